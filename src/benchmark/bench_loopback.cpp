@@ -0,0 +1,442 @@
+/********************************************************************************
+ *  File Name:
+ *    bench_loopback.cpp
+ *
+ *  Description:
+ *    Loopback benchmark implementation
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+/* Aurora Includes */
+#include <Aurora/logging>
+
+/* Chimera Includes */
+#include <Chimera/common>
+#include <Chimera/thread>
+
+/* Ripple Includes */
+#include <Ripple/benchmark>
+#include <Ripple/netif/loopback>
+#include <Ripple/netstack>
+#include <Ripple/packets>
+#include <Ripple/user>
+
+
+namespace Ripple::Benchmark
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr size_t MAX_PAYLOAD      = 255;                        /**< Largest record a PacketHdr can describe */
+  static constexpr size_t MAX_SENDERS      = RIPPLE_CTX_MAX_SOCKETS - 1; /**< One socket slot goes to the receiver */
+  static constexpr size_t STAMP_BYTES      = sizeof( uint32_t );         /**< Send time carried at the payload front */
+  static constexpr size_t LINE_BYTES       = 192;                        /**< Longest report line */
+  static constexpr size_t DEFAULT_PAYLOADS = 9;                          /**< Powers of two under MAX_PAYLOAD, then it */
+  static constexpr size_t DEFAULT_RATE[]   = { 0 };                      /**< Flat out only */
+
+  static_assert( RIPPLE_CTX_MAX_SOCKETS >= 2, "Benchmark needs a receiving and a sending socket" );
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  What the receive handler saw during a point. The handler runs on the
+   *  context thread and may still be running when a drain times out, so the
+   *  state is closed and the handler waited out before it is read or reset.
+   */
+  struct RXState
+  {
+    std::atomic<bool> open;        /**< Handler may record into the state */
+    std::atomic<uint32_t> busy;    /**< Handlers currently running */
+    std::atomic<uint32_t> packets; /**< Records received */
+    std::atomic<uint32_t> bytes;   /**< Payload bytes received */
+    std::atomic<uint32_t> last_us; /**< When the latest record arrived */
+    LatencyHistogram e2e;          /**< Socket write to the handler, for stamped payloads */
+  };
+
+  /**
+   *  Most memory a point used at once, sampled while it sends
+   */
+  struct UsagePeak
+  {
+    size_t minFree;                   /**< Fewest free context heap bytes */
+    size_t inUse[ POOL_NUM_OPTIONS ]; /**< Most blocks out of each pool */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Static Data
+  -------------------------------------------------------------------------------*/
+  static RXState s_rx;
+
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  static void onBenchPacket( const PacketId id, const PacketView &view )
+  {
+    const uint32_t now = static_cast<uint32_t>( Chimera::micros() );
+
+    s_rx.busy.fetch_add( 1 );
+    if ( s_rx.open.load() )
+    {
+      uint32_t stamp = 0;
+      if ( view.copy( &stamp, 0, STAMP_BYTES ) == STAMP_BYTES )
+      {
+        s_rx.e2e.add( now - stamp );
+      }
+
+      s_rx.bytes.fetch_add( static_cast<uint32_t>( view.size() ), std::memory_order_relaxed );
+      s_rx.last_us.store( now, std::memory_order_relaxed );
+      s_rx.packets.fetch_add( 1, std::memory_order_release );
+    }
+    s_rx.busy.fetch_sub( 1, std::memory_order_release );
+  }
+
+
+  /**
+   *  Stops the handler from recording and waits for any call still running
+   */
+  static void closeRX()
+  {
+    s_rx.open.store( false );
+    while ( s_rx.busy.load( std::memory_order_acquire ) )
+    {
+      Chimera::Thread::this_thread::yield();
+    }
+  }
+
+
+  /**
+   *  Narrows a figure for a %u field, so the format strings are right whatever
+   *  size_t and uint32_t are on the target
+   */
+  template<typename T>
+  static constexpr unsigned toU( const T value )
+  {
+    return static_cast<unsigned>( value );
+  }
+
+
+  static void logSink( const char *const line, const size_t length )
+  {
+    ( void )length;
+    LOG_INFO( "%s\r\n", line );
+  }
+
+
+  /**
+   *  Formats one line of the report and hands it to the sink
+   */
+  template<typename... Args>
+  static void emit( const BenchmarkSink &sink, const char *const format, Args... args )
+  {
+    char line[ LINE_BYTES ];
+    const int length = snprintf( line, sizeof( line ), format, args... );
+    if ( length > 0 )
+    {
+      const size_t written = static_cast<size_t>( length );
+      sink( line, ( written < sizeof( line ) ) ? written : ( sizeof( line ) - 1u ) );
+    }
+  }
+
+
+  static void sampleUsage( Context_rPtr context, UsagePeak &peak )
+  {
+    const size_t available = context->availableMemory();
+    peak.minFree           = ( available < peak.minFree ) ? available : peak.minFree;
+
+    for ( size_t pool = 0; pool < POOL_NUM_OPTIONS; pool++ )
+    {
+      PoolStats stats;
+      context->mHeap.getPoolStats( static_cast<PoolClass>( pool ), stats );
+      peak.inUse[ pool ] = ( stats.inUse > peak.inUse[ pool ] ) ? stats.inUse : peak.inUse[ pool ];
+    }
+  }
+
+
+  static size_t poolMisses( Context_rPtr context )
+  {
+    size_t misses = 0;
+    for ( size_t pool = 0; pool < POOL_NUM_OPTIONS; pool++ )
+    {
+      PoolStats stats;
+      context->mHeap.getPoolStats( static_cast<PoolClass>( pool ), stats );
+      misses += stats.misses;
+    }
+
+    return misses;
+  }
+
+
+  /**
+   *  Adds up the allocations and misses of the arenas of the first few senders
+   */
+  static void arenaUsage( Socket_rPtr *const senders, const size_t count, size_t &allocs, size_t &misses )
+  {
+    allocs = 0;
+    misses = 0;
+    for ( size_t idx = 0; idx < count; idx++ )
+    {
+      SocketStats stats;
+      senders[ idx ]->getStatistics( stats );
+      allocs += stats.memAllocs;
+      misses += stats.memMisses;
+    }
+  }
+
+
+  /**
+   *  Sends one point of the sweep and reports it
+   */
+  static void runPoint( Context_rPtr context, const LoopbackConfig &cfg, const BenchmarkSink &sink,
+                        Socket_rPtr *const senders, const size_t payload, const size_t numSenders, const size_t rate )
+  {
+    uint8_t data[ MAX_PAYLOAD ];
+    memset( data, 0xA5, sizeof( data ) );
+
+    /*-------------------------------------------------------------------------
+    Start from a clean slate. Counters that can't be reset are read now and
+    subtracted at the end.
+    -------------------------------------------------------------------------*/
+    closeRX();
+    s_rx.packets.store( 0 );
+    s_rx.bytes.store( 0 );
+    s_rx.last_us.store( 0 );
+    memset( &s_rx.e2e, 0, sizeof( s_rx.e2e ) );
+    s_rx.open.store( true );
+
+    UsagePeak peak           = {};
+    peak.minFree             = context->availableMemory();
+    const size_t freeAtStart = peak.minFree;
+
+    size_t arenaAllocs0 = 0;
+    size_t arenaMisses0 = 0;
+    arenaUsage( senders, numSenders, arenaAllocs0, arenaMisses0 );
+    const size_t heapAllocs0 = context->mHeap.allocs();
+    const size_t poolMisses0 = poolMisses( context );
+
+    /*-------------------------------------------------------------------------
+    Send round robin over the senders. Paced points hold the send times to a
+    fixed schedule, so a refused write still uses up its slot.
+    -------------------------------------------------------------------------*/
+    const uint32_t interval_us = rate ? static_cast<uint32_t>( 1000000u / rate ) : 0u;
+    const uint32_t start_us    = static_cast<uint32_t>( Chimera::micros() );
+    const size_t start_ms      = Chimera::millis();
+    uint32_t next_us           = start_us;
+    size_t sender              = 0;
+    size_t txCount             = 0;
+    size_t rejected            = 0;
+
+    while ( ( Chimera::millis() - start_ms ) < cfg.durationMs )
+    {
+      if ( rate && ( static_cast<int32_t>( static_cast<uint32_t>( Chimera::micros() ) - next_us ) < 0 ) )
+      {
+        Chimera::Thread::this_thread::yield();
+        continue;
+      }
+
+      if ( payload >= STAMP_BYTES )
+      {
+        const uint32_t stamp = static_cast<uint32_t>( Chimera::micros() );
+        memcpy( data, &stamp, STAMP_BYTES );
+      }
+
+      if ( transmitEncoded( cfg.packetId, nullptr, payload, *senders[ sender ], data, TXCallback(), 0 ) )
+      {
+        txCount++;
+        sampleUsage( context, peak );
+      }
+      else
+      {
+        /*---------------------------------------------------------------------
+        The stack is behind. Let the manager thread catch up.
+        ---------------------------------------------------------------------*/
+        rejected++;
+        Chimera::Thread::this_thread::yield();
+      }
+
+      next_us += interval_us;
+      sender = ( sender + 1u ) % numSenders;
+    }
+
+    /*-------------------------------------------------------------------------
+    Wait for whatever is still making its way through the stack
+    -------------------------------------------------------------------------*/
+    const size_t drainStart = Chimera::millis();
+    while ( ( s_rx.packets.load( std::memory_order_acquire ) < txCount ) &&
+            ( ( Chimera::millis() - drainStart ) < cfg.drainMs ) )
+    {
+      sampleUsage( context, peak );
+      Chimera::Thread::this_thread::yield();
+    }
+
+    /*-------------------------------------------------------------------------
+    Work out the rates over the time it took the packets to arrive, not just
+    the time spent sending them. Stragglers past the drain aren't counted.
+    -------------------------------------------------------------------------*/
+    closeRX();
+    const size_t rxCount     = s_rx.packets.load( std::memory_order_acquire );
+    const uint64_t elapsed   = rxCount ? static_cast<uint32_t>( s_rx.last_us.load() - start_us ) : 0u;
+    const size_t pktPerSec   = elapsed ? static_cast<size_t>( ( rxCount * 1000000ull ) / elapsed ) : 0u;
+    const size_t bytesPerSec = elapsed ? static_cast<size_t>( ( s_rx.bytes.load() * 1000000ull ) / elapsed ) : 0u;
+
+    size_t arenaAllocs = 0;
+    size_t arenaMisses = 0;
+    arenaUsage( senders, numSenders, arenaAllocs, arenaMisses );
+
+    const size_t allocs     = ( context->mHeap.allocs() - heapAllocs0 ) + ( arenaAllocs - arenaAllocs0 );
+    const size_t allocsX100 = rxCount ? ( ( allocs * 100u ) / rxCount ) : 0u;
+
+    emit( sink, "lb,%u,%u,%u,%u,%u,%u,%u,%u,%u.%02u,%u,%u,%u,%u,%u,%u,%u,%u,%u", toU( payload ), toU( numSenders ),
+          toU( rate ), toU( txCount ), toU( rxCount ), toU( rejected ), toU( pktPerSec ), toU( bytesPerSec ),
+          toU( allocsX100 / 100u ), toU( allocsX100 % 100u ), toU( freeAtStart - peak.minFree ),
+          toU( peak.inUse[ POOL_PAYLOAD ] ), toU( peak.inUse[ POOL_FRAGMENT ] ), toU( peak.inUse[ POOL_PACKET ] ),
+          toU( poolMisses( context ) - poolMisses0 ), toU( arenaMisses - arenaMisses0 ), toU( s_rx.e2e.percentile( 50 ) ),
+          toU( s_rx.e2e.percentile( 99 ) ), toU( s_rx.e2e.max_us ) );
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  bool runLoopback( Context_rPtr context, const LoopbackConfig &cfg )
+  {
+    using namespace Ripple::NetIf;
+
+    /*-------------------------------------------------------------------------
+    Input Protection
+    -------------------------------------------------------------------------*/
+    if ( !context || !cfg.durationMs )
+    {
+      return false;
+    }
+
+    const BenchmarkSink sink = cfg.sink.is_valid() ? cfg.sink : BenchmarkSink::create<logSink>();
+
+    /*-------------------------------------------------------------------------
+    Route the made up peer through a loopback interface. The packets still go
+    down to a netif and back up through assembly, like a real remote node.
+    -------------------------------------------------------------------------*/
+    Loopback::Adapter *netif = Loopback::createNetIf( context );
+    if ( !netif || !netif->powerUp( context ) || !context->attachNetif( netif ) ||
+         !context->addRoute( cfg.peerAddress, 32, netif ) )
+    {
+      LOG_ERROR( "Benchmark couldn't set up the loopback netif\r\n" );
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Work out the sweep, filling in defaults
+    -------------------------------------------------------------------------*/
+    size_t defaultPayloads[ DEFAULT_PAYLOADS ];
+    size_t defaultCount = 0;
+    for ( size_t bytes = 1; bytes < MAX_PAYLOAD; bytes *= 2u )
+    {
+      defaultPayloads[ defaultCount++ ] = bytes;
+    }
+    defaultPayloads[ defaultCount++ ] = MAX_PAYLOAD;
+
+    size_t defaultSenders[ MAX_SENDERS ];
+    for ( size_t idx = 0; idx < MAX_SENDERS; idx++ )
+    {
+      defaultSenders[ idx ] = idx + 1u;
+    }
+
+    const size_t *payloads   = cfg.payloads ? cfg.payloads : defaultPayloads;
+    const size_t *senders    = cfg.senders ? cfg.senders : defaultSenders;
+    const size_t *rates      = cfg.rates ? cfg.rates : DEFAULT_RATE;
+    const size_t numPayloads = cfg.payloads ? cfg.numPayloads : defaultCount;
+    const size_t numSenders  = cfg.senders ? cfg.numSenders : MAX_SENDERS;
+    const size_t numRates    = cfg.rates ? cfg.numRates : ARRAY_COUNT( DEFAULT_RATE );
+
+    size_t mostSenders = 0;
+    for ( size_t idx = 0; idx < numSenders; idx++ )
+    {
+      mostSenders = ( senders[ idx ] > mostSenders ) ? senders[ idx ] : mostSenders;
+    }
+
+    if ( mostSenders > MAX_SENDERS )
+    {
+      LOG_ERROR( "Benchmark can run at most %d senders\r\n", MAX_SENDERS );
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Sockets can't be given back, so every one the sweep needs is made once
+    -------------------------------------------------------------------------*/
+    SocketConfig rxCfg = {};
+    rxCfg.devicePort   = cfg.basePort;
+    rxCfg.rxFilter     = PacketFilter{ cfg.packetId };
+
+    Socket_rPtr receiver = context->socket( SocketType::PULL, cfg.socketCache );
+    if ( !receiver || ( receiver->open( rxCfg ) != Chimera::Status::OK ) ||
+         !onReceive( cfg.packetId, *receiver, onBenchPacket ) )
+    {
+      LOG_ERROR( "Benchmark couldn't create the receiving socket\r\n" );
+      return false;
+    }
+
+    Socket_rPtr sockets[ MAX_SENDERS ];
+    for ( size_t idx = 0; idx < mostSenders; idx++ )
+    {
+      SocketConfig txCfg = {};
+      txCfg.devicePort   = cfg.basePort + 1u + idx;
+      txCfg.txFilter     = PacketFilter{ cfg.packetId };
+
+      sockets[ idx ] = context->socket( SocketType::PUSH, cfg.socketCache );
+      if ( !sockets[ idx ] || ( sockets[ idx ]->open( txCfg ) != Chimera::Status::OK ) ||
+           ( sockets[ idx ]->connect( cfg.peerAddress, cfg.basePort ) != Chimera::Status::OK ) )
+      {
+        LOG_ERROR( "Benchmark couldn't create sending socket %d\r\n", idx );
+        return false;
+      }
+    }
+
+    /*-------------------------------------------------------------------------
+    Run every point of the sweep
+    -------------------------------------------------------------------------*/
+    emit( sink, "lb,payload,senders,rate,tx,rx,rejected,pkt_per_s,bytes_per_s,allocs_per_pkt,heap_peak,payload_peak,"
+                "frag_peak,packet_peak,pool_misses,arena_misses,e2e_p50_us,e2e_p99_us,e2e_max_us" );
+
+    for ( size_t p = 0; p < numPayloads; p++ )
+    {
+      for ( size_t s = 0; s < numSenders; s++ )
+      {
+        for ( size_t r = 0; r < numRates; r++ )
+        {
+          const size_t payload = ( payloads[ p ] < MAX_PAYLOAD ) ? payloads[ p ] : MAX_PAYLOAD;
+          if ( payload && senders[ s ] )
+          {
+            runPoint( context, cfg, sink, sockets, payload, senders[ s ], rates[ r ] );
+          }
+        }
+      }
+    }
+
+    /*-------------------------------------------------------------------------
+    Close with where the time went inside the stack over the whole run
+    -------------------------------------------------------------------------*/
+    static_assert( LAT_NUM_STAGES == 6, "Update the stage names" );
+    static const char *const stageNames[ LAT_NUM_STAGES ] = { "sock_tx", "link_queue", "link_air",
+                                                               "link_rx", "assembly",   "dispatch" };
+
+    LatencyReport latency;
+    context->getLatencyStats( latency );
+
+    emit( sink, "lb_stage,stage,p50_us,p99_us,max_us,samples" );
+    for ( size_t idx = 0; idx < LAT_NUM_STAGES; idx++ )
+    {
+      const LatencyHistogram &stage = latency.stage[ idx ];
+      emit( sink, "lb_stage,%s,%u,%u,%u,%u", stageNames[ idx ], toU( stage.percentile( 50 ) ), toU( stage.percentile( 99 ) ),
+            toU( stage.max_us ), toU( stage.count ) );
+    }
+
+    return true;
+  }
+
+}    // namespace Ripple::Benchmark
@@ -0,0 +1,92 @@
+/********************************************************************************
+ *  File Name:
+ *    bench_loopback.hpp
+ *
+ *  Description:
+ *    Throughput and latency benchmark of the net stack, run over the loopback
+ *    interface so no radio time is measured
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_BENCHMARK_LOOPBACK_HPP
+#define RIPPLE_BENCHMARK_LOOPBACK_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+/* ETL Includes */
+#include <etl/delegate.h>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/context.hpp>
+#include <Ripple/src/netstack/socket.hpp>
+#include <Ripple/src/shared/cmn_types.hpp>
+
+namespace Ripple::Benchmark
+{
+  /*-------------------------------------------------------------------------------
+  Aliases
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Takes one line of the report, without a line ending
+   */
+  using BenchmarkSink = etl::delegate<void( const char *const, const size_t )>;
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  What the loopback benchmark sweeps over. Every combination of payload
+   *  size, sender count and packet rate is run as a separate point. Leave a
+   *  list as nullptr to use its default.
+   */
+  struct LoopbackConfig
+  {
+    PacketId packetId      = 0;          /**< ID the benchmark records are sent as */
+    Port basePort          = 9000;       /**< Receiving port. The senders take the ones after it. */
+    IPAddress peerAddress  = 0x0A0000FE; /**< Made up node routed through the loopback, so packets aren't local */
+    size_t socketCache     = 4096;       /**< Bytes for each socket and its arena, a multiple of the word size */
+    const size_t *payloads = nullptr;    /**< Payload bytes to send, default powers of two up to the largest */
+    size_t numPayloads     = 0;
+    const size_t *senders  = nullptr;    /**< Sockets sending at once, default one up to the socket limit */
+    size_t numSenders      = 0;
+    const size_t *rates    = nullptr;    /**< Packets per second over all senders, 0 for flat out (the default) */
+    size_t numRates        = 0;
+    size_t durationMs      = 1000;       /**< How long each point sends for */
+    size_t drainMs         = 250;        /**< Longest to wait for packets still in flight after a point */
+    BenchmarkSink sink;                  /**< Where the report goes, the log if left unbound */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Runs the loopback benchmark. Creates a loopback netif, one PULL socket and
+   *  a PUSH socket per sender, then for each point of the sweep sends records
+   *  with transmitEncoded() and times them into the receive handler.
+   *
+   *  The report is CSV. A header line starting with "lb," is followed by one
+   *  row per point:
+   *
+   *    payload, senders, rate, tx, rx, rejected, pkt_per_s, bytes_per_s,
+   *    allocs_per_pkt, heap_peak, payload_peak, frag_peak, packet_peak,
+   *    pool_misses, arena_misses, e2e_p50_us, e2e_p99_us, e2e_max_us
+   *
+   *  then by one "lb_stage," row per LatencyStage with the context histograms
+   *  gathered over the whole run.
+   *
+   *  @note Sockets can't be handed back, so give the benchmark a context of its
+   *        own with every socket slot free. It also isn't reentrant.
+   *
+   *  @param[in]  context       Context to benchmark, already created
+   *  @param[in]  cfg           What to sweep over
+   *  @return bool              False if the netif or sockets couldn't be set up
+   */
+  bool runLoopback( Context_rPtr context, const LoopbackConfig &cfg );
+
+}    // namespace Ripple::Benchmark
+
+#endif /* !RIPPLE_BENCHMARK_LOOPBACK_HPP */
@@ -24,6 +24,7 @@
 #include <Ripple/src/netif/device_types.hpp>
 #include <Ripple/src/netstack/packets/fragment.hpp>
 #include <Ripple/src/netstack/types.hpp>
+#include <Ripple/src/shared/cmn_latency.hpp>
 #include <Ripple/src/shared/cmn_types.hpp>
 
 namespace Ripple::NetIf
@@ -130,15 +131,33 @@ namespace Ripple::NetIf
      *
      *  @param[in]  head        Root of the message to send
      *  @param[in]  ip          Address to send to
+     *  @param[in]  tc          Priority class of the message
      *  @return Chimera::Status_t
      *
      *  @retval Chimera::Status::OK       The entire fragment list was sent
      *  @retval Chimera::Status::READY    Ready to transmit the next fragment
-     *  @retval Chimera::Status::FULL     Cannot accept any more fragments just yet
+     *  @retval Chimera::Status::FULL     Cannot accept the whole message just yet. None of it was queued.
      *  @retval Chimera::Status::MEMORY   There was an issue with memory
      *  @retval Chimera::Status::FAIL     Some kind of unhandled error occurred
      */
-    virtual Chimera::Status_t send( const Fragment_sPtr head, const IPAddress &ip ) = 0;
+    virtual Chimera::Status_t send( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc ) = 0;
+
+    /**
+     *  Transmits a message once to every node in range. Nothing is ACKed, so
+     *  delivery is best effort. Each frame can be sent more than once to make
+     *  loss less likely. Receivers drop the extra copies.
+     *
+     *  @param[in]  head        Root of the message to send
+     *  @param[in]  repeats     Extra copies of each frame to send
+     *  @param[in]  tc          Priority class of the message
+     *  @return Chimera::Status_t
+     *
+     *  @retval Chimera::Status::READY    Every frame was queued for transmit
+     *  @retval Chimera::Status::FULL     Not enough room to queue the message, nothing was queued
+     *  @retval Chimera::Status::MEMORY   There was an issue with memory
+     *  @retval Chimera::Status::NOT_SUPPORTED  The interface can't multicast
+     */
+    virtual Chimera::Status_t sendMulticast( const Fragment_sPtr head, const uint8_t repeats, const TrafficClass tc ) = 0;
 
     /**
      * @brief Get the runtime statistics of the interface driver
@@ -147,6 +166,16 @@ namespace Ripple::NetIf
      */
     virtual void getStats( PerfStats &stats ) = 0;
 
+    /**
+     * @brief Get the latency histograms of the stages the interface owns
+     *
+     * Stages handled by other layers are left empty, so the report can be
+     * merged with theirs.
+     *
+     * @param report  Report to fill
+     */
+    virtual void getLatencyStats( LatencyReport &report ) = 0;
+
     /**
      *  Gets the interface's address resolver
      *  @return IARP *
@@ -159,6 +188,13 @@ namespace Ripple::NetIf
      */
     virtual size_t maxTransferSize() const = 0;
 
+    /**
+     *  Max data size that can be sent without fragmenting. This may be larger
+     *  than maxTransferSize() if unfragmented data needs less header space.
+     *  @return size_t
+     */
+    virtual size_t maxUnfragmentedSize() const = 0;
+
     /**
      * @brief Maximum number of fragments the network can handle
      * @return size_t
@@ -177,6 +213,19 @@ namespace Ripple::NetIf
      */
     virtual size_t lastActive() const = 0;
 
+    /**
+     *  Reads the network wide clock, for interfaces that keep one in step
+     *  across nodes
+     *
+     *  @param[out] now_us      Current network time (uS)
+     *  @return bool            False if the interface has no synced clock
+     */
+    virtual bool networkTime( uint64_t &now_us )
+    {
+      ( void )now_us;
+      return false;
+    }
+
   private:
     friend Chimera::Thread::Lockable<INetIf>;
   };
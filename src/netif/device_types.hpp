@@ -16,6 +16,9 @@
 #include <cstdint>
 #include <cstddef>
 
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_profile.hpp>
+
 namespace Ripple::NetIf
 {
   /*-------------------------------------------------------------------------------
@@ -35,10 +38,26 @@ namespace Ripple::NetIf
     CB_ERROR_TX_QUEUE_FULL, /**< A frame failed to be placed into the TX queue */
     CB_ERROR_ARP_RESOLVE,   /**< ARP could not resolve the destination address */
     CB_ERROR_ARP_LIMIT,     /**< ARP cache has reached the max storage entries */
+    CB_PEER_LOST,           /**< A neighbor stopped answering and was dropped from the ARP cache */
+    CB_SERVICE_OVERRUN,     /**< A pass of the driver thread ran past its time budget */
 
     CB_NUM_OPTIONS
   };
 
+  /**
+   *  Transmit priority classes, highest priority first. Interfaces that can
+   *  schedule their own traffic serve the classes in this order.
+   */
+  enum TrafficClass : uint8_t
+  {
+    TC_CONTROL,  /**< Small command/control messages that must never wait on other traffic */
+    TC_REALTIME, /**< Latency sensitive data, such as telemetry streams */
+    TC_BULK,     /**< Throughput oriented data, such as log or file uploads */
+
+    TC_NUM_OPTIONS,
+    TC_DEFAULT = TC_REALTIME
+  };
+
   /*-------------------------------------------------------------------------------
   Structures
   -------------------------------------------------------------------------------*/
@@ -63,6 +82,29 @@ namespace Ripple::NetIf
     uint32_t link_speed_rx; /**< Received bytes per second */
     uint32_t link_speed_tx; /**< Transmitted bytes per second */
     uint32_t link_up_time;  /**< Time the link has been up (ms) */
+
+    uint32_t tx_latency_last_us;        /**< Latest TX request to on-air latency (uS) */
+    uint32_t tx_latency_avg_us;         /**< Smoothed TX request to on-air latency (uS) */
+    uint32_t tx_latency_max_us;         /**< Worst case TX request to on-air latency (uS) */
+    uint32_t tx_control_latency_max_us; /**< Worst case latency seen by TC_CONTROL traffic (uS) */
+
+    uint32_t mode_transitions;         /**< Radio mode changes that reached the hardware */
+    uint32_t mode_transitions_skipped; /**< Mode change requests that were already satisfied */
+    uint32_t mode_time_off_ms;         /**< Time spent powered down */
+    uint32_t mode_time_standby_ms;     /**< Time spent in standby */
+    uint32_t mode_time_rx_ms;          /**< Time spent listening */
+    uint32_t mode_time_tx_ms;          /**< Time spent transmitting */
+
+    uint32_t rf_channel;   /**< RF channel currently in use */
+    uint32_t channel_hops; /**< Number of times the link moved channels */
+
+    uint32_t frame_fwd;      /**< Frames relayed toward another node */
+    uint32_t frame_fwd_drop; /**< Frames that could not be relayed */
+
+    uint32_t keepalive_tx; /**< Keepalives sent to quiet neighbors */
+    uint32_t peers_lost;   /**< Neighbors declared gone after going silent */
+
+    ThreadLoad load; /**< Driver thread CPU and stack usage, zeroed if it has no thread */
   };
 
 }  // namespace Ripple
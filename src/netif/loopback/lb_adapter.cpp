@@ -8,6 +8,9 @@
  *  2021 | Brandon Braun | brandonbraun653@gmail.com
  *******************************************************************************/
 
+/* STL Includes */
+#include <algorithm>
+
 /* Aurora Includes */
 #include <Aurora/logging>
 
@@ -39,10 +42,17 @@ namespace Ripple::NetIf::Loopback
   }
 
 
+  Adapter *createNetIf( StaticSlot<Adapter> &slot )
+  {
+    void *ptr = slot.claim();
+    return ptr ? new ( ptr ) Adapter() : nullptr;
+  }
+
+
   /*-------------------------------------------------------------------------------
   Service Class Implementation
   -------------------------------------------------------------------------------*/
-  Adapter::Adapter()
+  Adapter::Adapter() : mQueuedFrags( 0 ), mLock( nullptr )
   {
   }
 
@@ -71,6 +81,7 @@ namespace Ripple::NetIf::Loopback
     mContext = reinterpret_cast<Context_rPtr>( context );
     mAddressCache.clear();
     mPacketQueue.clear();
+    mQueuedFrags = 0;
     memset( &mStats, 0, sizeof( mStats ) );
 
     auto lock_mem = mContext->malloc( sizeof( Chimera::Thread::Mutex ) );
@@ -96,45 +107,123 @@ namespace Ripple::NetIf::Loopback
     Chimera::Thread::LockGuard lck( *mLock );
 
     /*-------------------------------------------------
-    Pop off the first element in the queue
+    Hand back a whole message per call. The chain is
+    only read from here on, never relinked.
     -------------------------------------------------*/
     if ( mPacketQueue.empty() )
     {
       return Chimera::Status::EMPTY;
     }
 
-    mPacketQueue.pop_into( fragmentList );
+    LoopbackEntry &entry = mPacketQueue.front();
+    fragmentList         = entry.head;
+    mQueuedFrags -= entry.frags;
+    mStats.frame_rx += entry.frags;
+    mStats.rx_bytes += entry.bytes;
+
+    mPacketQueue.pop();
     return Chimera::Status::READY;
   }
 
 
-  Chimera::Status_t Adapter::send( const Fragment_sPtr msg, const IPAddress &ip )
+  Chimera::Status_t Adapter::send( const Fragment_sPtr msg, const IPAddress &ip, const TrafficClass tc )
   {
-    Chimera::Thread::LockGuard lck( *mLock );
+    if ( !msg )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
 
-    Fragment_sPtr fragPtr = msg;
-    while ( fragPtr )
+    /*-------------------------------------------------
+    Size up the chain for admission control
+    -------------------------------------------------*/
+    size_t numFrags = 0;
+    size_t numBytes = 0;
+    for ( Fragment_sPtr fragPtr = msg; fragPtr; fragPtr = fragPtr->next )
+    {
+      numFrags++;
+      numBytes += fragPtr->length;
+    }
+
+    /*-------------------------------------------------
+    A message bigger than the whole budget would never
+    fit, so it can't be left to retry
+    -------------------------------------------------*/
+    if ( numFrags > LB_FRAG_BUDGET )
+    {
+      Chimera::Thread::LockGuard lck( *mLock );
+      mStats.frame_tx_drop += numFrags;
+      mStats.tx_bytes_lost += numBytes;
+      return Chimera::Status::MEMORY;
+    }
+
+    /*-------------------------------------------------
+    Queue the whole message by reference, or none of it
+    -------------------------------------------------*/
+    bool accepted = false;
     {
-      auto newFragment = fragmentShallowCopy( &mContext->mHeap, fragPtr );
+      Chimera::Thread::LockGuard lck( *mLock );
 
-      if ( !mPacketQueue.full() )
+      if ( !mPacketQueue.full() && ( ( mQueuedFrags + numFrags ) <= LB_FRAG_BUDGET ) )
       {
-        mPacketQueue.push( newFragment );
+        LoopbackEntry entry;
+        entry.head  = msg;
+        entry.frags = static_cast<uint16_t>( numFrags );
+        entry.bytes = static_cast<uint16_t>( numBytes );
+        mPacketQueue.push( entry );
+
+        mQueuedFrags += numFrags;
+        mStats.frame_tx += numFrags;
+        mStats.tx_bytes += numBytes;
+        accepted = true;
       }
+      else
+      {
+        mStats.frame_tx_drop += numFrags;
+        mStats.tx_bytes_lost += numBytes;
+      }
+    }
 
-      fragPtr = fragPtr->next;
+    if ( !accepted )
+    {
+      mCBService_registry.call<CallbackId::CB_ERROR_TX_QUEUE_FULL>();
+      return Chimera::Status::FULL;
     }
 
+    /*-------------------------------------------------
+    Tell the context the frames are waiting, same as a
+    radio would, instead of leaving them for its timer
+    -------------------------------------------------*/
+    mCBService_registry.call<CallbackId::CB_RX_SUCCESS>();
     return Chimera::Status::OK;
   }
 
 
+  Chimera::Status_t Adapter::sendMulticast( const Fragment_sPtr msg, const uint8_t repeats, const TrafficClass tc )
+  {
+    /*-------------------------------------------------
+    The only node reachable is this one, and nothing is
+    ever lost, so repeats aren't needed.
+    -------------------------------------------------*/
+    ( void )repeats;
+    return send( msg, mContext->getIPAddress(), tc );
+  }
+
+
   void Adapter::getStats( PerfStats &stats )
   {
-    Chimera::Thread::LockGuard _lock( *this );
+    Chimera::Thread::LockGuard _lock( *mLock );
     stats = mStats;
   }
 
+  void Adapter::getLatencyStats( LatencyReport &report )
+  {
+    /*-------------------------------------------------
+    Frames never wait on a radio here, so there are no
+    link stages to report on
+    -------------------------------------------------*/
+    report.clear();
+  }
+
   IARP *Adapter::addressResolver()
   {
     return this;
@@ -146,9 +235,14 @@ namespace Ripple::NetIf::Loopback
     return 29;    // Simulate packet size of NRF24L01
   }
 
+  size_t Adapter::maxUnfragmentedSize() const
+  {
+    return maxTransferSize();
+  }
+
   size_t Adapter::maxNumFragments() const
   {
-    return 512;    // Arbitrary. No real limit outside of memory.
+    return std::min<size_t>( LB_FRAG_BUDGET, FRAG_MAX_PER_PACKET );
   }
 
 
@@ -22,6 +22,7 @@
 /* Ripple Includes */
 #include <Ripple/src/netstack/context.hpp>
 #include <Ripple/src/netif/device_intf.hpp>
+#include <Ripple/src/shared/cmn_static.hpp>
 
 namespace Ripple::NetIf::Loopback
 {
@@ -29,11 +30,28 @@ namespace Ripple::NetIf::Loopback
   Constants
   -------------------------------------------------------------------------------*/
   #if defined( EMBEDDED )
-  #define LB_QUEUE_DEPTH  ( 16 )
+  #define LB_QUEUE_DEPTH  ( 4 )
+  #define LB_FRAG_BUDGET  ( 16 )
   #else   /* SIMULATOR */
-  #define LB_QUEUE_DEPTH  ( 512 )
+  #define LB_QUEUE_DEPTH  ( 64 )
+  #define LB_FRAG_BUDGET  ( 512 )
   #endif  /* EMBEDDED */
 
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  One message waiting to be looped back. The chain is the sender's own,
+   *  shared rather than copied, which is safe because nothing edits a chain
+   *  once it has been handed to a netif.
+   */
+  struct LoopbackEntry
+  {
+    Fragment_sPtr head; /**< First fragment of the message */
+    uint16_t frags;     /**< Fragments in the chain, held against the budget */
+    uint16_t bytes;     /**< Payload bytes in the chain */
+  };
+
   /*-------------------------------------------------------------------------------
   Classes
   -------------------------------------------------------------------------------*/
@@ -52,10 +70,13 @@ namespace Ripple::NetIf::Loopback
     bool powerUp( void * context ) final override;
     void powerDn() final override;
     Chimera::Status_t recv( Fragment_sPtr &fragmentList ) final override;
-    Chimera::Status_t send( const Fragment_sPtr head, const IPAddress &ip ) final override;
+    Chimera::Status_t send( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc ) final override;
+    Chimera::Status_t sendMulticast( const Fragment_sPtr head, const uint8_t repeats, const TrafficClass tc ) final override;
     void getStats( PerfStats &stats ) final override;
+    void getLatencyStats( LatencyReport &report ) final override;
     IARP *addressResolver() final override;
     size_t maxTransferSize() const final override;
+    size_t maxUnfragmentedSize() const final override;
     size_t maxNumFragments() const final override;
     size_t linkSpeed() const final override;
     size_t lastActive() const final override;
@@ -71,7 +92,8 @@ namespace Ripple::NetIf::Loopback
   private:
     Context_rPtr mContext;
     etl::map<IPAddress, uint64_t, 32> mAddressCache;
-    etl::queue<Fragment_sPtr, LB_QUEUE_DEPTH> mPacketQueue;
+    etl::queue<LoopbackEntry, LB_QUEUE_DEPTH> mPacketQueue;
+    size_t mQueuedFrags; /**< Fragments held by the queue, at most LB_FRAG_BUDGET */
     Chimera::Thread::Mutex *mLock;
     PerfStats mStats;
   };
@@ -86,6 +108,14 @@ namespace Ripple::NetIf::Loopback
    *  @return Handle *
    */
   Adapter *createNetIf( Context_rPtr context );
+
+  /**
+   *  Creates a loopback handle in statically placed storage
+   *
+   *  @param[in]  slot          Storage to construct into
+   *  @return Adapter *         nullptr if the slot was already claimed
+   */
+  Adapter *createNetIf( StaticSlot<Adapter> &slot );
 }  // namespace Ripple::NetIf::Loopback
 
 #endif  /* !RIPPLE_NETIF_LOOPBACK_HPP */
@@ -0,0 +1,470 @@
+/********************************************************************************
+ *  File Name:
+ *    bond_adapter.cpp
+ *
+ *  Description:
+ *    Implements bonding of two NRF24 data links
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <algorithm>
+#include <limits>
+
+/* Aurora Includes */
+#include <Aurora/logging>
+
+/* Chimera Includes */
+#include <Chimera/assert>
+#include <Chimera/thread>
+
+/* Ripple Includes */
+#include <Ripple/netif/nrf24l01>
+#include <Ripple/netstack>
+
+/*-------------------------------------------------------------------------------
+Literals
+-------------------------------------------------------------------------------*/
+#define DEBUG_MODULE ( true )
+
+/**
+ *  How many more frames the TX link must have queued than the RX link before
+ *  a fragment spills over to the RX link. Every spilled fragment briefly takes
+ *  the RX radio out of RX, so this trades incoming for outgoing bandwidth.
+ */
+#if !defined( NRF_BOND_RX_SPILL_DEPTH )
+#define NRF_BOND_RX_SPILL_DEPTH ( 4 )
+#endif
+
+/**
+ *  Lets fragments spill over to the RX link at all. Off by default, so the RX
+ *  radio stays listening and all traffic leaves through the TX link.
+ */
+#if !defined( NRF_BOND_RX_SPILL )
+#define NRF_BOND_RX_SPILL ( false )
+#endif
+
+namespace Ripple::NetIf::NRF24::Bonding
+{
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  BondedLink *createNetIf( Context_rPtr context, DataLink::DataLink *const txLink, DataLink::DataLink *const rxLink )
+  {
+    RT_HARD_ASSERT( context && txLink && rxLink && ( txLink != rxLink ) );
+    void *ptr = context->malloc( sizeof( BondedLink ) );
+    return new ( ptr ) BondedLink( txLink, rxLink );
+  }
+
+
+  BondedLink *createNetIf( StaticSlot<BondedLink> &slot, DataLink::DataLink *const txLink,
+                           DataLink::DataLink *const rxLink )
+  {
+    RT_HARD_ASSERT( txLink && rxLink && ( txLink != rxLink ) );
+    void *ptr = slot.claim();
+    return ptr ? new ( ptr ) BondedLink( txLink, rxLink ) : nullptr;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service Class Implementation
+  -------------------------------------------------------------------------------*/
+  BondedLink::BondedLink( DataLink::DataLink *const txLink, DataLink::DataLink *const rxLink ) :
+      mTXLink( txLink ), mRXLink( rxLink )
+  {
+  }
+
+
+  BondedLink::~BondedLink()
+  {
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: Net Interface
+  -------------------------------------------------------------------------------*/
+  bool BondedLink::powerUp( void *context )
+  {
+    /*-------------------------------------------------
+    Input Protection
+    -------------------------------------------------*/
+    if ( !context )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------
+    Events from either radio are reported as the bond's
+    -------------------------------------------------*/
+    for ( DataLink::DataLink *link : { mTXLink, mRXLink } )
+    {
+      for ( size_t id = 0; id < CallbackId::CB_NUM_OPTIONS; id++ )
+      {
+        link->registerCallback( static_cast<CallbackId>( id ),
+                                etl::delegate<void( size_t )>::create<BondedLink, &BondedLink::cb_Forward>( *this ) );
+      }
+    }
+
+    /*-------------------------------------------------
+    The RX radio must never leave its channel, or the
+    point of having it is lost
+    -------------------------------------------------*/
+    mRXLink->setDedicatedRX( true );
+
+    if ( !mTXLink->powerUp( context ) )
+    {
+      LOG_ERROR( "Bond failed to power up the TX link\r\n" );
+      return false;
+    }
+
+    if ( !mRXLink->powerUp( context ) )
+    {
+      LOG_ERROR( "Bond failed to power up the RX link\r\n" );
+      mTXLink->powerDn();
+      return false;
+    }
+
+    return true;
+  }
+
+
+  void BondedLink::powerDn()
+  {
+    mTXLink->powerDn();
+    mRXLink->powerDn();
+  }
+
+
+  Chimera::Status_t BondedLink::recv( Fragment_sPtr &fragmentList )
+  {
+    /*-------------------------------------------------
+    Most traffic lands on the RX link, but the TX link
+    listens between transfers and may have some too
+    -------------------------------------------------*/
+    Fragment_sPtr rxList = Fragment_sPtr();
+    Fragment_sPtr txList = Fragment_sPtr();
+
+    const Chimera::Status_t rxResult = mRXLink->recv( rxList );
+    const Chimera::Status_t txResult = mTXLink->recv( txList );
+
+    /*-------------------------------------------------
+    Order does not matter to the caller, so the TX list
+    is simply tacked on the end
+    -------------------------------------------------*/
+    if ( rxList && txList )
+    {
+      Fragment_sPtr tail = rxList;
+      while ( tail->next )
+      {
+        tail = tail->next;
+      }
+
+      tail->next = std::move( txList );
+    }
+    else if ( txList )
+    {
+      rxList = std::move( txList );
+    }
+
+    if ( rxList )
+    {
+      fragmentList = std::move( rxList );
+      return Chimera::Status::READY;
+    }
+
+    if ( ( rxResult == Chimera::Status::MEMORY ) || ( txResult == Chimera::Status::MEMORY ) )
+    {
+      return Chimera::Status::MEMORY;
+    }
+
+    return Chimera::Status::EMPTY;
+  }
+
+
+  Chimera::Status_t BondedLink::send( const Fragment_sPtr msg, const IPAddress &ip, const TrafficClass tc )
+  {
+    /*-------------------------------------------------
+    Input Protections
+    -------------------------------------------------*/
+    if ( !msg || ( tc >= TC_NUM_OPTIONS ) )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+
+    /*-------------------------------------------------
+    Serialize producers, including the housekeeping of
+    each radio, so the room read below still holds when
+    the fragments are handed over
+    -------------------------------------------------*/
+    Chimera::Thread::LockGuard lck( *this );
+    Chimera::Thread::LockGuard txLinkLock( mTXLink->txProducerLock() );
+    Chimera::Thread::LockGuard rxLinkLock( mRXLink->txProducerLock() );
+
+    size_t txDepth = mTXLink->txQueueDepth( tc );
+    size_t txSpace = mTXLink->txQueueSpace( tc );
+    size_t rxDepth = mRXLink->txQueueDepth( tc );
+    size_t rxSpace = NRF_BOND_RX_SPILL ? mRXLink->txQueueSpace( tc ) : 0;
+
+    /*-------------------------------------------------
+    Stripe the fragments. Each one goes to the TX link
+    unless it has backed up past the RX link by more
+    than the spill depth, or it is out of room.
+    -------------------------------------------------*/
+    FragmentMask txSelect = 0;
+    FragmentMask rxSelect = 0;
+    size_t position       = 0;
+
+    for ( Fragment_sPtr fragPtr = msg; fragPtr; fragPtr = fragPtr->next, position++ )
+    {
+      if ( position >= maxNumFragments() )
+      {
+        return Chimera::Status::INVAL_FUNC_PARAM;
+      }
+
+      const bool backedUp = ( txDepth > rxDepth ) && ( ( txDepth - rxDepth ) > NRF_BOND_RX_SPILL_DEPTH );
+      if ( txSpace && ( !backedUp || !rxSpace ) )
+      {
+        txSelect |= ( static_cast<FragmentMask>( 1u ) << position );
+        txDepth++;
+        txSpace--;
+      }
+      else if ( rxSpace )
+      {
+        rxSelect |= ( static_cast<FragmentMask>( 1u ) << position );
+        rxDepth++;
+        rxSpace--;
+      }
+      else
+      {
+        return Chimera::Status::FULL;
+      }
+    }
+
+    /*-------------------------------------------------
+    Both links have to take their share before either
+    is handed one, so a refusal leaves nothing sent.
+    Room found here holds, as the producer locks are
+    held and the consumers only free slots.
+    -------------------------------------------------*/
+    Chimera::Status_t result = Chimera::Status::READY;
+    if ( txSelect )
+    {
+      result = mTXLink->checkSelected( msg, ip, tc, txSelect );
+    }
+
+    if ( rxSelect && ( result == Chimera::Status::READY ) )
+    {
+      result = mRXLink->checkSelected( msg, ip, tc, rxSelect );
+    }
+
+    if ( result != Chimera::Status::READY )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Bond link refused a message: %d\r\n", result );
+      return result;
+    }
+
+    /*-------------------------------------------------
+    A route learned in between can still change what
+    the RX link accepts. Its share is then offered to
+    the TX link, which already holds the rest, rather
+    than leaving the message half sent.
+    -------------------------------------------------*/
+    if ( txSelect )
+    {
+      result = mTXLink->sendSelected( msg, ip, tc, txSelect );
+    }
+
+    if ( rxSelect && ( result == Chimera::Status::READY ) )
+    {
+      result = mRXLink->sendSelected( msg, ip, tc, rxSelect );
+      if ( ( result != Chimera::Status::READY ) && txSelect )
+      {
+        LOG_DEBUG_IF( DEBUG_MODULE, "RX link refused its share: %d, sending it on the TX link\r\n", result );
+        result = mTXLink->sendSelected( msg, ip, tc, rxSelect );
+      }
+    }
+
+    if ( result != Chimera::Status::READY )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Bond link refused a message: %d\r\n", result );
+    }
+
+    return result;
+  }
+
+
+  Chimera::Status_t BondedLink::sendMulticast( const Fragment_sPtr msg, const uint8_t repeats, const TrafficClass tc )
+  {
+    /*-------------------------------------------------
+    Multicast can't be split without losing the spacing
+    between copies, so it all goes out the TX link
+    -------------------------------------------------*/
+    return mTXLink->sendMulticast( msg, repeats, tc );
+  }
+
+
+  void BondedLink::getStats( PerfStats &stats )
+  {
+    PerfStats rxStats;
+    mTXLink->getStats( stats );
+    mRXLink->getStats( rxStats );
+
+    /*-------------------------------------------------
+    Traffic adds up across the radios. Latency and the
+    channel are reported for the TX link, except for the
+    worst cases, which are taken from either.
+    -------------------------------------------------*/
+    stats.tx_bytes += rxStats.tx_bytes;
+    stats.tx_bytes_lost += rxStats.tx_bytes_lost;
+    stats.rx_bytes += rxStats.rx_bytes;
+    stats.rx_bytes_lost += rxStats.rx_bytes_lost;
+    stats.frame_tx += rxStats.frame_tx;
+    stats.frame_rx += rxStats.frame_rx;
+    stats.frame_tx_fail += rxStats.frame_tx_fail;
+    stats.frame_tx_drop += rxStats.frame_tx_drop;
+    stats.frame_rx_drop += rxStats.frame_rx_drop;
+    stats.link_speed_rx += rxStats.link_speed_rx;
+    stats.link_speed_tx += rxStats.link_speed_tx;
+    stats.link_up_time = std::max( stats.link_up_time, rxStats.link_up_time );
+
+    stats.tx_latency_max_us         = std::max( stats.tx_latency_max_us, rxStats.tx_latency_max_us );
+    stats.tx_control_latency_max_us = std::max( stats.tx_control_latency_max_us, rxStats.tx_control_latency_max_us );
+
+    stats.mode_transitions += rxStats.mode_transitions;
+    stats.mode_transitions_skipped += rxStats.mode_transitions_skipped;
+    stats.mode_time_off_ms += rxStats.mode_time_off_ms;
+    stats.mode_time_standby_ms += rxStats.mode_time_standby_ms;
+    stats.mode_time_rx_ms += rxStats.mode_time_rx_ms;
+    stats.mode_time_tx_ms += rxStats.mode_time_tx_ms;
+
+    stats.channel_hops += rxStats.channel_hops;
+    stats.frame_fwd += rxStats.frame_fwd;
+    stats.frame_fwd_drop += rxStats.frame_fwd_drop;
+    stats.keepalive_tx += rxStats.keepalive_tx;
+    stats.peers_lost += rxStats.peers_lost;
+  }
+
+
+  void BondedLink::getLatencyStats( LatencyReport &report )
+  {
+    /*-------------------------------------------------
+    Histograms add up, so the bond simply reports the
+    samples of both radios together
+    -------------------------------------------------*/
+    LatencyReport rxReport;
+    mTXLink->getLatencyStats( report );
+    mRXLink->getLatencyStats( rxReport );
+    report.merge( rxReport );
+  }
+
+
+  IARP *BondedLink::addressResolver()
+  {
+    return this;
+  }
+
+
+  size_t BondedLink::maxTransferSize() const
+  {
+    return std::min( mTXLink->maxTransferSize(), mRXLink->maxTransferSize() );
+  }
+
+
+  size_t BondedLink::maxUnfragmentedSize() const
+  {
+    return std::min( mTXLink->maxUnfragmentedSize(), mRXLink->maxUnfragmentedSize() );
+  }
+
+
+  size_t BondedLink::maxNumFragments() const
+  {
+    return std::min( mTXLink->maxNumFragments(), mRXLink->maxNumFragments() );
+  }
+
+
+  size_t BondedLink::linkSpeed() const
+  {
+    return mTXLink->linkSpeed() + mRXLink->linkSpeed();
+  }
+
+
+  size_t BondedLink::lastActive() const
+  {
+    return std::max( mTXLink->lastActive(), mRXLink->lastActive() );
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: ARP Interface
+  -------------------------------------------------------------------------------*/
+  Chimera::Status_t BondedLink::addARPEntry( const IPAddress &ip, const void *const mac, const size_t size )
+  {
+    /*-------------------------------------------------
+    Keep both caches in step. An entry only one of the
+    radios knows would make striping go wrong.
+    -------------------------------------------------*/
+    Chimera::Thread::LockGuard lck( *this );
+
+    const Chimera::Status_t result = mTXLink->addARPEntry( ip, mac, size );
+    if ( result != Chimera::Status::OK )
+    {
+      return result;
+    }
+
+    if ( mRXLink->addARPEntry( ip, mac, size ) != Chimera::Status::OK )
+    {
+      mTXLink->dropARPEntry( ip );
+      return Chimera::Status::FAIL;
+    }
+
+    return Chimera::Status::OK;
+  }
+
+
+  Chimera::Status_t BondedLink::dropARPEntry( const IPAddress &ip )
+  {
+    Chimera::Thread::LockGuard lck( *this );
+
+    mTXLink->dropARPEntry( ip );
+    mRXLink->dropARPEntry( ip );
+    return Chimera::Status::OK;
+  }
+
+
+  bool BondedLink::arpLookUp( const IPAddress &ip, void *const mac, const size_t size )
+  {
+    return mTXLink->arpLookUp( ip, mac, size );
+  }
+
+
+  IPAddress BondedLink::arpLookUp( const void *const mac, const size_t size )
+  {
+    return mTXLink->arpLookUp( mac, size );
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: Public Methods
+  -------------------------------------------------------------------------------*/
+  DataLink::DataLink *BondedLink::txLink() const
+  {
+    return mTXLink;
+  }
+
+
+  DataLink::DataLink *BondedLink::rxLink() const
+  {
+    return mRXLink;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: Private Methods
+  -------------------------------------------------------------------------------*/
+  void BondedLink::cb_Forward( size_t id )
+  {
+    mCBService_registry.call( id );
+  }
+
+}    // namespace Ripple::NetIf::NRF24::Bonding
@@ -0,0 +1,125 @@
+/********************************************************************************
+ *  File Name:
+ *    bond_adapter.hpp
+ *
+ *  Description:
+ *    Bonds two NRF24 data links into a single full duplex network interface
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_NETIF_NRF24_BONDING_HPP
+#define RIPPLE_NETIF_NRF24_BONDING_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/context.hpp>
+#include <Ripple/src/netif/device_intf.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_service.hpp>
+#include <Ripple/src/shared/cmn_static.hpp>
+
+namespace Ripple::NetIf::NRF24::Bonding
+{
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Drives two radios as one logical link. The TX link carries outgoing data,
+   *  while the RX link stays listening on its own channel, so a frame can
+   *  arrive while another is on air. Fragments only spill over to the RX link
+   *  once the TX link has backed up, picking whichever queue is shallower.
+   *
+   *  Attach only the bond to the Context, never the links it wraps. Both links
+   *  are handed the same ARP entries, so the Context sees a single table.
+   */
+  class BondedLink : public INetIf, public IARP
+  {
+  public:
+    BondedLink( DataLink::DataLink *const txLink, DataLink::DataLink *const rxLink );
+    ~BondedLink();
+
+    /*-------------------------------------------------------------------------------
+    Net Interface
+    -------------------------------------------------------------------------------*/
+    bool powerUp( void * context ) final override;
+    void powerDn() final override;
+    Chimera::Status_t recv( Fragment_sPtr &fragmentList ) final override;
+    Chimera::Status_t send( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc ) final override;
+    Chimera::Status_t sendMulticast( const Fragment_sPtr head, const uint8_t repeats, const TrafficClass tc ) final override;
+    void getStats( PerfStats &stats ) final override;
+    void getLatencyStats( LatencyReport &report ) final override;
+    IARP *addressResolver() final override;
+    size_t maxTransferSize() const final override;
+    size_t maxUnfragmentedSize() const final override;
+    size_t maxNumFragments() const final override;
+    size_t linkSpeed() const final override;
+    size_t lastActive() const final override;
+
+    /*-------------------------------------------------------------------------------
+    ARP Interface
+    -------------------------------------------------------------------------------*/
+    Chimera::Status_t addARPEntry( const IPAddress &ip, const void *const mac, const size_t size ) final override;
+    Chimera::Status_t dropARPEntry( const IPAddress &ip ) final override;
+    bool arpLookUp( const IPAddress &ip, void *const mac, const size_t size ) final override;
+    IPAddress arpLookUp( const void *const mac, const size_t size ) final override;
+
+    /*-------------------------------------------------------------------------------
+    Bonding Specific Functions
+    -------------------------------------------------------------------------------*/
+    /**
+     *  Gets the link that carries outgoing data
+     *  @return DataLink::DataLink *
+     */
+    DataLink::DataLink *txLink() const;
+
+    /**
+     *  Gets the link that stays listening
+     *  @return DataLink::DataLink *
+     */
+    DataLink::DataLink *rxLink() const;
+
+  private:
+    DataLink::DataLink *mTXLink; /**< Radio dedicated to transmitting */
+    DataLink::DataLink *mRXLink; /**< Radio kept in RX on a separate channel */
+
+    /**
+     *  Passes an event from either link up to whoever registered with the bond
+     *
+     *  @param[in]  id          CallbackId raised by the link
+     *  @return void
+     */
+    void cb_Forward( size_t id );
+  };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Creates a bond over two NRF24 data links. Each link must already have its
+   *  physical configuration assigned, with the RX link on a different channel.
+   *
+   *  @param[in]  context       The current network context
+   *  @param[in]  txLink        Link that carries outgoing data
+   *  @param[in]  rxLink        Link that stays listening
+   *  @return BondedLink *
+   */
+  BondedLink *createNetIf( Context_rPtr context, DataLink::DataLink *const txLink, DataLink::DataLink *const rxLink );
+
+  /**
+   *  Creates a bond over two NRF24 data links in statically placed storage
+   *
+   *  @param[in]  slot          Storage to construct into
+   *  @param[in]  txLink        Link that carries outgoing data
+   *  @param[in]  rxLink        Link that stays listening
+   *  @return BondedLink *      nullptr if the slot was already claimed
+   */
+  BondedLink *createNetIf( StaticSlot<BondedLink> &slot, DataLink::DataLink *const txLink,
+                           DataLink::DataLink *const rxLink );
+
+}    // namespace Ripple::NetIf::NRF24::Bonding
+
+#endif /* !RIPPLE_NETIF_NRF24_BONDING_HPP */
@@ -34,9 +34,10 @@ namespace Ripple::NetIf::NRF24
     /**
      *  Due to the prevalence of counterfeit NRF24L01(+) chips, most of the
      *  cheap radios bought online will not support dynamic payloads, thus
-     *  this network driver really only supports fixed-length payloads instead.
-     *  The setting below controls the on-air frame length for each transmission,
-     *  (in bytes) regardless of the number of actual user data bytes.
+     *  fixed-length payloads are the default. Genuine parts can opt into
+     *  dynamic payloads per pipe through the hwDynamicPayloadPipes config.
+     *  The setting below controls the on-air frame length for each static
+     *  transmission (in bytes), regardless of the number of actual user data bytes.
      *
      *  Be warned that increasing this size will increase RAM allocation across
      *  nearly all of the network stack.
@@ -63,9 +64,19 @@ namespace Ripple::NetIf::NRF24
      *  the processing rate of the higher network layers. If the datalink
      *  queues are not emptied quickly enough, these may need to be larger.
      */
-    static constexpr size_t TX_QUEUE_ELEMENTS = 32;
     static constexpr size_t RX_QUEUE_ELEMENTS = 32;
 
+    /**
+     *  Outgoing frames are queued per traffic class (NetIf::TrafficClass) so a
+     *  large bulk transfer can't sit in front of a control message. Each class
+     *  gets its own depth. The control queue also carries the network service
+     *  messages, so it must fit a channel hop announcement to every known node.
+     */
+    static constexpr size_t TX_QUEUE_CONTROL_ELEMENTS  = 16;
+    static constexpr size_t TX_QUEUE_REALTIME_ELEMENTS = 8;
+    static constexpr size_t TX_QUEUE_BULK_ELEMENTS     = 16;
+    static constexpr size_t TX_QUEUE_ELEMENTS = TX_QUEUE_CONTROL_ELEMENTS + TX_QUEUE_REALTIME_ELEMENTS + TX_QUEUE_BULK_ELEMENTS;
+
     /**
      *  Defines the number of IP<->MAC mapping entries can exist in the
      *  Address Resolution Protocol cache table. If a message is attempted
@@ -77,6 +88,36 @@ namespace Ripple::NetIf::NRF24
      */
     static constexpr size_t ARP_CACHE_TABLE_ELEMENTS = 15;
 
+    /**
+     *  Frames going to a node missing from the ARP cache are parked while the
+     *  address is resolved, instead of being dropped. These set how many frames
+     *  can be parked in total, how many nodes can be resolved at once, and how
+     *  many unreachable nodes are remembered to avoid flooding the channel with
+     *  repeated requests.
+     */
+    static constexpr size_t ARP_PENDING_FRAME_ELEMENTS = 8;
+    static constexpr size_t ARP_PENDING_NODE_ELEMENTS  = 4;
+    static constexpr size_t ARP_NEGATIVE_ELEMENTS      = 4;
+
+    /**
+     *  Number of destinations whose link quality is tracked individually to
+     *  tune the auto-retransmit settings. Destinations beyond this share the
+     *  least recently used entry.
+     */
+    static constexpr size_t LINK_ESTIMATOR_ELEMENTS = 8;
+
+    /**
+     *  Number of destinations that can be reached through a relay. Frames for
+     *  these nodes are forwarded hop by hop on the EP_DATA_FORWARDING endpoint.
+     */
+    static constexpr size_t FORWARD_TABLE_ELEMENTS = 8;
+
+    /**
+     *  Number of neighbors whose liveness is tracked. Every node in the ARP
+     *  cache is a neighbor, so this follows the cache size.
+     */
+    static constexpr size_t PEER_LIVENESS_ELEMENTS = ARP_CACHE_TABLE_ELEMENTS;
+
     /*-------------------------------------------------
     Perform compile time checks on memory allocation
     -------------------------------------------------*/
@@ -84,11 +125,13 @@ namespace Ripple::NetIf::NRF24
     {
       static constexpr size_t _arp_entry_size = sizeof( uint32_t ) + sizeof( uint64_t );
       static constexpr size_t _arp_alloc_size = _arp_entry_size * ARP_CACHE_TABLE_ELEMENTS;
+      static_assert( TX_QUEUE_CONTROL_ELEMENTS >= ARP_CACHE_TABLE_ELEMENTS );
 
       static constexpr size_t _tx_alloc_size = TX_QUEUE_ELEMENTS * Physical::DFLT_STATIC_PAYLOAD_SIZE;
       static constexpr size_t _rx_alloc_size = RX_QUEUE_ELEMENTS * Physical::DFLT_STATIC_PAYLOAD_SIZE;
+      static constexpr size_t _arp_park_size = ARP_PENDING_FRAME_ELEMENTS * Physical::DFLT_STATIC_PAYLOAD_SIZE;
 
-      static constexpr size_t _alloc_size = _arp_alloc_size + _tx_alloc_size + _rx_alloc_size;
+      static constexpr size_t _alloc_size = _arp_alloc_size + _tx_alloc_size + _rx_alloc_size + _arp_park_size;
       static_assert( _alloc_size <= MAX_ALLOCATION_SIZE );
     }    // namespace _Internal
   }      // namespace DataLink
@@ -8,6 +8,9 @@
  *  2020-2021 | Brandon Braun | brandonbraun653@gmail.com
  *******************************************************************************/
 
+/* STL Includes */
+#include <cstring>
+
 /* Ripple Includes */
 #include <Ripple/netif/nrf24l01>
 
@@ -17,7 +20,7 @@ namespace Ripple::NetIf::NRF24::DataLink
   /*-------------------------------------------------------------------------------
   ARPCache Implementation
   -------------------------------------------------------------------------------*/
-  ARPCache::ARPCache()
+  ARPCache::ARPCache() : mGeneration( 0 ), mMemoValid( false ), mMemoIP( 0 ), mMemoMAC( 0 )
   {
 
   }
@@ -32,11 +35,26 @@ namespace Ripple::NetIf::NRF24::DataLink
   void ARPCache::clear()
   {
     mCache.clear();
+    mGeneration++;
+    mMemoValid = false;
   }
 
 
   bool ARPCache::lookup( const IPAddress ip, Physical::MACAddress *addr )
   {
+    /*-------------------------------------------------
+    Repeat lookups of the last node skip the search
+    -------------------------------------------------*/
+    if ( mMemoValid && ( mMemoIP == ip ) )
+    {
+      if ( addr )
+      {
+        *addr = mMemoMAC;
+      }
+
+      return true;
+    }
+
     /*-------------------------------------------------
     Find the registered key. Copy out the MAC if found.
     -------------------------------------------------*/
@@ -46,6 +64,10 @@ namespace Ripple::NetIf::NRF24::DataLink
     {
       tmp = iter->second;
       found = true;
+
+      mMemoValid = true;
+      mMemoIP    = ip;
+      mMemoMAC   = tmp;
     }
 
     /*-------------------------------------------------
@@ -79,6 +101,12 @@ namespace Ripple::NetIf::NRF24::DataLink
     if( auto iter = mCache.find( ip ); iter != mCache.end() )
     {
       mCache.erase( iter );
+      mGeneration++;
+    }
+
+    if ( mMemoIP == ip )
+    {
+      mMemoValid = false;
     }
   }
 
@@ -94,13 +122,257 @@ namespace Ripple::NetIf::NRF24::DataLink
     }
 
     mCache.insert( { ip, addr } );
+    mGeneration++;
     return true;
   }
 
 
+  size_t ARPCache::nodes( IPAddress *const list, const size_t size ) const
+  {
+    if ( !list )
+    {
+      return 0;
+    }
+
+    size_t count = 0;
+    for ( auto iter = mCache.begin(); ( iter != mCache.end() ) && ( count < size ); iter++ )
+    {
+      list[ count++ ] = iter->first;
+    }
+
+    return count;
+  }
+
+
   void ARPCache::onCacheMiss( ARPCallback &func )
   {
     mCacheMissCallback = func;
   }
 
+
+  uint32_t ARPCache::generation() const
+  {
+    return mGeneration;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  ARPPendingTable Implementation
+  -------------------------------------------------------------------------------*/
+  ARPPendingTable::ARPPendingTable()
+  {
+    clear();
+  }
+
+
+  void ARPPendingTable::clear()
+  {
+    mSequence = 0;
+
+    for ( auto &slot : mFrames )
+    {
+      slot.used = false;
+    }
+    memset( mNodes, 0, sizeof( mNodes ) );
+    memset( mUnreachable, 0, sizeof( mUnreachable ) );
+  }
+
+
+  bool ARPPendingTable::park( const Frame &frame, const TrafficClass tc )
+  {
+    /*-------------------------------------------------
+    Find the node entry, creating one if needed. A new
+    node has its first request due right away.
+    -------------------------------------------------*/
+    PendingNode *entry = nullptr;
+    PendingNode *spare = nullptr;
+    for ( auto &node : mNodes )
+    {
+      if ( node.used && ( node.ip == frame.nextHop ) )
+      {
+        entry = &node;
+        break;
+      }
+      else if ( !node.used && !spare )
+      {
+        spare = &node;
+      }
+    }
+
+    ParkedFrame *slot = nullptr;
+    for ( auto &candidate : mFrames )
+    {
+      if ( !candidate.used )
+      {
+        slot = &candidate;
+        break;
+      }
+    }
+
+    if ( !slot || ( !entry && !spare ) )
+    {
+      return false;
+    }
+
+    if ( !entry )
+    {
+      entry              = spare;
+      entry->used        = true;
+      entry->ip          = frame.nextHop;
+      entry->lastRequest = 0;
+      entry->attempts    = 0;
+    }
+
+    /*-------------------------------------------------
+    Park the frame
+    -------------------------------------------------*/
+    slot->used     = true;
+    slot->sequence = mSequence++;
+    slot->tc       = tc;
+    slot->frame    = frame;
+
+    return true;
+  }
+
+
+  ParkedFrame *ARPPendingTable::oldest( const IPAddress ip )
+  {
+    /*-------------------------------------------------
+    Sequence numbers only grow, so the smallest age is
+    found relative to the next one to be handed out.
+    -------------------------------------------------*/
+    ParkedFrame *result = nullptr;
+    for ( auto &slot : mFrames )
+    {
+      if ( slot.used && ( slot.frame.nextHop == ip ) &&
+           ( !result || ( ( mSequence - slot.sequence ) > ( mSequence - result->sequence ) ) ) )
+      {
+        result = &slot;
+      }
+    }
+
+    return result;
+  }
+
+
+  void ARPPendingTable::release( ParkedFrame *const slot )
+  {
+    if ( slot )
+    {
+      slot->used = false;
+    }
+  }
+
+
+  PendingNode *ARPPendingTable::node( const size_t idx )
+  {
+    if ( ( idx < ARRAY_COUNT( mNodes ) ) && mNodes[ idx ].used )
+    {
+      return &mNodes[ idx ];
+    }
+
+    return nullptr;
+  }
+
+
+  size_t ARPPendingTable::forget( const IPAddress ip )
+  {
+    for ( auto &node : mNodes )
+    {
+      if ( node.used && ( node.ip == ip ) )
+      {
+        node.used = false;
+      }
+    }
+
+    size_t dropped = 0;
+    for ( auto &slot : mFrames )
+    {
+      if ( slot.used && ( slot.frame.nextHop == ip ) )
+      {
+        slot.used = false;
+        dropped++;
+      }
+    }
+
+    return dropped;
+  }
+
+
+  void ARPPendingTable::markUnreachable( const IPAddress ip, const size_t now )
+  {
+    /*-------------------------------------------------
+    Reuse the node's entry, a free one, or else the one
+    that has been around the longest.
+    -------------------------------------------------*/
+    UnreachableNode *entry = &mUnreachable[ 0 ];
+    for ( auto &candidate : mUnreachable )
+    {
+      if ( candidate.used && ( candidate.ip == ip ) )
+      {
+        entry = &candidate;
+        break;
+      }
+      else if ( !candidate.used )
+      {
+        entry = &candidate;
+      }
+      else if ( entry->used && ( ( now - candidate.start ) > ( now - entry->start ) ) )
+      {
+        entry = &candidate;
+      }
+    }
+
+    entry->used  = true;
+    entry->ip    = ip;
+    entry->start = now;
+  }
+
+
+  bool ARPPendingTable::unreachable( const IPAddress ip, const size_t now, const size_t timeout )
+  {
+    for ( auto &entry : mUnreachable )
+    {
+      if ( !entry.used || ( entry.ip != ip ) )
+      {
+        continue;
+      }
+
+      if ( ( now - entry.start ) < timeout )
+      {
+        return true;
+      }
+
+      entry.used = false;
+    }
+
+    return false;
+  }
+
+
+  void ARPPendingTable::markReachable( const IPAddress ip )
+  {
+    for ( auto &entry : mUnreachable )
+    {
+      if ( entry.used && ( entry.ip == ip ) )
+      {
+        entry.used = false;
+      }
+    }
+  }
+
+
+  bool ARPPendingTable::active() const
+  {
+    for ( const auto &node : mNodes )
+    {
+      if ( node.used )
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
 }  // namespace Ripple::DataLink
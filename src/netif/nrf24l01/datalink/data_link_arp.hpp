@@ -22,7 +22,9 @@
 
 /* Ripple Includes */
 #include <Ripple/src/shared/cmn_types.hpp>
+#include <Ripple/src/netif/device_types.hpp>
 #include <Ripple/src/netif/nrf24l01/cmn_memory_config.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_frame.hpp>
 #include <Ripple/src/netif/nrf24l01/physical/phy_device_types.hpp>
 
 namespace Ripple::NetIf::NRF24::DataLink
@@ -34,6 +36,42 @@ namespace Ripple::NetIf::NRF24::DataLink
   using ARPCallback = etl::delegate<void( const IPAddress )>;
 
 
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  A frame waiting on its destination address to be resolved
+   */
+  struct ParkedFrame
+  {
+    bool used;         /**< Slot holds a frame */
+    uint32_t sequence; /**< Order the frame was parked in */
+    TrafficClass tc;   /**< TX queue the frame goes back to */
+    Frame frame;       /**< The parked frame */
+  };
+
+  /**
+   *  A node whose address is being resolved
+   */
+  struct PendingNode
+  {
+    bool used;          /**< Entry is active */
+    IPAddress ip;       /**< Node being resolved */
+    size_t lastRequest; /**< Last time a request went out (ms) */
+    size_t attempts;    /**< Requests sent so far */
+  };
+
+  /**
+   *  A node that recently failed to resolve
+   */
+  struct UnreachableNode
+  {
+    bool used;    /**< Entry is active */
+    IPAddress ip; /**< Node that failed to resolve */
+    size_t start; /**< Time the resolution failed (ms) */
+  };
+
+
   /*-------------------------------------------------------------------------------
   Classes
   -------------------------------------------------------------------------------*/
@@ -81,6 +119,15 @@ namespace Ripple::NetIf::NRF24::DataLink
      */
     bool insert( const IPAddress ip, const Physical::MACAddress &addr );
 
+    /**
+     *  Copies out the IP addresses of every node in the cache
+     *
+     *  @param[out] list      Buffer to fill with addresses
+     *  @param[in]  size      Max number of addresses the buffer holds
+     *  @return size_t        Number of addresses written
+     */
+    size_t nodes( IPAddress *const list, const size_t size ) const;
+
     /**
      *  Register a callback to execute when a lookup fails
      *
@@ -89,9 +136,125 @@ namespace Ripple::NetIf::NRF24::DataLink
      */
     void onCacheMiss( ARPCallback &func );
 
+    /**
+     *  Gets a counter that changes every time the cache contents change. Lets
+     *  a user holding on to a looked up address tell if it may be stale.
+     *
+     *  @return uint32_t
+     */
+    uint32_t generation() const;
+
   private:
+    uint32_t mGeneration;
     ARPCallback mCacheMissCallback;
     etl::flat_map<IPAddress, Physical::MACAddress, ARP_CACHE_TABLE_ELEMENTS> mCache;
+
+    /*-------------------------------------------------
+    Memo of the last successful lookup. Traffic tends
+    to go to the same node in bursts.
+    -------------------------------------------------*/
+    bool mMemoValid;
+    IPAddress mMemoIP;
+    Physical::MACAddress mMemoMAC;
+  };
+
+
+  /**
+   *  Holds on to frames whose destination is not yet in the ARP cache while
+   *  their addresses are resolved. Also remembers nodes that recently failed
+   *  to resolve, so repeated misses don't flood the channel with requests.
+   *  Not thread safe, it's meant to be owned by the DataLink thread.
+   */
+  class ARPPendingTable
+  {
+  public:
+    ARPPendingTable();
+
+    /**
+     *  Drops every parked frame and forgets all nodes
+     *  @return void
+     */
+    void clear();
+
+    /**
+     *  Parks a frame until its next hop is resolved
+     *
+     *  @param[in]  frame       Frame to park
+     *  @param[in]  tc          TX queue the frame came from
+     *  @return bool            False if there was no room to park it
+     */
+    bool park( const Frame &frame, const TrafficClass tc );
+
+    /**
+     *  Gets the oldest frame parked for a node
+     *
+     *  @param[in]  ip          Node to look for
+     *  @return ParkedFrame *   nullptr if none are parked
+     */
+    ParkedFrame *oldest( const IPAddress ip );
+
+    /**
+     *  Releases a parked frame slot
+     *
+     *  @param[in]  slot        Slot returned by oldest()
+     *  @return void
+     */
+    void release( ParkedFrame *const slot );
+
+    /**
+     *  Gets a node currently being resolved
+     *
+     *  @param[in]  idx         Table index, up to ARP_PENDING_NODE_ELEMENTS
+     *  @return PendingNode *   nullptr if the entry is not in use
+     */
+    PendingNode *node( const size_t idx );
+
+    /**
+     *  Stops resolving a node. Frames still parked for it are dropped.
+     *
+     *  @param[in]  ip          Node to forget
+     *  @return size_t          Number of frames dropped
+     */
+    size_t forget( const IPAddress ip );
+
+    /**
+     *  Remembers a node as unreachable for a while
+     *
+     *  @param[in]  ip          Node that failed to resolve
+     *  @param[in]  now         Current time (ms)
+     *  @return void
+     */
+    void markUnreachable( const IPAddress ip, const size_t now );
+
+    /**
+     *  Checks if a node recently failed to resolve
+     *
+     *  @param[in]  ip          Node to check
+     *  @param[in]  now         Current time (ms)
+     *  @param[in]  timeout     How long a failure is remembered (ms)
+     *  @return bool
+     */
+    bool unreachable( const IPAddress ip, const size_t now, const size_t timeout );
+
+    /**
+     *  Clears a node from the unreachable list, such as when it shows up
+     *
+     *  @param[in]  ip          Node to clear
+     *  @return void
+     */
+    void markReachable( const IPAddress ip );
+
+    /**
+     *  Checks if any node is being resolved
+     *  @return bool
+     */
+    bool active() const;
+
+  private:
+    uint32_t mSequence;
+    ParkedFrame mFrames[ ARP_PENDING_FRAME_ELEMENTS ];
+    PendingNode mNodes[ ARP_PENDING_NODE_ELEMENTS ];
+    UnreachableNode mUnreachable[ ARP_NEGATIVE_ELEMENTS ];
   };
 
 }  // namespace Ripple::DataLink::ARP
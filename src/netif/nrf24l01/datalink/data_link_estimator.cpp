@@ -0,0 +1,201 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_estimator.cpp
+ *
+ *  Description:
+ *    Link quality estimator implementation details
+ *
+ *  2020-2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <algorithm>
+
+/* Ripple Includes */
+#include <Ripple/netif/nrf24l01>
+
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr uint16_t EMA_SHIFT       = 3;     /**< Smoothing factor of 1/8 */
+  static constexpr uint16_t Q4_SHIFT        = 4;     /**< Fractional bits of the retry average */
+  static constexpr uint16_t RECOVERY_STREAK = 32;    /**< Clean sends before relaxing a step */
+  static constexpr size_t MAX_TX_RATE_US    = 10000; /**< Ceiling of the rate limit backoff */
+
+
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  static inline Physical::AutoRetransmitDelay stepDelay( const Physical::AutoRetransmitDelay delay, const int step )
+  {
+    int next = static_cast<int>( delay ) + step;
+    next     = std::clamp<int>( next, Physical::ART_DELAY_MIN, Physical::ART_DELAY_MAX );
+    return static_cast<Physical::AutoRetransmitDelay>( next );
+  }
+
+
+  static inline Physical::AutoRetransmitCount stepCount( const Physical::AutoRetransmitCount count, const int step )
+  {
+    int next = static_cast<int>( count ) + step;
+    next     = std::clamp<int>( next, Physical::ART_COUNT_1, Physical::ART_COUNT_15 );
+    return static_cast<Physical::AutoRetransmitCount>( next );
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  LinkEstimator Implementation
+  -------------------------------------------------------------------------------*/
+  LinkEstimator::LinkEstimator() : mAge( 0 )
+  {
+    reset( Physical::ART_DELAY_MED, Physical::ART_COUNT_3, 0 );
+  }
+
+
+  LinkEstimator::~LinkEstimator()
+  {
+  }
+
+
+  void LinkEstimator::reset( const Physical::AutoRetransmitDelay delay, const Physical::AutoRetransmitCount count,
+                             const size_t rate_us )
+  {
+    mTable.clear();
+    mAge = 0;
+
+    mBaseline.rtxDelay      = delay;
+    mBaseline.rtxCount      = count;
+    mBaseline.txRate_us     = rate_us;
+    mBaseline.avgRetries_q4 = 0;
+    mBaseline.successStreak = 0;
+    mBaseline.lastUsed      = 0;
+  }
+
+
+  void LinkEstimator::clear()
+  {
+    mTable.clear();
+    mAge = 0;
+  }
+
+
+  LinkEstimate LinkEstimator::lookup( const IPAddress node ) const
+  {
+    if ( auto iter = mTable.find( node ); iter != mTable.end() )
+    {
+      return iter->second;
+    }
+
+    return mBaseline;
+  }
+
+
+  void LinkEstimator::onSuccess( const IPAddress node, const uint8_t retries )
+  {
+    LinkEstimate &est = acquire( node );
+
+    /*-------------------------------------------------
+    Fold the new sample into the smoothed average
+    -------------------------------------------------*/
+    const int sample_q4 = static_cast<int>( retries ) << Q4_SHIFT;
+    const int avg_q4    = static_cast<int>( est.avgRetries_q4 );
+    est.avgRetries_q4   = static_cast<uint16_t>( avg_q4 + ( ( sample_q4 - avg_q4 ) >> EMA_SHIFT ) );
+
+    /*-------------------------------------------------
+    Frames needing more than half the retry budget mean
+    the receiver is busy or the channel is noisy. Give
+    the retries more room to space out.
+    -------------------------------------------------*/
+    const uint16_t limit_q4 = static_cast<uint16_t>( est.rtxCount ) << ( Q4_SHIFT - 1 );
+    if ( est.avgRetries_q4 > limit_q4 )
+    {
+      est.rtxDelay      = stepDelay( est.rtxDelay, 1 );
+      est.successStreak = 0;
+      return;
+    }
+
+    if ( retries != 0 )
+    {
+      est.successStreak = 0;
+      return;
+    }
+
+    /*-------------------------------------------------
+    A long run of first-try deliveries: walk a step back
+    toward the baseline, never beneath it.
+    -------------------------------------------------*/
+    if ( ++est.successStreak < RECOVERY_STREAK )
+    {
+      return;
+    }
+
+    est.successStreak = 0;
+    if ( est.rtxDelay > mBaseline.rtxDelay )
+    {
+      est.rtxDelay = stepDelay( est.rtxDelay, -1 );
+    }
+
+    if ( est.rtxCount > mBaseline.rtxCount )
+    {
+      est.rtxCount = stepCount( est.rtxCount, -1 );
+    }
+
+    est.txRate_us = std::max( mBaseline.txRate_us, ( est.txRate_us * 7u ) / 8u );
+  }
+
+
+  void LinkEstimator::onFailure( const IPAddress node )
+  {
+    LinkEstimate &est = acquire( node );
+
+    /*-------------------------------------------------
+    The whole retry budget was spent without an ACK.
+    Back off on every knob at once.
+    -------------------------------------------------*/
+    est.successStreak = 0;
+    est.avgRetries_q4 = static_cast<uint16_t>( est.rtxCount ) << Q4_SHIFT;
+    est.rtxDelay      = stepDelay( est.rtxDelay, 1 );
+    est.rtxCount      = stepCount( est.rtxCount, 1 );
+    est.txRate_us     = std::min( MAX_TX_RATE_US, std::max<size_t>( est.txRate_us * 2u, 1u ) );
+  }
+
+
+  LinkEstimate &LinkEstimator::acquire( const IPAddress node )
+  {
+    mAge++;
+
+    /*-------------------------------------------------
+    Existing entry? Just refresh its age.
+    -------------------------------------------------*/
+    if ( auto iter = mTable.find( node ); iter != mTable.end() )
+    {
+      iter->second.lastUsed = mAge;
+      return iter->second;
+    }
+
+    /*-------------------------------------------------
+    Make room by dropping the least recently used entry
+    -------------------------------------------------*/
+    if ( mTable.full() )
+    {
+      auto oldest = mTable.begin();
+      for ( auto iter = mTable.begin(); iter != mTable.end(); iter++ )
+      {
+        if ( iter->second.lastUsed < oldest->second.lastUsed )
+        {
+          oldest = iter;
+        }
+      }
+
+      mTable.erase( oldest );
+    }
+
+    LinkEstimate est = mBaseline;
+    est.lastUsed     = mAge;
+
+    return mTable.insert( { node, est } ).first->second;
+  }
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
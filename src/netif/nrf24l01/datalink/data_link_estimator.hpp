@@ -0,0 +1,120 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_estimator.hpp
+ *
+ *  Description:
+ *    Per-destination link quality estimation used to tune retransmit behavior
+ *
+ *  2020-2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_DataLink_Estimator_HPP
+#define RIPPLE_DataLink_Estimator_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+/* ETL Includes */
+#include <etl/flat_map.h>
+
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_types.hpp>
+#include <Ripple/src/netif/nrf24l01/cmn_memory_config.hpp>
+#include <Ripple/src/netif/nrf24l01/physical/phy_device_types.hpp>
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Transmit settings currently believed to suit a single destination
+   */
+  struct LinkEstimate
+  {
+    Physical::AutoRetransmitDelay rtxDelay; /**< Hardware delay between retransmissions */
+    Physical::AutoRetransmitCount rtxCount; /**< Hardware retransmission limit */
+    size_t txRate_us;                       /**< Minimum spacing between new transfers */
+    uint16_t avgRetries_q4;                 /**< Smoothed ARC_CNT, 4 fractional bits */
+    uint16_t successStreak;                 /**< Consecutive first-try deliveries */
+    uint32_t lastUsed;                      /**< Age counter for eviction */
+  };
+
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Tracks how hard each destination is to reach and adapts the hardware
+   *  auto-retransmit delay/count and the software TX rate limit to match.
+   *  Busy links back off quickly, then creep back toward the configured
+   *  baseline once deliveries succeed without retries again.
+   *
+   *  The class is not thread safe, so additional protection is required if
+   *  access is to be performed from multiple threads.
+   */
+  class LinkEstimator
+  {
+  public:
+    LinkEstimator();
+    ~LinkEstimator();
+
+    /**
+     *  Drops all per-destination history and sets the baseline that new
+     *  destinations start from and recovered links decay back toward.
+     *
+     *  @param[in]  delay       Baseline hardware retransmit delay
+     *  @param[in]  count       Baseline hardware retransmit count
+     *  @param[in]  rate_us     Baseline TX rate limit in microseconds
+     *  @return void
+     */
+    void reset( const Physical::AutoRetransmitDelay delay, const Physical::AutoRetransmitCount count,
+                const size_t rate_us );
+
+    /**
+     *  Drops all per-destination history, keeping the current baseline. Use
+     *  when the link conditions change wholesale, like after a channel move.
+     *
+     *  @return void
+     */
+    void clear();
+
+    /**
+     *  Gets the current estimate for a destination. Unknown destinations
+     *  report the baseline without allocating an entry.
+     *
+     *  @param[in]  node        Destination to look up
+     *  @return LinkEstimate
+     */
+    LinkEstimate lookup( const IPAddress node ) const;
+
+    /**
+     *  Records a delivered frame
+     *
+     *  @param[in]  node        Destination the frame was sent to
+     *  @param[in]  retries     Retransmissions the hardware needed (ARC_CNT)
+     *  @return void
+     */
+    void onSuccess( const IPAddress node, const uint8_t retries );
+
+    /**
+     *  Records a frame that exhausted its retries or timed out
+     *
+     *  @param[in]  node        Destination the frame was sent to
+     *  @return void
+     */
+    void onFailure( const IPAddress node );
+
+  private:
+    uint32_t mAge;
+    LinkEstimate mBaseline;
+    etl::flat_map<IPAddress, LinkEstimate, LINK_ESTIMATOR_ELEMENTS> mTable;
+
+    LinkEstimate &acquire( const IPAddress node );
+  };
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
+
+#endif  /* !RIPPLE_DataLink_Estimator_HPP */
@@ -8,6 +8,11 @@
  *  2021 | Brandon Braun | brandonbraun653@gmail.com
  *******************************************************************************/
 
+/* STL Includes */
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
 /* Chimera Includes */
 #include <Chimera/utility>
 
@@ -16,12 +21,39 @@
 
 namespace Ripple::NetIf::NRF24::DataLink
 {
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Gets the most user data a frame with the full header can carry
+   *
+   *  @param[in]  control     Control field of the frame
+   *  @return size_t
+   */
+  static size_t fullPayloadLimit( const _pfCtrl &control )
+  {
+    return ( control.endpoint == Endpoint::EP_DATA_FORWARDING ) ? FORWARD_FRAME_PAYLOAD : FULL_FRAME_PAYLOAD;
+  }
+
+
+  /**
+   *  Gets the most user data a frame with the extended header can carry
+   *
+   *  @param[in]  control     Control field of the frame
+   *  @return size_t
+   */
+  static size_t extendedPayloadLimit( const _pfCtrl &control )
+  {
+    return ( control.endpoint == Endpoint::EP_DATA_FORWARDING ) ? EXT_FORWARD_PAYLOAD : EXTENDED_FRAME_PAYLOAD;
+  }
+
   /*-------------------------------------------------------------------------------
   Classes
   -------------------------------------------------------------------------------*/
   Frame::Frame() :
       txAttempts( 0 ), nextHop( 0 ), receivedPipe( Physical::PipeNumber::PIPE_INVALID ),
-      rtxCount( Physical::AutoRetransmitCount::ART_COUNT_INVALID ), rtxDelay( Physical::AutoRetransmitDelay::ART_DELAY_UNKNOWN )
+      rtxCount( Physical::AutoRetransmitCount::ART_COUNT_INVALID ),
+      rtxDelay( Physical::AutoRetransmitDelay::ART_DELAY_UNKNOWN ), queuedTime_us( 0 )
   {
     /*-------------------------------------------------
     Reset the packed data fields to defaults
@@ -36,7 +68,7 @@ namespace Ripple::NetIf::NRF24::DataLink
 
   Frame::Frame( const Frame &other ) :
       txAttempts( other.txAttempts ), nextHop( other.nextHop ), receivedPipe( other.receivedPipe ), rtxCount( other.rtxCount ),
-      rtxDelay( other.rtxDelay )
+      rtxDelay( other.rtxDelay ), queuedTime_us( other.queuedTime_us )
   {
     memcpy( &wireData, &other.wireData, sizeof( PackedFrame ) );
   }
@@ -44,7 +76,7 @@ namespace Ripple::NetIf::NRF24::DataLink
 
   Frame::Frame( const Frame &&other ) :
       txAttempts( other.txAttempts ), nextHop( other.nextHop ), receivedPipe( other.receivedPipe ), rtxCount( other.rtxCount ),
-      rtxDelay( other.rtxDelay )
+      rtxDelay( other.rtxDelay ), queuedTime_us( other.queuedTime_us )
   {
     memcpy( &wireData, &other.wireData, sizeof( PackedFrame ) );
   }
@@ -54,17 +86,29 @@ namespace Ripple::NetIf::NRF24::DataLink
   {
     /*-------------------------------------------------
     This was required for integration with the
-    FrameQueue ETL structure.
+    FrameRing slot storage.
     -------------------------------------------------*/
-    txAttempts   = other.txAttempts;
-    nextHop      = other.nextHop;
-    receivedPipe = other.receivedPipe;
-    rtxCount     = other.rtxCount;
-    rtxDelay     = other.rtxDelay;
+    txAttempts    = other.txAttempts;
+    nextHop       = other.nextHop;
+    receivedPipe  = other.receivedPipe;
+    rtxCount      = other.rtxCount;
+    rtxDelay      = other.rtxDelay;
+    queuedTime_us = other.queuedTime_us;
     memcpy( &wireData, &other.wireData, sizeof( PackedFrame ) );
   }
 
 
+  void Frame::clear()
+  {
+    txAttempts    = 0;
+    nextHop       = 0;
+    receivedPipe  = Physical::PipeNumber::PIPE_INVALID;
+    rtxCount      = Physical::AutoRetransmitCount::ART_COUNT_INVALID;
+    rtxDelay      = Physical::AutoRetransmitDelay::ART_DELAY_UNKNOWN;
+    queuedTime_us = 0;
+  }
+
+
   size_t Frame::writeUserData( const void *const data, const size_t size )
   {
     /*-------------------------------------------------
@@ -106,22 +150,198 @@ namespace Ripple::NetIf::NRF24::DataLink
   }
 
 
-  void Frame::pack( FrameBuffer &buffer )
+  void Frame::setFrameNumber( const uint16_t number )
+  {
+    wireData.control.frameNumber = static_cast<uint8_t>( number & FRAME_NUMBER_MASK );
+    wireData.ext.frameNumberHi   = static_cast<uint8_t>( number >> FRAME_NUMBER_BITS );
+  }
+
+
+  uint16_t Frame::frameNumber() const
+  {
+    return static_cast<uint16_t>( ( wireData.ext.frameNumberHi << FRAME_NUMBER_BITS ) | wireData.control.frameNumber );
+  }
+
+
+  size_t Frame::pack( FrameBuffer &buffer )
+  {
+    static_assert( sizeof( FrameBuffer ) == Physical::MAX_SPI_DATA_LEN );
+
+    /*-------------------------------------------------
+    Frames holding a whole packet only need the bits
+    that can't be implied
+    -------------------------------------------------*/
+    if ( isCompact() )
+    {
+      const size_t length = std::min<size_t>( wireData.control.dataLength, COMPACT_FRAME_PAYLOAD );
+
+      _pfCompactCtrl compact;
+      compact.version    = CTRL_COMPACT_VERSION;
+      compact.dataLength = length;
+      compact.endpoint   = wireData.control.endpoint;
+      compact.shortId    = wireData.control.uuid;
+
+      memcpy( buffer.data(), &compact, sizeof( compact ) );
+      memcpy( buffer.data() + sizeof( compact ), wireData.userData, length );
+      return sizeof( compact ) + length;
+    }
+
+    /*-------------------------------------------------
+    The extended fields go between the control field
+    and the user data
+    -------------------------------------------------*/
+    if ( isExtended() )
+    {
+      const size_t length = std::min<size_t>( wireData.control.dataLength, extendedPayloadLimit( wireData.control ) );
+
+      _pfCtrl control = wireData.control;
+      control.version = CTRL_EXTENDED_VERSION;
+
+      memcpy( buffer.data(), &control, sizeof( control ) );
+      memcpy( buffer.data() + sizeof( control ), &wireData.ext, sizeof( wireData.ext ) );
+      memcpy( buffer.data() + EXT_HEADER_SIZE, wireData.userData, length );
+      return EXT_HEADER_SIZE + length;
+    }
+
+    /*-------------------------------------------------
+    Otherwise the host form is already the wire layout
+    -------------------------------------------------*/
+    const size_t length = std::min<size_t>( wireData.control.dataLength, fullPayloadLimit( wireData.control ) );
+    memcpy( buffer.data(), &wireData, sizeof( _pfCtrl ) + length );
+    return sizeof( _pfCtrl ) + length;
+  }
+
+
+  bool Frame::unpack( const void *const data, const size_t size )
+  {
+    /*-------------------------------------------------
+    Input Protection. The version bits sit in the same
+    place in either header.
+    -------------------------------------------------*/
+    if ( !data || ( size < sizeof( _pfCompactCtrl ) ) )
+    {
+      return false;
+    }
+
+    _pfCompactCtrl compact;
+    memcpy( &compact, data, sizeof( compact ) );
+
+    /*-------------------------------------------------
+    Expand the compact header. The payload is moved up
+    behind the full control field, which also works in
+    place as the host form is the larger of the two.
+    The short id lands in the reserved UUID range, so
+    it can't be mistaken for a full one.
+    -------------------------------------------------*/
+    if ( compact.version == CTRL_COMPACT_VERSION )
+    {
+      const size_t length = std::min<size_t>( { compact.dataLength, size - sizeof( compact ), COMPACT_FRAME_PAYLOAD } );
+      memmove( wireData.userData, reinterpret_cast<const uint8_t *>( data ) + sizeof( compact ), length );
+
+      memset( &wireData.control, 0, sizeof( wireData.control ) );
+      memset( &wireData.ext, 0, sizeof( wireData.ext ) );
+      wireData.control.version     = CTRL_STRUCTURE_VERSION;
+      wireData.control.dataLength  = length;
+      wireData.control.frameNumber = 0;
+      wireData.control.endpoint    = compact.endpoint;
+      wireData.control.uuid        = compact.shortId;
+      wireData.control.totalFrames = 1;
+      wireData.control.requireACK  = true;
+      return true;
+    }
+
+    /*-------------------------------------------------
+    Expand the extended header. The host form keeps its
+    fields past the end of anything read in place, so
+    only the user data has to move.
+    -------------------------------------------------*/
+    static_assert( offsetof( PackedFrame, ext ) >= Physical::MAX_SPI_DATA_LEN );
+
+    if ( compact.version == CTRL_EXTENDED_VERSION )
+    {
+      if ( size < EXT_HEADER_SIZE )
+      {
+        return false;
+      }
+
+      _pfCtrl control;
+      _pfExtCtrl ext;
+      memcpy( &control, data, sizeof( control ) );
+      memcpy( &ext, reinterpret_cast<const uint8_t *>( data ) + sizeof( control ), sizeof( ext ) );
+
+      const size_t length =
+          std::min<size_t>( { control.dataLength, size - EXT_HEADER_SIZE, extendedPayloadLimit( control ) } );
+      memmove( wireData.userData, reinterpret_cast<const uint8_t *>( data ) + EXT_HEADER_SIZE, length );
+
+      wireData.control            = control;
+      wireData.control.version    = CTRL_STRUCTURE_VERSION;
+      wireData.control.dataLength = length;
+      wireData.ext                = ext;
+      return true;
+    }
+
+    /*-------------------------------------------------
+    Full header, which is never trusted for a length
+    beyond what actually arrived
+    -------------------------------------------------*/
+    if ( ( compact.version != CTRL_STRUCTURE_VERSION ) || ( size < sizeof( _pfCtrl ) ) )
+    {
+      return false;
+    }
+
+    memset( &wireData.ext, 0, sizeof( wireData.ext ) );
+
+    if ( data != &wireData )
+    {
+      memcpy( &wireData, data, std::min( size, sizeof( _pfCtrl ) + FORWARD_FRAME_PAYLOAD ) );
+    }
+
+    const size_t maxData = std::min( size - sizeof( _pfCtrl ), fullPayloadLimit( wireData.control ) );
+    if ( wireData.control.dataLength > maxData )
+    {
+      wireData.control.dataLength = maxData;
+    }
+
+    return true;
+  }
+
+
+  bool Frame::isCompact() const
   {
-    memcpy( buffer.data(), &wireData, sizeof( PackedFrame ) );
-    static_assert( sizeof( FrameBuffer ) == sizeof( PackedFrame ) );
+    /*-------------------------------------------------
+    Multicast keeps the full header, as receivers need
+    the flag to weed out repeated copies. Forwarding
+    needs its hop limit.
+    -------------------------------------------------*/
+    return ( wireData.control.totalFrames <= 1 ) && ( wireData.control.frameNumber == 0 ) &&
+           !wireData.control.multicast && ( wireData.control.endpoint != Endpoint::EP_DATA_FORWARDING );
   }
 
 
-  void Frame::unpack( const FrameBuffer &buffer )
+  bool Frame::isExtended() const
   {
-    memcpy( &wireData, buffer.data(), sizeof( PackedFrame ) );
+    /*-------------------------------------------------
+    Whoever built the frame decides. Anything that came
+    in with the extended header keeps it when relayed,
+    whatever this node sends itself.
+    -------------------------------------------------*/
+    return !isCompact() && wireData.ext.present;
   }
 
 
   size_t Frame::size()
   {
-    return sizeof( PackedFrame );
+    if ( isCompact() )
+    {
+      return sizeof( _pfCompactCtrl ) + std::min<size_t>( wireData.control.dataLength, COMPACT_FRAME_PAYLOAD );
+    }
+
+    if ( isExtended() )
+    {
+      return EXT_HEADER_SIZE + std::min<size_t>( wireData.control.dataLength, extendedPayloadLimit( wireData.control ) );
+    }
+
+    return sizeof( _pfCtrl ) + std::min<size_t>( wireData.control.dataLength, fullPayloadLimit( wireData.control ) );
   }
 
 }    // namespace Ripple::NetIf::NRF24::DataLink
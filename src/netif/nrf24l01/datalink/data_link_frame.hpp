@@ -12,10 +12,27 @@
 #ifndef RIPPLE_NET_INTERFACE_NRF24L01_FRAME_HPP
 #define RIPPLE_NET_INTERFACE_NRF24L01_FRAME_HPP
 
+/* STL Includes */
+#include <limits>
+
 /* Ripple Includes */
 #include <Ripple/src/netif/nrf24l01/datalink/data_link_types.hpp>
 #include <Ripple/src/netif/nrf24l01/physical/phy_device_constants.hpp>
 #include <Ripple/src/netif/nrf24l01/physical/phy_device_types.hpp>
+#include <Ripple/src/netstack/packets/fragment.hpp>
+
+/*-------------------------------------------------------------------------------
+Configuration
+-------------------------------------------------------------------------------*/
+/**
+ *  Sends packet data with the extended header, which widens the frame number
+ *  and names the sending node so receivers can keep concurrent senders apart.
+ *  Costs two bytes of user data per frame. Extended frames are always accepted
+ *  on receive, this only picks what goes out.
+ */
+#if !defined( NRF_LINK_EXTENDED_HEADER )
+#define NRF_LINK_EXTENDED_HEADER ( 0 )
+#endif
 
 namespace Ripple::NetIf::NRF24::DataLink
 {
@@ -41,7 +58,7 @@ namespace Ripple::NetIf::NRF24::DataLink
    *  other side.
    *
    *  The max supported packet size is equal to:
-   *    sMax = 2^FRAME_NUMBER_BITS * sizeof( PackedFrame::userData )
+   *    sMax = 2^FRAME_NUMBER_BITS * FULL_FRAME_PAYLOAD
    */
   static constexpr size_t FRAME_NUMBER_BITS = 5;
 
@@ -52,12 +69,50 @@ namespace Ripple::NetIf::NRF24::DataLink
   static constexpr size_t ENDPOINT_BITS = 3;
   static_assert( Endpoint::EP_NUM_OPTIONS < 7 );
 
+  /**
+   *  Sets the number of bits used to represent how many of a packet's frames
+   *  are FEC parity rather than data
+   */
+  static constexpr size_t PARITY_BITS = 3;
+
+  /**
+   *  Sets the number of bits used to limit how many more relays a forwarded
+   *  frame may pass through, which stops routing loops from living forever
+   */
+  static constexpr size_t HOP_LIMIT_BITS    = 3;
+  static constexpr uint8_t FORWARD_HOP_LIMIT = ( 1u << HOP_LIMIT_BITS ) - 1u;
+
   /**
    *  Current control structure version
    */
   static constexpr size_t VERSION_LENGTH_BITS    = 3;
   static constexpr size_t CTRL_STRUCTURE_VERSION = 0;
 
+  /**
+   *  Control structure version of the compact header, used on the wire for
+   *  packets that fit in a single frame
+   */
+  static constexpr size_t CTRL_COMPACT_VERSION = 1;
+
+  /**
+   *  Sets the number of bits in the compact header's packet id. It only has
+   *  to tell apart packets that are back to back on the air.
+   */
+  static constexpr size_t SHORT_ID_BITS = 5;
+
+  /**
+   *  Control structure version of the extended header, used on the wire for
+   *  packet data when NRF_LINK_EXTENDED_HEADER is set
+   */
+  static constexpr size_t CTRL_EXTENDED_VERSION = 2;
+
+  /**
+   *  Sets the number of frame number bits the extended header adds on top of
+   *  the full header's
+   */
+  static constexpr size_t EXT_FRAME_NUMBER_BITS = 3;
+  static constexpr size_t FRAME_NUMBER_MASK     = ( 1u << FRAME_NUMBER_BITS ) - 1u;
+
   /*-------------------------------------------------------------------------------
   Structures
   -------------------------------------------------------------------------------*/
@@ -74,20 +129,80 @@ namespace Ripple::NetIf::NRF24::DataLink
     uint8_t   totalFrames;                          /**< Total number of frames in the packet */
     bool      multicast     : 1;                    /**< Should this be blasted across the network to everyone? */
     bool      requireACK    : 1;                    /**< Payload should require an ACK */
-    bool      _pad0         : 6;                    /**< Pad for alignment */
+    uint8_t   parityFrames  : PARITY_BITS;          /**< FEC parity frames at the end of the packet */
+    uint8_t   hopLimit      : HOP_LIMIT_BITS;       /**< Relays a forwarded frame may still pass through */
   }; /* clang-format on */
   static_assert( sizeof( _pfCtrl ) == sizeof( uint8_t[ 6 ] ) );
+  static_assert( FRAG_MAX_PARITY < ( 1u << PARITY_BITS ) );
+  static_assert( FRAG_MAX_PER_PACKET <= std::numeric_limits<uint8_t>::max() );
+
+  /**
+   *  Bit packed control field for a frame carrying an entire packet. Everything
+   *  about fragmentation is implied, leaving more room for user data.
+   */
+  struct _pfCompactCtrl
+  { /* clang-format off */
+    uint8_t   version       : VERSION_LENGTH_BITS;  /**< Structure versioning information, always CTRL_COMPACT_VERSION */
+    uint8_t   dataLength    : DATA_LENGTH_BITS;     /**< User data length */
+    uint8_t   endpoint      : ENDPOINT_BITS;        /**< Endpoint this frame is destined for on the target */
+    uint8_t   shortId       : SHORT_ID_BITS;        /**< Low bits of the packet's unique id */
+  }; /* clang-format on */
+  static_assert( sizeof( _pfCompactCtrl ) == sizeof( uint8_t[ 2 ] ) );
+  static_assert( ( 1u << SHORT_ID_BITS ) <= FRAG_UUID_RESERVED );
+
+  /**
+   *  Bit packed fields the extended header carries after the full control
+   *  field. Zero in the host form of frames that arrived without them.
+   */
+  struct _pfExtCtrl
+  { /* clang-format off */
+    uint8_t   frameNumberHi : EXT_FRAME_NUMBER_BITS;  /**< Upper bits of the frame number */
+    bool      present       : 1;                      /**< Frame goes on air with the extended header */
+    uint8_t   reserved      : 4;                      /**< Unused, always zero */
+    uint8_t   sourceId;                               /**< forwardId() of the node that built the packet */
+  }; /* clang-format on */
+  static_assert( sizeof( _pfExtCtrl ) == sizeof( uint8_t[ 2 ] ) );
+
+  /**
+   *  User data that fits in a frame with the full and compact headers
+   */
+  static constexpr size_t FULL_FRAME_PAYLOAD    = 25;
+  static constexpr size_t COMPACT_FRAME_PAYLOAD = Physical::MAX_SPI_DATA_LEN - sizeof( _pfCompactCtrl );
+  static_assert( ( sizeof( _pfCtrl ) + FULL_FRAME_PAYLOAD ) <= Physical::MAX_SPI_DATA_LEN );
+
+  /**
+   *  Forwarded frames use the full header's spare byte on air to carry the id
+   *  of the node they are going to, ahead of the user data
+   */
+  static constexpr size_t FORWARD_FRAME_PAYLOAD = Physical::MAX_SPI_DATA_LEN - sizeof( _pfCtrl );
+  static_assert( FORWARD_FRAME_PAYLOAD == ( FULL_FRAME_PAYLOAD + sizeof( uint8_t ) ) );
+  static_assert( COMPACT_FRAME_PAYLOAD < ( 1u << DATA_LENGTH_BITS ) );
 
   /**
-   *  Raw frame type that is transmitted out on the wire. This is sized such
-   *  that it can accommodate the maximum payload for the radio.
+   *  User data that fits in a frame with the extended header, keeping the same
+   *  spare byte for forwarding as the full header
+   */
+  static constexpr size_t EXT_HEADER_SIZE        = sizeof( _pfCtrl ) + sizeof( _pfExtCtrl );
+  static constexpr size_t EXT_FORWARD_PAYLOAD    = Physical::MAX_SPI_DATA_LEN - EXT_HEADER_SIZE;
+  static constexpr size_t EXTENDED_FRAME_PAYLOAD = EXT_FORWARD_PAYLOAD - sizeof( uint8_t );
+
+  /**
+   *  User data in each frame of a packet split up by the network layer
+   */
+  static constexpr size_t FRAGMENT_FRAME_PAYLOAD = NRF_LINK_EXTENDED_HEADER ? EXTENDED_FRAME_PAYLOAD : FULL_FRAME_PAYLOAD;
+
+  /**
+   *  Frame data in host form, always with the full control field. The on-air
+   *  layout is produced by Frame::pack() and read back by Frame::unpack(), so
+   *  this is sized for the largest user data of either header.
    */
   struct PackedFrame
   {
-    _pfCtrl control;        /**< Frame control field */
-    uint8_t userData[ 25 ]; /**< User configurable payload */
+    _pfCtrl control;                           /**< Frame control field */
+    uint8_t userData[ COMPACT_FRAME_PAYLOAD ]; /**< User configurable payload */
+    _pfExtCtrl ext;                            /**< Extended header fields, kept clear of the full header layout */
   };
-  static_assert( sizeof( PackedFrame ) == Physical::MAX_SPI_DATA_LEN );
+  static_assert( sizeof( PackedFrame ) >= Physical::MAX_SPI_DATA_LEN );
 
 
   /*-------------------------------------------------------------------------------
@@ -111,6 +226,7 @@ namespace Ripple::NetIf::NRF24::DataLink
     Physical::PipeNumber receivedPipe;      /**< Which pipe the data came from */
     Physical::AutoRetransmitCount rtxCount; /**< Max retransmit attempts */
     Physical::AutoRetransmitDelay rtxDelay; /**< Delay between each retransmission attempt */
+    size_t queuedTime_us;                   /**< System time the frame was handed to the DataLink (uS) */
 
     /*-------------------------------------------------
     Constructors/Destructors
@@ -128,6 +244,14 @@ namespace Ripple::NetIf::NRF24::DataLink
     /*-------------------------------------------------
     Interface Functions
     -------------------------------------------------*/
+    /**
+     *  Restores the bookkeeping fields to their defaults, for reusing the frame
+     *  in place. The wire data is left alone.
+     *
+     *  @return void
+     */
+    void clear();
+
     /**
      *  Writes data into the user data field and sets the length attribute
      *  if all bytes fit.
@@ -148,23 +272,57 @@ namespace Ripple::NetIf::NRF24::DataLink
     size_t readUserData( void *const data, const size_t size );
 
     /**
-     *  Packs a frame into the buffer using network byte ordering
+     *  Sets the frame's position in its packet, spilling into the extended
+     *  header once it outgrows the full one
      *
-     *  @param[out] buffer    Output buffer to be transmitted over the network
+     *  @param[in]  number    Zero indexed frame number
      *  @return void
      */
-    void pack( FrameBuffer &buffer );
+    void setFrameNumber( const uint16_t number );
 
     /**
-     *  Unpacks data received from the network into host byte ordering
+     *  Gets the frame's position in its packet
+     *  @return uint16_t
+     */
+    uint16_t frameNumber() const;
+
+    /**
+     *  Packs a frame into the buffer in its on-air layout. Frames carrying an
+     *  entire unicast packet get the compact header, packet data the extended
+     *  one if enabled, and all others the full one.
      *
-     *  @param[in]  buffer    Network data
-     *  @return void
+     *  @param[out] buffer    Output buffer to be transmitted over the network
+     *  @return size_t        Number of meaningful bytes in the buffer
+     */
+    size_t pack( FrameBuffer &buffer );
+
+    /**
+     *  Unpacks data received from the network into the host form, whichever
+     *  header it was sent with. The data may be this frame's own wire data.
+     *
+     *  @param[in]  data      Network data
+     *  @param[in]  size      Bytes of network data
+     *  @return bool          False if the data isn't a valid frame
+     */
+    bool unpack( const void *const data, const size_t size );
+
+    /**
+     *  Checks if the frame goes on air with the compact header
+     *  @return bool
      */
-    void unpack( const FrameBuffer &buffer );
+    bool isCompact() const;
 
     /**
-     * @brief Gets the size of the frame
+     *  Checks if the frame goes on air with the extended header
+     *  @return bool
+     */
+    bool isExtended() const;
+
+    /**
+     * @brief Gets the number of meaningful bytes in the frame
+     *
+     * This is the on-air control field plus the user data actually written,
+     * which is what goes on air when dynamic payloads are enabled.
      *
      * @return size_t
      */
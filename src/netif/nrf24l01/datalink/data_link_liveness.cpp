@@ -0,0 +1,102 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_liveness.cpp
+ *
+ *  Description:
+ *    Neighbor liveness tracking implementation details
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <cstring>
+
+/* Ripple Includes */
+#include <Ripple/netif/nrf24l01>
+
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  PeerLiveness Implementation
+  -------------------------------------------------------------------------------*/
+  PeerLiveness::PeerLiveness()
+  {
+    clear();
+  }
+
+
+  void PeerLiveness::clear()
+  {
+    memset( mPeers, 0, sizeof( mPeers ) );
+  }
+
+
+  void PeerLiveness::track( const IPAddress ip, const size_t now )
+  {
+    if ( find( ip ) )
+    {
+      return;
+    }
+
+    for ( PeerState &entry : mPeers )
+    {
+      if ( !entry.used )
+      {
+        entry.used      = true;
+        entry.ip        = ip;
+        entry.lastHeard = now;
+        entry.lastProbe = now;
+        return;
+      }
+    }
+  }
+
+
+  void PeerLiveness::forget( const IPAddress ip )
+  {
+    if ( PeerState *entry = find( ip ) )
+    {
+      entry->used = false;
+    }
+  }
+
+
+  void PeerLiveness::onHeard( const IPAddress ip, const size_t now )
+  {
+    if ( PeerState *entry = find( ip ) )
+    {
+      entry->lastHeard = now;
+    }
+  }
+
+
+  void PeerLiveness::onProbe( const IPAddress ip, const size_t now )
+  {
+    if ( PeerState *entry = find( ip ) )
+    {
+      entry->lastProbe = now;
+    }
+  }
+
+
+  const PeerState *PeerLiveness::peer( const size_t idx ) const
+  {
+    return ( ( idx < PEER_LIVENESS_ELEMENTS ) && mPeers[ idx ].used ) ? &mPeers[ idx ] : nullptr;
+  }
+
+
+  PeerState *PeerLiveness::find( const IPAddress ip )
+  {
+    for ( PeerState &entry : mPeers )
+    {
+      if ( entry.used && ( entry.ip == ip ) )
+      {
+        return &entry;
+      }
+    }
+
+    return nullptr;
+  }
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
@@ -0,0 +1,114 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_liveness.hpp
+ *
+ *  Description:
+ *    Per-neighbor liveness tracking, used to send keepalives only to quiet
+ *    neighbors and to notice the ones that have gone away
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_DataLink_LIVENESS_HPP
+#define RIPPLE_DataLink_LIVENESS_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_types.hpp>
+#include <Ripple/src/netif/nrf24l01/cmn_memory_config.hpp>
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  What is known about one neighbor being alive
+   */
+  struct PeerState
+  {
+    bool used;        /**< Entry is active */
+    IPAddress ip;     /**< Neighbor */
+    size_t lastHeard; /**< Last time the neighbor proved it was there (ms) */
+    size_t lastProbe; /**< Last time a keepalive was sent to it (ms) */
+  };
+
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Remembers when each neighbor was last heard from. Any frame it ACKs and
+   *  any network service message it sends count, so neighbors already busy
+   *  with data never need an explicit keepalive.
+   *
+   *  Not thread safe, it's meant to be owned by the DataLink thread.
+   */
+  class PeerLiveness
+  {
+  public:
+    PeerLiveness();
+
+    /**
+     *  Forgets every neighbor
+     *  @return void
+     */
+    void clear();
+
+    /**
+     *  Starts tracking a neighbor, as if just heard from. Does nothing if it
+     *  is already tracked or there is no room.
+     *
+     *  @param[in]  ip          Neighbor to track
+     *  @param[in]  now         Current time (ms)
+     *  @return void
+     */
+    void track( const IPAddress ip, const size_t now );
+
+    /**
+     *  Stops tracking a neighbor
+     *
+     *  @param[in]  ip          Neighbor to forget
+     *  @return void
+     */
+    void forget( const IPAddress ip );
+
+    /**
+     *  Records proof that a tracked neighbor is there
+     *
+     *  @param[in]  ip          Neighbor heard from
+     *  @param[in]  now         Current time (ms)
+     *  @return void
+     */
+    void onHeard( const IPAddress ip, const size_t now );
+
+    /**
+     *  Records that a keepalive went out to a neighbor
+     *
+     *  @param[in]  ip          Neighbor probed
+     *  @param[in]  now         Current time (ms)
+     *  @return void
+     */
+    void onProbe( const IPAddress ip, const size_t now );
+
+    /**
+     *  Gets a tracked neighbor
+     *
+     *  @param[in]  idx         Table index, up to PEER_LIVENESS_ELEMENTS
+     *  @return const PeerState *   nullptr if the entry is not in use
+     */
+    const PeerState *peer( const size_t idx ) const;
+
+  private:
+    PeerState mPeers[ PEER_LIVENESS_ELEMENTS ];
+
+    PeerState *find( const IPAddress ip );
+  };
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
+
+#endif  /* !RIPPLE_DataLink_LIVENESS_HPP */
@@ -0,0 +1,224 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_ring.hpp
+ *
+ *  Description:
+ *    Preallocated ring of frame slots used to move data through the DataLink
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_NET_INTERFACE_NRF24L01_RING_HPP
+#define RIPPLE_NET_INTERFACE_NRF24L01_RING_HPP
+
+/* STL Includes */
+#include <atomic>
+#include <cstddef>
+
+/* Ripple Includes */
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_frame.hpp>
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Fixed ring of frame slots. Producers reserve the next free slot, build the
+   *  frame directly inside it, then commit to publish it. Consumers work on the
+   *  slots in place and pop them once done, so frames are never copied in or out
+   *  of the queue on the fast path.
+   *
+   *  The ring is lock-free for one producer and one consumer running at the same
+   *  time. The producer owns the tail and the consumer owns the head, and each
+   *  publishes its index with release ordering so the other side sees the slot
+   *  contents before the index moves. Multiple producers or consumers must be
+   *  serialized externally. Only one reservation may be outstanding at a time.
+   *
+   *  The slot storage is provided by FrameRing, which lets rings of different
+   *  depths be handled through this common type.
+   */
+  class FrameRingBase
+  {
+  public:
+    FrameRingBase( const FrameRingBase & ) = delete;
+    FrameRingBase &operator=( const FrameRingBase & ) = delete;
+
+    /*-------------------------------------------------
+    Producer Interface
+    -------------------------------------------------*/
+    /**
+     *  Gets the next free slot without publishing it
+     *  @return Frame *         nullptr if the ring is full
+     */
+    Frame *reserve()
+    {
+      const size_t tail = mTail.load( std::memory_order_relaxed );
+      if ( distance( mHead.load( std::memory_order_acquire ), tail ) >= mSize )
+      {
+        return nullptr;
+      }
+
+      return &mSlots[ tail % mSize ];
+    }
+
+    /**
+     *  Publishes the slot returned by the last call to reserve()
+     *  @return void
+     */
+    void commit()
+    {
+      const size_t tail = mTail.load( std::memory_order_relaxed );
+      if ( distance( mHead.load( std::memory_order_acquire ), tail ) < mSize )
+      {
+        mTail.store( advance( tail ), std::memory_order_release );
+      }
+    }
+
+    /**
+     *  Copies a frame into the next free slot. Drops the frame if full.
+     *
+     *  @param[in]  frame       Frame to copy in
+     *  @return void
+     */
+    void push( const Frame &frame )
+    {
+      if ( Frame *slot = reserve() )
+      {
+        *slot = frame;
+        commit();
+      }
+    }
+
+    /*-------------------------------------------------
+    Consumer Interface
+    -------------------------------------------------*/
+    /**
+     *  Gets a published frame by its position from the front
+     *
+     *  @param[in]  idx         Position of the frame, zero being the oldest
+     *  @return Frame &
+     */
+    Frame &peek( const size_t idx )
+    {
+      return mSlots[ ( mHead.load( std::memory_order_relaxed ) + idx ) % mSize ];
+    }
+
+    Frame &front()
+    {
+      return peek( 0 );
+    }
+
+    /**
+     *  Releases the oldest frame back to the ring
+     *  @return void
+     */
+    void pop()
+    {
+      const size_t head = mHead.load( std::memory_order_relaxed );
+      if ( head != mTail.load( std::memory_order_acquire ) )
+      {
+        mHead.store( advance( head ), std::memory_order_release );
+      }
+    }
+
+    /**
+     *  Copies out the oldest frame, then releases it
+     *
+     *  @param[out] frame       Destination of the copy
+     *  @return void
+     */
+    void pop_into( Frame &frame )
+    {
+      frame = front();
+      pop();
+    }
+
+    /*-------------------------------------------------
+    Shared Interface
+    -------------------------------------------------*/
+    /**
+     *  Empties the ring. Neither side may be active during the call.
+     *  @return void
+     */
+    void clear()
+    {
+      mHead.store( 0, std::memory_order_relaxed );
+      mTail.store( 0, std::memory_order_release );
+    }
+
+    bool empty() const
+    {
+      return size() == 0;
+    }
+
+    bool full() const
+    {
+      return size() >= mSize;
+    }
+
+    size_t size() const
+    {
+      return distance( mHead.load( std::memory_order_acquire ), mTail.load( std::memory_order_acquire ) );
+    }
+
+    size_t available() const
+    {
+      return mSize - size();
+    }
+
+    size_t capacity() const
+    {
+      return mSize;
+    }
+
+  protected:
+    FrameRingBase( Frame *const slots, const size_t size ) :
+        mHead( 0 ), mTail( 0 ), mSize( size ), mIndexRange( 2 * size ), mSlots( slots )
+    {
+    }
+
+  private:
+    /*-------------------------------------------------
+    Indices run over twice the slot count, which tells
+    a full ring apart from an empty one without needing
+    a shared element counter.
+    -------------------------------------------------*/
+    size_t advance( const size_t idx ) const
+    {
+      return ( idx + 1 ) % mIndexRange;
+    }
+
+    size_t distance( const size_t head, const size_t tail ) const
+    {
+      return ( tail + mIndexRange - head ) % mIndexRange;
+    }
+
+    std::atomic<size_t> mHead; /**< Index of the oldest published frame, owned by the consumer */
+    std::atomic<size_t> mTail; /**< Index of the next slot to publish, owned by the producer */
+    const size_t mSize;        /**< Number of slots */
+    const size_t mIndexRange;  /**< Range the head and tail indices wrap over */
+    Frame *const mSlots;       /**< Frame storage */
+  };
+
+
+  /**
+   *  Frame ring that owns storage for SIZE slots
+   */
+  template<const size_t SIZE>
+  class FrameRing : public FrameRingBase
+  {
+  public:
+    static_assert( SIZE > 0 );
+
+    FrameRing() : FrameRingBase( mStorage, SIZE )
+    {
+    }
+
+  private:
+    Frame mStorage[ SIZE ]; /**< Frame storage */
+  };
+}    // namespace Ripple::NetIf::NRF24::DataLink
+
+#endif /* !RIPPLE_NET_INTERFACE_NRF24L01_RING_HPP */
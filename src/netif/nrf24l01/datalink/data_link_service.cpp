@@ -8,6 +8,11 @@
  *  2020-2021 | Brandon Braun | brandonbraun653@gmail.com
  *******************************************************************************/
 
+/* STL Includes */
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
 /* Aurora Includes */
 #include <Aurora/logging>
 #include <Aurora/tracing>
@@ -37,6 +42,155 @@ Literals
 #define NRF_STAT_UPDATE_PERIOD_MS ( Chimera::Thread::TIMEOUT_100MS )
 #endif
 
+/**
+ *  Forces the radio into Standby-1 before reading the RX FIFO. The datasheet
+ *  allows R_RX_PAYLOAD while in RX mode, so this is only needed for parts that
+ *  misbehave when read while listening.
+ */
+#if !defined( NRF_LINK_RX_READ_IN_STANDBY )
+#define NRF_LINK_RX_READ_IN_STANDBY ( false )
+#endif
+
+/**
+ *  Longest the service thread sleeps with nothing to do. Waking up this often
+ *  keeps the stats fresh and recovers from any missed IRQ edge.
+ */
+#if !defined( NRF_LINK_IDLE_PERIOD_MS )
+#define NRF_LINK_IDLE_PERIOD_MS ( NRF_STAT_UPDATE_PERIOD_MS )
+#endif
+
+/**
+ *  Number of frames allowed in flight on the radio at once. A depth of one
+ *  waits for each frame to be acknowledged before loading the next.
+ */
+#if !defined( NRF_LINK_TX_PIPELINE_DEPTH )
+#define NRF_LINK_TX_PIPELINE_DEPTH ( Physical::MAX_TX_FIFO_DEPTH )
+#endif
+
+/**
+ *  How long a frame may wait before it is promoted to the next traffic class
+ *  up, keeping bulk traffic from starving under a steady real-time load. Each
+ *  further period waited promotes it again. Zero gives strict priority.
+ */
+#if !defined( NRF_LINK_TX_AGING_MS )
+#define NRF_LINK_TX_AGING_MS ( Chimera::Thread::TIMEOUT_100MS )
+#endif
+
+/**
+ *  How long a frame staged as an ACK payload may wait for the remote node to
+ *  transmit before it is pulled back and sent as a normal frame.
+ */
+#if !defined( NRF_LINK_ACK_PAYLOAD_TIMEOUT_MS )
+#define NRF_LINK_ACK_PAYLOAD_TIMEOUT_MS ( Chimera::Thread::TIMEOUT_50MS )
+#endif
+
+/**
+ *  Longest (uS) one pass of the service thread may spend working before
+ *  CB_SERVICE_OVERRUN fires. Zero turns the check off.
+ */
+#if !defined( NRF_LINK_LOOP_BUDGET_US )
+#define NRF_LINK_LOOP_BUDGET_US ( 1000 )
+#endif
+
+/**
+ *  How often one channel of the background survey is sampled while the link
+ *  is idle. A full sweep takes NUM_RF_CHANNELS times this. Zero disables it.
+ */
+#if !defined( NRF_LINK_CHANNEL_SURVEY_PERIOD_MS )
+#define NRF_LINK_CHANNEL_SURVEY_PERIOD_MS ( Chimera::Thread::TIMEOUT_100MS )
+#endif
+
+/**
+ *  Time between announcing a channel hop and moving. Must be long enough for
+ *  the announcement to reach every node in the ARP cache, retries included.
+ */
+#if !defined( NRF_LINK_CHANNEL_HOP_DELAY_MS )
+#define NRF_LINK_CHANNEL_HOP_DELAY_MS ( Chimera::Thread::TIMEOUT_500MS )
+#endif
+
+/**
+ *  Lets this node start a hop on its own once a survey sweep finds a channel
+ *  quieter than the current one by NRF_LINK_CHANNEL_HOP_MARGIN. Only enable
+ *  this on a single coordinating node, or nodes may pull in different ways.
+ */
+#if !defined( NRF_LINK_CHANNEL_AUTO_HOP )
+#define NRF_LINK_CHANNEL_AUTO_HOP ( false )
+#endif
+
+#if !defined( NRF_LINK_CHANNEL_HOP_MARGIN )
+#define NRF_LINK_CHANNEL_HOP_MARGIN ( 64 )
+#endif
+
+/**
+ *  Resolution of a node missing from the ARP cache. A request is broadcast on
+ *  the discovery address every retry period until the node answers or the
+ *  retries run out. Nodes that never answer are remembered as unreachable for
+ *  the negative timeout, during which frames to them are dropped right away.
+ */
+#if !defined( NRF_LINK_ARP_RETRY_MS )
+#define NRF_LINK_ARP_RETRY_MS ( Chimera::Thread::TIMEOUT_50MS )
+#endif
+
+#if !defined( NRF_LINK_ARP_RETRIES )
+#define NRF_LINK_ARP_RETRIES ( 3 )
+#endif
+
+#if !defined( NRF_LINK_ARP_NEGATIVE_TIMEOUT_MS )
+#define NRF_LINK_ARP_NEGATIVE_TIMEOUT_MS ( Chimera::Thread::TIMEOUT_1S )
+#endif
+
+/**
+ *  How often the direct handshake of a session resume is repeated while
+ *  waiting on the coordinator
+ */
+#if !defined( NRF_LINK_RESUME_RETRY_MS )
+#define NRF_LINK_RESUME_RETRY_MS ( 25 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+/**
+ *  Neighbor liveness. Anything a neighbor ACKs or sends counts as hearing
+ *  from it, and only neighbors quiet for the keepalive period get an explicit
+ *  probe. Those silent past the dead timeout are dropped from the ARP cache
+ *  and treated as unreachable. A keepalive period of zero turns this off.
+ */
+#if !defined( NRF_LINK_KEEPALIVE_MS )
+#define NRF_LINK_KEEPALIVE_MS ( Chimera::Thread::TIMEOUT_1S )
+#endif
+
+#if !defined( NRF_LINK_PEER_DEAD_MS )
+#define NRF_LINK_PEER_DEAD_MS ( 3 * NRF_LINK_KEEPALIVE_MS )
+#endif
+
+/**
+ *  Network clock sync. The time master and every synced node send a beacon
+ *  this often, and a node that hears none for the timeout falls back to
+ *  unsynced. A period of zero turns the service off.
+ */
+#if !defined( NRF_LINK_TIME_SYNC_PERIOD_MS )
+#define NRF_LINK_TIME_SYNC_PERIOD_MS ( Chimera::Thread::TIMEOUT_1S )
+#endif
+
+#if !defined( NRF_LINK_TIME_SYNC_TIMEOUT_MS )
+#define NRF_LINK_TIME_SYNC_TIMEOUT_MS ( 4 * NRF_LINK_TIME_SYNC_PERIOD_MS )
+#endif
+
+/**
+ *  Oldest an RX IRQ stamp can be when the FIFO is drained and still be used
+ *  for a sync beacon, in uS. Anything older was likely picked up late, and
+ *  the beacon is dropped rather than fed a bad arrival time.
+ */
+#if !defined( NRF_LINK_TIME_SYNC_STAMP_AGE_US )
+#define NRF_LINK_TIME_SYNC_STAMP_AGE_US ( 2000 )
+#endif
+
+/**
+ *  Worst expected disagreement between two synced clocks, in uS. Counted into
+ *  the TDMA guard time alongside the radio turnaround.
+ */
+#if !defined( NRF_LINK_TDMA_SYNC_ERROR_US )
+#define NRF_LINK_TDMA_SYNC_ERROR_US ( 100 )
+#endif
+
 namespace Ripple::NetIf::NRF24::DataLink
 {
   /*-------------------------------------------------------------------------------
@@ -50,6 +204,179 @@ namespace Ripple::NetIf::NRF24::DataLink
                                                          PIPE_APP_DATA_3 };
   static_assert( ARRAY_COUNT( sEndpointPipes ) == EP_NUM_OPTIONS );
   static_assert( PIPE_DEVICE_ROOT == Physical::PIPE_NUM_1 );
+  static_assert( ( NRF_LINK_TX_PIPELINE_DEPTH >= 1 ) && ( NRF_LINK_TX_PIPELINE_DEPTH <= Physical::MAX_TX_FIFO_DEPTH ) );
+  static_assert( sizeof( ChannelHopMsg ) <= FULL_FRAME_PAYLOAD );
+  static_assert( sizeof( ARPMsg ) <= FULL_FRAME_PAYLOAD );
+  static_assert( sizeof( KeepAliveMsg ) <= FULL_FRAME_PAYLOAD );
+  static_assert( !NRF_LINK_KEEPALIVE_MS || ( NRF_LINK_PEER_DEAD_MS > NRF_LINK_KEEPALIVE_MS ),
+                 "Peers must have a chance to answer a keepalive" );
+  static_assert( sizeof( TimeSyncMsg ) <= FULL_FRAME_PAYLOAD );
+  static_assert( !NRF_LINK_TIME_SYNC_PERIOD_MS || ( NRF_LINK_TIME_SYNC_TIMEOUT_MS > NRF_LINK_TIME_SYNC_PERIOD_MS ),
+                 "Sync must survive a lost beacon" );
+  static_assert( sizeof( TDMASlotMsg ) <= FULL_FRAME_PAYLOAD );
+
+  /**
+   *  Dead time at each end of a TDMA slot. The last owner needs a PLL settle
+   *  to drop back to RX, this node needs another to come up in TX, and the
+   *  two clocks may disagree on where the edge is.
+   */
+  static constexpr uint32_t TDMA_GUARD_US = ( 2u * Physical::PLL_SETTLE_TIME_US ) + NRF_LINK_TDMA_SYNC_ERROR_US;
+
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Prepares a TX slot for a new outgoing frame, using the default reliability
+   *  settings. The caller fills in the remaining control fields and user data.
+   *
+   *  @param[out] frame       Slot to initialize
+   *  @param[in]  nextHop     Node the frame is going to
+   *  @param[in]  handle      Physical layer configuration
+   *  @return void
+   */
+  static void initTXFrame( Frame &frame, const IPAddress nextHop, const Physical::Handle &handle )
+  {
+    frame.clear();
+    frame.txAttempts    = 1;
+    frame.nextHop       = nextHop;
+    frame.rtxCount      = handle.cfg.hwRTXCount;
+    frame.rtxDelay      = handle.cfg.hwRTXDelay;
+    frame.queuedTime_us = Chimera::micros();
+
+    memset( &frame.wireData.control, 0, sizeof( frame.wireData.control ) );
+    memset( &frame.wireData.ext, 0, sizeof( frame.wireData.ext ) );
+    frame.wireData.control.version    = CTRL_STRUCTURE_VERSION;
+    frame.wireData.control.requireACK = true;
+  }
+
+
+  /**
+   *  Air time of one attempt at sending a frame, counting the ACK coming back.
+   *  Assumes the widest packet the radio can send, retries aren't included.
+   *
+   *  @param[in]  frame       Frame being sent
+   *  @param[in]  handle      Physical layer configuration
+   *  @return uint32_t        Time on air (uS)
+   */
+  static uint32_t frameAirTime( const Frame &frame, const Physical::Handle &handle )
+  {
+    /*-------------------------------------------------
+    Preamble, 5 byte address, payload and 2 byte CRC,
+    plus the 9 bit packet control field (RM 7.3)
+    -------------------------------------------------*/
+    constexpr uint32_t FRAME_BITS = ( ( 1u + 5u + Physical::MAX_TX_PAYLOAD_SIZE + 2u ) * 8u ) + 9u;
+    constexpr uint32_t ACK_BITS   = ( ( 1u + 5u + 2u ) * 8u ) + 9u;
+
+    uint32_t kbps = 1000;
+    if ( handle.cfg.hwDataRate == Physical::DR_2MBPS )
+    {
+      kbps = 2000;
+    }
+    else if ( handle.cfg.hwDataRate == Physical::DR_250KBPS )
+    {
+      kbps = 250;
+    }
+
+    uint32_t airTime_us = Physical::PLL_SETTLE_TIME_US + ( ( FRAME_BITS * 1000u ) / kbps );
+    if ( frame.wireData.control.requireACK )
+    {
+      airTime_us += Physical::PLL_SETTLE_TIME_US + ( ( ACK_BITS * 1000u ) / kbps );
+    }
+
+    return airTime_us;
+  }
+
+
+  /**
+   *  Longest a frame can keep the air busy, every hardware retry included.
+   *  Each retry waits out the retransmit delay, then goes out again.
+   *
+   *  @param[in]  frame       Frame being sent, with its retry settings applied
+   *  @param[in]  handle      Physical layer configuration
+   *  @return uint32_t        Time on air (uS)
+   */
+  static uint32_t frameWorstCaseTime( const Frame &frame, const Physical::Handle &handle )
+  {
+    const uint32_t attempt_us = frameAirTime( frame, handle );
+    if ( !frame.wireData.control.requireACK || ( frame.rtxCount > Physical::ART_COUNT_15 ) ||
+         ( frame.rtxDelay > Physical::ART_DELAY_MAX ) )
+    {
+      return attempt_us;
+    }
+
+    const uint32_t retries  = static_cast<uint32_t>( frame.rtxCount );
+    const uint32_t delay_us = ( static_cast<uint32_t>( frame.rtxDelay ) + 1u ) * 250u;
+    return attempt_us + ( retries * ( delay_us + attempt_us ) );
+  }
+
+
+  /**
+   *  Gets who reassembly takes a received fragment to be from. Frames with the
+   *  compact header say nothing of their sender, so the pipe they came in on
+   *  stands in for it. Their short ids sit in the reserved UUID range, which
+   *  keeps them apart from any full UUID whatever source is picked here.
+   *
+   *  @param[in]  frame       Frame as taken off the RX queue
+   *  @return IPAddress
+   */
+  static IPAddress fragmentSource( const Frame &frame )
+  {
+    if ( frame.wireData.control.uuid < FRAG_UUID_RESERVED )
+    {
+      return static_cast<IPAddress>( frame.receivedPipe ) + 1u;
+    }
+
+    return frame.wireData.ext.sourceId;
+  }
+
+
+  /**
+   *  Advances to the next application data pipe, spreading traffic across all
+   *  of them in turn.
+   *
+   *  @param[out] pipe        Pipe to advance
+   *  @return void
+   */
+  static void nextTXPipe( Physical::PipeNumber &pipe )
+  {
+    switch ( pipe )
+    {
+      case PIPE_APP_DATA_0:
+        pipe = PIPE_APP_DATA_1;
+        break;
+
+      case PIPE_APP_DATA_1:
+        pipe = PIPE_APP_DATA_2;
+        break;
+
+      case PIPE_APP_DATA_2:
+        pipe = PIPE_APP_DATA_3;
+        break;
+
+      case PIPE_APP_DATA_3:
+      default:
+        pipe = PIPE_APP_DATA_0;
+        break;
+    };
+  }
+
+
+  /**
+   *  Checks if two frames can be in the hardware TX FIFO at the same time. The
+   *  destination address and retry settings can only be changed while the FIFO
+   *  is empty, so they must match.
+   *
+   *  @param[in]  inFlight    Most recent frame loaded into the FIFO
+   *  @param[in]  next        Frame that would be loaded next
+   *  @return bool
+   */
+  static bool canShareTXFifo( const Frame &inFlight, const Frame &next )
+  {
+    return ( inFlight.nextHop == next.nextHop ) &&
+           ( inFlight.wireData.control.multicast == next.wireData.control.multicast ) &&
+           ( inFlight.wireData.control.requireACK == next.wireData.control.requireACK ) &&
+           ( inFlight.rtxDelay == next.rtxDelay ) && ( inFlight.rtxCount == next.rtxCount );
+  }
 
   /*-------------------------------------------------------------------------------
   Public Functions
@@ -62,11 +389,30 @@ namespace Ripple::NetIf::NRF24::DataLink
   }
 
 
+  DataLink *createNetIf( StaticSlot<DataLink> &slot )
+  {
+    void *ptr = slot.claim();
+    return ptr ? new ( ptr ) DataLink() : nullptr;
+  }
+
+
   /*-------------------------------------------------------------------------------
   Service Class Implementation
   -------------------------------------------------------------------------------*/
-  DataLink::DataLink() : mSystemEnabled( false ), pendingEvent( false )
+  DataLink::DataLink() :
+      mSystemEnabled( false ), mDedicatedRX( false ), mEvents( SVC_EVT_NONE ), mStatsTime( 0 ), mStatsTXBytes( 0 ),
+      mStatsRXBytes( 0 ), mTXQueue{ &mTXControl, &mTXRealtime, &mTXBulk }, mTXClass( TC_DEFAULT ), mRXReserved( nullptr ),
+      mLastIRQ_us( 0 ), mIRQSeq( 0 ), mRXDrainSeq( 0 ), mRXStamp_us( 0 ), mRXStampValid( false ), mRXPayloads( 0 ),
+      mLastBeacon( 0 ), mBeaconSeq( 0 ), mTDMAHold_us( 0 )
   {
+    static_assert( TC_NUM_OPTIONS == 3, "Update the TX queue list" );
+    mACB.reset();
+    mSurvey.reset();
+    mHopCB.reset();
+    mSessionCB.reset();
+    mMulticastHistory.reset();
+    mForwardTable.reset();
+    mProfile.setBudget( NRF_LINK_LOOP_BUDGET_US );
   }
 
 
@@ -91,6 +437,7 @@ namespace Ripple::NetIf::NRF24::DataLink
     mTCB.reset();
     mTCB.mTXRate_us = 500;
     mTCB.mLastTX_us = Chimera::micros();
+    mLinkEstimator.reset( mPhyHandle.cfg.hwRTXDelay, mPhyHandle.cfg.hwRTXCount, mTCB.mTXRate_us );
 
     /*-------------------------------------------------
     First turn on the hardware drivers
@@ -119,6 +466,7 @@ namespace Ripple::NetIf::NRF24::DataLink
     cfg.specialization.staticTask.stackBuffer = mContext->malloc( THREAD_STACK_BYTES );
     cfg.specialization.staticTask.stackSize   = THREAD_STACK_BYTES;
 
+    mProfile.watchStack( cfg.specialization.staticTask.stackBuffer, THREAD_STACK_BYTES );
     datalink.create( cfg );
     mTaskId = datalink.start();
     sendTaskMsg( mTaskId, ITCMsg::TSK_MSG_WAKEUP, TIMEOUT_DONT_WAIT );
@@ -137,30 +485,36 @@ namespace Ripple::NetIf::NRF24::DataLink
   Chimera::Status_t DataLink::recv( Fragment_sPtr &fragmentList )
   {
     /*-------------------------------------------------
-    Is the RX queue empty?
+    Is the RX queue empty? This thread is the only RX
+    consumer, so no lock is needed against the DataLink
+    thread filling it.
     -------------------------------------------------*/
-    Chimera::Thread::LockGuard queueLock( mRXMutex );
-    if ( mRXQueue.empty() )
+    size_t pending = mRXQueue.size();
+    if ( !pending )
     {
       return Chimera::Status::EMPTY;
     }
 
     /*-------------------------------------------------
-    Pull out each packet and assemble into a list
+    Pull out each packet and assemble into a list. Only
+    the frames present on entry are taken, so a busy
+    link can't keep the caller here forever. Only the
+    fragment heap is locked, never the whole context.
     -------------------------------------------------*/
-    Chimera::Thread::LockGuard contextLock( *mContext );
+    Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> heapLock( mContext->mHeap );
+    AllocSiteScope allocSite( mContext->mHeap, ALLOC_FRAGMENT );
 
     Fragment_sPtr rootMsg    = Fragment_sPtr();
     Chimera::Status_t result = Chimera::Status::READY;
 
-    while ( !mRXQueue.empty() )
+    while ( pending-- )
     {
       /*-------------------------------------------------
       Always pull the next frame to prevent stalling the
-      low level hardware processing.
+      low level hardware processing. The frame is read in
+      place and its slot released once copied out.
       -------------------------------------------------*/
       Frame &tmpFrame = mRXQueue.front();
-      mRXQueue.pop();
 
       /*-------------------------------------------------
       Make sure enough memory exists to allocate. If it
@@ -171,6 +525,7 @@ namespace Ripple::NetIf::NRF24::DataLink
       {
         LOG_DEBUG_IF( DEBUG_MODULE, "No memory to allocate for incoming fragment\r\n" );
         result = Chimera::Status::MEMORY;
+        mRXQueue.pop();
         continue;
       }
 
@@ -178,12 +533,15 @@ namespace Ripple::NetIf::NRF24::DataLink
       Copy in fragment fields
       -------------------------------------------------*/
       newFrag->length = tmpFrame.wireData.control.dataLength;
-      newFrag->number = tmpFrame.wireData.control.frameNumber;
+      newFrag->number = tmpFrame.frameNumber();
       newFrag->uuid   = tmpFrame.wireData.control.uuid;
       newFrag->total  = tmpFrame.wireData.control.totalFrames;
+      newFrag->parity = tmpFrame.wireData.control.parityFrames;
+      newFrag->source = fragmentSource( tmpFrame );
 
-      void **payload_buffer = newFrag->data.get();
-      tmpFrame.readUserData( *payload_buffer, newFrag->length );
+      tmpFrame.readUserData( newFrag->payload(), newFrag->length );
+      mLatency.recordSince( LAT_LINK_RX, static_cast<uint32_t>( tmpFrame.queuedTime_us ) );
+      mRXQueue.pop();
 
       /*-------------------------------------------------
       Link the fragments by inserting at the front. Order
@@ -214,80 +572,287 @@ namespace Ripple::NetIf::NRF24::DataLink
   }
 
 
-  Chimera::Status_t DataLink::send( const Fragment_sPtr msg, const IPAddress &ip )
+  Chimera::Status_t DataLink::send( const Fragment_sPtr msg, const IPAddress &ip, const TrafficClass tc )
+  {
+    return sendSelected( msg, ip, tc, std::numeric_limits<FragmentMask>::max() );
+  }
+
+
+  Chimera::Status_t DataLink::sendSelected( const Fragment_sPtr msg, const IPAddress &ip, const TrafficClass tc,
+                                            const FragmentMask selection )
+  {
+    /*-------------------------------------------------
+    Construct the NRF24 data link layer packets. The
+    lock only serializes producers, the DataLink thread
+    consumes without it. The whole message goes in or
+    none of it does, so a refused send can be retried
+    as is.
+    -------------------------------------------------*/
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+
+    IPAddress nextHop              = ip;
+    bool forward                   = false;
+    const Chimera::Status_t result = planSelected( msg, ip, tc, selection, nextHop, forward );
+    if ( result != Chimera::Status::READY )
+    {
+      return result;
+    }
+
+    const uint8_t sourceId = ( NRF_LINK_EXTENDED_HEADER && mContext ) ? forwardId( mContext->getIPAddress() ) : 0;
+    FrameRingBase &queue   = *mTXQueue[ tc ];
+    size_t fragPosition    = 0;
+
+    for ( Fragment_sPtr fragPtr = msg; fragPtr; fragPtr = fragPtr->next, fragPosition++ )
+    {
+      if ( ( fragPosition >= FRAG_MAX_PER_PACKET ) || !( ( selection >> fragPosition ) & 1u ) )
+      {
+        continue;
+      }
+
+      /*-------------------------------------------------
+      Build the frame directly in the next free TX slot,
+      so the fragment data is only copied once. Room was
+      checked above, so the slot is always there.
+      -------------------------------------------------*/
+      Frame *slot = queue.reserve();
+
+      initTXFrame( *slot, nextHop, mPhyHandle );
+      slot->setFrameNumber( fragPtr->number );
+      slot->wireData.control.totalFrames  = static_cast<uint8_t>( fragPtr->total );
+      slot->wireData.control.endpoint     = Endpoint::EP_APPLICATION_DATA_0;
+      slot->wireData.control.uuid         = fragPtr->uuid;
+      slot->wireData.control.parityFrames = fragPtr->parity;
+      slot->wireData.ext.present          = NRF_LINK_EXTENDED_HEADER;
+      slot->wireData.ext.sourceId         = sourceId;
+
+      const uint8_t *data = fragPtr->payload();
+      if ( forward )
+      {
+        slot->wireData.control.endpoint   = Endpoint::EP_DATA_FORWARDING;
+        slot->wireData.control.hopLimit   = FORWARD_HOP_LIMIT;
+        slot->wireData.control.dataLength = fragPtr->length + 1u;
+        slot->wireData.userData[ 0 ]      = forwardId( ip );
+        memcpy( &slot->wireData.userData[ 1 ], data, fragPtr->length );
+      }
+      else
+      {
+        slot->writeUserData( data, fragPtr->length );
+      }
+
+      /*-------------------------------------------------
+      Publish and prep for the next frame
+      -------------------------------------------------*/
+      queue.commit();
+      signalEvent( SVC_EVT_TX_ENQUEUE );
+    }
+
+    return Chimera::Status::READY;
+  }
+
+
+  Chimera::Status_t DataLink::checkSelected( const Fragment_sPtr msg, const IPAddress &ip, const TrafficClass tc,
+                                             const FragmentMask selection )
+  {
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+
+    IPAddress nextHop = ip;
+    bool forward      = false;
+    return planSelected( msg, ip, tc, selection, nextHop, forward );
+  }
+
+
+  Chimera::Status_t DataLink::planSelected( const Fragment_sPtr msg, const IPAddress &ip, const TrafficClass tc,
+                                            const FragmentMask selection, IPAddress &nextHop, bool &forward )
   {
+    static_assert( FRAG_MAX_PER_PACKET <= std::numeric_limits<FragmentMask>::digits, "Selection can't cover every fragment" );
+
     /*-------------------------------------------------
     Input Protections
     -------------------------------------------------*/
-    if ( !msg )
+    if ( !msg || ( tc >= TC_NUM_OPTIONS ) )
     {
       return Chimera::Status::INVAL_FUNC_PARAM;
     }
 
     /*-------------------------------------------------
-    Construct the NRF24 data link layer packets
+    Nodes behind a relay are handed to the next hop,
+    tagged with the id of where they are going.
+    -------------------------------------------------*/
+    nextHop = ip;
+    forward = false;
+    {
+      Chimera::Thread::LockGuard lck( *this );
+      if ( const ForwardRoute *route = mForwardTable.find( ip ) )
+      {
+        nextHop = route->nextHop;
+        forward = true;
+      }
+    }
+
+    /*-------------------------------------------------
+    Check the incoming data for validity. Fragmented
+    messages must not exceed a certain size, though an
+    unfragmented one gets the room of the compact header.
+    Forwarded frames always use the full header, or the
+    extended one if enabled.
     -------------------------------------------------*/
-    Chimera::Thread::LockGuard txLock( mTXMutex );
     Fragment_sPtr fragPtr = msg;
     size_t fragCounter    = 0;
+    size_t fragPosition   = 0;
 
-    while ( fragPtr )
+    for ( ; fragPtr; fragPtr = fragPtr->next, fragPosition++ )
     {
-      /*-------------------------------------------------
-      Check the incoming data for validity. Fragmented
-      messages must not exceed a certain size.
-      -------------------------------------------------*/
-      if ( !fragPtr->data || ( fragPtr->length > sizeof( PackedFrame::userData ) ) )
+      if ( ( fragPosition >= FRAG_MAX_PER_PACKET ) || !( ( selection >> fragPosition ) & 1u ) )
       {
-        LOG_DEBUG_IF( DEBUG_MODULE, "Fragment %d is invalid\r\n", fragCounter );
-        return Chimera::Status::MEMORY;
+        continue;
       }
-      else if ( mTXQueue.full() )
+
+      const size_t maxLength =
+          ( ( fragPtr->total <= 1 ) && !forward ) ? COMPACT_FRAME_PAYLOAD : FRAGMENT_FRAME_PAYLOAD;
+      if ( !fragPtr->data || ( fragPtr->number >= maxNumFragments() ) || ( fragPtr->length > maxLength ) )
       {
-        return Chimera::Status::FULL;
+        LOG_DEBUG_IF( DEBUG_MODULE, "Fragment %d is invalid\r\n", fragPosition );
+        return Chimera::Status::MEMORY;
       }
 
-      /*-------------------------------------------------
-      Build up the raw frame information
-      -------------------------------------------------*/
-      Frame tmpFrame;
-
-      /* Some high level packet parameters */
-      tmpFrame.txAttempts   = 1;
-      tmpFrame.nextHop      = ip;
-      tmpFrame.receivedPipe = Physical::PipeNumber::PIPE_INVALID;
-      tmpFrame.rtxCount     = mPhyHandle.cfg.hwRTXCount;
-      tmpFrame.rtxDelay     = mPhyHandle.cfg.hwRTXDelay;
-
-      /* Set packet control parameters */
-      memset( &tmpFrame.wireData, 0, sizeof( PackedFrame ) );
-      tmpFrame.wireData.control.multicast   = false;
-      tmpFrame.wireData.control.requireACK  = true;
-      tmpFrame.wireData.control.frameNumber = static_cast<uint8_t>( fragPtr->number );
-      tmpFrame.wireData.control.totalFrames = static_cast<uint8_t>( fragPtr->total );
-      tmpFrame.wireData.control.endpoint    = Endpoint::EP_APPLICATION_DATA_0;
-      tmpFrame.wireData.control.uuid        = fragPtr->uuid;
-
-      /* Copy in the data */
-      void **data = fragPtr->data.get();
-      tmpFrame.writeUserData( *data, fragPtr->length );
+      fragCounter++;
+    }
+
+    const FrameRingBase &queue = *mTXQueue[ tc ];
+    if ( fragCounter > queue.capacity() )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "%d frames will never fit a queue of %d\r\n", fragCounter, queue.capacity() );
+      return Chimera::Status::MEMORY;
+    }
+
+    if ( queue.available() < fragCounter )
+    {
+      return Chimera::Status::FULL;
+    }
+
+    return Chimera::Status::READY;
+  }
+
+
+  Chimera::Status_t DataLink::sendMulticast( const Fragment_sPtr msg, const uint8_t repeats, const TrafficClass tc )
+  {
+    /*-------------------------------------------------
+    Input Protections
+    -------------------------------------------------*/
+    if ( !msg || ( tc >= TC_NUM_OPTIONS ) || ( repeats > MULTICAST_MAX_REPEATS ) )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+
+    size_t numFrames      = 0;
+    Fragment_sPtr fragPtr = msg;
+    while ( fragPtr )
+    {
+      if ( !fragPtr->data || ( fragPtr->number >= maxNumFragments() ) || ( fragPtr->length > FRAGMENT_FRAME_PAYLOAD ) )
+      {
+        LOG_DEBUG_IF( DEBUG_MODULE, "Fragment %d is invalid\r\n", numFrames );
+        return Chimera::Status::MEMORY;
+      }
 
-      /*-------------------------------------------------
-      Enqueue and prep for the next frame
-      -------------------------------------------------*/
-      mTXQueue.push( tmpFrame );
       fragPtr = fragPtr->next;
-      fragCounter++;
+      numFrames++;
     }
 
+    /*-------------------------------------------------
+    Queue all the copies or none at all. A partially
+    queued message can't be retried without repeating
+    the frames that made it in.
+    -------------------------------------------------*/
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+    FrameRingBase &queue = *mTXQueue[ tc ];
+    if ( ( numFrames * ( repeats + 1u ) ) > queue.capacity() )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "%d multicast frames will never fit a queue of %d\r\n", numFrames * ( repeats + 1u ),
+                    queue.capacity() );
+      return Chimera::Status::MEMORY;
+    }
+
+    if ( queue.available() < ( numFrames * ( repeats + 1u ) ) )
+    {
+      return Chimera::Status::FULL;
+    }
+
+    const uint8_t sourceId = ( NRF_LINK_EXTENDED_HEADER && mContext ) ? forwardId( mContext->getIPAddress() ) : 0;
+
+    /*-------------------------------------------------
+    Send the whole message once per copy rather than
+    each frame back to back, so a short burst of noise
+    can't take out every copy of the same frame.
+    -------------------------------------------------*/
+    for ( size_t copy = 0; copy <= repeats; copy++ )
+    {
+      fragPtr = msg;
+      while ( fragPtr )
+      {
+        Frame *slot = queue.reserve();
+        RT_HARD_ASSERT( slot );
+
+        initTXFrame( *slot, MULTICAST_NEXT_HOP, mPhyHandle );
+        slot->setFrameNumber( fragPtr->number );
+        slot->wireData.control.totalFrames  = static_cast<uint8_t>( fragPtr->total );
+        slot->wireData.control.endpoint     = Endpoint::EP_APPLICATION_DATA_0;
+        slot->wireData.control.uuid         = fragPtr->uuid;
+        slot->wireData.control.parityFrames = fragPtr->parity;
+        slot->wireData.control.multicast    = true;
+        slot->wireData.control.requireACK   = false;
+        slot->wireData.ext.present          = NRF_LINK_EXTENDED_HEADER;
+        slot->wireData.ext.sourceId         = sourceId;
+
+        slot->writeUserData( fragPtr->payload(), fragPtr->length );
+
+        queue.commit();
+        fragPtr = fragPtr->next;
+      }
+    }
+
+    signalEvent( SVC_EVT_TX_ENQUEUE );
     return Chimera::Status::READY;
   }
 
 
   void DataLink::getStats( PerfStats &stats )
   {
-    Chimera::Thread::LockGuard _lock( *this );
-    stats = mStats;
+    {
+      Chimera::Thread::LockGuard _lock( *this );
+      stats = mStats;
+    }
+
+    /*-------------------------------------------------
+    Overlay the per-frame counters, which are kept
+    outside the lock
+    -------------------------------------------------*/
+    constexpr auto order     = std::memory_order_relaxed;
+    stats.tx_bytes           = mCounters.tx_bytes.load( order );
+    stats.tx_bytes_lost      = mCounters.tx_bytes_lost.load( order );
+    stats.rx_bytes           = mCounters.rx_bytes.load( order );
+    stats.rx_bytes_lost      = mCounters.rx_bytes_lost.load( order );
+    stats.frame_tx           = mCounters.frame_tx.load( order );
+    stats.frame_rx           = mCounters.frame_rx.load( order );
+    stats.frame_tx_fail      = mCounters.frame_tx_fail.load( order );
+    stats.frame_tx_drop      = mCounters.frame_tx_drop.load( order );
+    stats.frame_rx_drop      = mCounters.frame_rx_drop.load( order );
+    stats.tx_latency_last_us = mCounters.tx_latency_last_us.load( order );
+    stats.tx_latency_avg_us  = mCounters.tx_latency_avg_us.load( order );
+    stats.tx_latency_max_us  = mCounters.tx_latency_max_us.load( order );
+
+    stats.tx_control_latency_max_us = mCounters.tx_ctrl_latency_us.load( order );
+    stats.frame_fwd                 = mCounters.frame_fwd.load( order );
+    stats.frame_fwd_drop            = mCounters.frame_fwd_drop.load( order );
+    stats.keepalive_tx              = mCounters.keepalive_tx.load( order );
+    stats.peers_lost                = mCounters.peers_lost.load( order );
+
+    mProfile.getLoad( stats.load );
+  }
+
+
+  void DataLink::getLatencyStats( LatencyReport &report )
+  {
+    mLatency.snapshot( report );
   }
 
 
@@ -299,13 +864,28 @@ namespace Ripple::NetIf::NRF24::DataLink
 
   size_t DataLink::maxTransferSize() const
   {
-    return sizeof( PackedFrame::userData );
+    return FRAGMENT_FRAME_PAYLOAD;
+  }
+
+
+  size_t DataLink::maxUnfragmentedSize() const
+  {
+    /*-------------------------------------------------
+    Routed nodes need the full header, and the caller
+    doesn't say where its packet is going.
+    -------------------------------------------------*/
+    return mForwardTable.count ? FRAGMENT_FRAME_PAYLOAD : COMPACT_FRAME_PAYLOAD;
   }
 
 
   size_t DataLink::maxNumFragments() const
   {
-    return static_cast<size_t>( pow( 2, FRAME_NUMBER_BITS ) );
+    /*-------------------------------------------------
+    The frame numbers can count further than the stack
+    can track with the extended header
+    -------------------------------------------------*/
+    constexpr size_t frameBits = FRAME_NUMBER_BITS + ( NRF_LINK_EXTENDED_HEADER ? EXT_FRAME_NUMBER_BITS : 0 );
+    return std::min<size_t>( static_cast<size_t>( 1u ) << frameBits, FRAG_MAX_PER_PACKET );
   }
 
   size_t DataLink::linkSpeed() const
@@ -320,6 +900,17 @@ namespace Ripple::NetIf::NRF24::DataLink
   }
 
 
+  bool DataLink::networkTime( uint64_t &now_us )
+  {
+    this->lock();
+    const uint64_t local_us = mTimeSync.extend( static_cast<uint32_t>( Chimera::micros() ) );
+    const bool synced       = mTimeSync.toGlobal( local_us, now_us );
+    this->unlock();
+
+    return synced;
+  }
+
+
   /*-------------------------------------------------------------------------------
   Service: ARP Interface
   -------------------------------------------------------------------------------*/
@@ -412,6 +1003,14 @@ namespace Ripple::NetIf::NRF24::DataLink
     Establish communication with the radio and set up user configuration
     -------------------------------------------------------------------------*/
     memset( &mStats, 0, sizeof( mStats ) );
+    mCounters.reset();
+    mLatency.clear();
+    mStatsTime    = Chimera::millis();
+    mStatsTXBytes = 0;
+    mStatsRXBytes = 0;
+    mStats.rf_channel = mPhyHandle.cfg.hwRFChannel;
+    mLiveness.clear();
+    mLastActive = Chimera::millis();
     mFSMControl.receive( Physical::FSM::MsgPowerUp() );
     mSystemEnabled = true;
 
@@ -421,60 +1020,161 @@ namespace Ripple::NetIf::NRF24::DataLink
     while ( 1 )
     {
       /*-----------------------------------------------------------------------
-      Process the core radio events. This is driven by a GPIO interrupt tied to
-      the IRQ pin, or by another task informing that it's time to process data.
+      Sleep until an ISR or another thread raises an event, or until the next
+      tracked deadline expires. A wakeup without any flags set came from some
+      external task, so treat it like a timer event and check everything.
+      -----------------------------------------------------------------------*/
+      uint32_t events = mEvents.exchange( SVC_EVT_NONE );
+      if ( !events )
+      {
+        this_thread::pendTaskMsg( TSK_MSG_WAKEUP, nextWakeupDelay() );
+        events = mEvents.exchange( SVC_EVT_NONE );
+      }
+
+      if ( !events )
+      {
+        events = SVC_EVT_TIMER;
+      }
+
+      mProfile.beginWork();
+
+      /*-----------------------------------------------------------------------
+      Polling the radio on timer events catches any missed IRQ edges. It's a
+      single STATUS read, so the cost is low at the idle period rate.
       -----------------------------------------------------------------------*/
-      if ( pendingEvent || this_thread::pendTaskMsg( TSK_MSG_WAKEUP, 5 ) )
+      if ( events & SVC_EVT_TIMER )
       {
-        pendingEvent      = false;
-        uint8_t eventMask = Physical::getISREvent( mPhyHandle );
+        events |= SVC_EVT_RADIO_IRQ;
+      }
 
+      /*-----------------------------------------------------------------------
+      Process the core radio events
+      -----------------------------------------------------------------------*/
+      if ( events & SVC_EVT_RADIO_IRQ )
+      {
         /*-------------------------------------------------
-        The last packet failed to transmit correctly
+        Retire any payload writes that finished clocking
+        out while this thread was asleep.
         -------------------------------------------------*/
-        if ( eventMask & Physical::bfISRMask::ISR_MSK_MAX_RT )
-        {
-          processTXFail();
-        }
+        Physical::spiProcessAsync( mPhyHandle );
+        const uint32_t irqSeq = mIRQSeq.load();
+        uint8_t eventMask     = Physical::getISREvent( mPhyHandle );
 
         /*-------------------------------------------------
-        A new packet was received
+        A TX event shares the IRQ edge, so its stamp can't
+        be told apart from an RX arrival. Mark the edge as
+        used so the RX drain below won't trust it.
         -------------------------------------------------*/
-        if ( eventMask & Physical::bfISRMask::ISR_MSK_RX_DR )
+        if ( eventMask & ( Physical::bfISRMask::ISR_MSK_TX_DS | Physical::bfISRMask::ISR_MSK_MAX_RT ) )
         {
-          processRXQueue();
+          mRXDrainSeq = irqSeq;
         }
 
         /*-------------------------------------------------
-        A packet successfully transmitted
+        A packet successfully transmitted. Handle this ahead
+        of failures so frames that made it out before the
+        FIFO stalled are retired first.
         -------------------------------------------------*/
         if ( eventMask & Physical::bfISRMask::ISR_MSK_TX_DS )
         {
           processTXSuccess();
         }
-      }
+
+        /*-------------------------------------------------
+        The last packet failed to transmit correctly
+        -------------------------------------------------*/
+        if ( eventMask & Physical::bfISRMask::ISR_MSK_MAX_RT )
+        {
+          processTXFail();
+        }
+
+        /*-------------------------------------------------
+        A new packet was received
+        -------------------------------------------------*/
+        if ( eventMask & Physical::bfISRMask::ISR_MSK_RX_DR )
+        {
+          processRXQueue();
+        }
+
+        /*-------------------------------------------------
+        Finished or failed frames free up FIFO space and
+        may have been requeued, so keep the TX path moving.
+        -------------------------------------------------*/
+        if ( eventMask & ( Physical::bfISRMask::ISR_MSK_TX_DS | Physical::bfISRMask::ISR_MSK_MAX_RT ) )
+        {
+          events |= SVC_EVT_TX_ENQUEUE;
+        }
+      }
 
       /*-----------------------------------------------------------------------
-      Handle packet TX timeouts. Getting here means there is likely a setup
-      issue with the hardware or no receiver exists to accept the data.
+      Service the deadlines tracked by this thread
       -----------------------------------------------------------------------*/
-      if ( mTCB.inProgress && ( ( Chimera::millis() - mTCB.start ) > mTCB.timeout ) )
+      if ( events & SVC_EVT_TIMER )
       {
-        processTXFail();
+        /*-------------------------------------------------
+        Handle packet TX timeouts. Getting here means there
+        is likely a setup issue with the hardware or no
+        receiver exists to accept the data.
+        -------------------------------------------------*/
+        if ( mTCB.inProgress() && ( ( Chimera::millis() - mTCB.oldest().start ) > mTCB.oldest().timeout ) )
+        {
+          processTXFail();
+        }
+
+        /*-------------------------------------------------
+        Staged ACK payloads that the remote node never came
+        to collect go back out as normal transmissions. The
+        TX pass below picks them up right away.
+        -------------------------------------------------*/
+        if ( mACB.staged && ( ( Chimera::millis() - mACB.stagedStart ) > NRF_LINK_ACK_PAYLOAD_TIMEOUT_MS ) )
+        {
+          evictAckPayloads();
+        }
+
+        /*-------------------------------------------------
+        RF channel housekeeping. A due hop goes first so
+        the survey doesn't sample on the way out.
+        -------------------------------------------------*/
+        processChannelHop();
+        processChannelSurvey();
+
+        /*-------------------------------------------------
+        Resolve addresses for any parked frames
+        -------------------------------------------------*/
+        processARPPending();
+
+        /*-------------------------------------------------
+        Check in with quiet neighbors
+        -------------------------------------------------*/
+        processLiveness();
+
+        /*-------------------------------------------------
+        Keep the network clock in step
+        -------------------------------------------------*/
+        processTimeSync();
+
+        /*-------------------------------------------------
+        Frames may be waiting on the TX rate limiter
+        -------------------------------------------------*/
+        events |= SVC_EVT_TX_ENQUEUE;
+        updateStats();
       }
 
       /*-----------------------------------------------------------------------
-      Another thread may have woken this one to process new frame queue data.
-      Check if any is available. Handle RX first to keep the HW FIFOs empty.
+      Move queued frames onto the radio
       -----------------------------------------------------------------------*/
-      processRXQueue();
-      processTXQueue();
+      if ( events & SVC_EVT_TX_ENQUEUE )
+      {
+        processTXQueue();
+      }
 
       /*-----------------------------------------------------------------------
-      Calculate performance metrics
+      A pass that ran long was holding off the radio the whole time
       -----------------------------------------------------------------------*/
-      updateStats();
-      mLastActive = Chimera::millis();
+      if ( mProfile.endWork() )
+      {
+        mCBService_registry.call<CallbackId::CB_SERVICE_OVERRUN>();
+      }
     }
   }
 
@@ -499,7 +1199,9 @@ namespace Ripple::NetIf::NRF24::DataLink
     }
 
     /*-------------------------------------------------
-    Open each endpoint with the new addresses
+    Open each endpoint with the new addresses. Pipe 0
+    listens on the shared discovery address whenever
+    it isn't needed for ACKs.
     -------------------------------------------------*/
     Chimera::Status_t result = Chimera::Status::OK;
     for ( size_t ep = 0; ep < ARRAY_COUNT( sEndpointPipes ); ep++ )
@@ -507,6 +1209,8 @@ namespace Ripple::NetIf::NRF24::DataLink
       result |= Physical::openReadPipe( mPhyHandle, sEndpointPipes[ ep ], mEndpointMAC[ ep ] );
     }
 
+    result |= Physical::openReadPipe( mPhyHandle, PIPE_TX, DISCOVERY_MAC );
+
     /*-------------------------------------------------
     Officially assign the address if all good
     -------------------------------------------------*/
@@ -537,514 +1241,2360 @@ namespace Ripple::NetIf::NRF24::DataLink
   }
 
 
-  void DataLink::assignConfig( Physical::Handle &handle )
+  Chimera::Status_t DataLink::requestChannelHop( const Physical::RFChannel channel )
   {
-    mPhyHandle = handle;
-  }
-
+    using namespace Chimera::Thread;
 
-  /*-------------------------------------------------------------------------------
-  Service: Protected Methods
-  -------------------------------------------------------------------------------*/
-  Chimera::Status_t DataLink::powerUpRadio( Physical::Handle &handle )
-  {
     /*-------------------------------------------------
-    Input Protection
+    Input Protections
     -------------------------------------------------*/
-    auto result = initPeripherals( handle );
-    if ( result != Chimera::Status::OK )
+    if ( channel > Physical::MAX_RF_CHANNEL )
     {
-      return result;
+      return Chimera::Status::INVAL_FUNC_PARAM;
     }
-    else
+    else if ( channel == mPhyHandle.cfg.hwRFChannel )
     {
-      mPhyHandle = handle;
+      return Chimera::Status::OK;
     }
 
     /*-------------------------------------------------
-    Clear all memory
+    Find everyone that needs to hear about the move
     -------------------------------------------------*/
-    mTXQueue.clear();
-    mRXQueue.clear();
+    IPAddress nodeList[ ARP_CACHE_TABLE_ELEMENTS ];
+    size_t numNodes = 0;
+    {
+      LockGuard _lock( *this );
+      numNodes = mAddressCache.nodes( nodeList, ARRAY_COUNT( nodeList ) );
+    }
 
     /*-------------------------------------------------
-    Configure the hardware resources
+    Queue one announcement per node. All or nothing, so
+    a partial announcement can't split the network.
     -------------------------------------------------*/
-    LOG_ERROR_IF( ( Physical::powerUpDrivers( mPhyHandle ) != Chimera::Status::OK ), "Failed RF24 HW driver init\r\n" );
+    ChannelHopMsg msg;
+    msg.id       = NET_SVC_CHANNEL_HOP;
+    msg.channel  = channel;
+    msg.delay_ms = static_cast<uint16_t>( NRF_LINK_CHANNEL_HOP_DELAY_MS );
+
+    LockGuard txLock( mTXMutex );
+    FrameRingBase &queue = *mTXQueue[ TC_CONTROL ];
+    if ( queue.available() < numNodes )
+    {
+      return Chimera::Status::FULL;
+    }
 
-    /*-------------------------------------------------
-    GPIO interrupt configuration
-    -------------------------------------------------*/
-    auto cb = Chimera::Function::vGeneric::create<DataLink, &DataLink::irqPinAsserted>( *this );
-    result |= mPhyHandle.irqPin->attachInterrupt( cb, mPhyHandle.cfg.irqEdge );
+    for ( size_t idx = 0; idx < numNodes; idx++ )
+    {
+      Frame *slot = queue.reserve();
+      initTXFrame( *slot, nodeList[ idx ], mPhyHandle );
+      slot->wireData.control.totalFrames = 1;
+      slot->wireData.control.endpoint    = Endpoint::EP_NETWORK_SERVICES;
+      slot->writeUserData( &msg, sizeof( msg ) );
 
-    /*-------------------------------------------------
-    Reset the device to power on conditions
-    -------------------------------------------------*/
-    result |= Physical::openDevice( mPhyHandle.cfg, mPhyHandle );
-    result |= Physical::resetRegisterDefaults( mPhyHandle );
+      queue.commit();
+    }
 
     /*-------------------------------------------------
-    Apply basic global user settings
+    Follow along once the announcements have gone out
     -------------------------------------------------*/
-    result |= Physical::setCRCLength( mPhyHandle, mPhyHandle.cfg.hwCRCLength );
-    result |= Physical::setAddressWidth( mPhyHandle, mPhyHandle.cfg.hwAddressWidth );
-    result |= Physical::setISRMasks( mPhyHandle, mPhyHandle.cfg.hwISRMask );
-    result |= Physical::setRFChannel( mPhyHandle, mPhyHandle.cfg.hwRFChannel );
-    result |= Physical::setRFPower( mPhyHandle, mPhyHandle.cfg.hwPowerAmplitude );
-    result |= Physical::setDataRate( mPhyHandle, mPhyHandle.cfg.hwDataRate );
+    this->lock();
+    mHopCB.pending = true;
+    mHopCB.channel = channel;
+    mHopCB.start   = Chimera::millis();
+    mHopCB.delay   = NRF_LINK_CHANNEL_HOP_DELAY_MS;
+    this->unlock();
 
-    /* Allow the network driver to decide at runtime if a packet requires an ACK response */
-    result |= Physical::toggleDynamicAck( mPhyHandle, true );
-    result |= Physical::toggleAutoAck( mPhyHandle, true, Physical::PIPE_NUM_ALL );
+    signalEvent( SVC_EVT_TX_ENQUEUE );
+    return Chimera::Status::OK;
+  }
 
-    /* Static/Dynamic Payloads */
-    if ( mPhyHandle.cfg.hwStaticPayloadWidth )
-    {
-      result |= Physical::toggleDynamicPayloads( mPhyHandle, Physical::PIPE_NUM_ALL, false );
-      result |= Physical::setStaticPayloadSize( mPhyHandle, mPhyHandle.cfg.hwStaticPayloadWidth, Physical::PIPE_NUM_ALL );
-    }
-    else
-    {
-      result |= Physical::toggleDynamicPayloads( mPhyHandle, Physical::PIPE_NUM_ALL, true );
-    }
 
-    /*-------------------------------------------------
-    Flush hardware FIFOs to clear pre-existing data
-    -------------------------------------------------*/
-    result |= Physical::flushRX( mPhyHandle );
-    result |= Physical::flushTX( mPhyHandle );
+  void DataLink::getChannelSurvey( ChannelSurvey &survey )
+  {
+    Chimera::Thread::LockGuard _lock( *this );
+    survey = mSurvey;
+  }
+
+
+  void DataLink::assignConfig( Physical::Handle &handle )
+  {
+    mPhyHandle = handle;
+  }
+
+
+  size_t DataLink::txQueueDepth( const TrafficClass tc ) const
+  {
+    return ( tc < TC_NUM_OPTIONS ) ? mTXQueue[ tc ]->size() : 0;
+  }
+
+
+  size_t DataLink::txQueueSpace( const TrafficClass tc ) const
+  {
+    return ( tc < TC_NUM_OPTIONS ) ? mTXQueue[ tc ]->available() : 0;
+  }
+
+
+  void DataLink::setDedicatedRX( const bool enable )
+  {
+    mDedicatedRX = enable;
+  }
+
+
+  Chimera::Status_t DataLink::saveSession( ISessionStore &store, const IPAddress coordinator )
+  {
+    LinkSession session;
+    memset( &session, 0, sizeof( session ) );
 
     /*-------------------------------------------------
-    Initialize the FSM controller
+    The coordinator goes first, so it survives even if
+    the cache holds more nodes than the snapshot can
     -------------------------------------------------*/
-    _fsmStateList[ Physical::FSM::StateId::POWERED_OFF ] = &_fsmState_PoweredOff;
-    _fsmStateList[ Physical::FSM::StateId::STANDBY_1 ]   = &_fsmState_Standby1;
-    _fsmStateList[ Physical::FSM::StateId::RX_MODE ]     = &_fsmState_RXMode;
-    _fsmStateList[ Physical::FSM::StateId::TX_MODE ]     = &_fsmState_TXMode;
+    IPAddress nodeList[ ARP_CACHE_TABLE_ELEMENTS ];
+    {
+      Chimera::Thread::LockGuard lck( *this );
 
-    mFSMControl.mHandle = &mPhyHandle;
-    mFSMControl.set_states( _fsmStateList, std::size( _fsmStateList ) );
-    mFSMControl.start();
+      Physical::MACAddress mac = 0;
+      if ( !mContext || !mAddressCache.lookup( coordinator, &mac ) )
+      {
+        return Chimera::Status::NOT_FOUND;
+      }
+
+      session.ip                 = mContext->getIPAddress();
+      session.coordinator        = coordinator;
+      session.rootMAC            = mPhyHandle.cfg.hwAddress;
+      session.channel            = mPhyHandle.cfg.hwRFChannel;
+      session.neighbors[ 0 ].ip  = coordinator;
+      session.neighbors[ 0 ].mac = mac;
+      session.numNeighbors       = 1;
+
+      const size_t count = mAddressCache.nodes( nodeList, ARRAY_COUNT( nodeList ) );
+      for ( size_t idx = 0; ( idx < count ) && ( session.numNeighbors < SESSION_NEIGHBORS ); idx++ )
+      {
+        SessionNeighbor &entry = session.neighbors[ session.numNeighbors ];
+        if ( ( nodeList[ idx ] != coordinator ) && mAddressCache.lookup( nodeList[ idx ], &entry.mac ) )
+        {
+          entry.ip = nodeList[ idx ];
+          session.numNeighbors++;
+        }
+      }
+    }
 
     /*-------------------------------------------------
-    Record the final power up status
+    Seal the snapshot so a torn write is never resumed
     -------------------------------------------------*/
-    LOG_ERROR_IF( ( result != Chimera::Status::OK ), "Failed RF24 power up sequence\r\n" );
+    CRC32 crc;
+    crc.add( &session.ip, sizeof( session ) - offsetof( LinkSession, ip ) );
+    session.magic = SESSION_MAGIC;
+    session.crc   = crc.value();
 
-    return result;
+    return store.save( &session, sizeof( session ) ) ? Chimera::Status::OK : Chimera::Status::FAIL;
   }
 
 
-  Chimera::Status_t DataLink::initPeripherals( Physical::Handle &handle )
+  bool DataLink::resumeSession( ISessionStore &store, const size_t timeout )
   {
-    auto result = Chimera::Status::OK;
+    using namespace Aurora::Logging;
 
     /*-------------------------------------------------
-    Discrete GPIO: Chip Enable Pin
+    Only a whole snapshot from this build is usable
     -------------------------------------------------*/
-    handle.cePin = Chimera::GPIO::getDriver( handle.cfg.ce.port, handle.cfg.ce.pin );
-    result |= handle.cePin->init( handle.cfg.ce );
+    LinkSession session;
+    if ( !mContext || !store.load( &session, sizeof( session ) ) || ( session.magic != SESSION_MAGIC ) ||
+         ( session.numNeighbors > SESSION_NEIGHBORS ) )
+    {
+      return false;
+    }
+
+    CRC32 crc;
+    crc.add( &session.ip, sizeof( session ) - offsetof( LinkSession, ip ) );
+    if ( crc.value() != session.crc )
+    {
+      LOG_WARN_IF( DEBUG_MODULE, "NRF24 session snapshot is corrupted\r\n" );
+      return false;
+    }
 
     /*-------------------------------------------------
-    Discrete GPIO: IRQ Pin
+    Put back the identity and the neighbors
     -------------------------------------------------*/
-    handle.irqPin = Chimera::GPIO::getDriver( handle.cfg.irq.port, handle.cfg.irq.pin );
-    result |= handle.irqPin->init( handle.cfg.irq );
+    mContext->setIPAddress( session.ip );
+    if ( session.rootMAC && ( session.rootMAC != mPhyHandle.cfg.hwAddress ) )
+    {
+      setRootMAC( session.rootMAC );
+    }
+
+    for ( size_t idx = 0; idx < session.numNeighbors; idx++ )
+    {
+      const SessionNeighbor &entry = session.neighbors[ idx ];
+      addARPEntry( entry.ip, &entry.mac, sizeof( entry.mac ) );
+      mARPPending.markReachable( entry.ip );
+    }
 
     /*-------------------------------------------------
-    SPI: Chip Select Pin
+    Move to the network's channel without announcing
+    it. The service thread makes the move.
     -------------------------------------------------*/
-    handle.csPin = Chimera::GPIO::getDriver( handle.cfg.spi.CSInit.port, handle.cfg.spi.CSInit.pin );
-    result |= handle.csPin->init( handle.cfg.spi.CSInit );
+    this->lock();
+    if ( session.channel != mPhyHandle.cfg.hwRFChannel )
+    {
+      mHopCB.pending = true;
+      mHopCB.channel = session.channel;
+      mHopCB.start   = Chimera::millis();
+      mHopCB.delay   = 0;
+    }
+    this->unlock();
+    signalEvent( SVC_EVT_TX_ENQUEUE );
 
     /*-------------------------------------------------
-    SPI: Protocol Settings
+    Ask the coordinator directly until it answers. It
+    learns this node's mapping from the request.
     -------------------------------------------------*/
-    handle.spi = Chimera::SPI::getDriver( handle.cfg.spi.HWInit.hwChannel );
-    result |= handle.spi->init( handle.cfg.spi );
+    mSessionCB.confirmed.store( false );
+    mSessionCB.coordinator.store( session.coordinator );
 
-    RT_HARD_ASSERT( result == Chimera::Status::OK );
-    return result;
-  }
+    const size_t start = Chimera::millis();
+    size_t lastRequest = 0;
+    bool requested     = false;
 
+    while ( !mSessionCB.confirmed.load() && ( ( Chimera::millis() - start ) < timeout ) )
+    {
+      this->lock();
+      const bool moved = !mHopCB.pending;
+      this->unlock();
 
-  void DataLink::irqPinAsserted( void *arg )
-  {
-    using namespace Chimera::Thread;
+      if ( moved && ( !requested || ( ( Chimera::millis() - lastRequest ) >= NRF_LINK_RESUME_RETRY_MS ) ) &&
+           sendARPMessage( NET_SVC_ARP_REQUEST, session.coordinator, true ) )
+      {
+        requested   = true;
+        lastRequest = Chimera::millis();
+      }
 
-    /*-------------------------------------------------------------------------
-    Let user space thread know it has an event to process. Unsure what kind.
-    -------------------------------------------------------------------------*/
-    if ( mSystemEnabled )
+      Chimera::delayMilliseconds( 1 );
+    }
+
+    const bool confirmed = mSessionCB.confirmed.load();
+    mSessionCB.reset();
+
+    /*-------------------------------------------------
+    Nobody home. Fall back on resolving by broadcast.
+    -------------------------------------------------*/
+    if ( !confirmed )
     {
-      pendingEvent = true;
-      sendTaskMsg( mTaskId, TSK_MSG_WAKEUP, TIMEOUT_DONT_WAIT );
+      for ( size_t idx = 0; idx < session.numNeighbors; idx++ )
+      {
+        dropARPEntry( session.neighbors[ idx ].ip );
+      }
+
+      LOG_INFO( "NRF24 coordinator %d didn't answer, rejoining cold\r\n", session.coordinator );
+      return false;
     }
+
+    LOG_INFO( "NRF24 resumed session with coordinator %d in %dms\r\n", session.coordinator, Chimera::millis() - start );
+    return true;
   }
 
 
-  void DataLink::processTXSuccess()
+  void DataLink::setTimeMaster( const bool enable )
   {
-    /*-------------------------------------------------------------------------
-    Ack the success
-    -------------------------------------------------------------------------*/
-    mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
-    Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_TX_DS );
-    mTCB.inProgress = false;
-
-    /*-------------------------------------------------------------------------
-    Remove the now TX'd data off the queue
-    -------------------------------------------------------------------------*/
-    mTXMutex.lock();
-    mTXQueue.pop();
-    mTXMutex.unlock();
-
-    /*-------------------------------------------------------------------------
-    Update runtime stats
-    -------------------------------------------------------------------------*/
+    /*-------------------------------------------------
+    A new master beacons straight away rather than
+    waiting out a whole period
+    -------------------------------------------------*/
     this->lock();
-    mStats.tx_bytes += sizeof( PackedFrame );
-    mStats.frame_tx += 1;
+    mTimeSync.setMaster( enable, mContext ? mContext->getIPAddress() : 0 );
+    mLastBeacon = Chimera::millis() - NRF_LINK_TIME_SYNC_PERIOD_MS;
     this->unlock();
 
-    /*-------------------------------------------------------------------------
-    Notify the network layer of the success
-    -------------------------------------------------------------------------*/
-    mCBService_registry.call<CallbackId::CB_TX_SUCCESS>();
-    LOG_TRACE_IF( DEBUG_MODULE, "Transmit Success\r\n" );
+    signalEvent( SVC_EVT_TIMER );
   }
 
 
-  void DataLink::processTXFail()
+  void DataLink::getTimeSyncStatus( TimeSyncStatus &status )
   {
-    /*-------------------------------------------------------------------------
-    Dump the unsuccessful frame from the queue
-    -------------------------------------------------------------------------*/
-    Frame failedFrame;
-
-    mTXMutex.lock();
-    mTXQueue.pop_into( failedFrame );
-    mTXMutex.unlock();
-
-    /*-------------------------------------------------------------------------
-    Update stats
-    -------------------------------------------------------------------------*/
     this->lock();
-    mStats.frame_tx_fail += 1;
+    mTimeSync.getStatus( status );
     this->unlock();
+  }
 
-    /*-------------------------------------------------------------------------
-    Transition back to an idle state
-    -------------------------------------------------------------------------*/
-    mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
-    mTCB.inProgress = false;
 
-    /*-------------------------------------------------------------------------------
-    One reason why a TX fail event must be processed is due to a max retry IRQ. In
-    this case, the data is not removed from the TX FIFO, so it must be done manually.
-    (RM 8.4) First transition back to Standby-1 mode, then clear event flags and flush
-    the TX FIFO. Otherwise, the IRQ will continuously fire.
-    -------------------------------------------------------------------------------*/
-    if ( failedFrame.wireData.control.requireACK )
+  Chimera::Status_t DataLink::assignTDMASlot( const IPAddress node, const uint8_t slot, const uint8_t numSlots,
+                                              const uint32_t slot_us )
+  {
+    /*-------------------------------------------------
+    Catch a bad schedule here rather than on the node
+    -------------------------------------------------*/
+    TDMASchedule check;
+    if ( !check.configure( slot, numSlots, slot_us, TDMA_GUARD_US ) )
     {
-      Physical::flushTX( mPhyHandle );
-      Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_MAX_RT );
+      return Chimera::Status::INVAL_FUNC_PARAM;
     }
-    // else NO_ACK, which means there is nothing to clear. The data was lost to the ether.
 
-    /*-------------------------------------------------------------------------
-    Notify the network layer of the failed frame
-    -------------------------------------------------------------------------*/
-    mCBService_registry.call<CallbackId::CB_ERROR_TX_FAILURE>();
+    /*-------------------------------------------------
+    The coordinator's own slot takes effect right away
+    -------------------------------------------------*/
+    if ( mContext && ( node == mContext->getIPAddress() ) )
+    {
+      this->lock();
+      mTDMA.configure( slot, numSlots, slot_us, TDMA_GUARD_US );
+      this->unlock();
 
-    /*-------------------------------------------------------------------------
-    QOS: Retransmit the frame, using a backoff strategy.
+      signalEvent( SVC_EVT_TX_ENQUEUE );
+      return Chimera::Status::OK;
+    }
+
+    return sendTDMASlot( node, slot, numSlots, slot_us ) ? Chimera::Status::OK : Chimera::Status::FULL;
+  }
+
+
+  void DataLink::getTDMAStatus( TDMAStatus &status )
+  {
+    this->lock();
+    mTDMA.getStatus( status );
+    this->unlock();
+  }
+
+
+  Chimera::Status_t DataLink::bindAckPayloadPipe( const IPAddress &node, const Physical::PipeNumber pipe )
+  {
+    /*-------------------------------------------------
+    Input Protection
+    -------------------------------------------------*/
+    if ( pipe >= Physical::PIPE_NUM_ALL )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+    else if ( !mPhyHandle.cfg.ackPayloads )
+    {
+      return Chimera::Status::NOT_SUPPORTED;
+    }
+
+    /*-------------------------------------------------
+    A node may only be bound to a single pipe, else the
+    staged frames could be collected out of order.
+    -------------------------------------------------*/
+    Chimera::Thread::LockGuard lck( *this );
+
+    const auto existing = mACB.find( node );
+    if ( ( existing != Physical::PIPE_INVALID ) && ( existing != pipe ) )
+    {
+      mACB.route[ existing ].bound = false;
+    }
+
+    mACB.route[ pipe ].bound = true;
+    mACB.route[ pipe ].node  = node;
+
+    return Chimera::Status::OK;
+  }
+
+
+  void DataLink::unbindAckPayloadPipe( const Physical::PipeNumber pipe )
+  {
+    if ( pipe < Physical::PIPE_NUM_ALL )
+    {
+      Chimera::Thread::LockGuard lck( *this );
+      mACB.route[ pipe ].bound = false;
+    }
+  }
+
+
+  Chimera::Status_t DataLink::addRoute( const IPAddress &destination, const IPAddress &nextHop )
+  {
+    /*-------------------------------------------------
+    Input Protection
+    -------------------------------------------------*/
+    if ( destination == nextHop )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+
+    /*-------------------------------------------------
+    Each destination must have its own id on air
+    -------------------------------------------------*/
+    Chimera::Thread::LockGuard lck( *this );
+
+    const ForwardRoute *existing = mForwardTable.findById( forwardId( destination ) );
+    if ( existing && ( existing->destination != destination ) )
+    {
+      LOG_ERROR( "Route to %08X collides with the one to %08X\r\n", destination, existing->destination );
+      return Chimera::Status::FAIL;
+    }
+
+    return mForwardTable.insert( destination, nextHop ) ? Chimera::Status::OK : Chimera::Status::FULL;
+  }
+
+
+  void DataLink::dropRoute( const IPAddress &destination )
+  {
+    Chimera::Thread::LockGuard lck( *this );
+    mForwardTable.remove( destination );
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: Protected Methods
+  -------------------------------------------------------------------------------*/
+  Chimera::Status_t DataLink::powerUpRadio( Physical::Handle &handle )
+  {
+    /*-------------------------------------------------
+    Input Protection
+    -------------------------------------------------*/
+    auto result = initPeripherals( handle );
+    if ( result != Chimera::Status::OK )
+    {
+      return result;
+    }
+    else
+    {
+      mPhyHandle = handle;
+    }
+
+    /*-------------------------------------------------
+    Clear all memory
+    -------------------------------------------------*/
+    for ( auto queue : mTXQueue )
+    {
+      queue->clear();
+    }
+    mTXClass = TC_DEFAULT;
+    mRXQueue.clear();
+    mRXReserved     = nullptr;
+    mACB.stagedPipe = Physical::PIPE_INVALID;
+    mACB.staged     = 0;
+    mARPPending.clear();
+    mMulticastHistory.reset();
+
+    /*-------------------------------------------------
+    Configure the hardware resources
+    -------------------------------------------------*/
+    LOG_ERROR_IF( ( Physical::powerUpDrivers( mPhyHandle ) != Chimera::Status::OK ), "Failed RF24 HW driver init\r\n" );
+
+    /*-------------------------------------------------
+    GPIO interrupt configuration
+    -------------------------------------------------*/
+    auto cb = Chimera::Function::vGeneric::create<DataLink, &DataLink::irqPinAsserted>( *this );
+    result |= mPhyHandle.irqPin->attachInterrupt( cb, mPhyHandle.cfg.irqEdge );
+
+    /*-------------------------------------------------
+    Bring the registers up from a single image of the
+    user configuration, written in one queued run and
+    checked in one read pass. A radio that kept power
+    through an MCU reset only gets what changed.
+    -------------------------------------------------*/
+    result |= Physical::openDevice( mPhyHandle.cfg, mPhyHandle );
+
+    Physical::RegisterImage image;
+    result |= Physical::buildRegisterImage( mPhyHandle.cfg, image );
+    result |= Physical::applyRegisterImage( mPhyHandle, image, mPhyHandle.cfg.fastResume );
+
+    /*-------------------------------------------------
+    Flush hardware FIFOs to clear pre-existing data
+    -------------------------------------------------*/
+    result |= Physical::flushRX( mPhyHandle );
+    result |= Physical::flushTX( mPhyHandle );
+
+    /*-------------------------------------------------
+    Initialize the FSM controller
+    -------------------------------------------------*/
+    _fsmStateList[ Physical::FSM::StateId::POWERED_OFF ] = &_fsmState_PoweredOff;
+    _fsmStateList[ Physical::FSM::StateId::STANDBY_1 ]   = &_fsmState_Standby1;
+    _fsmStateList[ Physical::FSM::StateId::RX_MODE ]     = &_fsmState_RXMode;
+    _fsmStateList[ Physical::FSM::StateId::TX_MODE ]     = &_fsmState_TXMode;
+
+    mFSMControl.mHandle = &mPhyHandle;
+    mFSMControl.set_states( _fsmStateList, std::size( _fsmStateList ) );
+    mFSMControl.start();
+
+    /*-------------------------------------------------
+    Record the final power up status
+    -------------------------------------------------*/
+    LOG_ERROR_IF( ( result != Chimera::Status::OK ), "Failed RF24 power up sequence\r\n" );
+
+    return result;
+  }
+
+
+  Chimera::Status_t DataLink::initPeripherals( Physical::Handle &handle )
+  {
+    auto result = Chimera::Status::OK;
+
+    /*-------------------------------------------------
+    Discrete GPIO: Chip Enable Pin
+    -------------------------------------------------*/
+    handle.cePin = Chimera::GPIO::getDriver( handle.cfg.ce.port, handle.cfg.ce.pin );
+    result |= handle.cePin->init( handle.cfg.ce );
+
+    /*-------------------------------------------------
+    Discrete GPIO: IRQ Pin
+    -------------------------------------------------*/
+    handle.irqPin = Chimera::GPIO::getDriver( handle.cfg.irq.port, handle.cfg.irq.pin );
+    result |= handle.irqPin->init( handle.cfg.irq );
+
+    /*-------------------------------------------------
+    SPI: Chip Select Pin
+    -------------------------------------------------*/
+    handle.csPin = Chimera::GPIO::getDriver( handle.cfg.spi.CSInit.port, handle.cfg.spi.CSInit.pin );
+    result |= handle.csPin->init( handle.cfg.spi.CSInit );
+
+    /*-------------------------------------------------
+    SPI: Protocol Settings
+    -------------------------------------------------*/
+    handle.spi = Chimera::SPI::getDriver( handle.cfg.spi.HWInit.hwChannel );
+    result |= handle.spi->init( handle.cfg.spi );
+
+    RT_HARD_ASSERT( result == Chimera::Status::OK );
+    return result;
+  }
+
+
+  void DataLink::irqPinAsserted( void *arg )
+  {
+    using namespace Chimera::Thread;
+
+    /*-------------------------------------------------------------------------
+    Let user space thread know it has an event to process. Unsure what kind.
+    Stamp first, the clock sync wants the edge as close to the air as it gets.
+    -------------------------------------------------------------------------*/
+    mLastIRQ_us.store( static_cast<uint32_t>( Chimera::micros() ) );
+    mIRQSeq.fetch_add( 1u );
+    RIPPLE_TRACE( TRC_IRQ, 0, mSystemEnabled );
+    if ( mSystemEnabled )
+    {
+      signalEvent( SVC_EVT_RADIO_IRQ );
+    }
+  }
+
+
+  void DataLink::processTXSuccess()
+  {
+    /*-------------------------------------------------------------------------
+    Nothing to retire? Either an ACK payload went out while listening, or the
+    IRQ is stale from a previous flush.
+    -------------------------------------------------------------------------*/
+    if ( !mTCB.inProgress() )
+    {
+      Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_TX_DS );
+      if ( mACB.staged )
+      {
+        processAckSent();
+      }
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Determine how many frames completed. The hardware only latches a single
+    TX_DS flag no matter how many frames left, so compare what was loaded
+    against what is still sitting in the FIFO.
+    -------------------------------------------------------------------------*/
+    const bool fifoEmpty = Physical::txFifoEmpty( mPhyHandle );
+    const size_t retired = txFramesDone( fifoEmpty );
+
+    /*-------------------------------------------------------------------------
+    Ack the success. Only leave TX mode once the FIFO has drained, else the
+    frames still queued in hardware would stall.
+    -------------------------------------------------------------------------*/
+    if ( fifoEmpty )
+    {
+      mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
+    }
+    Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_TX_DS );
+
+    /*-------------------------------------------------------------------------
+    A full FIFO means nothing left since the frames were loaded, so the event
+    was left over from before they went in.
+    -------------------------------------------------------------------------*/
+    if ( !retired )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    OBSERVE_TX only reports on the most recent packet, so every retired frame
+    shares its retry count. Frames in one burst go to the same node anyway.
+    -------------------------------------------------------------------------*/
+    uint8_t retries = 0;
+    Physical::getTXObserve( mPhyHandle, nullptr, &retries );
+
+    /*-------------------------------------------------------------------------
+    Retire the now TX'd frames in the order they were loaded. Frames in flight
+    sit at the front of the TX queue, so retiring releases their slots. This
+    thread is the only consumer, so no lock is needed against the producers.
+    -------------------------------------------------------------------------*/
+    const size_t now     = Chimera::millis();
+    bool followUp        = false;
+    uint8_t followUpSeq  = 0;
+    uint64_t followUp_us = 0;
+
+    for ( size_t x = 0; x < retired; x++ )
+    {
+      /*-----------------------------------------------------------------------
+      An ACK proves the next hop is there, so busy neighbors never need a
+      keepalive of their own.
+      -----------------------------------------------------------------------*/
+      const _pfCtrl &control = txQueue().front().wireData.control;
+      RIPPLE_TRACE( TRC_FRAME_TX_ACK, control.uuid, txQueue().front().frameNumber() );
+
+      if ( control.requireACK )
+      {
+        mLinkEstimator.onSuccess( txQueue().front().nextHop, retries );
+        mLiveness.onHeard( txQueue().front().nextHop, now );
+      }
+
+      /*-----------------------------------------------------------------------
+      A sync beacon left when this IRQ fired, but only if it was the last
+      frame out. Anything earlier in the burst left at some unknown time.
+      -----------------------------------------------------------------------*/
+      if ( ( control.endpoint == Endpoint::EP_NETWORK_SERVICES ) && ( x == ( retired - 1u ) ) )
+      {
+        TimeSyncMsg msg;
+        const uint32_t irq_us = mLastIRQ_us.load();
+        const size_t msgSize  = txQueue().front().readUserData( &msg, sizeof( msg ) );
+        const bool isSync     = ( msgSize == sizeof( msg ) ) && ( msg.id == NET_SVC_TIME_SYNC );
+
+        if ( isSync && ( static_cast<int32_t>( irq_us - mTCB.oldest().loaded_us ) >= 0 ) )
+        {
+          this->lock();
+          followUp    = mTimeSync.toGlobal( mTimeSync.extend( irq_us ), followUp_us );
+          followUpSeq = msg.seq;
+          this->unlock();
+        }
+      }
+
+      mLatency.recordSince( LAT_LINK_AIR, mTCB.oldest().loaded_us );
+      txQueue().pop();
+      mTCB.release();
+    }
+
+    if ( followUp )
+    {
+      sendTimeMessage( NET_SVC_TIME_FOLLOW_UP, followUpSeq, followUp_us );
+    }
+
+    /*-------------------------------------------------------------------------
+    The remote node may have returned data inside the ACK. It lands in the RX
+    FIFO, so pass it up through the normal RX queue.
+    -------------------------------------------------------------------------*/
+    if ( mPhyHandle.cfg.ackPayloads && !Physical::rxFifoEmpty( mPhyHandle ) )
+    {
+      mRXStampValid = false;
+      auto handler  = Physical::RXPayloadHandler::create<DataLink, &DataLink::enqueueRXPayload>( *this );
+      auto provider = Physical::RXBufferProvider::create<DataLink, &DataLink::reserveRXPayload>( *this );
+      Physical::drainRXFifo( mPhyHandle, mPhyHandle.cfg.hwStaticPayloadWidth, handler, &provider );
+      Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_RX_DR );
+    }
+
+    /*-------------------------------------------------------------------------
+    Update runtime stats
+    -------------------------------------------------------------------------*/
+    TrafficCounters::add( mCounters.tx_bytes, Physical::MAX_SPI_DATA_LEN * retired );
+    TrafficCounters::add( mCounters.frame_tx, retired );
+    mLastActive = now;
+
+    /*-------------------------------------------------------------------------
+    Notify the network layer of the success
+    -------------------------------------------------------------------------*/
+    mCBService_registry.call<CallbackId::CB_TX_SUCCESS>();
+    LOG_TRACE_IF( DEBUG_MODULE, "Transmit Success\r\n" );
+  }
+
+
+  size_t DataLink::txFramesDone( const bool fifoEmpty )
+  {
+    if ( fifoEmpty )
+    {
+      return mTCB.inFlight;
+    }
+
+    /*-------------------------------------------------------------------------
+    FIFO_STATUS only flags empty or full, so a partly drained FIFO holds at
+    most one less than it can. The TX_DS event proves at least one frame has
+    gone too, which pins the count down exactly with up to two in flight. With
+    three in flight and two gone at once this comes up one short, and the
+    next event or an empty FIFO retires the straggler.
+    -------------------------------------------------------------------------*/
+    size_t remaining = Physical::MAX_TX_FIFO_DEPTH;
+    if ( !Physical::txFifoFull( mPhyHandle ) )
+    {
+      remaining = std::min<size_t>( Physical::MAX_TX_FIFO_DEPTH - 1u, mTCB.inFlight ? ( mTCB.inFlight - 1u ) : 0u );
+    }
+
+    return ( mTCB.inFlight > remaining ) ? ( mTCB.inFlight - remaining ) : 0u;
+  }
+
+
+  void DataLink::processTXFail()
+  {
+    /*-------------------------------------------------------------------------
+    The hardware stalls on the oldest un-acknowledged frame, so that is the
+    one that failed. Everything loaded behind it never had a chance to go out.
+    -------------------------------------------------------------------------*/
+    if ( !mTCB.inProgress() )
+    {
+      mTCB.releaseAll();
+      return;
+    }
+
+    Frame &failedFrame = txQueue().front();
+    mTCB.release();
+    RIPPLE_TRACE( TRC_FRAME_TX_FAIL, failedFrame.wireData.control.uuid, failedFrame.frameNumber() );
+
+    /*-------------------------------------------------------------------------
+    Update stats
+    -------------------------------------------------------------------------*/
+    TrafficCounters::add( mCounters.frame_tx_fail );
+
+    if ( failedFrame.wireData.control.requireACK )
+    {
+      mLinkEstimator.onFailure( failedFrame.nextHop );
+    }
+
+    /*-------------------------------------------------------------------------
+    Transition back to an idle state
+    -------------------------------------------------------------------------*/
+    mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
+
+    /*-------------------------------------------------------------------------------
+    One reason why a TX fail event must be processed is due to a max retry IRQ. In
+    this case, the data is not removed from the TX FIFO, so it must be done manually.
+    (RM 8.4) First transition back to Standby-1 mode, then clear event flags and flush
+    the TX FIFO. Otherwise, the IRQ will continuously fire. Any frames queued behind
+    the failed one must be dumped too.
+    -------------------------------------------------------------------------------*/
+    if ( failedFrame.wireData.control.requireACK || mTCB.inProgress() )
+    {
+      Physical::flushTX( mPhyHandle );
+      Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_MAX_RT );
+    }
+    // else NO_ACK, which means there is nothing to clear. The data was lost to the ether.
+
+    /*-------------------------------------------------------------------------
+    The failed frame and those flushed from behind it are still at the front
+    of the TX queue. Marking them as no longer loaded sends them again next,
+    and only the failed frame counts against the retry limit. A frame whose TX_DS raced the
+    flush may be sent twice, which the reassembly stage already tolerates.
+    -------------------------------------------------------------------------*/
+    mTCB.releaseAll();
+
+    /*-------------------------------------------------------------------------
+    Notify the network layer of the failed frame
+    -------------------------------------------------------------------------*/
+    mCBService_registry.call<CallbackId::CB_ERROR_TX_FAILURE>();
+
+    /*-------------------------------------------------------------------------
+    QOS: Retransmit the frame. The estimator already backed off the link.
+    -------------------------------------------------------------------------*/
+    this->retransmitFrame();
+  }
+
+
+  void DataLink::processTXQueue()
+  {
+    using namespace Aurora::Logging;
+    using namespace Chimera::Thread;
+
+    mTDMAHold_us = 0;
+
+    /*-------------------------------------------------------------------------
+    Can't load a new frame until a slot in the pipeline frees up
+    -------------------------------------------------------------------------*/
+    if ( mTCB.inFlight >= NRF_LINK_TX_PIPELINE_DEPTH )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Pick up the highest priority traffic while the radio is free to switch
+    -------------------------------------------------------------------------*/
+    if ( !mTCB.inProgress() && !mACB.staged )
+    {
+      const TrafficClass next = selectTXClass();
+      if ( next != TC_NUM_OPTIONS )
+      {
+        mTXClass = next;
+      }
+    }
+
+    if ( processAckQueue() )
+    {
+      return;
+    }
+
+    if ( !pendingTXFrames() )
+    {
+      /*-----------------------------------------------------------------------
+      Nothing to TX. Ensure hardware is listening once all frames are out.
+      -----------------------------------------------------------------------*/
+      if ( !mTCB.inProgress() )
+      {
+        mFSMControl.receive( Physical::FSM::MsgStartRX() );
+      }
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Rate limit the start of new transfers. Frames joining an ongoing transfer
+    are bounded by the radio itself. The limit follows the destination's link
+    quality, spacing out transfers to nodes that are struggling.
+    -------------------------------------------------------------------------*/
+    if ( !mTCB.inProgress() )
+    {
+      const TrafficClass next = selectTXClass();
+      const size_t offset     = ( next == mTXClass ) ? mACB.staged : 0;
+
+      mTCB.mTXRate_us = mLinkEstimator.lookup( mTXQueue[ next ]->peek( offset ).nextHop ).txRate_us;
+      if ( ( Chimera::micros() - mTCB.mLastTX_us ) < mTCB.mTXRate_us )
+      {
+        return;
+      }
+
+      /*-----------------------------------------------------------------------
+      Normal TX never waits on staged ACK payloads. They share the TX FIFO and
+      would go out as regular frames the moment TX mode starts, so take them
+      back out first. The radio can only flush the FIFO as a whole, but the
+      frames are still at the front of the queue and simply go out normally.
+      -----------------------------------------------------------------------*/
+      if ( mACB.staged )
+      {
+        evictAckPayloads();
+      }
+
+      mTXClass = next;
+    }
+
+    /*-------------------------------------------------------------------------
+    Keep the hardware FIFO loaded for as long as frames share a destination.
+    Higher priority traffic cuts the transfer short, so it never waits on more
+    than the frames already in flight.
+    -------------------------------------------------------------------------*/
+    FrameRingBase &queue = txQueue();
+    while ( ( queue.size() > mTCB.inFlight ) && ( mTCB.inFlight < NRF_LINK_TX_PIPELINE_DEPTH ) )
+    {
+      Frame &cacheFrame = queue.peek( mTCB.inFlight );
+
+      /*-----------------------------------------------------------------------
+      Apply the retry settings learned for this destination
+      -----------------------------------------------------------------------*/
+      if ( cacheFrame.wireData.control.requireACK )
+      {
+        const LinkEstimate est = mLinkEstimator.lookup( cacheFrame.nextHop );
+        cacheFrame.rtxDelay    = est.rtxDelay;
+        cacheFrame.rtxCount    = est.rtxCount;
+      }
+
+      /*-----------------------------------------------------------------------
+      On a slotted network the frame waits until it fits in this node's slot,
+      retries included
+      -----------------------------------------------------------------------*/
+      if ( tdmaHold( cacheFrame ) )
+      {
+        break;
+      }
+
+      if ( mTCB.inProgress() )
+      {
+        /*---------------------------------------------------------------------
+        The pipe address and retry settings are locked in while frames are in
+        flight. Wait for them to drain before switching to something else.
+        ---------------------------------------------------------------------*/
+        if ( !canShareTXFifo( queue.peek( mTCB.inFlight - 1 ), cacheFrame ) )
+        {
+          break;
+        }
+
+        bool preempted = false;
+        for ( size_t tc = TC_CONTROL; tc < mTXClass; tc++ )
+        {
+          preempted |= !mTXQueue[ tc ]->empty();
+        }
+
+        if ( preempted )
+        {
+          break;
+        }
+      }
+      else
+      {
+        /*---------------------------------------------------------------------
+        Look up the hardware address associated with the destination node. A
+        transfer continuing on to the same node reuses the last lookup, unless
+        the ARP cache changed in the meantime. Discovery traffic has a fixed
+        address instead.
+        ---------------------------------------------------------------------*/
+        const bool sameHop = mTCB.routeValid && ( mTCB.lastHop == cacheFrame.nextHop ) &&
+                             ( mTCB.arpGeneration == mAddressCache.generation() );
+
+        if ( !sameHop && !cacheFrame.wireData.control.multicast )
+        {
+          Physical::MACAddress deviceAddress = 0;
+          mTCB.routeValid = false;
+
+          this->lock();
+          const bool resolved = mAddressCache.lookup( cacheFrame.nextHop, &deviceAddress );
+          this->unlock();
+
+          /*-------------------------------------------------------------------
+          Unknown nodes get their frames parked while the address is resolved
+          -------------------------------------------------------------------*/
+          if ( !resolved )
+          {
+            LOG_DEBUG_IF( DEBUG_MODULE, "NRF24 ARP miss for next hop: %d\r\n", cacheFrame.nextHop );
+            parkTXFrame( cacheFrame );
+            queue.pop();
+            return;
+          }
+
+          mTCB.routeValid    = true;
+          mTCB.lastHop       = cacheFrame.nextHop;
+          mTCB.lastAddress   = deviceAddress;
+          mTCB.arpGeneration = mAddressCache.generation();
+        }
+
+        /*---------------------------------------------------------------------
+        Pick the pipe to send on. Pipes are balanced per packet rather than per
+        transfer, so every fragment of a packet sees the same TX address. With
+        the register shadow, reopening an unchanged pipe costs no SPI writes.
+        ---------------------------------------------------------------------*/
+        Physical::MACAddress dstAddress = DISCOVERY_MAC;
+        if ( !cacheFrame.wireData.control.multicast )
+        {
+          if ( !sameHop || ( mTCB.lastUuid != cacheFrame.wireData.control.uuid ) )
+          {
+            mTCB.lastUuid = cacheFrame.wireData.control.uuid;
+            nextTXPipe( mTCB.lastPipe );
+          }
+
+          dstAddress = ( mTCB.lastAddress & ~0xFF ) | EndpointAddrModifiers[ mTCB.lastPipe ];
+        }
+
+        /*---------------------------------------------------------------------
+        All information needed to TX the frame is known, so it's safe to
+        transition to standby mode in prep for moving to TX mode once the data
+        is loaded.
+        ---------------------------------------------------------------------*/
+        mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
+
+        /*---------------------------------------------------------------------
+        Open the proper port for writing
+        ---------------------------------------------------------------------*/
+        Physical::openWritePipe( mPhyHandle, dstAddress );
+
+        /*---------------------------------------------------------------------
+        Determine the reliability required on the TX. This assumes hardware is
+        initialized with DynamicACK, the proper payload length settings are set
+        and any pipes needing auto-ack are enabled.
+        ---------------------------------------------------------------------*/
+        if ( cacheFrame.wireData.control.requireACK )
+        {
+          Physical::setRetries( mPhyHandle, cacheFrame.rtxDelay, cacheFrame.rtxCount );
+        }
+      }
+
+      /*-----------------------------------------------------------------------
+      Write the data to the TX FIFO and make sure the radio is in the active TX
+      mode. If already transmitting, the radio picks the frame up on its own.
+      -----------------------------------------------------------------------*/
+      auto txType = Physical::PayloadType::PAYLOAD_NO_ACK;
+      if ( cacheFrame.wireData.control.requireACK )
+      {
+        txType = Physical::PayloadType::PAYLOAD_REQUIRES_ACK;
+      }
+
+      mTCB.mLastTX_us = Chimera::micros();
+      mTCB.acquire( Chimera::millis(), Chimera::Thread::TIMEOUT_10MS, static_cast<uint32_t>( mTCB.mLastTX_us ) );
+
+      /*-----------------------------------------------------------------------
+      With dynamic payloads on the TX pipe, only the bytes actually used go on
+      air. Otherwise the full frame is sent to match the static width.
+      -----------------------------------------------------------------------*/
+      FrameBuffer txBuffer = {};
+      size_t txSize        = cacheFrame.pack( txBuffer );
+      if ( !Physical::dynamicPayloadsEnabled( mPhyHandle, Physical::PIPE_NUM_0 ) )
+      {
+        txSize = txBuffer.size();
+      }
+
+      /*-----------------------------------------------------------------------
+      The payload write is queued rather than blocking, allowing the next frame
+      to be loaded while this one is still moving over the SPI bus. The driver
+      takes its own copy of the packed data. The frame stays in its slot until
+      the hardware reports back on it.
+      -----------------------------------------------------------------------*/
+      LOG_TRACE_IF( DEBUG_MODULE, "Transmit Packet\r\n" );
+      RIPPLE_TRACE( TRC_FRAME_TX, cacheFrame.wireData.control.uuid,
+                    ( static_cast<uint32_t>( cacheFrame.frameNumber() ) << 16 ) | txSize );
+      Physical::writePayloadAsync( mPhyHandle, txBuffer.data(), txSize, txType );
+      mFSMControl.receive( Physical::FSM::MsgStartTX() );
+      recordTXLatency( cacheFrame );
+    }
+  }
+
+
+  TrafficClass DataLink::selectTXClass()
+  {
+    /*-------------------------------------------------------------------------
+    Local helper to find the first frame of a class not yet handed to the radio
+    -------------------------------------------------------------------------*/
+    auto firstPending = [ this ]( const size_t tc ) -> size_t {
+      return ( tc == mTXClass ) ? ( mTCB.inFlight + mACB.staged ) : 0;
+    };
+
+    /*-------------------------------------------------------------------------
+    Control traffic always goes first
+    -------------------------------------------------------------------------*/
+    if ( mTXQueue[ TC_CONTROL ]->size() > firstPending( TC_CONTROL ) )
+    {
+      return TC_CONTROL;
+    }
+
+    /*-------------------------------------------------------------------------
+    Everything else competes on its class, less one level for each aging period
+    its oldest frame has waited. Ties go to the class whose oldest frame has
+    waited longest, so a promoted class takes turns with the one it caught up
+    to instead of starving behind it.
+    -------------------------------------------------------------------------*/
+    const size_t now      = Chimera::micros();
+    TrafficClass selected = TC_NUM_OPTIONS;
+    size_t bestLevel      = TC_NUM_OPTIONS;
+    size_t bestAge_us     = 0;
+
+    for ( size_t tc = TC_CONTROL + 1; tc < TC_NUM_OPTIONS; tc++ )
+    {
+      const size_t offset = firstPending( tc );
+      if ( mTXQueue[ tc ]->size() <= offset )
+      {
+        continue;
+      }
+
+      const size_t age_us = now - mTXQueue[ tc ]->peek( offset ).queuedTime_us;
+      size_t waited       = 0;
+      if constexpr ( NRF_LINK_TX_AGING_MS > 0 )
+      {
+        waited = age_us / ( NRF_LINK_TX_AGING_MS * 1000 );
+      }
+
+      const size_t level = ( waited < ( tc - TC_REALTIME ) ) ? ( tc - waited ) : TC_REALTIME;
+      if ( ( level < bestLevel ) || ( ( level == bestLevel ) && ( age_us > bestAge_us ) ) )
+      {
+        bestLevel  = level;
+        bestAge_us = age_us;
+        selected   = static_cast<TrafficClass>( tc );
+      }
+    }
+
+    return selected;
+  }
+
+
+  size_t DataLink::pendingTXFrames() const
+  {
+    size_t queued = 0;
+    for ( auto queue : mTXQueue )
+    {
+      queued += queue->size();
+    }
+
+    /*-------------------------------------------------------------------------
+    Frames in flight or staged all belong to the active class and sit at the
+    front of its queue
+    -------------------------------------------------------------------------*/
+    const size_t loaded = mTCB.inFlight + mACB.staged;
+    return ( queued > loaded ) ? ( queued - loaded ) : 0;
+  }
+
+
+  FrameRingBase &DataLink::txQueue()
+  {
+    return *mTXQueue[ mTXClass ];
+  }
+
+
+  bool DataLink::processAckQueue()
+  {
+    /*-------------------------------------------------------------------------
+    Staging only works while listening, as TX mode would send them as frames
+    -------------------------------------------------------------------------*/
+    if ( !mPhyHandle.cfg.ackPayloads || mTCB.inProgress() || ( txQueue().size() <= mACB.staged ) )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Count the frames that could be staged. They go to the node already waiting
+    on the FIFO, if any. One that has already waited out the ACK payload
+    timeout goes out as a normal frame instead, else frames pulled back for
+    timing out would just be staged again and never leave.
+    -------------------------------------------------------------------------*/
+    static constexpr size_t STAGE_LIMIT_US = NRF_LINK_ACK_PAYLOAD_TIMEOUT_MS * 1000u;
+
+    Physical::PipeNumber pipe = mACB.staged ? mACB.stagedPipe : Physical::PIPE_INVALID;
+    size_t count              = 0;
+
+    while ( ( txQueue().size() > ( mACB.staged + count ) ) && ( ( mACB.staged + count ) < Physical::MAX_TX_FIFO_DEPTH ) )
+    {
+      const Frame &cacheFrame = txQueue().peek( mACB.staged + count );
+      if ( ( Chimera::micros() - cacheFrame.queuedTime_us ) >= STAGE_LIMIT_US )
+      {
+        break;
+      }
+
+      this->lock();
+      const auto found = mACB.find( cacheFrame.nextHop );
+      this->unlock();
+
+      if ( ( found == Physical::PIPE_INVALID ) || ( ( pipe != Physical::PIPE_INVALID ) && ( found != pipe ) ) )
+      {
+        break;
+      }
+
+      pipe = found;
+      count++;
+    }
+
+    /*-------------------------------------------------------------------------
+    Normal TX never waits on staging. If anything else is waiting for the
+    radio, it would only pull the staged frames back out again, so everything
+    goes out the normal way instead.
+    -------------------------------------------------------------------------*/
+    if ( !count || ( pendingTXFrames() > count ) )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Staged frames keep their slot at the front of the TX queue until they are
+    sent
+    -------------------------------------------------------------------------*/
+    bool staged = false;
+    for ( ; count; count-- )
+    {
+      Frame &cacheFrame = txQueue().peek( mACB.staged );
+
+      FrameBuffer ackBuffer;
+      const size_t ackSize = cacheFrame.pack( ackBuffer );
+      if ( Physical::stageAckPayload( mPhyHandle, pipe, ackBuffer.data(), ackSize ) != Chimera::Status::OK )
+      {
+        break;
+      }
+
+      if ( !mACB.staged )
+      {
+        mACB.stagedStart = Chimera::millis();
+      }
+
+      LOG_TRACE_IF( DEBUG_MODULE, "Staged ACK payload on pipe %d\r\n", pipe );
+      mACB.stagedPipe = pipe;
+      mACB.staged++;
+      staged = true;
+    }
+
+    /*-------------------------------------------------------------------------
+    Make sure the radio is listening so the remote node can collect them
+    -------------------------------------------------------------------------*/
+    if ( staged )
+    {
+      mFSMControl.receive( Physical::FSM::MsgStartRX() );
+    }
+
+    return staged;
+  }
+
+
+  void DataLink::processAckSent()
+  {
+    /*-------------------------------------------------------------------------
+    All staged frames share a pipe, so they leave in the order they were loaded
+    -------------------------------------------------------------------------*/
+    TrafficCounters::add( mCounters.tx_bytes, txQueue().front().size() );
+    TrafficCounters::add( mCounters.frame_tx );
+
+    txQueue().pop();
+    mACB.staged--;
+    mACB.stagedStart = Chimera::millis();
+
+    mCBService_registry.call<CallbackId::CB_TX_SUCCESS>();
+    LOG_TRACE_IF( DEBUG_MODULE, "ACK payload sent\r\n" );
+  }
+
+
+  void DataLink::evictAckPayloads()
+  {
+    /*-------------------------------------------------------------------------
+    Only ACK payloads live in the TX FIFO while no transfer is in progress
+    -------------------------------------------------------------------------*/
+    if ( mTCB.inProgress() )
+    {
+      return;
+    }
+
+    Physical::flushTX( mPhyHandle );
+
+    /*-------------------------------------------------------------------------
+    The frames never left the front of the TX queue, so forgetting they were
+    staged hands them back to the normal TX path in their original order.
+    -------------------------------------------------------------------------*/
+    mACB.stagedPipe = Physical::PIPE_INVALID;
+    mACB.staged     = 0;
+  }
+
+
+  void DataLink::processChannelSurvey()
+  {
+    using namespace Physical::FSM;
+
+    /*-------------------------------------------------------------------------
+    Sample period elapsed?
+    -------------------------------------------------------------------------*/
+    if ( !NRF_LINK_CHANNEL_SURVEY_PERIOD_MS || !mSystemEnabled || mDedicatedRX ||
+         ( ( Chimera::millis() - mSurvey.lastSample ) < NRF_LINK_CHANNEL_SURVEY_PERIOD_MS ) )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Leaving the operating channel mid-transfer would lose frames, so only take
+    a sample while there is nothing else to do.
+    -------------------------------------------------------------------------*/
+    if ( mTCB.inProgress() || mACB.staged || mHopCB.pending || pendingTXFrames() || !Physical::rxFifoEmpty( mPhyHandle ) )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Listen on the sample channel long enough for the detector to settle. The
+    operating channel is sampled in place, which also counts this network's
+    own traffic against it.
+    -------------------------------------------------------------------------*/
+    const Physical::RFChannel home  = mPhyHandle.cfg.hwRFChannel;
+    const Physical::RFChannel probe = mSurvey.next();
+
+    if ( probe != home )
+    {
+      mFSMControl.receive( MsgGoToSTBY() );
+      Physical::setRFChannel( mPhyHandle, probe );
+    }
+
+    mFSMControl.receive( MsgStartRX() );
+    Physical::awaitPLLSettle( mPhyHandle );
+    Chimera::delayMicroseconds( Physical::RPD_SETTLE_TIME_US );
+
+    const bool detected = Physical::carrierDetected( mPhyHandle );
+
+    if ( probe != home )
+    {
+      mFSMControl.receive( MsgGoToSTBY() );
+      Physical::setRFChannel( mPhyHandle, home );
+      mFSMControl.receive( MsgStartRX() );
+    }
+
+    /*-------------------------------------------------------------------------
+    Update the survey results
+    -------------------------------------------------------------------------*/
+    this->lock();
+    mSurvey.lastSample = Chimera::millis();
+    mSurvey.record( probe, detected );
+    this->unlock();
+
+    /*-------------------------------------------------------------------------
+    At the end of each sweep, move if a much quieter channel was found
+    -------------------------------------------------------------------------*/
+    if constexpr ( NRF_LINK_CHANNEL_AUTO_HOP )
+    {
+      if ( mSurvey.cursor == 0 )
+      {
+        const uint8_t quiet = mSurvey.quietest();
+        if ( mSurvey.busy[ home ] > ( mSurvey.busy[ quiet ] + NRF_LINK_CHANNEL_HOP_MARGIN ) )
+        {
+          LOG_INFO( "Channel %d congested, moving to %d\r\n", home, quiet );
+          requestChannelHop( quiet );
+        }
+      }
+    }
+  }
+
+
+  void DataLink::processChannelHop()
+  {
+    using namespace Physical::FSM;
+
+    /*-------------------------------------------------------------------------
+    Is a hop due? Let frames in flight finish on the old channel first.
+    -------------------------------------------------------------------------*/
+    if ( !mHopCB.pending || ( ( Chimera::millis() - mHopCB.start ) < mHopCB.delay ) || mTCB.inProgress() )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Move the radio. Writing RF_CH also resets the hardware lost packet count.
+    -------------------------------------------------------------------------*/
+    mFSMControl.receive( MsgGoToSTBY() );
+    Physical::setRFChannel( mPhyHandle, mHopCB.channel );
+    mFSMControl.receive( MsgStartRX() );
+
+    /*-------------------------------------------------------------------------
+    Retry tuning learned on the old channel no longer applies
+    -------------------------------------------------------------------------*/
+    mLinkEstimator.clear();
+
+    this->lock();
+    mPhyHandle.cfg.hwRFChannel = mHopCB.channel;
+    mHopCB.pending             = false;
+    mStats.rf_channel          = mHopCB.channel;
+    mStats.channel_hops += 1;
+    this->unlock();
+
+    LOG_INFO( "NRF24 moved to RF channel %d\r\n", mPhyHandle.cfg.hwRFChannel );
+  }
+
+
+  void DataLink::processNetService( Frame &frame )
+  {
+    /*-------------------------------------------------------------------------
+    Pull out the message. The first byte identifies what it is.
+    -------------------------------------------------------------------------*/
+    uint8_t buffer[ sizeof( PackedFrame::userData ) ];
+    const size_t size = frame.readUserData( buffer, sizeof( buffer ) );
+
+    if ( !size )
+    {
+      return;
+    }
+
+    switch ( buffer[ 0 ] )
+    {
+      /*-----------------------------------------------------------------------
+      A neighbor is moving the network. Line up the move with the sender's.
+      -----------------------------------------------------------------------*/
+      case NET_SVC_CHANNEL_HOP: {
+        ChannelHopMsg msg;
+        if ( size < sizeof( msg ) )
+        {
+          break;
+        }
+
+        memcpy( &msg, buffer, sizeof( msg ) );
+        if ( ( msg.channel > Physical::MAX_RF_CHANNEL ) || ( msg.channel == mPhyHandle.cfg.hwRFChannel ) )
+        {
+          break;
+        }
+
+        this->lock();
+        mHopCB.pending = true;
+        mHopCB.channel = msg.channel;
+        mHopCB.start   = Chimera::millis();
+        mHopCB.delay   = msg.delay_ms;
+        this->unlock();
+
+        LOG_INFO( "Channel hop to %d requested by peer\r\n", msg.channel );
+        break;
+      }
+
+      /*-----------------------------------------------------------------------
+      Address resolution. Both messages carry the sender's own mapping, which
+      is learned here. Only messages for this node are acted on, so a busy
+      network doesn't fill the cache with nodes this one never talks to.
+      -----------------------------------------------------------------------*/
+      case NET_SVC_ARP_REQUEST:
+      case NET_SVC_ARP_REPLY: {
+        ARPMsg msg;
+        if ( ( size < sizeof( msg ) ) || !mContext )
+        {
+          break;
+        }
+
+        memcpy( &msg, buffer, sizeof( msg ) );
+        if ( msg.target != mContext->getIPAddress() )
+        {
+          break;
+        }
+
+        this->lock();
+        mAddressCache.insert( msg.sender, msg.senderMAC );
+        this->unlock();
+        mARPPending.markReachable( msg.sender );
+
+        if ( msg.id == NET_SVC_ARP_REQUEST )
+        {
+          LOG_DEBUG_IF( DEBUG_MODULE, "ARP request from %d\r\n", msg.sender );
+          sendARPMessage( NET_SVC_ARP_REPLY, msg.sender );
+        }
+        else
+        {
+          LOG_DEBUG_IF( DEBUG_MODULE, "ARP reply from %d\r\n", msg.sender );
+          releaseParkedFrames( msg.sender );
+
+          if ( msg.sender == mSessionCB.coordinator.load() )
+          {
+            mSessionCB.confirmed.store( true );
+          }
+        }
+
+        mLiveness.onHeard( msg.sender, Chimera::millis() );
+        break;
+      }
+
+      /*-----------------------------------------------------------------------
+      A neighbor checking in. The hardware ACK already answered it, all that's
+      left is to note that it's still around.
+      -----------------------------------------------------------------------*/
+      case NET_SVC_KEEPALIVE: {
+        KeepAliveMsg msg;
+        if ( size < sizeof( msg ) )
+        {
+          break;
+        }
+
+        memcpy( &msg, buffer, sizeof( msg ) );
+        mLiveness.onHeard( msg.sender, Chimera::millis() );
+        break;
+      }
+
+      /*-----------------------------------------------------------------------
+      Clock sync. Net service frames are handled while the FIFO is drained,
+      right after the RX IRQ. Only the first payload of a drain owns the IRQ
+      stamp, and only if the stamp is fresh, so a beacon that sat behind other
+      frames or was picked up late is dropped. The follow up without its sync
+      is then rejected too. The follow up says when the beacon left.
+      -----------------------------------------------------------------------*/
+      case NET_SVC_TIME_SYNC:
+      case NET_SVC_TIME_FOLLOW_UP: {
+        TimeSyncMsg msg;
+        if ( !NRF_LINK_TIME_SYNC_PERIOD_MS || ( size < sizeof( msg ) ) )
+        {
+          break;
+        }
+
+        memcpy( &msg, buffer, sizeof( msg ) );
+        if ( ( msg.id == NET_SVC_TIME_SYNC ) && ( !mRXStampValid || ( mRXPayloads != 1u ) ) )
+        {
+          LOG_DEBUG_IF( DEBUG_MODULE, "Dropped time sync from %d, no fresh RX stamp\r\n", msg.sender );
+          break;
+        }
+
+        this->lock();
+        if ( msg.id == NET_SVC_TIME_SYNC )
+        {
+          mTimeSync.onSync( msg.sender, msg.root, msg.level, msg.seq, mTimeSync.extend( mRXStamp_us ) );
+        }
+        else if ( mTimeSync.onFollowUp( msg.sender, msg.seq, msg.global_us, Chimera::millis() ) )
+        {
+          LOG_DEBUG_IF( DEBUG_MODULE, "Time sync sample from %d\r\n", msg.sender );
+        }
+        this->unlock();
+        break;
+      }
+
+      /*-----------------------------------------------------------------------
+      The coordinator handed out a TDMA slot, or took it back
+      -----------------------------------------------------------------------*/
+      case NET_SVC_TDMA_SLOT: {
+        TDMASlotMsg msg;
+        if ( size < sizeof( msg ) )
+        {
+          break;
+        }
+
+        memcpy( &msg, buffer, sizeof( msg ) );
+
+        this->lock();
+        const bool valid = mTDMA.configure( msg.slot, msg.numSlots, msg.slot_us, TDMA_GUARD_US );
+        this->unlock();
+
+        if ( !valid )
+        {
+          LOG_ERROR( "Invalid TDMA slot %d of %d from %d\r\n", msg.slot, msg.numSlots, msg.sender );
+        }
+        else if ( msg.numSlots )
+        {
+          LOG_INFO( "TDMA slot %d of %d, %dus, assigned by %d\r\n", msg.slot, msg.numSlots, msg.slot_us, msg.sender );
+        }
+        else
+        {
+          LOG_INFO( "TDMA schedule dropped by %d\r\n", msg.sender );
+        }
+        break;
+      }
+
+      default:
+        LOG_DEBUG_IF( DEBUG_MODULE, "Unknown network service message %d\r\n", buffer[ 0 ] );
+        break;
+    };
+  }
+
+
+  void DataLink::processRXQueue()
+  {
+    /*-------------------------------------------------------------------------
+    Ensure safe to process the queue. TX-ing and RX-ing are exclusive.
+    -------------------------------------------------------------------------*/
+    if ( mTCB.inProgress() )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Check if the queue is full, allowing the NET driver to pull data off. Don't
+    return early here b/c HW RX FIFO needs emptying regardless.
+    -------------------------------------------------------------------------*/
+    if ( mRXQueue.full() )
+    {
+      mCBService_registry.call<CallbackId::CB_ERROR_RX_QUEUE_FULL>();
+      LOG_ERROR_IF( mRXQueue.full(), "RX queue full. Cannot process netif receive\r\n" );
+    }
+
+    /*-------------------------------------------------------------------------
+    Payloads can be read while listening, which saves a CE toggle and the PLL
+    settle on the way back. Some parts need Standby-1 though (RM Appendix A).
+    -------------------------------------------------------------------------*/
+    if constexpr ( NRF_LINK_RX_READ_IN_STANDBY )
+    {
+      mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
+    }
+
+    /*-------------------------------------------------------------------------
+    Acknowledge the RX event. This prevents infinite IRQ events.
+    -------------------------------------------------------------------------*/
+    Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_RX_DR );
+
+    /*-------------------------------------------------------------------------
+    Pick the arrival stamp for this drain. The IRQ line stays low until RX_DR
+    is cleared, so with exactly one edge since the last drain, the stamp marks
+    the oldest payload in the FIFO. No edge means the stamp belongs to an
+    earlier drain, more than one means it may belong to a TX event. The seq
+    is read on both sides of the stamp so an IRQ landing in between is caught.
+    -------------------------------------------------------------------------*/
+    const uint32_t seq   = mIRQSeq.load();
+    const uint32_t stamp = mLastIRQ_us.load();
+    const uint32_t age   = static_cast<uint32_t>( Chimera::micros() ) - stamp;
+
+    mRXStampValid = ( seq == mIRQSeq.load() ) && ( ( seq - mRXDrainSeq ) == 1u ) &&
+                    ( age <= NRF_LINK_TIME_SYNC_STAMP_AGE_US );
+    mRXStamp_us   = stamp;
+    mRXDrainSeq   = seq;
+    mRXPayloads   = 0;
+
+    /*-------------------------------------------------------------------------
+    Read out all available data, regardless of whether or not the queue can
+    store the information. Without this, the network will stall. Each payload
+    read also reports its pipe, so the STATUS register isn't polled separately.
+    -------------------------------------------------------------------------*/
+    auto handler  = Physical::RXPayloadHandler::create<DataLink, &DataLink::enqueueRXPayload>( *this );
+    auto provider = Physical::RXBufferProvider::create<DataLink, &DataLink::reserveRXPayload>( *this );
+    Physical::drainRXFifo( mPhyHandle, mPhyHandle.cfg.hwStaticPayloadWidth, handler, &provider );
+
+    /*-------------------------------------------------------------------------
+    Go back to listening. The TX process is mutually exclusive, so it's ok to
+    transition to this state. This is free if the radio never left RX mode.
+    -------------------------------------------------------------------------*/
+    mFSMControl.receive( Physical::FSM::MsgStartRX() );
+    mLastActive = Chimera::millis();
+    mCBService_registry.call<CallbackId::CB_RX_SUCCESS>();
+  }
+
+
+  void *DataLink::reserveRXPayload( const size_t size )
+  {
+    /*-------------------------------------------------------------------------
+    Only this thread produces RX frames, so the reservation stays valid until
+    the payload handler either commits or abandons it. The network layer only
+    ever consumes, so no lock is needed.
+    -------------------------------------------------------------------------*/
+    mRXReserved = ( size <= sizeof( PackedFrame ) ) ? mRXQueue.reserve() : nullptr;
+
+    return mRXReserved ? &mRXReserved->wireData : nullptr;
+  }
+
+
+  void DataLink::enqueueRXPayload( const Physical::PipeNumber pipe, const void *const data, const size_t size )
+  {
+    /*-------------------------------------------------------------------------
+    Claim the reserved slot if the payload was read straight into it
+    -------------------------------------------------------------------------*/
+    mRXPayloads++;
+
+    Frame *slot = nullptr;
+    if ( mRXReserved && ( data == &mRXReserved->wireData ) )
+    {
+      slot = mRXReserved;
+    }
+    mRXReserved = nullptr;
+
+    /*-------------------------------------------------------------------------
+    Expand the on-air header into the host form, in place if the payload was
+    read straight into a slot. Payloads can be as short as the header.
+    -------------------------------------------------------------------------*/
+    Frame tmpFrame;
+    Frame &rxFrame = slot ? *slot : tmpFrame;
+    if ( !rxFrame.unpack( data, size ) )
+    {
+      LOG_ERROR( "RX frame dropped, malformed header\r\n" );
+      return;
+    }
+
+    const _pfCtrl &control = rxFrame.wireData.control;
+
+    /*-------------------------------------------------------------------------
+    Housekeeping traffic is handled here and never reaches the network layer.
+    A reserved slot is simply left uncommitted afterwards.
+    -------------------------------------------------------------------------*/
+    if ( control.endpoint == Endpoint::EP_NETWORK_SERVICES )
+    {
+      processNetService( rxFrame );
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Multicast senders may repeat each frame. Only the first copy is kept.
+    -------------------------------------------------------------------------*/
+    const uint8_t sender = rxFrame.isExtended() ? rxFrame.wireData.ext.sourceId : 0;
+    if ( control.multicast && mMulticastHistory.seen( sender, control.uuid, rxFrame.frameNumber() ) )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Dropped repeated multicast frame %d of UUID %d\r\n", rxFrame.frameNumber(),
+                    control.uuid );
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Frames passing through toward another node never leave this thread
+    -------------------------------------------------------------------------*/
+    if ( ( control.endpoint == Endpoint::EP_DATA_FORWARDING ) && forwardFrame( rxFrame ) )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    No slot means the queue was full when the read started. Give the network
+    layer a chance to drain it, then fall back to copying the frame in.
+    Otherwise the data is simply lost.
+    -------------------------------------------------------------------------*/
+    if ( !slot )
+    {
+      mPhyHandle.rxQueueOverflows++;
+      mCBService_registry.call<CallbackId::CB_ERROR_RX_QUEUE_FULL>();
+
+      slot = mRXQueue.reserve();
+      if ( !slot )
+      {
+        TrafficCounters::add( mCounters.rx_bytes_lost, size );
+        TrafficCounters::add( mCounters.frame_rx_drop );
+        RIPPLE_TRACE( TRC_FRAME_RX_DROP, control.uuid, size );
+        LOG_ERROR( "RX frame lost due to netif queue full\r\n" );
+        return;
+      }
+
+      memcpy( &slot->wireData, &tmpFrame.wireData, sizeof( PackedFrame ) );
+    }
+
+    /*-------------------------------------------------------------------------
+    Fill in the bookkeeping
+    -------------------------------------------------------------------------*/
+    slot->clear();
+    slot->receivedPipe  = pipe;
+    slot->queuedTime_us = Chimera::micros();
+
+    RIPPLE_TRACE( TRC_FRAME_RX, slot->wireData.control.uuid, ( static_cast<uint32_t>( pipe ) << 16 ) | size );
+    mRXQueue.commit();
+    TrafficCounters::add( mCounters.rx_bytes, size );
+    TrafficCounters::add( mCounters.frame_rx );
+  }
+
+
+  bool DataLink::forwardFrame( Frame &frame )
+  {
+    _pfCtrl &control = frame.wireData.control;
+    if ( !control.dataLength )
+    {
+      TrafficCounters::add( mCounters.frame_fwd_drop );
+      return true;
+    }
+
+    /*-------------------------------------------------------------------------
+    Arrived. Strip the destination id and let it continue up like any other
+    data frame.
+    -------------------------------------------------------------------------*/
+    const uint8_t target = frame.wireData.userData[ 0 ];
+    if ( mContext && ( target == forwardId( mContext->getIPAddress() ) ) )
+    {
+      control.dataLength -= 1u;
+      control.endpoint = Endpoint::EP_APPLICATION_DATA_0;
+      memmove( &frame.wireData.userData[ 0 ], &frame.wireData.userData[ 1 ], control.dataLength );
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Otherwise find who is closer to the destination
+    -------------------------------------------------------------------------*/
+    IPAddress nextHop = 0;
+    bool routed       = false;
+    {
+      Chimera::Thread::LockGuard lck( *this );
+      if ( const ForwardRoute *route = mForwardTable.findById( target ) )
+      {
+        nextHop = route->nextHop;
+        routed  = true;
+      }
+    }
+
+    if ( !routed || !control.hopLimit )
+    {
+      TrafficCounters::add( mCounters.frame_fwd_drop );
+      LOG_DEBUG_IF( DEBUG_MODULE, "Dropped forwarded frame for node %d, %s\r\n", target,
+                    routed ? "hop limit reached" : "no route" );
+      return true;
+    }
+
+    /*-------------------------------------------------------------------------
+    Requeue the frame as is. Relays never rebuild the packet, so a fragment
+    costs one TX slot and no heap.
+    -------------------------------------------------------------------------*/
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+    FrameRingBase &queue = *mTXQueue[ TC_REALTIME ];
+
+    Frame *slot = queue.reserve();
+    if ( !slot )
+    {
+      TrafficCounters::add( mCounters.frame_fwd_drop );
+      mCBService_registry.call<CallbackId::CB_ERROR_TX_QUEUE_FULL>();
+      return true;
+    }
+
+    initTXFrame( *slot, nextHop, mPhyHandle );
+    memcpy( &slot->wireData, &frame.wireData, sizeof( PackedFrame ) );
+    slot->wireData.control.hopLimit -= 1u;
+    slot->wireData.control.requireACK = true;
+
+    queue.commit();
+    signalEvent( SVC_EVT_TX_ENQUEUE );
+    TrafficCounters::add( mCounters.frame_fwd );
+    return true;
+  }
+
+
+  void DataLink::parkTXFrame( Frame &frame )
+  {
+    /*-------------------------------------------------------------------------
+    Nodes that just failed to resolve aren't asked about again for a while
+    -------------------------------------------------------------------------*/
+    const size_t now = Chimera::millis();
+    if ( mARPPending.unreachable( frame.nextHop, now, NRF_LINK_ARP_NEGATIVE_TIMEOUT_MS ) ||
+         !mARPPending.park( frame, mTXClass ) )
+    {
+      TrafficCounters::add( mCounters.frame_tx_drop );
+      TrafficCounters::add( mCounters.tx_bytes_lost, frame.size() );
+      mCBService_registry.call<CallbackId::CB_ERROR_ARP_RESOLVE>();
+      LOG_ERROR_IF( DEBUG_MODULE, "NRF24 ARP lookup failure for next hop: %d\r\n", frame.nextHop );
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Get the request out right away rather than on the next timer tick
+    -------------------------------------------------------------------------*/
+    processARPPending();
+  }
+
+
+  void DataLink::processARPPending()
+  {
+    if ( !mARPPending.active() )
+    {
+      return;
+    }
+
+    const size_t now = Chimera::millis();
+    for ( size_t idx = 0; idx < ARP_PENDING_NODE_ELEMENTS; idx++ )
+    {
+      PendingNode *node = mARPPending.node( idx );
+      if ( !node )
+      {
+        continue;
+      }
+
+      /*-----------------------------------------------------------------------
+      Resolved, either by a reply or by someone adding the entry directly
+      -----------------------------------------------------------------------*/
+      this->lock();
+      const bool resolved = mAddressCache.lookup( node->ip, nullptr );
+      this->unlock();
+
+      if ( resolved )
+      {
+        releaseParkedFrames( node->ip );
+        continue;
+      }
+
+      if ( node->attempts && ( ( now - node->lastRequest ) < NRF_LINK_ARP_RETRY_MS ) )
+      {
+        continue;
+      }
+
+      /*-----------------------------------------------------------------------
+      Out of retries. Drop the parked frames and stop asking for a while.
+      -----------------------------------------------------------------------*/
+      if ( node->attempts >= NRF_LINK_ARP_RETRIES )
+      {
+        const IPAddress ip   = node->ip;
+        const size_t dropped = mARPPending.forget( ip );
+        mARPPending.markUnreachable( ip, now );
+
+        TrafficCounters::add( mCounters.frame_tx_drop, dropped );
+        mCBService_registry.call<CallbackId::CB_ERROR_ARP_RESOLVE>();
+        LOG_ERROR( "NRF24 could not resolve node %d, dropped %d frames\r\n", ip, dropped );
+        continue;
+      }
+
+      /*-----------------------------------------------------------------------
+      Ask the network who owns the address
+      -----------------------------------------------------------------------*/
+      if ( sendARPMessage( NET_SVC_ARP_REQUEST, node->ip ) )
+      {
+        node->attempts++;
+        node->lastRequest = now;
+      }
+    }
+  }
+
+
+  void DataLink::releaseParkedFrames( const IPAddress ip )
+  {
+    /*-------------------------------------------------------------------------
+    Hand the frames back to their TX queues in the order they were parked. If
+    a queue is full, the rest stay parked and are retried on the next pass.
     -------------------------------------------------------------------------*/
-    this->retransmitFrame( failedFrame, true );
+    {
+      Chimera::Thread::LockGuard txLock( mTXMutex );
+      while ( ParkedFrame *parked = mARPPending.oldest( ip ) )
+      {
+        FrameRingBase &queue = *mTXQueue[ parked->tc ];
+        Frame *slot          = queue.reserve();
+        if ( !slot )
+        {
+          return;
+        }
+
+        *slot = parked->frame;
+        queue.commit();
+        mARPPending.release( parked );
+      }
+    }
+
+    mARPPending.forget( ip );
+    signalEvent( SVC_EVT_TX_ENQUEUE );
   }
 
 
-  void DataLink::processTXQueue()
+  bool DataLink::sendARPMessage( const NetServiceId id, const IPAddress target, const bool direct )
   {
-    using namespace Aurora::Logging;
-    using namespace Chimera::Thread;
+    /*-------------------------------------------------------------------------
+    Both messages carry this node's own mapping
+    -------------------------------------------------------------------------*/
+    ARPMsg msg;
+    memset( &msg, 0, sizeof( msg ) );
+    msg.id        = id;
+    msg.target    = target;
+    msg.sender    = mContext ? mContext->getIPAddress() : 0;
+    msg.senderMAC = mPhyHandle.cfg.hwAddress;
 
     /*-------------------------------------------------------------------------
-    Can't TX new frame until the last frame transmitted or errored out
+    Requests go to everyone on the discovery address, as the target can't be
+    addressed yet. Replies go straight back, the requester is known by now,
+    as do direct requests to a node whose address is already cached.
     -------------------------------------------------------------------------*/
-    if ( mTCB.inProgress )
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+    FrameRingBase &queue = *mTXQueue[ TC_CONTROL ];
+    Frame *slot          = queue.reserve();
+    if ( !slot )
     {
-      return;
+      return false;
     }
 
-    Chimera::Thread::LockGuard _queueLock( mTXMutex );
-    if ( mTXQueue.empty() )
+    initTXFrame( *slot, target, mPhyHandle );
+    slot->wireData.control.totalFrames = 1;
+    slot->wireData.control.endpoint    = Endpoint::EP_NETWORK_SERVICES;
+    if ( ( id == NET_SVC_ARP_REQUEST ) && !direct )
     {
-      /*-----------------------------------------------------------------------
-      Nothing to TX. Ensure hardware is listening.
-      -----------------------------------------------------------------------*/
-      mFSMControl.receive( Physical::FSM::MsgStartRX() );
-      return;
+      slot->wireData.control.multicast  = true;
+      slot->wireData.control.requireACK = false;
     }
+    slot->writeUserData( &msg, sizeof( msg ) );
 
-    /*-------------------------------------------------------------------------
-    Rate limit the transfers
-    -------------------------------------------------------------------------*/
-    if( ( Chimera::micros() - mTCB.mLastTX_us ) < mTCB.mTXRate_us )
+    queue.commit();
+    signalEvent( SVC_EVT_TX_ENQUEUE );
+    return true;
+  }
+
+
+  void DataLink::processLiveness()
+  {
+    if constexpr ( !NRF_LINK_KEEPALIVE_MS )
     {
       return;
     }
 
     /*-------------------------------------------------------------------------
-    Look up the hardware address associated with the destination node.
+    Every node in the ARP cache is a neighbor worth watching. Newly learned
+    ones start out as just heard from.
     -------------------------------------------------------------------------*/
-    Frame &cacheFrame                  = mTXQueue.front();
-    Physical::MACAddress deviceAddress = 0;
+    using namespace Chimera::Thread;
 
-    if ( !mAddressCache.lookup( cacheFrame.nextHop, &deviceAddress ) )
+    const size_t now = Chimera::millis();
+    IPAddress nodeList[ ARP_CACHE_TABLE_ELEMENTS ];
+    size_t numNodes = 0;
     {
-      mCBService_registry.call<CallbackId::CB_ERROR_ARP_RESOLVE>();
-      mTXQueue.pop();
-      mTCB.inProgress = false;
-      LOG_ERROR_IF( DEBUG_MODULE, "NRF24 ARP lookup failure for next hop: %d\r\n", cacheFrame.nextHop );
-      return;
+      LockGuard _lock( *this );
+      numNodes = mAddressCache.nodes( nodeList, ARRAY_COUNT( nodeList ) );
+    }
+
+    for ( size_t idx = 0; idx < numNodes; idx++ )
+    {
+      mLiveness.track( nodeList[ idx ], now );
     }
 
     /*-------------------------------------------------------------------------
-    Modify the destination address to go to the correct pipe. Switch pipes per
-    transaction to increase overall bandwidth and decrease channel congestion.
+    Walk the neighbors, probing the quiet ones and dropping the silent ones
     -------------------------------------------------------------------------*/
-    auto dstAddress = ( deviceAddress & ~0xFF ) | EndpointAddrModifiers[ mTCB.lastPipe ];
-    switch( mTCB.lastPipe )
+    for ( size_t idx = 0; idx < PEER_LIVENESS_ELEMENTS; idx++ )
     {
-      case PIPE_APP_DATA_0:
-        mTCB.lastPipe = PIPE_APP_DATA_1;
-        break;
+      const PeerState *peer = mLiveness.peer( idx );
+      if ( !peer )
+      {
+        continue;
+      }
 
-      case PIPE_APP_DATA_1:
-        mTCB.lastPipe = PIPE_APP_DATA_2;
-        break;
+      const IPAddress ip = peer->ip;
 
-      case PIPE_APP_DATA_2:
-        mTCB.lastPipe = PIPE_APP_DATA_3;
-        break;
+      /*-----------------------------------------------------------------------
+      Dropped from the cache by someone else, nothing left to watch
+      -----------------------------------------------------------------------*/
+      if ( std::find( nodeList, nodeList + numNodes, ip ) == ( nodeList + numNodes ) )
+      {
+        mLiveness.forget( ip );
+        continue;
+      }
 
-      case PIPE_APP_DATA_3:
-      default:
-        mTCB.lastPipe = PIPE_APP_DATA_0;
-        break;
-    };
+      /*-----------------------------------------------------------------------
+      Gone for good. Frames to it are dropped until it answers an ARP request.
+      -----------------------------------------------------------------------*/
+      if ( ( now - peer->lastHeard ) >= NRF_LINK_PEER_DEAD_MS )
+      {
+        {
+          LockGuard _lock( *this );
+          mAddressCache.remove( ip );
+        }
 
-    /*-------------------------------------------------------------------------
-    All information needed to TX the frame is known, so it's safe to transition
-    to standby mode in prep for moving to TX mode once the data is loaded.
-    -------------------------------------------------------------------------*/
-    mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
+        mLiveness.forget( ip );
+        mARPPending.markUnreachable( ip, now );
 
-    /*-------------------------------------------------------------------------
-    Open the proper port for writing
-    -------------------------------------------------------------------------*/
-    Physical::openWritePipe( mPhyHandle, dstAddress );
+        TrafficCounters::add( mCounters.peers_lost );
+        mCBService_registry.call<CallbackId::CB_PEER_LOST>();
+        LOG_WARN_IF( DEBUG_MODULE, "NRF24 lost contact with node %d\r\n", ip );
+        continue;
+      }
 
-    /*-------------------------------------------------------------------------
-    Determine the reliability required on the TX. This assumes hardware is
-    initialized with DynamicACK, the proper payload length settings are set
-    and any pipes needing auto-ack are enabled.
-    -------------------------------------------------------------------------*/
-    auto txType = Physical::PayloadType::PAYLOAD_NO_ACK;
-    if ( cacheFrame.wireData.control.requireACK )
-    {
-      txType = Physical::PayloadType::PAYLOAD_REQUIRES_ACK;
-      Physical::setRetries( mPhyHandle, cacheFrame.rtxDelay, cacheFrame.rtxCount );
+      /*-----------------------------------------------------------------------
+      Quiet for a while. Check in, at most once per keepalive period.
+      -----------------------------------------------------------------------*/
+      if ( ( ( now - peer->lastHeard ) >= NRF_LINK_KEEPALIVE_MS ) && ( ( now - peer->lastProbe ) >= NRF_LINK_KEEPALIVE_MS ) &&
+           sendKeepAlive( ip ) )
+      {
+        mLiveness.onProbe( ip, now );
+        TrafficCounters::add( mCounters.keepalive_tx );
+      }
     }
+  }
+
+
+  bool DataLink::sendKeepAlive( const IPAddress target )
+  {
+    KeepAliveMsg msg;
+    memset( &msg, 0, sizeof( msg ) );
+    msg.id     = NET_SVC_KEEPALIVE;
+    msg.sender = mContext ? mContext->getIPAddress() : 0;
 
     /*-------------------------------------------------------------------------
-    Write the data to the TX FIFO and transition to the active TX mode.
+    Sent straight to the neighbor with an ACK, which is the actual check
     -------------------------------------------------------------------------*/
-    mTCB.inProgress = true;
-    mTCB.timeout    = Chimera::Thread::TIMEOUT_10MS;
-    mTCB.start      = Chimera::millis();
-    mTCB.mLastTX_us = Chimera::micros();
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+    FrameRingBase &queue = *mTXQueue[ TC_CONTROL ];
+    Frame *slot          = queue.reserve();
+    if ( !slot )
+    {
+      return false;
+    }
 
-    FrameBuffer data;
-    cacheFrame.pack( data );
+    initTXFrame( *slot, target, mPhyHandle );
+    slot->wireData.control.totalFrames = 1;
+    slot->wireData.control.endpoint    = Endpoint::EP_NETWORK_SERVICES;
+    slot->writeUserData( &msg, sizeof( msg ) );
 
-    LOG_TRACE_IF( DEBUG_MODULE, "Transmit Packet\r\n" );
-    Physical::writePayload( mPhyHandle, data.data(), data.size(), txType );
-    mFSMControl.receive( Physical::FSM::MsgStartTX() );
+    queue.commit();
+    signalEvent( SVC_EVT_TX_ENQUEUE );
+    return true;
   }
 
 
-  void DataLink::processRXQueue()
+  void DataLink::processTimeSync()
   {
-    /*-------------------------------------------------------------------------
-    Ensure safe to process the queue. TX-ing and RX-ing are exclusive.
-    -------------------------------------------------------------------------*/
-    if ( mTCB.inProgress )
+    if constexpr ( !NRF_LINK_TIME_SYNC_PERIOD_MS )
     {
       return;
     }
 
-    /*-------------------------------------------------------------------------
-    Check if the queue is full, allowing the NET driver to pull data off. Don't
-    return early here b/c HW RX FIFO needs emptying regardless.
-    -------------------------------------------------------------------------*/
-    Chimera::Thread::LockGuard _mtxLock( mRXMutex );
-    if ( mRXQueue.full() )
+    const size_t now = Chimera::millis();
+
+    /*-------------------------------------------------
+    Reading the clock here also keeps its extension to
+    64 bits fed, so no wrap of micros() is ever missed
+    -------------------------------------------------*/
+    this->lock();
+    mTimeSync.extend( static_cast<uint32_t>( Chimera::micros() ) );
+    if ( mTimeSync.expire( now, NRF_LINK_TIME_SYNC_TIMEOUT_MS ) )
     {
-      mCBService_registry.call<CallbackId::CB_ERROR_RX_QUEUE_FULL>();
-      LOG_ERROR_IF( mRXQueue.full(), "RX queue full. Cannot process netif receive\r\n" );
+      LOG_INFO( "Network time lost, no sync beacons heard\r\n" );
     }
 
-    /*-------------------------------------------------------------------------
-    Move to Standby-1, else data can't be read from RX FIFO (RM Appendix A)
-    -------------------------------------------------------------------------*/
-    mFSMControl.receive( Physical::FSM::MsgGoToSTBY() );
+    const bool due = mTimeSync.canBeacon() && ( ( now - mLastBeacon ) >= NRF_LINK_TIME_SYNC_PERIOD_MS );
+    this->unlock();
+
+    /*-------------------------------------------------
+    A beacon that couldn't be queued goes next tick
+    -------------------------------------------------*/
+    const uint8_t seq = mBeaconSeq + 1u;
+    if ( due && sendTimeMessage( NET_SVC_TIME_SYNC, seq, 0 ) )
+    {
+      mBeaconSeq  = seq;
+      mLastBeacon = now;
+    }
+  }
+
+
+  bool DataLink::sendTimeMessage( const NetServiceId id, const uint8_t seq, const uint64_t global_us )
+  {
+    TimeSyncMsg msg;
+    memset( &msg, 0, sizeof( msg ) );
+    msg.id        = id;
+    msg.seq       = seq;
+    msg.sender    = mContext ? mContext->getIPAddress() : 0;
+    msg.global_us = global_us;
+
+    this->lock();
+    msg.level = mTimeSync.beaconLevel();
+    msg.root  = mTimeSync.root();
+    this->unlock();
 
     /*-------------------------------------------------------------------------
-    Acknowledge the RX event. This prevents infinite IRQ events.
+    Flooded to everyone in range without an ACK. Retries would only blur when
+    the beacon actually left.
     -------------------------------------------------------------------------*/
-    Physical::clrISREvent( mPhyHandle, Physical::bfISRMask::ISR_MSK_RX_DR );
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+    FrameRingBase &queue = *mTXQueue[ TC_CONTROL ];
+    Frame *slot          = queue.reserve();
+    if ( !slot )
+    {
+      return false;
+    }
+
+    initTXFrame( *slot, MULTICAST_NEXT_HOP, mPhyHandle );
+    slot->wireData.control.totalFrames = 1;
+    slot->wireData.control.endpoint    = Endpoint::EP_NETWORK_SERVICES;
+    slot->wireData.control.multicast   = true;
+    slot->wireData.control.requireACK  = false;
+    slot->writeUserData( &msg, sizeof( msg ) );
+
+    queue.commit();
+    signalEvent( SVC_EVT_TX_ENQUEUE );
+    return true;
+  }
+
+
+  bool DataLink::sendTDMASlot( const IPAddress target, const uint8_t slot, const uint8_t numSlots, const uint32_t slot_us )
+  {
+    TDMASlotMsg msg;
+    memset( &msg, 0, sizeof( msg ) );
+    msg.id       = NET_SVC_TDMA_SLOT;
+    msg.slot     = slot;
+    msg.numSlots = numSlots;
+    msg.sender   = mContext ? mContext->getIPAddress() : 0;
+    msg.slot_us  = slot_us;
 
     /*-------------------------------------------------------------------------
-    Read out all available data, regardless of whether or not the queue can
-    store the information. Without this, the network will stall.
+    Sent straight to the node with an ACK, it can't take part until it has it
     -------------------------------------------------------------------------*/
-    Physical::PipeNumber pipe = Physical::getAvailablePayloadPipe( mPhyHandle );
-    while ( pipe != Physical::PipeNumber::PIPE_INVALID )
+    Chimera::Thread::LockGuard txLock( mTXMutex );
+    FrameRingBase &queue = *mTXQueue[ TC_CONTROL ];
+    Frame *slotFrame     = queue.reserve();
+    if ( !slotFrame )
     {
-      /*-----------------------------------------------------------------------
-      Read out the data associated with the frame
-      -----------------------------------------------------------------------*/
-      size_t readSize = mPhyHandle.cfg.hwStaticPayloadWidth;
-      if ( !readSize )
-      {
-        RT_HARD_ASSERT( false );    // Currently not supported
-        readSize = Physical::getAvailablePayloadSize( mPhyHandle, pipe );
-      }
+      return false;
+    }
 
-      FrameBuffer tmpBuffer{ 0 };
-      auto read_result = Physical::readPayload( mPhyHandle, tmpBuffer.data(), readSize );
-      RT_HARD_ASSERT( read_result == Chimera::Status::OK );
+    initTXFrame( *slotFrame, target, mPhyHandle );
+    slotFrame->wireData.control.totalFrames = 1;
+    slotFrame->wireData.control.endpoint    = Endpoint::EP_NETWORK_SERVICES;
+    slotFrame->writeUserData( &msg, sizeof( msg ) );
+
+    queue.commit();
+    signalEvent( SVC_EVT_TX_ENQUEUE );
+    return true;
+  }
 
-      /*-----------------------------------------------------------------------
-      Create a new frame
-      -----------------------------------------------------------------------*/
-      Frame tempFrame;
-      tempFrame.unpack( tmpBuffer );
-      tempFrame.receivedPipe = pipe;
 
+  bool DataLink::tdmaHold( Frame &frame )
+  {
+    this->lock();
+    uint32_t hold_us = 0;
+    bool held        = false;
+    if ( mTDMA.active() )
+    {
       /*-----------------------------------------------------------------------
-      Enqueue the frame if possible, Otherwise the data is simply lost.
+      Only one frame is on air at a time under a schedule. A frame pipelined
+      behind another can't know when the first one's retries will let it out,
+      so it waits for the first to finish and is checked against the slot then.
       -----------------------------------------------------------------------*/
-      Chimera::Thread::LockGuard _lock( *this ); // Protect stats update
-      if ( !mRXQueue.full() )
+      if ( mTCB.inFlight )
       {
-        mStats.rx_bytes += readSize;
-        mStats.frame_rx += 1;
-
-        mRXQueue.push( tempFrame );
+        held = true;
       }
       else
       {
-        mPhyHandle.rxQueueOverflows++;
-        mCBService_registry.call<CallbackId::CB_ERROR_RX_QUEUE_FULL>();
-
-        if ( !mRXQueue.full() )
+        /*---------------------------------------------------------------------
+        Give up retries rather than run a frame past the end of the slot
+        ---------------------------------------------------------------------*/
+        while ( ( frame.rtxCount > Physical::ART_COUNT_DISABLED ) && ( frame.rtxCount <= Physical::ART_COUNT_15 ) &&
+                ( frameWorstCaseTime( frame, mPhyHandle ) > mTDMA.window() ) )
         {
-          mRXQueue.push( tempFrame );
+          frame.rtxCount = static_cast<Physical::AutoRetransmitCount>( frame.rtxCount - 1u );
         }
-        else
+
+        /*---------------------------------------------------------------------
+        Without network time there is no way to find the slot, so an unsynced
+        node falls back to contention rather than going silent
+        ---------------------------------------------------------------------*/
+        uint64_t global_us = 0;
+        if ( mTimeSync.toGlobal( mTimeSync.extend( static_cast<uint32_t>( Chimera::micros() ) ), global_us ) )
         {
-          mStats.rx_bytes_lost += readSize;
-          mStats.frame_rx_drop += 1;
-          LOG_ERROR( "RX frame lost due to netif queue full\r\n" );
+          hold_us = mTDMA.holdTime( global_us, frameWorstCaseTime( frame, mPhyHandle ) );
+          held    = ( hold_us != 0 );
         }
       }
-
-      /*-----------------------------------------------------------------------
-      Check for more data to read from the RX FIFO
-      -----------------------------------------------------------------------*/
-      pipe = Physical::getAvailablePayloadPipe( mPhyHandle );
     }
+    this->unlock();
 
-    /*-------------------------------------------------------------------------
-    Go back to listening. The TX process is mutually exclusive, so it's ok to
-    transition to this state.
-    -------------------------------------------------------------------------*/
-    mFSMControl.receive( Physical::FSM::MsgStartRX() );
-    mCBService_registry.call<CallbackId::CB_RX_SUCCESS>();
+    mTDMAHold_us = hold_us;
+    return held;
   }
 
 
-  void DataLink::retransmitFrame( Frame &frame, const bool rtxBackoff )
+  void DataLink::retransmitFrame()
   {
     /*-------------------------------------------------------------------------
-    Input Protection
+    The frame being retried never leaves the front of the TX queue, so it can
+    only be lost by running out of attempts.
     -------------------------------------------------------------------------*/
+    Frame &frame = txQueue().front();
+
     if ( frame.txAttempts > NRF_LINK_FRAME_RETRIES )
     {
+      TrafficCounters::add( mCounters.frame_tx_drop );
+      TrafficCounters::add( mCounters.tx_bytes_lost, frame.size() );
+      txQueue().pop();
+
       LOG_ERROR( "Transmit fail. Frame exceeded link layer retry attempts\r\n" );
       return;
     }
 
     /*-------------------------------------------------------------------------
-    Update the runtime data
+    Don't burn the retries on a neighbor that was already declared gone
     -------------------------------------------------------------------------*/
-    frame.txAttempts++;
-    if ( rtxBackoff && ( frame.rtxDelay < Physical::AutoRetransmitDelay::ART_DELAY_MAX ) )
+    if ( mARPPending.unreachable( frame.nextHop, Chimera::millis(), NRF_LINK_ARP_NEGATIVE_TIMEOUT_MS ) )
     {
-      frame.rtxDelay = static_cast<Physical::AutoRetransmitDelay>( static_cast<size_t>( frame.rtxDelay ) + 1 );
+      TrafficCounters::add( mCounters.frame_tx_drop );
+      TrafficCounters::add( mCounters.tx_bytes_lost, frame.size() );
+      txQueue().pop();
+
+      LOG_ERROR_IF( DEBUG_MODULE, "Transmit fail. Node %d is unreachable\r\n", frame.nextHop );
+      return;
     }
 
     /*-------------------------------------------------------------------------
-    Push to the transmit queue
+    Update the runtime data
+    -------------------------------------------------------------------------*/
+    frame.txAttempts++;
+  }
+
+
+  void DataLink::updateStats()
+  {
+    /*-------------------------------------------------------------------------
+    Local Constants
     -------------------------------------------------------------------------*/
-    Chimera::Thread::LockGuard _lock( mTXMutex );
+    static constexpr size_t UPDATES_PER_SECOND = Chimera::Thread::TIMEOUT_1S / NRF_STAT_UPDATE_PERIOD_MS;
 
-    if ( !mTXQueue.full() )
+    /*-------------------------------------------------------------------------
+    Calculation period elapsed? Only the service thread gets here.
+    -------------------------------------------------------------------------*/
+    if ( ( Chimera::millis() - mStatsTime ) < NRF_STAT_UPDATE_PERIOD_MS )
     {
-      mTXQueue.push( frame );
+      return;
     }
-    else
+
+    /*-------------------------------------------------------------------------
+    Update statistics
+    -------------------------------------------------------------------------*/
+    mStatsTime = Chimera::millis();
+    Chimera::Thread::LockGuard _lock( *this );
+
+    const uint32_t tx_bytes = mCounters.tx_bytes.load( std::memory_order_relaxed );
+    const uint32_t rx_bytes = mCounters.rx_bytes.load( std::memory_order_relaxed );
+
+    mStats.link_speed_tx = ( tx_bytes - mStatsTXBytes ) * UPDATES_PER_SECOND;
+    mStats.link_speed_rx = ( rx_bytes - mStatsRXBytes ) * UPDATES_PER_SECOND;
+    mStatsTXBytes        = tx_bytes;
+    mStatsRXBytes        = rx_bytes;
+
+    /*-------------------------------------------------------------------------
+    Radio mode statistics
+    -------------------------------------------------------------------------*/
+    using namespace Physical::FSM;
+    const TransitionStats &fsmStats = mFSMControl.transitionStats();
+
+    mStats.mode_transitions         = fsmStats.transitions;
+    mStats.mode_transitions_skipped = fsmStats.skipped;
+    mStats.mode_time_off_ms         = static_cast<uint32_t>( fsmStats.timeInState_us[ StateId::POWERED_OFF ] / 1000 );
+    mStats.mode_time_standby_ms     = static_cast<uint32_t>( fsmStats.timeInState_us[ StateId::STANDBY_1 ] / 1000 );
+    mStats.mode_time_rx_ms          = static_cast<uint32_t>( fsmStats.timeInState_us[ StateId::RX_MODE ] / 1000 );
+    mStats.mode_time_tx_ms          = static_cast<uint32_t>( fsmStats.timeInState_us[ StateId::TX_MODE ] / 1000 );
+  }
+
+
+  void DataLink::signalEvent( const uint32_t event )
+  {
+    using namespace Chimera::Thread;
+
+    /*-------------------------------------------------------------------------
+    Only the first event raised since the thread last ran needs to wake it
+    -------------------------------------------------------------------------*/
+    const uint32_t previous = mEvents.fetch_or( event );
+    if ( !previous )
     {
-      Chimera::Thread::LockGuard _lock2( *this );
-      mStats.frame_tx_drop += 1;
-      mStats.tx_bytes_lost += frame.size();
-      LOG_ERROR( "Lost frame in retransmit attempt. TX queue full.\r\n" );
+      sendTaskMsg( mTaskId, TSK_MSG_WAKEUP, TIMEOUT_DONT_WAIT );
     }
   }
 
 
-  void DataLink::updateStats()
+  size_t DataLink::nextWakeupDelay()
   {
     /*-------------------------------------------------------------------------
-    Local Constants
+    Local helper to get the time left until a deadline, in ms
     -------------------------------------------------------------------------*/
-    static constexpr size_t UPDATES_PER_SECOND = Chimera::Thread::TIMEOUT_1S / NRF_STAT_UPDATE_PERIOD_MS;
+    const size_t now = Chimera::millis();
+    auto remaining   = [ now ]( const size_t start, const size_t timeout ) -> size_t {
+      const size_t elapsed = now - start;
+      return ( elapsed < timeout ) ? ( timeout - elapsed ) : 0;
+    };
+
+    size_t delay = NRF_LINK_IDLE_PERIOD_MS;
+
+    /*-------------------------------------------------------------------------
+    Frames in flight time out
+    -------------------------------------------------------------------------*/
+    if ( mTCB.inProgress() )
+    {
+      delay = std::min( delay, remaining( mTCB.oldest().start, mTCB.oldest().timeout ) );
+    }
+
+    /*-------------------------------------------------------------------------
+    Staged ACK payloads get pulled back
+    -------------------------------------------------------------------------*/
+    if ( mACB.staged )
+    {
+      delay = std::min( delay, remaining( mACB.stagedStart, NRF_LINK_ACK_PAYLOAD_TIMEOUT_MS ) );
+    }
+
+    /*-------------------------------------------------------------------------
+    Address resolution requests get retried
+    -------------------------------------------------------------------------*/
+    if ( mARPPending.active() )
+    {
+      delay = std::min<size_t>( delay, NRF_LINK_ARP_RETRY_MS );
+    }
+
+    /*-------------------------------------------------------------------------
+    Scheduled channel hops and survey samples
+    -------------------------------------------------------------------------*/
+    if ( mHopCB.pending )
+    {
+      delay = std::min( delay, remaining( mHopCB.start, mHopCB.delay ) );
+    }
+
+    if ( NRF_LINK_CHANNEL_SURVEY_PERIOD_MS )
+    {
+      delay = std::min<size_t>( delay, remaining( mSurvey.lastSample, NRF_LINK_CHANNEL_SURVEY_PERIOD_MS ) );
+    }
+
+    /*-------------------------------------------------------------------------
+    Quiet neighbors get checked on
+    -------------------------------------------------------------------------*/
+    for ( size_t idx = 0; NRF_LINK_KEEPALIVE_MS && ( idx < PEER_LIVENESS_ELEMENTS ); idx++ )
+    {
+      if ( const PeerState *peer = mLiveness.peer( idx ) )
+      {
+        const size_t probe = std::max( peer->lastHeard, peer->lastProbe );
+        delay              = std::min<size_t>( delay, remaining( probe, NRF_LINK_KEEPALIVE_MS ) );
+        delay              = std::min<size_t>( delay, remaining( peer->lastHeard, NRF_LINK_PEER_DEAD_MS ) );
+      }
+    }
+
+    /*-------------------------------------------------------------------------
+    Clock sync beacons go out on schedule
+    -------------------------------------------------------------------------*/
+    if ( NRF_LINK_TIME_SYNC_PERIOD_MS && mTimeSync.canBeacon() )
+    {
+      delay = std::min<size_t>( delay, remaining( mLastBeacon, NRF_LINK_TIME_SYNC_PERIOD_MS ) );
+    }
 
     /*-------------------------------------------------------------------------
-    Calculation period elapsed?
+    Frames held back by the TX rate limiter are retried on the next tick, and
+    those waiting on their TDMA slot once it comes around. If the pipeline is
+    full, the radio IRQ is what frees it up instead.
     -------------------------------------------------------------------------*/
-    static size_t last_update   = Chimera::millis();
-    static PerfStats last_stats = mStats;
+    if ( pendingTXFrames() && ( mTCB.inFlight < NRF_LINK_TX_PIPELINE_DEPTH ) )
+    {
+      const size_t hold = ( mTDMAHold_us + 999u ) / 1000u;
+      delay             = std::min<size_t>( delay, std::max<size_t>( hold, 1 ) );
+    }
+
+    return delay;
+  }
+
 
-    if ( ( Chimera::millis() - last_update ) < NRF_STAT_UPDATE_PERIOD_MS )
+  void DataLink::recordTXLatency( const Frame &frame )
+  {
+    /*-------------------------------------------------------------------------
+    Retransmissions would skew the request-to-air measurement
+    -------------------------------------------------------------------------*/
+    if ( frame.txAttempts > 1 )
     {
       return;
     }
 
+    const uint32_t latency = static_cast<uint32_t>( Chimera::micros() - frame.queuedTime_us );
+    mLatency.record( LAT_LINK_QUEUE, latency );
+
     /*-------------------------------------------------------------------------
-    Update statistics
+    Smooth with a cheap EMA (alpha = 1/8) to avoid large sample buffers. Only
+    this thread writes the latency fields, so plain load/store is enough.
     -------------------------------------------------------------------------*/
-    last_update = Chimera::millis();
-    Chimera::Thread::LockGuard _lock( *this );
+    constexpr auto order = std::memory_order_relaxed;
+    const uint32_t avg   = mCounters.tx_latency_avg_us.load( order );
+    const uint32_t max   = mCounters.tx_latency_max_us.load( order );
 
-    mStats.link_speed_tx = ( mStats.tx_bytes - last_stats.tx_bytes ) * UPDATES_PER_SECOND;
-    mStats.link_speed_rx = ( mStats.rx_bytes - last_stats.rx_bytes ) * UPDATES_PER_SECOND;
+    mCounters.tx_latency_last_us.store( latency, order );
+    mCounters.tx_latency_max_us.store( std::max( max, latency ), order );
+    mCounters.tx_latency_avg_us.store( avg ? ( avg - ( avg / 8 ) + ( latency / 8 ) ) : latency, order );
 
-    last_stats = mStats;
+    if ( mTXClass == TC_CONTROL )
+    {
+      const uint32_t ctrlMax = mCounters.tx_ctrl_latency_us.load( order );
+      mCounters.tx_ctrl_latency_us.store( std::max( ctrlMax, latency ), order );
+    }
   }
 
 }    // namespace Ripple::NetIf::NRF24::DataLink
@@ -12,6 +12,9 @@
 #ifndef RIPPLE_DATA_LINK_THREAD_HPP
 #define RIPPLE_DATA_LINK_THREAD_HPP
 
+/* STL Includes */
+#include <atomic>
+
 /* Chimera Includes */
 #include <Chimera/thread>
 
@@ -23,8 +26,15 @@
 #include <Ripple/src/netstack/context.hpp>
 #include <Ripple/src/netif/device_intf.hpp>
 #include <Ripple/src/netif/nrf24l01/cmn_memory_config.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_estimator.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_liveness.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_ring.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_session.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_tdma.hpp>
+#include <Ripple/src/netif/nrf24l01/datalink/data_link_timesync.hpp>
 #include <Ripple/src/netif/nrf24l01/datalink/data_link_types.hpp>
 #include <Ripple/src/netif/nrf24l01/physical/phy_fsm_controller.hpp>
+#include <Ripple/src/shared/cmn_static.hpp>
 
 
 namespace Ripple::NetIf::NRF24::DataLink
@@ -54,13 +64,17 @@ namespace Ripple::NetIf::NRF24::DataLink
     bool powerUp( void * context ) final override;
     void powerDn() final override;
     Chimera::Status_t recv( Fragment_sPtr &fragmentList ) final override;
-    Chimera::Status_t send( const Fragment_sPtr msg, const IPAddress &ip ) final override;
+    Chimera::Status_t send( const Fragment_sPtr msg, const IPAddress &ip, const TrafficClass tc ) final override;
+    Chimera::Status_t sendMulticast( const Fragment_sPtr msg, const uint8_t repeats, const TrafficClass tc ) final override;
     void getStats( PerfStats &stats ) final override;
+    void getLatencyStats( LatencyReport &report ) final override;
     IARP *addressResolver() final override;
     size_t maxTransferSize() const final override;
+    size_t maxUnfragmentedSize() const final override;
     size_t maxNumFragments() const final override;
     size_t linkSpeed() const final override;
     size_t lastActive() const final override;
+    bool networkTime( uint64_t &now_us ) final override;
 
     /*-------------------------------------------------------------------------------
     ARP Interface
@@ -108,6 +122,71 @@ namespace Ripple::NetIf::NRF24::DataLink
      */
     Physical::MACAddress getEndpointMAC( const Endpoint endpoint );
 
+    /**
+     *  Binds a remote node to one of the local RX pipes. Frames going to that
+     *  node are staged as ACK payloads on the pipe instead of being transmitted,
+     *  returning to the node inside the ACK of its next transmission. Frames not
+     *  collected in time fall back to a normal transmission.
+     *
+     *  @note Requires the ackPayloads config option and dynamic payloads on the pipe
+     *
+     *  @param[in]  node        Remote node known to transmit on the pipe
+     *  @param[in]  pipe        Local RX pipe the node transmits on
+     *  @return Chimera::Status_t
+     */
+    Chimera::Status_t bindAckPayloadPipe( const IPAddress &node, const Physical::PipeNumber pipe );
+
+    /**
+     *  Removes a node binding created by bindAckPayloadPipe()
+     *
+     *  @param[in]  pipe        Local RX pipe to unbind
+     *  @return void
+     */
+    void unbindAckPayloadPipe( const Physical::PipeNumber pipe );
+
+    /**
+     *  Routes a node through a relay. Frames for it are sent to the next hop on
+     *  the EP_DATA_FORWARDING endpoint, and frames passing through this node for
+     *  it are relayed one at a time without rebuilding the packet.
+     *
+     *  @note Nodes are named on air by the low byte of their IP address, which
+     *        must be unique among the routed destinations.
+     *
+     *  @param[in]  destination Node that can't be reached directly
+     *  @param[in]  nextHop     Neighbor that is closer to the destination
+     *  @return Chimera::Status_t
+     */
+    Chimera::Status_t addRoute( const IPAddress &destination, const IPAddress &nextHop );
+
+    /**
+     *  Removes a route created by addRoute()
+     *
+     *  @param[in]  destination Node to stop routing
+     *  @return void
+     */
+    void dropRoute( const IPAddress &destination );
+
+    /**
+     *  Moves the network to a new RF channel. Every node in the ARP cache is
+     *  told of the move over EP_NETWORK_SERVICES, then after a short delay to
+     *  let the announcements land, this node follows.
+     *
+     *  @note Nodes not in the ARP cache are not told and will be left behind
+     *
+     *  @param[in]  channel     Channel to move to
+     *  @return Chimera::Status_t
+     */
+    Chimera::Status_t requestChannelHop( const Physical::RFChannel channel );
+
+    /**
+     *  Gets a snapshot of the activity seen on each channel by the background
+     *  channel survey.
+     *
+     *  @param[out] survey      Latest survey results
+     *  @return void
+     */
+    void getChannelSurvey( ChannelSurvey &survey );
+
     /**
      * @brief Assign the physical layer configuration
      *
@@ -115,6 +194,143 @@ namespace Ripple::NetIf::NRF24::DataLink
      */
     void assignConfig( Physical::Handle &handle );
 
+    /**
+     *  Transmits only some of the fragments in a message, leaving the rest to
+     *  be sent some other way. Otherwise behaves exactly like send().
+     *
+     *  @param[in]  head        Root of the message to send
+     *  @param[in]  ip          Address to send to
+     *  @param[in]  tc          Priority class of the message
+     *  @param[in]  selection   Bit N set sends the Nth fragment in the list
+     *  @return Chimera::Status_t
+     */
+    Chimera::Status_t sendSelected( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc,
+                                    const FragmentMask selection );
+
+    /**
+     *  Checks whether sendSelected() would take the fragments right now, without
+     *  queueing any. Room found stays there while txProducerLock() is held.
+     *
+     *  @param[in]  head        Root of the message to check
+     *  @param[in]  ip          Address it would be sent to
+     *  @param[in]  tc          Priority class of the message
+     *  @param[in]  selection   Bit N set checks the Nth fragment in the list
+     *  @return Chimera::Status_t   What sendSelected() would return
+     */
+    Chimera::Status_t checkSelected( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc,
+                                     const FragmentMask selection );
+
+    /**
+     *  Gets the number of frames sitting in a TX queue, including any in flight
+     *
+     *  @param[in]  tc          Queue to check
+     *  @return size_t
+     */
+    size_t txQueueDepth( const TrafficClass tc ) const;
+
+    /**
+     *  Gets the number of frames that can still be queued for a class
+     *
+     *  @param[in]  tc          Queue to check
+     *  @return size_t
+     */
+    size_t txQueueSpace( const TrafficClass tc ) const;
+
+    /**
+     *  Gets the lock that serializes TX producers. Holding it keeps the room
+     *  reported by txQueueSpace() until the caller's own sends are queued. The
+     *  lock is recursive, so sends may be made while holding it.
+     *
+     *  @return Chimera::Thread::RecursiveTimedMutex&
+     */
+    Chimera::Thread::RecursiveTimedMutex &txProducerLock()
+    {
+      return mTXMutex;
+    }
+
+    /**
+     *  Keeps the radio listening on its operating channel at all times. The
+     *  background channel survey is skipped, as it briefly tunes away.
+     *
+     *  @note Call before powerUp()
+     *
+     *  @param[in]  enable      Whether the radio is dedicated to RX
+     *  @return void
+     */
+    void setDedicatedRX( const bool enable );
+
+    /**
+     *  Snapshots this node's address, root MAC, channel and ARP cache into a
+     *  persistent store, so a later boot can skip discovery.
+     *
+     *  @param[in]  store       Where to keep the snapshot
+     *  @param[in]  coordinator Node to handshake with on resume. Must be in the ARP cache.
+     *  @return Chimera::Status_t
+     */
+    Chimera::Status_t saveSession( ISessionStore &store, const IPAddress coordinator );
+
+    /**
+     *  Rejoins the network from the last saved snapshot. The address, root MAC,
+     *  channel and ARP entries are put back, then the coordinator is asked to
+     *  confirm with a direct ARP request, skipping the discovery broadcast.
+     *
+     *  If the coordinator doesn't answer in time, the restored ARP entries are
+     *  dropped again, so every node is resolved by broadcast as on a cold start.
+     *  The address and channel are left as restored.
+     *
+     *  @note Call after powerUp()
+     *
+     *  @param[in]  store       Where the snapshot was kept
+     *  @param[in]  timeout     Longest to wait for the coordinator (ms)
+     *  @return bool            True if the coordinator confirmed the session
+     */
+    bool resumeSession( ISessionStore &store, const size_t timeout );
+
+    /**
+     *  Makes this node the source of network time. Every other node follows
+     *  the master with the lowest address it can hear, directly or through
+     *  synced neighbors.
+     *
+     *  @note Call after powerUp(), the master is known by its address
+     *
+     *  @param[in]  enable      Whether to be the master
+     *  @return void
+     */
+    void setTimeMaster( const bool enable );
+
+    /**
+     *  Gets what this node knows about the network clock
+     *
+     *  @param[out] status      Output for the state
+     *  @return void
+     */
+    void getTimeSyncStatus( TimeSyncStatus &status );
+
+    /**
+     *  Hands a node its TDMA slot. Once it has one and its clock is synced, it
+     *  only starts a transmit when the frame fits inside its slot, so nodes
+     *  sharing the channel never collide. Every node on the channel needs its
+     *  own slot of the same schedule, this one included.
+     *
+     *  Slots should be a few ms long, the DataLink thread sleeps in ms.
+     *
+     *  @param[in]  node        Node to assign, may be this one
+     *  @param[in]  slot        Slot the node owns
+     *  @param[in]  numSlots    Slots in one frame of the schedule, zero for contention
+     *  @param[in]  slot_us     Length of every slot
+     *  @return Chimera::Status_t
+     */
+    Chimera::Status_t assignTDMASlot( const IPAddress node, const uint8_t slot, const uint8_t numSlots,
+                                      const uint32_t slot_us );
+
+    /**
+     *  Gets this node's TDMA slot assignment
+     *
+     *  @param[out] status      Output for the state
+     *  @return void
+     */
+    void getTDMAStatus( TDMAStatus &status );
+
   protected:
     /**
      *  Initializes the radio with the user configured settings
@@ -142,23 +358,58 @@ namespace Ripple::NetIf::NRF24::DataLink
     void irqPinAsserted( void *arg );
 
     /**
-     *  Handle the IRQ event when a transmission succeeded
+     *  Handle the IRQ event when a transmission succeeded. Retires frames in
+     *  flight in the order they were loaded into the hardware FIFO.
      *  @return void
      */
     void processTXSuccess();
 
     /**
-     *  Handle the IRQ event when a transmission failed
+     *  Works out how many of the frames in flight have left the TX FIFO, going
+     *  by what was loaded and the FIFO status flags. Called on a TX_DS event.
+     *
+     *  @param[in]  fifoEmpty   Whether the TX FIFO has drained
+     *  @return size_t          Number of frames to retire, oldest first
+     */
+    size_t txFramesDone( const bool fifoEmpty );
+
+    /**
+     *  Handle the IRQ event when a transmission failed. The oldest frame in
+     *  flight is retransmitted and any frames queued behind it are requeued.
      *  @return void
      */
     void processTXFail();
 
     /**
-     *  Periodic process to transmit a frame enqueued with the service
+     *  Periodic process to transmit frames enqueued with the service. Keeps
+     *  the hardware TX FIFO loaded with frames going to the same destination.
      *  @return void
      */
     void processTXQueue();
 
+    /**
+     *  Picks the traffic class the next transfer is served from. Classes are
+     *  served in strict priority order, except that frames waiting long enough
+     *  are promoted one class per NRF_LINK_TX_AGING_MS. Classes that end up
+     *  level are served oldest frame first, which bounds the wait of a
+     *  promoted class. Aging never promotes a frame ahead of control traffic.
+     *
+     *  @return TrafficClass    TC_NUM_OPTIONS if nothing is waiting
+     */
+    TrafficClass selectTXClass();
+
+    /**
+     *  Counts the queued frames that are neither in flight nor staged
+     *  @return size_t
+     */
+    size_t pendingTXFrames() const;
+
+    /**
+     *  Gets the TX queue the frames in flight or staged belong to
+     *  @return FrameRingBase &
+     */
+    FrameRingBase &txQueue();
+
     /**
      *  Periodic process to read a frame from the radio and queue it
      *  @return void
@@ -166,43 +417,293 @@ namespace Ripple::NetIf::NRF24::DataLink
     void processRXQueue();
 
     /**
-     * @brief Retransmits a pre-built frame
+     *  Stages frames at the front of the TX queue as ACK payloads, if they are
+     *  going to a node with a bound pipe and nothing else is waiting to be sent.
+     *  @return bool            True if the TX queue head was consumed by staging
+     */
+    bool processAckQueue();
+
+    /**
+     *  Handles a TX_DS event while in RX mode, which signals that an ACK payload
+     *  was sent back to the remote node.
+     *  @return void
+     */
+    void processAckSent();
+
+    /**
+     *  Flushes all staged ACK payloads out of the hardware and requeues them as
+     *  normal transmissions.
+     *  @return void
+     */
+    void evictAckPayloads();
+
+    /**
+     *  Samples the received power detector on the next channel of the survey
+     *  sweep. Only runs while the link is idle, as the radio briefly leaves the
+     *  operating channel to take the sample.
+     *  @return void
+     */
+    void processChannelSurvey();
+
+    /**
+     *  Moves to the new RF channel once a scheduled hop comes due
+     *  @return void
+     */
+    void processChannelHop();
+
+    /**
+     *  Handles a housekeeping frame received on EP_NETWORK_SERVICES. These are
+     *  consumed by the DataLink and never reach the network layer.
+     *
+     *  @param[in]  frame       Frame that was received
+     *  @return void
+     */
+    void processNetService( Frame &frame );
+
+    /**
+     *  Reserves the next RX queue slot so the radio can read a payload
+     *  straight into it. Invoked for each payload during an RX FIFO drain.
      *
-     * @param frame         Raw frame to transmit
-     * @param rtxBackoff    Use a backoff hardware level retransmit delay strategy
+     *  @param[in]  size        Number of bytes about to be read
+     *  @return void *          Wire data of the reserved slot, nullptr if none fits
+     */
+    void *reserveRXPayload( const size_t size );
+
+    /**
+     *  Publishes a payload read from the radio as a frame on the RX queue.
+     *  Payloads read into the slot from reserveRXPayload() are committed in
+     *  place, anything else is copied in. Invoked for each payload during an
+     *  RX FIFO drain.
+     *
+     *  @param[in]  pipe        Pipe the payload was received on
+     *  @param[in]  data        Raw payload data
+     *  @param[in]  size        Number of bytes in the payload
+     *  @return void
      */
-    void retransmitFrame( Frame &frame, const bool rtxBackoff );
+    void enqueueRXPayload( const Physical::PipeNumber pipe, const void *const data, const size_t size );
+
+    /**
+     *  Parks a frame whose next hop is missing from the ARP cache, starting
+     *  address resolution for it. The frame is dropped if the node recently
+     *  failed to resolve or there is no room to park it.
+     *
+     *  @param[in]  frame       Frame to park
+     *  @return void
+     */
+    void parkTXFrame( Frame &frame );
+
+    /**
+     *  Drives address resolution for nodes with parked frames. Releases the
+     *  frames once resolved, retries requests, and gives up after too many.
+     *  @return void
+     */
+    void processARPPending();
+
+    /**
+     *  Moves the frames parked for a node back into their TX queues
+     *
+     *  @param[in]  ip          Node that was resolved
+     *  @return void
+     */
+    void releaseParkedFrames( const IPAddress ip );
+
+    /**
+     *  Queues an ARP request or reply on the control TX queue
+     *
+     *  @param[in]  id          NET_SVC_ARP_REQUEST or NET_SVC_ARP_REPLY
+     *  @param[in]  target      Node being resolved, or requester being answered
+     *  @param[in]  direct      Send a request straight to a node already in the cache
+     *  @return bool            False if the control queue was full
+     */
+    bool sendARPMessage( const NetServiceId id, const IPAddress target, const bool direct = false );
+
+    /**
+     *  Checks in with neighbors that have gone quiet and drops the ones that
+     *  stayed silent for too long. Neighbors that ACK normal traffic are never
+     *  probed, the ACKs already prove they are there.
+     *  @return void
+     */
+    void processLiveness();
+
+    /**
+     *  Queues a keepalive to a neighbor on the control TX queue
+     *
+     *  @param[in]  target      Neighbor to check in with
+     *  @return bool            False if the control queue was full
+     */
+    bool sendKeepAlive( const IPAddress target );
+
+    /**
+     *  Sends clock sync beacons when due and drops a stale clock estimate
+     *  @return void
+     */
+    void processTimeSync();
+
+    /**
+     *  Queues a clock sync beacon or its follow up on the control TX queue
+     *
+     *  @param[in]  id          NET_SVC_TIME_SYNC or NET_SVC_TIME_FOLLOW_UP
+     *  @param[in]  seq         Beacon sequence number
+     *  @param[in]  global_us   Network time the beacon left at, follow ups only
+     *  @return bool            False if the control queue was full
+     */
+    bool sendTimeMessage( const NetServiceId id, const uint8_t seq, const uint64_t global_us );
+
+    /**
+     *  Queues a TDMA slot assignment to a node on the control TX queue
+     *
+     *  @param[in]  target      Node being assigned
+     *  @param[in]  slot        Slot the node owns
+     *  @param[in]  numSlots    Slots in one frame of the schedule
+     *  @param[in]  slot_us     Length of every slot
+     *  @return bool            False if the control queue was full
+     */
+    bool sendTDMASlot( const IPAddress target, const uint8_t slot, const uint8_t numSlots, const uint32_t slot_us );
+
+    /**
+     *  Checks if a frame has to wait for this node's TDMA slot, budgeting for
+     *  every retry it may make. Trims the frame's retries if they couldn't
+     *  all fit in the slot. Always false without a slot or without network
+     *  time.
+     *
+     *  @param[in]  frame       Frame about to be loaded, retry settings applied
+     *  @return bool            True if it has to wait
+     */
+    bool tdmaHold( Frame &frame );
+
+    /**
+     *  Handles a frame received on the EP_DATA_FORWARDING endpoint. Frames for
+     *  this node are turned back into normal data frames, everything else is
+     *  requeued toward the next hop or dropped.
+     *
+     *  @param[in]  frame       Frame that was received
+     *  @return bool            True if the frame was consumed
+     */
+    bool forwardFrame( Frame &frame );
+
+    /**
+     * @brief Retries the frame at the front of the TX queue
+     *
+     * The frame stays in its slot and is loaded again on the next pass, or is
+     * dropped once out of attempts. Retry settings are refreshed from the link
+     * estimator when it is loaded, so no backoff is applied here.
+     */
+    void retransmitFrame();
 
     /**
      * @brief Update runtime statistics of the driver
      */
     void updateStats();
 
+    /**
+     *  Flags work for the service thread and wakes it if it isn't already
+     *  pending. Safe to call from ISR context.
+     *
+     *  @param[in]  event       bfServiceEvent flags to raise
+     *  @return void
+     */
+    void signalEvent( const uint32_t event );
+
+    /**
+     *  Computes how long the service thread may sleep before the nearest
+     *  deadline it is tracking expires.
+     *
+     *  @return size_t          Sleep time in milliseconds
+     */
+    size_t nextWakeupDelay();
+
+    /**
+     *  Records the time between a frame being handed to the DataLink and it
+     *  being put on air.
+     *
+     *  @param[in]  frame       Frame that was just put on air
+     *  @return void
+     */
+    void recordTXLatency( const Frame &frame );
+
+    /**
+     *  Works out where the selected fragments of a message go and checks they
+     *  are valid and fit their TX queue. The mTXMutex must be held.
+     *
+     *  @param[in]  head        Root of the message
+     *  @param[in]  ip          Address it is sent to
+     *  @param[in]  tc          Priority class of the message
+     *  @param[in]  selection   Bit N set covers the Nth fragment in the list
+     *  @param[out] nextHop     Node the frames are handed to
+     *  @param[out] forward     The frames go through a relay
+     *  @return Chimera::Status_t   READY if the fragments can be queued
+     */
+    Chimera::Status_t planSelected( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc,
+                                    const FragmentMask selection, IPAddress &nextHop, bool &forward );
+
   private:
     /*-------------------------------------------------
     Class State Data
     -------------------------------------------------*/
     bool mSystemEnabled;             /**< Gating signal for the ISR handler to prevent spurious interrupts */
-    volatile bool pendingEvent;      /**< Signal flag set by an ISR that an event occurred */
+    bool mDedicatedRX;               /**< Radio never tunes away from its operating channel */
+    std::atomic<uint32_t> mEvents;   /**< Pending bfServiceEvent flags set by ISRs or other threads */
     Chimera::Thread::TaskId mTaskId; /**< Thread registration ID */
-    TransferControlBlock mTCB;       /**< TX control block */
+    TransferControlBlock mTCB;       /**< TX control block for all frames in flight */
     size_t mLastActive;              /**< Last time the system did some TX/RX activity */
     PerfStats mStats;                /**< Driver performance stats */
+    size_t mStatsTime;               /**< When the link speeds were last worked out (mS) */
+    uint32_t mStatsTXBytes;          /**< TX byte count the link speed was last worked out from */
+    uint32_t mStatsRXBytes;          /**< RX byte count the link speed was last worked out from */
+    TrafficCounters mCounters;       /**< Per-frame stats, updated without the lock */
+    LatencyRecorder mLatency;        /**< Per-stage latency histograms, updated without the lock */
+    ThreadProfiler mProfile;         /**< Service thread load, owned by that thread */
 
     Physical::MACAddress mEndpointMAC[ Endpoint::EP_NUM_OPTIONS ];
 
     /*-------------------------------------------------
     TX/RX Queues
     -------------------------------------------------*/
-    FrameQueue<TX_QUEUE_ELEMENTS> mTXQueue;        /**< Queue for data destined for the physical layer */
-    Chimera::Thread::RecursiveTimedMutex mTXMutex; /**< Thread safety lock */
-    FrameQueue<RX_QUEUE_ELEMENTS> mRXQueue;        /**< Queue for data coming from the physical layer */
-    Chimera::Thread::RecursiveTimedMutex mRXMutex; /**< Thread safety lock */
+    FrameRing<TX_QUEUE_CONTROL_ELEMENTS> mTXControl;   /**< Frames for TC_CONTROL */
+    FrameRing<TX_QUEUE_REALTIME_ELEMENTS> mTXRealtime; /**< Frames for TC_REALTIME */
+    FrameRing<TX_QUEUE_BULK_ELEMENTS> mTXBulk;         /**< Frames for TC_BULK */
+    FrameRingBase *mTXQueue[ TC_NUM_OPTIONS ];         /**< TX queue of each class, in flight or ACK staged ones first */
+    TrafficClass mTXClass;                             /**< Class of the frames currently in flight or staged */
+    AckPayloadControlBlock mACB;                       /**< Routing and timing of staged ACK payloads */
+    Chimera::Thread::RecursiveTimedMutex mTXMutex;     /**< Serializes TX producers, the consumer never takes it */
+    FrameRing<RX_QUEUE_ELEMENTS> mRXQueue;          /**< Queue for data coming from the physical layer */
+    Frame *mRXReserved;                             /**< RX slot the radio is reading the next payload into */
+    MulticastHistory mMulticastHistory;             /**< Multicast frames recently accepted */
+    ForwardingTable mForwardTable;                  /**< Nodes reached through a relay */
 
     /*-------------------------------------------------
     Lookup table for known device IP->MAC mappings
     -------------------------------------------------*/
     ARPCache mAddressCache;
+    ARPPendingTable mARPPending;
+    SessionControlBlock mSessionCB;
+    PeerLiveness mLiveness;
+
+    /*-------------------------------------------------
+    Per-destination retransmit tuning
+    -------------------------------------------------*/
+    LinkEstimator mLinkEstimator;
+
+    /*-------------------------------------------------
+    RF channel management
+    -------------------------------------------------*/
+    ChannelSurvey mSurvey;         /**< Background activity of every channel */
+    ChannelHopControlBlock mHopCB; /**< Scheduled channel move */
+
+    /*-------------------------------------------------
+    Network clock
+    -------------------------------------------------*/
+    TimeSync mTimeSync;                /**< Network time estimate, guarded by the DataLink lock */
+    std::atomic<uint32_t> mLastIRQ_us; /**< Time the radio IRQ last fired (uS) */
+    std::atomic<uint32_t> mIRQSeq;     /**< Radio IRQ edges seen, bumped after each stamp */
+    uint32_t mRXDrainSeq;              /**< mIRQSeq at the last RX FIFO drain */
+    uint32_t mRXStamp_us;              /**< IRQ stamp picked for the current drain */
+    bool mRXStampValid;                /**< mRXStamp_us marks the first payload of the drain */
+    size_t mRXPayloads;                /**< Payloads handled so far in the current drain */
+    size_t mLastBeacon;                /**< Last time a sync beacon was queued (ms) */
+    uint8_t mBeaconSeq;                /**< Sequence number of the last sync beacon */
+    TDMASchedule mTDMA;                /**< Slot assignment, guarded by the DataLink lock */
+    uint32_t mTDMAHold_us;             /**< Wait for the TDMA slot seen on the last TX pass */
 
     Context_rPtr mContext;
     Physical::Handle mPhyHandle;
@@ -229,6 +730,14 @@ namespace Ripple::NetIf::NRF24::DataLink
    */
   DataLink *createNetIf( Context_rPtr context );
 
+  /**
+   *  Creates a handle to a new NRF24 device in statically placed storage
+   *
+   *  @param[in]  slot          Storage to construct into
+   *  @return DataLink *        nullptr if the slot was already claimed
+   */
+  DataLink *createNetIf( StaticSlot<DataLink> &slot );
+
 }    // namespace Ripple::NetIf::NRF24::DataLink
 
 #endif /* !RIPPLE_DATA_LINK_THREAD_HPP */
@@ -0,0 +1,117 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_session.hpp
+ *
+ *  Description:
+ *    Snapshot of the link state a node needs to rejoin its network quickly,
+ *    kept in a project supplied persistent store across resets
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_DataLink_SESSION_HPP
+#define RIPPLE_DataLink_SESSION_HPP
+
+/* STL Includes */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Ripple Includes */
+#include <Ripple/src/netif/device_types.hpp>
+#include <Ripple/src/netif/nrf24l01/cmn_memory_config.hpp>
+#include <Ripple/src/netif/nrf24l01/physical/phy_device_types.hpp>
+#include <Ripple/src/shared/cmn_types.hpp>
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr uint32_t SESSION_MAGIC   = 0x52534E31; /**< "RSN1", changes whenever LinkSession does */
+  static constexpr size_t SESSION_NEIGHBORS = 8;          /**< Most ARP entries a snapshot carries */
+
+  static_assert( SESSION_NEIGHBORS <= ARP_CACHE_TABLE_ELEMENTS );
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  One cached IP->MAC mapping
+   */
+  struct SessionNeighbor
+  {
+    IPAddress ip;             /**< Node address */
+    uint32_t _pad;            /**< Pad for alignment */
+    Physical::MACAddress mac; /**< Root MAC of the node */
+  };
+
+  /**
+   *  Everything a node was using on the network when it last saved. Written
+   *  to the store as raw bytes, so it only has to survive on the same build.
+   */
+  struct LinkSession
+  {
+    uint32_t magic;                                 /**< SESSION_MAGIC if the snapshot is usable */
+    uint32_t crc;                                   /**< CRC32 of everything after this field */
+    IPAddress ip;                                   /**< Address this node was assigned */
+    IPAddress coordinator;                          /**< Node that answers the resume handshake */
+    Physical::MACAddress rootMAC;                   /**< Root MAC this node was using */
+    Physical::RFChannel channel;                    /**< Channel the network was on */
+    uint8_t numNeighbors;                           /**< Valid entries in neighbors */
+    uint8_t _pad[ 6 ];                              /**< Pad for alignment */
+    SessionNeighbor neighbors[ SESSION_NEIGHBORS ]; /**< ARP entries, the coordinator first */
+  };
+
+  /**
+   *  Tracks an in progress resume handshake. Written by the caller of
+   *  resumeSession() and the service thread, so it is lock free.
+   */
+  struct SessionControlBlock
+  {
+    std::atomic<IPAddress> coordinator; /**< Node the handshake is waiting on, zero if none */
+    std::atomic<bool> confirmed;        /**< The coordinator answered */
+
+    void reset()
+    {
+      coordinator.store( 0 );
+      confirmed.store( false );
+    }
+  };
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Project supplied persistent memory for a LinkSession, such as a flash
+   *  page or battery backed RAM. Only the bytes are stored, so the driver
+   *  needs to know nothing about the layout.
+   */
+  class ISessionStore
+  {
+  public:
+    virtual ~ISessionStore() = default;
+
+    /**
+     *  Reads back the last stored snapshot
+     *
+     *  @param[out] data        Where to copy the snapshot to
+     *  @param[in]  size        Bytes to read
+     *  @return bool            False if nothing has been stored
+     */
+    virtual bool load( void *const data, const size_t size ) = 0;
+
+    /**
+     *  Replaces the stored snapshot
+     *
+     *  @param[in]  data        Snapshot to store
+     *  @param[in]  size        Bytes to write
+     *  @return bool            Whether the write succeeded
+     */
+    virtual bool save( const void *const data, const size_t size ) = 0;
+  };
+
+}    // namespace Ripple::NetIf::NRF24::DataLink
+
+#endif /* !RIPPLE_DataLink_SESSION_HPP */
@@ -0,0 +1,99 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_tdma.cpp
+ *
+ *  Description:
+ *    Time slotted transmit schedule implementation details
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <algorithm>
+
+/* Ripple Includes */
+#include <Ripple/netif/nrf24l01>
+
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  TDMASchedule Implementation
+  -------------------------------------------------------------------------------*/
+  TDMASchedule::TDMASchedule() : mHolds( 0 )
+  {
+    clear();
+  }
+
+
+  void TDMASchedule::clear()
+  {
+    mSlot     = 0;
+    mNumSlots = 0;
+    mSlot_us  = 0;
+    mGuard_us = 0;
+  }
+
+
+  bool TDMASchedule::configure( const uint8_t slot, const uint8_t numSlots, const uint32_t slot_us, const uint32_t guard_us )
+  {
+    if ( !numSlots )
+    {
+      clear();
+      return true;
+    }
+
+    if ( ( slot >= numSlots ) || ( slot_us <= ( 2u * guard_us ) ) )
+    {
+      return false;
+    }
+
+    mSlot     = slot;
+    mNumSlots = numSlots;
+    mSlot_us  = slot_us;
+    mGuard_us = guard_us;
+    return true;
+  }
+
+
+  uint32_t TDMASchedule::holdTime( const uint64_t global_us, const uint32_t need_us )
+  {
+    if ( !active() )
+    {
+      return 0;
+    }
+
+    /*-------------------------------------------------
+    Where this node's usable window sits in the frame
+    -------------------------------------------------*/
+    const uint64_t frame_us = static_cast<uint64_t>( mNumSlots ) * mSlot_us;
+    const uint64_t pos      = global_us % frame_us;
+    const uint64_t open     = ( static_cast<uint64_t>( mSlot ) * mSlot_us ) + mGuard_us;
+    const uint64_t window   = mSlot_us - ( 2u * mGuard_us );
+    const uint64_t need     = std::min<uint64_t>( need_us, window );
+
+    if ( ( pos >= open ) && ( ( pos + need ) <= ( open + window ) ) )
+    {
+      return 0;
+    }
+
+    /*-------------------------------------------------
+    Too early, or too late to fit. Wait for the window
+    to open, in this frame or the next one.
+    -------------------------------------------------*/
+    mHolds++;
+    return static_cast<uint32_t>( ( pos < open ) ? ( open - pos ) : ( ( frame_us - pos ) + open ) );
+  }
+
+
+  void TDMASchedule::getStatus( TDMAStatus &status ) const
+  {
+    status.active   = active();
+    status.slot     = mSlot;
+    status.numSlots = mNumSlots;
+    status.slot_us  = mSlot_us;
+    status.guard_us = mGuard_us;
+    status.holds    = mHolds;
+  }
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
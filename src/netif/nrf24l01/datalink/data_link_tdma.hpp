@@ -0,0 +1,116 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_tdma.hpp
+ *
+ *  Description:
+ *    Time slotted transmit schedule, run on top of the network clock
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_DataLink_TDMA_HPP
+#define RIPPLE_DataLink_TDMA_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Current slot assignment of a node
+   */
+  struct TDMAStatus
+  {
+    bool active;       /**< Transmits are held to the assigned slot */
+    uint8_t slot;      /**< Slot owned by this node */
+    uint8_t numSlots;  /**< Slots in one frame of the schedule */
+    uint32_t slot_us;  /**< Length of every slot */
+    uint32_t guard_us; /**< Dead time kept at both ends of the slot */
+    uint32_t holds;    /**< Times a transmit was held for the slot to come around */
+  };
+
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Fixed TDMA schedule. Network time is cut into frames of numSlots equal
+   *  slots, and a node may only start a transmit inside its own slot, leaving
+   *  the guard time clear at both ends for clock error and radio turnaround.
+   *
+   *  Not thread safe, it's meant to be guarded by the DataLink lock.
+   */
+  class TDMASchedule
+  {
+  public:
+    TDMASchedule();
+
+    /**
+     *  Drops the slot assignment, going back to contention
+     *  @return void
+     */
+    void clear();
+
+    /**
+     *  Assigns this node a slot. Zero slots drops the assignment.
+     *
+     *  @param[in]  slot        Slot owned by this node
+     *  @param[in]  numSlots    Slots in one frame of the schedule
+     *  @param[in]  slot_us     Length of every slot
+     *  @param[in]  guard_us    Dead time to keep at both ends of the slot
+     *  @return bool            False if the slot doesn't exist or is all guard time
+     */
+    bool configure( const uint8_t slot, const uint8_t numSlots, const uint32_t slot_us, const uint32_t guard_us );
+
+    /**
+     *  Checks if a slot assignment is in effect
+     *  @return bool
+     */
+    bool active() const
+    {
+      return mNumSlots != 0;
+    }
+
+    /**
+     *  Works out how long a transmit has to wait for room in this node's slot.
+     *  A transmit longer than the usable slot only has to wait for its start.
+     *
+     *  @param[in]  global_us   Current network time
+     *  @param[in]  need_us     Air time the transmit needs
+     *  @return uint32_t        Wait until it may start (uS), zero if it can go now
+     */
+    uint32_t holdTime( const uint64_t global_us, const uint32_t need_us );
+
+    /**
+     *  Gets the part of the slot a transmit may use, between the guards
+     *  @return uint32_t        Usable time (uS), zero when not active
+     */
+    uint32_t window() const
+    {
+      return active() ? ( mSlot_us - ( 2u * mGuard_us ) ) : 0;
+    }
+
+    /**
+     *  Gets the slot assignment
+     *
+     *  @param[out] status      Output for the state
+     *  @return void
+     */
+    void getStatus( TDMAStatus &status ) const;
+
+  private:
+    uint8_t mSlot;      /**< Slot owned by this node */
+    uint8_t mNumSlots;  /**< Slots in one frame, zero when not active */
+    uint32_t mSlot_us;  /**< Length of every slot */
+    uint32_t mGuard_us; /**< Dead time kept at both ends of the slot */
+    uint32_t mHolds;    /**< Transmits held for the slot */
+  };
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
+
+#endif  /* !RIPPLE_DataLink_TDMA_HPP */
@@ -0,0 +1,303 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_timesync.cpp
+ *
+ *  Description:
+ *    Network clock sync implementation details
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <cstring>
+
+/* Ripple Includes */
+#include <Ripple/netif/nrf24l01>
+
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  TimeSync Implementation
+  -------------------------------------------------------------------------------*/
+  TimeSync::TimeSync() : mMaster( false ), mLocalClock_us( 0 )
+  {
+    clear();
+  }
+
+
+  void TimeSync::clear()
+  {
+    mRoot            = 0;
+    mParent          = 0;
+    mParentLevel     = TIME_SYNC_NO_LEVEL;
+    mLastSample      = 0;
+    mCaptured        = false;
+    mCaptureSender   = 0;
+    mCaptureRoot     = 0;
+    mCaptureLevel    = TIME_SYNC_NO_LEVEL;
+    mCaptureSeq      = 0;
+    mCaptureLocal_us = 0;
+    mNumSamples      = 0;
+    mNextSample      = 0;
+    mOutliers        = 0;
+    mTotalSamples    = 0;
+    mRejected        = 0;
+    mRefLocal_us     = 0;
+    mRefOffset_us    = 0;
+    mSkew            = 0.0f;
+    memset( mSamples, 0, sizeof( mSamples ) );
+  }
+
+
+  void TimeSync::setMaster( const bool enable, const IPAddress self )
+  {
+    clear();
+    mMaster = enable;
+    mRoot   = enable ? self : 0;
+  }
+
+
+  uint64_t TimeSync::extend( const uint32_t stamp_us )
+  {
+    if ( !mLocalClock_us )
+    {
+      mLocalClock_us = stamp_us;
+      return mLocalClock_us;
+    }
+
+    /*-------------------------------------------------
+    The signed distance from the last reading carries
+    the stamp across any wrap in between
+    -------------------------------------------------*/
+    const int32_t delta   = static_cast<int32_t>( stamp_us - static_cast<uint32_t>( mLocalClock_us ) );
+    const uint64_t result = mLocalClock_us + static_cast<int64_t>( delta );
+    if ( delta > 0 )
+    {
+      mLocalClock_us = result;
+    }
+
+    return result;
+  }
+
+
+  bool TimeSync::toGlobal( const uint64_t local_us, uint64_t &global_us ) const
+  {
+    if ( mMaster )
+    {
+      global_us = local_us;
+      return true;
+    }
+
+    if ( mNumSamples < TIME_SYNC_MIN_SAMPLES )
+    {
+      return false;
+    }
+
+    const int64_t elapsed = static_cast<int64_t>( local_us - mRefLocal_us );
+    global_us             = local_us + mRefOffset_us + static_cast<int64_t>( mSkew * static_cast<float>( elapsed ) );
+    return true;
+  }
+
+
+  void TimeSync::onSync( const IPAddress sender, const IPAddress root, const uint8_t level, const uint8_t seq,
+                         const uint64_t local_us )
+  {
+    /*-------------------------------------------------
+    The master answers to nobody. Everyone else stays
+    with their parent unless a beacon comes from closer
+    to the master, or from a master with a lower address
+    when two of them are competing.
+    -------------------------------------------------*/
+    if ( mMaster || ( level >= TIME_SYNC_NO_LEVEL ) )
+    {
+      return;
+    }
+
+    const bool unsynced   = ( mParentLevel == TIME_SYNC_NO_LEVEL );
+    const bool fromParent = ( sender == mParent ) && ( root == mRoot );
+    const bool closer     = ( root == mRoot ) && ( level < mParentLevel );
+    const bool betterRoot = ( root < mRoot );
+
+    if ( !unsynced && !fromParent && !closer && !betterRoot )
+    {
+      return;
+    }
+
+    mCaptured        = true;
+    mCaptureSender   = sender;
+    mCaptureRoot     = root;
+    mCaptureLevel    = level;
+    mCaptureSeq      = seq;
+    mCaptureLocal_us = local_us;
+  }
+
+
+  bool TimeSync::onFollowUp( const IPAddress sender, const uint8_t seq, const uint64_t global_us, const size_t now )
+  {
+    if ( mMaster )
+    {
+      return false;
+    }
+
+    if ( !mCaptured || ( sender != mCaptureSender ) || ( seq != mCaptureSeq ) )
+    {
+      mRejected++;
+      return false;
+    }
+
+    mCaptured = false;
+
+    const IPAddress root    = mCaptureRoot;
+    const uint8_t level     = mCaptureLevel;
+    const uint64_t local_us = mCaptureLocal_us;
+
+    /*-------------------------------------------------
+    A new parent has its own idea of network time, so
+    the old samples no longer fit the same line
+    -------------------------------------------------*/
+    if ( ( sender != mParent ) || ( root != mRoot ) )
+    {
+      const uint32_t rejected = mRejected;
+      const uint32_t total    = mTotalSamples;
+      clear();
+      mRejected     = rejected;
+      mTotalSamples = total;
+      mParent       = sender;
+      mRoot         = root;
+    }
+
+    /*-------------------------------------------------
+    Check the sample against the line so far. A stamp
+    that slipped past the RX checks would otherwise
+    drag the offset and skew with it.
+    -------------------------------------------------*/
+    uint64_t predicted_us = 0;
+    if ( ( mNumSamples >= TIME_SYNC_MIN_SAMPLES ) && toGlobal( local_us, predicted_us ) )
+    {
+      const int64_t residual = static_cast<int64_t>( global_us - predicted_us );
+      if ( ( residual > TIME_SYNC_MAX_RESIDUAL_US ) || ( residual < -TIME_SYNC_MAX_RESIDUAL_US ) )
+      {
+        mRejected++;
+        mOutliers++;
+        if ( mOutliers < TIME_SYNC_MAX_OUTLIERS )
+        {
+          return false;
+        }
+
+        const uint32_t rejected = mRejected;
+        const uint32_t total    = mTotalSamples;
+        clear();
+        mRejected     = rejected;
+        mTotalSamples = total;
+        mParent       = sender;
+        mRoot         = root;
+      }
+      else
+      {
+        mOutliers = 0;
+      }
+    }
+
+    mParentLevel = level;
+    mLastSample  = now;
+
+    mSamples[ mNextSample ] = { local_us, global_us };
+    mNextSample             = ( mNextSample + 1u ) % TIME_SYNC_SAMPLES;
+    mNumSamples             = ( mNumSamples < TIME_SYNC_SAMPLES ) ? ( mNumSamples + 1u ) : TIME_SYNC_SAMPLES;
+    mTotalSamples++;
+
+    refit();
+    return true;
+  }
+
+
+  bool TimeSync::expire( const size_t now, const size_t timeout )
+  {
+    if ( mMaster || ( mParentLevel == TIME_SYNC_NO_LEVEL ) || ( ( now - mLastSample ) < timeout ) )
+    {
+      return false;
+    }
+
+    const uint32_t rejected = mRejected;
+    const uint32_t total    = mTotalSamples;
+    clear();
+    mRejected     = rejected;
+    mTotalSamples = total;
+    return true;
+  }
+
+
+  bool TimeSync::canBeacon() const
+  {
+    return mMaster || ( mNumSamples >= TIME_SYNC_MIN_SAMPLES );
+  }
+
+
+  uint8_t TimeSync::beaconLevel() const
+  {
+    if ( mMaster )
+    {
+      return 0;
+    }
+
+    if ( !canBeacon() || ( mParentLevel >= ( TIME_SYNC_NO_LEVEL - 1u ) ) )
+    {
+      return TIME_SYNC_NO_LEVEL;
+    }
+
+    return mParentLevel + 1u;
+  }
+
+
+  void TimeSync::getStatus( TimeSyncStatus &status ) const
+  {
+    status.master    = mMaster;
+    status.synced    = mMaster || ( mNumSamples >= TIME_SYNC_MIN_SAMPLES );
+    status.level     = beaconLevel();
+    status.root      = mRoot;
+    status.parent    = mParent;
+    status.offset_us = mRefOffset_us;
+    status.skew      = mSkew;
+    status.samples   = mTotalSamples;
+    status.rejected  = mRejected;
+  }
+
+
+  void TimeSync::refit()
+  {
+    /*-------------------------------------------------
+    Least squares line of offset against local time.
+    Everything is taken relative to the first sample so
+    the sums stay small.
+    -------------------------------------------------*/
+    const uint64_t base = mSamples[ 0 ].local_us;
+
+    int64_t sumLocal  = 0;
+    int64_t sumOffset = 0;
+    for ( size_t idx = 0; idx < mNumSamples; idx++ )
+    {
+      sumLocal += static_cast<int64_t>( mSamples[ idx ].local_us - base );
+      sumOffset += static_cast<int64_t>( mSamples[ idx ].global_us - mSamples[ idx ].local_us );
+    }
+
+    const int64_t n         = static_cast<int64_t>( mNumSamples );
+    const int64_t meanLocal = sumLocal / n;
+    mRefLocal_us            = base + meanLocal;
+    mRefOffset_us           = sumOffset / n;
+
+    double num = 0.0;
+    double den = 0.0;
+    for ( size_t idx = 0; idx < mNumSamples; idx++ )
+    {
+      const double dl = static_cast<double>( static_cast<int64_t>( mSamples[ idx ].local_us - base ) - meanLocal );
+      const double dO =
+          static_cast<double>( static_cast<int64_t>( mSamples[ idx ].global_us - mSamples[ idx ].local_us ) - mRefOffset_us );
+      num += dl * dO;
+      den += dl * dl;
+    }
+
+    mSkew = ( den > 0.0 ) ? static_cast<float>( num / den ) : 0.0f;
+  }
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
@@ -0,0 +1,220 @@
+/********************************************************************************
+ *  File Name:
+ *    data_link_timesync.hpp
+ *
+ *  Description:
+ *    Network wide microsecond clock, kept in step by flooded sync beacons
+ *    timestamped at the radio IRQ
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_DataLink_TIMESYNC_HPP
+#define RIPPLE_DataLink_TIMESYNC_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_types.hpp>
+
+namespace Ripple::NetIf::NRF24::DataLink
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr size_t TIME_SYNC_SAMPLES          = 8;    /**< Beacons the clock estimate is fit over */
+  static constexpr size_t TIME_SYNC_MIN_SAMPLES      = 2;    /**< Beacons needed before the clock is trusted */
+  static constexpr uint8_t TIME_SYNC_NO_LEVEL        = 0xFF; /**< Level of a node that isn't synced */
+  static constexpr int64_t TIME_SYNC_MAX_RESIDUAL_US = 1000; /**< Furthest a sample may land from the fit */
+  static constexpr uint8_t TIME_SYNC_MAX_OUTLIERS    = 3;    /**< Outliers in a row before the fit restarts */
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  What a node knows about the network clock
+   */
+  struct TimeSyncStatus
+  {
+    bool master;        /**< This node is the time master */
+    bool synced;        /**< Network time is available */
+    uint8_t level;      /**< Hops from the master, TIME_SYNC_NO_LEVEL if not synced */
+    IPAddress root;     /**< Master being followed */
+    IPAddress parent;   /**< Neighbor the beacons come from */
+    int64_t offset_us;  /**< Network time minus local time, at the last beacon */
+    float skew;         /**< Rate the offset drifts at, in uS per uS */
+    uint32_t samples;   /**< Beacons accepted since startup */
+    uint32_t rejected;  /**< Follow ups that didn't match a captured sync or fell off the fit */
+  };
+
+  /**
+   *  One beacon, the local time it arrived at and the network time it left at
+   */
+  struct TimeSyncSample
+  {
+    uint64_t local_us;  /**< Local time the sync was received */
+    uint64_t global_us; /**< Network time the sync was sent */
+  };
+
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  FTSP style clock sync. The master floods sync beacons, each node fits a
+   *  line through the last few (local, network) time pairs to track both the
+   *  offset and the skew of its clock, and synced nodes then send beacons of
+   *  their own one level further out.
+   *
+   *  Sends are two step. The sync frame is timestamped by the sender when its
+   *  TX_DS fires and by the receiver when its RX_DR fires, then a follow up
+   *  carries the sender's timestamp across. Both ends stamp at the IRQ, so
+   *  queueing and SPI time on either side drop out.
+   *
+   *  Not thread safe, it's meant to be owned by the DataLink thread.
+   */
+  class TimeSync
+  {
+  public:
+    TimeSync();
+
+    /**
+     *  Forgets the clock estimate and where it came from. The master setting
+     *  and the local clock extension are kept.
+     *
+     *  @return void
+     */
+    void clear();
+
+    /**
+     *  Makes this node the source of network time, or stops it being one
+     *
+     *  @param[in]  enable      Whether to be the master
+     *  @param[in]  self        This node's address
+     *  @return void
+     */
+    void setMaster( const bool enable, const IPAddress self );
+
+    /**
+     *  Extends a 32 bit microsecond timestamp to 64 bits. Stamps a little in
+     *  the past are fine, but it must see the clock at least once per wrap.
+     *
+     *  @param[in]  stamp_us    Chimera::micros(), truncated
+     *  @return uint64_t
+     */
+    uint64_t extend( const uint32_t stamp_us );
+
+    /**
+     *  Converts a local time to network time
+     *
+     *  @param[in]  local_us    Local time, from extend()
+     *  @param[out] global_us   Network time
+     *  @return bool            False if not synced
+     */
+    bool toGlobal( const uint64_t local_us, uint64_t &global_us ) const;
+
+    /**
+     *  Records a sync beacon arriving. The network time comes later, in its
+     *  follow up. Beacons from nodes that wouldn't bring this one closer to
+     *  the master are ignored.
+     *
+     *  @param[in]  sender      Node that sent the beacon
+     *  @param[in]  root        Master the sender follows
+     *  @param[in]  level       Sender's hops from the master
+     *  @param[in]  seq         Beacon sequence number
+     *  @param[in]  local_us    Local time the beacon arrived
+     *  @return void
+     */
+    void onSync( const IPAddress sender, const IPAddress root, const uint8_t level, const uint8_t seq,
+                 const uint64_t local_us );
+
+    /**
+     *  Records the follow up to a beacon, adding a sample if it matches the
+     *  last one captured. Once synced, a sample further than
+     *  TIME_SYNC_MAX_RESIDUAL_US from the current fit is rejected. Enough of
+     *  those in a row means the parent's clock really moved, and the fit
+     *  starts over from the new sample.
+     *
+     *  @param[in]  sender      Node that sent the follow up
+     *  @param[in]  seq         Sequence number of the beacon it describes
+     *  @param[in]  global_us   Network time the beacon left the sender
+     *  @param[in]  now         Current time (ms)
+     *  @return bool            True if a sample was added
+     */
+    bool onFollowUp( const IPAddress sender, const uint8_t seq, const uint64_t global_us, const size_t now );
+
+    /**
+     *  Drops the estimate once beacons have stopped for too long
+     *
+     *  @param[in]  now         Current time (ms)
+     *  @param[in]  timeout     Longest to go without a beacon (ms)
+     *  @return bool            True if sync was lost
+     */
+    bool expire( const size_t now, const size_t timeout );
+
+    /**
+     *  Checks if this node should be sending beacons, as the master or as a
+     *  synced node relaying network time further out
+     *  @return bool
+     */
+    bool canBeacon() const;
+
+    /**
+     *  Level this node's beacons go out at
+     *  @return uint8_t
+     */
+    uint8_t beaconLevel() const;
+
+    /**
+     *  Master this node's beacons follow
+     *  @return IPAddress
+     */
+    IPAddress root() const
+    {
+      return mRoot;
+    }
+
+    /**
+     *  Gets what is known about the network clock
+     *
+     *  @param[out] status      Output for the state
+     *  @return void
+     */
+    void getStatus( TimeSyncStatus &status ) const;
+
+  private:
+    bool mMaster;              /**< This node is the time master */
+    IPAddress mRoot;           /**< Master being followed */
+    IPAddress mParent;         /**< Neighbor being synced to */
+    uint8_t mParentLevel;      /**< Parent's hops from the master */
+    size_t mLastSample;        /**< Last time a sample was added (ms) */
+
+    bool mCaptured;            /**< A sync is waiting for its follow up */
+    IPAddress mCaptureSender;  /**< Node the waiting sync came from */
+    IPAddress mCaptureRoot;    /**< Master the waiting sync follows */
+    uint8_t mCaptureLevel;     /**< Level the waiting sync was sent at */
+    uint8_t mCaptureSeq;       /**< Sequence number of the waiting sync */
+    uint64_t mCaptureLocal_us; /**< Local time the waiting sync arrived */
+
+    TimeSyncSample mSamples[ TIME_SYNC_SAMPLES ];
+    size_t mNumSamples;        /**< Valid entries in mSamples */
+    size_t mNextSample;        /**< Entry the next sample replaces */
+    uint8_t mOutliers;         /**< Samples rejected in a row for being off the fit */
+    uint32_t mTotalSamples;
+    uint32_t mRejected;
+
+    uint64_t mRefLocal_us;     /**< Mean local time of the fit */
+    int64_t mRefOffset_us;     /**< Mean offset of the fit */
+    float mSkew;               /**< Slope of the fit */
+
+    uint64_t mLocalClock_us;   /**< Latest extended local time */
+
+    void refit();
+  };
+
+}  // namespace Ripple::NetIf::NRF24::DataLink
+
+#endif  /* !RIPPLE_DataLink_TIMESYNC_HPP */
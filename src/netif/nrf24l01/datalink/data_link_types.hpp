@@ -14,15 +14,17 @@
 
 /* STL Includes */
 #include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstring>
+#include <initializer_list>
 
 /* Chimera Includes */
 #include <Chimera/thread>
 
-/* ETL Includes */
-#include <etl/queue.h>
-
 /* Ripple Includes */
+#include <Ripple/src/netif/nrf24l01/cmn_memory_config.hpp>
+#include <Ripple/src/netstack/packets/fragment.hpp>
 #include <Ripple/src/shared/cmn_types.hpp>
 #include <Ripple/src/netif/nrf24l01/physical/phy_device_constants.hpp>
 #include <Ripple/src/netif/nrf24l01/physical/phy_device_types.hpp>
@@ -53,6 +55,29 @@ namespace Ripple::NetIf::NRF24::DataLink
     0xD3  /**< APPLICATION DATA 1 */
   };
 
+  /**
+   *  Address every node listens on with pipe 0 while in RX mode. Carries
+   *  traffic for nodes that can't be addressed directly yet, like ARP requests.
+   *  Frames sent here have no ACK, as every listening node would answer.
+   */
+  static constexpr Physical::MACAddress DISCOVERY_MAC = 0xE1F0F0F0C3;
+
+  /**
+   *  Next hop given to multicast data frames, which have no single destination
+   */
+  static constexpr IPAddress MULTICAST_NEXT_HOP = 0xFFFFFFFF;
+
+  /**
+   *  Multicast packets recently accepted, used to drop the repeated copies.
+   *  Each remembers every frame of its packet.
+   */
+  static constexpr size_t MULTICAST_HISTORY_ELEMENTS = 8;
+
+  /**
+   *  Upper limit on extra copies of each multicast frame
+   */
+  static constexpr uint8_t MULTICAST_MAX_REPEATS = 3;
+
   static constexpr Physical::PipeNumber PIPE_TX           = Physical::PIPE_NUM_0;
   static constexpr Physical::PipeNumber PIPE_DEVICE_ROOT  = Physical::PIPE_NUM_1;
   static constexpr Physical::PipeNumber PIPE_APP_DATA_0   = Physical::PIPE_NUM_2;
@@ -82,39 +107,580 @@ namespace Ripple::NetIf::NRF24::DataLink
   static_assert( EP_NUM_OPTIONS == ( Physical::MAX_NUM_RX_PIPES - 1 ) );
   static_assert( Physical::MAX_NUM_PIPES == ARRAY_COUNT( EndpointAddrModifiers ) );
 
+  /**
+   *  Sources of work that wake the DataLink service thread
+   */
+  enum bfServiceEvent : uint32_t
+  {
+    SVC_EVT_NONE       = 0,
+    SVC_EVT_RADIO_IRQ  = ( 1u << 0 ), /**< Radio IRQ pin was asserted */
+    SVC_EVT_TX_ENQUEUE = ( 1u << 1 ), /**< Frames were placed into the TX queue */
+    SVC_EVT_TIMER      = ( 1u << 2 ), /**< A deadline expired or the idle period elapsed */
+  };
+
+  /**
+   *  Housekeeping messages exchanged on EP_NETWORK_SERVICES. The first byte of
+   *  the frame user data selects which message is carried.
+   */
+  enum NetServiceId : uint8_t
+  {
+    NET_SVC_INVALID,
+    NET_SVC_CHANNEL_HOP,    /**< Sender is moving the network to a new RF channel */
+    NET_SVC_ARP_REQUEST,    /**< Sender wants the MAC of the target node */
+    NET_SVC_ARP_REPLY,      /**< Sender answers a request for its own MAC */
+    NET_SVC_KEEPALIVE,      /**< Sender checks in with a neighbor that has gone quiet */
+    NET_SVC_TIME_SYNC,      /**< Sender's clock sync beacon, timestamped as it goes out */
+    NET_SVC_TIME_FOLLOW_UP, /**< Network time the last sync beacon actually left at */
+    NET_SVC_TDMA_SLOT,      /**< Coordinator assigns the receiver a TDMA slot */
+
+    NET_SVC_NUM_OPTIONS
+  };
+
   /*-------------------------------------------------------------------------------
   Structures
   -------------------------------------------------------------------------------*/
+  /**
+   *  Tracks a single frame that has been loaded into the hardware TX FIFO
+   */
+  struct TransferSlot
+  {
+    size_t timeout;     /**< Time the frame has to complete the transfer (ms) */
+    size_t start;       /**< Time the frame was loaded into the FIFO (ms) */
+    uint32_t loaded_us; /**< Time the frame was loaded into the FIFO (uS), for latency tracking */
+  };
+
+  /**
+   *  Controls the frames in flight on the radio. Slots are retired in the same
+   *  order they were loaded, mirroring how the hardware drains its TX FIFO.
+   */
   struct TransferControlBlock
   {
-    bool inProgress;                /**< TX is ongoing and hasn't been acknowledged yet */
-    size_t timeout;                 /**< Timeout for the transfer */
-    size_t start;                   /**< Start time for the transfer */
-    size_t mLastTX_us;              /**< Last system time a TX event was issued (uS) */
-    size_t mTXRate_us;              /**< Adaptive TX rate limit (uS) */
-    Physical::PipeNumber lastPipe;  /**< Last pipe used for TX */
+    TransferSlot slot[ Physical::MAX_TX_FIFO_DEPTH ]; /**< Per-frame control data, used as a ring */
+    size_t head;                                      /**< Slot index of the oldest frame in flight */
+    size_t inFlight;                                  /**< Number of frames loaded into the TX FIFO */
+    size_t mLastTX_us;                                /**< Last system time a TX event was issued (uS) */
+    size_t mTXRate_us;                                /**< Adaptive TX rate limit (uS) */
+    Physical::PipeNumber lastPipe;                    /**< Last pipe used for TX */
+    bool routeValid;                                  /**< The route fields below describe the last transfer */
+    IPAddress lastHop;                                /**< Destination of the last transfer */
+    Physical::MACAddress lastAddress;                 /**< Resolved MAC of lastHop */
+    uint16_t lastUuid;                                /**< Packet the last transfer belonged to */
+    uint32_t arpGeneration;                           /**< ARP cache generation lastAddress was resolved in */
+
+    void reset()
+    {
+      memset( slot, 0, sizeof( slot ) );
+      head          = 0;
+      inFlight      = 0;
+      mLastTX_us    = 0;
+      mTXRate_us    = 0;
+      lastPipe      = PIPE_APP_DATA_0;
+      routeValid    = false;
+      lastHop       = 0;
+      lastAddress   = 0;
+      lastUuid      = 0;
+      arpGeneration = 0;
+    }
+
+    /**
+     *  Checks if any frame is still waiting on the hardware
+     *  @return bool
+     */
+    bool inProgress() const
+    {
+      return inFlight != 0;
+    }
+
+    /**
+     *  Claims the next free slot for a frame that was just loaded
+     *
+     *  @param[in]  startTime   Time the frame was loaded (ms)
+     *  @param[in]  timeout     Time the frame has to complete (ms)
+     *  @param[in]  loadTime_us Time the frame was loaded (uS)
+     *  @return bool            False if all slots are in use
+     */
+    bool acquire( const size_t startTime, const size_t timeout, const uint32_t loadTime_us )
+    {
+      if ( inFlight >= ARRAY_COUNT( slot ) )
+      {
+        return false;
+      }
+
+      TransferSlot &next = slot[ ( head + inFlight ) % ARRAY_COUNT( slot ) ];
+      next.start         = startTime;
+      next.timeout       = timeout;
+      next.loaded_us     = loadTime_us;
+      inFlight++;
+
+      return true;
+    }
+
+    /**
+     *  Retires the oldest frame in flight
+     *  @return void
+     */
+    void release()
+    {
+      if ( inFlight )
+      {
+        head = ( head + 1 ) % ARRAY_COUNT( slot );
+        inFlight--;
+      }
+    }
+
+    /**
+     *  Retires every frame in flight at once, such as after a FIFO flush
+     *  @return void
+     */
+    void releaseAll()
+    {
+      head     = 0;
+      inFlight = 0;
+    }
+
+    /**
+     *  Gets the slot of the oldest frame in flight
+     *  @return const TransferSlot&
+     */
+    const TransferSlot &oldest() const
+    {
+      return slot[ head ];
+    }
+  };
+
+  /**
+   *  Associates a remote node with one of the local RX pipes so frames going to
+   *  that node can ride back on the ACK packets of its transmissions.
+   */
+  struct AckPayloadRoute
+  {
+    bool bound;     /**< Route is in use */
+    IPAddress node; /**< Remote node that transmits on this pipe */
+  };
+
+  /**
+   *  Tracks frames staged in the hardware TX FIFO as ACK payloads. All staged
+   *  frames share one pipe so they are collected in the order they were loaded.
+   *  Staged frames stay at the front of the TX queue until they are collected.
+   */
+  struct AckPayloadControlBlock
+  {
+    AckPayloadRoute route[ Physical::MAX_NUM_PIPES ]; /**< Node bound to each RX pipe */
+    Physical::PipeNumber stagedPipe;                  /**< Pipe the staged frames are waiting on */
+    size_t stagedStart;                               /**< Last time a staged frame moved (ms) */
+    size_t staged;                                    /**< Number of frames staged in the TX FIFO */
 
     void reset()
     {
-      inProgress = false;
-      timeout    = Chimera::Thread::TIMEOUT_10MS;
-      start      = 0;
-      mLastTX_us = 0;
-      mTXRate_us = 0;
-      lastPipe   = PIPE_APP_DATA_0;
+      memset( route, 0, sizeof( route ) );
+      stagedPipe  = Physical::PIPE_INVALID;
+      stagedStart = 0;
+      staged      = 0;
+    }
+
+    /**
+     *  Finds the pipe a node has been bound to
+     *
+     *  @param[in]  node        Node to look up
+     *  @return Physical::PipeNumber  PIPE_INVALID if not bound
+     */
+    Physical::PipeNumber find( const IPAddress node ) const
+    {
+      for ( size_t pipe = 0; pipe < ARRAY_COUNT( route ); pipe++ )
+      {
+        if ( route[ pipe ].bound && ( route[ pipe ].node == node ) )
+        {
+          return static_cast<Physical::PipeNumber>( pipe );
+        }
+      }
+
+      return Physical::PIPE_INVALID;
+    }
+  };
+
+  /**
+   *  Per-frame traffic counters. Only the DataLink thread writes them, so they
+   *  are updated with relaxed atomics and read from other threads without a lock.
+   */
+  struct TrafficCounters
+  {
+    std::atomic<uint32_t> tx_bytes;           /**< Raw number of bytes transmitted */
+    std::atomic<uint32_t> tx_bytes_lost;      /**< Total bytes lost */
+    std::atomic<uint32_t> rx_bytes;           /**< Raw number of bytes received */
+    std::atomic<uint32_t> rx_bytes_lost;      /**< Raw number of bytes lost */
+    std::atomic<uint32_t> frame_tx;           /**< Frames transmitted */
+    std::atomic<uint32_t> frame_rx;           /**< Frames received */
+    std::atomic<uint32_t> frame_tx_fail;      /**< Frames failed to be transmitted */
+    std::atomic<uint32_t> frame_tx_drop;      /**< Total frames dropped due to failure */
+    std::atomic<uint32_t> frame_rx_drop;      /**< Total frames lost */
+    std::atomic<uint32_t> tx_latency_last_us; /**< Latest TX request to on-air latency (uS) */
+    std::atomic<uint32_t> tx_latency_avg_us;  /**< Smoothed TX request to on-air latency (uS) */
+    std::atomic<uint32_t> tx_latency_max_us;  /**< Worst case TX request to on-air latency (uS) */
+    std::atomic<uint32_t> tx_ctrl_latency_us; /**< Worst case latency of TC_CONTROL frames (uS) */
+    std::atomic<uint32_t> frame_fwd;          /**< Frames relayed toward another node */
+    std::atomic<uint32_t> frame_fwd_drop;     /**< Frames that could not be relayed */
+    std::atomic<uint32_t> keepalive_tx;       /**< Keepalives sent to quiet neighbors */
+    std::atomic<uint32_t> peers_lost;         /**< Neighbors declared gone after going silent */
+
+    void reset()
+    {
+      for ( auto counter : { &tx_bytes, &tx_bytes_lost, &rx_bytes, &rx_bytes_lost, &frame_tx, &frame_rx, &frame_tx_fail,
+                             &frame_tx_drop, &frame_rx_drop, &tx_latency_last_us, &tx_latency_avg_us, &tx_latency_max_us,
+                             &tx_ctrl_latency_us, &frame_fwd, &frame_fwd_drop, &keepalive_tx, &peers_lost } )
+      {
+        counter->store( 0, std::memory_order_relaxed );
+      }
+    }
+
+    /**
+     *  Adds to a counter. Only safe from the DataLink thread.
+     *
+     *  @param[in]  counter     Counter to update
+     *  @param[in]  value       Amount to add
+     *  @return void
+     */
+    static void add( std::atomic<uint32_t> &counter, const size_t value = 1 )
+    {
+      counter.fetch_add( static_cast<uint32_t>( value ), std::memory_order_relaxed );
+    }
+  };
+
+  /**
+   *  Wire format of a NET_SVC_CHANNEL_HOP message
+   */
+  struct ChannelHopMsg
+  {
+    uint8_t id;        /**< NET_SVC_CHANNEL_HOP */
+    uint8_t channel;   /**< Channel the network is moving to */
+    uint16_t delay_ms; /**< Time from reception until the move happens */
+  };
+  static_assert( sizeof( ChannelHopMsg ) == 4 );
+
+  /**
+   *  Wire format of the NET_SVC_ARP_REQUEST and NET_SVC_ARP_REPLY messages.
+   *  Both carry the sender's own mapping, so the receiver learns it for free.
+   */
+  struct ARPMsg
+  {
+    uint8_t id;                     /**< NET_SVC_ARP_REQUEST or NET_SVC_ARP_REPLY */
+    uint8_t _pad[ 3 ];              /**< Pad for alignment */
+    IPAddress target;               /**< Node the message is addressed to */
+    IPAddress sender;               /**< Node that sent the message */
+    uint32_t _pad1;                 /**< Pad for alignment */
+    Physical::MACAddress senderMAC; /**< Root MAC of the sender */
+  };
+  static_assert( sizeof( ARPMsg ) == 24 );
+
+  /**
+   *  Wire format of a NET_SVC_KEEPALIVE message. Only sent to neighbors that
+   *  haven't been heard from in a while. The hardware ACK is the answer.
+   */
+  struct KeepAliveMsg
+  {
+    uint8_t id;        /**< NET_SVC_KEEPALIVE */
+    uint8_t _pad[ 3 ]; /**< Pad for alignment */
+    IPAddress sender;  /**< Node that sent the message */
+  };
+  static_assert( sizeof( KeepAliveMsg ) == 8 );
+
+  /**
+   *  Wire format of the NET_SVC_TIME_SYNC and NET_SVC_TIME_FOLLOW_UP messages.
+   *  Both go to everyone without an ACK. The sync only carries who sent it,
+   *  the follow up with the same sequence number carries when it was sent.
+   */
+  struct TimeSyncMsg
+  {
+    uint8_t id;         /**< NET_SVC_TIME_SYNC or NET_SVC_TIME_FOLLOW_UP */
+    uint8_t level;      /**< Sender's hops from the master */
+    uint8_t seq;        /**< Beacon sequence number */
+    uint8_t _pad;       /**< Pad for alignment */
+    IPAddress sender;   /**< Node that sent the message */
+    IPAddress root;     /**< Master the sender follows */
+    uint32_t _pad1;     /**< Pad for alignment */
+    uint64_t global_us; /**< Network time the sync left at. Only set in the follow up. */
+  };
+  static_assert( sizeof( TimeSyncMsg ) == 24 );
+
+  /**
+   *  Wire format of a NET_SVC_TDMA_SLOT message. Zero slots takes the
+   *  receiver back to contention.
+   */
+  struct TDMASlotMsg
+  {
+    uint8_t id;       /**< NET_SVC_TDMA_SLOT */
+    uint8_t slot;     /**< Slot owned by the receiver */
+    uint8_t numSlots; /**< Slots in one frame of the schedule */
+    uint8_t _pad;     /**< Pad for alignment */
+    IPAddress sender; /**< Coordinator that sent the message */
+    uint32_t slot_us; /**< Length of every slot */
+  };
+  static_assert( sizeof( TDMASlotMsg ) == 12 );
+
+  /**
+   *  Smoothed activity seen on each RF channel by the received power detector.
+   *  Channels are sampled one at a time in a round robin sweep.
+   */
+  struct ChannelSurvey
+  {
+    uint8_t busy[ Physical::NUM_RF_CHANNELS ]; /**< Activity level, 0 = quiet, 255 = always busy */
+    uint8_t cursor;                            /**< Next channel to sample */
+    size_t lastSample;                         /**< Last time a channel was sampled (ms) */
+
+    void reset()
+    {
+      memset( busy, 0, sizeof( busy ) );
+      cursor     = 0;
+      lastSample = 0;
+    }
+
+    /**
+     *  Gets the channel to sample next and advances the sweep
+     *  @return uint8_t
+     */
+    uint8_t next()
+    {
+      const uint8_t channel = cursor;
+      cursor                = ( cursor >= Physical::MAX_RF_CHANNEL ) ? 0 : ( cursor + 1 );
+      return channel;
+    }
+
+    /**
+     *  Folds a detector sample into the channel's activity (alpha = 1/8)
+     *
+     *  @param[in]  channel     Channel that was sampled
+     *  @param[in]  detected    Whether the detector saw a carrier
+     *  @return void
+     */
+    void record( const uint8_t channel, const bool detected )
+    {
+      const int target = detected ? 255 : 0;
+      const int level  = busy[ channel ];
+      busy[ channel ]  = static_cast<uint8_t>( level + ( ( target - level ) >> 3 ) );
+    }
+
+    /**
+     *  Finds the channel with the least activity seen so far
+     *  @return uint8_t
+     */
+    uint8_t quietest() const
+    {
+      uint8_t best = 0;
+      for ( size_t channel = 1; channel < ARRAY_COUNT( busy ); channel++ )
+      {
+        if ( busy[ channel ] < busy[ best ] )
+        {
+          best = static_cast<uint8_t>( channel );
+        }
+      }
+
+      return best;
+    }
+  };
+
+  /**
+   *  Tracks a scheduled move to a new RF channel
+   */
+  struct ChannelHopControlBlock
+  {
+    bool pending;    /**< A move is scheduled */
+    uint8_t channel; /**< Channel to move to */
+    size_t start;    /**< Time the move was scheduled (ms) */
+    size_t delay;    /**< How long after start to move (ms) */
+
+    void reset()
+    {
+      pending = false;
+      channel = 0;
+      start   = 0;
+      delay   = 0;
+    }
+  };
+
+  /**
+   *  Remembers the multicast packets accepted most recently. Multicast has no
+   *  ACK, so senders may repeat each frame and only the first copy should make
+   *  it up the stack.
+   *
+   *  Packets are told apart by sender and uuid. The sender is only known from
+   *  the extended header, so without it every sender shares id zero.
+   */
+  struct MulticastHistory
+  {
+    struct Entry
+    {
+      uint16_t uuid;       /**< Packet the frames belong to */
+      uint8_t source;      /**< Sender id, zero if unknown */
+      bool used;           /**< Entry holds a packet */
+      FragmentMask frames; /**< Bit N is set once frame N was accepted */
+    };
+
+    Entry entry[ MULTICAST_HISTORY_ELEMENTS ];
+    size_t next; /**< Entry the next new packet replaces */
+
+    void reset()
+    {
+      memset( entry, 0, sizeof( entry ) );
+      next = 0;
+    }
+
+    /**
+     *  Records a frame, reporting whether it was already seen
+     *
+     *  @param[in]  source      Sender id of the frame
+     *  @param[in]  uuid        Packet the frame belongs to
+     *  @param[in]  frameNumber Position of the frame in the packet
+     *  @return bool            True if this is a repeated copy
+     */
+    bool seen( const uint8_t source, const uint16_t uuid, const uint16_t frameNumber )
+    {
+      if ( frameNumber >= FRAG_MAX_PER_PACKET )
+      {
+        return false;
+      }
+
+      const FragmentMask bit = static_cast<FragmentMask>( 1u ) << frameNumber;
+      for ( auto &e : entry )
+      {
+        if ( e.used && ( e.uuid == uuid ) && ( e.source == source ) )
+        {
+          const bool repeat = ( e.frames & bit ) != 0;
+          e.frames |= bit;
+          return repeat;
+        }
+      }
+
+      Entry &e = entry[ next ];
+      e.uuid   = uuid;
+      e.source = source;
+      e.used   = true;
+      e.frames = bit;
+      next     = ( next + 1 ) % MULTICAST_HISTORY_ELEMENTS;
+      return false;
     }
   };
 
-  /*-------------------------------------------------------------------------------
-  Aliases
-  -------------------------------------------------------------------------------*/
   /**
-   *  Queue that is optimized to hold up to 255 elements at a time. Note
-   *  that this is not thread safe and will require protection.
+   *  Gets the id a forwarded frame uses on air to name the node it is going to
+   *
+   *  @param[in]  ip          Address of the node
+   *  @return uint8_t
    */
-  template<const size_t SIZE>
-  using FrameQueue = etl::queue<Frame, SIZE, etl::memory_model::MEMORY_MODEL_SMALL>;
+  static constexpr uint8_t forwardId( const IPAddress ip )
+  {
+    return static_cast<uint8_t>( ip & 0xFF );
+  }
+
+  /**
+   *  Static route to a node that can only be reached through a relay
+   */
+  struct ForwardRoute
+  {
+    bool used;             /**< Entry holds a route */
+    IPAddress destination; /**< Node the frames are going to */
+    IPAddress nextHop;     /**< Neighbor the frames are handed to */
+  };
+
+  /**
+   *  Routes used to forward frames hop by hop without reassembling packets
+   */
+  struct ForwardingTable
+  {
+    ForwardRoute route[ FORWARD_TABLE_ELEMENTS ]; /**< Known routes */
+    size_t count;                                 /**< Number of routes in use */
+
+    void reset()
+    {
+      memset( route, 0, sizeof( route ) );
+      count = 0;
+    }
+
+    /**
+     *  Looks up the route to a destination
+     *
+     *  @param[in]  destination Node being routed to
+     *  @return ForwardRoute*   Route, or nullptr if none exists
+     */
+    ForwardRoute *find( const IPAddress destination )
+    {
+      for ( auto &entry : route )
+      {
+        if ( entry.used && ( entry.destination == destination ) )
+        {
+          return &entry;
+        }
+      }
+
+      return nullptr;
+    }
+
+    /**
+     *  Looks up the route to a destination by the id carried on air
+     *
+     *  @param[in]  id          Destination id of a forwarded frame
+     *  @return ForwardRoute*   Route, or nullptr if none exists
+     */
+    ForwardRoute *findById( const uint8_t id )
+    {
+      for ( auto &entry : route )
+      {
+        if ( entry.used && ( forwardId( entry.destination ) == id ) )
+        {
+          return &entry;
+        }
+      }
 
+      return nullptr;
+    }
+
+    /**
+     *  Adds or replaces the route to a destination
+     *
+     *  @param[in]  destination Node being routed to
+     *  @param[in]  nextHop     Neighbor to hand frames to
+     *  @return bool            False if the table is full
+     */
+    bool insert( const IPAddress destination, const IPAddress nextHop )
+    {
+      ForwardRoute *entry = find( destination );
+      for ( size_t idx = 0; !entry && ( idx < FORWARD_TABLE_ELEMENTS ); idx++ )
+      {
+        if ( !route[ idx ].used )
+        {
+          entry = &route[ idx ];
+          count++;
+        }
+      }
+
+      if ( !entry )
+      {
+        return false;
+      }
+
+      entry->used        = true;
+      entry->destination = destination;
+      entry->nextHop     = nextHop;
+      return true;
+    }
+
+    /**
+     *  Removes the route to a destination, if one exists
+     *
+     *  @param[in]  destination Node being routed to
+     *  @return void
+     */
+    void remove( const IPAddress destination )
+    {
+      if ( ForwardRoute *entry = find( destination ) )
+      {
+        memset( entry, 0, sizeof( ForwardRoute ) );
+        count--;
+      }
+    }
+  };
+
+  /*-------------------------------------------------------------------------------
+  Aliases
+  -------------------------------------------------------------------------------*/
   /**
    *  Buffer that can hold the maximum single data transaction on the radio
    */
@@ -44,6 +44,24 @@ namespace Ripple::NetIf::NRF24::Physical
   static constexpr size_t MIN_ADDR_BYTES      = 3;
   static constexpr size_t MAX_ADDR_BYTES      = 5;
 
+  /*------------------------------------------------
+  FIFO Details
+  ------------------------------------------------*/
+  static constexpr size_t MAX_TX_FIFO_DEPTH = 3;
+  static constexpr size_t MAX_RX_FIFO_DEPTH = 3;
+
+  /*------------------------------------------------
+  RF Channel Details
+  ------------------------------------------------*/
+  static constexpr size_t MAX_RF_CHANNEL  = 125; /**< Highest usable channel, 2525MHz */
+  static constexpr size_t NUM_RF_CHANNELS = MAX_RF_CHANNEL + 1;
+
+  /*------------------------------------------------
+  Timing Details
+  ------------------------------------------------*/
+  static constexpr size_t PLL_SETTLE_TIME_US = 130; /**< Tstby2a, time from CE high until RX/TX is operational */
+  static constexpr size_t RPD_SETTLE_TIME_US = 170; /**< Time in RX mode before RPD reflects the channel */
+
 }    // namespace Ripple::Physical
 
 #endif /* !RIPPLE_PHYSICAL_DEVICE_CONSTANTS_HPP */
@@ -94,6 +94,41 @@ namespace Ripple::NetIf::NRF24::Physical
     return handle.opened;
   }
 
+
+  /**
+   *  Extracts the RX pipe number from a STATUS register value
+   *
+   *  @param[in]  status      STATUS register value
+   *  @return PipeNumber      PIPE_INVALID if the RX FIFO is empty
+   */
+  static PipeNumber decodeStatusPipe( const Reg8_t status )
+  {
+    if ( status == INVALID_STATUS_REG )
+    {
+      return PipeNumber::PIPE_INVALID;
+    }
+
+    uint8_t pipe = ( status & STATUS_RX_P_NO_Msk ) >> STATUS_RX_P_NO_Pos;
+
+    switch ( pipe )
+    {
+      /*-------------------------------------------------
+      Not Used (0b110) or RX FIFO Empty (0b111)
+      -------------------------------------------------*/
+      case 6:
+      case 7:
+        return PipeNumber::PIPE_INVALID;
+        break;
+
+      /*-------------------------------------------------
+      Some pipe has data (0b000 - 0b101)
+      -------------------------------------------------*/
+      default:
+        return static_cast<PipeNumber>( pipe );
+        break;
+    };
+  }
+
   /*-------------------------------------------------------------------------------
   Open/Close Functions
   -------------------------------------------------------------------------------*/
@@ -108,9 +143,10 @@ namespace Ripple::NetIf::NRF24::Physical
     -------------------------------------------------*/
     handle.opened = true;    // Temporarily set to true to the read/write can work
     handle.cfg    = cfg;
+    invalidateShadow( handle );
 
     writeRegister( handle, REG_ADDR_RF_CH, TestChannel );
-    uint8_t val = readRegister( handle, REG_ADDR_RF_CH );
+    uint8_t val = readHardwareRegister( handle, REG_ADDR_RF_CH );
 
     if ( val == TestChannel )
     {
@@ -145,6 +181,12 @@ namespace Ripple::NetIf::NRF24::Physical
       return Chimera::Status::NOT_AVAILABLE;
     }
 
+    /*-------------------------------------------------
+    The device state is unknown at this point, so the
+    shadow can't be trusted to skip any writes.
+    -------------------------------------------------*/
+    invalidateShadow( handle );
+
     /*-------------------------------------------------
     Reset each register back to power-on defaults
     -------------------------------------------------*/
@@ -156,7 +198,7 @@ namespace Ripple::NetIf::NRF24::Physical
       -------------------------------------------------*/
       uint8_t maskedValue = sRegDefaults[ x ].val & sRegDefaults[ x ].rwMask;
       writeRegister( handle, sRegDefaults[ x ].reg, maskedValue );
-      uint8_t readValue = readRegister( handle, sRegDefaults[ x ].reg );
+      uint8_t readValue = readHardwareRegister( handle, sRegDefaults[ x ].reg );
 
       /*-------------------------------------------------
       Verify register settings match
@@ -185,6 +227,309 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
+  Chimera::Status_t buildRegisterImage( const DeviceConfig &cfg, RegisterImage &image )
+  {
+    /*-------------------------------------------------
+    Start from the power-on defaults
+    -------------------------------------------------*/
+    image.clear();
+    for ( size_t x = 0; x < ARRAY_COUNT( sRegDefaults ); x++ )
+    {
+      image.reg[ sRegDefaults[ x ].reg ]  = sRegDefaults[ x ].val & sRegDefaults[ x ].rwMask;
+      image.mask[ sRegDefaults[ x ].reg ] = sRegDefaults[ x ].rwMask;
+    }
+
+    /*-------------------------------------------------
+    CRC and interrupt masks. The device is left powered
+    down, bringing it up is the FSM's job. The IRQ mask
+    bits use negative logic.
+    -------------------------------------------------*/
+    uint8_t config = CONFIG_Reset & ~( CONFIG_CRCO | CONFIG_EN_CRC );
+    switch ( cfg.hwCRCLength )
+    {
+      case CRCLength::CRC_8:
+        config |= CONFIG_EN_CRC;
+        break;
+
+      case CRCLength::CRC_16:
+        config |= CONFIG_EN_CRC | CONFIG_CRCO;
+        break;
+
+      default:
+        return Chimera::Status::INVAL_FUNC_PARAM;
+        break;
+    }
+
+    config |= ( CONFIG_MASK_MAX_RT | CONFIG_MASK_RX_DR | CONFIG_MASK_TX_DS );
+    if ( cfg.hwISRMask & bfISRMask::ISR_MSK_MAX_RT )
+    {
+      config &= ~CONFIG_MASK_MAX_RT;
+    }
+
+    if ( cfg.hwISRMask & bfISRMask::ISR_MSK_RX_DR )
+    {
+      config &= ~CONFIG_MASK_RX_DR;
+    }
+
+    if ( cfg.hwISRMask & bfISRMask::ISR_MSK_TX_DS )
+    {
+      config &= ~CONFIG_MASK_TX_DS;
+    }
+
+    image.reg[ REG_ADDR_CONFIG ] = config;
+
+    /*-------------------------------------------------
+    Address width and channel
+    -------------------------------------------------*/
+    switch ( cfg.hwAddressWidth )
+    {
+      case AddressWidth::AW_3Byte:
+        image.reg[ REG_ADDR_SETUP_AW ] = 0x01;
+        break;
+
+      case AddressWidth::AW_4Byte:
+        image.reg[ REG_ADDR_SETUP_AW ] = 0x02;
+        break;
+
+      case AddressWidth::AW_5Byte:
+        image.reg[ REG_ADDR_SETUP_AW ] = 0x03;
+        break;
+
+      default:
+        return Chimera::Status::INVAL_FUNC_PARAM;
+        break;
+    };
+
+    if ( cfg.hwRFChannel > MAX_RF_CHANNEL )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+    image.reg[ REG_ADDR_RF_CH ] = static_cast<uint8_t>( cfg.hwRFChannel );
+
+    /*-------------------------------------------------
+    Power and data rate share RF_SETUP. The data rate
+    low bit sits outside the reset mask, so check the
+    exact fields that were set instead.
+    -------------------------------------------------*/
+    uint8_t setup = RF_SETUP_Reset & ~( RF_SETUP_RF_PWR | RF_SETUP_RF_DR_HIGH | RF_SETUP_RF_DR_LOW );
+    switch ( cfg.hwPowerAmplitude )
+    {
+      case RFPower::PA_LVL_1:
+        setup |= ( 0x01 << RF_SETUP_RF_PWR_Pos ) & RF_SETUP_RF_PWR_Msk;
+        break;
+
+      case RFPower::PA_LVL_2:
+        setup |= ( 0x02 << RF_SETUP_RF_PWR_Pos ) & RF_SETUP_RF_PWR_Msk;
+        break;
+
+      case RFPower::PA_LVL_3:
+        setup |= ( 0x03 << RF_SETUP_RF_PWR_Pos ) & RF_SETUP_RF_PWR_Msk;
+        break;
+
+      case RFPower::PA_LVL_0:
+      default:
+        break;
+    };
+
+    switch ( cfg.hwDataRate )
+    {
+      case DataRate::DR_250KBPS:
+        setup |= RF_SETUP_RF_DR_LOW;
+        break;
+
+      case DataRate::DR_1MBPS:
+        break;
+
+      case DataRate::DR_2MBPS:
+        setup |= RF_SETUP_RF_DR_HIGH;
+        break;
+
+      default:
+        return Chimera::Status::INVAL_FUNC_PARAM;
+        break;
+    }
+
+    image.reg[ REG_ADDR_RF_SETUP ]  = setup;
+    image.mask[ REG_ADDR_RF_SETUP ] = RF_SETUP_RF_PWR | RF_SETUP_RF_DR_HIGH | RF_SETUP_RF_DR_LOW | RF_SETUP_LNA_HCURR;
+
+    /*-------------------------------------------------
+    Auto ACK on every pipe, with the network driver
+    deciding per packet whether one is wanted
+    -------------------------------------------------*/
+    image.reg[ REG_ADDR_EN_AA ] = EN_AA_Mask;
+
+    /*-------------------------------------------------
+    Payload widths. Static widths stay programmed as
+    the fallback for pipes not using DPL. Without one,
+    every pipe has to be dynamic.
+    -------------------------------------------------*/
+    uint8_t dynpd = cfg.hwDynamicPayloadPipes & DYNPD_Mask;
+    if ( cfg.hwStaticPayloadWidth )
+    {
+      if ( cfg.hwStaticPayloadWidth > MAX_TX_PAYLOAD_SIZE )
+      {
+        return Chimera::Status::INVAL_FUNC_PARAM;
+      }
+
+      for ( size_t pipe = 0; pipe < MAX_NUM_PIPES; pipe++ )
+      {
+        image.reg[ rxPipePayloadWidthRegister[ pipe ] ] = cfg.hwStaticPayloadWidth;
+      }
+    }
+    else
+    {
+      dynpd = DYNPD_Mask;
+    }
+
+    /*-------------------------------------------------
+    ACK payloads are always dynamic length, on P0 for
+    the ACK coming back and P1 as the default RX pipe
+    -------------------------------------------------*/
+    uint8_t feature = FEATURE_EN_DYN_ACK;
+    if ( cfg.ackPayloads )
+    {
+      dynpd |= DYNPD_DPL_P0 | DYNPD_DPL_P1;
+      feature |= FEATURE_EN_ACK_PAY;
+    }
+
+    if ( dynpd )
+    {
+      feature |= FEATURE_EN_DPL;
+    }
+
+    image.reg[ REG_ADDR_DYNPD ]   = dynpd;
+    image.reg[ REG_ADDR_FEATURE ] = feature;
+
+    return Chimera::Status::OK;
+  }
+
+
+  Chimera::Status_t applyRegisterImage( Handle &handle, const RegisterImage &image, const bool resume )
+  {
+    /*-------------------------------------------------
+    Entrance Checks
+    -------------------------------------------------*/
+    if ( !driverReady( handle ) )
+    {
+      return Chimera::Status::NOT_AVAILABLE;
+    }
+
+    /*-------------------------------------------------
+    A cold start trusts nothing. A resume reads back
+    what survived in one pass, after which the shadow
+    skips every write the device doesn't need.
+    -------------------------------------------------*/
+    invalidateShadow( handle );
+    if ( resume )
+    {
+      for ( uint8_t reg = 0; reg < NUM_SHADOW_REGISTERS; reg++ )
+      {
+        if ( image.mask[ reg ] )
+        {
+          readHardwareRegister( handle, reg );
+        }
+      }
+    }
+
+    /*-------------------------------------------------
+    Queue every write back to back. Each register is
+    its own SPI transfer, but none of them wait on a
+    read back or on the one before.
+    -------------------------------------------------*/
+    auto result      = Chimera::Status::OK;
+    uint32_t written = 0;
+
+    for ( uint8_t reg = 0; reg < NUM_SHADOW_REGISTERS; reg++ )
+    {
+      bool queued = false;
+      if ( image.mask[ reg ] && ( writeRegisterAsync( handle, reg, image.reg[ reg ], queued ) != Chimera::Status::OK ) )
+      {
+        result = Chimera::Status::FAIL;
+      }
+
+      written |= queued ? ( 1u << reg ) : 0u;
+    }
+
+    spiFlushAsync( handle );
+
+    /*-------------------------------------------------
+    One read pass over what was written. Reading from
+    the hardware also puts the real value in the shadow.
+    -------------------------------------------------*/
+    auto verify = [ &handle, &image ]( const uint32_t regs ) -> uint32_t {
+      uint32_t mismatched = 0;
+      for ( uint8_t reg = 0; reg < NUM_SHADOW_REGISTERS; reg++ )
+      {
+        if ( ( regs & ( 1u << reg ) ) &&
+             ( ( readHardwareRegister( handle, reg ) & image.mask[ reg ] ) != ( image.reg[ reg ] & image.mask[ reg ] ) ) )
+        {
+          mismatched |= ( 1u << reg );
+        }
+      }
+      return mismatched;
+    };
+
+    uint32_t mismatched = verify( written );
+
+    /*-------------------------------------------------
+    Older parts ignore FEATURE and DYNPD until unlocked
+    by ACTIVATE. It toggles the lock, so only send it
+    when those writes didn't stick.
+    -------------------------------------------------*/
+    constexpr uint32_t featureRegs = ( 1u << REG_ADDR_FEATURE ) | ( 1u << REG_ADDR_DYNPD );
+    if ( mismatched & featureRegs )
+    {
+      writeCommand( handle, CMD_ACTIVATE, &FEATURE_ACTIVATE_KEY, 1 );
+      writeRegister( handle, REG_ADDR_FEATURE, image.reg[ REG_ADDR_FEATURE ] );
+      writeRegister( handle, REG_ADDR_DYNPD, image.reg[ REG_ADDR_DYNPD ] );
+      mismatched = ( mismatched & ~featureRegs ) | verify( mismatched & featureRegs );
+    }
+
+    for ( uint8_t reg = 0; reg < NUM_SHADOW_REGISTERS; reg++ )
+    {
+      LOG_WARN_IF( DBG_MODULE && ( mismatched & ( 1u << reg ) ), "Failed to set register 0x%02x\r\n", reg );
+    }
+
+    /*-------------------------------------------------
+    Track the features the image turned on
+    -------------------------------------------------*/
+    handle.flags &= ~( DEV_FEATURES_ACTIVE | DEV_DYNAMIC_PAYLOADS | DEV_ACK_PAYLOADS );
+    if ( image.reg[ REG_ADDR_FEATURE ] )
+    {
+      handle.flags |= DEV_FEATURES_ACTIVE;
+    }
+
+    if ( image.reg[ REG_ADDR_DYNPD ] )
+    {
+      handle.flags |= DEV_DYNAMIC_PAYLOADS;
+    }
+
+    if ( image.reg[ REG_ADDR_FEATURE ] & FEATURE_EN_ACK_PAY )
+    {
+      handle.flags |= DEV_ACK_PAYLOADS;
+    }
+
+    handle.registerCache.CONFIG   = image.reg[ REG_ADDR_CONFIG ];
+    handle.registerCache.RF_SETUP = image.reg[ REG_ADDR_RF_SETUP ];
+
+    /*-------------------------------------------------
+    The multi-byte registers go back to defaults on a
+    cold start, like resetRegisterDefaults(). A resume
+    leaves them, the pipes get opened again anyway.
+    -------------------------------------------------*/
+    if ( !resume )
+    {
+      writeRegister( handle, REG_ADDR_TX_ADDR, &TX_ADDR_Reset, TX_ADDR_byteWidth );
+      writeRegister( handle, REG_ADDR_RX_ADDR_P0, &RX_ADDR_P0_Reset, RX_ADDR_P0_byteWidth );
+      writeRegister( handle, REG_ADDR_RX_ADDR_P1, &RX_ADDR_P1_Reset, RX_ADDR_P1_byteWidth );
+    }
+
+    writeRegister( handle, REG_ADDR_STATUS, STATUS_Clear );
+
+    return ( ( result == Chimera::Status::OK ) && !mismatched ) ? Chimera::Status::OK : Chimera::Status::FAIL;
+  }
+
+
   Chimera::Status_t flushTX( Handle &handle )
   {
     /*-------------------------------------------------
@@ -242,7 +587,7 @@ namespace Ripple::NetIf::NRF24::Physical
     /*-------------------------------------------------
     Transition back to Standby-1 mode
     -------------------------------------------------*/
-    handle.cePin->setState( State::LOW );
+    setChipEnable( handle, false );
 
     /*-------------------------------------------------
     If we are auto-acknowledging RX packets with a payload,
@@ -261,8 +606,8 @@ namespace Ripple::NetIf::NRF24::Physical
     -------------------------------------------------*/
     setRegisterBits( handle, REG_ADDR_STATUS, ( STATUS_RX_DR | STATUS_TX_DS | STATUS_MAX_RT ) );
     setRegisterBits( handle, REG_ADDR_CONFIG, CONFIG_PRIM_RX );
-    handle.cePin->setState( State::HIGH );
-    Chimera::delayMilliseconds( 1 );
+    setChipEnable( handle, true );
+    awaitPLLSettle( handle );
 
     /*-------------------------------------------------
     If the Pipe 0 RX address was previously clobbered
@@ -302,7 +647,7 @@ namespace Ripple::NetIf::NRF24::Physical
     /*-------------------------------------------------
     Transition device into standby mode 1
     -------------------------------------------------*/
-    handle.cePin->setState( State::LOW );
+    setChipEnable( handle, false );
     clrRegisterBits( handle, REG_ADDR_CONFIG, CONFIG_PRIM_RX );
 
     /*-------------------------------------------------
@@ -346,7 +691,7 @@ namespace Ripple::NetIf::NRF24::Physical
     clearing CE=0, we can transition the module to
     Standby-1 mode.
     -------------------------------------------------*/
-    handle.cePin->setState( State::LOW );
+    setChipEnable( handle, false );
     handle.flags |= ( DEV_IS_LISTENING | DEV_LISTEN_PAUSE );
 
     return Chimera::Status::OK;
@@ -372,11 +717,11 @@ namespace Ripple::NetIf::NRF24::Physical
     By setting CE=1, we can transition the module back
     to RX mode.
     -------------------------------------------------*/
-    handle.cePin->setState( State::HIGH );
+    setChipEnable( handle, true );
     handle.flags &= ~DEV_LISTEN_PAUSE;
 
     /* The transition requires an RX settling period of ~130us */
-    Chimera::delayMilliseconds( 1 );
+    awaitPLLSettle( handle );
     return Chimera::Status::OK;
   }
 
@@ -402,13 +747,15 @@ namespace Ripple::NetIf::NRF24::Physical
       }
 
       /*-------------------------------------------------
-      Enable the proper bits
-      // TODO: Why only P0/P1? Check datasheet then make comment
+      Enable the proper bits. ACK payloads are always
+      dynamic length, so DPL must be on. P0 receives the
+      ACK when transmitting and P1 is the default RX pipe.
+      Other pipes need DPL enabled individually.
       -------------------------------------------------*/
-      setRegisterBits( handle, REG_ADDR_FEATURE, FEATURE_EN_ACK_PAY );
+      setRegisterBits( handle, REG_ADDR_FEATURE, FEATURE_EN_ACK_PAY | FEATURE_EN_DPL );
       setRegisterBits( handle, REG_ADDR_DYNPD, DYNPD_DPL_P0 | DYNPD_DPL_P1 );
 
-      handle.flags |= DEV_ACK_PAYLOADS;
+      handle.flags |= DEV_ACK_PAYLOADS | DEV_DYNAMIC_PAYLOADS;
     }
     else if ( handle.flags & DEV_ACK_PAYLOADS )    // && !state
     {
@@ -424,12 +771,6 @@ namespace Ripple::NetIf::NRF24::Physical
 
   Chimera::Status_t toggleDynamicPayloads( Handle &handle, const PipeNumber pipe, const bool state )
   {
-    /*-------------------------------------------------------------------------------
-    For now, only static payloads are allowed due to counterfeit chips not working
-    at all with dynamic payloads. Maybe one day I'll switch to the real Nordic chip.
-    -------------------------------------------------------------------------------*/
-    RT_HARD_ASSERT( state == false );
-
     /*-------------------------------------------------
     Entrance Checks
     -------------------------------------------------*/
@@ -487,14 +828,13 @@ namespace Ripple::NetIf::NRF24::Physical
       clrRegisterBits( handle, REG_ADDR_DYNPD, dynpd_mask );
 
       /*-------------------------------------------------
-      Disable for all pipes
+      Only drop the feature once no pipe uses it anymore
       -------------------------------------------------*/
-      if ( pipe == PIPE_NUM_ALL )
+      if ( !( readRegister( handle, REG_ADDR_DYNPD ) & DYNPD_Mask ) )
       {
         clrRegisterBits( handle, REG_ADDR_FEATURE, FEATURE_EN_DPL );
+        handle.flags &= ~DEV_DYNAMIC_PAYLOADS;
       }
-
-      handle.flags &= ~DEV_DYNAMIC_PAYLOADS;
     }
 
     return Chimera::Status::OK;
@@ -649,9 +989,14 @@ namespace Ripple::NetIf::NRF24::Physical
     //       packet read/write.
 
     /*-------------------------------------------------
-    Cache the currently configured RX address
+    Cache the currently configured RX address, unless
+    one is already saved. Back to back transmissions
+    would otherwise cache the previous TX address.
     -------------------------------------------------*/
-    readRegister( handle, REG_ADDR_RX_ADDR_P0, &handle.cachedPipe0RXAddr, MAX_ADDR_BYTES );
+    if ( !handle.cachedPipe0RXAddr )
+    {
+      readRegister( handle, REG_ADDR_RX_ADDR_P0, &handle.cachedPipe0RXAddr, MAX_ADDR_BYTES );
+    }
 
     /*-------------------------------------------------
     Set pipe 0 RX address == TX address. This allows the
@@ -760,17 +1105,12 @@ namespace Ripple::NetIf::NRF24::Physical
     }
 
     /*-------------------------------------------------
-    Write the payload width, then turn the pipe on
+    Write the payload width, then turn the pipe on. The
+    width is ignored on pipes with dynamic payloads, but
+    writing zero would disable the pipe on clone chips
+    that don't honor the DYNPD register.
     -------------------------------------------------*/
-    uint8_t payloadSize = handle.cfg.hwStaticPayloadWidth;
-    if ( handle.flags & DEV_DYNAMIC_PAYLOADS )
-    {
-      // TODO: Verify if this still allows for dynamic payloads. Datasheet says zero == disabled, but
-      //       it might be what makes this mode work for some of the cheaper chinese clones.
-      payloadSize = 0;
-    }
-
-    writeRegister( handle, rxPipePayloadWidthRegister[ pipe ], payloadSize );
+    writeRegister( handle, rxPipePayloadWidthRegister[ pipe ], handle.cfg.hwStaticPayloadWidth );
     setRegisterBits( handle, REG_ADDR_EN_RXADDR, rxPipeEnableBitField[ pipe ] );
 
     return Chimera::Status::OK;
@@ -827,7 +1167,7 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
-  Chimera::Status_t readPayload( Handle &handle, void *const buffer, const size_t length )
+  Chimera::Status_t readPayload( Handle &handle, void *const buffer, const size_t length, Reg8_t *const status )
   {
     /*-------------------------------------------------
     Entrance Checks
@@ -848,10 +1188,101 @@ namespace Ripple::NetIf::NRF24::Physical
     size_t readLength = std::min( length, MAX_TX_PAYLOAD_SIZE );
     uint8_t statusReg = readCommand( handle, CMD_R_RX_PAYLOAD, buffer, readLength );
 
+    if ( status )
+    {
+      *status = statusReg;
+    }
+
     return ( statusReg != Physical::INVALID_STATUS_REG ) ? Chimera::Status::OK : Chimera::Status::FAIL;
   }
 
 
+  size_t drainRXFifo( Handle &handle, const size_t length, RXPayloadHandler &handler, RXBufferProvider *const provider )
+  {
+    /*-------------------------------------------------
+    Entrance Checks
+    -------------------------------------------------*/
+    const bool dynamic = ( handle.flags & DEV_DYNAMIC_PAYLOADS );
+    if ( !driverReady( handle ) || ( !length && !dynamic ) || !handler.is_valid() )
+    {
+      return 0;
+    }
+
+    /*-------------------------------------------------
+    Pull payloads until the hardware reports the FIFO
+    was empty when the read started. The loop is bounded
+    by the FIFO depth in case the radio is still in RX
+    mode and new payloads keep arriving.
+    -------------------------------------------------*/
+    const size_t staticLength = std::min( length, MAX_TX_PAYLOAD_SIZE );
+    uint8_t scratch[ MAX_TX_PAYLOAD_SIZE ];
+    size_t payloadCount = 0;
+
+    /*-------------------------------------------------
+    Reads go straight into the consumer's storage when
+    it can take them, else through the scratch buffer.
+    -------------------------------------------------*/
+    auto bufferFor = [ & ]( const size_t size ) -> uint8_t * {
+      void *dst = ( provider && provider->is_valid() ) ? ( *provider )( size ) : nullptr;
+      return dst ? reinterpret_cast<uint8_t *>( dst ) : scratch;
+    };
+
+    while ( payloadCount < MAX_RX_FIFO_DEPTH )
+    {
+      /*-------------------------------------------------
+      Static payloads: a single speculative read gets the
+      pipe and the data in one transaction.
+      -------------------------------------------------*/
+      if ( !dynamic )
+      {
+        uint8_t *const buffer = bufferFor( staticLength );
+        const PipeNumber pipe = decodeStatusPipe( readCommand( handle, CMD_R_RX_PAYLOAD, buffer, staticLength ) );
+        if ( pipe == PipeNumber::PIPE_INVALID )
+        {
+          break;
+        }
+
+        handler( pipe, buffer, staticLength );
+        payloadCount++;
+        continue;
+      }
+
+      /*-------------------------------------------------
+      Dynamic payloads: the width query reports the pipe
+      too, so only one extra transaction is needed.
+      -------------------------------------------------*/
+      uint8_t width         = 0;
+      const PipeNumber pipe = decodeStatusPipe( readCommand( handle, CMD_R_RX_PL_WID, &width, 1u ) );
+      if ( pipe == PipeNumber::PIPE_INVALID )
+      {
+        break;
+      }
+
+      size_t readLength = staticLength;
+      if ( dynamicPayloadsEnabled( handle, pipe ) )
+      {
+        /*-------------------------------------------------
+        The datasheet requires flushing on a corrupt width
+        -------------------------------------------------*/
+        if ( !width || ( width > MAX_TX_PAYLOAD_SIZE ) )
+        {
+          flushRX( handle );
+          break;
+        }
+
+        readLength = width;
+      }
+
+      uint8_t *const buffer = bufferFor( readLength );
+      readCommand( handle, CMD_R_RX_PAYLOAD, buffer, readLength );
+      handler( pipe, buffer, readLength );
+      payloadCount++;
+    }
+
+    return payloadCount;
+  }
+
+
   Chimera::Status_t writePayload( Handle &handle, const void *const buffer, const size_t length, const PayloadType type )
   {
     /*-------------------------------------------------
@@ -884,6 +1315,42 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
+  Chimera::Status_t writePayloadAsync( Handle &handle, const void *const buffer, const size_t length,
+                                       const PayloadType type, SPICallback onComplete )
+  {
+    /*-------------------------------------------------
+    Entrance Checks
+    -------------------------------------------------*/
+    if ( !driverReady( handle ) )
+    {
+      return Chimera::Status::NOT_AVAILABLE;
+    }
+    else if ( !buffer || !length || ( length > MAX_TX_PAYLOAD_SIZE ) )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+
+    /*-------------------------------------------------
+    Build the full command. The async queue takes its
+    own copy, so a stack buffer is fine here.
+    -------------------------------------------------*/
+    uint8_t cmdBuffer[ MAX_SPI_TRANSACTION_LEN ];
+
+    cmdBuffer[ 0 ] = CMD_W_TX_PAYLOAD;
+    if ( type == PayloadType::PAYLOAD_NO_ACK )
+    {
+      cmdBuffer[ 0 ] = CMD_W_TX_PAYLOAD_NO_ACK;
+    }
+
+    memcpy( &cmdBuffer[ 1 ], buffer, length );
+
+    /*-------------------------------------------------
+    Queue the data for transfer
+    -------------------------------------------------*/
+    return spiTransactionAsync( handle, cmdBuffer, length + 1, onComplete );
+  }
+
+
   Chimera::Status_t stageAckPayload( Handle &handle, const PipeNumber pipe, const void *const buffer, size_t length )
   {
     /*-------------------------------------------------
@@ -897,12 +1364,21 @@ namespace Ripple::NetIf::NRF24::Physical
     {
       return Chimera::Status::INVAL_FUNC_PARAM;
     }
+    else if ( !( handle.flags & DEV_ACK_PAYLOADS ) || !dynamicPayloadsEnabled( handle, pipe ) )
+    {
+      return Chimera::Status::NOT_SUPPORTED;
+    }
+    else if ( txFifoFull( handle ) )
+    {
+      return Chimera::Status::FULL;
+    }
 
     /*-------------------------------------------------
-    Perform the staging command
+    Perform the staging command. The pipe number is
+    encoded in the low bits of the command.
     -------------------------------------------------*/
     size_t writeLength = std::min( length, MAX_TX_PAYLOAD_SIZE );
-    writeCommand( handle, CMD_W_ACK_PAYLOAD, buffer, writeLength );
+    writeCommand( handle, CMD_W_ACK_PAYLOAD | pipe, buffer, writeLength );
 
     return Chimera::Status::OK;
   }
@@ -922,38 +1398,39 @@ namespace Ripple::NetIf::NRF24::Physical
     }
 
     /*-------------------------------------------------
-    Read the single byte registers first
-    -------------------------------------------------*/
-    handle.registerCache.CONFIG      = readRegister( handle, REG_ADDR_CONFIG );
-    handle.registerCache.EN_AA       = readRegister( handle, REG_ADDR_EN_AA );
-    handle.registerCache.EN_RX_ADDR  = readRegister( handle, REG_ADDR_EN_RXADDR );
-    handle.registerCache.SETUP_AW    = readRegister( handle, REG_ADDR_SETUP_AW );
-    handle.registerCache.SETUP_RETR  = readRegister( handle, REG_ADDR_SETUP_RETR );
-    handle.registerCache.RF_CH       = readRegister( handle, REG_ADDR_RF_CH );
-    handle.registerCache.RF_SETUP    = readRegister( handle, REG_ADDR_RF_SETUP );
-    handle.registerCache.STATUS      = readRegister( handle, REG_ADDR_STATUS );
-    handle.registerCache.OBSERVE_TX  = readRegister( handle, REG_ADDR_OBSERVE_TX );
-    handle.registerCache.RPD         = readRegister( handle, REG_ADDR_CD );
-    handle.registerCache.RX_PW_P0    = readRegister( handle, REG_ADDR_RX_PW_P0 );
-    handle.registerCache.RX_PW_P1    = readRegister( handle, REG_ADDR_RX_PW_P1 );
-    handle.registerCache.RX_PW_P2    = readRegister( handle, REG_ADDR_RX_PW_P2 );
-    handle.registerCache.RX_PW_P3    = readRegister( handle, REG_ADDR_RX_PW_P3 );
-    handle.registerCache.RX_PW_P4    = readRegister( handle, REG_ADDR_RX_PW_P4 );
-    handle.registerCache.RX_PW_P5    = readRegister( handle, REG_ADDR_RX_PW_P5 );
-    handle.registerCache.FIFO_STATUS = readRegister( handle, REG_ADDR_FIFO_STATUS );
-    handle.registerCache.DYNPD       = readRegister( handle, REG_ADDR_DYNPD );
-    handle.registerCache.FEATURE     = readRegister( handle, REG_ADDR_FEATURE );
-    handle.registerCache.RX_ADDR_P2  = readRegister( handle, REG_ADDR_RX_ADDR_P2 );
-    handle.registerCache.RX_ADDR_P3  = readRegister( handle, REG_ADDR_RX_ADDR_P3 );
-    handle.registerCache.RX_ADDR_P4  = readRegister( handle, REG_ADDR_RX_ADDR_P4 );
-    handle.registerCache.RX_ADDR_P5  = readRegister( handle, REG_ADDR_RX_ADDR_P5 );
+    Read the single byte registers first. This is a
+    debug dump, so always go to the hardware.
+    -------------------------------------------------*/
+    handle.registerCache.CONFIG      = readHardwareRegister( handle, REG_ADDR_CONFIG );
+    handle.registerCache.EN_AA       = readHardwareRegister( handle, REG_ADDR_EN_AA );
+    handle.registerCache.EN_RX_ADDR  = readHardwareRegister( handle, REG_ADDR_EN_RXADDR );
+    handle.registerCache.SETUP_AW    = readHardwareRegister( handle, REG_ADDR_SETUP_AW );
+    handle.registerCache.SETUP_RETR  = readHardwareRegister( handle, REG_ADDR_SETUP_RETR );
+    handle.registerCache.RF_CH       = readHardwareRegister( handle, REG_ADDR_RF_CH );
+    handle.registerCache.RF_SETUP    = readHardwareRegister( handle, REG_ADDR_RF_SETUP );
+    handle.registerCache.STATUS      = readHardwareRegister( handle, REG_ADDR_STATUS );
+    handle.registerCache.OBSERVE_TX  = readHardwareRegister( handle, REG_ADDR_OBSERVE_TX );
+    handle.registerCache.RPD         = readHardwareRegister( handle, REG_ADDR_CD );
+    handle.registerCache.RX_PW_P0    = readHardwareRegister( handle, REG_ADDR_RX_PW_P0 );
+    handle.registerCache.RX_PW_P1    = readHardwareRegister( handle, REG_ADDR_RX_PW_P1 );
+    handle.registerCache.RX_PW_P2    = readHardwareRegister( handle, REG_ADDR_RX_PW_P2 );
+    handle.registerCache.RX_PW_P3    = readHardwareRegister( handle, REG_ADDR_RX_PW_P3 );
+    handle.registerCache.RX_PW_P4    = readHardwareRegister( handle, REG_ADDR_RX_PW_P4 );
+    handle.registerCache.RX_PW_P5    = readHardwareRegister( handle, REG_ADDR_RX_PW_P5 );
+    handle.registerCache.FIFO_STATUS = readHardwareRegister( handle, REG_ADDR_FIFO_STATUS );
+    handle.registerCache.DYNPD       = readHardwareRegister( handle, REG_ADDR_DYNPD );
+    handle.registerCache.FEATURE     = readHardwareRegister( handle, REG_ADDR_FEATURE );
+    handle.registerCache.RX_ADDR_P2  = readHardwareRegister( handle, REG_ADDR_RX_ADDR_P2 );
+    handle.registerCache.RX_ADDR_P3  = readHardwareRegister( handle, REG_ADDR_RX_ADDR_P3 );
+    handle.registerCache.RX_ADDR_P4  = readHardwareRegister( handle, REG_ADDR_RX_ADDR_P4 );
+    handle.registerCache.RX_ADDR_P5  = readHardwareRegister( handle, REG_ADDR_RX_ADDR_P5 );
 
     /*-------------------------------------------------
     Read the multi-byte registers next
     -------------------------------------------------*/
-    readRegister( handle, REG_ADDR_TX_ADDR, &handle.registerCache.TX_ADDR, handle.cfg.hwAddressWidth );
-    readRegister( handle, REG_ADDR_RX_ADDR_P0, &handle.registerCache.RX_ADDR_P0, handle.cfg.hwAddressWidth );
-    readRegister( handle, REG_ADDR_RX_ADDR_P1, &handle.registerCache.RX_ADDR_P1, handle.cfg.hwAddressWidth );
+    readHardwareRegister( handle, REG_ADDR_TX_ADDR, &handle.registerCache.TX_ADDR, handle.cfg.hwAddressWidth );
+    readHardwareRegister( handle, REG_ADDR_RX_ADDR_P0, &handle.registerCache.RX_ADDR_P0, handle.cfg.hwAddressWidth );
+    readHardwareRegister( handle, REG_ADDR_RX_ADDR_P1, &handle.registerCache.RX_ADDR_P1, handle.cfg.hwAddressWidth );
   }
 
 
@@ -1211,6 +1688,36 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
+  Chimera::Status_t getTXObserve( Handle &handle, uint8_t *const lost, uint8_t *const retries )
+  {
+    /*-------------------------------------------------
+    Entrance Checks
+    -------------------------------------------------*/
+    if ( !driverReady( handle ) )
+    {
+      return Chimera::Status::NOT_AVAILABLE;
+    }
+
+    /*-------------------------------------------------
+    Both counters live in one register, so a single
+    read covers them. OBSERVE_TX is never shadowed.
+    -------------------------------------------------*/
+    const uint8_t val = readRegister( handle, REG_ADDR_OBSERVE_TX );
+
+    if ( lost )
+    {
+      *lost = ( val & OBSERVE_TX_PLOS_CNT_Msk ) >> OBSERVE_TX_PLOS_CNT_Pos;
+    }
+
+    if ( retries )
+    {
+      *retries = ( val & OBSERVE_TX_ARC_CNT_Msk ) >> OBSERVE_TX_ARC_CNT_Pos;
+    }
+
+    return Chimera::Status::OK;
+  }
+
+
   AutoRetransmitCount getRTXCount( Handle &handle )
   {
     /*-------------------------------------------------
@@ -1269,6 +1776,23 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
+  bool carrierDetected( Handle &handle )
+  {
+    /*-------------------------------------------------
+    Entrance Checks
+    -------------------------------------------------*/
+    if ( !driverReady( handle ) )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------
+    RPD is a live status bit, so it is never shadowed
+    -------------------------------------------------*/
+    return ( readRegister( handle, REG_ADDR_CD ) & RPD_RPD_Msk );
+  }
+
+
   Chimera::Status_t setISRMasks( Handle &handle, const uint8_t msk )
   {
     /*-------------------------------------------------
@@ -1672,25 +2196,7 @@ namespace Ripple::NetIf::NRF24::Physical
     /*-------------------------------------------------
     Read the status register to get appropriate pipe
     -------------------------------------------------*/
-    uint8_t pipe = ( getStatusRegister( handle ) & STATUS_RX_P_NO_Msk ) >> STATUS_RX_P_NO_Pos;
-
-    switch ( pipe )
-    {
-      /*-------------------------------------------------
-      Not Used (0b110) or RX FIFO Empty (0b111)
-      -------------------------------------------------*/
-      case 6:
-      case 7:
-        return PipeNumber::PIPE_INVALID;
-        break;
-
-      /*-------------------------------------------------
-      Some pipe has data (0b000 - 0b101)
-      -------------------------------------------------*/
-      default:
-        return static_cast<PipeNumber>( pipe );
-        break;
-    };
+    return decodeStatusPipe( getStatusRegister( handle ) );
   }
 
 
@@ -1708,10 +2214,21 @@ namespace Ripple::NetIf::NRF24::Physical
     Using dynamic payloads? Grab the last reported size
     else get the pipe's static configuration.
     -------------------------------------------------*/
-    if ( handle.flags & DEV_DYNAMIC_PAYLOADS )
+    if ( dynamicPayloadsEnabled( handle, pipe ) )
     {
       uint8_t tmp = 0;
       readCommand( handle, CMD_R_RX_PL_WID, &tmp, 1u );
+
+      /*-------------------------------------------------
+      Per the datasheet, a width over 32 bytes means the
+      payload is corrupt and must be flushed.
+      -------------------------------------------------*/
+      if ( tmp > MAX_TX_PAYLOAD_SIZE )
+      {
+        flushRX( handle );
+        return 0;
+      }
+
       return tmp;
     }
     else
@@ -1720,6 +2237,23 @@ namespace Ripple::NetIf::NRF24::Physical
     }
   }
 
+
+  bool dynamicPayloadsEnabled( Handle &handle, const PipeNumber pipe )
+  {
+    /*-------------------------------------------------
+    Entrance Checks
+    -------------------------------------------------*/
+    if ( !( handle.flags & DEV_DYNAMIC_PAYLOADS ) || !( pipe < ARRAY_COUNT( rxPipeEnableDPLMask ) ) )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------
+    DYNPD is shadowed, so this doesn't touch the bus
+    -------------------------------------------------*/
+    return readRegister( handle, REG_ADDR_DYNPD ) & rxPipeEnableDPLMask[ pipe ];
+  }
+
 }    // namespace Ripple::NetIf::NRF24::Physical
 
 #endif /* EMBEDDED */
@@ -54,6 +54,31 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   Chimera::Status_t resetRegisterDefaults( Handle &handle );
 
+  /**
+   *  Computes every register setting the device needs from its configuration,
+   *  without touching the hardware
+   *
+   *  @param[in]  cfg         Device configuration
+   *  @param[out] image       Register settings to bring the device up with
+   *  @return Chimera::Status_t
+   */
+  Chimera::Status_t buildRegisterImage( const DeviceConfig &cfg, RegisterImage &image );
+
+  /**
+   *  Writes a register image into the device as one queued run of SPI writes,
+   *  then checks everything written in a single read pass. Replaces a reset
+   *  to defaults followed by the individual setters.
+   *
+   *  A resume reads the register map first and only writes registers that no
+   *  longer match, for when the radio kept its power through an MCU reset.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  image       Register settings, from buildRegisterImage()
+   *  @param[in]  resume      Keep registers the device still holds
+   *  @return Chimera::Status_t
+   */
+  Chimera::Status_t applyRegisterImage( Handle &handle, const RegisterImage &image, const bool resume );
+
   /**
    *  Clears out the TX FIFO
    *
@@ -120,8 +145,9 @@ namespace Ripple::NetIf::NRF24::Physical
   /**
    *  Enable dynamically-sized payloads for both TX and ACK packets
    *
-   *  This disables dynamic payloads on ALL pipes. Since ACK Payloads requires Dynamic Payloads, ACK Payloads
-   *  are also disabled. If dynamic payloads are later re-enabled and ACK payloads are desired then enableAckPayload()
+   *  Pipes can be configured individually. The EN_DPL feature stays on until the last pipe using it is
+   *  disabled. Since ACK Payloads requires Dynamic Payloads, disabling on ALL pipes also disables ACK
+   *  Payloads. If dynamic payloads are later re-enabled and ACK payloads are desired then enableAckPayload()
    *  must be called again as well.
    *
    *  @param[in]  handle      Handle to the device
@@ -231,9 +257,32 @@ namespace Ripple::NetIf::NRF24::Physical
    *  @param[in]  handle      Handle to the device
    *  @param[out] buffer      Pointer to a buffer where the data should be written. Should be sized for max packet.
    *  @param[in]  length      Number of bytes to read from FIFO into the buffer
+   *  @param[out] status      Optional. STATUS register clocked out at the start of the read, which
+   *                          holds the pipe number of the payload that was just read.
    *  @return Chimera::Status_t
    */
-  Chimera::Status_t readPayload( Handle &handle, void *const buffer, const size_t length );
+  Chimera::Status_t readPayload( Handle &handle, void *const buffer, const size_t length, Reg8_t *const status = nullptr );
+
+  /**
+   *  Drains the RX FIFO, handing each payload to a consumer. Every read is issued
+   *  speculatively so the STATUS byte returned by the same SPI transaction reports
+   *  which pipe the payload came from, or that the FIFO had already emptied. This
+   *  avoids polling the STATUS register between payloads.
+   *
+   *  When dynamic payloads are enabled, each payload is preceded by a width query
+   *  which returns the pipe in the same transaction.
+   *
+   *  @note Safe in Standby-1 or RX mode. The loop is bounded by the FIFO depth, so
+   *        payloads arriving mid-drain are left for the next RX_DR event.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  length      Number of bytes to read per payload on static width pipes
+   *  @param[in]  handler     Consumer invoked once per payload read
+   *  @param[in]  provider    Optional. Supplies the buffer each payload is read into.
+   *  @return size_t          Number of payloads read
+   */
+  size_t drainRXFifo( Handle &handle, const size_t length, RXPayloadHandler &handler,
+                      RXBufferProvider *const provider = nullptr );
 
   /**
    *  Immediately writes data to pipe 0 under the assumption that the hardware has already
@@ -247,6 +296,20 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   Chimera::Status_t writePayload( Handle &handle, const void *const buffer, const size_t length, const PayloadType type );
 
+  /**
+   *  Queues a payload write to pipe 0 without waiting for the SPI transfer to finish.
+   *  Ordering with respect to other device commands is preserved.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  buffer      Array of data to be sent, copied before returning
+   *  @param[in]  length      Number of bytes to be sent from the buffer
+   *  @param[in]  type        Should the hardware expect an ACK from receiver or not?
+   *  @param[in]  onComplete  Optional callback invoked once the payload is in the TX FIFO
+   *  @return Chimera::Status_t
+   */
+  Chimera::Status_t writePayloadAsync( Handle &handle, const void *const buffer, const size_t length,
+                                       const PayloadType type, SPICallback onComplete = SPICallback() );
+
   /**
    *  Write an ACK payload for the specified pipe
    *
@@ -382,6 +445,19 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   AutoRetransmitCount getRTXCount( Handle &handle );
 
+  /**
+   *  Reads the transmit observe register, which reports link quality for the
+   *  most recent transmission.
+   *
+   *  @note PLOS_CNT saturates at 15 and only clears when RF_CH is written
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[out] lost        Packets lost since the last channel write (PLOS_CNT)
+   *  @param[out] retries     Retransmissions used by the last packet (ARC_CNT)
+   *  @return Chimera::Status_t
+   */
+  Chimera::Status_t getTXObserve( Handle &handle, uint8_t *const lost, uint8_t *const retries );
+
   /**
    *  Set RF communication channel
    *
@@ -399,6 +475,18 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   size_t getRFChannel( Handle &handle );
 
+  /**
+   *  Reads the received power detector, which reports if a signal stronger
+   *  than -64dBm is present on the current channel.
+   *
+   *  @note Only meaningful after the radio has been listening for at least
+   *        RPD_SETTLE_TIME_US. The value latches when CE goes low.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @return bool
+   */
+  bool carrierDetected( Handle &handle );
+
   /**
    *  Sets the ISR mask to enable/disable interrupt event generations on the
    *  device's IRQ pin.
@@ -516,6 +604,15 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   size_t getAvailablePayloadSize( Handle &handle, const PipeNumber pipe );
 
+  /**
+   *  Checks if a pipe has been configured for dynamic payload lengths
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  pipe        The pipe to check
+   *  @return bool
+   */
+  bool dynamicPayloadsEnabled( Handle &handle, const PipeNumber pipe );
+
 }    // namespace Ripple::Physical
 
 #endif /* !RIPPLE_PHYSICAL_DEVICE_DRIVER_HPP */
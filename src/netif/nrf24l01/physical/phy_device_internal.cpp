@@ -20,6 +20,196 @@
 
 namespace Ripple::NetIf::NRF24::Physical
 {
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Maps a multi-byte address register onto its slot in the shadow cache
+   *
+   *  @param[in]  addr        Register address
+   *  @return int             Slot index, or -1 if not a multi-byte register
+   */
+  static int shadowAddrSlot( const uint8_t addr )
+  {
+    switch ( addr )
+    {
+      case REG_ADDR_RX_ADDR_P0:
+        return 0;
+
+      case REG_ADDR_RX_ADDR_P1:
+        return 1;
+
+      case REG_ADDR_TX_ADDR:
+        return 2;
+
+      default:
+        return -1;
+    }
+  }
+
+
+  /**
+   *  Checks if the shadow cache can satisfy a read of the given register
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  addr        Register address
+   *  @param[in]  len         Number of bytes being read
+   *  @return bool
+   */
+  static bool shadowCanRead( const Handle &handle, const uint8_t addr, const size_t len )
+  {
+    if ( !registerIsCacheable( addr ) || !( handle.shadow.valid & ( 1u << addr ) ) )
+    {
+      return false;
+    }
+
+    const int slot = shadowAddrSlot( addr );
+    if ( slot < 0 )
+    {
+      return ( len == sizeof( uint8_t ) );
+    }
+    else
+    {
+      return ( len <= handle.shadow.addrLen[ slot ] );
+    }
+  }
+
+
+  /**
+   *  Checks if the shadow cache shows the device already holds the given data
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  addr        Register address
+   *  @param[in]  data        Data that would be written
+   *  @param[in]  len         Number of bytes that would be written
+   *  @return bool
+   */
+  static bool shadowMatches( const Handle &handle, const uint8_t addr, const void *const data, const size_t len )
+  {
+    if ( !registerIsCacheable( addr ) || !( handle.shadow.valid & ( 1u << addr ) ) )
+    {
+      return false;
+    }
+
+    const int slot = shadowAddrSlot( addr );
+    if ( slot < 0 )
+    {
+      return ( len == sizeof( uint8_t ) ) && ( handle.shadow.reg[ addr ] == *reinterpret_cast<const uint8_t *>( data ) );
+    }
+    else
+    {
+      return ( len == handle.shadow.addrLen[ slot ] ) && ( memcmp( handle.shadow.addr[ slot ], data, len ) == 0 );
+    }
+  }
+
+
+  /**
+   *  Updates the shadow cache with data known to be present in the device
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  addr        Register address
+   *  @param[in]  data        Register contents
+   *  @param[in]  len         Number of bytes in data
+   *  @return void
+   */
+  static void shadowUpdate( Handle &handle, const uint8_t addr, const void *const data, const size_t len )
+  {
+    if ( !registerIsCacheable( addr ) )
+    {
+      return;
+    }
+
+    const int slot = shadowAddrSlot( addr );
+    if ( ( slot >= 0 ) && ( len <= MAX_ADDR_BYTES ) )
+    {
+      memcpy( handle.shadow.addr[ slot ], data, len );
+      handle.shadow.addrLen[ slot ] = static_cast<uint8_t>( len );
+      handle.shadow.valid |= ( 1u << addr );
+    }
+    else if ( ( slot < 0 ) && ( len == sizeof( uint8_t ) ) )
+    {
+      handle.shadow.reg[ addr ] = *reinterpret_cast<const uint8_t *>( data );
+      handle.shadow.valid |= ( 1u << addr );
+    }
+    else
+    {
+      handle.shadow.valid &= ~( 1u << addr );
+    }
+  }
+
+
+  /**
+   *  Puts the descriptor at the head of the async queue onto the bus
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @return Chimera::Status_t
+   */
+  static Chimera::Status_t asyncStartHead( Handle &handle )
+  {
+    using namespace Chimera::GPIO;
+
+    SPIDescriptor &desc = handle.spiQueue.desc[ handle.spiQueue.head ];
+
+    handle.spi->lock();
+    desc.cs->setState( State::LOW );
+    handle.spiQueue.active = true;
+
+    return handle.spi->readWriteBytes( desc.txBuffer, desc.rxBuffer, desc.length );
+  }
+
+
+  /**
+   *  Releases the bus from the head descriptor, notifies its owner and starts
+   *  the next transaction in line.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  result      Result of the transfer
+   *  @return void
+   */
+  static void asyncFinishHead( Handle &handle, const Chimera::Status_t result )
+  {
+    using namespace Chimera::GPIO;
+
+    SPIDescriptor &desc = handle.spiQueue.desc[ handle.spiQueue.head ];
+
+    /*-------------------------------------------------
+    Close out the transaction on the bus
+    -------------------------------------------------*/
+    desc.cs->setState( State::HIGH );
+    handle.spi->unlock();
+    handle.spiQueue.active = false;
+
+    if ( result == Chimera::Status::OK )
+    {
+      handle.lastStatus = desc.rxBuffer[ 0 ];
+    }
+
+    /*-------------------------------------------------
+    Notify the owner, then free the slot
+    -------------------------------------------------*/
+    if ( desc.onComplete.is_valid() )
+    {
+      desc.onComplete( result, desc.rxBuffer, desc.length );
+    }
+
+    desc.onComplete        = SPICallback();
+    handle.spiQueue.head   = ( handle.spiQueue.head + 1 ) % SPI_ASYNC_QUEUE_DEPTH;
+    handle.spiQueue.count -= 1;
+
+    /*-------------------------------------------------
+    Keep the bus busy with the next transaction
+    -------------------------------------------------*/
+    if ( handle.spiQueue.count )
+    {
+      auto startResult = asyncStartHead( handle );
+      if ( startResult != Chimera::Status::OK )
+      {
+        asyncFinishHead( handle, startResult );
+      }
+    }
+  }
+
+
   /*-------------------------------------------------------------------------------
   Private Functions
   -------------------------------------------------------------------------------*/
@@ -39,7 +229,8 @@ namespace Ripple::NetIf::NRF24::Physical
     }
 
     initOk |= handle.cePin->init( handle.cfg.ce );
-    handle.cePin->setState( State::HIGH );
+    handle.ceKnown = false;
+    setChipEnable( handle, true );
 
     /*-------------------------------------------------
     Configure the IRQ pin
@@ -91,6 +282,12 @@ namespace Ripple::NetIf::NRF24::Physical
       return Chimera::Status::INVAL_FUNC_PARAM;
     }
 
+    /*-------------------------------------------------
+    Anything queued asynchronously must hit the device
+    before this transaction to keep command ordering.
+    -------------------------------------------------*/
+    spiFlushAsync( handle );
+
     /*-------------------------------------------------
     Guarantee access to the device
     -------------------------------------------------*/
@@ -112,6 +309,93 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
+  Chimera::Status_t spiTransactionAsync( Handle &handle, const void *const txBuffer, const size_t length,
+                                         SPICallback onComplete )
+  {
+    using namespace Chimera::Thread;
+
+    /*-------------------------------------------------
+    Input protection
+    -------------------------------------------------*/
+    if ( !txBuffer || !length || ( length > MAX_SPI_TRANSACTION_LEN ) )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+
+    /*-------------------------------------------------
+    Make room if the queue is backed up. This applies
+    back pressure to the caller instead of failing.
+    -------------------------------------------------*/
+    spiProcessAsync( handle );
+    if ( handle.spiQueue.count >= SPI_ASYNC_QUEUE_DEPTH )
+    {
+      auto result = handle.spi->await( Chimera::Event::Trigger::TRIGGER_TRANSFER_COMPLETE, TIMEOUT_BLOCK );
+      asyncFinishHead( handle, result );
+    }
+
+    /*-------------------------------------------------
+    Fill out the next free descriptor
+    -------------------------------------------------*/
+    const size_t idx    = ( handle.spiQueue.head + handle.spiQueue.count ) % SPI_ASYNC_QUEUE_DEPTH;
+    SPIDescriptor &desc = handle.spiQueue.desc[ idx ];
+
+    desc.cs         = handle.csPin;
+    desc.length     = length;
+    desc.onComplete = onComplete;
+    memcpy( desc.txBuffer, txBuffer, length );
+    memset( desc.rxBuffer, 0, sizeof( desc.rxBuffer ) );
+
+    handle.spiQueue.count += 1;
+
+    /*-------------------------------------------------
+    Kick off the transfer if the bus is idle
+    -------------------------------------------------*/
+    if ( !handle.spiQueue.active )
+    {
+      auto result = asyncStartHead( handle );
+      if ( result != Chimera::Status::OK )
+      {
+        asyncFinishHead( handle, result );
+        return result;
+      }
+    }
+
+    return Chimera::Status::OK;
+  }
+
+
+  void spiProcessAsync( Handle &handle )
+  {
+    using namespace Chimera::Thread;
+
+    while ( handle.spiQueue.active )
+    {
+      auto result = handle.spi->await( Chimera::Event::Trigger::TRIGGER_TRANSFER_COMPLETE, TIMEOUT_DONT_WAIT );
+      if ( result != Chimera::Status::OK )
+      {
+        break;
+      }
+
+      asyncFinishHead( handle, result );
+    }
+  }
+
+
+  Chimera::Status_t spiFlushAsync( Handle &handle )
+  {
+    using namespace Chimera::Thread;
+
+    Chimera::Status_t lastResult = Chimera::Status::OK;
+    while ( handle.spiQueue.active )
+    {
+      lastResult = handle.spi->await( Chimera::Event::Trigger::TRIGGER_TRANSFER_COMPLETE, TIMEOUT_BLOCK );
+      asyncFinishHead( handle, lastResult );
+    }
+
+    return lastResult;
+  }
+
+
   uint8_t readRegister( Handle &handle, const uint8_t addr )
   {
     uint8_t tempBuffer = std::numeric_limits<uint8_t>::max();
@@ -130,6 +414,47 @@ namespace Ripple::NetIf::NRF24::Physical
       return INVALID_STATUS_REG;
     }
 
+    /*-------------------------------------------------
+    Serve the read from the shadow if possible
+    -------------------------------------------------*/
+    const uint8_t regAddr = addr & CMD_REGISTER_MASK;
+    if ( shadowCanRead( handle, regAddr, len ) )
+    {
+      const int slot = shadowAddrSlot( regAddr );
+      if ( slot < 0 )
+      {
+        *reinterpret_cast<uint8_t *>( buf ) = handle.shadow.reg[ regAddr ];
+      }
+      else
+      {
+        memcpy( buf, handle.shadow.addr[ slot ], len );
+      }
+
+      return handle.lastStatus;
+    }
+
+    return readHardwareRegister( handle, regAddr, buf, len );
+  }
+
+
+  uint8_t readHardwareRegister( Handle &handle, const uint8_t addr )
+  {
+    uint8_t tempBuffer = std::numeric_limits<uint8_t>::max();
+    readHardwareRegister( handle, addr, &tempBuffer, sizeof( tempBuffer ) );
+    return tempBuffer;
+  }
+
+
+  StatusReg_t readHardwareRegister( Handle &handle, const uint8_t addr, void *const buf, size_t len )
+  {
+    /*-------------------------------------------------
+    Input Protection
+    -------------------------------------------------*/
+    if ( !buf || !len || ( len > MAX_SPI_DATA_LEN ) )
+    {
+      return INVALID_STATUS_REG;
+    }
+
     /*------------------------------------------------
     Populate the read command
     ------------------------------------------------*/
@@ -148,6 +473,7 @@ namespace Ripple::NetIf::NRF24::Physical
     {
       /* Copy out the data fields */
       memcpy( buf, &handle.rxBuffer[ 1 ], len );
+      shadowUpdate( handle, ( addr & CMD_REGISTER_MASK ), buf, len );
 
       /* Status register is in the first byte */
       handle.lastStatus = handle.rxBuffer[ 0 ];
@@ -172,6 +498,16 @@ namespace Ripple::NetIf::NRF24::Physical
       return INVALID_STATUS_REG;
     }
 
+    /*-------------------------------------------------
+    Skip the bus transaction if the device already
+    holds the requested data.
+    -------------------------------------------------*/
+    const uint8_t regAddr = addr & CMD_REGISTER_MASK;
+    if ( shadowMatches( handle, regAddr, buffer, len ) )
+    {
+      return handle.lastStatus;
+    }
+
     /*------------------------------------------------
     Prepare the write command
     ------------------------------------------------*/
@@ -190,17 +526,20 @@ namespace Ripple::NetIf::NRF24::Physical
     {
       /* Status register is in the first byte */
       handle.lastStatus = handle.rxBuffer[ 0 ];
+      shadowUpdate( handle, regAddr, buffer, len );
     }
 
     /*-------------------------------------------------
-    Should the last write be double checked?
+    Should the last write be double checked? This must
+    go to the hardware, which also re-syncs the shadow
+    with whatever the device actually accepted.
     -------------------------------------------------*/
-    if ( handle.cfg.verifyRegisters && ( addr != REG_ADDR_STATUS ) )
+    if ( handle.cfg.verifyRegisters && ( regAddr != REG_ADDR_STATUS ) )
     {
       uint8_t tmpBuffer[ MAX_SPI_TRANSACTION_LEN ];
       memset( tmpBuffer, 0, MAX_SPI_TRANSACTION_LEN );
 
-      readRegister( handle, addr, tmpBuffer, len );
+      readHardwareRegister( handle, regAddr, tmpBuffer, len );
 
       if( memcmp( tmpBuffer, buffer, len ) != 0 )
       {
@@ -214,6 +553,37 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
+  Chimera::Status_t writeRegisterAsync( Handle &handle, const uint8_t addr, const uint8_t value, bool &queued )
+  {
+    queued = false;
+
+    /*-------------------------------------------------
+    Skip the bus transaction if the device already
+    holds the requested data.
+    -------------------------------------------------*/
+    const uint8_t regAddr = addr & CMD_REGISTER_MASK;
+    if ( shadowMatches( handle, regAddr, &value, sizeof( value ) ) )
+    {
+      return Chimera::Status::OK;
+    }
+
+    /*-------------------------------------------------
+    The queue takes its own copy of the command. The
+    shadow is updated now, the caller verifies later.
+    -------------------------------------------------*/
+    const uint8_t cmdBuffer[ 2 ] = { static_cast<uint8_t>( CMD_W_REGISTER | regAddr ), value };
+
+    auto result = spiTransactionAsync( handle, cmdBuffer, sizeof( cmdBuffer ), SPICallback() );
+    if ( result == Chimera::Status::OK )
+    {
+      shadowUpdate( handle, regAddr, &value, sizeof( value ) );
+      queued = true;
+    }
+
+    return result;
+  }
+
+
   StatusReg_t writeCommand( Handle &handle, const uint8_t cmd )
   {
     return writeCommand( handle, cmd, nullptr, 0 );
@@ -297,6 +667,40 @@ namespace Ripple::NetIf::NRF24::Physical
   }
 
 
+  bool registerIsCacheable( const uint8_t addr )
+  {
+    switch ( addr )
+    {
+      /*-------------------------------------------------
+      Registers the hardware modifies on its own
+      -------------------------------------------------*/
+      case REG_ADDR_STATUS:
+      case REG_ADDR_OBSERVE_TX:
+      case REG_ADDR_CD:
+      case REG_ADDR_FIFO_STATUS:
+        return false;
+
+      /*-------------------------------------------------
+      Holes in the register map
+      -------------------------------------------------*/
+      case 0x18:
+      case 0x19:
+      case 0x1A:
+      case 0x1B:
+        return false;
+
+      default:
+        return ( addr < NUM_SHADOW_REGISTERS );
+    }
+  }
+
+
+  void invalidateShadow( Handle &handle )
+  {
+    handle.shadow.clear();
+  }
+
+
   bool registerIsBitmaskSet( Handle &handle, const uint8_t reg, const uint8_t bitmask )
   {
     return ( readRegister( handle, reg ) & bitmask ) == bitmask;
@@ -324,4 +728,51 @@ namespace Ripple::NetIf::NRF24::Physical
     return writeRegister( handle, addr, current );
   }
 
+
+  bool setChipEnable( Handle &handle, const bool state )
+  {
+    using namespace Chimera::GPIO;
+
+    /*-------------------------------------------------
+    Redundant requests are free
+    -------------------------------------------------*/
+    if ( handle.ceKnown && ( handle.ceState == state ) )
+    {
+      return true;
+    }
+
+    if ( handle.cePin->setState( state ? State::HIGH : State::LOW ) != Chimera::Status::OK )
+    {
+      handle.ceKnown = false;
+      return false;
+    }
+
+    /*-------------------------------------------------
+    Start the settle clock on the rising edge
+    -------------------------------------------------*/
+    if ( state )
+    {
+      handle.ceHighTime_us = Chimera::micros();
+    }
+
+    handle.ceKnown = true;
+    handle.ceState = state;
+    return true;
+  }
+
+
+  bool pllSettled( Handle &handle )
+  {
+    return !handle.ceState || ( ( Chimera::micros() - handle.ceHighTime_us ) >= PLL_SETTLE_TIME_US );
+  }
+
+
+  void awaitPLLSettle( Handle &handle )
+  {
+    while ( !pllSettled( handle ) )
+    {
+      continue;
+    }
+  }
+
 }    // namespace Ripple::Physical
@@ -59,8 +59,44 @@ namespace Ripple::NetIf::NRF24::Physical
   Chimera::Status_t spiTransaction( Handle &handle, const void *const txBuffer, void *const rxBuffer,
                                     const size_t length );
 
+  /**
+   *  Queues a SPI transaction to be executed in the background. Transactions run
+   *  back to back in the order they were queued, using whatever transfer mode
+   *  (DMA, interrupt) the SPI driver was configured with. If the queue is full,
+   *  this blocks until the oldest transaction completes.
+   *
+   *  @note Any blocking spiTransaction() first drains this queue so command
+   *        ordering on the device is always preserved.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  txBuffer    Data to be transmitted, copied into the queue
+   *  @param[in]  length      Number of bytes in the transaction
+   *  @param[in]  onComplete  Optional callback invoked once the transfer finishes
+   *  @return Chimera::Status_t
+   */
+  Chimera::Status_t spiTransactionAsync( Handle &handle, const void *const txBuffer, const size_t length,
+                                         SPICallback onComplete );
+
+  /**
+   *  Services the asynchronous SPI queue without blocking. Retires finished
+   *  transactions, invokes their callbacks, and starts the next queued one.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @return void
+   */
+  void spiProcessAsync( Handle &handle );
+
+  /**
+   *  Blocks until every queued asynchronous SPI transaction has completed
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @return Chimera::Status_t
+   */
+  Chimera::Status_t spiFlushAsync( Handle &handle );
+
   /**
    *  Reads a register on the device and returns the current value of that register
+   *  @note Served from the register shadow when the entry is valid
    *
    *  @param[in]  handle      Handle to the device
    *  @param[in]  addr    The address of the register to read
@@ -70,17 +106,61 @@ namespace Ripple::NetIf::NRF24::Physical
 
   /**
    *  Reads a multibyte register into a buffer
+   *  @note Served from the register shadow when the entry is valid
    *
    *  @param[in]  handle      Handle to the device
    *  @param[in]  addr        The address of the register to read
    *  @param[out] buf         The buffer to read into
    *  @param[in]  len         The total number of bytes to read from the register
-   *  @return StatusReg_t
+   *  @return StatusReg_t     Last known status register if served from the shadow
    */
   StatusReg_t readRegister( Handle &handle, const uint8_t addr, void *const buf, size_t len );
 
   /**
-   *  Writes a register on the device with a given value
+   *  Reads a register directly from the device, bypassing the register shadow.
+   *  The shadow is refreshed with the result for cacheable registers.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  addr        The address of the register to read
+   *  @return uint8_t
+   */
+  uint8_t readHardwareRegister( Handle &handle, const uint8_t addr );
+
+  /**
+   *  Reads a multibyte register directly from the device, bypassing the
+   *  register shadow. The shadow is refreshed with the result for cacheable
+   *  registers.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  addr        The address of the register to read
+   *  @param[out] buf         The buffer to read into
+   *  @param[in]  len         The total number of bytes to read from the register
+   *  @return StatusReg_t
+   */
+  StatusReg_t readHardwareRegister( Handle &handle, const uint8_t addr, void *const buf, size_t len );
+
+  /**
+   *  Checks if a register may be served from the shadow cache. Registers the
+   *  hardware modifies on its own are never cached.
+   *
+   *  @param[in]  addr        The address of the register to check
+   *  @return bool
+   */
+  bool registerIsCacheable( const uint8_t addr );
+
+  /**
+   *  Marks every entry in the register shadow as stale, forcing the next access
+   *  of each register to go out to the device. Call this any time the device
+   *  could have been reset behind the driver's back.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @return void
+   */
+  void invalidateShadow( Handle &handle );
+
+  /**
+   *  Writes a register on the device with a given value. The write is skipped
+   *  if the register shadow shows the device already holds the value.
    *
    *  @warning  This operation overwrites the entire register
    *  @note     Validation only works in debug builds
@@ -93,7 +173,8 @@ namespace Ripple::NetIf::NRF24::Physical
   StatusReg_t writeRegister( Handle &handle, const uint8_t addr, const uint8_t value );
 
   /**
-   *  Writes a register on the device with multiple bytes
+   *  Writes a register on the device with multiple bytes. The write is skipped
+   *  if the register shadow shows the device already holds the data.
    *
    *  @warning  This operation overwrites the entire register
    *  @note     Validation only works in debug builds
@@ -106,6 +187,19 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   StatusReg_t writeRegister( Handle &handle, const uint8_t addr, const void *const buffer, size_t len );
 
+  /**
+   *  Queues a single byte register write on the asynchronous SPI queue. The
+   *  write is skipped if the register shadow shows the device already holds
+   *  the value. Nothing is read back, follow up with a verification pass.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  addr        The address of the register to write
+   *  @param[in]  value       The data to write to that register
+   *  @param[out] queued      Whether a write actually went on the queue
+   *  @return Chimera::Status_t
+   */
+  Chimera::Status_t writeRegisterAsync( Handle &handle, const uint8_t addr, const uint8_t value, bool &queued );
+
   /**
    *  Writes a single byte command to the device
    *
@@ -177,6 +271,33 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   StatusReg_t clrRegisterBits( Handle &handle, const uint8_t addr, const uint8_t mask );
 
+  /**
+   *  Drives the CE pin, skipping the GPIO access if it's already at the
+   *  requested level. Rising edges are timestamped to track the PLL settle.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @param[in]  state       Level to drive, true for high
+   *  @return bool
+   */
+  bool setChipEnable( Handle &handle, const bool state );
+
+  /**
+   *  Checks if the PLL has settled since CE last went high
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @return bool
+   */
+  bool pllSettled( Handle &handle );
+
+  /**
+   *  Waits out whatever remains of the PLL settle time. Returns immediately
+   *  if CE is low or enough time has already passed.
+   *
+   *  @param[in]  handle      Handle to the device
+   *  @return void
+   */
+  void awaitPLLSettle( Handle &handle );
+
 }    // namespace Ripple::Physical
 
 #endif /* !RIPPLY_PHYSICAL_INTERNAL_HPP */
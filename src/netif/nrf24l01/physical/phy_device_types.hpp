@@ -19,6 +19,9 @@
 #include <Chimera/spi>
 #include <Chimera/thread>
 
+/* ETL Includes */
+#include <etl/delegate.h>
+
 /* Ripple Includes */
 #include <Ripple/src/netif/nrf24l01/physical/phy_device_constants.hpp>
 
@@ -43,6 +46,23 @@ namespace Ripple::NetIf::NRF24::Physical
    */
   static constexpr size_t MAX_SPI_TRANSACTION_LEN = 33;
 
+  /**
+   *  Number of register addresses tracked by the shadow cache. Covers the full
+   *  address range from CONFIG (0x00) through FEATURE (0x1D).
+   */
+  static constexpr size_t NUM_SHADOW_REGISTERS = 0x1E;
+
+  /**
+   *  Number of multi-byte address registers (RX_ADDR_P0, RX_ADDR_P1, TX_ADDR)
+   */
+  static constexpr size_t NUM_SHADOW_ADDR_REGISTERS = 3;
+
+  /**
+   *  Number of asynchronous SPI transactions that may be queued at once. Sized
+   *  so a full TX FIFO worth of payloads can be in the pipeline.
+   */
+  static constexpr size_t SPI_ASYNC_QUEUE_DEPTH = MAX_TX_FIFO_DEPTH;
+
   /*-------------------------------------------------------------------------------
   Enumerations
   -------------------------------------------------------------------------------*/
@@ -226,6 +246,36 @@ namespace Ripple::NetIf::NRF24::Physical
     DEV_ACK_PAYLOADS     = ( 1u << 5 ), /**< ACK payloads are enabled */
   };
 
+  /*-------------------------------------------------------------------------------
+  Callback Aliases
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Consumer for payloads pulled out of the RX FIFO during a burst drain
+   *
+   *  @param[in]  pipe        Pipe the payload was received on
+   *  @param[in]  data        Payload data, only valid for the duration of the call
+   *  @param[in]  size        Number of bytes in the payload
+   */
+  using RXPayloadHandler = etl::delegate<void( const PipeNumber, const void *const, const size_t )>;
+
+  /**
+   *  Supplies the buffer an RX payload is read into, letting the consumer take
+   *  the data in place rather than copying it out of a scratch buffer.
+   *
+   *  @param[in]  size        Number of bytes about to be read
+   *  @return void *          Buffer of at least size bytes, or nullptr to use scratch space
+   */
+  using RXBufferProvider = etl::delegate<void *( const size_t )>;
+
+  /**
+   *  Completion notification for an asynchronous SPI transaction
+   *
+   *  @param[in]  result      Result of the transfer
+   *  @param[in]  rxData      Data clocked in, only valid for the duration of the call
+   *  @param[in]  length      Number of bytes in the transaction
+   */
+  using SPICallback = etl::delegate<void( const Chimera::Status_t, const uint8_t *const, const size_t )>;
+
   /*-------------------------------------------------------------------------------
   Structures
   -------------------------------------------------------------------------------*/
@@ -265,6 +315,87 @@ namespace Ripple::NetIf::NRF24::Physical
     Reg8_t FEATURE;
   };
 
+  /**
+   *  Write-through copy of the device register map. Allows reads of registers
+   *  that only change when software writes them to be served without going out
+   *  on the SPI bus, and lets redundant writes be skipped entirely. Volatile
+   *  registers (STATUS, OBSERVE_TX, RPD, FIFO_STATUS) are never shadowed.
+   */
+  struct RegisterShadow
+  {
+    uint32_t valid;                                                 /**< Bit per register address, set when entry is trusted */
+    uint8_t reg[ NUM_SHADOW_REGISTERS ];                            /**< Single byte register images, indexed by address */
+    uint8_t addr[ NUM_SHADOW_ADDR_REGISTERS ][ MAX_ADDR_BYTES ];    /**< Multi-byte address register images */
+    uint8_t addrLen[ NUM_SHADOW_ADDR_REGISTERS ];                   /**< Bytes last written into each address image */
+
+    void clear()
+    {
+      valid = 0;
+      memset( reg, 0, sizeof( reg ) );
+      memset( addr, 0, sizeof( addr ) );
+      memset( addrLen, 0, sizeof( addrLen ) );
+    }
+
+    static_assert( NUM_SHADOW_REGISTERS <= ( sizeof( valid ) * 8 ) );
+  };
+
+  /**
+   *  Register settings the device should hold once brought up, computed from
+   *  the DeviceConfig in one go. Only single byte registers are covered, pipe
+   *  addresses are programmed as the pipes are opened.
+   */
+  struct RegisterImage
+  {
+    uint8_t reg[ NUM_SHADOW_REGISTERS ];  /**< Value of each register, indexed by address */
+    uint8_t mask[ NUM_SHADOW_REGISTERS ]; /**< Bits checked on read back, zero for registers not in the image */
+
+    void clear()
+    {
+      memset( reg, 0, sizeof( reg ) );
+      memset( mask, 0, sizeof( mask ) );
+    }
+  };
+
+  /**
+   *  Describes a single SPI transaction waiting to go out on the bus. The data
+   *  is copied into the descriptor so callers don't have to keep their buffers
+   *  alive while the transfer is queued.
+   */
+  struct SPIDescriptor
+  {
+    Chimera::GPIO::Driver_rPtr cs;               /**< Chip select framing the transaction */
+    size_t length;                               /**< Number of bytes in the transaction */
+    SPICallback onComplete;                      /**< Optional completion notification */
+    uint8_t txBuffer[ MAX_SPI_TRANSACTION_LEN ]; /**< Data clocked out */
+    uint8_t rxBuffer[ MAX_SPI_TRANSACTION_LEN ]; /**< Data clocked in */
+  };
+
+  /**
+   *  Ring of SPI transactions that are executed back to back. The descriptor
+   *  at the head is the one currently on the bus, if any.
+   */
+  struct SPIAsyncQueue
+  {
+    SPIDescriptor desc[ SPI_ASYNC_QUEUE_DEPTH ]; /**< Descriptor storage */
+    size_t head;                                 /**< Index of the oldest descriptor */
+    size_t count;                                /**< Number of queued descriptors */
+    bool active;                                 /**< The head descriptor is on the bus */
+
+    void clear()
+    {
+      head   = 0;
+      count  = 0;
+      active = false;
+
+      for ( auto &d : desc )
+      {
+        d.cs         = nullptr;
+        d.length     = 0;
+        d.onComplete = SPICallback();
+      }
+    }
+  };
+
   /**
    *  NRF24L01 hardware configuration specs
    */
@@ -286,6 +417,7 @@ namespace Ripple::NetIf::NRF24::Physical
     size_t networkBaud;  /**< Desired effective link speed in kbps */
     IPAddress ipAddress; /**< Static address of this device */
     uint8_t hwStaticPayloadWidth;
+    uint8_t hwDynamicPayloadPipes; /**< Pipes using dynamic payload lengths, DYNPD bit layout */
     RFPower hwPowerAmplitude;
     DataRate hwDataRate;
     CRCLength hwCRCLength;
@@ -297,18 +429,23 @@ namespace Ripple::NetIf::NRF24::Physical
     uint8_t hwISRMask;
     uint8_t hwISREvent;
     bool verifyRegisters; /**< Runtime verification of register setting updates */
+    bool ackPayloads;     /**< Allow frames to be returned inside ACK packets */
+    bool fastResume;      /**< Only rewrite registers that no longer match, for a radio that kept power */
 
     void clear()
     {
-      hwAddress            = 0;
-      hwAddressWidth       = Physical::AddressWidth::AW_INVALID;
-      hwChannel            = 0;
-      hwDataRate           = Physical::DataRate::DR_INVALID;
-      hwPowerAmplitude     = Physical::RFPower::PA_INVALID;
-      hwStaticPayloadWidth = static_cast<uint8_t>( Physical::MAX_TX_PAYLOAD_SIZE );
-      ipAddress            = 0;
-      networkBaud          = 0;
-      verifyRegisters      = true;
+      hwAddress             = 0;
+      hwAddressWidth        = Physical::AddressWidth::AW_INVALID;
+      hwChannel             = 0;
+      hwDataRate            = Physical::DataRate::DR_INVALID;
+      hwPowerAmplitude      = Physical::RFPower::PA_INVALID;
+      hwStaticPayloadWidth  = static_cast<uint8_t>( Physical::MAX_TX_PAYLOAD_SIZE );
+      hwDynamicPayloadPipes = 0;
+      ipAddress             = 0;
+      networkBaud           = 0;
+      verifyRegisters       = true;
+      ackPayloads           = false;
+      fastResume            = false;
     }
   };
 
@@ -337,9 +474,14 @@ namespace Ripple::NetIf::NRF24::Physical
     uint8_t flags;                               /**< Flags tracking runtime device settings */
     uint8_t lastStatus;                          /**< Debug variable to track last status register returned in transaction */
     RegisterMap registerCache;                   /**< Tracks the system state as reads/writes occur */
+    RegisterShadow shadow;                       /**< Write-through register cache used to skip SPI traffic */
+    SPIAsyncQueue spiQueue;                      /**< Asynchronous SPI transactions waiting on the bus */
     uint8_t txBuffer[ MAX_SPI_TRANSACTION_LEN ]; /**< Internal transmit buffer */
     uint8_t rxBuffer[ MAX_SPI_TRANSACTION_LEN ]; /**< Internal receive buffer */
     uint64_t cachedPipe0RXAddr;                  /**< RX address cache when Pipe 0 need to become TX */
+    bool ceKnown;                                /**< Whether ceState reflects the actual CE pin */
+    bool ceState;                                /**< Last level driven onto the CE pin */
+    size_t ceHighTime_us;                        /**< Time CE last went high, used to track the PLL settle */
 
     /**
      * Time to wait for a hardware IRQ event (ms) to instruct the DataLink
@@ -374,10 +516,15 @@ namespace Ripple::NetIf::NRF24::Physical
       flags             = 0;
       lastStatus        = 0;
       cachedPipe0RXAddr = 0;
+      ceKnown           = false;
+      ceState           = false;
+      ceHighTime_us     = 0;
       hwIRQEventTimeout = 25;
       rxQueueOverflows  = 0;
       txQueueOverflows  = 0;
       memset( &registerCache, 0, sizeof( RegisterMap ) );
+      shadow.clear();
+      spiQueue.clear();
       memset( txBuffer, 0, ARRAY_BYTES( txBuffer ) );
       memset( rxBuffer, 0, ARRAY_BYTES( rxBuffer ) );
     }
@@ -16,6 +16,7 @@
 
 /* Ripple Includes */
 #include <Ripple/netif/nrf24l01>
+#include <Ripple/shared>
 #include <Ripple/src/netif/nrf24l01/physical/phy_device_internal.hpp>
 
 
@@ -24,9 +25,55 @@ namespace Ripple::NetIf::NRF24::Physical::FSM
   /*-------------------------------------------------------------------------------
   Classes: System Controller Behaviors
   -------------------------------------------------------------------------------*/
+  void RadioControl::receive( const etl::imessage &msg )
+  {
+    /*-------------------------------------------------
+    Let the current state decide what to do. Most of
+    the requests are already satisfied and cost nothing.
+    -------------------------------------------------*/
+    const auto before = get_state_id();
+    fsm::receive( msg );
+    const auto after = get_state_id();
+
+    if ( before == after )
+    {
+      mStats.skipped++;
+      return;
+    }
+
+    /*-------------------------------------------------
+    Credit the time to the mode that was just left
+    -------------------------------------------------*/
+    const size_t now = Chimera::micros();
+    if ( before < StateId::NUMBER_OF_STATES )
+    {
+      mStats.timeInState_us[ before ] += ( now - mStateEntry_us );
+    }
+
+    mStateEntry_us = now;
+    mStats.transitions++;
+    RIPPLE_TRACE( TRC_PHY_MODE, before, after );
+  }
+
+
+  const TransitionStats &RadioControl::transitionStats()
+  {
+    const size_t now     = Chimera::micros();
+    const auto   current = get_state_id();
+
+    if ( current < StateId::NUMBER_OF_STATES )
+    {
+      mStats.timeInState_us[ current ] += ( now - mStateEntry_us );
+    }
+
+    mStateEntry_us = now;
+    return mStats;
+  }
+
+
   bool RadioControl::setChipEnableState( Chimera::GPIO::State state )
   {
-    return ( mHandle->cePin->setState( state ) == Chimera::Status::OK );
+    return setChipEnable( *mHandle, state == Chimera::GPIO::State::HIGH );
   }
 
 
@@ -104,8 +151,11 @@ namespace Ripple::NetIf::NRF24::Physical::FSM
   bool RadioControl::transitionToSTBYMode()
   {
     /*-------------------------------------------------
-    RM 6.1.3.1
+    RM 6.1.3.1. Don't cut CE before the PLL finished
+    settling, or a TX pulse may be too short to take.
+    This only waits if the last mode was just entered.
     -------------------------------------------------*/
+    awaitPLLSettle( *mHandle );
     if ( setChipEnableState( Chimera::GPIO::State::LOW ) )
     {
       return true;
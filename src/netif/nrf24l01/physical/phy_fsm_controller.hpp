@@ -13,6 +13,9 @@
 #ifndef RIPPLE_PHYSICAL_FSM_HPP
 #define RIPPLE_PHYSICAL_FSM_HPP
 
+/* STL Includes */
+#include <cstdint>
+
 /* Chimera Includes */
 #include <Chimera/gpio>
 
@@ -69,6 +72,19 @@ namespace Ripple::NetIf::NRF24::Physical::FSM
     };
   };
 
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Runtime statistics on how the radio moves between its operating modes
+   */
+  struct TransitionStats
+  {
+    uint32_t transitions;                                /**< Requests that changed the radio mode */
+    uint32_t skipped;                                    /**< Requests that were already satisfied */
+    uint64_t timeInState_us[ StateId::NUMBER_OF_STATES ]; /**< Total time spent in each mode */
+  };
+
   /*-------------------------------------------------------------------------------
   Classes: Event Messages
   -------------------------------------------------------------------------------*/
@@ -99,13 +115,31 @@ namespace Ripple::NetIf::NRF24::Physical::FSM
   class RadioControl : public etl::fsm
   {
   public:
-    RadioControl() : fsm( RF_MODE_CONTROL ), mHandle( nullptr )
+    RadioControl() : fsm( RF_MODE_CONTROL ), mHandle( nullptr ), mStats{}, mStateEntry_us( 0 )
     {
     }
     ~RadioControl() = default;
 
     Handle *mHandle; /**< Device handle used to perform operations */
 
+    /**
+     *  Routes a mode request through the state machine, tracking whether the
+     *  request changed anything and how long the previous mode lasted.
+     *
+     *  @param[in]  msg         Mode request to process
+     *  @return void
+     */
+    using fsm::receive;
+    void receive( const etl::imessage &msg ) override;
+
+    /**
+     *  Gets the transition statistics, with the current mode's time brought
+     *  up to date.
+     *
+     *  @return const TransitionStats&
+     */
+    const TransitionStats &transitionStats();
+
     /**
      *  Transitions the hardware to RX mode, without regard for the
      *  pre-existing state.
@@ -169,6 +203,10 @@ namespace Ripple::NetIf::NRF24::Physical::FSM
      *  @return bool
      */
     bool setTranscieverMode( const TranscieverMode mode );
+
+  private:
+    TransitionStats mStats;  /**< Mode change statistics */
+    size_t mStateEntry_us;   /**< Time the current mode was entered */
   };
 
 
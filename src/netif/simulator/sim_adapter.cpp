@@ -0,0 +1,1030 @@
+/********************************************************************************
+ *  File Name:
+ *    sim_adapter.cpp
+ *
+ *  Description:
+ *    Simulated NRF24 radio implementation
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#if defined( SIMULATOR )
+
+/* STL Includes */
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+/* Aurora Includes */
+#include <Aurora/logging>
+
+/* Chimera Includes */
+#include <Chimera/assert>
+#include <Chimera/common>
+#include <Chimera/thread>
+
+/* Ripple Includes */
+#include <Ripple/netstack>
+#include <Ripple/netif/simulator>
+#include <Ripple/shared>
+
+/*-------------------------------------------------------------------------------
+Literals
+-------------------------------------------------------------------------------*/
+#define DEBUG_MODULE ( false )
+
+
+namespace Ripple::NetIf::Simulator
+{
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Leads the payload of every data frame, carrying what the stack needs to
+   *  put the fragment back together
+   */
+  struct FragmentHeader
+  {
+    uint16_t uuid;  /**< Packet the fragment belongs to */
+    uint8_t number; /**< Fragment number, zero indexed */
+    uint8_t total;  /**< Fragments in the packet */
+    uint8_t parity; /**< Parity fragments at the end of the packet */
+    uint8_t length; /**< Fragment bytes after the header */
+  };
+  static_assert( sizeof( FragmentHeader ) == 6 );
+
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr size_t THREAD_STACK_BYTES    = 4096;
+  static constexpr size_t THREAD_STACK_WORDS    = STACK_BYTES( THREAD_STACK_BYTES );
+  static constexpr std::string_view THREAD_NAME = "SimRadio";
+
+  static constexpr size_t FRAG_PAYLOAD   = SIM_FRAME_BYTES - sizeof( FragmentHeader ); /**< Fragment bytes per frame */
+  static constexpr size_t AIR_HEADER     = offsetof( AirFrame, payload );              /**< Bytes ahead of the payload */
+  static constexpr size_t AIR_FRAME_BITS = ( ( 1 + 5 + 2 ) * 8 ) + 9;                  /**< Preamble, address, CRC, PCF */
+  static constexpr uint8_t PID_MASK      = 0x03;                                       /**< Packet IDs are 2 bits */
+  static constexpr uint32_t MAX_IDLE_US  = 1000;                                       /**< Longest sleep between checks */
+
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Checks if a deadline has passed, allowing for the microsecond timer to wrap
+   */
+  static inline bool expired( const uint32_t now, const uint32_t start, const uint32_t length )
+  {
+    return ( now - start ) >= length;
+  }
+
+
+  /**
+   *  FNV-1a over a frame payload. Stands in for the CRC the hardware compares
+   *  along with the packet ID to spot a resend.
+   */
+  static uint32_t payloadHash( const AirFrame &frame )
+  {
+    uint32_t hash = 2166136261u;
+    for ( size_t idx = 0; idx < frame.length; idx++ )
+    {
+      hash = ( hash ^ frame.payload[ idx ] ) * 16777619u;
+    }
+
+    return hash;
+  }
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  Adapter *createNetIf( Context_rPtr context, const SimConfig &cfg )
+  {
+    /*-------------------------------------------------
+    Use placement new to allocate a handle on the heap
+    -------------------------------------------------*/
+    RT_HARD_ASSERT( context );
+    void *ptr = context->malloc( sizeof( Adapter ) );
+    return ptr ? new ( ptr ) Adapter( cfg ) : nullptr;
+  }
+
+
+  Adapter *createNetIf( StaticSlot<Adapter> &slot, const SimConfig &cfg )
+  {
+    void *ptr = slot.claim();
+    return ptr ? new ( ptr ) Adapter( cfg ) : nullptr;
+  }
+
+
+  bool runAirBroker( const char *const xsubEndpoint, const char *const xpubEndpoint )
+  {
+    try
+    {
+      zmq::context_t ctx;
+      zmq::socket_t frontend( ctx, zmq::socket_type::xsub );
+      zmq::socket_t backend( ctx, zmq::socket_type::xpub );
+
+      frontend.bind( xsubEndpoint );
+      backend.bind( xpubEndpoint );
+
+      LOG_INFO( "Sim air broker up on %s -> %s\r\n", xsubEndpoint, xpubEndpoint );
+      zmq::proxy( frontend, backend );
+    }
+    catch ( const zmq::error_t &err )
+    {
+      LOG_ERROR( "Sim air broker stopped: %s\r\n", err.what() );
+      return false;
+    }
+
+    return true;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service Class Implementation
+  -------------------------------------------------------------------------------*/
+  Adapter::Adapter( const SimConfig &cfg ) :
+      mConfig( cfg ), mContext( nullptr ), mRunning( false ), mThreadActive( false ), mStack( nullptr ),
+      mState( RadioState::IDLE ), mAttempts( 0 ), mNextPID( 0 ), mStateStart_us( 0 ), mStateLength_us( 0 ), mAirStart_us( 0 ),
+      mRandom( 1 ), mLastActive( 0 )
+  {
+    memset( &mActive, 0, sizeof( mActive ) );
+    memset( &mStats, 0, sizeof( mStats ) );
+  }
+
+
+  Adapter::~Adapter()
+  {
+    powerDn();
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: Net Interface
+  -------------------------------------------------------------------------------*/
+  bool Adapter::powerUp( void *context )
+  {
+    using namespace Chimera::Thread;
+
+    /*-------------------------------------------------
+    Input Protection
+    -------------------------------------------------*/
+    if ( !context || ( mConfig.pipes[ 1 ] == SIM_PIPE_CLOSED ) || mThreadActive )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------
+    Initialize module memory
+    -------------------------------------------------*/
+    mContext = reinterpret_cast<Context_rPtr>( context );
+
+    /*-------------------------------------------------
+    The stack outlives the thread by an instant as it
+    unwinds, so it is allocated once and reused rather
+    than freed on power down
+    -------------------------------------------------*/
+    if ( !mStack )
+    {
+      mStack = mContext->malloc( THREAD_STACK_BYTES );
+      if ( !mStack )
+      {
+        LOG_ERROR( "Sim radio couldn't allocate its thread stack\r\n" );
+        return false;
+      }
+    }
+
+    mLastHeard.clear();
+    mTXQueue.clear();
+    mRXQueue.clear();
+    mInFlight.clear();
+    mLatency.clear();
+    memset( &mStats, 0, sizeof( mStats ) );
+    mStats.rf_channel = mConfig.channel;
+
+    mState  = RadioState::IDLE;
+    mRandom = ( mConfig.seed ^ static_cast<uint32_t>( mConfig.pipes[ 1 ] ) ) | 1u;
+
+    /*-------------------------------------------------
+    Join the air. Subscribing to a pipe address is what
+    opens the pipe, so only frames sent to this node or
+    to everyone ever reach it.
+    -------------------------------------------------*/
+    try
+    {
+      mPub = zmq::socket_t( mZMQ, zmq::socket_type::pub );
+      mSub = zmq::socket_t( mZMQ, zmq::socket_type::sub );
+      mPub.connect( mConfig.pubEndpoint );
+      mSub.connect( mConfig.subEndpoint );
+
+      for ( size_t pipe = 1; pipe < SIM_NUM_PIPES; pipe++ )
+      {
+        if ( mConfig.pipes[ pipe ] != SIM_PIPE_CLOSED )
+        {
+          mSub.set( zmq::sockopt::subscribe, zmq::const_buffer( &mConfig.pipes[ pipe ], sizeof( SimAddress ) ) );
+        }
+      }
+
+      mSub.set( zmq::sockopt::subscribe, zmq::const_buffer( &mConfig.multicastAddress, sizeof( SimAddress ) ) );
+    }
+    catch ( const zmq::error_t &err )
+    {
+      LOG_ERROR( "Sim radio couldn't join the air: %s\r\n", err.what() );
+      return false;
+    }
+
+    /*-------------------------------------------------
+    Start the radio thread
+    -------------------------------------------------*/
+    TaskDelegate func = TaskDelegate::create<Adapter, &Adapter::run>( *this );
+
+    Task radio;
+    TaskConfig cfg;
+
+    cfg.arg                                   = nullptr;
+    cfg.function                              = func;
+    cfg.priority                              = 4;
+    cfg.stackWords                            = THREAD_STACK_WORDS;
+    cfg.type                                  = TaskInitType::STATIC;
+    cfg.name                                  = THREAD_NAME.data();
+    cfg.specialization.staticTask.stackBuffer = mStack;
+    cfg.specialization.staticTask.stackSize   = THREAD_STACK_BYTES;
+
+    mRunning      = true;
+    mThreadActive = true;
+    radio.create( cfg );
+    mTaskId = radio.start();
+    sendTaskMsg( mTaskId, ITCMsg::TSK_MSG_WAKEUP, TIMEOUT_DONT_WAIT );
+
+    mLastActive = Chimera::millis();
+    return true;
+  }
+
+
+  void Adapter::powerDn()
+  {
+    /*-------------------------------------------------
+    The radio thread sees this within MAX_IDLE_US and
+    closes the sockets on its way out. Wait for that,
+    unless this is the radio thread itself, so the
+    sockets aren't destroyed under it.
+    -------------------------------------------------*/
+    mRunning = false;
+    if ( !mThreadActive || ( Chimera::Thread::this_thread::id() == mTaskId ) )
+    {
+      return;
+    }
+
+    const size_t start = Chimera::millis();
+    while ( mThreadActive && ( ( Chimera::millis() - start ) < SIM_STOP_TIMEOUT_MS ) )
+    {
+      Chimera::delayMilliseconds( 1 );
+    }
+
+    RT_HARD_ASSERT( !mThreadActive );
+  }
+
+
+  Chimera::Status_t Adapter::recv( Fragment_sPtr &fragmentList )
+  {
+    Chimera::Thread::LockGuard lck( mLock );
+    if ( mRXQueue.empty() )
+    {
+      return Chimera::Status::EMPTY;
+    }
+
+    /*-------------------------------------------------
+    Hand up every frame waiting, newest at the front.
+    The stack sorts them out during assembly.
+    -------------------------------------------------*/
+    Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> heapLock( mContext->mHeap );
+    AllocSiteScope allocSite( mContext->mHeap, ALLOC_FRAGMENT );
+
+    Fragment_sPtr rootMsg    = Fragment_sPtr();
+    Chimera::Status_t result = Chimera::Status::READY;
+
+    while ( !mRXQueue.empty() )
+    {
+      const RXFrame &rx = mRXQueue.front();
+
+      FragmentHeader hdr;
+      memcpy( &hdr, rx.frame.payload, sizeof( hdr ) );
+
+      Fragment_sPtr newFrag = allocFragment( &mContext->mHeap, hdr.length );
+      if ( !newFrag )
+      {
+        LOG_DEBUG_IF( DEBUG_MODULE, "No memory to allocate for incoming fragment\r\n" );
+        result = Chimera::Status::MEMORY;
+        mRXQueue.pop();
+        continue;
+      }
+
+      newFrag->length = hdr.length;
+      newFrag->number = hdr.number;
+      newFrag->uuid   = hdr.uuid;
+      newFrag->total  = hdr.total;
+      newFrag->parity = hdr.parity;
+      newFrag->source = static_cast<IPAddress>( rx.frame.src ^ ( rx.frame.src >> 32 ) );
+      memcpy( newFrag->payload(), rx.frame.payload + sizeof( hdr ), hdr.length );
+
+      mLatency.recordSince( LAT_LINK_RX, rx.queued_us );
+      mRXQueue.pop();
+
+      newFrag->next = rootMsg;
+      rootMsg       = newFrag;
+    }
+
+    fragmentList = rootMsg;
+    return result;
+  }
+
+
+  Chimera::Status_t Adapter::send( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc )
+  {
+    /*-------------------------------------------------
+    There is one FIFO on the radio, so every class is
+    sent in the order it arrives
+    -------------------------------------------------*/
+    ( void )tc;
+
+    SimAddress dst = SIM_PIPE_CLOSED;
+    if ( !arpLookUp( ip, &dst, sizeof( dst ) ) )
+    {
+      mCBService_registry.call<CallbackId::CB_ERROR_ARP_RESOLVE>();
+      return Chimera::Status::FAIL;
+    }
+
+    return queueMessage( head, dst, true, 0 );
+  }
+
+
+  Chimera::Status_t Adapter::sendMulticast( const Fragment_sPtr head, const uint8_t repeats, const TrafficClass tc )
+  {
+    ( void )tc;
+
+    const Chimera::Status_t result = queueMessage( head, mConfig.multicastAddress, false, repeats );
+    return ( result == Chimera::Status::OK ) ? Chimera::Status::READY : result;
+  }
+
+
+  void Adapter::getStats( PerfStats &stats )
+  {
+    Chimera::Thread::LockGuard lck( mLock );
+    stats = mStats;
+  }
+
+
+  void Adapter::getLatencyStats( LatencyReport &report )
+  {
+    mLatency.snapshot( report );
+  }
+
+
+  IARP *Adapter::addressResolver()
+  {
+    return this;
+  }
+
+
+  size_t Adapter::maxTransferSize() const
+  {
+    return FRAG_PAYLOAD;
+  }
+
+
+  size_t Adapter::maxUnfragmentedSize() const
+  {
+    return maxTransferSize();
+  }
+
+
+  size_t Adapter::maxNumFragments() const
+  {
+    return FRAG_MAX_PER_PACKET;
+  }
+
+
+  size_t Adapter::linkSpeed() const
+  {
+    return mConfig.defaultLink.bandwidth / 8u;
+  }
+
+
+  size_t Adapter::lastActive() const
+  {
+    return mLastActive;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: ARP Interface
+  -------------------------------------------------------------------------------*/
+  Chimera::Status_t Adapter::addARPEntry( const IPAddress &ip, const void *const mac, const size_t size )
+  {
+    if ( !mac || ( size != sizeof( SimAddress ) ) )
+    {
+      return Chimera::Status::FAIL;
+    }
+
+    SimAddress addr = SIM_PIPE_CLOSED;
+    memcpy( &addr, mac, sizeof( addr ) );
+
+    {
+      Chimera::Thread::LockGuard lck( mLock );
+      auto iter = mARP.find( ip );
+      if ( iter != mARP.end() )
+      {
+        iter->second = addr;
+        return Chimera::Status::OK;
+      }
+
+      if ( !mARP.full() )
+      {
+        mARP.insert( { ip, addr } );
+        return Chimera::Status::OK;
+      }
+    }
+
+    mCBService_registry.call<CallbackId::CB_ERROR_ARP_LIMIT>();
+    return Chimera::Status::FULL;
+  }
+
+
+  Chimera::Status_t Adapter::dropARPEntry( const IPAddress &ip )
+  {
+    Chimera::Thread::LockGuard lck( mLock );
+    mARP.erase( ip );
+    return Chimera::Status::OK;
+  }
+
+
+  bool Adapter::arpLookUp( const IPAddress &ip, void *const mac, const size_t size )
+  {
+    if ( !mac || ( size != sizeof( SimAddress ) ) )
+    {
+      return false;
+    }
+
+    Chimera::Thread::LockGuard lck( mLock );
+    auto iter = mARP.find( ip );
+    if ( iter == mARP.end() )
+    {
+      return false;
+    }
+
+    memcpy( mac, &iter->second, size );
+    return true;
+  }
+
+
+  IPAddress Adapter::arpLookUp( const void *const mac, const size_t size )
+  {
+    if ( !mac || ( size != sizeof( SimAddress ) ) )
+    {
+      return 0;
+    }
+
+    SimAddress addr = SIM_PIPE_CLOSED;
+    memcpy( &addr, mac, sizeof( addr ) );
+
+    Chimera::Thread::LockGuard lck( mLock );
+    for ( const auto &entry : mARP )
+    {
+      if ( entry.second == addr )
+      {
+        return entry.first;
+      }
+    }
+
+    return 0;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Service: Simulator Specific Functions
+  -------------------------------------------------------------------------------*/
+  bool Adapter::setLinkModel( const SimAddress peer, const LinkModel &model )
+  {
+    Chimera::Thread::LockGuard lck( mLock );
+    auto iter = mLinks.find( peer );
+    if ( iter != mLinks.end() )
+    {
+      iter->second = model;
+      return true;
+    }
+
+    if ( mLinks.full() )
+    {
+      return false;
+    }
+
+    mLinks.insert( { peer, model } );
+    return true;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Private Methods
+  -------------------------------------------------------------------------------*/
+  void Adapter::run( void *arg )
+  {
+    using namespace Chimera::Thread;
+
+    Ripple::TaskWaitInit();
+    this_thread::set_name( THREAD_NAME.data() );
+    mTaskId = this_thread::id();
+
+    while ( mRunning )
+    {
+      /*-----------------------------------------------------------------------
+      Sleep on the air until the next thing that needs the radio: a frame to
+      start sending, the current state running out, or a delayed frame due.
+      -----------------------------------------------------------------------*/
+      const uint32_t now = static_cast<uint32_t>( Chimera::micros() );
+      uint32_t wait_us   = MAX_IDLE_US;
+
+      if ( mState != RadioState::IDLE )
+      {
+        const uint32_t elapsed = now - mStateStart_us;
+        wait_us = ( elapsed < mStateLength_us ) ? std::min( wait_us, mStateLength_us - elapsed ) : 0u;
+      }
+      else
+      {
+        Chimera::Thread::LockGuard lck( mLock );
+        wait_us = mTXQueue.empty() ? wait_us : 0u;
+      }
+
+      for ( const DelayedFrame &delayed : mInFlight )
+      {
+        const int32_t until = static_cast<int32_t>( delayed.arrive_us - now );
+        wait_us             = ( until <= 0 ) ? 0u : std::min( wait_us, static_cast<uint32_t>( until ) );
+      }
+
+      pollAir( wait_us );
+      processInFlight();
+      processTX();
+    }
+
+    mPub.close();
+    mSub.close();
+    mThreadActive = false;
+  }
+
+
+  void Adapter::pollAir( const uint32_t wait_us )
+  {
+    /*-------------------------------------------------
+    ZeroMQ only waits in whole milliseconds, so round
+    up and let the states run a little long
+    -------------------------------------------------*/
+    zmq::pollitem_t items[] = { { mSub.handle(), 0, ZMQ_POLLIN, 0 } };
+    zmq::poll( items, 1, std::chrono::milliseconds( ( wait_us + 999u ) / 1000u ) );
+    if ( !( items[ 0 ].revents & ZMQ_POLLIN ) )
+    {
+      return;
+    }
+
+    AirFrame frame;
+    while ( true )
+    {
+      const auto size = mSub.recv( zmq::mutable_buffer( &frame, sizeof( frame ) ), zmq::recv_flags::dontwait );
+      if ( !size )
+      {
+        break;
+      }
+
+      /*-------------------------------------------------
+      Ignore anything malformed or on another channel,
+      which a real radio would never have heard
+      -------------------------------------------------*/
+      if ( size->truncated() || ( size->size < AIR_HEADER ) || ( frame.length > SIM_FRAME_BYTES ) ||
+           ( size->size != ( AIR_HEADER + frame.length ) ) || ( frame.channel != mConfig.channel ) ||
+           ( frame.src == mConfig.pipes[ 1 ] ) )
+      {
+        continue;
+      }
+
+      /*-------------------------------------------------
+      Apply the link the frame came over. Frames arrive
+      once they have finished going out on air.
+      -------------------------------------------------*/
+      const LinkModel link = linkTo( frame.src );
+      if ( link.lossPerMille && ( ( nextRandom() % 1000u ) < link.lossPerMille ) )
+      {
+        continue;
+      }
+
+      uint32_t delay = airTime( frame.src, frame.length ) + link.latency_us;
+      if ( link.jitter_us )
+      {
+        delay += nextRandom() % ( link.jitter_us + 1u );
+      }
+
+      if ( mInFlight.full() )
+      {
+        LOG_DEBUG_IF( DEBUG_MODULE, "Sim delay line full, frame lost\r\n" );
+        continue;
+      }
+
+      /*-------------------------------------------------
+      A frame from someone else that is still arriving
+      while this one starts garbles both
+      -------------------------------------------------*/
+      const uint32_t arrive_us = static_cast<uint32_t>( Chimera::micros() ) + delay;
+      const uint32_t start_us  = arrive_us - airTime( frame.src, frame.length );
+      bool collided            = false;
+
+      for ( DelayedFrame &other : mInFlight )
+      {
+        const bool overlap = ( static_cast<int32_t>( start_us - other.arrive_us ) < 0 ) &&
+                             ( static_cast<int32_t>( other.start_us - arrive_us ) < 0 );
+        if ( overlap && ( other.frame.src != frame.src ) )
+        {
+          other.collided = true;
+          collided       = true;
+        }
+      }
+
+      mInFlight.push_back( { frame, start_us, arrive_us, collided } );
+    }
+  }
+
+
+  void Adapter::processInFlight()
+  {
+    const uint32_t now = static_cast<uint32_t>( Chimera::micros() );
+
+    for ( size_t idx = 0; idx < mInFlight.size(); )
+    {
+      if ( static_cast<int32_t>( now - mInFlight[ idx ].arrive_us ) >= 0 )
+      {
+        const AirFrame frame = mInFlight[ idx ].frame;
+        const bool collided  = mInFlight[ idx ].collided;
+        mInFlight.erase( mInFlight.begin() + idx );
+
+        if ( collided )
+        {
+          Chimera::Thread::LockGuard lck( mLock );
+          mStats.frame_rx_drop++;
+          mStats.rx_bytes_lost += frame.length;
+          continue;
+        }
+
+        onFrameArrived( frame );
+      }
+      else
+      {
+        idx++;
+      }
+    }
+  }
+
+
+  void Adapter::processTX()
+  {
+    const uint32_t now = static_cast<uint32_t>( Chimera::micros() );
+
+    switch ( mState )
+    {
+      case RadioState::IDLE: {
+        /*---------------------------------------------------------------------
+        Load the next frame. Every new frame gets the next packet ID, while
+        resends and repeats keep theirs.
+        ---------------------------------------------------------------------*/
+        {
+          Chimera::Thread::LockGuard lck( mLock );
+          if ( mTXQueue.empty() )
+          {
+            return;
+          }
+
+          mActive = mTXQueue.front();
+          mTXQueue.pop();
+        }
+
+        mNextPID          = ( mNextPID + 1u ) & PID_MASK;
+        mActive.frame.pid = mNextPID;
+        mAttempts         = 0;
+        mAirStart_us      = now;
+        mLatency.recordSince( LAT_LINK_QUEUE, mActive.queued_us );
+        startAttempt( now );
+      }
+      break;
+
+      case RadioState::ON_AIR:
+        if ( !expired( now, mStateStart_us, mStateLength_us ) )
+        {
+          return;
+        }
+
+        if ( mActive.requireACK )
+        {
+          mState          = RadioState::WAIT_ACK;
+          mStateStart_us  = now;
+          mStateLength_us = mConfig.ackTimeout_us;
+        }
+        else if ( mActive.repeats )
+        {
+          mActive.repeats--;
+          startAttempt( now );
+        }
+        else
+        {
+          finishActive( true );
+        }
+        break;
+
+      case RadioState::WAIT_ACK:
+        if ( !expired( now, mStateStart_us, mStateLength_us ) )
+        {
+          return;
+        }
+
+        /*---------------------------------------------------------------------
+        Missed the ACK. The extra random wait keeps two nodes sending to each
+        other from colliding in step on every retry.
+        ---------------------------------------------------------------------*/
+        if ( mAttempts > mConfig.retries )
+        {
+          finishActive( false );
+        }
+        else
+        {
+          mState          = RadioState::BACKOFF;
+          mStateStart_us  = now;
+          mStateLength_us = mConfig.retryDelay_us + ( nextRandom() % ( mConfig.retryDelay_us + 1u ) );
+        }
+        break;
+
+      case RadioState::BACKOFF:
+        if ( expired( now, mStateStart_us, mStateLength_us ) )
+        {
+          startAttempt( now );
+        }
+        break;
+
+      default:
+        mState = RadioState::IDLE;
+        break;
+    }
+  }
+
+
+  void Adapter::onFrameArrived( const AirFrame &frame )
+  {
+    /*-------------------------------------------------
+    The only thing heard while sending is the ACK for
+    the frame on air
+    -------------------------------------------------*/
+    if ( frame.type == AIR_ACK )
+    {
+      if ( ( mState == RadioState::WAIT_ACK ) && ( frame.src == mActive.frame.dst ) && ( frame.pid == mActive.frame.pid ) )
+      {
+        finishActive( true );
+      }
+      return;
+    }
+
+    if ( ( frame.type != AIR_DATA ) || ( frame.length < sizeof( FragmentHeader ) ) )
+    {
+      return;
+    }
+
+    const bool multicast = ( frame.dst == mConfig.multicastAddress );
+    if ( mState != RadioState::IDLE )
+    {
+      Chimera::Thread::LockGuard lck( mLock );
+      mStats.frame_rx_drop++;
+      mStats.rx_bytes_lost += frame.length;
+      return;
+    }
+
+    /*-------------------------------------------------
+    Take the frame in, unless it's a resend of the last
+    one taken from the same sender. Resends are still
+    ACKed, since the sender clearly missed the first.
+    -------------------------------------------------*/
+    bool queued   = false;
+    bool overflow = false;
+    {
+      Chimera::Thread::LockGuard lck( mLock );
+      if ( mRXQueue.full() )
+      {
+        overflow = true;
+        mStats.frame_rx_drop++;
+        mStats.rx_bytes_lost += frame.length;
+      }
+      else
+      {
+        const LastHeard heard = { frame.pid, payloadHash( frame ) };
+        auto iter             = mLastHeard.find( frame.src );
+
+        if ( ( iter != mLastHeard.end() ) && ( iter->second.pid == heard.pid ) && ( iter->second.hash == heard.hash ) )
+        {
+          LOG_DEBUG_IF( DEBUG_MODULE, "Dropped resent frame\r\n" );
+        }
+        else
+        {
+          if ( iter != mLastHeard.end() )
+          {
+            iter->second = heard;
+          }
+          else if ( !mLastHeard.full() )
+          {
+            mLastHeard.insert( { frame.src, heard } );
+          }
+
+          mRXQueue.push( { frame, static_cast<uint32_t>( Chimera::micros() ) } );
+          mStats.frame_rx++;
+          mStats.rx_bytes += frame.length;
+          queued = true;
+        }
+
+        if ( !multicast )
+        {
+          acknowledge( frame );
+        }
+      }
+    }
+
+    /*-------------------------------------------------
+    Tell the stack with no locks held
+    -------------------------------------------------*/
+    if ( queued )
+    {
+      mLastActive = Chimera::millis();
+      mCBService_registry.call<CallbackId::CB_RX_SUCCESS>();
+    }
+    else if ( overflow )
+    {
+      mCBService_registry.call<CallbackId::CB_ERROR_RX_QUEUE_FULL>();
+    }
+  }
+
+
+  void Adapter::acknowledge( const AirFrame &frame )
+  {
+    AirFrame ack;
+    ack.dst     = frame.src;
+    ack.src     = frame.dst;
+    ack.channel = mConfig.channel;
+    ack.type    = AIR_ACK;
+    ack.pid     = frame.pid;
+    ack.length  = 0;
+
+    publish( ack );
+  }
+
+
+  void Adapter::startAttempt( const uint32_t now )
+  {
+    mAttempts++;
+    publish( mActive.frame );
+
+    mState          = RadioState::ON_AIR;
+    mStateStart_us  = now;
+    mStateLength_us = airTime( mActive.frame.dst, mActive.frame.length );
+  }
+
+
+  void Adapter::finishActive( const bool success )
+  {
+    mState = RadioState::IDLE;
+
+    {
+      Chimera::Thread::LockGuard lck( mLock );
+      if ( success )
+      {
+        mStats.frame_tx++;
+        mStats.tx_bytes += mActive.frame.length;
+      }
+      else
+      {
+        mStats.frame_tx_fail++;
+        mStats.frame_tx_drop++;
+        mStats.tx_bytes_lost += mActive.frame.length;
+      }
+    }
+
+    if ( success )
+    {
+      mLatency.recordSince( LAT_LINK_AIR, mAirStart_us );
+      mLastActive = Chimera::millis();
+      mCBService_registry.call<CallbackId::CB_TX_SUCCESS>();
+    }
+    else
+    {
+      mCBService_registry.call<CallbackId::CB_ERROR_TX_FAILURE>();
+    }
+  }
+
+
+  void Adapter::publish( const AirFrame &frame )
+  {
+    try
+    {
+      mPub.send( zmq::const_buffer( &frame, AIR_HEADER + frame.length ), zmq::send_flags::dontwait );
+    }
+    catch ( const zmq::error_t &err )
+    {
+      /*-------------------------------------------------
+      Same as a frame lost on air. Retries cover it.
+      -------------------------------------------------*/
+      LOG_DEBUG_IF( DEBUG_MODULE, "Sim publish failed: %s\r\n", err.what() );
+    }
+  }
+
+
+  LinkModel Adapter::linkTo( const SimAddress peer )
+  {
+    Chimera::Thread::LockGuard lck( mLock );
+    auto iter = mLinks.find( peer );
+    return ( iter != mLinks.end() ) ? iter->second : mConfig.defaultLink;
+  }
+
+
+  uint32_t Adapter::airTime( const SimAddress peer, const size_t length )
+  {
+    const uint32_t bandwidth = linkTo( peer ).bandwidth;
+    if ( !bandwidth )
+    {
+      return 0;
+    }
+
+    const uint64_t bits = AIR_FRAME_BITS + ( length * 8u );
+    return static_cast<uint32_t>( ( bits * 1000000ull ) / bandwidth );
+  }
+
+
+  uint32_t Adapter::nextRandom()
+  {
+    mRandom ^= mRandom << 13;
+    mRandom ^= mRandom >> 17;
+    mRandom ^= mRandom << 5;
+    return mRandom;
+  }
+
+
+  Chimera::Status_t Adapter::queueMessage( const Fragment_sPtr head, const SimAddress dst, const bool requireACK,
+                                           const uint8_t repeats )
+  {
+    /*-------------------------------------------------
+    Queue the whole message or none of it
+    -------------------------------------------------*/
+    size_t numFrags = 0;
+    for ( Fragment_sPtr frag = head; frag; frag = frag->next )
+    {
+      if ( frag->length > FRAG_PAYLOAD )
+      {
+        LOG_ERROR( "Fragment of %d bytes won't fit a frame\r\n", frag->length );
+        return Chimera::Status::FAIL;
+      }
+
+      numFrags++;
+    }
+
+    bool full = false;
+    {
+      Chimera::Thread::LockGuard lck( mLock );
+      full = ( mTXQueue.available() < numFrags );
+
+      const uint32_t now = static_cast<uint32_t>( Chimera::micros() );
+      for ( Fragment_sPtr frag = head; frag && !full; frag = frag->next )
+      {
+        FragmentHeader hdr;
+        hdr.uuid   = frag->uuid;
+        hdr.number = static_cast<uint8_t>( frag->number );
+        hdr.total  = static_cast<uint8_t>( frag->total );
+        hdr.parity = frag->parity;
+        hdr.length = static_cast<uint8_t>( frag->length );
+
+        TXFrame tx;
+        tx.frame.dst     = dst;
+        tx.frame.src     = mConfig.pipes[ 1 ];
+        tx.frame.channel = mConfig.channel;
+        tx.frame.type    = AIR_DATA;
+        tx.frame.pid     = 0;
+        tx.frame.length  = static_cast<uint8_t>( sizeof( hdr ) + frag->length );
+        tx.requireACK    = requireACK;
+        tx.repeats       = repeats;
+        tx.queued_us     = now;
+
+        memcpy( tx.frame.payload, &hdr, sizeof( hdr ) );
+        memcpy( tx.frame.payload + sizeof( hdr ), frag->payload(), frag->length );
+
+        mTXQueue.push( tx );
+      }
+    }
+
+    if ( full )
+    {
+      mCBService_registry.call<CallbackId::CB_ERROR_TX_QUEUE_FULL>();
+      return Chimera::Status::FULL;
+    }
+
+    return Chimera::Status::OK;
+  }
+
+}    // namespace Ripple::NetIf::Simulator
+
+#endif /* SIMULATOR */
@@ -0,0 +1,351 @@
+/********************************************************************************
+ *  File Name:
+ *    sim_adapter.hpp
+ *
+ *  Description:
+ *    Simulated NRF24 radio that carries frames between processes over ZeroMQ
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_NETIF_SIMULATOR_HPP
+#define RIPPLE_NETIF_SIMULATOR_HPP
+
+#if defined( SIMULATOR )
+
+/* STL Includes */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* ETL Includes */
+#include <etl/map.h>
+#include <etl/queue.h>
+#include <etl/vector.h>
+
+/* Chimera Includes */
+#include <Chimera/thread>
+
+/* ZeroMQ Includes */
+#include <zmq.hpp>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/context.hpp>
+#include <Ripple/src/netif/device_intf.hpp>
+#include <Ripple/src/shared/cmn_latency.hpp>
+#include <Ripple/src/shared/cmn_static.hpp>
+
+namespace Ripple::NetIf::Simulator
+{
+  /*-------------------------------------------------------------------------------
+  Configuration
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Frames waiting to go on air, over all destinations
+   */
+  #if !defined( SIM_TX_QUEUE_DEPTH )
+  #define SIM_TX_QUEUE_DEPTH ( 64 )
+  #endif
+
+  /**
+   *  Frames heard but not yet pulled up the stack. A full queue stops the
+   *  radio from ACKing, same as a full RX FIFO.
+   */
+  #if !defined( SIM_RX_QUEUE_DEPTH )
+  #define SIM_RX_QUEUE_DEPTH ( 64 )
+  #endif
+
+  /**
+   *  Frames held back by the link model's latency and jitter
+   */
+  #if !defined( SIM_DELAY_QUEUE_DEPTH )
+  #define SIM_DELAY_QUEUE_DEPTH ( 128 )
+  #endif
+
+  /**
+   *  Longest powerDn() waits for the radio thread to let go of the sockets
+   */
+  #if !defined( SIM_STOP_TIMEOUT_MS )
+  #define SIM_STOP_TIMEOUT_MS ( 100 )
+  #endif
+
+  /**
+   *  Nodes with their own ARP entry or link model. Sized for a 50 node swarm.
+   */
+  #if !defined( SIM_MAX_PEERS )
+  #define SIM_MAX_PEERS ( 64 )
+  #endif
+
+  /*-------------------------------------------------------------------------------
+  Aliases
+  -------------------------------------------------------------------------------*/
+  using SimAddress = uint64_t; /**< Pipe address, only the low 40 bits are used like the NRF24 */
+
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr size_t SIM_FRAME_BYTES     = 32; /**< Largest NRF24 payload */
+  static constexpr size_t SIM_NUM_PIPES       = 6;  /**< Pipe 0 is left for ACKs like the hardware, 1-5 listen */
+  static constexpr SimAddress SIM_PIPE_CLOSED = 0;  /**< Pipe isn't listening */
+
+  /*-------------------------------------------------------------------------------
+  Enumerations
+  -------------------------------------------------------------------------------*/
+  enum AirFrameType : uint8_t
+  {
+    AIR_DATA, /**< Carries a fragment */
+    AIR_ACK,  /**< Confirms a data frame, payload is empty */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Impairments of the path from one node to another. Loss, latency and
+   *  jitter are applied where a frame is heard, bandwidth where it is sent.
+   *  On top of these, two frames from different senders that overlap on air
+   *  at a receiver are both lost there.
+   */
+  struct LinkModel
+  {
+    uint16_t lossPerMille = 0;       /**< Frames lost out of every thousand, ACKs included */
+    uint32_t latency_us   = 0;       /**< Fixed delay between a frame going on air and being heard */
+    uint32_t jitter_us    = 0;       /**< Most extra delay, drawn evenly for each frame */
+    uint32_t bandwidth    = 2000000; /**< Air data rate (bits/s), which sets how long a frame is on air */
+  };
+
+  /**
+   *  How a simulated radio joins the air. Every node connects to the same
+   *  broker, see runAirBroker().
+   */
+  struct SimConfig
+  {
+    const char *pubEndpoint            = "tcp://127.0.0.1:5550"; /**< Broker XSUB endpoint frames are sent to */
+    const char *subEndpoint            = "tcp://127.0.0.1:5551"; /**< Broker XPUB endpoint frames are heard from */
+    SimAddress pipes[ SIM_NUM_PIPES ]  = {};                     /**< Pipe 1 is this node, 2-5 optional, 0 unused */
+    uint8_t channel                    = 76;                     /**< Only frames on the same channel are heard */
+    uint8_t retries                    = 15;                     /**< Resends after the first attempt, like ARC */
+    uint32_t retryDelay_us             = 500;                    /**< Wait after a missed ACK, like ARD */
+    uint32_t ackTimeout_us             = 5000;                   /**< Longest to wait on an ACK, ZeroMQ delay included */
+    SimAddress multicastAddress        = 0xE7E7E7E7E7ull;        /**< Heard by every node, never ACKed */
+    LinkModel defaultLink;                                       /**< Used for any peer without its own model */
+    uint32_t seed                      = 1;                      /**< Seeds loss and jitter, mixed with pipe 1 */
+  };
+
+  /**
+   *  Frame as it crosses the broker. The destination comes first so the ZeroMQ
+   *  subscription filter does the job of the pipe address match.
+   */
+  struct AirFrame
+  {
+    SimAddress dst;                    /**< Pipe address the frame is sent to */
+    SimAddress src;                    /**< Pipe address of the sender, or the pipe an ACK answers for */
+    uint8_t channel;                   /**< RF channel */
+    uint8_t type;                      /**< AirFrameType */
+    uint8_t pid;                       /**< 2-bit packet ID, bumped for every new frame */
+    uint8_t length;                    /**< Bytes in payload */
+    uint8_t payload[ SIM_FRAME_BYTES ];
+  };
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Behaves like an NRF24 running Enhanced ShockBurst: 32 byte frames, auto
+   *  ACK with retries, duplicate rejection by packet ID, and a half duplex
+   *  radio that can't hear data frames while it sends or waits for an ACK.
+   *  Overlapping frames collide and loss is drawn per link. Fragments go out
+   *  one per frame behind a small header.
+   *
+   *  This is a network interface of its own and not a PHY under the NRF24
+   *  DataLink, so none of the DataLink's framing, scheduling or services run
+   *  in the simulation. ARP entries map IP addresses to pipe 1 addresses and
+   *  must be added by whoever sets up the swarm.
+   */
+  class Adapter : public INetIf, public IARP
+  {
+  public:
+    Adapter( const SimConfig &cfg );
+    ~Adapter();
+
+    /*-------------------------------------------------------------------------------
+    Net Interface
+    -------------------------------------------------------------------------------*/
+    bool powerUp( void * context ) final override;
+    void powerDn() final override;
+    Chimera::Status_t recv( Fragment_sPtr &fragmentList ) final override;
+    Chimera::Status_t send( const Fragment_sPtr head, const IPAddress &ip, const TrafficClass tc ) final override;
+    Chimera::Status_t sendMulticast( const Fragment_sPtr head, const uint8_t repeats, const TrafficClass tc ) final override;
+    void getStats( PerfStats &stats ) final override;
+    void getLatencyStats( LatencyReport &report ) final override;
+    IARP *addressResolver() final override;
+    size_t maxTransferSize() const final override;
+    size_t maxUnfragmentedSize() const final override;
+    size_t maxNumFragments() const final override;
+    size_t linkSpeed() const final override;
+    size_t lastActive() const final override;
+
+    /*-------------------------------------------------------------------------------
+    ARP Interface
+    -------------------------------------------------------------------------------*/
+    Chimera::Status_t addARPEntry( const IPAddress &ip, const void *const mac, const size_t size ) final override;
+    Chimera::Status_t dropARPEntry( const IPAddress &ip ) final override;
+    bool arpLookUp( const IPAddress &ip, void *const mac, const size_t size ) final override;
+    IPAddress arpLookUp( const void *const mac, const size_t size ) final override;
+
+    /*-------------------------------------------------------------------------------
+    Simulator Specific Functions
+    -------------------------------------------------------------------------------*/
+    /**
+     *  Sets the impairments of the path to and from one peer, replacing the
+     *  default model for it
+     *
+     *  @param[in]  peer        Pipe 1 address of the peer
+     *  @param[in]  model       Impairments to apply
+     *  @return bool            False if the peer table is full
+     */
+    bool setLinkModel( const SimAddress peer, const LinkModel &model );
+
+  private:
+    /**
+     *  A frame heard off the air, held until the link model lets it arrive
+     */
+    struct DelayedFrame
+    {
+      AirFrame frame;      /**< Frame as heard */
+      uint32_t start_us;   /**< When the frame started arriving */
+      uint32_t arrive_us;  /**< When the frame reaches the radio */
+      bool collided;       /**< Overlapped another frame on air */
+    };
+
+    /**
+     *  A frame the radio has taken in
+     */
+    struct RXFrame
+    {
+      AirFrame frame;      /**< Frame as heard */
+      uint32_t queued_us;  /**< When it was queued for the stack */
+    };
+
+    /**
+     *  A frame waiting to be sent
+     */
+    struct TXFrame
+    {
+      AirFrame frame;      /**< Frame to put on air */
+      bool requireACK;     /**< Resend until ACKed, or send once */
+      uint8_t repeats;     /**< Extra copies of an unACKed frame */
+      uint32_t queued_us;  /**< When send() took the frame */
+    };
+
+    /**
+     *  Last frame taken from a sender, to tell a resend from a new frame
+     */
+    struct LastHeard
+    {
+      uint8_t pid;    /**< Packet ID of the frame */
+      uint32_t hash;  /**< Hash of the payload, standing in for the CRC */
+    };
+
+    enum class RadioState : uint8_t
+    {
+      IDLE,     /**< Listening, free to send */
+      ON_AIR,   /**< Frame going out, blind to data frames */
+      WAIT_ACK, /**< Listening for the ACK only */
+      BACKOFF,  /**< Retry delay after a missed ACK */
+    };
+
+    SimConfig mConfig;
+    Context_rPtr mContext;
+    Chimera::Thread::Mutex mLock;                               /**< Guards the queues, ARP and link tables */
+    Chimera::Thread::TaskId mTaskId;                            /**< Radio thread */
+    std::atomic<bool> mRunning;                                 /**< Radio thread keeps going while set */
+    std::atomic<bool> mThreadActive;                            /**< Radio thread started and hasn't exited */
+    void *mStack;                                               /**< Radio thread stack, kept across power cycles */
+
+    zmq::context_t mZMQ;                                        /**< ZeroMQ I/O context */
+    zmq::socket_t mPub;                                         /**< Sends frames to the broker */
+    zmq::socket_t mSub;                                         /**< Hears frames addressed to an open pipe */
+
+    etl::map<IPAddress, SimAddress, SIM_MAX_PEERS> mARP;        /**< IP to pipe 1 address */
+    etl::map<SimAddress, LinkModel, SIM_MAX_PEERS> mLinks;      /**< Per peer impairments */
+    etl::map<SimAddress, LastHeard, SIM_MAX_PEERS> mLastHeard;  /**< Last frame taken from each sender */
+    etl::queue<TXFrame, SIM_TX_QUEUE_DEPTH> mTXQueue;           /**< Frames waiting to go on air */
+    etl::queue<RXFrame, SIM_RX_QUEUE_DEPTH> mRXQueue;           /**< Frames waiting to go up the stack */
+    etl::vector<DelayedFrame, SIM_DELAY_QUEUE_DEPTH> mInFlight; /**< Frames still crossing the air */
+
+    RadioState mState;                                          /**< What the radio is doing */
+    TXFrame mActive;                                            /**< Frame being sent, valid outside of IDLE */
+    uint8_t mAttempts;                                          /**< Sends of the active frame so far */
+    uint8_t mNextPID;                                           /**< Packet ID of the next new frame */
+    uint32_t mStateStart_us;                                    /**< When the radio entered its state */
+    uint32_t mStateLength_us;                                   /**< How long the state lasts */
+    uint32_t mAirStart_us;                                      /**< When the active frame first went on air */
+    uint32_t mRandom;                                           /**< xorshift32 state */
+    size_t mLastActive;                                         /**< Last TX success or RX (ms) */
+    PerfStats mStats;
+    LatencyRecorder mLatency;
+
+    /**
+     *  Radio thread. Moves frames between the air, the delay line and the
+     *  queues, and runs the ACK/retry state machine.
+     *
+     *  @param[in]  arg         Unused
+     *  @return void
+     */
+    void run( void *arg );
+
+    void pollAir( const uint32_t wait_us );
+    void processInFlight();
+    void processTX();
+    void onFrameArrived( const AirFrame &frame );
+    void acknowledge( const AirFrame &frame );
+    void startAttempt( const uint32_t now );
+    void finishActive( const bool success );
+    void publish( const AirFrame &frame );
+    bool isOwnPipe( const SimAddress address ) const;
+    LinkModel linkTo( const SimAddress peer );
+    uint32_t airTime( const SimAddress peer, const size_t length );
+    uint32_t nextRandom();
+    Chimera::Status_t queueMessage( const Fragment_sPtr head, const SimAddress dst, const bool requireACK,
+                                    const uint8_t repeats );
+  };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Creates a simulated radio
+   *
+   *  @param[in]  context       The current network context
+   *  @param[in]  cfg           How the radio joins the air
+   *  @return Adapter *
+   */
+  Adapter *createNetIf( Context_rPtr context, const SimConfig &cfg );
+
+  /**
+   *  Creates a simulated radio in statically placed storage
+   *
+   *  @param[in]  slot          Storage to construct into
+   *  @param[in]  cfg           How the radio joins the air
+   *  @return Adapter *         nullptr if the slot was already claimed
+   */
+  Adapter *createNetIf( StaticSlot<Adapter> &slot, const SimConfig &cfg );
+
+  /**
+   *  Runs the broker all simulated radios meet at. Every frame sent to the
+   *  XSUB endpoint is passed to each node subscribed to its destination on
+   *  the XPUB endpoint. Blocks for as long as the broker runs, so give it a
+   *  process or thread of its own.
+   *
+   *  @param[in]  xsubEndpoint  Where nodes send frames, matches SimConfig::pubEndpoint
+   *  @param[in]  xpubEndpoint  Where nodes hear frames, matches SimConfig::subEndpoint
+   *  @return bool              False if the endpoints couldn't be bound
+   */
+  bool runAirBroker( const char *const xsubEndpoint, const char *const xpubEndpoint );
+
+}    // namespace Ripple::NetIf::Simulator
+
+#endif /* SIMULATOR */
+#endif /* !RIPPLE_NETIF_SIMULATOR_HPP */
@@ -0,0 +1,409 @@
+/********************************************************************************
+ *  File Name:
+ *    codec.cpp
+ *
+ *  Description:
+ *    Keyframe and delta coding of application packets
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <cstring>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/codec.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr uint8_t RUN_OF_ZEROS = 0x80; /**< Token flag: zeros follow, none stored */
+  static constexpr size_t MAX_RUN       = 0x80; /**< Longest run or literal one token covers */
+
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Packs runs of zeros down to a single token byte
+   *
+   * A token with RUN_OF_ZEROS set stands for ( token & 0x7F ) + 1 zeros. One
+   * without it is followed by token + 1 literal bytes. Lone zeros are left in
+   * a literal, as a token of their own would cost just as much.
+   *
+   * @param src       Bytes to pack
+   * @param size      Number of bytes
+   * @param dst       Where to pack to
+   * @param limit     Most bytes to pack into
+   * @return size_t   Packed bytes, zero if they didn't fit
+   */
+  static size_t packZeroRuns( const uint8_t *const src, const size_t size, uint8_t *const dst, const size_t limit )
+  {
+    size_t in  = 0;
+    size_t out = 0;
+
+    while ( in < size )
+    {
+      size_t run = 0;
+      if ( !src[ in ] )
+      {
+        while ( ( ( in + run ) < size ) && !src[ in + run ] && ( run < MAX_RUN ) )
+        {
+          run++;
+        }
+
+        if ( out >= limit )
+        {
+          return 0;
+        }
+
+        dst[ out++ ] = RUN_OF_ZEROS | static_cast<uint8_t>( run - 1u );
+        in += run;
+        continue;
+      }
+
+      /*-------------------------------------------------
+      Literal, until two zeros in a row make a run worth it
+      -------------------------------------------------*/
+      while ( ( ( in + run ) < size ) && ( run < MAX_RUN ) )
+      {
+        const size_t next = in + run;
+        if ( !src[ next ] && ( ( ( next + 1u ) >= size ) || !src[ next + 1u ] ) )
+        {
+          break;
+        }
+
+        run++;
+      }
+
+      if ( ( out + 1u + run ) > limit )
+      {
+        return 0;
+      }
+
+      dst[ out++ ] = static_cast<uint8_t>( run - 1u );
+      memcpy( dst + out, src + in, run );
+      out += run;
+      in += run;
+    }
+
+    return out;
+  }
+
+
+  /**
+   * @brief Undoes packZeroRuns()
+   *
+   * @param src       Packed bytes
+   * @param size      Number of packed bytes
+   * @param dst       Where to unpack to
+   * @param expected  Bytes the data must unpack to
+   * @return true     Data unpacked to exactly the expected size
+   * @return false    Data was malformed
+   */
+  static bool unpackZeroRuns( const uint8_t *const src, const size_t size, uint8_t *const dst, const size_t expected )
+  {
+    size_t in  = 0;
+    size_t out = 0;
+
+    while ( in < size )
+    {
+      const uint8_t token = src[ in++ ];
+      const size_t run    = ( token & ~RUN_OF_ZEROS ) + 1u;
+
+      if ( ( out + run ) > expected )
+      {
+        return false;
+      }
+
+      if ( token & RUN_OF_ZEROS )
+      {
+        memset( dst + out, 0, run );
+      }
+      else if ( ( in + run ) <= size )
+      {
+        memcpy( dst + out, src + in, run );
+        in += run;
+      }
+      else
+      {
+        return false;
+      }
+
+      out += run;
+    }
+
+    return out == expected;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  RecordCodec Class
+  -------------------------------------------------------------------------------*/
+  RecordCodec::RecordCodec( Aurora::Memory::Heap *const heap ) : mHeap( heap ), mInterval( 0 )
+  {
+    memset( mTXRef, 0, sizeof( mTXRef ) );
+    memset( mRXRef, 0, sizeof( mRXRef ) );
+    memset( &mStats, 0, sizeof( mStats ) );
+    memset( &mPending, 0, sizeof( mPending ) );
+  }
+
+
+  RecordCodec::~RecordCodec()
+  {
+    for ( size_t x = 0; x < NUM_PACKET_IDS; x++ )
+    {
+      release( mTXRef[ x ] );
+      release( mRXRef[ x ] );
+    }
+  }
+
+
+  void RecordCodec::reset( const size_t keyframeInterval )
+  {
+    /*-------------------------------------------------------------------------
+    Keep the memory, just invalidate what it holds. The keyframe counters
+    carry on so a peer can't match a delta against a stale reference.
+    -------------------------------------------------------------------------*/
+    for ( size_t x = 0; x < NUM_PACKET_IDS; x++ )
+    {
+      mTXRef[ x ].size     = 0;
+      mTXRef[ x ].sinceKey = 0;
+      mRXRef[ x ].size     = 0;
+    }
+
+    mInterval = keyframeInterval;
+    memset( &mStats, 0, sizeof( mStats ) );
+    memset( &mPending, 0, sizeof( mPending ) );
+  }
+
+
+  bool RecordCodec::encode( const PacketFiller &filler, const size_t bytes, PacketCopy &coded )
+  {
+    /*-------------------------------------------------------------------------
+    Produce the record as it would have been sent
+    -------------------------------------------------------------------------*/
+    PacketWriter writer( mRecord, sizeof( mRecord ), nullptr, 0 );
+    if ( ( bytes > sizeof( mRecord ) ) || !filler( writer ) || ( writer.written() != bytes ) )
+    {
+      return false;
+    }
+
+    coded.data     = mRecord;
+    coded.bytes    = bytes;
+    mPending.valid = false;
+
+    const PacketHdr *hdr = reinterpret_cast<const PacketHdr *>( mRecord );
+    const uint8_t *raw   = mRecord + sizeof( PacketHdr );
+
+    if ( !enabled() || ( bytes < sizeof( PacketHdr ) ) || ( bytes != ( sizeof( PacketHdr ) + hdr->size ) ) ||
+         !packetIdValid( hdr->id ) || ( hdr->codec != RECORD_CODEC_NONE ) || !hdr->size )
+    {
+      return true;
+    }
+
+    /*-------------------------------------------------------------------------
+    Keyframe when due, or when there's nothing the peer could match against.
+    The reference itself is left alone until commit(), the record may yet be
+    refused by the socket.
+    -------------------------------------------------------------------------*/
+    Reference &ref   = mTXRef[ hdr->id ];
+    const bool key   = ( ref.size != hdr->size ) || ( ( ref.sinceKey + 1u ) >= mInterval );
+    PacketHdr *out   = reinterpret_cast<PacketHdr *>( mCoded );
+    uint8_t *payload = mCoded + sizeof( PacketHdr );
+    size_t size      = 0;
+
+    mPending.valid = true;
+    mPending.type  = RECORD_CODEC_NONE;
+    mPending.coded = hdr->size;
+
+    if ( key )
+    {
+      size = packZeroRuns( raw, hdr->size, payload, hdr->size - 1u );
+    }
+    else
+    {
+      uint8_t delta[ CODEC_MAX_PAYLOAD ];
+      for ( size_t x = 0; x < hdr->size; x++ )
+      {
+        delta[ x ] = raw[ x ] ^ ref.data[ x ];
+      }
+
+      size = packZeroRuns( delta, hdr->size, payload, hdr->size - 1u );
+    }
+
+    /*-------------------------------------------------------------------------
+    A keyframe that didn't pack goes out raw, but is still announced as the
+    reference. Otherwise the size check above would never be satisfied and
+    every sample after it would be another keyframe.
+    -------------------------------------------------------------------------*/
+    RecordCodecType type = key ? RECORD_CODEC_KEY : RECORD_CODEC_DELTA;
+    if ( key && !size )
+    {
+      memcpy( payload, raw, hdr->size );
+      size = hdr->size;
+      type = RECORD_CODEC_RAW;
+    }
+
+    /*-------------------------------------------------------------------------
+    Send it plain if a delta didn't help. Room for a keyframe is found now, so
+    commit() can't fail to hold one the peer was already sent. Without it the
+    old reference stays, and the keyframe can't be announced either.
+    -------------------------------------------------------------------------*/
+    if ( !size || ( key && !reserve( ref, hdr->size ) ) )
+    {
+      return true;
+    }
+
+    out->id       = hdr->id;
+    out->size     = static_cast<uint8_t>( size );
+    out->codec    = type;
+    out->rawSize  = hdr->size;
+    out->keyframe = key ? static_cast<uint8_t>( ref.keyframe + 1u ) : ref.keyframe;
+
+    mPending.type  = type;
+    mPending.coded = size;
+    coded.data     = mCoded;
+    coded.bytes    = sizeof( PacketHdr ) + size;
+    return true;
+  }
+
+
+  void RecordCodec::commit()
+  {
+    if ( !mPending.valid )
+    {
+      return;
+    }
+
+    const PacketHdr *hdr = reinterpret_cast<const PacketHdr *>( mRecord );
+    Reference &ref       = mTXRef[ hdr->id ];
+
+    mPending.valid = false;
+    mStats.txRawBytes += hdr->size;
+    mStats.txCodedBytes += mPending.coded;
+
+    switch ( mPending.type )
+    {
+      case RECORD_CODEC_KEY:
+      case RECORD_CODEC_RAW:
+        store( ref, mRecord + sizeof( PacketHdr ), hdr->size );
+        ref.keyframe++;
+        ref.sinceKey = 0;
+        mStats.txKeyframes++;
+        break;
+
+      case RECORD_CODEC_DELTA:
+        ref.sinceKey++;
+        mStats.txDeltas++;
+        break;
+
+      default:
+        mStats.txPlain++;
+        break;
+    }
+  }
+
+
+  size_t RecordCodec::decode( const uint8_t *const record, const size_t bytes, uint8_t *const payload )
+  {
+    const PacketHdr *hdr = reinterpret_cast<const PacketHdr *>( record );
+    if ( ( bytes < sizeof( PacketHdr ) ) || ( bytes < ( sizeof( PacketHdr ) + hdr->size ) ) || !packetIdValid( hdr->id ) )
+    {
+      mStats.rxDropped++;
+      return 0;
+    }
+
+    Reference &ref      = mRXRef[ hdr->id ];
+    const uint8_t *data = record + sizeof( PacketHdr );
+
+    /*-------------------------------------------------------------------------
+    Keyframes stand on their own. Deltas need the keyframe they were taken
+    against, which the counter and size have to agree on.
+    -------------------------------------------------------------------------*/
+    bool keyframe = false;
+    if ( hdr->codec == RECORD_CODEC_KEY )
+    {
+      keyframe = unpackZeroRuns( data, hdr->size, payload, hdr->rawSize );
+    }
+    else if ( ( hdr->codec == RECORD_CODEC_RAW ) && ( hdr->size == hdr->rawSize ) )
+    {
+      memcpy( payload, data, hdr->size );
+      keyframe = true;
+    }
+
+    if ( keyframe )
+    {
+      if ( store( ref, payload, hdr->rawSize ) )
+      {
+        ref.keyframe = hdr->keyframe;
+      }
+
+      mStats.rxDecoded++;
+      return hdr->rawSize;
+    }
+
+    const bool matched = ( hdr->codec == RECORD_CODEC_DELTA ) && ref.size && ( ref.size == hdr->rawSize ) &&
+                         ( ref.keyframe == hdr->keyframe );
+    if ( !matched || !unpackZeroRuns( data, hdr->size, payload, hdr->rawSize ) )
+    {
+      mStats.rxDropped++;
+      return 0;
+    }
+
+    for ( size_t x = 0; x < hdr->rawSize; x++ )
+    {
+      payload[ x ] ^= ref.data[ x ];
+    }
+
+    mStats.rxDecoded++;
+    return hdr->rawSize;
+  }
+
+
+  bool RecordCodec::reserve( Reference &ref, const size_t size )
+  {
+    if ( ref.capacity < size )
+    {
+      release( ref );
+
+      ref.data = reinterpret_cast<uint8_t *>( mHeap->malloc( size ) );
+      if ( !ref.data )
+      {
+        return false;
+      }
+
+      ref.capacity = static_cast<uint8_t>( size );
+    }
+
+    return true;
+  }
+
+
+  bool RecordCodec::store( Reference &ref, const uint8_t *const payload, const size_t size )
+  {
+    if ( !reserve( ref, size ) )
+    {
+      return false;
+    }
+
+    memcpy( ref.data, payload, size );
+    ref.size = static_cast<uint8_t>( size );
+    return true;
+  }
+
+
+  void RecordCodec::release( Reference &ref )
+  {
+    if ( ref.data )
+    {
+      mHeap->free( ref.data );
+    }
+
+    ref.data     = nullptr;
+    ref.capacity = 0;
+    ref.size     = 0;
+  }
+
+}    // namespace Ripple
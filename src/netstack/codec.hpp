@@ -0,0 +1,184 @@
+/********************************************************************************
+ *  File Name:
+ *    codec.hpp
+ *
+ *  Description:
+ *    Optional per-socket stage that shrinks slowly changing application packets
+ *    by sending them as a difference against the last keyframe, with runs of
+ *    zeros squeezed out.
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_NETSTACK_CODEC_HPP
+#define RIPPLE_NETSTACK_CODEC_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/* Aurora Includes */
+#include <Aurora/memory>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/packets/packet.hpp>
+#include <Ripple/src/netstack/packets/registry.hpp>
+#include <Ripple/src/netstack/packets/types.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr size_t CODEC_MAX_PAYLOAD = std::numeric_limits<decltype( PacketHdr::size )>::max();
+  static constexpr size_t CODEC_MAX_RECORD  = sizeof( PacketHdr ) + CODEC_MAX_PAYLOAD;
+
+  /*-------------------------------------------------------------------------------
+  Enumerations
+  -------------------------------------------------------------------------------*/
+  /**
+   *  How the bytes after a PacketHdr are coded, kept in PacketHdr::codec
+   */
+  enum RecordCodecType : uint8_t
+  {
+    RECORD_CODEC_NONE  = 0, /**< Plain record */
+    RECORD_CODEC_KEY   = 1, /**< Zero runs packed, becomes the new reference */
+    RECORD_CODEC_DELTA = 2, /**< XOR against the reference, then zero runs packed */
+    RECORD_CODEC_RAW   = 3, /**< Keyframe that didn't pack, sent as is but still the new reference */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  struct CodecStats
+  {
+    size_t txKeyframes;  /**< Records sent as keyframes */
+    size_t txDeltas;     /**< Records sent as deltas */
+    size_t txPlain;      /**< Records that didn't shrink and went out as is */
+    size_t txRawBytes;   /**< Payload bytes handed to the codec */
+    size_t txCodedBytes; /**< Payload bytes the codec put on the wire */
+    size_t rxDecoded;    /**< Coded records restored */
+    size_t rxDropped;    /**< Coded records without a matching keyframe */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Keyframe and delta coding of application packets, per packet ID
+   *
+   * Every keyframeInterval'th sample of a packet goes out as a keyframe. The
+   * ones between are XOR'd against that keyframe, so a sample that barely
+   * changed turns into mostly zeros, which then pack down to a byte per run.
+   * Deltas are taken against the keyframe rather than the sample before, so
+   * losing one costs only that one. Losing a keyframe drops the deltas that
+   * follow it until the next keyframe arrives.
+   *
+   * Both ends of a link have to run the codec. The receiving half keeps one
+   * reference per packet ID, so a socket only decodes cleanly from a single
+   * sender of each packet. A delta whose keyframe doesn't match is dropped.
+   *
+   * Deltas that wouldn't get any smaller are sent plain. Keyframes that don't
+   * pack still go out as raw keyframes, so the deltas after them have
+   * something to match. Not thread safe, the owning socket's lock guards it.
+   */
+  class RecordCodec
+  {
+  public:
+    /**
+     * @param heap      Where the reference samples are allocated from
+     */
+    explicit RecordCodec( Aurora::Memory::Heap *const heap );
+    ~RecordCodec();
+
+    /**
+     * @brief Forgets every reference and sets how often keyframes go out
+     *
+     * @param keyframeInterval    Samples per keyframe, zero to stop coding
+     */
+    void reset( const size_t keyframeInterval );
+
+    /**
+     * @brief Checks if outgoing records are being coded
+     */
+    bool enabled() const
+    {
+      return mInterval != 0;
+    }
+
+    /**
+     * @brief Produces a record and codes it, if that makes it smaller
+     *
+     * Nothing is taken as sent yet. Call commit() once the record was queued,
+     * otherwise the next encode() codes against the same reference as before.
+     *
+     * @param filler    Writes exactly bytes of the record, starting with its PacketHdr
+     * @param bytes     Bytes in the record, at most CODEC_MAX_RECORD
+     * @param coded     Set to the record to send. Valid until the next call.
+     * @return true     The record was produced
+     * @return false    The filler failed
+     */
+    bool encode( const PacketFiller &filler, const size_t bytes, PacketCopy &coded );
+
+    /**
+     * @brief Takes the record from the last encode() as sent, moving the
+     * reference on if it was a keyframe. Does nothing if there is none.
+     */
+    void commit();
+
+    /**
+     * @brief Restores the payload of a coded record
+     *
+     * @param record    Record, starting with its PacketHdr
+     * @param bytes     Bytes in the record
+     * @param payload   Where to restore to, at least CODEC_MAX_PAYLOAD bytes
+     * @return size_t   Bytes restored, zero if the record can't be decoded
+     */
+    size_t decode( const uint8_t *const record, const size_t bytes, uint8_t *const payload );
+
+    void getStats( CodecStats &stats ) const
+    {
+      stats = mStats;
+    }
+
+  private:
+    /**
+     * @brief Last keyframe of one packet ID, in one direction
+     */
+    struct Reference
+    {
+      uint8_t *data;    /**< Keyframe payload, nullptr until the first one */
+      uint8_t capacity; /**< Bytes allocated at data */
+      uint8_t size;     /**< Bytes of the keyframe, zero if none is held */
+      uint8_t keyframe; /**< Counter of the keyframe held */
+      size_t sinceKey;  /**< Samples coded against it, TX only */
+    };
+
+    Aurora::Memory::Heap *mHeap;
+    size_t mInterval;
+    Reference mTXRef[ NUM_PACKET_IDS ];
+    Reference mRXRef[ NUM_PACKET_IDS ];
+    uint8_t mRecord[ CODEC_MAX_RECORD ]; /**< Record as the filler produced it */
+    uint8_t mCoded[ CODEC_MAX_RECORD ];  /**< Record as it goes on the wire */
+    CodecStats mStats;
+
+    /**
+     * @brief Record encode() produced, waiting on commit()
+     */
+    struct Pending
+    {
+      bool valid;           /**< An encoded record is waiting */
+      RecordCodecType type; /**< How it was coded, RECORD_CODEC_NONE if plain */
+      size_t coded;         /**< Payload bytes it put on the wire */
+    } mPending;
+
+    bool reserve( Reference &ref, const size_t size );
+    bool store( Reference &ref, const uint8_t *const payload, const size_t size );
+    void release( Reference &ref );
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_NETSTACK_CODEC_HPP */
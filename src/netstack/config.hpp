@@ -20,6 +20,20 @@
 #define RIPPLE_CTX_MAX_SOCKETS ( 4 )
 #endif
 
+/**
+ * Max number of network interfaces attached to one context
+ */
+#if !defined( RIPPLE_CTX_MAX_NETIF )
+#define RIPPLE_CTX_MAX_NETIF ( 3 )
+#endif
+
+/**
+ * Max number of entries in a context's routing table
+ */
+#if !defined( RIPPLE_CTX_MAX_ROUTES )
+#define RIPPLE_CTX_MAX_ROUTES ( 8 )
+#endif
+
 /**
  * Max number of fragmented packets that are being assembled at any given time
  */
@@ -27,6 +41,22 @@
 #define RIPPLE_CTX_MAX_PKT ( 32 )
 #endif
 
+/**
+ * Longest time (ms) the context manager thread sleeps when no events or
+ * deadlines are pending. Only bounds housekeeping, not latency.
+ */
+#if !defined( RIPPLE_CTX_IDLE_PERIOD )
+#define RIPPLE_CTX_IDLE_PERIOD ( 100 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+/**
+ * Longest (uS) one pass of the context manager thread may spend working
+ * before CB_SERVICE_OVERRUN fires. Zero turns the check off.
+ */
+#if !defined( RIPPLE_CTX_LOOP_BUDGET_US )
+#define RIPPLE_CTX_LOOP_BUDGET_US ( 2000 )
+#endif
+
 /**
  * Amount of time (ms) a fragmented packet can spend being assembled in the net
  * stack. For example, if a packet has 10 fragments then all 10 fragments must
@@ -36,4 +66,163 @@
 #define RIPPLE_PKT_LIFETIME ( 750 * Chimera::Thread::TIMEOUT_1MS )
 #endif
 
+/**
+ * Amount of time (ms) an assembly can go without receiving a fragment before
+ * the sender is asked to resend the ones still missing.
+ */
+#if !defined( RIPPLE_NACK_DELAY )
+#define RIPPLE_NACK_DELAY ( 30 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+/**
+ * Max number of resend requests made for a single packet before leaving it to
+ * the assembly timeout.
+ */
+#if !defined( RIPPLE_NACK_RETRIES )
+#define RIPPLE_NACK_RETRIES ( 3 )
+#endif
+
+/**
+ * Max number of sent, fragmented packets held onto in case the receiver asks
+ * for some of their fragments again. The oldest is released when full.
+ */
+#if !defined( RIPPLE_CTX_MAX_RETAINED )
+#define RIPPLE_CTX_MAX_RETAINED ( 4 )
+#endif
+
+/**
+ * Amount of time (ms) a sent packet is held onto for resend requests. Should
+ * cover a few rounds of RIPPLE_NACK_DELAY.
+ */
+#if !defined( RIPPLE_PKT_RETENTION )
+#define RIPPLE_PKT_RETENTION ( 150 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+/**
+ * Bytes of bookkeeping the shared pointers add to each allocation they make.
+ * Pool blocks are sized to hold the object plus this much.
+ */
+#if !defined( RIPPLE_POOL_BLOCK_OVERHEAD )
+#define RIPPLE_POOL_BLOCK_OVERHEAD ( 16 )
+#endif
+
+/**
+ * Number of fragment payload buffers kept in a fixed pool. Zero disables the
+ * pool and leaves those allocations to the heap.
+ */
+#if !defined( RIPPLE_POOL_PAYLOAD_BLOCKS )
+#define RIPPLE_POOL_PAYLOAD_BLOCKS ( 48 )
+#endif
+
+/**
+ * Number of fragment control structures kept in a fixed pool
+ */
+#if !defined( RIPPLE_POOL_FRAGMENT_BLOCKS )
+#define RIPPLE_POOL_FRAGMENT_BLOCKS ( 48 )
+#endif
+
+/**
+ * Number of packet control structures kept in a fixed pool
+ */
+#if !defined( RIPPLE_POOL_PACKET_BLOCKS )
+#define RIPPLE_POOL_PACKET_BLOCKS ( 12 )
+#endif
+
+/**
+ * Most packets a socket can hold waiting to be sent. SocketConfig::txQueueDepth
+ * can set a lower limit per socket.
+ */
+#if !defined( RIPPLE_SOCK_TX_QUEUE_DEPTH )
+#define RIPPLE_SOCK_TX_QUEUE_DEPTH ( 5 )
+#endif
+
+/**
+ * Most received packets a socket can hold waiting to be processed
+ */
+#if !defined( RIPPLE_SOCK_RX_QUEUE_DEPTH )
+#define RIPPLE_SOCK_RX_QUEUE_DEPTH ( 5 )
+#endif
+
+/**
+ * Amount of time (ms) before a socket retries sending into a netif that was
+ * full. The retry happens sooner if the netif reports a frame went out.
+ */
+#if !defined( RIPPLE_CTX_TX_RETRY_DELAY )
+#define RIPPLE_CTX_TX_RETRY_DELAY ( 5 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+/**
+ * Bytes each socket sets aside to gather small packets into one transport
+ * packet. Caps SocketConfig::coalesceBytes.
+ */
+#if !defined( RIPPLE_SOCK_COALESCE_BYTES )
+#define RIPPLE_SOCK_COALESCE_BYTES ( 64 )
+#endif
+
+/**
+ * Bytes a stream socket holds on to until the peer acknowledges them. Bounds
+ * how much a writer can get ahead of the link.
+ */
+#if !defined( RIPPLE_STREAM_TX_BUFFER )
+#define RIPPLE_STREAM_TX_BUFFER ( 1024 )
+#endif
+
+/**
+ * Bytes a stream socket can hold for the reader. The free space is the window
+ * advertised to the sender.
+ */
+#if !defined( RIPPLE_STREAM_RX_BUFFER )
+#define RIPPLE_STREAM_RX_BUFFER ( 1024 )
+#endif
+
+/**
+ * Most payload bytes in one stream segment. Each segment is one transport
+ * packet, so this must fit in the fragment limit of a packet.
+ */
+#if !defined( RIPPLE_STREAM_SEGMENT_BYTES )
+#define RIPPLE_STREAM_SEGMENT_BYTES ( 256 )
+#endif
+
+/**
+ * Most stream segments in flight at once
+ */
+#if !defined( RIPPLE_STREAM_WINDOW )
+#define RIPPLE_STREAM_WINDOW ( 4 )
+#endif
+
+/**
+ * Retransmit timeout (ms) used before any round trip has been measured
+ */
+#if !defined( RIPPLE_STREAM_RTO_INIT )
+#define RIPPLE_STREAM_RTO_INIT ( 250 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+/**
+ * Bounds (ms) of the retransmit timeout derived from the round trip time
+ */
+#if !defined( RIPPLE_STREAM_RTO_MIN )
+#define RIPPLE_STREAM_RTO_MIN ( 50 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+#if !defined( RIPPLE_STREAM_RTO_MAX )
+#define RIPPLE_STREAM_RTO_MAX ( 2000 * Chimera::Thread::TIMEOUT_1MS )
+#endif
+
+/**
+ * Timeouts in a row, without the peer acknowledging anything, before a stream
+ * gives up
+ */
+#if !defined( RIPPLE_STREAM_MAX_RETRIES )
+#define RIPPLE_STREAM_MAX_RETRIES ( 8 )
+#endif
+
+/**
+ * Attribute given to statically placed network stacks, such as
+ * __attribute__( ( section( ".dtcm" ) ) ) to put them in tightly coupled RAM.
+ * Empty leaves them wherever the linker puts .bss.
+ */
+#if !defined( RIPPLE_STATIC_SECTION )
+#define RIPPLE_STATIC_SECTION
+#endif
+
 #endif  /* !RIPPLE_CONFIGURATION_HPP */
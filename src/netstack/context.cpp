@@ -8,6 +8,12 @@
  *  2021 | Brandon Braun | brandonbraun653@gmail.com
  *******************************************************************************/
 
+/* STL Includes */
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
 /* Aurora Includes */
 #include <Aurora/logging>
 
@@ -27,21 +33,70 @@ Literals
 namespace Ripple
 {
   /*-------------------------------------------------------------------------------
-  Constants
+  Static Functions
   -------------------------------------------------------------------------------*/
-  static constexpr size_t UUID_NO_REMOVE = 0xFFFFFFFF;
+  /**
+   *  Builds the address mask for a route prefix
+   *
+   *  @param[in]  prefix      Leading bits that must match, clamped to 32
+   *  @return IPAddress
+   */
+  static constexpr IPAddress prefixMask( const uint8_t prefix )
+  {
+    return ( prefix >= 32 ) ? ~IPAddress( 0 ) : ~( ~IPAddress( 0 ) >> prefix );
+  }
+
+  /**
+   *  Adds a latency sample measured from when an event was raised
+   *
+   *  @param[in]  latency     Latency data to update
+   *  @param[in]  eventTime   When the event was raised (uS)
+   *  @return void
+   */
+  static void recordLatency( LatencyStats &latency, const uint32_t eventTime )
+  {
+    const uint32_t sample = static_cast<uint32_t>( Chimera::micros() ) - eventTime;
+
+    /*-------------------------------------------------
+    Same cheap EMA (alpha = 1/8) the netif uses
+    -------------------------------------------------*/
+    latency.last_us = sample;
+    latency.max_us  = std::max( latency.max_us, sample );
+    latency.avg_us  = latency.avg_us ? ( latency.avg_us - ( latency.avg_us / 8 ) + ( sample / 8 ) ) : sample;
+  }
 
   /*-------------------------------------------------------------------------------
   Context Class
   -------------------------------------------------------------------------------*/
-  Context::Context()
+  Context::Context() :
+      mTXReadyHead( nullptr ), mTXReadyTail( nullptr ), mTXBlocked( false ), mEvents( CTX_EVT_NONE ), mRXEventTime( 0 ),
+      mTXEventTime( 0 )
+  {
+    memset( mPortIndex, 0, sizeof( mPortIndex ) );
+    memset( &mStats, 0, sizeof( mStats ) );
+    mProfile.setBudget( RIPPLE_CTX_LOOP_BUDGET_US );
+  }
+
+
+  Context::Context( Aurora::Memory::Heap &&heap ) : Context( std::move( heap ), nullptr, 0 )
   {
   }
 
 
-  Context::Context( Aurora::Memory::Heap &&heap ) : mHeap( std::move( heap ) )
+  Context::Context( Aurora::Memory::Heap &&heap, void *const poolMemory, const size_t poolSize ) :
+      mHeap( std::move( heap ) ), mTXReadyHead( nullptr ), mTXReadyTail( nullptr ), mTXBlocked( false ),
+      mEvents( CTX_EVT_NONE ), mRXEventTime( 0 ), mTXEventTime( 0 )
   {
     mSocketList.clear();
+    memset( mPortIndex, 0, sizeof( mPortIndex ) );
+    memset( &mStats, 0, sizeof( mStats ) );
+    mProfile.setBudget( RIPPLE_CTX_LOOP_BUDGET_US );
+
+    const bool pooled = poolMemory ? mHeap.initPools( poolMemory, poolSize ) : mHeap.initPools();
+    if ( !pooled )
+    {
+      LOG_ERROR( "Some block pools are empty, their allocations will come from the heap\r\n" );
+    }
   }
 
 
@@ -53,6 +108,7 @@ namespace Ripple
   void Context::setIPAddress( const IPAddress address )
   {
     mIP = address;
+    seedPacketUUID( static_cast<uint32_t>( address ) );
   }
 
 
@@ -67,7 +123,7 @@ namespace Ripple
     /*-------------------------------------------------
     Input Protection
     -------------------------------------------------*/
-    if ( ( cacheSize < sizeof( Socket ) ) || ( ( cacheSize % sizeof( size_t ) ) != 0 ) )
+    if ( ( cacheSize <= SOCKET_OBJECT_BYTES ) || ( ( cacheSize % sizeof( size_t ) ) != 0 ) )
     {
       LOG_DEBUG_IF( DEBUG_MODULE, "Cache size of %d is too small for socket of size %d!\r\n", cacheSize, sizeof( Socket ) );
       return nullptr;
@@ -84,414 +140,1199 @@ namespace Ripple
     }
 
     /*-------------------------------------------------
-    Construct the socket
+    Construct the socket at the front of its cache. The
+    rest becomes the arena it builds its packets in.
     -------------------------------------------------*/
-    Socket_rPtr sock = new ( this->malloc( sizeof( Socket ) ) ) Socket( this, type, cacheSize );
-    RT_HARD_ASSERT( sock );
+    uint8_t *cache = reinterpret_cast<uint8_t *>( this->malloc( cacheSize, ALLOC_SOCKET ) );
+    if ( !cache )
+    {
+      return nullptr;
+    }
+
+    Socket_rPtr sock = unsafe_placeSocket( type, cache, cacheSize );
+    if ( !sock )
+    {
+      this->free( cache );
+    }
+
+    return sock;
+  }
+
 
+  Socket_rPtr Context::socket( const SocketType type, void *const cache, const size_t cacheSize )
+  {
     /*-------------------------------------------------
-    Register socket with context manager
+    Input Protection
     -------------------------------------------------*/
-    mSocketList.push_back( sock );
-    mSocketList.sort( Socket::compare );
+    if ( !cache || ( reinterpret_cast<uintptr_t>( cache ) % alignof( std::max_align_t ) ) ||
+         ( cacheSize <= SOCKET_OBJECT_BYTES ) || ( ( cacheSize % sizeof( size_t ) ) != 0 ) )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Cache of %d bytes can't hold a socket of size %d!\r\n", cacheSize, sizeof( Socket ) );
+      return nullptr;
+    }
 
-    return sock;
+    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+    if ( mSocketList.full() )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Socket limit reached!\r\n" );
+      return nullptr;
+    }
+
+    return unsafe_placeSocket( type, reinterpret_cast<uint8_t *>( cache ), cacheSize );
   }
 
 
-  void Context::attachNetif( NetIf::INetIf *const netif )
+  bool Context::attachNetif( NetIf::INetIf *const netif )
   {
     /*-------------------------------------------------
     Ensure the interface actually exists
     -------------------------------------------------*/
     RT_HARD_ASSERT( netif );
-    mNetIf = netif;
+    {
+      Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _routeLock( mRouteLock );
+      if ( std::find( mNetIfs.begin(), mNetIfs.end(), netif ) != mNetIfs.end() )
+      {
+        return true;
+      }
+
+      if ( mNetIfs.full() )
+      {
+        LOG_ERROR( "Netif limit of %d reached\r\n", mNetIfs.capacity() );
+        return false;
+      }
+
+      mNetIfs.push_back( netif );
+    }
 
     /*-------------------------------------------------
     Register callbacks with the interface
     -------------------------------------------------*/
-    mNetIf->registerCallback( NetIf::CallbackId::CB_ERROR_ARP_LIMIT,
+    netif->registerCallback( NetIf::CallbackId::CB_ERROR_ARP_LIMIT,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_OnARPStorageLimit>( *this ) );
 
-    mNetIf->registerCallback( NetIf::CallbackId::CB_ERROR_ARP_RESOLVE,
+    netif->registerCallback( NetIf::CallbackId::CB_ERROR_ARP_RESOLVE,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_OnARPResolveError>( *this ) );
 
-    mNetIf->registerCallback( NetIf::CallbackId::CB_ERROR_RX_QUEUE_FULL,
+    netif->registerCallback( NetIf::CallbackId::CB_ERROR_RX_QUEUE_FULL,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_OnRXQueueFull>( *this ) );
 
-    mNetIf->registerCallback( NetIf::CallbackId::CB_ERROR_TX_QUEUE_FULL,
+    netif->registerCallback( NetIf::CallbackId::CB_ERROR_TX_QUEUE_FULL,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_OnTXQueueFull>( *this ) );
 
-    mNetIf->registerCallback( NetIf::CallbackId::CB_ERROR_TX_FAILURE,
+    netif->registerCallback( NetIf::CallbackId::CB_ERROR_TX_FAILURE,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_OnFragmentTXFail>( *this ) );
 
-    mNetIf->registerCallback( NetIf::CallbackId::CB_RX_SUCCESS,
+    netif->registerCallback( NetIf::CallbackId::CB_RX_SUCCESS,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_OnFragmentRX>( *this ) );
 
-    mNetIf->registerCallback( NetIf::CallbackId::CB_TX_SUCCESS,
+    netif->registerCallback( NetIf::CallbackId::CB_TX_SUCCESS,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_OnFragmentTX>( *this ) );
 
-    mNetIf->registerCallback( NetIf::CallbackId::CB_UNHANDLED,
+    netif->registerCallback( NetIf::CallbackId::CB_UNHANDLED,
                               etl::delegate<void( size_t )>::create<Context, &Context::cb_Unhandled>( *this ) );
+
+    return true;
   }
 
 
-  void *Context::malloc( const size_t size )
+  bool Context::addRoute( const IPAddress network, const uint8_t prefix, NetIf::INetIf *const netif, const IPAddress nextHop )
   {
-    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
-    void *mem = mHeap.malloc( size );
+    Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _routeLock( mRouteLock );
 
-    if ( !mem )
+    if ( !netif || ( std::find( mNetIfs.begin(), mNetIfs.end(), netif ) == mNetIfs.end() ) )
     {
-      mCBService_registry.call<CallbackId::CB_OUT_OF_MEMORY>();
+      return false;
     }
 
-    return mem;
-  }
+    Route entry;
+    entry.mask    = prefixMask( prefix );
+    entry.network = network & entry.mask;
+    entry.nextHop = nextHop;
+    entry.netif   = netif;
 
+    /*-------------------------------------------------
+    Replace a route to the same network in place
+    -------------------------------------------------*/
+    for ( Route &route : mRoutes )
+    {
+      if ( ( route.network == entry.network ) && ( route.mask == entry.mask ) )
+      {
+        route = entry;
+        return true;
+      }
+    }
 
-  void Context::free( void *pv )
-  {
-    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
-    mHeap.free( pv );
-  }
+    if ( mRoutes.full() )
+    {
+      return false;
+    }
 
+    /*-------------------------------------------------
+    Keep longer prefixes first, so the first match in a
+    lookup is the most specific one
+    -------------------------------------------------*/
+    auto pos = std::find_if( mRoutes.begin(), mRoutes.end(), [ &entry ]( const Route &route ) {
+      return route.mask < entry.mask;
+    } );
 
-  size_t Context::availableMemory() const
-  {
-    return mHeap.available();
+    mRoutes.insert( pos, entry );
+    return true;
   }
 
 
-  void Context::printStats()
+  void Context::removeRoute( const IPAddress network, const uint8_t prefix )
   {
-    /*-------------------------------------------------------------------------
-    Grab the latest stats
-    -------------------------------------------------------------------------*/
-    NetIf::PerfStats stats;
-    mNetIf->getStats( stats );
+    Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _routeLock( mRouteLock );
 
-    /*-------------------------------------------------------------------------
-    Format a string for printing to the console
-    -------------------------------------------------------------------------*/
-    char buf[ 512 ];
-    memset( buf, 0, ARRAY_BYTES( buf ) );
-
-    snprintf( buf, ARRAY_BYTES( buf ),
-      "\r\n\tRX:\tbytes\tframes\tspeed\tdropped\tlost"
-      "\r\n\t\t%ld\t%ld\t%ld\t%ld\t%ld"
-      "\r\n\tTX:\tbytes\tframes\tspeed\tdropped\tlost"
-      "\r\n\t\t%ld\t%ld\t%ld\t%ld\t%ld"
-      "\r\n"
-      ,
-      stats.rx_bytes, stats.frame_rx, stats.link_speed_rx, stats.frame_rx_drop, stats.rx_bytes_lost,
-      stats.tx_bytes, stats.frame_tx, stats.link_speed_tx, stats.frame_tx_drop, stats.tx_bytes_lost );
-
-    LOG_INFO( buf );
+    const IPAddress mask = prefixMask( prefix );
+    for ( auto route = mRoutes.begin(); route != mRoutes.end(); route++ )
+    {
+      if ( ( route->network == ( network & mask ) ) && ( route->mask == mask ) )
+      {
+        mRoutes.erase( route );
+        return;
+      }
+    }
   }
 
 
-  void Context::ManagerThread( void *arg )
+  RouteResult Context::route( const IPAddress destination )
   {
-    using namespace Aurora::Logging;
-    using namespace Chimera::Thread;
-
-    /*-------------------------------------------------------------------------
-    Wait for this thread to be told to initialize
-    -------------------------------------------------------------------------*/
-    Ripple::TaskWaitInit();
-    this_thread::set_name( "NetMgr" );
-    LOG_DEBUG_IF( DEBUG_MODULE, "Starting Ripple Net Manager\r\n" );
+    RouteResult result = { nullptr, destination, false };
 
-    /*-------------------------------------------------------------------------
-    Initialize the fragment assembly workspace
-    -------------------------------------------------------------------------*/
-    for ( auto &assemblyItem : mPacketAssembly )
+    /*-------------------------------------------------
+    Traffic to this node never touches an interface
+    -------------------------------------------------*/
+    if ( ( destination == LOCAL_HOST_IP ) || ( destination == mIP ) )
     {
-      assemblyItem.second.inProgress = false;
+      result.local = true;
+      return result;
     }
 
-    /*-------------------------------------------------------------------------
-    Perform the core processing loop
-    -------------------------------------------------------------------------*/
-    while ( true )
+    Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _routeLock( mRouteLock );
+
+    for ( const Route &route : mRoutes )
     {
-      processRX();
-      processTX();
-      this_thread::sleep_for( 10 );
+      if ( ( destination & route.mask ) == route.network )
+      {
+        result.netif   = route.netif;
+        result.address = route.nextHop ? route.nextHop : destination;
+        return result;
+      }
     }
-  }
 
-
-  void Context::processRX()
-  {
-    /*-----------------------------------------------------------------
-    Input Protections
-    -----------------------------------------------------------------*/
-    if ( !mNetIf )
+    if ( !mNetIfs.empty() )
     {
-      return;
+      result.netif = mNetIfs.front();
     }
 
-    /*-----------------------------------------------------------------
-    Process in-progress RX'd fragments first, then pull any waiting
-    fragments from the network interface driver.
-    -----------------------------------------------------------------*/
-    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
-    unsafe_processRXFrags();
-    unsafe_pumpRXFrags();
+    return result;
+  }
 
-    /*-----------------------------------------------------------------
-    Process all socket periodic functionality
-    -----------------------------------------------------------------*/
-    for ( auto sock = mSocketList.begin(); sock != mSocketList.end(); sock++ )
-    {
-      ( *sock )->processData();
-    }
+
+  size_t Context::snapshotNetifs( NetIf::INetIf **const netifs )
+  {
+    Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _routeLock( mRouteLock );
+    std::copy( mNetIfs.begin(), mNetIfs.end(), netifs );
+    return mNetIfs.size();
   }
 
 
-  void Context::processTX()
+  void *Context::malloc( const size_t size, const AllocSite site )
   {
-    /*-------------------------------------------------------------------------
-    Input Protections
-    -------------------------------------------------------------------------*/
-    if ( !mNetIf )
+    void *mem = nullptr;
     {
-      return;
+      Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> _heapLock( mHeap );
+      AllocSiteScope _site( mHeap, site );
+      mem = mHeap.malloc( size );
     }
 
-    /*-------------------------------------------------------------------------
-    Check each registered socket for available TX data
-    -------------------------------------------------------------------------*/
-    for ( auto sock = mSocketList.begin(); sock != mSocketList.end(); sock++ )
+    if ( !mem )
     {
-      Chimera::Thread::LockGuard<Socket> _sckLock( *( *sock ) );
-
-      /*-----------------------------------------------------------------------
-      Grab the next fragment list to transmit until no more exist
-      -----------------------------------------------------------------------*/
-      while( !( *sock )->mTXQueue.empty() )
-      {
-        Packet_sPtr msg;
-        ( *sock )->mTXQueue.pop_into( msg );
-
-        /*---------------------------------------------------------------------
-        Move the data into the network interface driver
-        ---------------------------------------------------------------------*/
-        auto sts = mNetIf->send( msg->head, ( *sock )->mDestAddress );
-        if ( ( sts != Chimera::Status::OK ) && ( sts != Chimera::Status::READY ) )
-        {
-          LOG_DEBUG_IF( DEBUG_MODULE, "Failed TX to netif\r\n" );
-        }
-      }
+      mCBService_registry.call<CallbackId::CB_OUT_OF_MEMORY>();
     }
-  }
-
 
-  void Context::cb_Unhandled( size_t callbackID )
-  {
-    LOG_ERROR( "NetIf unhandled callback id: %d\r\n", callbackID );
+    return mem;
   }
 
 
-  void Context::cb_OnFragmentTX( size_t callbackID )
+  void Context::free( void *pv )
   {
+    Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> _heapLock( mHeap );
+    mHeap.free( pv );
   }
 
 
-  void Context::cb_OnFragmentRX( size_t callbackID )
+  size_t Context::availableMemory() const
   {
+    return mHeap.available();
   }
 
 
-  void Context::cb_OnFragmentTXFail( size_t callbackID )
+  void Context::getHeapStats( HeapStats &stats )
   {
+    mHeap.getHeapStats( stats );
   }
 
 
-  void Context::cb_OnRXQueueFull( size_t callbackID )
+  bool Context::networkTime( uint64_t &now_us )
   {
+    Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _routeLock( mRouteLock );
+    for ( NetIf::INetIf *netif : mNetIfs )
+    {
+      if ( netif->networkTime( now_us ) )
+      {
+        return true;
+      }
+    }
+
+    return false;
   }
 
 
-  void Context::cb_OnTXQueueFull( size_t callbackID )
+  void Context::getStats( ContextStats &stats )
   {
+    {
+      Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+      stats = mStats;
+    }
+
+    mProfile.getLoad( stats.load );
   }
 
 
-  void Context::cb_OnARPResolveError( size_t callbackID )
+  void Context::getLatencyStats( LatencyReport &report )
   {
+    /*-------------------------------------------------------------------------
+    The context owns the socket and assembly stages, the netifs own the link
+    stages. Every report leaves the others' stages empty, so they just add up.
+    -------------------------------------------------------------------------*/
+    mLatency.snapshot( report );
+
+    NetIf::INetIf *netifs[ RIPPLE_CTX_MAX_NETIF ];
+    const size_t numNetifs = snapshotNetifs( netifs );
+    for ( size_t idx = 0; idx < numNetifs; idx++ )
+    {
+      LatencyReport netifReport;
+      netifs[ idx ]->getLatencyStats( netifReport );
+      report.merge( netifReport );
+    }
   }
 
 
-  void Context::cb_OnARPStorageLimit( size_t callbackID )
+  void Context::printStats()
   {
-  }
+    char buf[ 1024 ];
 
+    /*-------------------------------------------------------------------------
+    Link figures, one block per attached netif
+    -------------------------------------------------------------------------*/
+    NetIf::INetIf *netifs[ RIPPLE_CTX_MAX_NETIF ];
+    const size_t numNetifs = snapshotNetifs( netifs );
+
+    for ( size_t idx = 0; idx < numNetifs; idx++ )
+    {
+      NetIf::PerfStats stats;
+      memset( &stats, 0, sizeof( stats ) );
+      netifs[ idx ]->getStats( stats );
+
+      memset( buf, 0, ARRAY_BYTES( buf ) );
+      snprintf( buf, ARRAY_BYTES( buf ),
+        "\r\n\tNetif %d:"
+        "\r\n\tRX:\tbytes\tframes\tspeed\tdropped\tlost"
+        "\r\n\t\t%ld\t%ld\t%ld\t%ld\t%ld"
+        "\r\n\tTX:\tbytes\tframes\tspeed\tdropped\tlost"
+        "\r\n\t\t%ld\t%ld\t%ld\t%ld\t%ld"
+        "\r\n\tLatency (uS):\tlast\tavg\tmax\tctrl max"
+        "\r\n\t\t%ld\t%ld\t%ld\t%ld"
+        "\r\n\tChannel:\tcurrent\thops"
+        "\r\n\t\t%ld\t%ld"
+        "\r\n\tForward:\tframes\tdropped"
+        "\r\n\t\t%ld\t%ld"
+        "\r\n\tLiveness:\tprobes\tlost"
+        "\r\n\t\t%ld\t%ld"
+        "\r\n"
+        ,
+        idx,
+        stats.rx_bytes, stats.frame_rx, stats.link_speed_rx, stats.frame_rx_drop, stats.rx_bytes_lost,
+        stats.tx_bytes, stats.frame_tx, stats.link_speed_tx, stats.frame_tx_drop, stats.tx_bytes_lost,
+        stats.tx_latency_last_us, stats.tx_latency_avg_us, stats.tx_latency_max_us, stats.tx_control_latency_max_us,
+        stats.rf_channel, stats.channel_hops,
+        stats.frame_fwd, stats.frame_fwd_drop,
+        stats.keepalive_tx, stats.peers_lost );
+
+      LOG_INFO( buf );
+    }
 
-  /**
-   * @brief Removes dead packets from the assembly area
-   */
-  void Context::unsafe_pruneRXFrags()
-  {
     /*-------------------------------------------------------------------------
-    Local Variables
+    Context wide figures
     -------------------------------------------------------------------------*/
-    std::array<uint32_t, RIPPLE_CTX_MAX_PKT> uuidToRemove;
-    uint8_t removeIdx = 0;
+    ContextStats ctxStats;
+    getStats( ctxStats );
+
+    HeapStats heap;
+    getHeapStats( heap );
+    const PoolStats *const pools = heap.pool;
 
     /*-------------------------------------------------------------------------
-    Find all packets that are expired, whether explicitly or via timeout.
+    Format a string for printing to the console
     -------------------------------------------------------------------------*/
-    uuidToRemove.fill( UUID_NO_REMOVE );
-    for ( auto &assemblyItem : mPacketAssembly )
-    {
-      PacketAssembly *const assembly = &assemblyItem.second;
-      const uint32_t uuid            = assemblyItem.first;
-      const uint32_t lifetime        = assembly->lastTimeoutCheck - assembly->startRxTime;
+    memset( buf, 0, ARRAY_BYTES( buf ) );
 
-      if ( lifetime >= assembly->timeout )
-      {
-        assembly->remove    = true;
-        assembly->whyRemove = PacketAssembly::RemoveErr::TIMEOUT;
-      }
+    snprintf( buf, ARRAY_BYTES( buf ),
+      "\r\n\tPool peak:\tpayload\tfrag\tpacket\tmisses"
+      "\r\n\t\t%d/%d\t%d/%d\t%d/%d\t%d"
+      "\r\n\tHeap:\t\tfree\tpeak\tlargest\tfrag %%\tfailed"
+      "\r\n\t\t%d/%d\t%d\t%d\t%d\t%d"
+      "\r\n\tAllocs:\t\tfrag\tpacket\tscratch\tsocket\tother"
+      "\r\n\t\t%d\t%d\t%d\t%d\t%d"
+      "\r\n\tStack (uS):\trx last\trx avg\trx max\ttx last\ttx avg\ttx max\twakeups"
+      "\r\n\t\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld"
+      "\r\n"
+      ,
+      pools[ POOL_PAYLOAD ].highWater, pools[ POOL_PAYLOAD ].blocks,
+      pools[ POOL_FRAGMENT ].highWater, pools[ POOL_FRAGMENT ].blocks,
+      pools[ POOL_PACKET ].highWater, pools[ POOL_PACKET ].blocks,
+      pools[ POOL_PAYLOAD ].misses + pools[ POOL_FRAGMENT ].misses + pools[ POOL_PACKET ].misses,
+      heap.free, heap.capacity, heap.capacity - heap.lowWater, heap.largestFree, heap.fragmentation, heap.failures,
+      heap.site[ ALLOC_FRAGMENT ].allocs, heap.site[ ALLOC_PACKET ].allocs, heap.site[ ALLOC_SCRATCH ].allocs,
+      heap.site[ ALLOC_SOCKET ].allocs, heap.site[ ALLOC_OTHER ].allocs,
+      ctxStats.rx.last_us, ctxStats.rx.avg_us, ctxStats.rx.max_us,
+      ctxStats.tx.last_us, ctxStats.tx.avg_us, ctxStats.tx.max_us, ctxStats.wakeups );
 
-      if ( assembly->remove )
-      {
-        uuidToRemove[ removeIdx ] = uuid;
-        removeIdx++;
-      }
-      else
-      {
-        assembly->lastTimeoutCheck = Chimera::millis();
-      }
-    }
+    LOG_INFO( buf );
 
     /*-------------------------------------------------------------------------
-    Free the memory flagged for removal
+    Per-stage latency, one line each
     -------------------------------------------------------------------------*/
-    for ( size_t idx = 0; idx < removeIdx; idx++ )
-    {
-      auto iter = mPacketAssembly.find( uuidToRemove[ idx ] );
-      if ( iter != mPacketAssembly.end() )
-      {
-        /*---------------------------------------------------------------------
-        Log the reason for removal. Very useful for post mortem debugging.
-        ---------------------------------------------------------------------*/
-        PacketAssembly *const assembly = &iter->second;
-        if( assembly->whyRemove != PacketAssembly::RemoveErr::COMPLETED )
-        {
-          LOG_DEBUG_IF( DEBUG_MODULE, "Abnormal assembly removal of UUID [%d]: %s\r\n", uuidToRemove[ idx ], assembly->whyRemoveString() );
-        }
+    static_assert( LAT_NUM_STAGES == 6, "Update the stage names" );
+    static const char *const stageNames[ LAT_NUM_STAGES ] = { "sock tx", "link queue", "link air",
+                                                               "link rx", "assembly",   "dispatch" };
 
-        mPacketAssembly.erase( iter );
-      }
+    LatencyReport latency;
+    getLatencyStats( latency );
+
+    size_t used = snprintf( buf, ARRAY_BYTES( buf ), "\r\n\tStage (uS):\tp50\tp99\tmax\tsamples" );
+    for ( size_t idx = 0; ( idx < LAT_NUM_STAGES ) && ( used < ARRAY_BYTES( buf ) ); idx++ )
+    {
+      const LatencyHistogram &stage = latency.stage[ idx ];
+      used += snprintf( buf + used, ARRAY_BYTES( buf ) - used, "\r\n\t%s:\t%ld\t%ld\t%ld\t%ld", stageNames[ idx ],
+                        stage.percentile( 50 ), stage.percentile( 99 ), stage.max_us, stage.count );
     }
 
-    LOG_TRACE_IF( ( DEBUG_MODULE && removeIdx ), "Pruned %d packets from assembly\r\n", removeIdx );
+    LOG_INFO( "%s\r\n", buf );
   }
 
 
-  /**
-   * @brief Process packet assembly for completed or malformed packets.
-   *
-   * Acts as a message pump of sorts. Completed fragments are inspected to
-   * determine which destination socket on the network stack the packet will be
-   * assigned to, then pushed in to the appropriate RX queue.
-   */
-  void Context::unsafe_processRXFrags()
+  void Context::ManagerThread( void *arg )
   {
+    using namespace Aurora::Logging;
+    using namespace Chimera::Thread;
+
     /*-------------------------------------------------------------------------
-    Clean the assembly area to prepare for new frags
+    Wait for this thread to be told to initialize
     -------------------------------------------------------------------------*/
-    unsafe_pruneRXFrags();
+    Ripple::TaskWaitInit();
+    this_thread::set_name( "NetMgr" );
+    mTaskId = this_thread::id();
+    LOG_DEBUG_IF( DEBUG_MODULE, "Starting Ripple Net Manager\r\n" );
 
     /*-------------------------------------------------------------------------
-    Iterate over each possible assembly task and update their status. If ready,
-    push to the RX queue of the destination socket.
+    Perform the core processing loop
     -------------------------------------------------------------------------*/
-    for ( auto &assemblyItem : mPacketAssembly )
+    while ( true )
     {
-      PacketAssembly *const assembly = &assemblyItem.second;
-
       /*-----------------------------------------------------------------------
-      Check for a completed packet
+      Sleep until the netif or a socket raises an event, or until the next
+      tracked deadline expires. A wakeup without any flags set came from some
+      external task, so treat it like a timer event.
       -----------------------------------------------------------------------*/
-      if ( !assembly->inProgress || assembly->packet->isMissingFragments() )
+      uint32_t events = mEvents.exchange( CTX_EVT_NONE );
+      if ( !events )
       {
-        continue;
+        this_thread::pendTaskMsg( ITCMsg::TSK_MSG_WAKEUP, nextWakeupDelay() );
+        events = mEvents.exchange( CTX_EVT_NONE );
       }
 
+      if ( !events )
+      {
+        events = CTX_EVT_TIMER;
+      }
+
+      mProfile.beginWork();
+      const uint32_t rxEventTime = mRXEventTime.load();
+      const uint32_t txEventTime = mTXEventTime.load();
+
       /*-----------------------------------------------------------------------
-      All fragments received. Perform basic validity checks on whole packet.
+      Only run the work that is actually pending. Timer events also poll the
+      netif, which catches any RX notification that was missed.
       -----------------------------------------------------------------------*/
-      assembly->inProgress = false;
-      assembly->packet->sort();
+      size_t rxPackets = 0;
+      size_t txPackets = 0;
 
-      if ( !assembly->packet->isFullyComposed() )
+      if ( events & ( CTX_EVT_RX | CTX_EVT_TIMER ) )
       {
-        assembly->remove    = true;
-        assembly->whyRemove = PacketAssembly::RemoveErr::CORRUPTION;
-        continue;
+        rxPackets = processRX();
+      }
+
+      if ( events & ( CTX_EVT_TX | CTX_EVT_TIMER ) )
+      {
+        txPackets = processTX();
       }
 
       /*-----------------------------------------------------------------------
-      Find the socket associated with the packet, then push it to the RX queue
+      Release sent packets that are too old to be asked for again, then log
+      how long the events took to get through.
       -----------------------------------------------------------------------*/
-      void **raw_data = assembly->packet->head->data.get();
-      auto header     = reinterpret_cast<TransportHeader *>( *raw_data );
-
-      for ( auto sock = mSocketList.begin(); /* Check exit below*/; sock++ )
       {
-        /*---------------------------------------------------------------------
-        No socket matched the destination port. Exit the loop here. Note that
-        only sockets which are PULL type can receive data.
-        ---------------------------------------------------------------------*/
-        if ( sock == mSocketList.end() )
+        Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+
+        if ( events & CTX_EVT_TIMER )
         {
-          assembly->remove    = true;
-          assembly->whyRemove = PacketAssembly::RemoveErr::SOCK_NOT_FOUND;
-          break;
+          unsafe_pruneRetained();
         }
 
-        /*---------------------------------------------------------------------
-        Found the destination socket. Right type and right port.
-        ---------------------------------------------------------------------*/
-        if ( ( ( *sock )->type() == SocketType::PULL ) && ( ( *sock )->port() == header->dstPort ) )
+        if ( rxPackets && ( events & CTX_EVT_RX ) )
         {
-          /*-------------------------------------------------------------------
-          Check for enough room in the RX queue
-          -------------------------------------------------------------------*/
-          if ( ( *sock )->mRXQueue.full() )
-          {
-            assembly->remove    = true;
-            assembly->whyRemove = PacketAssembly::RemoveErr::SOCK_Q_FULL;
-            break;
-          }
+          recordLatency( mStats.rx, rxEventTime );
+        }
 
-          /*-------------------------------------------------------------------
-          Push the root fragment into the queue, effectively informing the
-          socket of the entire ordered packet.
-          -------------------------------------------------------------------*/
-          ( *sock )->mRXQueue.push( assembly->packet );
-          assembly->remove    = true;
-          assembly->whyRemove = PacketAssembly::RemoveErr::COMPLETED;
-          break;
+        if ( txPackets && ( events & CTX_EVT_TX ) )
+        {
+          recordLatency( mStats.tx, txEventTime );
         }
-      }
-    }
-  }
 
+        mStats.wakeups++;
+      }
 
-  /**
+      /*-----------------------------------------------------------------------
+      Let a listener know the pass took longer than this thread is allowed,
+      outside the lock so the handler can use the context.
+      -----------------------------------------------------------------------*/
+      if ( mProfile.endWork() )
+      {
+        mCBService_registry.call<CallbackId::CB_SERVICE_OVERRUN>();
+      }
+    }
+  }
+
+
+  size_t Context::processRX()
+  {
+    NetIf::INetIf *netifs[ RIPPLE_CTX_MAX_NETIF ];
+    const size_t numNetifs = snapshotNetifs( netifs );
+
+    /*-----------------------------------------------------------------
+    Pull any waiting fragments from every network interface, then
+    hand off whatever packets they completed in the same pass. Only
+    routing needs the socket registry, so the context lock is held
+    just for that.
+    -----------------------------------------------------------------*/
+    etl::vector<Socket *, RIPPLE_CTX_MAX_SOCKETS> rxSockets;
+    size_t delivered = 0;
+    {
+      Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _rxLock( mRXLock );
+      unsafe_expireRXFrags();
+      for ( size_t idx = 0; idx < numNetifs; idx++ )
+      {
+        unsafe_pumpRXFrags( netifs[ idx ] );
+      }
+
+      {
+        Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+        delivered = unsafe_processRXFrags();
+        rxSockets = mRXSockets;
+        mRXSockets.clear();
+      }
+
+      unsafe_requestMissingFrags();
+    }
+
+    /*-----------------------------------------------------------------
+    Let the sockets that were just handed packets process them. No
+    stack lock is held, so slow handlers only delay their own socket.
+    -----------------------------------------------------------------*/
+    for ( Socket *const sock : rxSockets )
+    {
+      sock->processData();
+    }
+
+    return delivered;
+  }
+
+
+  size_t Context::processTX()
+  {
+    size_t sent = 0;
+
+    /*-------------------------------------------------------------------------
+    Take the sockets that have queued packets. Any that write again after this
+    simply rejoin the list for the next pass.
+    -------------------------------------------------------------------------*/
+    etl::vector<Socket *, RIPPLE_CTX_MAX_SOCKETS> ready;
+    {
+      Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+
+      for ( Socket *sock = mTXReadyHead; sock; sock = sock->mTXNext )
+      {
+        ready.push_back( sock );
+        sock->mTXPending = false;
+      }
+
+      mTXReadyHead = nullptr;
+      mTXReadyTail = nullptr;
+    }
+
+    /*-------------------------------------------------------------------------
+    Drain each of them into the network interface. A packet the netif is too
+    full to take stays at the front of its queue, and the socket goes back on
+    the list to retry. So do sockets still gathering small packets, until
+    their deadline.
+    -------------------------------------------------------------------------*/
+    struct Deferred
+    {
+      Socket *sock;
+      size_t delay;
+    };
+
+    struct Completion
+    {
+      TXCallback callback;
+      Chimera::Status_t status;
+    };
+
+    struct Retain
+    {
+      Packet_sPtr packet;
+      IPAddress destination;
+      NetIf::TrafficClass trafficClass;
+    };
+
+    etl::vector<Deferred, RIPPLE_CTX_MAX_SOCKETS> deferred;
+    bool blocked = false;
+
+    for ( Socket *const sock : ready )
+    {
+      etl::vector<Completion, RIPPLE_SOCK_TX_QUEUE_DEPTH> done;
+      etl::vector<Retain, RIPPLE_SOCK_TX_QUEUE_DEPTH> retain;
+      etl::vector<Packet_sPtr, RIPPLE_SOCK_TX_QUEUE_DEPTH> local;
+      {
+        Chimera::Thread::LockGuard<Socket> _sckLock( *sock );
+
+        if ( sock->mCoalesceSize && !sock->unsafe_coalesceDelay() )
+        {
+          sock->unsafe_flush();
+        }
+
+        /*-----------------------------------------------------------------------
+        Streams queue new segments, retransmits and ACKs as their window and
+        timers allow
+        -----------------------------------------------------------------------*/
+        size_t delay = STREAM_IDLE;
+        if ( sock->mStream )
+        {
+          StreamWriter writer = StreamWriter::create<Socket, &Socket::unsafe_writeSegment>( *sock );
+          delay               = sock->mStream->service( Chimera::millis(), writer );
+        }
+
+        bool sockBlocked       = false;
+        const RouteResult path = route( sock->mDestAddress );
+
+        while ( !sock->mTXQueue.empty() )
+        {
+          const TXRequest &request = sock->mTXQueue.front();
+
+          /*---------------------------------------------------------------------
+          Move the data into the network interface driver. Packets for this
+          node skip the interfaces and go straight to the receiving socket.
+          ---------------------------------------------------------------------*/
+          Chimera::Status_t sts = Chimera::Status::FAIL;
+          if ( path.local )
+          {
+            local.push_back( request.packet );
+            sts = Chimera::Status::OK;
+          }
+          else if ( path.netif )
+          {
+            sts = path.netif->send( request.packet->head, path.address, sock->mConfig.trafficClass );
+          }
+
+          if ( sts == Chimera::Status::FULL )
+          {
+            sockBlocked = true;
+            break;
+          }
+
+          if ( ( sts == Chimera::Status::OK ) || ( sts == Chimera::Status::READY ) )
+          {
+            sts = Chimera::Status::OK;
+            sent++;
+            if ( !path.local )
+            {
+              mLatency.recordSince( LAT_SOCKET_TX, request.packet->timestamp_us );
+              if ( request.packet->numFragments() > 1 )
+              {
+                retain.push_back( { request.packet, sock->mDestAddress, sock->mConfig.trafficClass } );
+              }
+            }
+          }
+          else
+          {
+            LOG_DEBUG_IF( DEBUG_MODULE, "Failed TX to netif\r\n" );
+          }
+
+          if ( request.callback.is_valid() )
+          {
+            done.push_back( { request.callback, sts } );
+          }
+
+          RIPPLE_TRACE( TRC_SOCK_TX_DEQUEUE, sock->mThisPort, sts );
+          sock->mTXQueue.pop();
+        }
+
+        if ( sock->mCoalesceSize )
+        {
+          delay = std::min( delay, sock->unsafe_coalesceDelay() );
+        }
+
+        if ( sockBlocked )
+        {
+          blocked = true;
+          delay   = RIPPLE_CTX_TX_RETRY_DELAY;
+        }
+
+        if ( delay != STREAM_IDLE )
+        {
+          deferred.push_back( { sock, delay } );
+        }
+      }
+
+      /*-----------------------------------------------------------------------
+      Keep fragmented packets for resend requests, then let writers know how
+      their packets went. The socket is unlocked first so the context lock is
+      never taken under it, and writers are free to write again.
+      -----------------------------------------------------------------------*/
+      for ( const Retain &entry : retain )
+      {
+        retainPacket( entry.packet, entry.destination, entry.trafficClass );
+      }
+
+      for ( const Packet_sPtr &packet : local )
+      {
+        deliverLocal( packet );
+      }
+
+      for ( const Completion &entry : done )
+      {
+        entry.callback( entry.status );
+      }
+    }
+
+    /*-------------------------------------------------------------------------
+    Requeue the sockets with work left. A netif that sends a frame frees up
+    room, so let that trigger the retry early.
+    -------------------------------------------------------------------------*/
+    if ( blocked )
+    {
+      mTXBlocked = true;
+    }
+
+    for ( const Deferred &entry : deferred )
+    {
+      markTXReady( entry.sock, entry.delay );
+    }
+
+    return sent;
+  }
+
+
+  bool Context::bindPort( Socket *const socket )
+  {
+    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+
+    size_t bucket = hashIndex16( socket->port(), PORT_INDEX_BITS );
+    while ( mPortIndex[ bucket ] )
+    {
+      if ( mPortIndex[ bucket ]->port() == socket->port() )
+      {
+        return mPortIndex[ bucket ] == socket;
+      }
+
+      bucket = ( bucket + 1u ) & PORT_INDEX_MASK;
+    }
+
+    mPortIndex[ bucket ] = socket;
+    return true;
+  }
+
+
+  void Context::unbindPort( Socket *const socket )
+  {
+    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+
+    /*-------------------------------------------------------------------------
+    Find the socket. It may never have been bound at all.
+    -------------------------------------------------------------------------*/
+    size_t hole = hashIndex16( socket->port(), PORT_INDEX_BITS );
+    while ( mPortIndex[ hole ] != socket )
+    {
+      if ( !mPortIndex[ hole ] )
+      {
+        return;
+      }
+
+      hole = ( hole + 1u ) & PORT_INDEX_MASK;
+    }
+
+    /*-------------------------------------------------------------------------
+    Shift later entries of the probe chain back over the hole
+    -------------------------------------------------------------------------*/
+    for ( size_t next = ( hole + 1u ) & PORT_INDEX_MASK; mPortIndex[ next ]; next = ( next + 1u ) & PORT_INDEX_MASK )
+    {
+      const size_t ideal = hashIndex16( mPortIndex[ next ]->port(), PORT_INDEX_BITS );
+      if ( ( ( next - ideal ) & PORT_INDEX_MASK ) >= ( ( next - hole ) & PORT_INDEX_MASK ) )
+      {
+        mPortIndex[ hole ] = mPortIndex[ next ];
+        hole               = next;
+      }
+    }
+
+    mPortIndex[ hole ] = nullptr;
+  }
+
+
+  void Context::markTXReady( Socket *const socket, const size_t delay )
+  {
+    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+
+    /*-------------------------------------------------------------------------
+    A socket already on the list keeps whichever visit is due first
+    -------------------------------------------------------------------------*/
+    const size_t due = Chimera::millis() + delay;
+
+    if ( socket->mTXPending )
+    {
+      if ( static_cast<std::make_signed_t<size_t>>( due - socket->mTXDueTime ) < 0 )
+      {
+        socket->mTXDueTime = due;
+      }
+
+      return;
+    }
+
+    socket->mTXPending = true;
+    socket->mTXNext    = nullptr;
+    socket->mTXDueTime = due;
+
+    if ( mTXReadyTail )
+    {
+      mTXReadyTail->mTXNext = socket;
+    }
+    else
+    {
+      mTXReadyHead = socket;
+    }
+
+    mTXReadyTail = socket;
+  }
+
+
+  void Context::signalEvent( const uint32_t event )
+  {
+    using namespace Chimera::Thread;
+
+    /*-------------------------------------------------------------------------
+    Stamp the event before raising it, so the manager never sees a flag
+    without its time. A flag already pending keeps its original stamp.
+    -------------------------------------------------------------------------*/
+    const uint32_t now = static_cast<uint32_t>( Chimera::micros() );
+    if ( !( mEvents.load() & event ) )
+    {
+      if ( event & CTX_EVT_RX )
+      {
+        mRXEventTime.store( now );
+      }
+
+      if ( event & CTX_EVT_TX )
+      {
+        mTXEventTime.store( now );
+      }
+    }
+
+    /*-------------------------------------------------------------------------
+    Only the first event raised since the thread last ran needs to wake it
+    -------------------------------------------------------------------------*/
+    const uint32_t previous = mEvents.fetch_or( event );
+    if ( !previous )
+    {
+      sendTaskMsg( mTaskId, ITCMsg::TSK_MSG_WAKEUP, TIMEOUT_DONT_WAIT );
+    }
+  }
+
+
+  size_t Context::nextWakeupDelay()
+  {
+    Chimera::Thread::LockGuard<Chimera::Thread::RecursiveTimedMutex> _rxLock( mRXLock );
+    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+
+    /*-------------------------------------------------------------------------
+    Local helper to get the time left until a deadline, in ms
+    -------------------------------------------------------------------------*/
+    const size_t now = Chimera::millis();
+    auto remaining   = [ now ]( const size_t start, const size_t timeout ) -> size_t {
+      const size_t elapsed = now - start;
+      return ( elapsed < timeout ) ? ( timeout - elapsed ) : 0;
+    };
+
+    size_t delay = RIPPLE_CTX_IDLE_PERIOD;
+
+    /*-------------------------------------------------------------------------
+    Assemblies time out, the earliest being on top of the table. Stalled ones
+    ask for a resend.
+    -------------------------------------------------------------------------*/
+    if ( const PacketAssembly *const earliest = mPacketAssembly.earliest() )
+    {
+      delay = std::min( delay, remaining( earliest->startRxTime, earliest->timeout ) );
+    }
+
+    for ( size_t idx = 0; idx < mPacketAssembly.size(); idx++ )
+    {
+      const PacketAssembly *const assembly = mPacketAssembly.active( idx );
+      if ( assembly->inProgress && ( assembly->nackCount < RIPPLE_NACK_RETRIES ) )
+      {
+        delay = std::min<size_t>( delay, remaining( assembly->lastRxTime, RIPPLE_NACK_DELAY ) );
+      }
+    }
+
+    /*-------------------------------------------------------------------------
+    Retained packets are released. The oldest is always at the front.
+    -------------------------------------------------------------------------*/
+    if ( !mRetained.empty() )
+    {
+      delay = std::min<size_t>( delay, remaining( mRetained.front().sentTime, RIPPLE_PKT_RETENTION ) );
+    }
+
+    /*-------------------------------------------------------------------------
+    Sockets gathering small packets have to send them by their deadline
+    -------------------------------------------------------------------------*/
+    for ( const Socket *sock = mTXReadyHead; sock; sock = sock->mTXNext )
+    {
+      const size_t due = sock->mTXDueTime;
+      delay = std::min<size_t>( delay, ( static_cast<std::make_signed_t<size_t>>( due - now ) > 0 ) ? ( due - now ) : 0 );
+    }
+
+    return delay;
+  }
+
+
+  void Context::retainPacket( const Packet_sPtr &packet, const IPAddress destination, const NetIf::TrafficClass tc )
+  {
+    Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+
+    /*-------------------------------------------------------------------------
+    Make room by letting go of the oldest packet
+    -------------------------------------------------------------------------*/
+    if ( mRetained.full() )
+    {
+      mRetained.pop_front();
+    }
+
+    RetainedPacket entry;
+    entry.packet       = packet;
+    entry.destination  = destination;
+    entry.trafficClass = tc;
+    entry.sentTime     = Chimera::millis();
+
+    mRetained.push_back( entry );
+  }
+
+
+  void Context::cb_Unhandled( size_t callbackID )
+  {
+    LOG_ERROR( "NetIf unhandled callback id: %d\r\n", callbackID );
+  }
+
+
+  void Context::cb_OnFragmentTX( size_t callbackID )
+  {
+    /*-------------------------------------------------------------------------
+    A frame left the netif, so a socket stuck on a full queue can try again
+    -------------------------------------------------------------------------*/
+    if ( mTXBlocked.exchange( false ) )
+    {
+      signalEvent( CTX_EVT_TX );
+    }
+  }
+
+
+  void Context::cb_OnFragmentRX( size_t callbackID )
+  {
+    signalEvent( CTX_EVT_RX );
+  }
+
+
+  void Context::cb_OnFragmentTXFail( size_t callbackID )
+  {
+  }
+
+
+  void Context::cb_OnRXQueueFull( size_t callbackID )
+  {
+  }
+
+
+  void Context::cb_OnTXQueueFull( size_t callbackID )
+  {
+  }
+
+
+  void Context::cb_OnARPResolveError( size_t callbackID )
+  {
+  }
+
+
+  void Context::cb_OnARPStorageLimit( size_t callbackID )
+  {
+  }
+
+
+  /**
+   * @brief Drops assemblies that ran out of time to finish
+   *
+   * Assemblies are ordered by deadline, so this stops at the first one that
+   * isn't due and never looks at the rest.
+   */
+  void Context::unsafe_expireRXFrags()
+  {
+    const size_t now = Chimera::millis();
+    size_t expired   = 0;
+
+    while ( PacketAssembly *const assembly = mPacketAssembly.expired( now ) )
+    {
+      assembly->whyRemove = PacketAssembly::RemoveErr::TIMEOUT;
+      unsafe_releaseAssembly( assembly );
+      expired++;
+    }
+
+    LOG_TRACE_IF( ( DEBUG_MODULE && expired ), "Expired %d packets from assembly\r\n", expired );
+  }
+
+
+  /**
+   * @brief Returns an assembly's slot to the table
+   *
+   * @param assembly  Finished or abandoned assembly, with whyRemove filled in
+   */
+  void Context::unsafe_releaseAssembly( PacketAssembly *const assembly )
+  {
+    /*-------------------------------------------------------------------------
+    Log the reason for removal. Very useful for post mortem debugging.
+    -------------------------------------------------------------------------*/
+    RIPPLE_TRACE( TRC_ASM_REMOVE, assembly->uuid, static_cast<uint32_t>( assembly->whyRemove ) );
+    if ( assembly->whyRemove != PacketAssembly::RemoveErr::COMPLETED )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Abnormal assembly removal of UUID [%d]: %s\r\n", assembly->uuid,
+                    assembly->whyRemoveString() );
+    }
+
+    mPacketAssembly.release( assembly );
+  }
+
+
+  /**
+   * @brief Hands the packets completed by the last pump to their sockets
+   *
+   * Only assemblies that actually finished are looked at. Each one is routed
+   * or dropped, then its slot goes straight back to the table.
+   *
+   * @return size_t   Number of packets pushed to a socket
+   */
+  size_t Context::unsafe_processRXFrags()
+  {
+    size_t delivered = 0;
+
+    for ( PacketAssembly *const assembly : mRXReady )
+    {
+      if ( unsafe_routePacket( assembly ) )
+      {
+        delivered++;
+      }
+
+      unsafe_releaseAssembly( assembly );
+    }
+
+    mRXReady.clear();
+    return delivered;
+  }
+
+
+  /**
+   * @brief Inspects a completed packet and pushes it to its destination socket
+   *
+   * @param assembly  Completed assembly. Its whyRemove is filled in.
+   * @return true     Packet was queued on a socket
+   * @return false    Packet was dropped or consumed by the context
+   */
+  bool Context::unsafe_routePacket( PacketAssembly *const assembly )
+  {
+    /*-------------------------------------------------------------------------
+    All fragments received. Perform basic validity checks on whole packet.
+    -------------------------------------------------------------------------*/
+    if ( !assembly->crcValid || !assembly->packet->isFullyComposed() )
+    {
+      assembly->whyRemove = PacketAssembly::RemoveErr::CORRUPTION;
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Resend requests are answered here and never reach a socket
+    -------------------------------------------------------------------------*/
+    auto header = reinterpret_cast<const TransportHeader *>( assembly->packet->head->payload() );
+
+    if ( header->dstPort == NACK_PORT )
+    {
+      unsafe_processNack( assembly->packet );
+      assembly->whyRemove = PacketAssembly::RemoveErr::COMPLETED;
+      return false;
+    }
+
+    assembly->whyRemove = unsafe_deliver( assembly->packet );
+    return ( assembly->whyRemove == PacketAssembly::RemoveErr::COMPLETED );
+  }
+
+
+  /**
+   * @brief Pushes a whole packet to the socket bound to its destination port
+   *
+   * @param packet    Packet starting with its TransportHeader
+   * @return RemoveErr  COMPLETED if the packet was queued, else why it wasn't
+   */
+  PacketAssembly::RemoveErr Context::unsafe_deliver( const Packet_sPtr &packet )
+  {
+    /*-------------------------------------------------------------------------
+    Find the socket bound to the destination port. Only PULL and STREAM sockets
+    bind, as they are the only ones that can receive data.
+    -------------------------------------------------------------------------*/
+    auto header        = reinterpret_cast<const TransportHeader *>( packet->head->payload() );
+    Socket *const sock = unsafe_findPort( header->dstPort );
+    if ( !sock )
+    {
+      return PacketAssembly::RemoveErr::SOCK_NOT_FOUND;
+    }
+
+    /*-------------------------------------------------------------------------
+    Check for enough room in the RX queue
+    -------------------------------------------------------------------------*/
+    Chimera::Thread::LockGuard<Socket> _sckLock( *sock );
+    if ( sock->mRXQueue.full() )
+    {
+      return PacketAssembly::RemoveErr::SOCK_Q_FULL;
+    }
+
+    /*-------------------------------------------------------------------------
+    Push the root fragment into the queue, effectively informing the socket
+    of the entire ordered packet. The socket is visited once per pass, no
+    matter how many packets it was given.
+    -------------------------------------------------------------------------*/
+    if ( sock->mRXQueue.empty() )
+    {
+      mRXSockets.push_back( sock );
+    }
+
+    sock->mRXQueue.push( packet );
+    RIPPLE_TRACE( TRC_SOCK_RX_ENQUEUE, header->dstPort, packet->size() );
+    return PacketAssembly::RemoveErr::COMPLETED;
+  }
+
+
+  /**
+   * @brief Hands a packet sent to this node straight to its socket
+   *
+   * Local packets are built as a single fragment, so they already look like a
+   * reassembled packet. The RX pass that picks them up is raised here.
+   *
+   * @param packet    Packet written by a local socket
+   */
+  void Context::deliverLocal( const Packet_sPtr &packet )
+  {
+    PacketAssembly::RemoveErr result = PacketAssembly::RemoveErr::UNKNOWN;
+    packet->timestamp_us             = static_cast<uint32_t>( Chimera::micros() );
+    {
+      Chimera::Thread::LockGuard<Context> _ctxLock( *this );
+      result = unsafe_deliver( packet );
+    }
+
+    if ( result == PacketAssembly::RemoveErr::COMPLETED )
+    {
+      signalEvent( CTX_EVT_RX );
+    }
+    else
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Dropped local packet: %d\r\n", static_cast<int>( result ) );
+    }
+  }
+
+
+  /**
+   * @brief Looks up the socket bound to a port
+   *
+   * @param port      Port to look up
+   * @return Socket*  Bound socket, or nullptr if there isn't one
+   */
+  Socket *Context::unsafe_findPort( const SocketId port ) const
+  {
+    for ( size_t bucket = hashIndex16( port, PORT_INDEX_BITS ); mPortIndex[ bucket ];
+          bucket = ( bucket + 1u ) & PORT_INDEX_MASK )
+    {
+      if ( mPortIndex[ bucket ]->port() == port )
+      {
+        return mPortIndex[ bucket ];
+      }
+    }
+
+    return nullptr;
+  }
+
+
+  /**
+   * @brief Builds a socket at the front of its cache and registers it
+   *
+   * The rest of the cache becomes the arena the socket builds its packets in.
+   * The caller owns the cache and gets it back untouched on failure.
+   *
+   * @param type        Socket type to create
+   * @param cache       Memory for the socket, already checked for size
+   * @param cacheSize   Bytes in the cache
+   * @return Socket_rPtr  Registered socket, or nullptr on failure
+   */
+  Socket_rPtr Context::unsafe_placeSocket( const SocketType type, uint8_t *const cache, const size_t cacheSize )
+  {
+    Socket_rPtr sock = new ( cache ) Socket( this, type, cache + SOCKET_OBJECT_BYTES, cacheSize - SOCKET_OBJECT_BYTES );
+
+    if ( ( type == SocketType::STREAM ) && !sock->mStream )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "Cache size of %d is too small for a stream socket!\r\n", cacheSize );
+      sock->~Socket();
+      return nullptr;
+    }
+
+    mSocketList.push_back( sock );
+    mSocketList.sort( Socket::compare );
+
+    return sock;
+  }
+
+
+  /**
    * @brief Moves received data from hardware driver to net stack
    *
    * Acts as a message pump to communicate with the device driver, pulling out
    * any waiting message fragments and pushing them into the appropriate area
    * for assembly into a full message.
+   *
+   * @param netif     Interface to pull from
    */
-  void Context::unsafe_pumpRXFrags()
+  void Context::unsafe_pumpRXFrags( NetIf::INetIf *const netif )
   {
     /*-------------------------------------------------------------------------
     Local Variables
@@ -499,11 +1340,6 @@ namespace Ripple
     Fragment_sPtr fragList;              /**< Temp var for HW assembled data */
     auto state = Chimera::Status::READY; /**< Reported HW state */
 
-    /*-------------------------------------------------------------------------
-    Clean the assembly area to prepare for new frags
-    -------------------------------------------------------------------------*/
-    unsafe_pruneRXFrags();
-
     /*-------------------------------------------------------------------------
     Keep pulling in data while NetIf says it's ready
     -------------------------------------------------------------------------*/
@@ -513,7 +1349,7 @@ namespace Ripple
       Try to receive a message from the hardware driver
       -----------------------------------------------------------------------*/
       fragList = Fragment_sPtr();
-      state    = mNetIf->recv( fragList );
+      state    = netif->recv( fragList );
 
       if ( ( state != Chimera::Status::READY ) || !fragList )
       {
@@ -522,6 +1358,8 @@ namespace Ripple
 
       /*-----------------------------------------------------------------------
       Pull each fragment from the list and push it to the packet assembly area.
+      The list is only walked, never relinked, since assembly copies out the
+      payload and a netif may hand up a chain it shares with someone else.
       -----------------------------------------------------------------------*/
       while ( fragList )
       {
@@ -529,78 +1367,90 @@ namespace Ripple
         Cache the next item in the list for later
         ---------------------------------------------------------------------*/
         Fragment_sPtr nextFragment = fragList->next;
-        fragList->next             = Fragment_sPtr();
 
         /*---------------------------------------------------------------------
         Does the fragment UUID exist in the assembly area?
         ---------------------------------------------------------------------*/
-        auto iter = mPacketAssembly.find( fragList->uuid );
-        if ( iter != mPacketAssembly.end() )
+        PacketAssembly *assembly = mPacketAssembly.find( fragList->source, fragList->uuid );
+        bool stored              = false;
+
+        if ( assembly )
         {
           LOG_TRACE_IF( DEBUG_MODULE, "Received fragment UUID: %d\r\n", fragList->uuid );
 
           /*-------------------------------------------------------------------
-          Does this particular packet already exist in the assembly? Iterate
-          with pointers to avoid constructor costs.
-          -------------------------------------------------------------------*/
-          Fragment_sPtr* frag = &iter->second.packet->head;
-          bool isDuplicate    = false;
-          while ( *frag )
-          {
-            if ( fragList->number == ( *frag )->number )
-            {
-              LOG_ERROR_IF( DEBUG_MODULE, "Got duplicate fragment %d for UUID %d \r\n", fragList->number, fragList->uuid );
-              isDuplicate = true;
-              break; // First while
-            }
-
-            frag = &( *frag )->next;
-          }
-
-          /*-------------------------------------------------------------------
-          Insert the fragment at the front, out of order. The sorting process
-          will come later once all packets have been received.
+          Copy the fragment straight into its slot. Duplicates are caught by
+          the receive bitmap and simply dropped.
           -------------------------------------------------------------------*/
-          if ( !isDuplicate )
+          stored = assembly->insert( fragList );
+          if ( stored )
           {
-            Fragment_sPtr prevAssemblyFragPtr = iter->second.packet->head;
-
-            iter->second.packet->head       = fragList;
-            iter->second.packet->head->next = prevAssemblyFragPtr;
-            iter->second.bytesRcvd += fragList->length;
+            assembly->bytesRcvd += fragList->length;
+            assembly->lastRxTime = Chimera::millis();
           }
         }
         else if ( !mPacketAssembly.full() )
         {
           /*-------------------------------------------------------------------
-          Allocate memory for a new assembly
+          Take a free slot and allocate memory for the new assembly
           -------------------------------------------------------------------*/
-          PacketAssembly newAssembly( &this->mHeap );
+          const size_t now = Chimera::millis();
+          assembly         = mPacketAssembly.acquire( fragList->source, fragList->uuid, now + RIPPLE_PKT_LIFETIME );
+          bool started     = false;
+          {
+            Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> _heapLock( mHeap );
+            AllocSiteScope _site( mHeap, ALLOC_PACKET );
+
+            /*-----------------------------------------------------------------
+            A packet sent whole may use the roomier unfragmented frame
+            -----------------------------------------------------------------*/
+            const size_t slotSize = ( fragList->total <= 1 )
+                                        ? std::max( netif->maxTransferSize(), netif->maxUnfragmentedSize() )
+                                        : netif->maxTransferSize();
+
+            assembly->packet = allocPacket( &this->mHeap );
+            started          = assembly->begin( &this->mHeap, fragList, slotSize );
+          }
 
-          newAssembly.inProgress         = true;
-          newAssembly.remove             = false;
-          newAssembly.bytesRcvd          = fragList->length;
-          newAssembly.packet->head       = fragList;
-          newAssembly.startRxTime        = Chimera::millis();
-          newAssembly.lastTimeoutCheck   = newAssembly.startRxTime;
-          newAssembly.timeout            = RIPPLE_PKT_LIFETIME;
-          newAssembly.packet->head->next = Fragment_sPtr();
+          if ( !started )
+          {
+            LOG_ERROR( "Couldn't start assembly for UUID: %d\r\n", fragList->uuid );
+            mPacketAssembly.release( assembly );
+            fragList = nextFragment;
+            continue;
+          }
 
-          /*-------------------------------------------------------------------
-          Need to explicitly move the newly created assembly else some memory
-          issues occur with transferring the internal shared_ptr objects.
-          -------------------------------------------------------------------*/
-          std::pair<const uint32_t, Ripple::PacketAssembly> x{ fragList->uuid, std::move( newAssembly ) };
-          mPacketAssembly.insert( std::move( x ) );
+          assembly->inProgress  = true;
+          assembly->bytesRcvd   = fragList->length;
+          assembly->startRxTime = now;
+          assembly->startRx_us  = static_cast<uint32_t>( Chimera::micros() );
+          assembly->timeout     = RIPPLE_PKT_LIFETIME;
+          assembly->lastRxTime  = now;
+          assembly->nackCount   = 0;
+          stored                = true;
 
+          RIPPLE_TRACE( TRC_ASM_START, fragList->uuid, fragList->total );
           LOG_TRACE_IF( DEBUG_MODULE, "Starting assembly for UUID: %d\r\n", fragList->uuid );
         }
         else
         {
-          LOG_ERROR( "Packet assembly limit [%d] reached. Dropped fragment with UUID: %d\r\n", mPacketAssembly.MAX_SIZE,
+          LOG_ERROR( "Packet assembly limit [%d] reached. Dropped fragment with UUID: %d\r\n", mPacketAssembly.capacity(),
                      fragList->uuid );
         }
 
+        /*---------------------------------------------------------------------
+        Check for a completed packet. One sent with parity can be finished
+        early, rebuilding lost fragments rather than waiting out the timeout.
+        ---------------------------------------------------------------------*/
+        if ( stored && assembly->complete() )
+        {
+          assembly->inProgress           = false;
+          assembly->packet->timestamp_us = static_cast<uint32_t>( Chimera::micros() );
+          mLatency.record( LAT_ASSEMBLY, assembly->packet->timestamp_us - assembly->startRx_us );
+          mRXReady.push_back( assembly );
+          RIPPLE_TRACE( TRC_ASM_COMPLETE, assembly->uuid, assembly->bytesRcvd );
+        }
+
         /*---------------------------------------------------------------------
         Start parsing the next fragment
         ---------------------------------------------------------------------*/
@@ -609,4 +1459,207 @@ namespace Ripple
     }
   }
 
+
+  /**
+   * @brief Asks senders of stalled packets to resend the fragments still missing
+   *
+   * The link layer gives up on a frame after a few retries, which would leave
+   * the packet waiting out its full assembly timeout. Once an assembly has gone
+   * quiet for a while, a bitmap of the missing fragment numbers is sent back so
+   * only those are repaired.
+   */
+  void Context::unsafe_requestMissingFrags()
+  {
+    const size_t now = Chimera::millis();
+
+    for ( size_t idx = 0; idx < mPacketAssembly.size(); idx++ )
+    {
+      PacketAssembly *const assembly = mPacketAssembly.active( idx );
+      if ( !assembly->inProgress || ( assembly->nackCount >= RIPPLE_NACK_RETRIES ) ||
+           ( ( now - assembly->lastRxTime ) < RIPPLE_NACK_DELAY ) )
+      {
+        continue;
+      }
+
+      /*-----------------------------------------------------------------------
+      Wait a while again before the next check, even if no request goes out,
+      so the manager thread isn't woken for this one over and over.
+      -----------------------------------------------------------------------*/
+      assembly->lastRxTime = now;
+
+      /*-----------------------------------------------------------------------
+      Only the first fragment says who sent the packet. Without it, all that
+      can be done is wait for the timeout.
+      -----------------------------------------------------------------------*/
+      size_t length        = 0;
+      const void *raw_data = assembly->fragmentData( 0, length );
+      if ( !raw_data || ( length < sizeof( TransportHeader ) ) )
+      {
+        continue;
+      }
+
+      TransportHeader pktHeader;
+      memcpy( &pktHeader, raw_data, sizeof( TransportHeader ) );
+
+      /*-----------------------------------------------------------------------
+      Build the request. The original 32 bit form goes out unless a fragment
+      past its reach is missing.
+      -----------------------------------------------------------------------*/
+      static_assert( sizeof( FragmentNackWide::missing ) == sizeof( FragmentMask ) );
+
+      const FragmentMask missing = assembly->missingFragments();
+      const RouteResult path     = route( pktHeader.srcAddress );
+      if ( !missing || ( pktHeader.dstPort == NACK_PORT ) || !path.netif )
+      {
+        continue;
+      }
+
+      FragmentNack nack;
+      FragmentNackWide wide;
+      const bool isWide = ( missing >> std::numeric_limits<decltype( nack.missing )>::digits ) != 0;
+
+      nack.uuid    = assembly->uuid;
+      nack._pad    = 0;
+      nack.missing = static_cast<uint32_t>( missing );
+      wide.uuid    = assembly->uuid;
+      wide.version = NACK_VERSION_WIDE;
+      wide._pad    = 0;
+      wide.missing = missing;
+
+      const void *const request = isWide ? static_cast<const void *>( &wide ) : static_cast<const void *>( &nack );
+      const size_t requestSize  = isWide ? sizeof( wide ) : sizeof( nack );
+
+      assembly->nackCount++;
+
+      TransportHeader header;
+      header.crc        = 0;
+      header.dataLength = static_cast<uint16_t>( sizeof( TransportHeader ) + requestSize );
+      header.dstPort    = NACK_PORT;
+      header.srcPort    = NACK_PORT;
+      header.srcAddress = mIP;
+      header.flags      = TRANSPORT_FLAG_NONE;
+
+      Packet_sPtr pkt = Transport::constructPacket( &mHeap, header, request, requestSize, path.netif->maxTransferSize(),
+                                                    path.netif->maxUnfragmentedSize(), 0, path.netif->maxNumFragments() );
+      if ( pkt )
+      {
+        path.netif->send( pkt->head, path.address, NetIf::TC_CONTROL );
+        LOG_DEBUG_IF( DEBUG_MODULE, "Requested fragments %08X%08X of UUID %d\r\n", static_cast<uint32_t>( missing >> 32 ),
+                      static_cast<uint32_t>( missing ), assembly->uuid );
+      }
+    }
+  }
+
+
+  /**
+   * @brief Resends the fragments a receiver reported as missing
+   *
+   * @param packet    Fully assembled resend request
+   */
+  void Context::unsafe_processNack( const Packet_sPtr &packet )
+  {
+    /*-------------------------------------------------------------------------
+    Pull out the request. Its CRC was checked during reassembly, and its size
+    says which layout it is.
+    -------------------------------------------------------------------------*/
+    uint8_t raw[ sizeof( TransportHeader ) + sizeof( FragmentNackWide ) ];
+    const size_t size = packet->size();
+    if ( ( ( size != ( sizeof( TransportHeader ) + sizeof( FragmentNack ) ) ) &&
+           ( size != ( sizeof( TransportHeader ) + sizeof( FragmentNackWide ) ) ) ) ||
+         !packet->unpack( raw, size ) )
+    {
+      return;
+    }
+
+    TransportHeader header;
+    FragmentNackWide nack;
+    memcpy( &header, raw, sizeof( TransportHeader ) );
+
+    if ( size == sizeof( raw ) )
+    {
+      memcpy( &nack, raw + sizeof( TransportHeader ), sizeof( FragmentNackWide ) );
+      if ( nack.version != NACK_VERSION_WIDE )
+      {
+        return;
+      }
+    }
+    else
+    {
+      FragmentNack narrow;
+      memcpy( &narrow, raw + sizeof( TransportHeader ), sizeof( FragmentNack ) );
+      nack.uuid    = narrow.uuid;
+      nack.missing = narrow.missing;
+    }
+
+    /*-------------------------------------------------------------------------
+    Find the packet, if it's still around
+    -------------------------------------------------------------------------*/
+    auto entry = mRetained.begin();
+    while ( ( entry != mRetained.end() ) &&
+            ( ( entry->packet->getUUID() != nack.uuid ) || ( entry->destination != header.srcAddress ) ) )
+    {
+      entry++;
+    }
+
+    if ( entry == mRetained.end() )
+    {
+      LOG_DEBUG_IF( DEBUG_MODULE, "UUID %d no longer retained for resend\r\n", nack.uuid );
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Link copies of just the missing fragments, then send them off together.
+    Running out of memory part way sends only the ones copied so far, the
+    receiver asks again for the rest.
+    -------------------------------------------------------------------------*/
+    Fragment_sPtr resendHead;
+    Fragment_sPtr *tail   = &resendHead;
+    Fragment_sPtr fragPtr = entry->packet->head;
+
+    {
+      Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> _heapLock( mHeap );
+      AllocSiteScope _site( mHeap, ALLOC_FRAGMENT );
+
+      while ( fragPtr )
+      {
+        if ( ( fragPtr->number < std::numeric_limits<FragmentMask>::digits ) && ( ( nack.missing >> fragPtr->number ) & 0x1 ) )
+        {
+          Fragment_sPtr copy = fragmentShallowCopy( &mHeap, fragPtr );
+          if ( !copy )
+          {
+            LOG_DEBUG_IF( DEBUG_MODULE, "No memory to resend all of UUID %d\r\n", nack.uuid );
+            break;
+          }
+
+          *tail = copy;
+          tail  = &( *tail )->next;
+        }
+
+        fragPtr = fragPtr->next;
+      }
+    }
+
+    const RouteResult path = route( entry->destination );
+    if ( resendHead && path.netif )
+    {
+      path.netif->send( resendHead, path.address, entry->trafficClass );
+    }
+
+    Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> _heapLock( mHeap );
+    resendHead = Fragment_sPtr();
+  }
+
+
+  /**
+   * @brief Releases sent packets whose resend window has closed
+   */
+  void Context::unsafe_pruneRetained()
+  {
+    const size_t now = Chimera::millis();
+    while ( !mRetained.empty() && ( ( now - mRetained.front().sentTime ) >= RIPPLE_PKT_RETENTION ) )
+    {
+      mRetained.pop_front();
+    }
+  }
+
 }    // namespace Ripple
@@ -13,29 +13,73 @@
 #define RIPPLE_NETSTACK_CONTEXT_HPP
 
 /* STL Includes */
+#include <atomic>
 #include <cstdint>
 #include <cstddef>
 
 /* ETL Includes */
+#include <etl/deque.h>
 #include <etl/list.h>
 #include <etl/map.h>
 #include <etl/queue.h>
+#include <etl/vector.h>
 
 /* Aurora Includes */
 #include <Aurora/memory>
 
 /* Chimera Includes */
 #include <Chimera/callback>
+#include <Chimera/thread>
 
 /* Ripple Includes */
 #include <Ripple/src/netif/device_intf.hpp>
 #include <Ripple/src/netstack/config.hpp>
+#include <Ripple/src/netstack/memory_pool.hpp>
 #include <Ripple/src/netstack/types.hpp>
+#include <Ripple/src/netstack/packets/assembly.hpp>
 #include <Ripple/src/netstack/packets/packet.hpp>
+#include <Ripple/src/shared/cmn_utils.hpp>
 
 
 namespace Ripple
 {
+  /*---------------------------------------------------------------------------
+  Structures
+  ---------------------------------------------------------------------------*/
+  /**
+   *  A sent packet held onto for a short while, so fragments the receiver
+   *  reports as missing can be resent on their own.
+   */
+  struct RetainedPacket
+  {
+    Packet_sPtr packet;               /**< Packet that was sent */
+    IPAddress destination;            /**< Node the packet was sent to */
+    NetIf::TrafficClass trafficClass; /**< Class the packet was sent with */
+    size_t sentTime;                  /**< Time the packet was handed to the netif */
+  };
+
+  /**
+   *  Entry in the routing table. Packets for addresses inside the network go
+   *  out on the given interface, addressed to the next hop.
+   */
+  struct Route
+  {
+    IPAddress network;     /**< Destination network, already masked */
+    IPAddress mask;        /**< Bits of an address that must match the network */
+    IPAddress nextHop;     /**< Node to hand the packets to, or zero to send straight to the destination */
+    NetIf::INetIf *netif;  /**< Interface to send on */
+  };
+
+  /**
+   *  Where a packet to some destination goes
+   */
+  struct RouteResult
+  {
+    NetIf::INetIf *netif; /**< Interface to send on, nullptr if unreachable or local */
+    IPAddress address;    /**< Address to hand the packet to on that interface */
+    bool local;           /**< Destination is this node, so no interface is needed */
+  };
+
   /*---------------------------------------------------------------------------
   Classes
   ---------------------------------------------------------------------------*/
@@ -60,26 +104,70 @@ namespace Ripple
      *        cache memory. The cache must be word aligned.
      *
      *  @param[in]  type      Socket type to create
-     *  @param[in]  cacheSize How many bytes to allocate for packet memory
+     *  @param[in]  cacheSize How many bytes to allocate for the socket and the
+     *                        arena its outgoing packets are built in
      *  @return Socket_rPtr
      */
     Socket_rPtr socket( const SocketType type, const size_t cacheSize );
 
     /**
-     *  Attaches a network interface instance to use as the transport layer
+     *  Creates a new socket in memory owned by the caller, such as a
+     *  StaticSocketCache. The memory is never handed back to the heap.
+     *
+     *  @param[in]  type      Socket type to create
+     *  @param[in]  cache     Memory for the socket and its arena, max_align_t aligned
+     *  @param[in]  cacheSize Bytes in the cache
+     *  @return Socket_rPtr
+     */
+    Socket_rPtr socket( const SocketType type, void *const cache, const size_t cacheSize );
+
+    /**
+     *  Attaches a network interface instance to use as the transport layer.
+     *  Several may be attached. The first one carries anything no route
+     *  covers.
      *
      *  @param[in]  netif     Network interface
+     *  @return bool          False if the interface limit was reached
+     */
+    bool attachNetif( NetIf::INetIf *const netif );
+
+    /**
+     *  Adds or replaces a route. Lookups pick the longest matching prefix.
+     *
+     *  @param[in]  network   Destination network
+     *  @param[in]  prefix    Leading bits of the network that must match, 0 to 32
+     *  @param[in]  netif     Attached interface to send on
+     *  @param[in]  nextHop   Node to send through, or zero to send straight to the destination
+     *  @return bool          False if the table is full or the interface isn't attached
+     */
+    bool addRoute( const IPAddress network, const uint8_t prefix, NetIf::INetIf *const netif, const IPAddress nextHop = 0 );
+
+    /**
+     *  Removes a route
+     *
+     *  @param[in]  network   Destination network
+     *  @param[in]  prefix    Prefix length the route was added with
      *  @return void
      */
-    void attachNetif( NetIf::INetIf *const netif );
+    void removeRoute( const IPAddress network, const uint8_t prefix );
+
+    /**
+     *  Finds where a packet to a destination goes. LOCAL_HOST_IP and this
+     *  node's own address never leave the node.
+     *
+     *  @param[in]  destination   Address to reach
+     *  @return RouteResult
+     */
+    RouteResult route( const IPAddress destination );
 
     /**
      *  Allocates memory from the internally managed heap
      *
      *  @param[in]  size      Bytes to allocate
+     *  @param[in]  site      Which path the telemetry charges it to
      *  @return void *
      */
-    void *malloc( const size_t size );
+    void *malloc( const size_t size, const AllocSite site = ALLOC_SCRATCH );
 
     /**
      *  Free memory allocated on the internally managed heap
@@ -95,19 +183,56 @@ namespace Ripple
      */
     size_t availableMemory() const;
 
+    /**
+     *  Gets the allocation telemetry of the heap, for sizing the memory
+     *  handed to create() and finding what churns it
+     *
+     *  @param[out] stats     Output for the telemetry
+     *  @return void
+     */
+    void getHeapStats( HeapStats &stats );
+
+    /**
+     *  Reads the network wide clock from the first attached interface that
+     *  has one synced
+     *
+     *  @param[out] now_us    Current network time (uS)
+     *  @return bool          False if no interface has a synced clock
+     */
+    bool networkTime( uint64_t &now_us );
+
+    /**
+     *  Gets the performance data of the context manager
+     *
+     *  @param[out] stats     Output for the data
+     *  @return void
+     */
+    void getStats( ContextStats &stats );
+
+    /**
+     *  Gets the latency histograms of every stage a packet moves through,
+     *  from the socket write down to the radio and back up to the handler.
+     *  Link stages are summed over all attached netifs.
+     *
+     *  @param[out] report    Output for the histograms
+     *  @return void
+     */
+    void getLatencyStats( LatencyReport &report );
+
     /**
      * @brief Prints the available network stats to console
      */
     void printStats();
 
 
-    Aurora::Memory::Heap mHeap; /**< Managed memory pool for the whole network */
+    PoolHeap mHeap; /**< Managed memory pool for the whole network */
 
 
   protected:
     friend class Socket;
     friend class Chimera::Thread::Lockable<Context>;
-    friend Context_rPtr create( void *, const size_t );
+    friend Context_rPtr createInPlace( void *const, void *const, const size_t, void *const, const size_t, void *const,
+                                       const size_t );
 
     /**
      *  Constructor for creating the context from a pre-allocated memory pool
@@ -116,6 +241,15 @@ namespace Ripple
      */
     explicit Context( Aurora::Memory::Heap &&heap );
 
+    /**
+     *  Constructor for a context whose block pools live outside the heap
+     *
+     *  @param[in]  heap        Memory allocator used for construction
+     *  @param[in]  poolMemory  Memory to carve the pools from, nullptr for the heap
+     *  @param[in]  poolSize    Bytes in poolMemory
+     */
+    Context( Aurora::Memory::Heap &&heap, void *const poolMemory, const size_t poolSize );
+
     /**
      *  Class manager thread that handles all the runtime operations
      *  needed for the network to stay alive and have messages flowing.
@@ -127,15 +261,67 @@ namespace Ripple
 
     /**
      *  Processes RX data and routes to the proper socket
-     *  @return void
+     *  @return size_t          Number of packets handed to sockets
      */
-    void processRX();
+    size_t processRX();
 
     /**
      *  Processes TX data and queues for transmission
+     *  @return size_t          Number of packets handed to the netif
+     */
+    size_t processTX();
+
+    /**
+     *  Flags work for the manager thread and wakes it if it isn't already
+     *
+     *  @param[in]  event       bfContextEvent flags to raise
      *  @return void
      */
-    void processTX();
+    void signalEvent( const uint32_t event );
+
+    /**
+     *  Works out how long the manager thread can sleep before a tracked
+     *  deadline, such as an assembly timeout, comes due.
+     *
+     *  @return size_t          Milliseconds until the next deadline
+     */
+    size_t nextWakeupDelay();
+
+    /**
+     *  Holds onto a sent packet in case the receiver asks for fragments again
+     *
+     *  @param[in]  packet      Packet that was sent
+     *  @param[in]  destination Node the packet was sent to
+     *  @param[in]  tc          Class the packet was sent with
+     *  @return void
+     */
+    void retainPacket( const Packet_sPtr &packet, const IPAddress destination, const NetIf::TrafficClass tc );
+
+    /**
+     *  Makes a socket the one that receives packets sent to its port
+     *
+     *  @param[in]  socket      Socket to bind, already given its port
+     *  @return bool            False if another socket holds the port
+     */
+    bool bindPort( Socket *const socket );
+
+    /**
+     *  Stops a socket from receiving packets. Does nothing if it isn't bound.
+     *
+     *  @param[in]  socket      Socket to unbind
+     *  @return void
+     */
+    void unbindPort( Socket *const socket );
+
+    /**
+     *  Puts a socket on the list the manager visits to send packets. Takes the
+     *  context lock, so must not be called with the socket locked.
+     *
+     *  @param[in]  socket      Socket that just queued or gathered a packet
+     *  @param[in]  delay       How long until the socket must be visited (ms)
+     *  @return void
+     */
+    void markTXReady( Socket *const socket, const size_t delay = 0 );
 
     /*-------------------------------------------------
     Callbacks for NetIf CallbackId
@@ -150,14 +336,54 @@ namespace Ripple
     void cb_OnARPStorageLimit( size_t callbackID );
 
   private:
+    static constexpr size_t PORT_INDEX_BITS = hashIndexBits( RIPPLE_CTX_MAX_SOCKETS );
+    static constexpr size_t PORT_INDEX_SIZE = static_cast<size_t>( 1u ) << PORT_INDEX_BITS;
+    static constexpr size_t PORT_INDEX_MASK = PORT_INDEX_SIZE - 1u;
+
+    /*-------------------------------------------------
+    Locks are always taken in this order: mRXLock, the
+    context lock, a socket, then a heap or the route
+    lock. The context
+    lock guards the socket list, port index, TX ready
+    list and retained packets. User callbacks never run
+    with any of them held.
+    -------------------------------------------------*/
+    Chimera::Thread::RecursiveTimedMutex mRXLock;                  /**< Guards the assembly table and RX ready list */
+    Chimera::Thread::RecursiveTimedMutex mRouteLock;               /**< Guards the interfaces and routes. Taken last. */
+
     IPAddress mIP;
-    NetIf::INetIf *mNetIf;                                   /**< Network interface driver */
-    etl::list<Socket *, RIPPLE_CTX_MAX_SOCKETS> mSocketList; /**< Socket control structures */
-    AssemblyMap<RIPPLE_CTX_MAX_PKT> mPacketAssembly;         /**< Workspace for assembling fragments */
+    etl::vector<NetIf::INetIf *, RIPPLE_CTX_MAX_NETIF> mNetIfs;    /**< Attached interfaces, the first is the default */
+    etl::vector<Route, RIPPLE_CTX_MAX_ROUTES> mRoutes;             /**< Routing table, longest prefix first */
+    etl::list<Socket *, RIPPLE_CTX_MAX_SOCKETS> mSocketList;       /**< Socket control structures */
+    AssemblyTable<RIPPLE_CTX_MAX_PKT> mPacketAssembly;             /**< Workspace for assembling fragments */
+    etl::vector<PacketAssembly *, RIPPLE_CTX_MAX_PKT> mRXReady;    /**< Assemblies completed by the last pump */
+    etl::vector<Socket *, RIPPLE_CTX_MAX_SOCKETS> mRXSockets;      /**< Sockets handed packets by the last pump */
+    Socket *mPortIndex[ PORT_INDEX_SIZE ];                         /**< Open hash of port to receiving socket */
+    Socket *mTXReadyHead;                                          /**< First socket with packets waiting to send */
+    Socket *mTXReadyTail;                                          /**< Last socket with packets waiting to send */
+    std::atomic<bool> mTXBlocked;                                  /**< A socket is waiting on room in the netif */
+    etl::deque<RetainedPacket, RIPPLE_CTX_MAX_RETAINED> mRetained; /**< Sent packets kept for resend requests */
+    Chimera::Thread::TaskId mTaskId;                               /**< Manager thread registration ID */
+    std::atomic<uint32_t> mEvents;                                 /**< Pending bfContextEvent flags */
+    std::atomic<uint32_t> mRXEventTime;                            /**< When the pending RX event was raised (uS) */
+    std::atomic<uint32_t> mTXEventTime;                            /**< When the pending TX event was raised (uS) */
+    ContextStats mStats;                                           /**< Manager performance data */
+    LatencyRecorder mLatency;                                      /**< Socket and assembly stage histograms */
+    ThreadProfiler mProfile;                                       /**< Manager thread load, owned by that thread */
 
-    void unsafe_pruneRXFrags();
-    void unsafe_processRXFrags();
-    void unsafe_pumpRXFrags();
+    void unsafe_expireRXFrags();
+    void unsafe_releaseAssembly( PacketAssembly *const assembly );
+    size_t unsafe_processRXFrags();
+    bool unsafe_routePacket( PacketAssembly *const assembly );
+    Socket *unsafe_findPort( const SocketId port ) const;
+    void unsafe_pumpRXFrags( NetIf::INetIf *const netif );
+    PacketAssembly::RemoveErr unsafe_deliver( const Packet_sPtr &packet );
+    void deliverLocal( const Packet_sPtr &packet );
+    size_t snapshotNetifs( NetIf::INetIf **const netifs );
+    void unsafe_requestMissingFrags();
+    void unsafe_processNack( const Packet_sPtr &packet );
+    void unsafe_pruneRetained();
+    Socket_rPtr unsafe_placeSocket( const SocketType type, uint8_t *const cache, const size_t cacheSize );
   };
 
 }    // namespace Ripple
@@ -0,0 +1,419 @@
+/********************************************************************************
+ *  File Name:
+ *    memory_pool.cpp
+ *
+ *  Description:
+ *    Fixed size block pools for the objects the net stack churns through
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <algorithm>
+#include <cstring>
+
+/* Aurora Includes */
+#include <Aurora/logging>
+
+/* Ripple Includes */
+#include <Ripple/netstack>
+
+/*-------------------------------------------------------------------------------
+Literals
+-------------------------------------------------------------------------------*/
+#define DEBUG_MODULE ( false )
+
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr uint32_t POOL_INDEX_MASK = 0xFFFF;
+  static constexpr uint32_t POOL_TAG_SHIFT  = 16;
+  static constexpr uint16_t POOL_END        = 0xFFFF;
+
+
+  /*-------------------------------------------------------------------------------
+  BlockPool Class
+  -------------------------------------------------------------------------------*/
+  BlockPool::BlockPool() :
+      mBase( nullptr ), mBlockSize( 0 ), mBlocks( 0 ), mFreeHead( POOL_END ), mInUse( 0 ), mHighWater( 0 ), mMisses( 0 )
+  {
+  }
+
+
+  void BlockPool::assign( void *const memory, const size_t blockSize, const size_t blocks )
+  {
+    mBase      = reinterpret_cast<uint8_t *>( memory );
+    mBlockSize = blockSize;
+    mBlocks    = ( memory && ( blockSize >= sizeof( uint16_t ) ) ) ? std::min<size_t>( blocks, POOL_END ) : 0;
+
+    /*-------------------------------------------------
+    Link every block into the free stack, in order
+    -------------------------------------------------*/
+    for ( size_t idx = 0; idx < mBlocks; idx++ )
+    {
+      const uint16_t next = ( ( idx + 1u ) < mBlocks ) ? static_cast<uint16_t>( idx + 1u ) : POOL_END;
+      memcpy( mBase + ( idx * mBlockSize ), &next, sizeof( next ) );
+    }
+
+    mFreeHead.store( mBlocks ? 0 : POOL_END, std::memory_order_release );
+    mInUse.store( 0, std::memory_order_relaxed );
+    mHighWater.store( 0, std::memory_order_relaxed );
+    mMisses.store( 0, std::memory_order_relaxed );
+  }
+
+
+  void *BlockPool::allocate()
+  {
+    /*-------------------------------------------------
+    Pop the top of the free stack. The tag changes on
+    every update so a stale head can't win the swap.
+    -------------------------------------------------*/
+    uint32_t head = mFreeHead.load( std::memory_order_acquire );
+    while ( ( head & POOL_INDEX_MASK ) != POOL_END )
+    {
+      const uint32_t idx = head & POOL_INDEX_MASK;
+      uint16_t next      = POOL_END;
+      memcpy( &next, mBase + ( idx * mBlockSize ), sizeof( next ) );
+
+      const uint32_t tag     = ( ( head >> POOL_TAG_SHIFT ) + 1u ) << POOL_TAG_SHIFT;
+      const uint32_t desired = tag | next;
+      if ( mFreeHead.compare_exchange_weak( head, desired, std::memory_order_acq_rel, std::memory_order_acquire ) )
+      {
+        /*-------------------------------------------------
+        Track the most blocks ever out at once
+        -------------------------------------------------*/
+        const uint32_t inUse = mInUse.fetch_add( 1, std::memory_order_relaxed ) + 1u;
+        uint32_t highWater   = mHighWater.load( std::memory_order_relaxed );
+        while ( ( inUse > highWater ) &&
+                !mHighWater.compare_exchange_weak( highWater, inUse, std::memory_order_relaxed ) )
+        {
+          continue;
+        }
+
+        return mBase + ( idx * mBlockSize );
+      }
+    }
+
+    mMisses.fetch_add( 1, std::memory_order_relaxed );
+    return nullptr;
+  }
+
+
+  void BlockPool::release( void *const block )
+  {
+    const uint16_t idx = static_cast<uint16_t>( ( reinterpret_cast<uint8_t *>( block ) - mBase ) / mBlockSize );
+    uint32_t head      = mFreeHead.load( std::memory_order_acquire );
+    uint32_t desired   = 0;
+
+    do
+    {
+      const uint16_t next = static_cast<uint16_t>( head & POOL_INDEX_MASK );
+      memcpy( block, &next, sizeof( next ) );
+
+      desired = ( ( ( head >> POOL_TAG_SHIFT ) + 1u ) << POOL_TAG_SHIFT ) | idx;
+    } while ( !mFreeHead.compare_exchange_weak( head, desired, std::memory_order_acq_rel, std::memory_order_acquire ) );
+
+    mInUse.fetch_sub( 1, std::memory_order_relaxed );
+  }
+
+
+  bool BlockPool::owns( const void *const block ) const
+  {
+    const uint8_t *ptr = reinterpret_cast<const uint8_t *>( block );
+    return mBlocks && ( ptr >= mBase ) && ( ptr < ( mBase + ( mBlocks * mBlockSize ) ) );
+  }
+
+
+  void BlockPool::getStats( PoolStats &stats ) const
+  {
+    stats.blockSize = mBlockSize;
+    stats.blocks    = mBlocks;
+    stats.inUse     = mInUse.load( std::memory_order_relaxed );
+    stats.highWater = mHighWater.load( std::memory_order_relaxed );
+    stats.misses    = mMisses.load( std::memory_order_relaxed );
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  PoolHeap Class
+  -------------------------------------------------------------------------------*/
+  PoolHeap::PoolHeap() : Aurora::Memory::Heap(), mBySize{ POOL_PAYLOAD, POOL_FRAGMENT, POOL_PACKET }, mAllocs( 0 )
+  {
+    resetTelemetry();
+  }
+
+
+  PoolHeap::PoolHeap( Aurora::Memory::Heap &&heap ) :
+      Aurora::Memory::Heap( std::move( heap ) ), mBySize{ POOL_PAYLOAD, POOL_FRAGMENT, POOL_PACKET }, mAllocs( 0 )
+  {
+    resetTelemetry();
+  }
+
+
+  bool PoolHeap::initPools()
+  {
+    return assignPools( nullptr, 0 );
+  }
+
+
+  bool PoolHeap::initPools( void *const memory, const size_t size )
+  {
+    if ( !memory || ( reinterpret_cast<uintptr_t>( memory ) % POOL_ALIGNMENT ) )
+    {
+      return false;
+    }
+
+    return assignPools( reinterpret_cast<uint8_t *>( memory ), size );
+  }
+
+
+  bool PoolHeap::assignPools( uint8_t *const region, const size_t size )
+  {
+    static_assert( POOL_NUM_OPTIONS == 3, "Update the pool sizing" );
+
+    const size_t blockSize[ POOL_NUM_OPTIONS ] = { POOL_PAYLOAD_BLOCK, POOL_FRAGMENT_BLOCK, POOL_PACKET_BLOCK };
+    const size_t blocks[ POOL_NUM_OPTIONS ]    = { RIPPLE_POOL_PAYLOAD_BLOCKS, RIPPLE_POOL_FRAGMENT_BLOCKS,
+                                                   RIPPLE_POOL_PACKET_BLOCKS };
+
+    /*-------------------------------------------------
+    Carve the memory out of the region or the heap.
+    This happens once and is never given back.
+    -------------------------------------------------*/
+    bool allAssigned = true;
+    size_t used      = 0;
+    for ( size_t idx = 0; idx < POOL_NUM_OPTIONS; idx++ )
+    {
+      const size_t bytes = blockSize[ idx ] * blocks[ idx ];
+      void *memory       = nullptr;
+
+      if ( bytes && region && ( ( size - used ) >= bytes ) )
+      {
+        memory = region + used;
+        used += bytes;
+      }
+      else if ( bytes && !region )
+      {
+        memory = Aurora::Memory::Heap::malloc( bytes );
+      }
+
+      if ( blocks[ idx ] && !memory )
+      {
+        LOG_ERROR( "Not enough memory for pool %d of %d blocks\r\n", idx, blocks[ idx ] );
+        allAssigned = false;
+      }
+
+      mPool[ idx ].assign( memory, blockSize[ idx ], memory ? blocks[ idx ] : 0 );
+    }
+
+    /*-------------------------------------------------
+    Requests go to the smallest block that fits
+    -------------------------------------------------*/
+    std::sort( std::begin( mBySize ), std::end( mBySize ), [ this ]( const PoolClass a, const PoolClass b ) {
+      return mPool[ a ].blockSize() < mPool[ b ].blockSize();
+    } );
+
+    updateLowWater();
+    return allAssigned;
+  }
+
+
+  void *PoolHeap::malloc( size_t size )
+  {
+    const uint8_t site = mSite.load( std::memory_order_relaxed );
+
+    mAllocs.fetch_add( 1, std::memory_order_relaxed );
+    mSiteAllocs[ site ].fetch_add( 1, std::memory_order_relaxed );
+    mSiteBytes[ site ].fetch_add( static_cast<uint32_t>( size ), std::memory_order_relaxed );
+
+    for ( auto pool : mBySize )
+    {
+      if ( size > mPool[ pool ].blockSize() )
+      {
+        continue;
+      }
+
+      if ( void *block = mPool[ pool ].allocate() )
+      {
+        return block;
+      }
+    }
+
+    /*-------------------------------------------------
+    Only the heap itself can move the low water mark,
+    since the pools were carved from it up front
+    -------------------------------------------------*/
+    void *mem = Aurora::Memory::Heap::malloc( size );
+    if ( mem )
+    {
+      updateLowWater();
+    }
+    else
+    {
+      mFailures.fetch_add( 1, std::memory_order_relaxed );
+      mSiteFailures[ site ].fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    return mem;
+  }
+
+
+  void PoolHeap::free( void *pv )
+  {
+    mFrees.fetch_add( 1, std::memory_order_relaxed );
+
+    for ( auto &pool : mPool )
+    {
+      if ( pool.owns( pv ) )
+      {
+        pool.release( pv );
+        return;
+      }
+    }
+
+    Aurora::Memory::Heap::free( pv );
+  }
+
+
+  void PoolHeap::getPoolStats( const PoolClass pool, PoolStats &stats ) const
+  {
+    if ( pool < POOL_NUM_OPTIONS )
+    {
+      mPool[ pool ].getStats( stats );
+    }
+    else
+    {
+      memset( &stats, 0, sizeof( stats ) );
+    }
+  }
+
+
+  void PoolHeap::getHeapStats( HeapStats &stats )
+  {
+    Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> _heapLock( *this );
+
+    stats.capacity    = mCapacity;
+    stats.free        = available();
+    stats.lowWater    = std::min<size_t>( mLowWater.load( std::memory_order_relaxed ), stats.free );
+    stats.largestFree = unsafe_largestFree();
+    stats.allocs      = mAllocs.load( std::memory_order_relaxed );
+    stats.frees       = mFrees.load( std::memory_order_relaxed );
+    stats.failures    = mFailures.load( std::memory_order_relaxed );
+
+    stats.fragmentation = 0;
+    if ( stats.free )
+    {
+      stats.fragmentation = 100u - ( ( 100u * std::min( stats.largestFree, stats.free ) ) / stats.free );
+    }
+
+    for ( size_t idx = 0; idx < ALLOC_NUM_OPTIONS; idx++ )
+    {
+      stats.site[ idx ].allocs   = mSiteAllocs[ idx ].load( std::memory_order_relaxed );
+      stats.site[ idx ].bytes    = mSiteBytes[ idx ].load( std::memory_order_relaxed );
+      stats.site[ idx ].failures = mSiteFailures[ idx ].load( std::memory_order_relaxed );
+    }
+
+    for ( size_t idx = 0; idx < POOL_NUM_OPTIONS; idx++ )
+    {
+      mPool[ idx ].getStats( stats.pool[ idx ] );
+    }
+  }
+
+
+  size_t PoolHeap::unsafe_largestFree()
+  {
+    /*-------------------------------------------------
+    The heap doesn't expose its free list, so binary
+    search for the biggest request it will grant. Goes
+    straight to the heap so the counters aren't moved.
+    -------------------------------------------------*/
+    size_t lo = 0;
+    size_t hi = available();
+
+    while ( lo < hi )
+    {
+      const size_t mid = lo + ( ( hi - lo + 1u ) / 2u );
+      void *probe      = Aurora::Memory::Heap::malloc( mid );
+      if ( probe )
+      {
+        Aurora::Memory::Heap::free( probe );
+        lo = mid;
+      }
+      else
+      {
+        hi = mid - 1u;
+      }
+    }
+
+    return lo;
+  }
+
+
+  void PoolHeap::updateLowWater()
+  {
+    const uint32_t freeNow = static_cast<uint32_t>( available() );
+    uint32_t lowWater      = mLowWater.load( std::memory_order_relaxed );
+    while ( ( freeNow < lowWater ) && !mLowWater.compare_exchange_weak( lowWater, freeNow, std::memory_order_relaxed ) )
+    {
+      continue;
+    }
+  }
+
+
+  void PoolHeap::resetTelemetry()
+  {
+    mCapacity = available();
+    mFrees.store( 0, std::memory_order_relaxed );
+    mFailures.store( 0, std::memory_order_relaxed );
+    mLowWater.store( static_cast<uint32_t>( mCapacity ), std::memory_order_relaxed );
+    mSite.store( ALLOC_OTHER, std::memory_order_relaxed );
+
+    for ( size_t idx = 0; idx < ALLOC_NUM_OPTIONS; idx++ )
+    {
+      mSiteAllocs[ idx ].store( 0, std::memory_order_relaxed );
+      mSiteBytes[ idx ].store( 0, std::memory_order_relaxed );
+      mSiteFailures[ idx ].store( 0, std::memory_order_relaxed );
+    }
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  AllocSiteScope Class
+  -------------------------------------------------------------------------------*/
+  AllocSiteScope::AllocSiteScope( PoolHeap &heap, const AllocSite site ) :
+      mHeap( heap ), mPrevious( heap.mSite.load( std::memory_order_relaxed ) )
+  {
+    mHeap.mSite.store( ( site < ALLOC_NUM_OPTIONS ) ? site : ALLOC_OTHER, std::memory_order_relaxed );
+  }
+
+
+  AllocSiteScope::~AllocSiteScope()
+  {
+    mHeap.mSite.store( mPrevious, std::memory_order_relaxed );
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  SocketArena Class
+  -------------------------------------------------------------------------------*/
+  SocketArena::SocketArena() : Aurora::Memory::Heap(), mMisses( 0 ), mAllocs( 0 )
+  {
+  }
+
+
+  void *SocketArena::malloc( size_t size )
+  {
+    mAllocs.fetch_add( 1, std::memory_order_relaxed );
+
+    void *mem = Aurora::Memory::Heap::malloc( size );
+    if ( !mem )
+    {
+      mMisses.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    return mem;
+  }
+
+}    // namespace Ripple
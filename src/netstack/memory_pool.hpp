@@ -0,0 +1,380 @@
+/********************************************************************************
+ *  File Name:
+ *    memory_pool.hpp
+ *
+ *  Description:
+ *    Fixed size block pools for the objects the net stack churns through
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_NETSTACK_MEMORY_POOL_HPP
+#define RIPPLE_NETSTACK_MEMORY_POOL_HPP
+
+/* STL Includes */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* Aurora Includes */
+#include <Aurora/memory>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/config.hpp>
+#include <Ripple/src/netstack/packets/packet.hpp>
+
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Largest fragment payload served by the payload pool. Covers a full NRF24
+   *  frame with room to spare.
+   */
+  static constexpr size_t POOL_PAYLOAD_BYTES = 32;
+
+  /**
+   *  Alignment of every block, and of the memory the pools are carved from
+   */
+  static constexpr size_t POOL_ALIGNMENT = 2 * sizeof( size_t );
+
+  /*-------------------------------------------------------------------------------
+  Enumerations
+  -------------------------------------------------------------------------------*/
+  enum PoolClass : uint8_t
+  {
+    POOL_PAYLOAD,  /**< Fragment payload buffers */
+    POOL_FRAGMENT, /**< Fragment control structures */
+    POOL_PACKET,   /**< Packet control structures */
+
+    POOL_NUM_OPTIONS
+  };
+
+  /**
+   *  Which path asked for memory from the context heap
+   */
+  enum AllocSite : uint8_t
+  {
+    ALLOC_FRAGMENT, /**< Fragments built by a netif from received frames */
+    ALLOC_PACKET,   /**< Packets and assembly buffers built from received fragments */
+    ALLOC_SCRATCH,  /**< Context::malloc(), such as netif objects and thread stacks */
+    ALLOC_SOCKET,   /**< Socket caches and the arenas inside them */
+    ALLOC_OTHER,    /**< Anything allocated outside an AllocSiteScope */
+
+    ALLOC_NUM_OPTIONS
+  };
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  struct PoolStats
+  {
+    size_t blockSize; /**< Bytes in each block */
+    size_t blocks;    /**< Blocks in the pool */
+    size_t inUse;     /**< Blocks currently handed out */
+    size_t highWater; /**< Most blocks ever handed out at once */
+    size_t misses;    /**< Requests that found the pool empty */
+  };
+
+  struct AllocSiteStats
+  {
+    size_t allocs;   /**< Allocations asked for, pooled or not */
+    size_t bytes;    /**< Bytes asked for over all of them */
+    size_t failures; /**< Allocations that couldn't be served */
+  };
+
+  /**
+   *  Telemetry for the context heap. Per site numbers count since the context
+   *  was created, since a free can't be traced back to the site it came from.
+   *  What's in use right now comes from the heap and pool numbers instead.
+   */
+  struct HeapStats
+  {
+    size_t capacity;      /**< Free bytes the heap had when the context took it over */
+    size_t free;          /**< Free bytes right now */
+    size_t lowWater;      /**< Fewest free bytes ever, so capacity - lowWater is the peak use */
+    size_t largestFree;   /**< Biggest single allocation that would succeed right now */
+    size_t fragmentation; /**< Percent of the free bytes not in the largest block */
+    size_t allocs;        /**< Calls to malloc() */
+    size_t frees;         /**< Calls to free() */
+    size_t failures;      /**< Allocations neither a pool nor the heap could serve */
+    AllocSiteStats site[ ALLOC_NUM_OPTIONS ];
+    PoolStats pool[ POOL_NUM_OPTIONS ];
+  };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Rounds a block size up so every block in a pool stays aligned
+   *
+   *  @param[in]  size        Requested block size
+   *  @return size_t
+   */
+  constexpr size_t poolAlignBlock( const size_t size )
+  {
+    return ( ( size + POOL_ALIGNMENT - 1u ) / POOL_ALIGNMENT ) * POOL_ALIGNMENT;
+  }
+
+  /*-------------------------------------------------------------------------------
+  Pool Sizing
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Each pool is sized for its object plus the shared pointer bookkeeping
+   *  that rides along with it. The total is what a statically placed stack
+   *  has to set aside for the pools.
+   */
+  static constexpr size_t POOL_PAYLOAD_BLOCK  = poolAlignBlock( POOL_PAYLOAD_BYTES + RIPPLE_POOL_BLOCK_OVERHEAD );
+  static constexpr size_t POOL_FRAGMENT_BLOCK = poolAlignBlock( sizeof( Fragment ) + RIPPLE_POOL_BLOCK_OVERHEAD );
+  static constexpr size_t POOL_PACKET_BLOCK   = poolAlignBlock( sizeof( Packet ) + RIPPLE_POOL_BLOCK_OVERHEAD );
+  static constexpr size_t POOL_TOTAL_BYTES    = ( POOL_PAYLOAD_BLOCK * RIPPLE_POOL_PAYLOAD_BLOCKS ) +
+                                             ( POOL_FRAGMENT_BLOCK * RIPPLE_POOL_FRAGMENT_BLOCKS ) +
+                                             ( POOL_PACKET_BLOCK * RIPPLE_POOL_PACKET_BLOCKS );
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Pool of equally sized blocks. Free blocks form a singly linked stack threaded
+   *  through the blocks themselves, so allocate and release are O(1) and only
+   *  need a compare-exchange, never a lock.
+   */
+  class BlockPool
+  {
+  public:
+    BlockPool();
+
+    /**
+     *  Hands the pool its memory
+     *
+     *  @param[in]  memory      Start of the region, word aligned
+     *  @param[in]  blockSize   Bytes in each block, a multiple of the word size
+     *  @param[in]  blocks      Number of blocks in the region
+     *  @return void
+     */
+    void assign( void *const memory, const size_t blockSize, const size_t blocks );
+
+    /**
+     *  Takes a block from the pool
+     *  @return void *          Block, or nullptr if the pool is empty
+     */
+    void *allocate();
+
+    /**
+     *  Returns a block to the pool
+     *
+     *  @param[in]  block       Block previously handed out by allocate()
+     *  @return void
+     */
+    void release( void *const block );
+
+    /**
+     *  Checks if a block came from this pool
+     *
+     *  @param[in]  block       Memory to check
+     *  @return bool
+     */
+    bool owns( const void *const block ) const;
+
+    /**
+     *  Gets the usage of the pool
+     *
+     *  @param[out] stats       Output for the usage data
+     *  @return void
+     */
+    void getStats( PoolStats &stats ) const;
+
+    size_t blockSize() const
+    {
+      return mBlockSize;
+    }
+
+  private:
+    uint8_t *mBase;                   /**< Start of the pool memory */
+    size_t mBlockSize;                /**< Bytes in each block */
+    size_t mBlocks;                   /**< Blocks in the pool */
+    std::atomic<uint32_t> mFreeHead;  /**< First free block in the low half, ABA tag in the high half */
+    std::atomic<uint32_t> mInUse;     /**< Blocks currently handed out */
+    std::atomic<uint32_t> mHighWater; /**< Most blocks ever handed out at once */
+    std::atomic<uint32_t> mMisses;    /**< Requests that found the pool empty */
+  };
+
+
+  /**
+   *  Context heap that serves the small, fixed size allocations behind fragments
+   *  and packets from block pools. The pools are carved once from the heap, so
+   *  the constant churn of these objects can't fragment it. Anything that doesn't
+   *  fit a pool, or arrives while its pool is empty, falls back to the heap.
+   */
+  class PoolHeap : public Aurora::Memory::Heap
+  {
+  public:
+    PoolHeap();
+
+    /**
+     *  Takes over a heap that already owns its memory
+     *
+     *  @param[in]  heap        Heap to take over
+     */
+    explicit PoolHeap( Aurora::Memory::Heap &&heap );
+
+    /**
+     *  Carves the block pools out of the heap, sized by the RIPPLE_POOL_*
+     *  options in config.hpp. Pools that don't fit are left empty.
+     *
+     *  @return bool            True if every pool got its memory
+     */
+    bool initPools();
+
+    /**
+     *  Carves the block pools out of memory outside the heap instead, such as
+     *  a statically placed region. Pools that don't fit are left empty.
+     *
+     *  @param[in]  memory      Start of the region, POOL_ALIGNMENT aligned
+     *  @param[in]  size        Bytes in the region, POOL_TOTAL_BYTES fits every pool
+     *  @return bool            True if every pool got its memory
+     */
+    bool initPools( void *const memory, const size_t size );
+
+    void *malloc( size_t size ) override;
+    void free( void *pv ) override;
+
+    /**
+     *  Gets the usage of a pool
+     *
+     *  @param[in]  pool        Which pool to read
+     *  @param[out] stats       Output for the usage data
+     *  @return void
+     */
+    void getPoolStats( const PoolClass pool, PoolStats &stats ) const;
+
+    /**
+     *  Gets how many allocations have been asked of the heap, pooled or not
+     *  @return size_t
+     */
+    size_t allocs() const
+    {
+      return mAllocs.load( std::memory_order_relaxed );
+    }
+
+    /**
+     *  Gets the heap telemetry. Finding the largest free block probes the
+     *  heap with a handful of allocations, so keep this off the hot path.
+     *
+     *  @note Takes the heap lock
+     *
+     *  @param[out] stats       Output for the telemetry
+     *  @return void
+     */
+    void getHeapStats( HeapStats &stats );
+
+  private:
+    friend class AllocSiteScope;
+
+    /**
+     *  Finds the largest single allocation the heap could serve right now.
+     *  The heap lock must be held.
+     *
+     *  @return size_t
+     */
+    size_t unsafe_largestFree();
+
+    /**
+     *  Hands each pool its memory, taken from the region if there is one and
+     *  from the heap otherwise
+     *
+     *  @param[in]  region      Memory to carve from, nullptr for the heap
+     *  @param[in]  size        Bytes in the region
+     *  @return bool            True if every pool got its memory
+     */
+    bool assignPools( uint8_t *const region, const size_t size );
+
+    /**
+     *  Lowers the low water mark to the current free bytes, if it's higher
+     *  @return void
+     */
+    void updateLowWater();
+
+    /**
+     *  Zeroes the telemetry and takes the current free bytes as the capacity
+     *  @return void
+     */
+    void resetTelemetry();
+
+    BlockPool mPool[ POOL_NUM_OPTIONS ];   /**< Pools for each object class */
+    PoolClass mBySize[ POOL_NUM_OPTIONS ]; /**< Pools ordered from smallest to largest block */
+    std::atomic<uint32_t> mAllocs;         /**< Calls to malloc() since construction */
+    std::atomic<uint32_t> mFrees;          /**< Calls to free() since construction */
+    std::atomic<uint32_t> mFailures;       /**< Allocations nothing could serve */
+    std::atomic<uint32_t> mLowWater;       /**< Fewest free bytes ever */
+    std::atomic<uint8_t> mSite;            /**< AllocSite charged for the next allocations */
+    size_t mCapacity;                      /**< Free bytes at construction */
+
+    std::atomic<uint32_t> mSiteAllocs[ ALLOC_NUM_OPTIONS ];   /**< Allocations per site */
+    std::atomic<uint32_t> mSiteBytes[ ALLOC_NUM_OPTIONS ];    /**< Bytes asked for per site */
+    std::atomic<uint32_t> mSiteFailures[ ALLOC_NUM_OPTIONS ]; /**< Failed allocations per site */
+  };
+
+
+  /**
+   *  Charges every allocation made from a PoolHeap while in scope to one site,
+   *  then puts back whatever site was charged before. Construct it with the
+   *  heap lock held, so other threads can't be charged to the wrong site.
+   */
+  class AllocSiteScope
+  {
+  public:
+    AllocSiteScope( PoolHeap &heap, const AllocSite site );
+    ~AllocSiteScope();
+
+    AllocSiteScope( const AllocSiteScope & ) = delete;
+    AllocSiteScope &operator=( const AllocSiteScope & ) = delete;
+
+  private:
+    PoolHeap &mHeap;
+    uint8_t mPrevious;
+  };
+
+
+  /**
+   *  Heap private to one socket, carved from the context heap when the socket
+   *  is created. Everything the socket queues to send is built here, so a busy
+   *  socket runs out of its own memory instead of starving the others, and its
+   *  allocations never contend for the context heap lock.
+   */
+  class SocketArena : public Aurora::Memory::Heap
+  {
+  public:
+    SocketArena();
+
+    void *malloc( size_t size ) override;
+
+    /**
+     *  Gets how many allocations have failed since the arena was assigned
+     *  @return size_t
+     */
+    size_t misses() const
+    {
+      return mMisses.load( std::memory_order_relaxed );
+    }
+
+    /**
+     *  Gets how many allocations have been asked of the arena
+     *  @return size_t
+     */
+    size_t allocs() const
+    {
+      return mAllocs.load( std::memory_order_relaxed );
+    }
+
+  private:
+    std::atomic<uint32_t> mMisses; /**< Requests the arena couldn't fit */
+    std::atomic<uint32_t> mAllocs; /**< Calls to malloc() since construction */
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_NETSTACK_MEMORY_POOL_HPP */
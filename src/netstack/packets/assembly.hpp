@@ -0,0 +1,329 @@
+/********************************************************************************
+ *  File Name:
+ *    assembly.hpp
+ *
+ *  Description:
+ *    Fixed storage for packets under reassembly, indexed by source and UUID and
+ *    ordered by when they expire
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_PACKET_ASSEMBLY_HPP
+#define RIPPLE_PACKET_ASSEMBLY_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/packets/packet.hpp>
+#include <Ripple/src/shared/cmn_utils.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Set of packet assemblies with O(1) lookup and deadline ordered expiry
+   *
+   * Assemblies live in fixed slots handed out from a free list, so starting and
+   * finishing a packet never allocates or rebalances a tree. A small open hash
+   * maps the sender and UUID to slots, so two nodes that happen to pick the same
+   * UUID don't land in each other's packets. A min-heap keyed on the deadline
+   * keeps the next assembly to expire on top, so expiry only ever touches the
+   * ones that are due.
+   *
+   * @tparam SIZE   Max number of assemblies in progress at once
+   */
+  template<size_t SIZE>
+  class AssemblyTable
+  {
+    static_assert( ( SIZE > 0 ) && ( SIZE < 0xFF ), "Slot indices are stored in a byte" );
+
+  public:
+    AssemblyTable()
+    {
+      reset();
+    }
+
+    /**
+     * @brief Releases every assembly
+     */
+    void reset()
+    {
+      for ( size_t idx = 0; idx < SIZE; idx++ )
+      {
+        mSlots[ idx ].clear();
+        mFree[ idx ] = static_cast<uint8_t>( SIZE - 1u - idx );
+      }
+
+      memset( mIndex, SLOT_EMPTY, sizeof( mIndex ) );
+      mFreeCount = SIZE;
+      mCount     = 0;
+    }
+
+    /**
+     * @brief Looks up the assembly of a packet
+     *
+     * @param source    Sender of the packet, as reported by the netif
+     * @param uuid      Packet to find
+     * @return PacketAssembly*  The assembly, or nullptr if none is in progress
+     */
+    PacketAssembly *find( const IPAddress source, const uint16_t uuid )
+    {
+      for ( size_t bucket = home( source, uuid ); mIndex[ bucket ] != SLOT_EMPTY; bucket = ( bucket + 1u ) & INDEX_MASK )
+      {
+        const PacketAssembly &assembly = mSlots[ mIndex[ bucket ] ];
+        if ( ( assembly.uuid == uuid ) && ( assembly.source == source ) )
+        {
+          return &mSlots[ mIndex[ bucket ] ];
+        }
+      }
+
+      return nullptr;
+    }
+
+    /**
+     * @brief Takes a free slot for a new packet
+     *
+     * @param source    Sender of the packet, as reported by the netif
+     * @param uuid      Packet being assembled. Must not be in the table already.
+     * @param deadline  Time the assembly expires
+     * @return PacketAssembly*  Cleared assembly, or nullptr if the table is full
+     */
+    PacketAssembly *acquire( const IPAddress source, const uint16_t uuid, const size_t deadline )
+    {
+      if ( !mFreeCount )
+      {
+        return nullptr;
+      }
+
+      const uint8_t slot       = mFree[ --mFreeCount ];
+      PacketAssembly &assembly = mSlots[ slot ];
+      assembly.source          = source;
+      assembly.uuid            = uuid;
+      assembly.deadline        = deadline;
+
+      /*-------------------------------------------------
+      Index by source and UUID
+      -------------------------------------------------*/
+      size_t bucket = home( source, uuid );
+      while ( mIndex[ bucket ] != SLOT_EMPTY )
+      {
+        bucket = ( bucket + 1u ) & INDEX_MASK;
+      }
+
+      mIndex[ bucket ] = slot;
+
+      /*-------------------------------------------------
+      Order by deadline
+      -------------------------------------------------*/
+      mHeap[ mCount ]  = slot;
+      mHeapPos[ slot ] = static_cast<uint8_t>( mCount );
+      siftUp( mCount++ );
+
+      return &assembly;
+    }
+
+    /**
+     * @brief Cleans up an assembly and returns its slot to the free list
+     *
+     * @param assembly  Assembly from acquire()
+     */
+    void release( PacketAssembly *const assembly )
+    {
+      const size_t slot = static_cast<size_t>( assembly - mSlots );
+      if ( slot >= SIZE )
+      {
+        return;
+      }
+
+      /*-------------------------------------------------
+      Drop from the index. Entries further along
+      the probe chain shift back to fill the hole, so no
+      tombstones build up.
+      -------------------------------------------------*/
+      size_t hole = home( assembly->source, assembly->uuid );
+      while ( mIndex[ hole ] != slot )
+      {
+        hole = ( hole + 1u ) & INDEX_MASK;
+      }
+
+      for ( size_t next = ( hole + 1u ) & INDEX_MASK; mIndex[ next ] != SLOT_EMPTY; next = ( next + 1u ) & INDEX_MASK )
+      {
+        const size_t ideal = home( mSlots[ mIndex[ next ] ].source, mSlots[ mIndex[ next ] ].uuid );
+        if ( ( ( next - ideal ) & INDEX_MASK ) >= ( ( next - hole ) & INDEX_MASK ) )
+        {
+          mIndex[ hole ] = mIndex[ next ];
+          hole           = next;
+        }
+      }
+
+      mIndex[ hole ] = SLOT_EMPTY;
+
+      /*-------------------------------------------------
+      Drop from the deadline heap by moving the last one
+      into its place
+      -------------------------------------------------*/
+      const size_t pos = mHeapPos[ slot ];
+      mCount--;
+
+      if ( pos != mCount )
+      {
+        mHeap[ pos ]             = mHeap[ mCount ];
+        mHeapPos[ mHeap[ pos ] ] = static_cast<uint8_t>( pos );
+        siftDown( pos );
+        siftUp( pos );
+      }
+
+      assembly->clear();
+      mFree[ mFreeCount++ ] = static_cast<uint8_t>( slot );
+    }
+
+    /**
+     * @brief Gets the assembly closest to expiring, if it is already due
+     *
+     * @param now       Current time
+     * @return PacketAssembly*  Expired assembly, or nullptr if none are due
+     */
+    PacketAssembly *expired( const size_t now )
+    {
+      if ( !mCount || before( now, mSlots[ mHeap[ 0 ] ].deadline ) )
+      {
+        return nullptr;
+      }
+
+      return &mSlots[ mHeap[ 0 ] ];
+    }
+
+    /**
+     * @brief Gets the assembly that expires first
+     *
+     * @return const PacketAssembly*  Assembly, or nullptr if none are in progress
+     */
+    const PacketAssembly *earliest() const
+    {
+      return mCount ? &mSlots[ mHeap[ 0 ] ] : nullptr;
+    }
+
+    /**
+     * @brief Gets an assembly in progress, in no particular order
+     *
+     * @param idx       Index less than size()
+     * @return PacketAssembly*
+     */
+    PacketAssembly *active( const size_t idx )
+    {
+      return ( idx < mCount ) ? &mSlots[ mHeap[ idx ] ] : nullptr;
+    }
+
+    size_t size() const
+    {
+      return mCount;
+    }
+
+    bool full() const
+    {
+      return !mFreeCount;
+    }
+
+    static constexpr size_t capacity()
+    {
+      return SIZE;
+    }
+
+  private:
+    /*-------------------------------------------------
+    Index sizing. Kept at most half full so probe
+    chains stay short.
+    -------------------------------------------------*/
+    static constexpr size_t INDEX_BITS  = hashIndexBits( SIZE );
+    static constexpr size_t INDEX_SIZE  = static_cast<size_t>( 1u ) << INDEX_BITS;
+    static constexpr size_t INDEX_MASK  = INDEX_SIZE - 1u;
+    static constexpr uint8_t SLOT_EMPTY = 0xFF;
+
+    PacketAssembly mSlots[ SIZE ];  /**< Assembly storage */
+    uint8_t mFree[ SIZE ];          /**< Stack of free slots */
+    uint8_t mHeap[ SIZE ];          /**< Active slots as a min-heap on deadline */
+    uint8_t mHeapPos[ SIZE ];       /**< Where each slot sits in the heap */
+    uint8_t mIndex[ INDEX_SIZE ];   /**< Open hash of source and UUID to slot */
+    size_t mFreeCount;              /**< Slots on the free stack */
+    size_t mCount;                  /**< Assemblies in progress */
+
+    /**
+     * @brief Where a packet's probe chain starts in the index
+     */
+    static constexpr size_t home( const IPAddress source, const uint16_t uuid )
+    {
+      return hashIndex16( static_cast<uint16_t>( uuid ^ source ^ ( source >> 16 ) ), INDEX_BITS );
+    }
+
+    /**
+     * @brief Checks if time a comes before time b, allowing for wrap around
+     */
+    static constexpr bool before( const size_t a, const size_t b )
+    {
+      return static_cast<std::make_signed_t<size_t>>( a - b ) < 0;
+    }
+
+    void swap( const size_t a, const size_t b )
+    {
+      const uint8_t tmp = mHeap[ a ];
+      mHeap[ a ]        = mHeap[ b ];
+      mHeap[ b ]        = tmp;
+
+      mHeapPos[ mHeap[ a ] ] = static_cast<uint8_t>( a );
+      mHeapPos[ mHeap[ b ] ] = static_cast<uint8_t>( b );
+    }
+
+    void siftUp( size_t pos )
+    {
+      while ( pos )
+      {
+        const size_t parent = ( pos - 1u ) / 2u;
+        if ( !before( mSlots[ mHeap[ pos ] ].deadline, mSlots[ mHeap[ parent ] ].deadline ) )
+        {
+          break;
+        }
+
+        swap( pos, parent );
+        pos = parent;
+      }
+    }
+
+    void siftDown( size_t pos )
+    {
+      while ( true )
+      {
+        const size_t left  = ( 2u * pos ) + 1u;
+        const size_t right = left + 1u;
+        size_t earliest    = pos;
+
+        if ( ( left < mCount ) && before( mSlots[ mHeap[ left ] ].deadline, mSlots[ mHeap[ earliest ] ].deadline ) )
+        {
+          earliest = left;
+        }
+
+        if ( ( right < mCount ) && before( mSlots[ mHeap[ right ] ].deadline, mSlots[ mHeap[ earliest ] ].deadline ) )
+        {
+          earliest = right;
+        }
+
+        if ( earliest == pos )
+        {
+          break;
+        }
+
+        swap( pos, earliest );
+        pos = earliest;
+      }
+    }
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_PACKET_ASSEMBLY_HPP */
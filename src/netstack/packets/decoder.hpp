@@ -33,6 +33,9 @@
 /* Ripple Includes */
 #include <Ripple/src/user/user_contract.hpp>
 #include <Ripple/src/netstack/packets/packet.hpp>
+#include <Ripple/src/netstack/packets/pb_stream.hpp>
+#include <Ripple/src/netstack/packets/registry.hpp>
+#include <Ripple/src/netstack/packets/view.hpp>
 
 
 namespace Ripple
@@ -45,6 +48,15 @@ namespace Ripple
   /*-------------------------------------------------------------------------------
   Classes
   -------------------------------------------------------------------------------*/
+  /**
+   * @brief Decodes NanoPB generated types straight out of a packet
+   *
+   * The fields are read from the packet's fragments as the decoder asks for
+   * them, so nothing is unpacked into an intermediate buffer first.
+   *
+   * @tparam PacketType     Generated NanoPB type
+   * @tparam EncodedSize    Most encoded bytes to read
+   */
   template<typename PacketType, const size_t EncodedSize>
   class PacketDecoder
   {
@@ -52,27 +64,40 @@ namespace Ripple
 
     bool decode( const Packet_sPtr pkt, PacketType &data, const pb_msgdesc_t* fields )
     {
-      /*-----------------------------------------------------------------
-      Unpack the packet into the stream buffer
-      -----------------------------------------------------------------*/
-      memset( mStreamBuffer, 0, sizeof( mStreamBuffer ) );
-      if( !pkt->unpack( mStreamBuffer, sizeof( mStreamBuffer ) ) )
+      if ( !pkt )
       {
         return false;
       }
 
-      /*-----------------------------------------------------------------
-      Decode the data into the packet type
-      -----------------------------------------------------------------*/
-      pb_istream_t stream = pb_istream_from_buffer( mStreamBuffer, sizeof( mStreamBuffer ) );
-      return pb_decode( &stream, fields, &data );
+      return decode( PacketView( pkt, 0, pkt->size() ), data, fields );
     }
 
-  private:
-    Aurora::Memory::IHeapAllocator *const mContext;
-    uint8_t mStreamBuffer[ EncodedSize ];
+    bool decode( const PacketView &view, PacketType &data, const pb_msgdesc_t *fields )
+    {
+      PacketReader reader = { view, 0 };
+      pb_istream_t stream = pbInputStream( reader, EncodedSize );
+      return pb_decode( &stream, fields, &data );
+    }
   };
 
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Decodes a registered packet type out of the view a handler was lent
+   *
+   * @param view      Payload of the packet, as handed to a PacketViewCallback
+   * @param data      Where to decode to
+   * @return true     The payload decoded
+   * @return false    The payload was malformed
+   */
+  template<typename PacketType>
+  bool decode( const PacketView &view, PacketType &data )
+  {
+    using Traits = PacketTraits<PacketType>;
+    return PacketDecoder<PacketType, Traits::size>().decode( view, data, Traits::fields );
+  }
+
 }  // namespace Ripple
 
 #endif  /* !RIPPLE_PACKET_DECODER_HPP */
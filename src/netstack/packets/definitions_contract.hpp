@@ -13,16 +13,18 @@
 #ifndef RIPPLE_PACKET_DEFINTIONS_CONTRACT_HPP
 #define RIPPLE_PACKET_DEFINTIONS_CONTRACT_HPP
 
-/* ETL Includes */
-#include <etl/map.h>
-
 /* Ripple Includes */
 #include <Ripple/src/netstack/packets/types.hpp>
 #include "ripple_packet_contract_prj.hpp"
 
 namespace Ripple
 {
-  extern etl::map<PacketId, PacketDef, RIPPLE_MAX_NUM_PKTS> PacketDefinitions;
+  /**
+   *  Project packet definitions, indexed by packet ID. IDs are dense and run
+   *  from zero to RIPPLE_MAX_NUM_PKTS - 1. Unused IDs leave their entry's
+   *  fields descriptor null.
+   */
+  extern const PacketDef PacketDefinitions[ RIPPLE_MAX_NUM_PKTS ];
 }  // namespace Ripple
 
 #endif  /* !RIPPLE_PACKET_DEFINTIONS_CONTRACT_HPP */
@@ -11,63 +11,75 @@
 /* Chimera Includes */
 #include <Chimera/common>
 
-/* ETL Includes */
-#include <etl/crc32.h>
-
 /* Project Includes */
 #include <Ripple/netstack>
 
 
 namespace Ripple::Transport
 {
+  /*-------------------------------------------------------------------------------
+  Static Assertions
+  -------------------------------------------------------------------------------*/
+  static_assert( offsetof( TransportHeader, crc ) == 0 );
+  static_assert( offsetof( TransportHeader, dstPort ) == PACKET_CRC_BYTES );
+
   /*-------------------------------------------------------------------------------
   Public Functions
   -------------------------------------------------------------------------------*/
-  Packet_sPtr constructPacket( Aurora::Memory::IHeapAllocator *const context, const TransportHeader &header, const void *const data, const size_t bytes )
+  Packet_sPtr constructPacket( Aurora::Memory::IHeapAllocator *const context, const TransportHeader &header,
+                               const void *const data, const size_t bytes, const size_t fragmentSize,
+                               const size_t unfragmentedSize, const uint8_t parityFragments, const size_t maxFragments )
   {
     /*-----------------------------------------------------------------
     Input protection
     -----------------------------------------------------------------*/
-    if ( !context || !data || !bytes )
+    if ( !data )
     {
       return Packet_sPtr();
     }
 
-    /*-----------------------------------------------------------------
-    Ensure exclusive access to the context manager
-    -----------------------------------------------------------------*/
-    Chimera::Thread::LockGuard lck( *context );
+    PacketCopy source = { data, bytes };
+    return constructPacket( context, header, source.filler(), bytes, fragmentSize, unfragmentedSize, parityFragments,
+                            maxFragments );
+  }
 
+
+  Packet_sPtr constructPacket( Aurora::Memory::IHeapAllocator *const context, const TransportHeader &header,
+                               const PacketFiller &filler, const size_t bytes, const size_t fragmentSize,
+                               const size_t unfragmentedSize, const uint8_t parityFragments, const size_t maxFragments )
+  {
     /*-----------------------------------------------------------------
-    Build the full packet in some scratch memory
+    Input protection
     -----------------------------------------------------------------*/
-    const size_t allocationSize = bytes + sizeof( TransportHeader );
-    uint8_t *scratch            = reinterpret_cast<uint8_t *>( context->malloc( allocationSize ) );
-
-    memset( scratch, 0, allocationSize );
-    memcpy( scratch, &header, sizeof( TransportHeader ) );
-    memcpy( scratch + sizeof( TransportHeader ), data, bytes );
+    if ( !context || !filler.is_valid() || !bytes )
+    {
+      return Packet_sPtr();
+    }
 
     /*-----------------------------------------------------------------
-    Add the CRC to the packet header
+    Ensure exclusive access to the context manager
     -----------------------------------------------------------------*/
-    etl::crc32 crc_gen;
-    crc_gen.reset();
-    crc_gen.add( scratch + offsetof( TransportHeader, dstPort ), scratch + allocationSize );
-
-    auto hdr_ptr = reinterpret_cast<TransportHeader *>( scratch );
-    hdr_ptr->crc = crc_gen.value();
+    Chimera::Thread::LockGuard lck( *context );
 
     /*-----------------------------------------------------------------
-    Pack the scratch memory into a newly created packet
+    Gather the header and payload straight into the packet. The CRC
+    field leads the header, so the packet fills it in while copying.
+    It covers the rest of the header, then the payload.
     -----------------------------------------------------------------*/
     Packet_sPtr pkt = allocPacket( context );
-    pkt->pack( scratch, allocationSize );
+    if ( !pkt )
+    {
+      return Packet_sPtr();
+    }
 
-    /*-----------------------------------------------------------------
-    Free the scratch memory now that we're done with it
-    -----------------------------------------------------------------*/
-    context->free( scratch );
+    pkt->setFragmentation( fragmentSize, unfragmentedSize, maxFragments );
+    pkt->setParity( parityFragments );
+    pkt->setChecksum( true );
+
+    if ( !pkt->pack( &header, sizeof( TransportHeader ), filler, bytes ) )
+    {
+      return Packet_sPtr();
+    }
 
     return pkt;
   }
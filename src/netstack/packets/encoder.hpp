@@ -48,10 +48,34 @@ namespace Ripple
      * @param header          Transport layer header to attach
      * @param data            Raw data payload
      * @param bytes           Size of raw data payload
+     * @param fragmentSize    Bytes per fragment when fragmenting, zero for the default
+     * @param unfragmentedSize  Largest packet that is left as a single fragment
+     * @param parityFragments Parity fragments added when fragmenting
+     * @param maxFragments    Most fragments the netif can carry, zero for FRAG_MAX_PER_PACKET
      * @return Packet_sPtr    Fully constructed packet
      */
     Packet_sPtr constructPacket( Aurora::Memory::IHeapAllocator *const context, const TransportHeader &header,
-                                 const void *const data, const size_t bytes );
+                                 const void *const data, const size_t bytes, const size_t fragmentSize = 0,
+                                 const size_t unfragmentedSize = 0, const uint8_t parityFragments = 0,
+                                 const size_t maxFragments = 0 );
+
+    /**
+     * @brief Builds a transport layer packet whose payload is produced in place
+     *
+     * @param context         Memory context to allocate from
+     * @param header          Transport layer header to attach
+     * @param filler          Writes exactly bytes of payload into the packet
+     * @param bytes           Size of the payload
+     * @param fragmentSize    Bytes per fragment when fragmenting, zero for the default
+     * @param unfragmentedSize  Largest packet that is left as a single fragment
+     * @param parityFragments Parity fragments added when fragmenting
+     * @param maxFragments    Most fragments the netif can carry, zero for FRAG_MAX_PER_PACKET
+     * @return Packet_sPtr    Fully constructed packet
+     */
+    Packet_sPtr constructPacket( Aurora::Memory::IHeapAllocator *const context, const TransportHeader &header,
+                                 const PacketFiller &filler, const size_t bytes, const size_t fragmentSize = 0,
+                                 const size_t unfragmentedSize = 0, const uint8_t parityFragments = 0,
+                                 const size_t maxFragments = 0 );
   }    // namespace Transport
 
   /*-------------------------------------------------------------------------------
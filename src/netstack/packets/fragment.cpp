@@ -138,7 +138,10 @@ namespace Ripple
   Fragment_sPtr allocFragment( Aurora::Memory::IHeapAllocator *const context, const size_t payload_bytes )
   {
     Fragment_sPtr local( context );
-    local->data = Aurora::Memory::shared_ptr<void *>( context, payload_bytes );
+    local->data   = Aurora::Memory::shared_ptr<void *>( context, payload_bytes );
+    local->offset = 0;
+    local->parity = 0;
+    local->source = 0;
 
     return local;
   }
@@ -186,31 +189,40 @@ namespace Ripple
 
 
   /**
-   * @brief Copies a fragment into freshly allocated memory.
+   * @brief Makes a new, unlinked fragment that views the same payload memory.
    *
    * @param context       Memory context
    * @param fragment      Fragment being copied
-   * @return Fragment_sPtr
+   * @return Fragment_sPtr  Empty if out of memory
    */
   Fragment_sPtr fragmentShallowCopy( Aurora::Memory::IHeapAllocator *const context, const Fragment_sPtr &fragment )
   {
+    if ( !context || !fragment )
+    {
+      return Fragment_sPtr();
+    }
+
     /*-------------------------------------------------
-    Allocate a new fragment
+    Allocate a new fragment control structure only
     -------------------------------------------------*/
-    auto newFrag = allocFragment( context, fragment->length );
+    Fragment_sPtr newFrag( context );
+    if ( !newFrag )
+    {
+      return Fragment_sPtr();
+    }
 
     /*-------------------------------------------------
-    Copy over the old fragment data, but discard links
+    Share the payload, but discard links
     -------------------------------------------------*/
     newFrag->next   = Fragment_sPtr();
+    newFrag->data   = fragment->data;
+    newFrag->offset = fragment->offset;
     newFrag->length = fragment->length;
     newFrag->number = fragment->number;
     newFrag->uuid   = fragment->uuid;
     newFrag->total  = fragment->total;
-
-    void **dst = newFrag->data.get();
-    void **src = fragment->data.get();
-    memcpy( *dst, *src, fragment->length );
+    newFrag->parity = fragment->parity;
+    newFrag->source = fragment->source;
 
     return newFrag;
   }
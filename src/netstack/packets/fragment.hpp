@@ -12,11 +12,54 @@
 #ifndef RIPPLE_FRAGMENT_TYPE_HPP
 #define RIPPLE_FRAGMENT_TYPE_HPP
 
+/* STL Includes */
+#include <cstdint>
+#include <limits>
+
 /* Aurora Includes  */
 #include <Aurora/memory>
 
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_types.hpp>
+
 namespace Ripple
 {
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  /**
+   *  UUIDs below this value are never generated for packets. A network interface
+   *  that only carries the low bits of a UUID on the wire can map them in here,
+   *  without colliding with a full UUID still being assembled.
+   */
+  static constexpr uint16_t FRAG_UUID_RESERVED = 32;
+
+  /**
+   *  Max fragments, parity included, that a single packet may be split into.
+   *  Network interfaces may support fewer, see INetIf::maxNumFragments().
+   */
+  static constexpr size_t FRAG_MAX_PER_PACKET = 64;
+
+  /*-------------------------------------------------------------------------------
+  Aliases
+  -------------------------------------------------------------------------------*/
+  /**
+   *  One bit per fragment of a packet, bit N for fragment number N
+   */
+  using FragmentMask = uint64_t;
+  static_assert( FRAG_MAX_PER_PACKET <= std::numeric_limits<FragmentMask>::digits );
+
+  /**
+   *  Max parity fragments that can be added to a single packet
+   */
+  static constexpr uint8_t FRAG_MAX_PARITY = 7;
+
+  /**
+   *  Bytes at the front of a parity fragment's payload, ahead of the parity
+   *  data itself. Holds the length of the packet's last data fragment.
+   */
+  static constexpr size_t FRAG_PARITY_HEADER = 1;
+
   /*-------------------------------------------------------------------------------
   Classes
   -------------------------------------------------------------------------------*/
@@ -25,9 +68,9 @@ namespace Ripple
    *
    * Utilizes a list structure to allow non-contiguous memory and dynamically
    * building a packet at runtime. Each fragment represents a single piece of
-   * a full packet. The fragment's memory is dynamically allocated inside of
-   * the network context manager and its lifetime is controlled via reference
-   * counting.
+   * a full packet. The payload memory is dynamically allocated inside of the
+   * network context manager and its lifetime is controlled via reference
+   * counting. Fragments of a packet built locally are views into one buffer.
    *
    * @warning If updating fields, please update fragmentShallowCopy() as well.
    */
@@ -35,11 +78,24 @@ namespace Ripple
   {
   public:
     Aurora::Memory::shared_ptr<Fragment> next; /**< Next fragment */
-    Aurora::Memory::shared_ptr<void *> data;   /**< Allocated memory for this fragment */
+    Aurora::Memory::shared_ptr<void *> data;   /**< Memory holding the payload, possibly shared with other fragments */
+    uint16_t offset;                           /**< Where the payload starts inside of data */
     uint16_t length;                           /**< Length of the current fragment */
     uint16_t number;                           /**< Which fragment number this is, zero indexed */
     uint16_t total;                            /**< Total number of fragments */
     uint16_t uuid;                             /**< Unique ID for the fragment */
+    uint8_t parity;                            /**< Parity fragments at the end of the packet, counted in total */
+    IPAddress source;                          /**< Sender as far as the netif can tell, zero if it can't */
+
+    /**
+     * @brief Gets the start of this fragment's payload
+     *
+     * @return uint8_t*
+     */
+    uint8_t *payload() const
+    {
+      return reinterpret_cast<uint8_t *>( *data.get() ) + offset;
+    }
   };
 
   /*-------------------------------------------------------------------------------
@@ -14,7 +14,7 @@ Includes
 -----------------------------------------------------------------------------*/
 #include <Aurora/logging>
 #include <Ripple/netstack>
-#include <etl/random.h>
+#include <atomic>
 #include <limits>
 #include <utility>
 
@@ -31,39 +31,338 @@ namespace Ripple
   Constants
   ---------------------------------------------------------------------------*/
   static constexpr size_t DFLT_FRAG_SIZE = 24;
-  static constexpr size_t MAX_NUM_FRAGS  = 32;
+  static constexpr size_t MAX_NUM_FRAGS  = FRAG_MAX_PER_PACKET;
+  static constexpr size_t UUID_RANGE     = std::numeric_limits<uint16_t>::max() + 1u - FRAG_UUID_RESERVED;
 
 
   /*---------------------------------------------------------------------------
-  Static Data
+  Static Functions
   ---------------------------------------------------------------------------*/
-  static etl::random_xorshift s_rng;
+  /**
+   * @brief Gets a mask with a bit set for each of the first count fragments
+   *
+   * @param count     Fragments to cover
+   * @return FragmentMask
+   */
+  static constexpr FragmentMask fragmentMask( const size_t count )
+  {
+    constexpr size_t bits = std::numeric_limits<FragmentMask>::digits;
+    return ( count >= bits ) ? std::numeric_limits<FragmentMask>::max() : ( ( static_cast<FragmentMask>( 1u ) << count ) - 1u );
+  }
+
+
+  /**
+   * @brief Counter the packet UUIDs of this node are drawn from
+   *
+   * The count starts from the clock so a reboot doesn't reuse recent UUIDs.
+   *
+   * @return std::atomic<uint32_t>&
+   */
+  static std::atomic<uint32_t> &uuidSequence()
+  {
+    static std::atomic<uint32_t> s_sequence( static_cast<uint32_t>( Chimera::micros() ) );
+    return s_sequence;
+  }
+
+
+  /**
+   * @brief Hands out the UUID of the next packet built on this node
+   *
+   * Receivers key reassembly on the sender as well as the UUID where the netif
+   * can say who sent a fragment. Counting through the range keeps packets from
+   * the same node apart until it wraps, which random picks could not promise.
+   *
+   * @return uint16_t
+   */
+  static uint16_t nextUUID()
+  {
+    const uint32_t count = uuidSequence().fetch_add( 1u, std::memory_order_relaxed );
+    return static_cast<uint16_t>( FRAG_UUID_RESERVED + ( count % UUID_RANGE ) );
+  }
 
 
   /*---------------------------------------------------------------------------
   Public Functions
   ---------------------------------------------------------------------------*/
+  void seedPacketUUID( const uint32_t nodeId )
+  {
+    /*-------------------------------------------------------------------------
+    Not every netif can tell receivers who sent a fragment, and then only the
+    UUID keeps two senders apart. Nodes that boot in step would count through
+    the same UUIDs, so spread them out by a hash of something unique to each.
+    -------------------------------------------------------------------------*/
+    uuidSequence().fetch_add( nodeId * 2654435761u, std::memory_order_relaxed );
+  }
+
+
   Packet_sPtr allocPacket( Aurora::Memory::IHeapAllocator *const context )
   {
-    s_rng.initialise( Chimera::millis() );
+    if ( !context )
+    {
+      return Packet_sPtr();
+    }
 
     Packet_sPtr local = Packet_sPtr( context );
-    local->mContext   = context;
+    if ( local )
+    {
+      local->mContext = context;
+    }
 
     return local;
   }
 
 
   /*---------------------------------------------------------------------------
-  Classes
+  PacketAssembly Class
+  ---------------------------------------------------------------------------*/
+  bool PacketAssembly::begin( Aurora::Memory::IHeapAllocator *const context, const Fragment_sPtr &fragment,
+                              const size_t maxLength )
+  {
+    /*-------------------------------------------------------------------------
+    Input Protection
+    -------------------------------------------------------------------------*/
+    if ( !context || !fragment || !fragment->total || ( fragment->total > MAX_NUM_FRAGS ) ||
+         ( fragment->parity >= fragment->total ) || !maxLength ||
+         ( maxLength > std::numeric_limits<uint8_t>::max() ) )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Reserve a slot for every fragment. The finished packet is handed up in this
+    same memory, so no other copy is made.
+    -------------------------------------------------------------------------*/
+    buffer = allocFragment( context, fragment->total * maxLength );
+    if ( !buffer )
+    {
+      return false;
+    }
+
+    buffer->next   = Fragment_sPtr();
+    buffer->length = 0;
+    buffer->number = 0;
+    buffer->total  = fragment->total;
+    buffer->uuid   = fragment->uuid;
+    buffer->parity = fragment->parity;
+    buffer->source = fragment->source;
+
+    rxBitmap    = 0;
+    slotSize    = static_cast<uint16_t>( maxLength );
+    source      = fragment->source;
+    uuid        = fragment->uuid;
+    totalFrags  = fragment->total;
+    parityFrags = fragment->parity;
+    crcNext     = 0;
+    crcValid    = false;
+    crc.reset();
+    memset( slotLength, 0, sizeof( slotLength ) );
+
+    return insert( fragment );
+  }
+
+
+  bool PacketAssembly::insert( const Fragment_sPtr &fragment )
+  {
+    /*-------------------------------------------------------------------------
+    Input Protection. A fragment out of step with the first one can't be from
+    the same packet.
+    -------------------------------------------------------------------------*/
+    if ( !buffer || !fragment || ( fragment->uuid != uuid ) || ( fragment->source != source ) ||
+         ( fragment->total != totalFrags ) || ( fragment->number >= totalFrags ) || ( fragment->length > slotSize ) )
+    {
+      return false;
+    }
+
+    const FragmentMask bit = static_cast<FragmentMask>( 1u ) << fragment->number;
+    if ( rxBitmap & bit )
+    {
+      LOG_ERROR_IF( DEBUG_MODULE, "Got duplicate fragment %d for UUID %d \r\n", fragment->number, uuid );
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Drop the payload straight into its slot
+    -------------------------------------------------------------------------*/
+    uint8_t *slot = buffer->payload() + ( fragment->number * slotSize );
+    memcpy( slot, fragment->payload(), fragment->length );
+
+    slotLength[ fragment->number ] = static_cast<uint8_t>( fragment->length );
+    rxBitmap |= bit;
+
+    advanceCRC();
+    return true;
+  }
+
+
+  bool PacketAssembly::complete()
+  {
+    /*-------------------------------------------------------------------------
+    Input Protection
+    -------------------------------------------------------------------------*/
+    if ( !buffer || !packet )
+    {
+      return false;
+    }
+
+    const size_t dataFrags      = totalFrags - parityFrags;
+    const FragmentMask dataMask = fragmentMask( dataFrags );
+    uint8_t *const base         = buffer->payload();
+
+    /*-------------------------------------------------------------------------
+    Rebuild each missing data fragment whose parity group is otherwise whole.
+    Parity fragment N covers every Nth data fragment.
+    -------------------------------------------------------------------------*/
+    for ( size_t missing = 0; parityFrags && ( ( rxBitmap & dataMask ) != dataMask ) && ( missing < dataFrags ); missing++ )
+    {
+      const size_t parityIdx = dataFrags + ( missing % parityFrags );
+      if ( ( ( rxBitmap >> missing ) & 0x1 ) || !( ( rxBitmap >> parityIdx ) & 0x1 ) ||
+           ( slotLength[ parityIdx ] <= FRAG_PARITY_HEADER ) )
+      {
+        continue;
+      }
+
+      bool groupWhole = true;
+      for ( size_t idx = missing % parityFrags; idx < dataFrags; idx += parityFrags )
+      {
+        if ( ( idx != missing ) && !( ( rxBitmap >> idx ) & 0x1 ) )
+        {
+          groupWhole = false;
+          break;
+        }
+      }
+
+      if ( !groupWhole )
+      {
+        continue;
+      }
+
+      const uint8_t *parityData = base + ( parityIdx * slotSize );
+      const size_t chunkSize    = slotLength[ parityIdx ] - FRAG_PARITY_HEADER;
+      const size_t rebuiltLen   = ( missing == ( dataFrags - 1u ) ) ? parityData[ 0 ] : chunkSize;
+      if ( rebuiltLen > chunkSize )
+      {
+        return false;
+      }
+
+      uint8_t *dst = base + ( missing * slotSize );
+      memcpy( dst, parityData + FRAG_PARITY_HEADER, rebuiltLen );
+
+      for ( size_t idx = missing % parityFrags; idx < dataFrags; idx += parityFrags )
+      {
+        if ( idx == missing )
+        {
+          continue;
+        }
+
+        const uint8_t *data = base + ( idx * slotSize );
+        for ( size_t byte = 0; ( byte < slotLength[ idx ] ) && ( byte < rebuiltLen ); byte++ )
+        {
+          dst[ byte ] ^= data[ byte ];
+        }
+      }
+
+      slotLength[ missing ] = static_cast<uint8_t>( rebuiltLen );
+      rxBitmap |= ( static_cast<FragmentMask>( 1u ) << missing );
+    }
+
+    if ( ( rxBitmap & dataMask ) != dataMask )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Pick up any slots the CRC couldn't reach yet, rebuilt ones included, then
+    check it against the one the sender stored up front.
+    -------------------------------------------------------------------------*/
+    advanceCRC();
+
+    uint32_t expectedCRC = 0;
+    if ( slotLength[ 0 ] >= PACKET_CRC_BYTES )
+    {
+      memcpy( &expectedCRC, base, PACKET_CRC_BYTES );
+    }
+
+    crcValid = ( slotLength[ 0 ] >= PACKET_CRC_BYTES ) && ( crcNext == dataFrags ) && ( crc.value() == expectedCRC );
+
+    /*-------------------------------------------------------------------------
+    Every data fragment is here. Close the gaps left by short slots and hand
+    the buffer to the packet as one fragment, as if it had never been split.
+    Full slots ahead of the first short one are already in place.
+    -------------------------------------------------------------------------*/
+    size_t length = 0;
+    for ( size_t idx = 0; idx < dataFrags; idx++ )
+    {
+      if ( length != ( idx * slotSize ) )
+      {
+        memmove( base + length, base + ( idx * slotSize ), slotLength[ idx ] );
+      }
+
+      length += slotLength[ idx ];
+    }
+
+    buffer->length = static_cast<uint16_t>( length );
+    buffer->total  = 1;
+    buffer->parity = 0;
+
+    packet->head = buffer;
+    buffer       = Fragment_sPtr();
+    return true;
+  }
+
+
+  FragmentMask PacketAssembly::missingFragments() const
+  {
+    return buffer ? ( fragmentMask( totalFrags ) & ~rxBitmap ) : 0;
+  }
+
+
+  void PacketAssembly::advanceCRC()
+  {
+    if ( !buffer )
+    {
+      return;
+    }
+
+    const size_t dataFrags = totalFrags - parityFrags;
+    const uint8_t *base    = buffer->payload();
+
+    while ( ( crcNext < dataFrags ) && ( ( rxBitmap >> crcNext ) & 0x1 ) )
+    {
+      const uint8_t *slot = base + ( crcNext * slotSize );
+      const size_t skip   = ( crcNext == 0 ) ? std::min<size_t>( slotLength[ 0 ], PACKET_CRC_BYTES ) : 0;
+
+      crc.add( slot + skip, slotLength[ crcNext ] - skip );
+      crcNext++;
+    }
+  }
+
+
+  const void *PacketAssembly::fragmentData( const size_t number, size_t &length ) const
+  {
+    if ( !buffer || ( number >= totalFrags ) || !( ( rxBitmap >> number ) & 0x1 ) )
+    {
+      length = 0;
+      return nullptr;
+    }
+
+    length = slotLength[ number ];
+    return buffer->payload() + ( number * slotSize );
+  }
+
+
+  /*---------------------------------------------------------------------------
+  Packet Class
   ---------------------------------------------------------------------------*/
-  Packet::Packet() : mContext( nullptr ), mFragmentationSize( DFLT_FRAG_SIZE ), mTotalFragments( 0 )
+  Packet::Packet() :
+      timestamp_us( 0 ), mContext( nullptr ), mFragmentationSize( DFLT_FRAG_SIZE ), mUnfragmentedSize( DFLT_FRAG_SIZE ),
+      mMaxFragments( MAX_NUM_FRAGS ), mTotalFragments( 0 ), mParityFragments( 0 ), mChecksum( false )
   {
   }
 
 
   Packet::Packet( Aurora::Memory::IHeapAllocator *const context ) :
-      mContext( context ), mFragmentationSize( DFLT_FRAG_SIZE ), mTotalFragments( 0 )
+      timestamp_us( 0 ), mContext( context ), mFragmentationSize( DFLT_FRAG_SIZE ), mUnfragmentedSize( DFLT_FRAG_SIZE ),
+      mMaxFragments( MAX_NUM_FRAGS ), mTotalFragments( 0 ), mParityFragments( 0 ), mChecksum( false )
   {
   }
 
@@ -79,44 +378,119 @@ namespace Ripple
   }
 
 
+  void Packet::setFragmentation( const size_t fragmentSize, const size_t unfragmentedSize, const size_t maxFragments )
+  {
+    if ( fragmentSize )
+    {
+      mFragmentationSize = fragmentSize;
+    }
+
+    mUnfragmentedSize = std::max( unfragmentedSize, mFragmentationSize );
+    mMaxFragments     = maxFragments ? std::min( maxFragments, MAX_NUM_FRAGS ) : MAX_NUM_FRAGS;
+  }
+
+
+  void Packet::setParity( const uint8_t parityFragments )
+  {
+    mParityFragments = std::min( parityFragments, FRAG_MAX_PARITY );
+  }
+
+
+  void Packet::setChecksum( const bool enable )
+  {
+    mChecksum = enable;
+  }
+
+
   bool Packet::pack( const void *const buffer, const size_t size )
+  {
+    return pack( nullptr, 0, buffer, size );
+  }
+
+
+  bool Packet::pack( const void *const prefix, const size_t prefixSize, const void *const buffer, const size_t size )
+  {
+    if ( size && !buffer )
+    {
+      return false;
+    }
+
+    PacketCopy source = { buffer, size };
+    return pack( prefix, prefixSize, source.filler(), size );
+  }
+
+
+  bool Packet::pack( const void *const prefix, const size_t prefixSize, const PacketFiller &filler, const size_t size )
   {
+    /*-------------------------------------------------------------------------------
+    Input Protection
+    -------------------------------------------------------------------------------*/
+    if ( ( prefixSize && !prefix ) || !filler.is_valid() || !( prefixSize + size ) ||
+         ( mChecksum && ( ( prefixSize + size ) < PACKET_CRC_BYTES ) ) )
+    {
+      return false;
+    }
+
     /*-------------------------------------------------------------------------------
     Determine transfer fragmentation sizing/boundaries
     -------------------------------------------------------------------------------*/
-    mTotalFragments         = 0; /**< Total fragments to be sent */
-    size_t lastFragmentSize = 0; /**< Track remainder payload in last non-full fragment */
+    const size_t totalSize  = prefixSize + size;  /**< Bytes of packet data, prefix included */
+    mTotalFragments         = 0;                  /**< Total fragments to be sent */
+    size_t lastFragmentSize = 0;                  /**< Track remainder payload in last non-full fragment */
+    size_t chunkSize        = mFragmentationSize; /**< Payload of each full data fragment */
+    uint8_t parityFrags     = 0;                  /**< Parity fragments added at the end */
 
-    if ( size <= mFragmentationSize )
+    if ( totalSize <= mUnfragmentedSize )
     {
       /*-------------------------------------------------
-      Single "fragment" lte to the reported fragment size
+      Single "fragment", which may be larger than a piece
+      of a fragmented packet if the link header shrinks.
       -------------------------------------------------*/
       mTotalFragments  = 1;
-      lastFragmentSize = size;
+      lastFragmentSize = totalSize;
     }
     else
     {
       /*-------------------------------------------------
-      Multiple fragments, possibly not aligned
+      Multiple fragments, possibly not aligned. Parity
+      fragments have a small header, so the data ones
+      shrink to match when parity is enabled.
       -------------------------------------------------*/
-      mTotalFragments  = size / mFragmentationSize;
-      lastFragmentSize = size % mFragmentationSize;
+      if ( mParityFragments && ( mFragmentationSize > FRAG_PARITY_HEADER ) )
+      {
+        chunkSize -= FRAG_PARITY_HEADER;
+      }
+
+      mTotalFragments  = totalSize / chunkSize;
+      lastFragmentSize = totalSize % chunkSize;
 
       if ( lastFragmentSize != 0 )
       {
         mTotalFragments += 1u;
       }
+      else
+      {
+        lastFragmentSize = chunkSize;
+      }
+
+      if ( chunkSize != mFragmentationSize )
+      {
+        parityFrags = std::min<size_t>( mParityFragments, mTotalFragments );
+      }
     }
 
+    const size_t dataFragments = mTotalFragments;
+    const size_t parityStride  = FRAG_PARITY_HEADER + chunkSize;
+    mTotalFragments += parityFrags;
+
     /*-------------------------------------------------
     Check that the number of fragments are supported by
     the underlying network interface.
     -------------------------------------------------*/
-    if ( mTotalFragments > MAX_NUM_FRAGS )    // TODO: Redirect to the current netif
+    if ( mTotalFragments > mMaxFragments )
     {
-      LOG_ERROR( "Packet too large. NetIf only supports %d fragments, but %d are needed.\r\n", MAX_NUM_FRAGS, mTotalFragments );
-      return Chimera::Status::NOT_SUPPORTED;
+      LOG_ERROR( "Packet too large. NetIf only supports %d fragments, but %d are needed.\r\n", mMaxFragments, mTotalFragments );
+      return false;
     }
 
     /*-------------------------------------------------------------------------------
@@ -132,62 +506,124 @@ namespace Ripple
     /*-------------------------------------------------
     Calculate the expected memory consumption:
 
-        User payload data
-      + Payload for first fragment
+        Packet data
+      + Parity fragment payloads
       + Total num fragment structures
       --------------------------------------
       = allocation Size
     -------------------------------------------------*/
-    const size_t allocationSize = size + ( Fragment_sPtr().size() * mTotalFragments );
+    const size_t dataSize       = totalSize + ( parityFrags * parityStride );
+    const size_t allocationSize = dataSize + ( Fragment_sPtr().size() * mTotalFragments );
     if ( freeMem <= allocationSize )
     {
+      /*-------------------------------------------------
+      Still put the request to the heap, so one that
+      counts failed allocations sees this one too
+      -------------------------------------------------*/
+      void *probe = mContext->malloc( allocationSize );
+      if ( probe )
+      {
+        mContext->free( probe );
+      }
+
       LOG_DEBUG( "Out of memory. Tried to allocate %d bytes from remaining %d\r\n", allocationSize, freeMem );
-      return Chimera::Status::MEMORY;
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------------
+    Gather the data into one buffer shared by every fragment. Each fragment is only
+    a view of its piece, so the data is written exactly once, with the CRC computed
+    along the way. It has to be in place before parity covers it. Anything landing
+    in the CRC bytes is left out of it.
+    -------------------------------------------------------------------------------*/
+    Aurora::Memory::shared_ptr<void *> storage( mContext, dataSize );
+    uint8_t *const base = reinterpret_cast<uint8_t *>( *storage.get() );
+
+    CRC32 crc;
+    PacketWriter writer( base, totalSize, mChecksum ? &crc : nullptr, PACKET_CRC_BYTES );
+
+    if ( !writer.write( prefix, prefixSize ) || !filler( writer ) || writer.remaining() )
+    {
+      LOG_DEBUG( "Packet filler wrote %d of %d bytes\r\n", writer.written(), totalSize );
+      return false;
+    }
+
+    if ( mChecksum )
+    {
+      const uint32_t value = crc.value();
+      memcpy( base, &value, PACKET_CRC_BYTES );
     }
 
     /*-------------------------------------------------------------------------------
-    Construct the fragment list from user data
+    Construct the fragment list over the shared buffer
     -------------------------------------------------------------------------------*/
-    size_t bytesLeft          = size; /**< Bytes to pack into fragments */
-    size_t dataOffset         = 0;    /**< Byte offset into the user data */
-    const uint16_t randomUUID = s_rng() % std::numeric_limits<uint16_t>::max();
+    const uint16_t packetUUID = nextUUID();
 
-    for ( size_t fragCnt = 0; fragCnt < mTotalFragments; fragCnt++ )
+    for ( size_t fragCnt = mTotalFragments; fragCnt-- > 0; )
     {
       /*-------------------------------------------------
-      Determine how many bytes to allocate
+      Locate the fragment's piece of the buffer
       -------------------------------------------------*/
-      const size_t fragmentDataSize = std::min( bytesLeft, mFragmentationSize );
+      const bool isParity = ( fragCnt >= dataFragments );
+      size_t fragmentDataSize;
+      size_t fragmentOffset;
+
+      if ( isParity )
+      {
+        fragmentDataSize = parityStride;
+        fragmentOffset   = totalSize + ( ( fragCnt - dataFragments ) * parityStride );
+      }
+      else
+      {
+        fragmentDataSize = ( fragCnt == ( dataFragments - 1u ) ) ? lastFragmentSize : chunkSize;
+        fragmentOffset   = fragCnt * chunkSize;
+      }
 
       /*-------------------------------------------------
-      Allocate a new fragment
+      Allocate a new fragment view
       -------------------------------------------------*/
-      auto newFrag    = allocFragment( mContext, fragmentDataSize );
+      Fragment_sPtr newFrag( mContext );
+      newFrag->data   = storage;
+      newFrag->offset = fragmentOffset;
       newFrag->length = fragmentDataSize;
-      newFrag->uuid   = randomUUID;
+      newFrag->uuid   = packetUUID;
       newFrag->number = fragCnt;
       newFrag->total  = mTotalFragments;
+      newFrag->parity = parityFrags;
+      newFrag->source = 0;
 
-      void **data_buffer = newFrag->data.get();
-      memcpy( *( data_buffer ), ( reinterpret_cast<const uint8_t *const>( buffer ) + dataOffset ), fragmentDataSize );
+      if ( isParity )
+      {
+        /*-------------------------------------------------
+        Parity fragment N covers every Nth data fragment,
+        so a burst of losses spreads over several of them.
+        -------------------------------------------------*/
+        uint8_t *dst = newFrag->payload();
+        memset( dst, 0, fragmentDataSize );
+        dst[ 0 ] = static_cast<uint8_t>( lastFragmentSize );
+
+        for ( size_t dataIdx = fragCnt - dataFragments; dataIdx < dataFragments; dataIdx += parityFrags )
+        {
+          const size_t dataLen = ( dataIdx == ( dataFragments - 1u ) ) ? lastFragmentSize : chunkSize;
+          const uint8_t *data  = base + ( dataIdx * chunkSize );
+
+          for ( size_t byte = 0; byte < dataLen; byte++ )
+          {
+            dst[ FRAG_PARITY_HEADER + byte ] ^= data[ byte ];
+          }
+        }
+      }
 
       /*-------------------------------------------------
-      Insert the packet into the list
+      Insert the fragment into the list. Building it from
+      the back leaves it sorted.
       -------------------------------------------------*/
       Fragment_sPtr previousHead = std::move( head );
 
       head       = newFrag;
       head->next = previousHead;
-
-      /*-------------------------------------------------
-      Update tracking data
-      -------------------------------------------------*/
-      bytesLeft -= fragmentDataSize;
-      dataOffset += fragmentDataSize;
     }
 
-    this->sort();
-
     return true;
   }
 
@@ -212,12 +648,11 @@ namespace Ripple
 
     while ( *fragPtr && ( offset < size ) )
     {
-      /* Get the source and destination pointers */
-      void **src    = ( *fragPtr )->data.get();
+      /* Get the destination pointer */
       uint8_t *dest = reinterpret_cast<uint8_t *>( buffer ) + offset;
 
       /* Move the data over */
-      memcpy( dest, *( src ), ( *fragPtr )->length );
+      memcpy( dest, ( *fragPtr )->payload(), ( *fragPtr )->length );
 
       /* Update trackers */
       offset += ( *fragPtr )->length;   // Offset into user buffer
@@ -263,6 +698,38 @@ namespace Ripple
   }
 
 
+  const uint8_t *Packet::data() const
+  {
+    /*-------------------------------------------------------------------------
+    Input Protection
+    -------------------------------------------------------------------------*/
+    if ( !head )
+    {
+      return nullptr;
+    }
+
+    /*-------------------------------------------------------------------------
+    Every fragment must pick up right where the last one ended
+    -------------------------------------------------------------------------*/
+    const uint8_t *const start   = head->payload();
+    const Fragment_sPtr *fragPtr = &head;
+    const uint8_t *expected      = start;
+
+    while ( *fragPtr )
+    {
+      if ( ( *fragPtr )->payload() != expected )
+      {
+        return nullptr;
+      }
+
+      expected += ( *fragPtr )->length;
+      fragPtr = &( *fragPtr )->next;
+    }
+
+    return start;
+  }
+
+
   uint16_t Packet::getUUID() const
   {
     return head ? head->uuid : 0;
@@ -371,6 +838,7 @@ namespace Ripple
         return false;
       }
       fragPtr = &( *fragPtr )->next;
+      currentIdx++;
     }
 
     return true;
@@ -400,9 +868,7 @@ namespace Ripple
     {
       for ( size_t byte = 0; byte < ( *fragPtr )->length; byte++ )
       {
-        void **raw_buffer = ( *fragPtr )->data.get();
-        bytes += scnprintf( msgBuffer + bytes, sizeof( msgBuffer ) - bytes, "0x%02x ",
-                            reinterpret_cast<const uint8_t *>( *raw_buffer )[ byte ] );
+        bytes += scnprintf( msgBuffer + bytes, sizeof( msgBuffer ) - bytes, "0x%02x ", ( *fragPtr )->payload()[ byte ] );
       }
       fragPtr = &( *fragPtr )->next;
     }
@@ -427,4 +893,71 @@ namespace Ripple
     return true;
   }
 
+
+  /*---------------------------------------------------------------------------
+  PacketWriter Class
+  ---------------------------------------------------------------------------*/
+  PacketWriter::PacketWriter( uint8_t *const dst, const size_t size, CRC32 *const crc, const size_t skip ) :
+      mDst( dst ), mSize( size ), mWritten( 0 ), mCRC( crc ), mSkip( skip )
+  {
+  }
+
+
+  bool PacketWriter::write( const void *const data, const size_t bytes )
+  {
+    if ( !bytes )
+    {
+      return true;
+    }
+    else if ( !data || ( bytes > remaining() ) )
+    {
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    Bytes past the skipped ones are folded in on their way through, so the
+    data is only walked once
+    -------------------------------------------------------------------------*/
+    const uint8_t *src = reinterpret_cast<const uint8_t *>( data );
+    const size_t ahead = ( mWritten < mSkip ) ? std::min( mSkip - mWritten, bytes ) : 0;
+    uint8_t *const dst = mDst + mWritten;
+
+    memcpy( dst, src, ahead );
+    if ( mCRC )
+    {
+      mCRC->copy( dst + ahead, src + ahead, bytes - ahead );
+    }
+    else
+    {
+      memcpy( dst + ahead, src + ahead, bytes - ahead );
+    }
+
+    mWritten += bytes;
+    return true;
+  }
+
+
+  bool PacketWriter::pad( const size_t bytes )
+  {
+    if ( bytes > remaining() )
+    {
+      return false;
+    }
+
+    memset( mDst + mWritten, 0, bytes );
+    fold( bytes );
+    mWritten += bytes;
+    return true;
+  }
+
+
+  void PacketWriter::fold( const size_t bytes )
+  {
+    const size_t ahead = ( mWritten < mSkip ) ? std::min( mSkip - mWritten, bytes ) : 0;
+    if ( mCRC && ( bytes > ahead ) )
+    {
+      mCRC->add( mDst + mWritten + ahead, bytes - ahead );
+    }
+  }
+
 }    // namespace Ripple
@@ -12,7 +12,12 @@
 #ifndef RIPPLE_PACKET_HPP
 #define RIPPLE_PACKET_HPP
 
+/* STL Includes */
+#include <cstdint>
+#include <cstring>
+
 /* ETL Includes */
+#include <etl/delegate.h>
 #include <etl/list.h>
 #include <etl/map.h>
 #include <etl/queue.h>
@@ -22,6 +27,7 @@
 
 /* Ripple Includes */
 #include <Ripple/src/netstack/packets/fragment.hpp>
+#include <Ripple/src/shared/cmn_crc.hpp>
 
 namespace Ripple
 {
@@ -30,6 +36,7 @@ namespace Ripple
   -------------------------------------------------------------------------------*/
   class Fragment;
   class Packet;
+  class PacketWriter;
 
   /*-------------------------------------------------------------------------------
   Aliases
@@ -38,11 +45,35 @@ namespace Ripple
   using PacketQueue = etl::queue<Aurora::Memory::shared_ptr<Packet>, SIZE>;
   using Packet_sPtr = Aurora::Memory::shared_ptr<Packet>;
 
+  /**
+   *  Produces packet data straight into the packet's memory. Must write exactly
+   *  the number of bytes the packet was sized for, else the packet is dropped.
+   */
+  using PacketFiller = etl::delegate<bool( PacketWriter & )>;
+
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Leading bytes of a checksummed packet that hold the CRC32 of everything
+   *  after them.
+   */
+  static constexpr size_t PACKET_CRC_BYTES = sizeof( uint32_t );
+
   /*-------------------------------------------------------------------------------
   Public Functions
   -------------------------------------------------------------------------------*/
   Packet_sPtr allocPacket( Aurora::Memory::IHeapAllocator *const context );
 
+  /**
+   *  Moves this node's packet UUID counter by a value only it has, such as its
+   *  IP or MAC address. Done once the address is known.
+   *
+   *  @param[in]  nodeId        Value unique to this node
+   *  @return void
+   */
+  void seedPacketUUID( const uint32_t nodeId );
+
   /*-------------------------------------------------------------------------------
   Structures
   -------------------------------------------------------------------------------*/
@@ -59,14 +90,28 @@ namespace Ripple
       SOCK_NOT_FOUND, /**< Destination socket wasn't found */
     };
 
-    bool inProgress;         /**< Is the assembly still accumulating fragments? */
-    bool remove;             /**< Flag to mark for removal */
-    RemoveErr whyRemove;     /**< Reason for removal */
-    Packet_sPtr packet;      /**< Fragment container */
-    size_t bytesRcvd;        /**< Total number of bytes received */
-    size_t startRxTime;      /**< Time the assembly started */
-    size_t lastTimeoutCheck; /**< Last time a timeout check was performed */
-    size_t timeout;          /**< Time delta the assembly has to build the message */
+    bool inProgress;     /**< Is the assembly still accumulating fragments? */
+    RemoveErr whyRemove; /**< Reason for removal */
+    Packet_sPtr packet;  /**< Fragment container */
+    size_t bytesRcvd;    /**< Total number of bytes received */
+    size_t startRxTime;  /**< Time the assembly started */
+    uint32_t startRx_us; /**< Time the assembly started (uS), for latency tracking */
+    size_t deadline;     /**< Time the assembly expires */
+    size_t timeout;      /**< Time delta the assembly has to build the message */
+    size_t lastRxTime;   /**< Last time a fragment arrived or a resend was considered */
+    size_t nackCount;    /**< Number of resend requests made */
+
+    Fragment_sPtr buffer;                      /**< Reassembly buffer with one fixed size slot per fragment */
+    FragmentMask rxBitmap;                     /**< Bit N is set once fragment N is in its slot */
+    uint8_t slotLength[ FRAG_MAX_PER_PACKET ]; /**< Bytes held in each slot */
+    uint16_t slotSize;                         /**< Bytes reserved for each slot */
+    IPAddress source;                          /**< Sender of the packet, as reported by the netif */
+    uint16_t uuid;                             /**< Packet being assembled, unique per source */
+    uint16_t totalFrags;                       /**< Fragments in the packet, parity included */
+    uint8_t parityFrags;                       /**< Parity fragments at the end of the packet */
+    CRC32 crc;                                 /**< Running CRC over the slots received in order */
+    uint8_t crcNext;                           /**< Next slot to fold into the CRC */
+    bool crcValid;                             /**< Completed packet matched the CRC it carries */
 
     /**
      * @brief Default construct a new PacketAssembly
@@ -94,14 +139,26 @@ namespace Ripple
      */
     explicit PacketAssembly( PacketAssembly &&obj )
     {
-      this->inProgress       = obj.inProgress;
-      this->remove           = obj.remove;
-      this->packet           = obj.packet;
-      this->bytesRcvd        = obj.bytesRcvd;
-      this->startRxTime      = obj.startRxTime;
-      this->lastTimeoutCheck = obj.lastTimeoutCheck;
-      this->timeout          = obj.timeout;
-      this->whyRemove        = obj.whyRemove;
+      this->inProgress  = obj.inProgress;
+      this->packet      = obj.packet;
+      this->bytesRcvd   = obj.bytesRcvd;
+      this->startRxTime = obj.startRxTime;
+      this->deadline    = obj.deadline;
+      this->timeout     = obj.timeout;
+      this->lastRxTime  = obj.lastRxTime;
+      this->nackCount   = obj.nackCount;
+      this->whyRemove   = obj.whyRemove;
+      this->buffer      = obj.buffer;
+      this->rxBitmap    = obj.rxBitmap;
+      this->slotSize    = obj.slotSize;
+      this->source      = obj.source;
+      this->uuid        = obj.uuid;
+      this->totalFrags  = obj.totalFrags;
+      this->parityFrags = obj.parityFrags;
+      this->crc         = obj.crc;
+      this->crcNext     = obj.crcNext;
+      this->crcValid    = obj.crcValid;
+      memcpy( this->slotLength, obj.slotLength, sizeof( slotLength ) );
 
       obj.clear();
     }
@@ -111,16 +168,87 @@ namespace Ripple
      */
     void clear()
     {
-      inProgress       = false;
-      remove           = false;
-      whyRemove        = RemoveErr::UNKNOWN;
-      packet           = Packet_sPtr();
-      bytesRcvd        = 0;
-      startRxTime      = 0;
-      lastTimeoutCheck = 0;
-      timeout          = 0;
+      inProgress  = false;
+      whyRemove   = RemoveErr::UNKNOWN;
+      packet      = Packet_sPtr();
+      bytesRcvd   = 0;
+      startRxTime = 0;
+      deadline    = 0;
+      timeout     = 0;
+      lastRxTime  = 0;
+      nackCount   = 0;
+      buffer      = Fragment_sPtr();
+      rxBitmap    = 0;
+      slotSize    = 0;
+      source      = 0;
+      uuid        = 0;
+      totalFrags  = 0;
+      parityFrags = 0;
+      crcNext     = 0;
+      crcValid    = false;
+      crc.reset();
+      memset( slotLength, 0, sizeof( slotLength ) );
     }
 
+    /**
+     * @brief Starts assembling a packet from the first of its fragments to arrive
+     *
+     * Allocates a buffer with room for every fragment of the packet, so each one
+     * is copied straight to its final place as it arrives.
+     *
+     * @param context   Memory allocator for the reassembly buffer
+     * @param fragment  First fragment received
+     * @param maxLength Largest fragment payload the network interface delivers
+     * @return true     Assembly started
+     * @return false    Fragment is malformed or out of memory
+     */
+    bool begin( Aurora::Memory::IHeapAllocator *const context, const Fragment_sPtr &fragment, const size_t maxLength );
+
+    /**
+     * @brief Copies a fragment into its slot
+     *
+     * Slots that now follow on from the last one checked are added to the
+     * CRC, so in order arrivals are checked while they're still in cache.
+     *
+     * @param fragment  Fragment received
+     * @return true     Fragment was stored
+     * @return false    Fragment is a duplicate or doesn't belong to this packet
+     */
+    bool insert( const Fragment_sPtr &fragment );
+
+    /**
+     * @brief Finishes the packet once every data fragment is present
+     *
+     * Lost data fragments are rebuilt from parity where possible. On success the
+     * slots are packed together into a single fragment held by the packet, and
+     * crcValid reports whether it matched the CRC in its leading bytes.
+     *
+     * @return true     Packet is ready
+     * @return false    Fragments are still missing
+     */
+    bool complete();
+
+    /**
+     * @brief Gets which fragments have yet to arrive
+     *
+     * @return FragmentMask   Bit N is set if fragment number N is missing
+     */
+    FragmentMask missingFragments() const;
+
+    /**
+     * @brief Gets the payload of a fragment that has arrived
+     *
+     * @param number    Fragment number
+     * @param length    Bytes in the payload
+     * @return const void*  Payload, or nullptr if the fragment hasn't arrived
+     */
+    const void *fragmentData( const size_t number, size_t &length ) const;
+
+    /**
+     * @brief Folds every data slot that follows on from the last one into the CRC
+     */
+    void advanceCRC();
+
 
     /**
      * @brief Helper method to convert removal reason error code into a string
@@ -158,15 +286,89 @@ namespace Ripple
     }
   };
 
-  /*-------------------------------------------------------------------------------
-  Aliases
-  -------------------------------------------------------------------------------*/
-  template<size_t SIZE>
-  using AssemblyMap = etl::map<const uint32_t, PacketAssembly, SIZE>;
-
   /*-------------------------------------------------------------------------------
   Classes
   -------------------------------------------------------------------------------*/
+  /**
+   * @brief Appends bytes to a block of memory, folding them into a CRC as they go
+   *
+   * Handed to a PacketFiller so data lands in its final place the moment it is
+   * produced, such as by a NanoPB output stream.
+   */
+  class PacketWriter
+  {
+  public:
+    /**
+     * @brief Sets up a writer over a block of memory
+     *
+     * @param dst       Where the first byte goes
+     * @param size      Bytes the block holds
+     * @param crc       CRC to fold written bytes into, nullptr for none
+     * @param skip      Leading bytes to leave out of the CRC
+     */
+    PacketWriter( uint8_t *const dst, const size_t size, CRC32 *const crc, const size_t skip );
+
+    /**
+     * @brief Appends bytes
+     *
+     * @param data      Bytes to append
+     * @param bytes     Number of bytes
+     * @return bool     False if they don't fit, in which case nothing is written
+     */
+    bool write( const void *const data, const size_t bytes );
+
+    /**
+     * @brief Appends zeros
+     *
+     * @param bytes     Number of zeros
+     * @return bool     False if they don't fit, in which case nothing is written
+     */
+    bool pad( const size_t bytes );
+
+    size_t written() const
+    {
+      return mWritten;
+    }
+
+    size_t remaining() const
+    {
+      return mSize - mWritten;
+    }
+
+  private:
+    uint8_t *mDst;   /**< Start of the block */
+    size_t mSize;    /**< Bytes in the block */
+    size_t mWritten; /**< Bytes appended so far */
+    CRC32 *mCRC;     /**< CRC being built, may be nullptr */
+    size_t mSkip;    /**< Leading bytes the CRC doesn't cover */
+
+    /**
+     * @brief Folds the bytes just placed at the cursor into the CRC
+     */
+    void fold( const size_t bytes );
+  };
+
+
+  /**
+   * @brief Fills a packet from a flat buffer
+   */
+  struct PacketCopy
+  {
+    const void *data; /**< Bytes to copy */
+    size_t bytes;     /**< Number of bytes */
+
+    bool fill( PacketWriter &writer )
+    {
+      return writer.write( data, bytes );
+    }
+
+    PacketFiller filler()
+    {
+      return PacketFiller::create<PacketCopy, &PacketCopy::fill>( *this );
+    }
+  };
+
+
   /**
    * @brief Top level interface for raw packets on the network
    */
@@ -185,6 +387,35 @@ namespace Ripple
      */
     void sort();
 
+    /**
+     * @brief Sets how data is split up into fragments by pack()
+     *
+     * @param fragmentSize      Bytes in each fragment of a fragmented packet, zero keeps the default
+     * @param unfragmentedSize  Largest packet sent as a single fragment
+     * @param maxFragments      Most fragments the packet may be split into, zero for FRAG_MAX_PER_PACKET
+     */
+    void setFragmentation( const size_t fragmentSize, const size_t unfragmentedSize, const size_t maxFragments = 0 );
+
+    /**
+     * @brief Sets how many XOR parity fragments pack() adds to a fragmented packet
+     *
+     * Parity fragment N covers every Nth data fragment. The receiver can rebuild
+     * one lost data fragment per parity fragment without a retransmit.
+     *
+     * @param parityFragments   Parity fragments to add, zero disables them
+     */
+    void setParity( const uint8_t parityFragments );
+
+    /**
+     * @brief Has pack() store a CRC32 of the packet in its first PACKET_CRC_BYTES
+     *
+     * The CRC is built up as the data is copied in, covering everything after
+     * the bytes that hold it. Whatever the prefix had there is overwritten.
+     *
+     * @param enable    True to add the CRC
+     */
+    void setChecksum( const bool enable );
+
     /**
      * @brief Packs user data into the packet, creating new fragments as needed
      *
@@ -195,6 +426,36 @@ namespace Ripple
      */
     bool pack( const void *const buffer, const size_t size );
 
+    /**
+     * @brief Packs a prefix followed by user data, copying each only once
+     *
+     * Both are gathered into a single buffer owned by the packet. The fragments
+     * are views into that buffer rather than copies of it.
+     *
+     * @param prefix      Data placed ahead of the user data, such as a header
+     * @param prefixSize  Number of prefix bytes
+     * @param buffer      User data to be packed
+     * @param size        Number of bytes being packed
+     * @return true
+     * @return false
+     */
+    bool pack( const void *const prefix, const size_t prefixSize, const void *const buffer, const size_t size );
+
+    /**
+     * @brief Packs a prefix followed by data that is produced in place
+     *
+     * Like the buffered version, except the filler writes the data straight
+     * into the packet's buffer, so it never has to be staged anywhere else.
+     *
+     * @param prefix      Data placed ahead of the user data, such as a header
+     * @param prefixSize  Number of prefix bytes
+     * @param filler      Writes exactly size bytes of user data
+     * @param size        Number of bytes being packed
+     * @return true
+     * @return false
+     */
+    bool pack( const void *const prefix, const size_t prefixSize, const PacketFiller &filler, const size_t size );
+
     /**
      * @brief Unpacks the packet fragments into a user buffer
      *
@@ -222,6 +483,16 @@ namespace Ripple
      */
     size_t size() const;
 
+    /**
+     * @brief Gets the packet data as one block, if it is laid out that way
+     *
+     * True of packets that were reassembled or built with pack(). Lets the data
+     * be read in place instead of unpacked into a copy.
+     *
+     * @return const uint8_t*   Start of the data, or nullptr if not contiguous
+     */
+    const uint8_t *data() const;
+
     /**
      * @brief Returns the unique ID of the packet
      *
@@ -286,7 +557,8 @@ namespace Ripple
     /*-------------------------------------------------------------------------
     Public Data
     -------------------------------------------------------------------------*/
-    Fragment_sPtr head; /**< Fragment list head */
+    Fragment_sPtr head;    /**< Fragment list head */
+    uint32_t timestamp_us; /**< When the packet entered its current stage (uS), for latency tracking */
 
   protected:
     friend Packet_sPtr allocPacket( Aurora::Memory::IHeapAllocator *const context );
@@ -296,7 +568,11 @@ namespace Ripple
 
   private:
     size_t mFragmentationSize;
+    size_t mUnfragmentedSize;
+    size_t mMaxFragments;
     uint16_t mTotalFragments;
+    uint8_t mParityFragments;
+    bool mChecksum;
   };
 
 }    // namespace Ripple
@@ -0,0 +1,72 @@
+/********************************************************************************
+ *  File Name:
+ *    pb_stream.cpp
+ *
+ *  Description:
+ *    NanoPB stream adapters for Ripple packets
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <algorithm>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/packets/pb_stream.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  static bool writeCallback( pb_ostream_t *stream, const pb_byte_t *buf, size_t count )
+  {
+    return reinterpret_cast<PacketWriter *>( stream->state )->write( buf, count );
+  }
+
+
+  static bool readCallback( pb_istream_t *stream, pb_byte_t *buf, size_t count )
+  {
+    PacketReader *reader = reinterpret_cast<PacketReader *>( stream->state );
+
+    /*-------------------------------------------------
+    Fields can span fragments, so the view copies out
+    across the boundary
+    -------------------------------------------------*/
+    if ( !buf || ( reader->view.copy( buf, reader->offset, count ) != count ) )
+    {
+      return false;
+    }
+
+    reader->offset += count;
+    return true;
+  }
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  pb_ostream_t pbOutputStream( PacketWriter &writer, const size_t maxBytes )
+  {
+    pb_ostream_t stream{};
+    stream.callback      = writeCallback;
+    stream.state         = &writer;
+    stream.max_size      = std::min( maxBytes, writer.remaining() );
+    stream.bytes_written = 0;
+
+    return stream;
+  }
+
+
+  pb_istream_t pbInputStream( PacketReader &reader, const size_t maxBytes )
+  {
+    const size_t left = ( reader.offset < reader.view.size() ) ? ( reader.view.size() - reader.offset ) : 0;
+
+    pb_istream_t stream{};
+    stream.callback   = readCallback;
+    stream.state      = &reader;
+    stream.bytes_left = std::min( maxBytes, left );
+
+    return stream;
+  }
+
+}    // namespace Ripple
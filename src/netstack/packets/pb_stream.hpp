@@ -0,0 +1,70 @@
+/********************************************************************************
+ *  File Name:
+ *    pb_stream.hpp
+ *
+ *  Description:
+ *    NanoPB streams that encode straight into a packet under construction and
+ *    decode straight out of a received packet's fragments
+ *
+ *  Notes:
+ *    See documentation for Nanopb at https://jpa.kapsi.fi/nanopb/docs/
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_PACKET_PB_STREAM_HPP
+#define RIPPLE_PACKET_PB_STREAM_HPP
+
+/* STL Includes */
+#include <cstddef>
+
+/* Nanopb Includes */
+#include "pb.h"
+#include "pb_decode.h"
+#include "pb_encode.h"
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/packets/packet.hpp>
+#include <Ripple/src/netstack/packets/view.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Read position inside a packet view, used as input stream state
+   */
+  struct PacketReader
+  {
+    PacketView view; /**< Data being decoded */
+    size_t offset;   /**< Bytes of the view already consumed */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Creates an output stream that appends to a packet writer
+   *
+   * Every encoded byte lands in its final place, CRC included, as it is emitted.
+   *
+   * @param writer    Writer handed to a PacketFiller. Must outlive the stream.
+   * @param maxBytes  Most bytes the stream may emit
+   * @return pb_ostream_t
+   */
+  pb_ostream_t pbOutputStream( PacketWriter &writer, const size_t maxBytes );
+
+  /**
+   * @brief Creates an input stream that reads a packet view span by span
+   *
+   * @param reader    Where to read from. Must outlive the stream.
+   * @param maxBytes  Most bytes the stream may consume
+   * @return pb_istream_t
+   */
+  pb_istream_t pbInputStream( PacketReader &reader, const size_t maxBytes );
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_PACKET_PB_STREAM_HPP */
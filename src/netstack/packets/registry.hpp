@@ -0,0 +1,180 @@
+/********************************************************************************
+ *  File Name:
+ *    registry.hpp
+ *
+ *  Description:
+ *    Dense packet ID registry built from the project packet contract. Filters
+ *    and per-packet tables are indexed straight by ID.
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_PACKET_REGISTRY_HPP
+#define RIPPLE_PACKET_REGISTRY_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/packets/definitions_contract.hpp>
+#include <Ripple/src/netstack/packets/types.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static_assert( RIPPLE_MAX_NUM_PKTS > 0, "Project must define at least one packet" );
+
+  static constexpr size_t NUM_PACKET_IDS = RIPPLE_MAX_NUM_PKTS; /**< Packet IDs run from zero up to this */
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Checks if an ID can index the packet tables
+   *
+   * @param pkt       Packet to check
+   * @return true     ID is in range of the contract
+   * @return false    ID is out of range
+   */
+  static constexpr bool packetIdValid( const PacketId pkt )
+  {
+    return pkt < NUM_PACKET_IDS;
+  }
+
+  /**
+   * @brief Looks up the project definition of a packet
+   *
+   * @param pkt       Packet to look up
+   * @return const PacketDef*   Definition, or nullptr if the project doesn't define it
+   */
+  static inline const PacketDef *packetDefinition( const PacketId pkt )
+  {
+    if ( !packetIdValid( pkt ) )
+    {
+      return nullptr;
+    }
+
+    const PacketDef *def = &PacketDefinitions[ pkt ];
+    return ( ( def->id == pkt ) && def->fields ) ? def : nullptr;
+  }
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Compile time description of a NanoPB type sent as a packet
+   *
+   * Specialize with RIPPLE_REGISTER_PACKET() for every type the project sends
+   * through the typed transmit<T>(). Types without one fail to build there.
+   *
+   *    RIPPLE_REGISTER_PACKET( PingMessage, PKT_PING );
+   */
+  template<typename T>
+  struct PacketTraits;
+
+
+  /**
+   * @brief Set of packets, one bit per ID
+   *
+   * Constructible at compile time, so socket configurations can be constants:
+   *
+   *    static constexpr PacketFilter txFilter = { PKT_PING, PKT_STATUS };
+   */
+  class PacketFilter
+  {
+  public:
+    constexpr PacketFilter() : mWords{}
+    {
+    }
+
+    constexpr PacketFilter( std::initializer_list<PacketId> packets ) : mWords{}
+    {
+      for ( const PacketId pkt : packets )
+      {
+        set( pkt );
+      }
+    }
+
+    /**
+     * @brief Adds a packet to the set. Out of range IDs are ignored.
+     */
+    constexpr void set( const PacketId pkt )
+    {
+      if ( packetIdValid( pkt ) )
+      {
+        mWords[ pkt / WORD_BITS ] |= ( 1u << ( pkt % WORD_BITS ) );
+      }
+    }
+
+    /**
+     * @brief Removes a packet from the set
+     */
+    constexpr void reset( const PacketId pkt )
+    {
+      if ( packetIdValid( pkt ) )
+      {
+        mWords[ pkt / WORD_BITS ] &= ~( 1u << ( pkt % WORD_BITS ) );
+      }
+    }
+
+    /**
+     * @brief Checks if a packet is in the set
+     */
+    constexpr bool test( const PacketId pkt ) const
+    {
+      return packetIdValid( pkt ) && ( ( mWords[ pkt / WORD_BITS ] >> ( pkt % WORD_BITS ) ) & 1u );
+    }
+
+  private:
+    static constexpr size_t WORD_BITS = 32;
+    static constexpr size_t NUM_WORDS = ( NUM_PACKET_IDS + WORD_BITS - 1u ) / WORD_BITS;
+
+    uint32_t mWords[ NUM_WORDS ];
+  };
+
+
+  /**
+   * @brief Checks if a packet is in the given filter
+   *
+   * @param pkt       Packet to look for
+   * @param filter    Which filter to look in
+   * @return true     The packet is in the filter
+   * @return false    The packet is not in the filter
+   */
+  static constexpr bool packetInFilter( const PacketId pkt, const PacketFilter &filter )
+  {
+    return filter.test( pkt );
+  }
+
+}    // namespace Ripple
+
+/*-------------------------------------------------------------------------------
+Macros
+-------------------------------------------------------------------------------*/
+/**
+ *  Registers a NanoPB generated type as a packet. Uses the TYPE_size and
+ *  TYPE_fields definitions NanoPB generates next to it. Place at global scope.
+ *
+ *  @param  TYPE    Generated NanoPB message type
+ *  @param  ID      PacketId the type is sent with
+ */
+#define RIPPLE_REGISTER_PACKET( TYPE, ID )                                                                   \
+  template<>                                                                                                 \
+  struct Ripple::PacketTraits<TYPE>                                                                          \
+  {                                                                                                          \
+    static constexpr Ripple::PacketId id         = ( ID );                                                   \
+    static constexpr size_t size                 = ( TYPE##_size );                                          \
+    static constexpr const pb_msgdesc_t *fields  = ( TYPE##_fields );                                        \
+                                                                                                             \
+    static_assert( Ripple::packetIdValid( id ), #TYPE " has an ID outside of the packet contract" );         \
+    static_assert( size <= std::numeric_limits<decltype( Ripple::PacketHdr::size )>::max(),                  \
+                   #TYPE " encodes larger than a packet header can describe" );                              \
+  }
+
+#endif /* !RIPPLE_PACKET_REGISTRY_HPP */
@@ -24,12 +24,22 @@
 
 namespace Ripple
 {
+  /*-------------------------------------------------------------------------------
+  Forward Declarations
+  -------------------------------------------------------------------------------*/
+  class PacketView;
+
   /*-------------------------------------------------------------------------------
   Aliases
   -------------------------------------------------------------------------------*/
   using PacketId       = uint32_t;
   using PacketCallback = void ( * )( const PacketId, const void *const, const size_t );
-  using PacketFilter   = std::array<PacketId, 32>;
+
+  /**
+   *  Handler given the packet data as a view, valid until it returns. Copy the
+   *  view to keep the data longer.
+   */
+  using PacketViewCallback = void ( * )( const PacketId, const PacketView & );
 
   /*-------------------------------------------------------------------------------
   Structures
@@ -50,8 +60,10 @@ namespace Ripple
   struct PacketHdr
   {
     PacketId id;
-    uint8_t size;
-    uint8_t pad0[ 3 ];
+    uint8_t size;     /**< Bytes following the header */
+    uint8_t codec;    /**< RecordCodecType the bytes were coded with, zero if plain */
+    uint8_t rawSize;  /**< Bytes the record decodes to, if coded */
+    uint8_t keyframe; /**< Keyframe a coded record belongs to */
   };
 
 }    // namespace Ripple
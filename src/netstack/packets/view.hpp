@@ -0,0 +1,227 @@
+/********************************************************************************
+ *  File Name:
+ *    view.hpp
+ *
+ *  Description:
+ *    Read-only window over the payload of a packet, walked one fragment at a
+ *    time so the data never has to be gathered into one buffer
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_PACKET_VIEW_HPP
+#define RIPPLE_PACKET_VIEW_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/packets/fragment.hpp>
+#include <Ripple/src/netstack/packets/packet.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief One contiguous piece of a packet view
+   */
+  struct PacketSpan
+  {
+    const uint8_t *data; /**< First byte of the piece */
+    size_t size;         /**< Bytes in the piece */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Lends out a range of bytes inside a packet without copying them
+   *
+   * The view holds a reference to the packet, so the memory stays put for as
+   * long as the view does, or until release() is called. Iterating yields one
+   * PacketSpan per fragment the range touches:
+   *
+   *    for ( const PacketSpan &span : view )
+   *    {
+   *      consume( span.data, span.size );
+   *    }
+   *
+   * Packets reassembled by the stack are a single block, so most views come
+   * out as one span. Code should still handle several.
+   */
+  class PacketView
+  {
+  public:
+    /**
+     * @brief Walks the spans of a view in order
+     */
+    class Iterator
+    {
+    public:
+      Iterator( const Fragment *const fragment, const size_t skip, const size_t remaining ) :
+          mFragment( fragment ), mSkip( skip ), mRemaining( remaining )
+      {
+        settle();
+      }
+
+      PacketSpan operator*() const
+      {
+        const size_t size = mFragment->length - mSkip;
+        return { mFragment->payload() + mSkip, ( size < mRemaining ) ? size : mRemaining };
+      }
+
+      Iterator &operator++()
+      {
+        const size_t size = mFragment->length - mSkip;
+        mRemaining -= ( size < mRemaining ) ? size : mRemaining;
+        mFragment = mFragment->next.get();
+        mSkip     = 0;
+        settle();
+        return *this;
+      }
+
+      bool operator!=( const Iterator &other ) const
+      {
+        return mFragment != other.mFragment;
+      }
+
+    private:
+      const Fragment *mFragment; /**< Fragment the current span is in, nullptr at the end */
+      size_t mSkip;              /**< Bytes of the fragment ahead of the span */
+      size_t mRemaining;         /**< Bytes left in the view from the current span on */
+
+      /**
+       * @brief Steps past fragments the view doesn't reach into
+       */
+      void settle()
+      {
+        while ( mFragment && mRemaining && ( mSkip >= mFragment->length ) )
+        {
+          mSkip -= mFragment->length;
+          mFragment = mFragment->next.get();
+        }
+
+        if ( !mRemaining )
+        {
+          mFragment = nullptr;
+        }
+      }
+    };
+
+    PacketView() : mPacket(), mOffset( 0 ), mSize( 0 )
+    {
+    }
+
+    /**
+     * @brief Views part of a packet
+     *
+     * @param packet    Packet to lend out
+     * @param offset    Bytes into the packet the view starts at
+     * @param size      Bytes in the view
+     */
+    PacketView( const Packet_sPtr &packet, const size_t offset, const size_t size ) :
+        mPacket( packet ), mOffset( offset ), mSize( size )
+    {
+    }
+
+    /**
+     * @brief Gives the packet back. The view is empty afterwards.
+     */
+    void release()
+    {
+      mPacket = Packet_sPtr();
+      mOffset = 0;
+      mSize   = 0;
+    }
+
+    /**
+     * @brief Gets a narrower view of the same packet
+     *
+     * @param offset    Bytes into this view the new one starts at
+     * @param size      Bytes in the new view, clipped to what this one holds
+     * @return PacketView
+     */
+    PacketView subview( const size_t offset, const size_t size ) const
+    {
+      if ( offset >= mSize )
+      {
+        return PacketView();
+      }
+
+      const size_t left = mSize - offset;
+      return PacketView( mPacket, mOffset + offset, ( size < left ) ? size : left );
+    }
+
+    /**
+     * @brief Copies bytes out of the view
+     *
+     * @param dst       Where to copy to
+     * @param offset    Bytes into the view to start at
+     * @param bytes     Most bytes to copy
+     * @return size_t   Bytes copied
+     */
+    size_t copy( void *const dst, const size_t offset, const size_t bytes ) const
+    {
+      uint8_t *out  = reinterpret_cast<uint8_t *>( dst );
+      size_t copied = 0;
+
+      for ( const PacketSpan &span : subview( offset, bytes ) )
+      {
+        memcpy( out + copied, span.data, span.size );
+        copied += span.size;
+      }
+
+      return copied;
+    }
+
+    /**
+     * @brief Gets the view as one block, if it lies within a single fragment
+     *
+     * @return const uint8_t*   Start of the view, or nullptr if it is split
+     */
+    const uint8_t *contiguous() const
+    {
+      Iterator span = begin();
+      if ( !( span != end() ) )
+      {
+        return nullptr;
+      }
+
+      const PacketSpan first = *span;
+      return ( first.size == mSize ) ? first.data : nullptr;
+    }
+
+    size_t size() const
+    {
+      return mSize;
+    }
+
+    bool empty() const
+    {
+      return !mSize;
+    }
+
+    Iterator begin() const
+    {
+      return Iterator( ( mPacket && mSize ) ? mPacket->head.get() : nullptr, mOffset, mSize );
+    }
+
+    Iterator end() const
+    {
+      return Iterator( nullptr, 0, 0 );
+    }
+
+  private:
+    Packet_sPtr mPacket; /**< Packet on loan */
+    size_t mOffset;      /**< Bytes into the packet the view starts at */
+    size_t mSize;        /**< Bytes in the view */
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_PACKET_VIEW_HPP */
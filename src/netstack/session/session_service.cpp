@@ -35,6 +35,7 @@ namespace Ripple::Session
       mContext( nullptr ), mUpdateRate( Chimera::Thread::TIMEOUT_50MS ),
       mServiceStarvedThreshold( 2 * Chimera::Thread::TIMEOUT_1MS )
   {
+    updateBudget();
   }
 
 
@@ -92,6 +93,7 @@ namespace Ripple::Session
       this_thread::pendTaskMsg( ITCMsg::TSK_MSG_WAKEUP, pendTime );
       lastWakeup = Chimera::millis();
       nextWakeup = lastWakeup + mUpdateRate;
+      mProfile.beginWork();
 
       /*-------------------------------------------------
       Process the session services state machine
@@ -134,7 +136,7 @@ namespace Ripple::Session
       Calculate the next time this thread should wake.
       -------------------------------------------------*/
       currentTick = Chimera::millis();
-      pendTime    = nextWakeup - currentTick;
+      pendTime    = ( nextWakeup > currentTick ) ? ( nextWakeup - currentTick ) : 0;
 
       /*-------------------------------------------------
       Notify a listener if the thread is doing too much
@@ -144,7 +146,7 @@ namespace Ripple::Session
       This callback firing is more of a warning bell then
       a sure-fire sign that there is a problem.
       -------------------------------------------------*/
-      if ( ( currentTick >= nextWakeup ) || ( pendTime <= mServiceStarvedThreshold ) )
+      if ( mProfile.endWork() )
       {
         mCBService_registry.call<CallbackId::CB_SERVICE_OVERRUN>();
       }
@@ -156,10 +158,17 @@ namespace Ripple::Session
   {
     this->lock();
     mUpdateRate = period;
+    updateBudget();
     this->unlock();
   }
 
 
+  void Service::getLoad( ThreadLoad &load )
+  {
+    mProfile.getLoad( load );
+  }
+
+
   Chimera::Status_t Service::registerCallback( const CallbackId id, etl::delegate<void( size_t )> func )
   {
     /*-------------------------------------------------
@@ -231,4 +240,15 @@ namespace Ripple::Session
     }
   }
 
+
+  void Service::updateBudget()
+  {
+    /*-------------------------------------------------
+    Getting within the starvation threshold of the next
+    wakeup means the thread is using nearly all its time
+    -------------------------------------------------*/
+    const size_t budget_ms = ( mUpdateRate > mServiceStarvedThreshold ) ? ( mUpdateRate - mServiceStarvedThreshold ) : 0;
+    mProfile.setBudget( static_cast<uint32_t>( budget_ms * 1000u ) );
+  }
+
 }  // namespace Ripple::Session
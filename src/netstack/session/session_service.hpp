@@ -23,6 +23,7 @@
 #include <Ripple/src/session/process/process_intf.hpp>
 #include <Ripple/src/session/session_process.hpp>
 #include <Ripple/src/session/session_types.hpp>
+#include <Ripple/src/shared/cmn_profile.hpp>
 
 
 namespace Ripple::Session
@@ -92,6 +93,14 @@ namespace Ripple::Session
      */
     Chimera::Status_t registerCallback( const CallbackId id, etl::delegate<void( size_t )> func );
 
+    /**
+     *  Gets how hard the run() thread is working
+     *
+     *  @param[out] load        Output for the figures
+     *  @return void
+     */
+    void getLoad( ThreadLoad &load );
+
     /*-------------------------------------------------------------------------------
     Processes
     -------------------------------------------------------------------------------*/
@@ -135,6 +144,14 @@ namespace Ripple::Session
      */
     void initializeProcess();
 
+    /**
+     *  Derives the work budget of one pass from the update rate, leaving
+     *  the starvation threshold free for the thread to sleep in
+     *
+     *  @return void
+     */
+    void updateBudget();
+
     /*-------------------------------------------------
     Private Data
     -------------------------------------------------*/
@@ -142,6 +159,7 @@ namespace Ripple::Session
     size_t mServiceStarvedThreshold;        /**< Thread delay time that indicates the process is starved for processing */
     Chimera::Thread::TaskId mTaskId; /**< Thread registration ID */
     Session::Context mContext;              /**< User context for the network stack */
+    ThreadProfiler mProfile;                /**< Thread load, owned by the run() thread */
 
     /**
      *  Helper for tracking/invoking event callbacks
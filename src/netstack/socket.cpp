@@ -15,7 +15,6 @@
 #include <cstring>
 
 /* ETL Includes */
-#include <etl/crc32.h>
 
 /* Aurora Includes */
 #include <Aurora/logging>
@@ -35,47 +34,136 @@ Literals
 namespace Ripple
 {
   /*-------------------------------------------------------------------------------
-  Public Functions
+  Static Functions
   -------------------------------------------------------------------------------*/
-  bool packetInFilter( const PacketId pkt, const PacketFilter &filter )
+  /**
+   * @brief Checks a received packet is whole enough to read
+   *
+   * The CRC was already checked as the packet was reassembled, and corrupted
+   * packets never reach a socket, so only the layout is left to verify.
+   *
+   * @param raw       Start of the packet data
+   * @param size      Bytes in the packet
+   * @return true     Packet is intact
+   * @return false    Packet is too short or not contiguous
+   */
+  static bool packetIsIntact( const uint8_t *const raw, const size_t size )
   {
-    for ( auto &filter_pkt : filter )
-    {
-      if ( pkt == filter_pkt )
-      {
-        return true;
-      }
-    }
+    return raw && ( size >= sizeof( TransportHeader ) );
+  }
+
 
-    return false;
+  /**
+   * @brief Gets the space a packet takes up inside a coalesced packet
+   *
+   * Each one is padded out so the next PacketHdr stays aligned.
+   *
+   * @param bytes     Packet size, including its PacketHdr
+   * @return size_t
+   */
+  static constexpr size_t coalescedSize( const size_t bytes )
+  {
+    return ( bytes + alignof( PacketHdr ) - 1u ) & ~( alignof( PacketHdr ) - 1u );
   }
 
 
   /*-------------------------------------------------------------------------------
   Socket Class
   -------------------------------------------------------------------------------*/
-  Socket::Socket( Context_rPtr ctx, const SocketType type, const size_t memory ) : mContext( ctx ), mSocketType( type )
+  Socket::Socket( Context_rPtr ctx, const SocketType type, void *const arena, const size_t arenaSize ) :
+      mContext( ctx ), mSocketType( type )
   {
     using namespace Chimera::Thread;
     RT_HARD_ASSERT( ctx );
-    RT_HARD_ASSERT( memory );
+    RT_HARD_ASSERT( arena && arenaSize );
+
+    maxMem = arenaSize;
+    mArena.assignMemoryPool( arena, arenaSize );
+    memset( &mStats, 0, sizeof( mStats ) );
+
+    mTXNext        = nullptr;
+    mTXDueTime     = 0;
+    mTXPending     = false;
+    mCoalesceSize  = 0;
+    mCoalesceStart = 0;
+    mDestAddress   = std::numeric_limits<IPAddress>::max();
+    mDestPort      = std::numeric_limits<Port>::max();
+
+    /*-------------------------------------------------------------------------
+    Stream state counts against the socket's own budget. The context checks
+    it fit before handing the socket out.
+    -------------------------------------------------------------------------*/
+    mStream = nullptr;
+    if ( type == SocketType::STREAM )
+    {
+      void *mem = mArena.malloc( sizeof( Stream ) );
+      mStream   = mem ? new ( mem ) Stream() : nullptr;
+    }
+
+    mCodec = nullptr;
 
-    maxMem   = memory;
-    allocMem = 0;
+    mCommonPktCallback  = nullptr;
+    mCommonViewCallback = nullptr;
+    memset( mPktCallbacks, 0, sizeof( mPktCallbacks ) );
+    memset( mViewCallbacks, 0, sizeof( mViewCallbacks ) );
     mTXQueue.clear();
     mRXQueue.clear();
   }
 
   Socket::~Socket()
   {
+    if ( mStream )
+    {
+      mStream->~Stream();
+      mArena.free( mStream );
+    }
+
+    if ( mCodec )
+    {
+      mCodec->~RecordCodec();
+      mArena.free( mCodec );
+    }
   }
 
 
   Chimera::Status_t Socket::open( const SocketConfig &cfg )
   {
+    /*-------------------------------------------------------------------------
+    Move the socket over to its new port. Only PULL and STREAM sockets
+    receive, so only they claim a port with the context.
+    -------------------------------------------------------------------------*/
+    mContext->unbindPort( this );
+
     mThisPort = cfg.devicePort;
     mConfig   = cfg;
 
+    /*-------------------------------------------------------------------------
+    The codec comes out of the socket's own arena, and is kept once made so
+    reopening can't fragment it. Reopening always starts from a keyframe.
+    A socket that doesn't code only makes one once a coded record arrives.
+    -------------------------------------------------------------------------*/
+    {
+      Chimera::Thread::LockGuard _lck( *this );
+
+      RecordCodec *codec = cfg.codecKeyframes ? unsafe_codec() : mCodec;
+      if ( codec )
+      {
+        codec->reset( cfg.codecKeyframes );
+      }
+      else if ( cfg.codecKeyframes )
+      {
+        LOG_ERROR_IF( DEBUG_MODULE, "No memory for codec on port %d\r\n", mThisPort );
+        return Chimera::Status::MEMORY;
+      }
+    }
+
+    const bool receives = ( mSocketType == SocketType::PULL ) || ( mSocketType == SocketType::STREAM );
+    if ( receives && !mContext->bindPort( this ) )
+    {
+      LOG_ERROR_IF( DEBUG_MODULE, "Port %d already in use\r\n", mThisPort );
+      return Chimera::Status::FAIL;
+    }
+
     return Chimera::Status::OK;
   }
 
@@ -83,27 +171,341 @@ namespace Ripple
   void Socket::close()
   {
     using namespace Aurora::Logging;
+    mContext->unbindPort( this );
+    disconnect();
   }
 
 
   Chimera::Status_t Socket::connect( const IPAddress address, const Port port )
   {
+    Chimera::Thread::LockGuard _lck( *this );
     mDestAddress = address;
     mDestPort    = port;
+
+    /*-------------------------------------------------------------------------
+    Streams start a fresh sequence, which the first segment announces
+    -------------------------------------------------------------------------*/
+    if ( mStream )
+    {
+      mStream->open( Chimera::millis() );
+    }
+
     return Chimera::Status::OK;
   }
 
 
   Chimera::Status_t Socket::disconnect()
   {
+    Chimera::Thread::LockGuard _lck( *this );
     mDestAddress = std::numeric_limits<IPAddress>::max();
     mDestPort    = std::numeric_limits<Port>::max();
+
+    if ( mStream )
+    {
+      mStream->close();
+    }
+
     return Chimera::Status::OK;
   }
 
 
-  Chimera::Status_t Socket::write( const void *const data, const size_t bytes )
+  size_t Socket::streamWrite( const void *const data, const size_t bytes )
+  {
+    if ( !mStream || !data || !bytes )
+    {
+      return 0;
+    }
+
+    size_t written = 0;
+    {
+      Chimera::Thread::LockGuard _lck( *this );
+      written = mStream->write( data, bytes );
+    }
+
+    if ( written )
+    {
+      mContext->markTXReady( this );
+      mContext->signalEvent( CTX_EVT_TX );
+    }
+
+    return written;
+  }
+
+
+  size_t Socket::streamRead( void *const data, const size_t bytes )
+  {
+    if ( !mStream || !data || !bytes )
+    {
+      return 0;
+    }
+
+    size_t taken = 0;
+    bool opened  = false;
+    {
+      Chimera::Thread::LockGuard _lck( *this );
+      taken  = mStream->read( data, bytes );
+      opened = mStream->pending();
+    }
+
+    /*-------------------------------------------------------------------------
+    Reading may have reopened the window, which the peer must hear about
+    -------------------------------------------------------------------------*/
+    if ( opened )
+    {
+      mContext->markTXReady( this );
+      mContext->signalEvent( CTX_EVT_TX );
+    }
+
+    return taken;
+  }
+
+
+  size_t Socket::streamAvailable()
+  {
+    Chimera::Thread::LockGuard _lck( *this );
+    return mStream ? mStream->available() : 0;
+  }
+
+
+  bool Socket::streamFailed()
+  {
+    Chimera::Thread::LockGuard _lck( *this );
+    return mStream && mStream->failed();
+  }
+
+
+  void Socket::getStreamStats( StreamStats &stats )
+  {
+    Chimera::Thread::LockGuard _lck( *this );
+    if ( mStream )
+    {
+      mStream->getStats( stats );
+    }
+    else
+    {
+      memset( &stats, 0, sizeof( stats ) );
+    }
+  }
+
+
+  void Socket::getCodecStats( CodecStats &stats )
+  {
+    Chimera::Thread::LockGuard _lck( *this );
+    if ( mCodec )
+    {
+      mCodec->getStats( stats );
+    }
+    else
+    {
+      memset( &stats, 0, sizeof( stats ) );
+    }
+  }
+
+
+  Chimera::Status_t Socket::write( const void *const data, const size_t bytes, TXCallback callback )
+  {
+    Chimera::Status_t result = Chimera::Status::FAIL;
+    {
+      Chimera::Thread::LockGuard _lck( *this );
+      result = unsafe_enqueue( data, bytes, TRANSPORT_FLAG_NONE, callback );
+    }
+
+    if ( result == Chimera::Status::OK )
+    {
+      mContext->markTXReady( this );
+      mContext->signalEvent( CTX_EVT_TX );
+    }
+
+    return result;
+  }
+
+
+  Chimera::Status_t Socket::writePacket( const void *const data, const size_t bytes, TXCallback callback )
   {
+    if ( !data )
+    {
+      return Chimera::Status::INVAL_FUNC_PARAM;
+    }
+
+    PacketCopy source = { data, bytes };
+    return writePacket( source.filler(), bytes, callback );
+  }
+
+
+  Chimera::Status_t Socket::writePacket( const PacketFiller &filler, const size_t bytes, TXCallback callback )
+  {
+    const size_t limit = callback.is_valid() ? 0 : std::min<size_t>( mConfig.coalesceBytes, sizeof( mCoalesceBuffer ) );
+
+    Chimera::Status_t result = Chimera::Status::OK;
+    size_t delay             = 0;
+    bool queued              = false;
+    {
+      Chimera::Thread::LockGuard _lck( *this );
+
+      /*-----------------------------------------------------------------------
+      A socket running the codec produces the packet up front, so it can be
+      shrunk before deciding where it goes. Everything after sends the coded
+      record in its place.
+      -----------------------------------------------------------------------*/
+      PacketFiller source = filler;
+      size_t size         = bytes;
+      PacketCopy coded    = { nullptr, 0 };
+
+      if ( mCodec && mCodec->enabled() && ( bytes <= CODEC_MAX_RECORD ) )
+      {
+        if ( !mCodec->encode( filler, bytes, coded ) )
+        {
+          return Chimera::Status::FAIL;
+        }
+
+        source = coded.filler();
+        size   = coded.bytes;
+      }
+
+      const size_t record = coalescedSize( size );
+
+      /*-----------------------------------------------------------------------
+      Whatever was gathered goes first if this packet can't join it, so the
+      order is kept. If the queue is too full to take it, this packet is
+      refused as well.
+      -----------------------------------------------------------------------*/
+      const bool gather = ( record <= limit );
+      if ( mCoalesceSize && ( !gather || ( ( mCoalesceSize + record ) > limit ) ) )
+      {
+        result = unsafe_flush();
+        queued = ( result == Chimera::Status::OK );
+      }
+
+      if ( result == Chimera::Status::FULL )
+      {
+        delay = 0;
+      }
+      else if ( !gather )
+      {
+        /*---------------------------------------------------------------------
+        Packets too big to gather go out on their own
+        ---------------------------------------------------------------------*/
+        result = unsafe_enqueue( source, size, TRANSPORT_FLAG_NONE, callback );
+        queued = queued || ( result == Chimera::Status::OK );
+      }
+      else
+      {
+        /*---------------------------------------------------------------------
+        The packet is produced right where it is gathered. One that doesn't
+        fill its space is dropped without disturbing the others.
+        ---------------------------------------------------------------------*/
+        PacketWriter writer( mCoalesceBuffer + mCoalesceSize, record, nullptr, 0 );
+        if ( !source( writer ) || ( writer.written() != size ) )
+        {
+          result = Chimera::Status::FAIL;
+        }
+        else
+        {
+          if ( !mCoalesceSize )
+          {
+            mCoalesceStart = static_cast<uint32_t>( Chimera::micros() );
+          }
+
+          writer.pad( record - size );
+          mCoalesceSize += record;
+          result = Chimera::Status::OK;
+
+          /*-------------------------------------------------------------------
+          Send once full, otherwise let the context send it by the deadline.
+          A full queue holds the batch back, which the manager retries.
+          -------------------------------------------------------------------*/
+          if ( mCoalesceSize >= limit )
+          {
+            queued = ( unsafe_flush() == Chimera::Status::OK ) || queued;
+          }
+          else
+          {
+            delay = queued ? 0 : unsafe_coalesceDelay();
+          }
+        }
+      }
+
+      /*-----------------------------------------------------------------------
+      Only a record the socket took moves the codec on. A refused keyframe
+      leaves both ends on the reference they already share.
+      -----------------------------------------------------------------------*/
+      if ( coded.data && ( result == Chimera::Status::OK ) )
+      {
+        mCodec->commit();
+      }
+    }
+
+    mContext->markTXReady( this, delay );
+    if ( queued )
+    {
+      mContext->signalEvent( CTX_EVT_TX );
+    }
+
+    return result;
+  }
+
+
+  void Socket::getStatistics( SocketStats &stats )
+  {
+    Chimera::Thread::LockGuard _lck( *this );
+    stats              = mStats;
+    stats.arenaMem     = maxMem;
+    stats.allocatedMem = maxMem - mArena.available();
+    stats.memMisses    = mArena.misses();
+    stats.memAllocs    = mArena.allocs();
+  }
+
+
+  Chimera::Status_t Socket::flush()
+  {
+    Chimera::Status_t result = Chimera::Status::OK;
+    {
+      Chimera::Thread::LockGuard _lck( *this );
+      if ( !mCoalesceSize )
+      {
+        return result;
+      }
+
+      result = unsafe_flush();
+    }
+
+    /*-------------------------------------------------------------------------
+    A batch held back by a full queue is retried by the manager
+    -------------------------------------------------------------------------*/
+    mContext->markTXReady( this );
+    if ( result == Chimera::Status::OK )
+    {
+      mContext->signalEvent( CTX_EVT_TX );
+    }
+
+    return result;
+  }
+
+
+  Chimera::Status_t Socket::unsafe_enqueue( const void *const data, const size_t bytes, const uint16_t flags,
+                                            TXCallback callback )
+  {
+    if ( !data )
+    {
+      return Chimera::Status::FAIL;
+    }
+
+    PacketCopy source = { data, bytes };
+    return unsafe_enqueue( source.filler(), bytes, flags, callback );
+  }
+
+
+  Chimera::Status_t Socket::unsafe_enqueue( const PacketFiller &filler, const size_t bytes, const uint16_t flags,
+                                            TXCallback callback )
+  {
+    /*-------------------------------------------------------------------------
+    Refuse the packet before building it if there's no room to keep it
+    -------------------------------------------------------------------------*/
+    if ( unsafe_txFull() )
+    {
+      return Chimera::Status::FULL;
+    }
+
     /*-------------------------------------------------------------------------
     Create a header for the packet
     -------------------------------------------------------------------------*/
@@ -113,29 +515,122 @@ namespace Ripple
     header.dstPort    = mDestPort;
     header.srcPort    = mThisPort;
     header.srcAddress = mContext->getIPAddress();
-    header._pad       = 0;
+    header.flags      = flags;
 
     /*-------------------------------------------------------------------------
-    Push the packet to the queue
+    Size the fragments to what the outgoing interface can carry. Packets for
+    this node never leave it, so they stay in one piece without parity.
     -------------------------------------------------------------------------*/
-    Packet_sPtr newPacket = Transport::constructPacket( &mContext->mHeap, header, data, bytes );
-    auto result           = Chimera::Status::FAIL;
+    const RouteResult path  = mContext->route( mDestAddress );
+    size_t fragmentSize     = 0;
+    size_t unfragmentedSize = 0;
+    size_t maxFragments     = 0;
+    uint8_t parity          = mConfig.parityFragments;
+    if ( path.local )
+    {
+      fragmentSize     = header.dataLength;
+      unfragmentedSize = header.dataLength;
+      parity           = 0;
+    }
+    else if ( path.netif )
+    {
+      fragmentSize     = path.netif->maxTransferSize();
+      unfragmentedSize = path.netif->maxUnfragmentedSize();
+      maxFragments     = path.netif->maxNumFragments();
+    }
 
-    if ( newPacket )
+    /*-------------------------------------------------------------------------
+    Build the packet in the socket's arena and push it to the queue. Running
+    the arena dry only affects this socket, which is told about it.
+    -------------------------------------------------------------------------*/
+    const size_t misses   = mArena.misses();
+    Packet_sPtr newPacket =
+        Transport::constructPacket( &mArena, header, filler, bytes, fragmentSize, unfragmentedSize, parity, maxFragments );
+    if ( !newPacket )
     {
-      Chimera::Thread::LockGuard _lck( *this );
-      mTXQueue.push( newPacket );
-      result = Chimera::Status::OK;
+      /*-----------------------------------------------------------------------
+      Only a request the arena turned down is a memory problem. Anything else,
+      such as a packet too large for the netif, is a plain failure.
+      -----------------------------------------------------------------------*/
+      if ( mArena.misses() != misses )
+      {
+        LOG_ERROR_IF( DEBUG_MODULE, "Socket %d out of memory\r\n", mThisPort );
+        mCBService_registry.call<CallbackId::CB_OUT_OF_MEMORY>();
+        return Chimera::Status::MEMORY;
+      }
+
+      return Chimera::Status::FAIL;
     }
 
+    newPacket->timestamp_us = static_cast<uint32_t>( Chimera::micros() );
+    mTXQueue.push( { newPacket, callback } );
+    mStats.txPackets++;
+    RIPPLE_TRACE( TRC_SOCK_TX_ENQUEUE, mThisPort, bytes );
+    return Chimera::Status::OK;
+  }
+
+
+  bool Socket::unsafe_txFull() const
+  {
+    return mTXQueue.full() || ( mTXQueue.size() >= mConfig.txQueueDepth );
+  }
+
+
+  Chimera::Status_t Socket::unsafe_flush()
+  {
+    /*-------------------------------------------------------------------------
+    A full queue only holds the gathered packets back. Any other failure drops
+    them, as holding on to them would stall every packet written after.
+    -------------------------------------------------------------------------*/
+    const Chimera::Status_t result = unsafe_enqueue( mCoalesceBuffer, mCoalesceSize, TRANSPORT_FLAG_COALESCED );
+    if ( result == Chimera::Status::FULL )
+    {
+      return result;
+    }
+
+    if ( result != Chimera::Status::OK )
+    {
+      LOG_ERROR_IF( DEBUG_MODULE, "Dropped %d coalesced bytes\r\n", mCoalesceSize );
+    }
+
+    mCoalesceSize = 0;
     return result;
   }
 
 
+  size_t Socket::unsafe_coalesceDelay() const
+  {
+    const uint32_t elapsed = static_cast<uint32_t>( Chimera::micros() ) - mCoalesceStart;
+    if ( elapsed >= mConfig.coalesceDeadline )
+    {
+      return 0;
+    }
+
+    return ( ( mConfig.coalesceDeadline - elapsed ) + 999u ) / 1000u;
+  }
+
+
+  Chimera::Status_t Socket::unsafe_writeSegment( const void *const segment, const size_t bytes )
+  {
+    return unsafe_enqueue( segment, bytes, TRANSPORT_FLAG_STREAM );
+  }
+
+
+  RecordCodec *Socket::unsafe_codec()
+  {
+    if ( !mCodec )
+    {
+      void *mem = mArena.malloc( sizeof( RecordCodec ) );
+      mCodec    = mem ? new ( mem ) RecordCodec( &mArena ) : nullptr;
+    }
+
+    return mCodec;
+  }
+
+
   Chimera::Status_t Socket::read( void *const data, const size_t bytes )
   {
     Chimera::Thread::LockGuard sockLock( *this );
-    Chimera::Thread::LockGuard<Context> lock( *mContext );
 
     /*-------------------------------------------------------------------------
     Input Protection
@@ -149,18 +644,15 @@ namespace Ripple
       return Chimera::Status::EMPTY;
     }
 
-    Packet_sPtr packet       = mRXQueue.front();
-    Chimera::Status_t status = Chimera::Status::OK;
+    const Packet_sPtr &packet = mRXQueue.front();
+    Chimera::Status_t status  = Chimera::Status::OK;
 
     /*-------------------------------------------------------------------------
-    Build the full packet in some scratch memory
+    Received packets are reassembled into one block, so they're read in place
     -------------------------------------------------------------------------*/
-    const size_t packetSize    = packet->size();
-    const size_t crcDataOffset = offsetof( TransportHeader, dstPort );
-    const size_t dataSize      = packetSize - sizeof( TransportHeader );
-    uint8_t *scratch           = reinterpret_cast<uint8_t *>( mContext->malloc( packetSize ) );
-    memset( scratch, 0, packetSize );
-    packet->unpack( scratch, packetSize );
+    const uint8_t *raw      = packet->data();
+    const size_t packetSize = packet->size();
+    const size_t dataSize   = ( packetSize > sizeof( TransportHeader ) ) ? ( packetSize - sizeof( TransportHeader ) ) : 0;
 
     if( bytes < dataSize )
     {
@@ -169,42 +661,73 @@ namespace Ripple
     }
 
     /*-------------------------------------------------------------------------
-    Calculate the CRC over the packet data
-    -------------------------------------------------------------------------*/
-    etl::crc32 crc_gen;
-    crc_gen.reset();
-    crc_gen.add( scratch + crcDataOffset, scratch + packetSize );
-
-    auto hdr_ptr = reinterpret_cast<TransportHeader *>( scratch );
-
-    /*-------------------------------------------------------------------------
-    Read packet into the user buffer, tossing the first fragment (NET header)
+    Read packet into the user buffer, tossing the NET header
     -------------------------------------------------------------------------*/
-    uint32_t crc = crc_gen.value();
-    if ( hdr_ptr->crc == crc )
+    if ( packetIsIntact( raw, packetSize ) )
     {
-      memcpy( data, scratch + sizeof( TransportHeader ), bytes );
+      memcpy( data, raw + sizeof( TransportHeader ), dataSize );
     }
     else
     {
-      LOG_ERROR_IF( DEBUG_MODULE, "Packet CRC error!\r\n" );
+      LOG_ERROR_IF( DEBUG_MODULE, "Malformed packet!\r\n" );
       status = Chimera::Status::CRC_ERROR;
     }
 
     /*-------------------------------------------------------------------------
-    Free the packet and return the status
+    Free the packet and return the status. It lives in the context heap.
     -------------------------------------------------------------------------*/
-    mRXQueue.pop();
-    mContext->free( scratch );
+    {
+      Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> heapLock( mContext->mHeap );
+      mRXQueue.pop();
+    }
 
+    RIPPLE_TRACE( TRC_SOCK_RX_DEQUEUE, mThisPort, packetSize );
     return status;
   }
 
 
+  Chimera::Status_t Socket::readView( PacketView &view )
+  {
+    Chimera::Thread::LockGuard sockLock( *this );
+
+    if ( mRXQueue.empty() )
+    {
+      return Chimera::Status::EMPTY;
+    }
+
+    /*-------------------------------------------------------------------------
+    The packet leaves the queue either way. A good one is lent to the caller,
+    skipping the NET header. Whatever the view held before may be released
+    along with it, so both happen under the context heap lock.
+    -------------------------------------------------------------------------*/
+    const Packet_sPtr &packet = mRXQueue.front();
+    const size_t packetSize   = packet->size();
+    const bool intact         = packetIsIntact( packet->data(), packetSize );
+    RIPPLE_TRACE( TRC_SOCK_RX_DEQUEUE, mThisPort, packetSize );
+
+    {
+      Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> heapLock( mContext->mHeap );
+      if ( intact )
+      {
+        view = PacketView( packet, sizeof( TransportHeader ), packetSize - sizeof( TransportHeader ) );
+      }
+
+      mRXQueue.pop();
+    }
+
+    if ( !intact )
+    {
+      LOG_ERROR_IF( DEBUG_MODULE, "Malformed packet!\r\n" );
+      return Chimera::Status::CRC_ERROR;
+    }
+
+    return Chimera::Status::OK;
+  }
+
+
   size_t Socket::available()
   {
     Chimera::Thread::LockGuard sockLock( *this );
-    Chimera::Thread::LockGuard<Context> lock( *mContext );
 
     if ( mRXQueue.empty() )
     {
@@ -221,78 +744,227 @@ namespace Ripple
   void Socket::processData()
   {
     /*-----------------------------------------------------------------
-    Ensure thread safety on memory accesses
+    Take everything off the RX queue under the socket lock. Streams
+    consume their segments right away, the rest wait to be handed to
+    user handlers.
     -----------------------------------------------------------------*/
-    Chimera::Thread::LockGuard sockLock( *this );
-    Chimera::Thread::LockGuard<Context> lock( *mContext );
+    RXDispatchQueue dispatch;
+    bool streamPending = false;
+    {
+      Chimera::Thread::LockGuard sockLock( *this );
+      streamPending = unsafe_receivePackets( dispatch );
+    }
+
+    if ( streamPending )
+    {
+      mContext->markTXReady( this );
+      mContext->signalEvent( CTX_EVT_TX );
+    }
 
     /*-----------------------------------------------------------------
-    Process all pending packets
+    Run the handlers with no stack lock held, so a slow one can't stall
+    anything but this socket. Handlers are given a view straight into
+    the packet, which stays alive until they return.
     -----------------------------------------------------------------*/
-    auto bytesAvailable = this->available();
-    while ( bytesAvailable )
+    for ( const Packet_sPtr &packet : dispatch )
     {
+      mContext->mLatency.recordSince( LAT_DISPATCH, packet->timestamp_us );
+
+      const size_t packetSize       = packet->size();
+      const TransportHeader *header = reinterpret_cast<const TransportHeader *>( packet->data() );
+
       /*-----------------------------------------------------------------
-      Allocate temporary storage for the packet
+      Coalesced packets carry several application packets back to back,
+      each led by its own header. All others carry exactly one.
       -----------------------------------------------------------------*/
-      uint8_t *rxData = reinterpret_cast<uint8_t *>( mContext->malloc( bytesAvailable ) );
-      if ( !rxData )
+      const bool coalesced = ( header->flags & TRANSPORT_FLAG_COALESCED );
+      size_t offset        = sizeof( TransportHeader );
+
+      do
       {
-        LOG_ERROR( "Out of storage for socket\r\n" );
-        return;
-      }
+        const size_t used = dispatchPacket( packet, offset );
+        if ( !used )
+        {
+          break;
+        }
+
+        offset += used;
+      } while ( coalesced && ( offset < packetSize ) );
+    }
+
+    /*-----------------------------------------------------------------
+    Handlers are done with the packets. Drop them back into the
+    context heap under its lock.
+    -----------------------------------------------------------------*/
+    Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> heapLock( mContext->mHeap );
+    dispatch.clear();
+  }
+
+
+  bool Socket::unsafe_receivePackets( RXDispatchQueue &dispatch )
+  {
+    /*-----------------------------------------------------------------
+    Packets not handed on are freed with their queue entry, which puts
+    them back in the context heap
+    -----------------------------------------------------------------*/
+    while ( !mRXQueue.empty() )
+    {
+      unsafe_receivePacket( mRXQueue.front(), dispatch );
+
+      Chimera::Thread::LockGuard<Aurora::Memory::IHeapAllocator> heapLock( mContext->mHeap );
+      mRXQueue.pop();
+    }
+
+    return mStream && mStream->pending();
+  }
+
+
+  void Socket::unsafe_receivePacket( const Packet_sPtr &packet, RXDispatchQueue &dispatch )
+  {
+    const uint8_t *raw      = packet->data();
+    const size_t packetSize = packet->size();
+    RIPPLE_TRACE( TRC_SOCK_RX_DEQUEUE, mThisPort, packetSize );
+
+    if ( !packetIsIntact( raw, packetSize ) )
+    {
+      LOG_ERROR( "Packet read failure: %d\r\n", Chimera::Status::CRC_ERROR );
+      return;
+    }
+
+    mStats.rxPackets++;
+
+    /*-----------------------------------------------------------------
+    Stream segments go to the connection. A listening socket answers
+    whoever starts a sequence with it.
+    -----------------------------------------------------------------*/
+    const TransportHeader *header = reinterpret_cast<const TransportHeader *>( raw );
+    if ( !( header->flags & TRANSPORT_FLAG_STREAM ) )
+    {
+      dispatch.push_back( packet );
+      return;
+    }
+
+    if ( !mStream )
+    {
+      LOG_DEBUG( "Stream segment on non-stream socket %d\r\n", mThisPort );
+      return;
+    }
+
+    const size_t offset = sizeof( TransportHeader );
+    const bool started  = mStream->receive( raw + offset, packetSize - offset, Chimera::millis() );
+    if ( started && ( mDestPort == std::numeric_limits<Port>::max() ) )
+    {
+      mDestAddress = header->srcAddress;
+      mDestPort    = header->srcPort;
+    }
+  }
+
 
+  size_t Socket::dispatchPacket( const Packet_sPtr &packet, const size_t offset )
+  {
+    /*-----------------------------------------------------------------
+    Make sure the whole packet is there before reading it
+    -----------------------------------------------------------------*/
+    const uint8_t *record = packet->data() + offset;
+    const size_t bytes    = packet->size() - offset;
+    const PacketHdr *hdr  = reinterpret_cast<const PacketHdr *>( record );
+    if ( ( bytes < sizeof( PacketHdr ) ) || ( bytes < ( sizeof( PacketHdr ) + hdr->size ) ) )
+    {
+      LOG_ERROR( "Packet read failure: %d\r\n", Chimera::Status::CRC_ERROR );
+      return 0;
+    }
+
+    /*-----------------------------------------------------------------
+    Is the packet allowed to be received by the socket?
+    -----------------------------------------------------------------*/
+    if ( packetInFilter( hdr->id, mConfig.rxFilter ) )
+    {
       /*-----------------------------------------------------------------
-      Read out the data packet
+      Calculate the offset in to the buffer where the raw data lives
       -----------------------------------------------------------------*/
-      auto result = this->read( rxData, bytesAvailable );
+      const uint8_t *pktData = record + sizeof( PacketHdr );
+      size_t pktSize         = hdr->size;
+      Packet_sPtr source     = packet;
+      size_t sourceOffset    = offset + sizeof( PacketHdr );
 
       /*-----------------------------------------------------------------
-      Read the header and invoke the appropriate handler
+      Coded records are restored first. Dropping one doesn't disturb the
+      records gathered with it.
       -----------------------------------------------------------------*/
-      if ( result == Chimera::Status::OK )
+      uint8_t decoded[ CODEC_MAX_PAYLOAD ];
+      if ( hdr->codec != RECORD_CODEC_NONE )
       {
-        /*-----------------------------------------------------------------
-        Is the packet allowed to be received by the socket?
-        -----------------------------------------------------------------*/
-        PacketHdr *hdr = reinterpret_cast<PacketHdr *>( rxData );
-        if ( packetInFilter( hdr->id, mConfig.rxFilter ) )
         {
-          /*-----------------------------------------------------------------
-          Calculate the offset in to the buffer where the raw data lives
-          -----------------------------------------------------------------*/
-          uint8_t *pktData = rxData + sizeof( PacketHdr );
-
-          /*-----------------------------------------------------------------
-          Call the specific handler if available, else call default handler
-          -----------------------------------------------------------------*/
-          auto callbackIterator = mPktCallbacks.find( hdr->id );
-          if ( callbackIterator == mPktCallbacks.end() )
-          {
-            RT_HARD_ASSERT( mCommonPktCallback );
-            mCommonPktCallback( hdr->id, pktData, hdr->size );
-          }
-          else
+          Chimera::Thread::LockGuard _lck( *this );
+          RecordCodec *codec = unsafe_codec();
+          pktSize            = codec ? codec->decode( record, bytes, decoded ) : 0;
+        }
+
+        if ( !pktSize )
+        {
+          LOG_DEBUG( "Packet id [%d] couldn't be decoded\r\n", hdr->id );
+          return coalescedSize( sizeof( PacketHdr ) + hdr->size );
+        }
+
+        pktData = decoded;
+      }
+
+      /*-----------------------------------------------------------------
+      Call the specific handler if available, else call default handler.
+      Handlers taking a view win over raw ones at the same level. A view
+      of restored data needs a packet of its own to lend out.
+      -----------------------------------------------------------------*/
+      const PacketViewCallback viewCallback = mViewCallbacks[ hdr->id ];
+      const PacketCallback callback         = mPktCallbacks[ hdr->id ];
+
+      if ( viewCallback || ( !callback && mCommonViewCallback ) )
+      {
+        /*---------------------------------------------------------------
+        The arena has no lock of its own, so the lent packet is made and
+        given back under the socket's.
+        ---------------------------------------------------------------*/
+        if ( pktData == decoded )
+        {
+          Chimera::Thread::LockGuard _lck( *this );
+          source       = allocPacket( &mArena );
+          sourceOffset = 0;
+          if ( source && !source->pack( decoded, pktSize ) )
           {
-            callbackIterator->second( hdr->id, pktData, hdr->size );
+            source = Packet_sPtr();
           }
         }
-        else
+
+        if ( !source )
         {
-          LOG_DEBUG( "Packet id [%d] rejected by socket\r\n", hdr->id );
+          LOG_ERROR( "No memory to lend out packet id [%d]\r\n", hdr->id );
+          return coalescedSize( sizeof( PacketHdr ) + hdr->size );
         }
+
+        {
+          PacketView view( source, sourceOffset, pktSize );
+          ( viewCallback ? viewCallback : mCommonViewCallback )( hdr->id, view );
+
+          Chimera::Thread::LockGuard _lck( *this );
+          view.release();
+          source = Packet_sPtr();
+        }
+      }
+      else if ( !callback )
+      {
+        RT_HARD_ASSERT( mCommonPktCallback );
+        mCommonPktCallback( hdr->id, pktData, pktSize );
       }
       else
       {
-        LOG_ERROR( "Packet read failure: %d\r\n", result );
+        callback( hdr->id, pktData, pktSize );
       }
-
-      /*-----------------------------------------------------------------
-      Free the temporary storage and grab the next packet size
-      -----------------------------------------------------------------*/
-      mContext->free( rxData );
-      bytesAvailable = this->available();
     }
+    else
+    {
+      LOG_DEBUG( "Packet id [%d] rejected by socket\r\n", hdr->id );
+    }
+
+    return coalescedSize( sizeof( PacketHdr ) + hdr->size );
   }
 
 }    // namespace Ripple
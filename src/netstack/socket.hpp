@@ -17,8 +17,10 @@
 #include <cstddef>
 
 /* ETL Includes */
+#include <etl/delegate.h>
 #include <etl/list.h>
 #include <etl/queue.h>
+#include <etl/vector.h>
 
 /* Aurora Includes */
 #include <Aurora/memory>
@@ -28,8 +30,15 @@
 
 /* Ripple Includes */
 #include <Ripple/src/netif/device_intf.hpp>
+#include <Ripple/src/netstack/codec.hpp>
+#include <Ripple/src/netstack/config.hpp>
+#include <Ripple/src/netstack/memory_pool.hpp>
+#include <Ripple/src/netstack/stream.hpp>
 #include <Ripple/src/netstack/types.hpp>
+#include <Ripple/src/netstack/packets/packet.hpp>
+#include <Ripple/src/netstack/packets/registry.hpp>
 #include <Ripple/src/netstack/packets/types.hpp>
+#include <Ripple/src/netstack/packets/view.hpp>
 
 /*
 need some way of dynamically assigning packet lists for filtering and holding handlers.
@@ -46,6 +55,17 @@ namespace Ripple
   -------------------------------------------------------------------------------*/
   using Port = uint32_t;
 
+  /**
+   *  Told how a write went once the manager is done with it. OK means every
+   *  frame was admitted to the netif, anything else means it was dropped.
+   */
+  using TXCallback = etl::delegate<void( const Chimera::Status_t )>;
+
+  /**
+   *  Received packets waiting for their handlers to run
+   */
+  using RXDispatchQueue = etl::vector<Packet_sPtr, RIPPLE_SOCK_RX_QUEUE_DEPTH>;
+
   /*-------------------------------------------------------------------------------
   Constants
   -------------------------------------------------------------------------------*/
@@ -60,9 +80,24 @@ namespace Ripple
    */
   struct SocketConfig
   {
-    Port devicePort;       /**< Port the socket will listen on */
-    PacketFilter txFilter; /**< Packets the socket is allowed to TX */
-    PacketFilter rxFilter; /**< Packets the socket will allow to be RX'd */
+    Port devicePort;                                      /**< Port the socket will listen on */
+    PacketFilter txFilter;                                /**< Packets the socket is allowed to TX */
+    PacketFilter rxFilter;                                /**< Packets the socket will allow to be RX'd */
+    NetIf::TrafficClass trafficClass = NetIf::TC_DEFAULT; /**< Priority of the socket's outgoing traffic */
+    uint8_t parityFragments          = 0;                 /**< FEC parity fragments per fragmented packet */
+    size_t coalesceBytes             = 0;                 /**< Bytes of small packets to gather into one, 0 to disable */
+    size_t coalesceDeadline          = 0;                 /**< Longest a gathered packet waits to be sent (uS) */
+    size_t txQueueDepth = RIPPLE_SOCK_TX_QUEUE_DEPTH;     /**< Packets waiting to send before writes are refused */
+    size_t codecKeyframes            = 0;                 /**< Samples per codec keyframe, 0 to send packets plain */
+  };
+
+  /**
+   * @brief A packet waiting to be sent and who to tell when it is
+   */
+  struct TXRequest
+  {
+    Packet_sPtr packet;  /**< Packet to send */
+    TXCallback callback; /**< Optional completion callback */
   };
 
   /**
@@ -73,30 +108,23 @@ namespace Ripple
     size_t txPackets;
     size_t rxPackets;
 
-    size_t allocatedMem;
+    size_t arenaMem;     /**< Bytes in the socket's arena */
+    size_t allocatedMem; /**< Arena bytes currently in use */
+    size_t memMisses;    /**< Allocations the arena couldn't fit */
+    size_t memAllocs;    /**< Allocations asked of the arena */
   };
 
-  /*-------------------------------------------------------------------------------
-  Public Functions
-  -------------------------------------------------------------------------------*/
-  /**
-   * @brief Checks if a packet is in the given filter
-   *
-   * @param pkt       Packet to look for
-   * @param filter    Which filter to look in
-   * @return true     The packet is in the filter
-   * @return false    The packet is not in the filter
-   */
-  bool packetInFilter( const PacketId pkt, const PacketFilter &filter );
-
   /*-------------------------------------------------------------------------------
   Classes
   -------------------------------------------------------------------------------*/
   /**
    *  Defines a single interface to transmit/receive data on the network.
    *  Must be created by a network context manager.
+   *
+   *  Packets the socket sends are built in its own arena. CB_OUT_OF_MEMORY
+   *  is raised on the socket when the arena can't fit one.
    */
-  class Socket : public Chimera::Thread::Lockable<Socket>
+  class Socket : public Chimera::Thread::Lockable<Socket>, public Chimera::Callback::DelegateService<Socket, CallbackId>
   {
   public:
     ~Socket();
@@ -139,6 +167,57 @@ namespace Ripple
      */
     void getStatistics( SocketStats &stats );
 
+    /**
+     *  Sends any packets gathered for coalescing right away
+     *  @return Chimera::Status_t
+     */
+    Chimera::Status_t flush();
+
+    /**
+     *  Queues bytes on a STREAM socket's connection. They arrive at the peer
+     *  in order, or the stream reports failed().
+     *
+     *  @param[in]  data      Bytes to send
+     *  @param[in]  bytes     Number of bytes
+     *  @return size_t        Bytes accepted, less than asked once the send buffer fills
+     */
+    size_t streamWrite( const void *const data, const size_t bytes );
+
+    /**
+     *  Takes bytes received on a STREAM socket's connection, in order
+     *
+     *  @param[out] data      Where to copy to
+     *  @param[in]  bytes     Most bytes to take
+     *  @return size_t        Bytes copied
+     */
+    size_t streamRead( void *const data, const size_t bytes );
+
+    /**
+     *  Gets how many received stream bytes are waiting to be read
+     *  @return size_t
+     */
+    size_t streamAvailable();
+
+    /**
+     *  Checks if the stream gave up on the peer after too many retransmits
+     *  @return bool
+     */
+    bool streamFailed();
+
+    /**
+     * @brief Gather statistics for the socket's stream
+     *
+     * @param stats   Output object for the gathered data
+     */
+    void getStreamStats( StreamStats &stats );
+
+    /**
+     * @brief Gather statistics for the socket's packet codec
+     *
+     * @param stats   Output object for the gathered data
+     */
+    void getCodecStats( CodecStats &stats );
+
     /**
      *  Comparison function for list sorting
      */
@@ -161,9 +240,12 @@ namespace Ripple
 
   protected:
     friend class Context;
-    friend bool transmit( const PacketId, Socket &, const void *const, const size_t );
+    friend bool transmitEncoded( const PacketId, const pb_msgdesc_t *const, const size_t, Socket &, const void *const,
+                                 TXCallback, const size_t );
     friend bool onReceive( const PacketId, Socket &, PacketCallback );
     friend bool onReceive( Socket &, PacketCallback );
+    friend bool onReceive( const PacketId, Socket &, PacketViewCallback );
+    friend bool onReceive( Socket &, PacketViewCallback );
 
     /**
      * @brief Construct a new Socket object
@@ -171,20 +253,49 @@ namespace Ripple
      * Used by the context manager for creating a new object with
      * dynamically allocated memory.
      *
-     * @param ctx     Context manager to use
-     * @param type    What type of socket this is
-     * @param memory  How much memory should be allocated for socket use
+     * @param ctx       Context manager to use
+     * @param type      What type of socket this is
+     * @param arena     Memory for the socket's private heap, word aligned
+     * @param arenaSize Bytes of arena memory
      */
-    Socket( Context_rPtr ctx, const SocketType type, const size_t memory );
+    Socket( Context_rPtr ctx, const SocketType type, void *const arena, const size_t arenaSize );
 
     /**
      *  @brief Low level function to write a number of bytes into a connection stream
      *
      *  @param[in]  data      Data to write
      *  @param[in]  bytes     Number of bytes to write
+     *  @param[in]  callback  Optional callback for when the write completes or fails
      *  @return Chimera::Status_t
+     *
+     *  @retval Chimera::Status::OK     Queued to send
+     *  @retval Chimera::Status::FULL   Queue is at its depth, try again later
+     *  @retval Chimera::Status::MEMORY Socket arena is out of memory
+     *  @retval Chimera::Status::FAIL   Packet couldn't be built
+     */
+    Chimera::Status_t write( const void *const data, const size_t bytes, TXCallback callback = TXCallback() );
+
+    /**
+     *  @brief Writes one application packet, gathering it with others if the
+     *  socket is configured to coalesce
+     *
+     *  @param[in]  data      Packet, starting with its PacketHdr
+     *  @param[in]  bytes     Number of bytes in the packet
+     *  @param[in]  callback  Optional completion callback. Packets with one are never gathered.
+     *  @return Chimera::Status_t   Same as write()
+     */
+    Chimera::Status_t writePacket( const void *const data, const size_t bytes, TXCallback callback = TXCallback() );
+
+    /**
+     *  @brief Writes one application packet that is produced in place, either
+     *  straight into the gathering buffer or into the packet that carries it
+     *
+     *  @param[in]  filler    Writes exactly bytes of the packet, starting with its PacketHdr
+     *  @param[in]  bytes     Number of bytes in the packet
+     *  @param[in]  callback  Optional completion callback. Packets with one are never gathered.
+     *  @return Chimera::Status_t   Same as write()
      */
-    Chimera::Status_t write( const void *const data, const size_t bytes );
+    Chimera::Status_t writePacket( const PacketFiller &filler, const size_t bytes, TXCallback callback = TXCallback() );
 
     /**
      *  @brief Low level function to read a number of bytes out from the connection stream
@@ -195,6 +306,22 @@ namespace Ripple
      */
     Chimera::Status_t read( void *const data, const size_t bytes );
 
+    /**
+     *  @brief Takes the next packet out of the connection stream without copying it
+     *
+     *  The view lends out the packet's memory until it is released or destroyed.
+     *  That memory comes out of the context heap, so don't hold on to it longer
+     *  than needed.
+     *
+     *  @param[out] view      Set to the data after the transport header
+     *  @return Chimera::Status_t
+     *
+     *  @retval Chimera::Status::OK         The view holds the packet
+     *  @retval Chimera::Status::EMPTY      Nothing to read
+     *  @retval Chimera::Status::CRC_ERROR  The packet was malformed and dropped
+     */
+    Chimera::Status_t readView( PacketView &view );
+
     /**
      *  @brief Queries the number of bytes available to read from the the connection stream
      *  @return size_t
@@ -206,15 +333,103 @@ namespace Ripple
      *
      * Handles reading data out of the RX queue and translating that into
      * packets. Upon reception of a good packet, calls reception handler.
+     * Must be called without any stack lock held, as handlers run inline.
      */
     void processData();
 
+    /**
+     * @brief Empties the RX queue. Socket must be locked.
+     *
+     * @param dispatch    Packets to hand to user handlers once unlocked
+     * @return bool       True if a stream now has segments to send
+     */
+    bool unsafe_receivePackets( RXDispatchQueue &dispatch );
+
+    /**
+     * @brief Takes in one packet off the RX queue. Socket must be locked.
+     *
+     * @param packet      Packet at the front of the RX queue
+     * @param dispatch    Packets to hand to user handlers once unlocked
+     * @return void
+     */
+    void unsafe_receivePacket( const Packet_sPtr &packet, RXDispatchQueue &dispatch );
+
+    /**
+     * @brief Builds a transport packet and queues it to send. Socket must be locked.
+     *
+     * @param data        Payload of the packet
+     * @param bytes       Bytes in the payload
+     * @param flags       bfTransportFlags to set in the header
+     * @param callback    Optional completion callback
+     * @return Chimera::Status_t
+     */
+    Chimera::Status_t unsafe_enqueue( const void *const data, const size_t bytes, const uint16_t flags,
+                                      TXCallback callback = TXCallback() );
+
+    /**
+     * @brief Builds a transport packet from a filler and queues it to send. Socket must be locked.
+     *
+     * @param filler      Writes exactly bytes of payload into the packet
+     * @param bytes       Bytes in the payload
+     * @param flags       bfTransportFlags to set in the header
+     * @param callback    Optional completion callback
+     * @return Chimera::Status_t
+     */
+    Chimera::Status_t unsafe_enqueue( const PacketFiller &filler, const size_t bytes, const uint16_t flags,
+                                      TXCallback callback = TXCallback() );
+
+    /**
+     * @brief Checks if the TX queue has reached its depth. Socket must be locked.
+     * @return bool
+     */
+    bool unsafe_txFull() const;
+
+    /**
+     * @brief Queues the gathered packets as one transport packet. Socket must be locked.
+     *
+     * The packets are kept if the queue is full. Any other failure drops them.
+     *
+     * @return Chimera::Status_t
+     */
+    Chimera::Status_t unsafe_flush();
+
+    /**
+     * @brief Gets how long the gathered packets may still wait. Socket must be locked.
+     * @return size_t     Time left (ms), rounded up
+     */
+    size_t unsafe_coalesceDelay() const;
+
+    /**
+     * @brief Queues one stream segment to the connected peer. Socket must be locked.
+     *
+     * @param segment     Segment, starting with its StreamHeader
+     * @param bytes       Bytes in the segment
+     * @return Chimera::Status_t   Same as unsafe_enqueue()
+     */
+    Chimera::Status_t unsafe_writeSegment( const void *const segment, const size_t bytes );
+
+    /**
+     * @brief Gets the codec, making it on first use. Socket must be locked.
+     * @return RecordCodec*   nullptr if the arena is out of memory
+     */
+    RecordCodec *unsafe_codec();
 
-    size_t maxMem;   /**< Maximum memory assigned to this socket */
-    size_t allocMem; /**< Currently allocated memory */
+    /**
+     * @brief Hands one application packet to its handler
+     *
+     * @param packet      Transport packet holding the record
+     * @param offset      Where the record's PacketHdr starts in the packet
+     * @return size_t     Bytes the record takes up, or zero if it is malformed
+     */
+    size_t dispatchPacket( const Packet_sPtr &packet, const size_t offset );
 
-    PacketQueue<5> mTXQueue;
-    PacketQueue<5> mRXQueue;
+
+    size_t maxMem;      /**< Maximum memory assigned to this socket */
+    SocketArena mArena; /**< Private heap the socket builds its packets in */
+    SocketStats mStats;
+
+    etl::queue<TXRequest, RIPPLE_SOCK_TX_QUEUE_DEPTH> mTXQueue;
+    PacketQueue<RIPPLE_SOCK_RX_QUEUE_DEPTH> mRXQueue;
 
     Port mThisPort;         /**< Port of this socket */
     IPAddress mDestAddress; /**< Destination network address */
@@ -222,13 +437,35 @@ namespace Ripple
     SocketConfig mConfig;
 
     PacketCallback mCommonPktCallback;
-    etl::map<PacketId, PacketCallback, 10> mPktCallbacks;
+    PacketCallback mPktCallbacks[ NUM_PACKET_IDS ];      /**< Handlers indexed by packet ID */
+    PacketViewCallback mCommonViewCallback;              /**< Any packet, given as a view. Beats mCommonPktCallback. */
+    PacketViewCallback mViewCallbacks[ NUM_PACKET_IDS ]; /**< Handlers given a view, beating mPktCallbacks */
+
+    uint8_t mCoalesceBuffer[ RIPPLE_SOCK_COALESCE_BYTES ]; /**< Packets gathered to be sent together */
+    size_t mCoalesceSize;                                  /**< Bytes gathered */
+    uint32_t mCoalesceStart;                               /**< When the first gathered packet was written (uS) */
+
+    Stream *mStream;     /**< Connection state of STREAM sockets, nullptr for all others */
+    RecordCodec *mCodec; /**< Made once coding is enabled or a coded record arrives, nullptr until then */
+
+    Socket *mTXNext;    /**< Next socket on the context's TX ready list. Guarded by the context lock. */
+    size_t mTXDueTime;  /**< When the context must next service the socket (ms). Guarded by the context lock. */
+    bool mTXPending;    /**< Socket is on the context's TX ready list. Guarded by the context lock. */
 
   private:
     Context_rPtr mContext;
     SocketType mSocketType;
   };
 
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Space a socket object takes at the front of its cache, rounded up so the
+   *  arena that follows stays aligned
+   */
+  static constexpr size_t SOCKET_OBJECT_BYTES =
+      ( sizeof( Socket ) + alignof( std::max_align_t ) - 1u ) & ~( alignof( std::max_align_t ) - 1u );
 
 }    // namespace Ripple
 
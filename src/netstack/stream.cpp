@@ -0,0 +1,506 @@
+/********************************************************************************
+ *  File Name:
+ *    stream.cpp
+ *
+ *  Description:
+ *    Reliable, ordered byte stream carried over transport packets
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <algorithm>
+#include <cstring>
+
+/* Chimera Includes */
+#include <Chimera/thread>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/stream.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Checks if sequence number a comes before b, allowing for wrap around
+   */
+  static constexpr bool seqBefore( const uint32_t a, const uint32_t b )
+  {
+    return static_cast<int32_t>( a - b ) < 0;
+  }
+
+
+  /**
+   * @brief Gets the time left on a timer, or zero if it expired
+   */
+  static constexpr size_t timeLeft( const size_t now, const size_t start, const size_t timeout )
+  {
+    return ( ( now - start ) < timeout ) ? ( timeout - ( now - start ) ) : 0;
+  }
+
+
+  /*-------------------------------------------------------------------------------
+  Stream Class
+  -------------------------------------------------------------------------------*/
+  Stream::Stream()
+  {
+    close();
+  }
+
+
+  void Stream::open( const size_t now )
+  {
+    /*-------------------------------------------------------------------------
+    Pick a starting point unlikely to match the last connection, so stale
+    segments from it can't be mistaken for this one
+    -------------------------------------------------------------------------*/
+    mTXData.clear();
+    mInFlightHead  = 0;
+    mInFlightCount = 0;
+
+    mISN        = static_cast<uint32_t>( now ) * 2654435761u;
+    mSndUna     = mISN;
+    mSndNxt     = mISN;
+    mSndMax     = mISN;
+    mResendTo   = mISN;
+    mPeerWindow = RIPPLE_STREAM_SEGMENT_BYTES;
+    mProbeTime  = now;
+    mRetries    = 0;
+    mRTTVar     = 0;
+    mTXOpen     = true;
+    mFailed     = false;
+
+    mStats.srtt = 0;
+    mStats.rto  = RIPPLE_STREAM_RTO_INIT;
+  }
+
+
+  void Stream::close()
+  {
+    mTXData.clear();
+    mRXData.clear();
+    mInFlightHead  = 0;
+    mInFlightCount = 0;
+
+    mTXOpen     = false;
+    mRXSynced   = false;
+    mFailed     = false;
+    mAckPending = false;
+    mRstPending = false;
+
+    mISN        = 0;
+    mSndUna     = 0;
+    mSndNxt     = 0;
+    mSndMax     = 0;
+    mResendTo   = 0;
+    mPeerISN    = 0;
+    mRcvNxt     = 0;
+    mRstAck     = 0;
+    mPeerWindow = 0;
+    mProbeTime  = 0;
+    mRetries    = 0;
+    mRTTVar     = 0;
+
+    memset( &mStats, 0, sizeof( mStats ) );
+    mStats.rto = RIPPLE_STREAM_RTO_INIT;
+  }
+
+
+  size_t Stream::write( const void *const data, const size_t bytes )
+  {
+    if ( !mTXOpen || mFailed || !data )
+    {
+      return 0;
+    }
+
+    return mTXData.push( data, bytes );
+  }
+
+
+  size_t Stream::read( void *const data, const size_t bytes )
+  {
+    if ( !data )
+    {
+      return 0;
+    }
+
+    const size_t count     = std::min( bytes, mRXData.size() );
+    const bool wasTooSmall = ( mRXData.space() < RIPPLE_STREAM_SEGMENT_BYTES );
+
+    mRXData.peek( 0, data, count );
+    mRXData.drop( count );
+
+    /*-------------------------------------------------------------------------
+    Tell the sender once there is room for a whole segment again, otherwise it
+    would wait on its window probe timer
+    -------------------------------------------------------------------------*/
+    if ( count && wasTooSmall && ( mRXData.space() >= RIPPLE_STREAM_SEGMENT_BYTES ) )
+    {
+      mAckPending = true;
+    }
+
+    return count;
+  }
+
+
+  size_t Stream::available() const
+  {
+    return mRXData.size();
+  }
+
+
+  bool Stream::pending() const
+  {
+    if ( mAckPending || mRstPending )
+    {
+      return true;
+    }
+
+    if ( !mTXOpen || mFailed || ( mInFlightCount >= RIPPLE_STREAM_WINDOW ) )
+    {
+      return false;
+    }
+
+    const size_t outstanding = mSndNxt - mSndUna;
+    return ( mTXData.size() > outstanding ) && ( mPeerWindow > outstanding );
+  }
+
+
+  bool Stream::receive( const uint8_t *const segment, const size_t bytes, const size_t now )
+  {
+    if ( !segment || ( bytes < sizeof( StreamHeader ) ) )
+    {
+      mStats.rxDropped++;
+      return false;
+    }
+
+    StreamHeader hdr;
+    memcpy( &hdr, segment, sizeof( hdr ) );
+
+    const uint8_t *payload = segment + sizeof( StreamHeader );
+    const size_t length    = bytes - sizeof( StreamHeader );
+
+    /*-------------------------------------------------------------------------
+    The peer has no connection for what this side sent, either because the
+    SYN was lost or because it started over. Only an RST naming a segment
+    that is still outstanding counts, stale or stray ones are ignored. The
+    unacknowledged bytes are then sent again from a new SYN, which the peer
+    syncs to. Every try counts against the retry limit.
+    -------------------------------------------------------------------------*/
+    if ( hdr.flags & STREAM_FLAG_RST )
+    {
+      if ( mTXOpen && !mFailed && !seqBefore( hdr.ack, mSndUna ) && !seqBefore( mSndMax, hdr.ack ) )
+      {
+        if ( ++mRetries > RIPPLE_STREAM_MAX_RETRIES )
+        {
+          mFailed = true;
+          mTXData.clear();
+          mInFlightCount = 0;
+        }
+        else
+        {
+          mISN           = mSndUna;
+          mResendTo      = mSndMax;
+          mSndNxt        = mSndUna;
+          mInFlightCount = 0;
+        }
+      }
+
+      return false;
+    }
+
+    /*-------------------------------------------------------------------------
+    A SYN from a new sequence restarts the incoming half. One repeated from the
+    current sequence is just a retransmit.
+    -------------------------------------------------------------------------*/
+    bool started = false;
+    if ( ( hdr.flags & STREAM_FLAG_SYN ) && ( !mRXSynced || ( hdr.seq != mPeerISN ) ) )
+    {
+      mPeerISN  = hdr.seq;
+      mRcvNxt   = hdr.seq;
+      mRXSynced = true;
+      mRXData.clear();
+      started = true;
+    }
+
+    /*-------------------------------------------------------------------------
+    Only the next expected bytes are taken. Anything else is dropped and
+    answered with the cumulative ACK, which prompts the sender to go back.
+    -------------------------------------------------------------------------*/
+    if ( length || ( hdr.flags & STREAM_FLAG_PROBE ) )
+    {
+      if ( !mRXSynced )
+      {
+        mRstPending = true;
+        mRstAck     = hdr.seq;
+      }
+      else
+      {
+        if ( length && ( hdr.seq == mRcvNxt ) && ( length <= mRXData.space() ) )
+        {
+          mRXData.push( payload, length );
+          mRcvNxt += static_cast<uint32_t>( length );
+          mStats.rxSegments++;
+        }
+        else if ( length )
+        {
+          mStats.rxDropped++;
+        }
+
+        mAckPending = true;
+      }
+    }
+
+    if ( hdr.flags & STREAM_FLAG_ACK )
+    {
+      onAck( hdr.ack, hdr.window, now );
+    }
+
+    return started;
+  }
+
+
+  size_t Stream::service( const size_t now, StreamWriter &writer )
+  {
+    if ( mRstPending && ( sendSegment( mSndNxt, 0, STREAM_FLAG_RST, writer ) == Chimera::Status::OK ) )
+    {
+      mRstPending = false;
+    }
+
+    if ( mTXOpen && !mFailed )
+    {
+      /*-----------------------------------------------------------------------
+      Go back to the oldest unacknowledged byte if it has waited too long
+      -----------------------------------------------------------------------*/
+      if ( mInFlightCount && !timeLeft( now, mInFlight[ mInFlightHead ].sentTime, mStats.rto ) )
+      {
+        onTimeout();
+      }
+
+      /*-----------------------------------------------------------------------
+      A closed window is probed in case the update reopening it was lost
+      -----------------------------------------------------------------------*/
+      const size_t unsent = mTXData.size() - ( mSndNxt - mSndUna );
+      if ( !mFailed && !mInFlightCount && unsent && !mPeerWindow && !timeLeft( now, mProbeTime, mStats.rto ) )
+      {
+        if ( sendSegment( mSndNxt, 0, STREAM_FLAG_PROBE, writer ) == Chimera::Status::OK )
+        {
+          mProbeTime = now;
+        }
+      }
+
+      /*-----------------------------------------------------------------------
+      Fill the window with new segments, or resent ones after a timeout
+      -----------------------------------------------------------------------*/
+      while ( !mFailed && ( mInFlightCount < RIPPLE_STREAM_WINDOW ) )
+      {
+        const size_t outstanding = mSndNxt - mSndUna;
+        const size_t usable      = ( mPeerWindow > outstanding ) ? ( mPeerWindow - outstanding ) : 0;
+        const size_t wanted      = std::min<size_t>( mTXData.size() - outstanding, RIPPLE_STREAM_SEGMENT_BYTES );
+        const size_t length      = std::min( wanted, usable );
+
+        /*---------------------------------------------------------------------
+        Don't chop a segment down to fit a sliver of window while ACKs are
+        still coming that will open it up
+        ---------------------------------------------------------------------*/
+        if ( !length || ( ( length < wanted ) && mInFlightCount ) )
+        {
+          break;
+        }
+
+        if ( sendSegment( mSndNxt, length, STREAM_FLAG_NONE, writer ) != Chimera::Status::OK )
+        {
+          break;
+        }
+
+        InFlight &seg = mInFlight[ ( mInFlightHead + mInFlightCount ) % RIPPLE_STREAM_WINDOW ];
+        seg.seq       = mSndNxt;
+        seg.length    = static_cast<uint16_t>( length );
+        seg.resent    = seqBefore( mSndNxt, mResendTo );
+        seg.sentTime  = now;
+        mInFlightCount++;
+
+        if ( seg.resent )
+        {
+          mStats.retransmits++;
+        }
+
+        mSndNxt += static_cast<uint32_t>( length );
+        if ( seqBefore( mSndMax, mSndNxt ) )
+        {
+          mSndMax = mSndNxt;
+        }
+
+        mProbeTime = now;
+      }
+    }
+
+    /*-------------------------------------------------------------------------
+    Data segments carry the ACK, so one on its own is only needed when none
+    went out
+    -------------------------------------------------------------------------*/
+    if ( mAckPending )
+    {
+      sendSegment( mSndNxt, 0, STREAM_FLAG_NONE, writer );
+    }
+
+    /*-------------------------------------------------------------------------
+    Work out when the stream next needs to run
+    -------------------------------------------------------------------------*/
+    size_t delay = STREAM_IDLE;
+
+    if ( pending() )
+    {
+      delay = RIPPLE_CTX_TX_RETRY_DELAY;
+    }
+
+    if ( mTXOpen && !mFailed )
+    {
+      if ( mInFlightCount )
+      {
+        delay = std::min( delay, timeLeft( now, mInFlight[ mInFlightHead ].sentTime, mStats.rto ) );
+      }
+      else if ( !mPeerWindow && ( mTXData.size() > ( mSndNxt - mSndUna ) ) )
+      {
+        delay = std::min( delay, timeLeft( now, mProbeTime, mStats.rto ) );
+      }
+    }
+
+    return delay;
+  }
+
+
+  Chimera::Status_t Stream::sendSegment( const uint32_t seq, const size_t length, const uint8_t flags,
+                                         StreamWriter &writer )
+  {
+    StreamHeader hdr;
+    hdr.seq    = seq;
+    hdr.ack    = ( flags & STREAM_FLAG_RST ) ? mRstAck : mRcvNxt;
+    hdr.window = static_cast<uint16_t>( std::min<size_t>( mRXData.space(), std::numeric_limits<uint16_t>::max() ) );
+    hdr.flags  = flags;
+    hdr._pad   = 0;
+
+    if ( mRXSynced )
+    {
+      hdr.flags |= STREAM_FLAG_ACK;
+    }
+
+    if ( mTXOpen && ( seq == mISN ) )
+    {
+      hdr.flags |= STREAM_FLAG_SYN;
+    }
+
+    memcpy( mScratch, &hdr, sizeof( hdr ) );
+    mTXData.peek( seq - mSndUna, mScratch + sizeof( hdr ), length );
+
+    const Chimera::Status_t result = writer( mScratch, sizeof( hdr ) + length );
+    if ( result == Chimera::Status::OK )
+    {
+      mStats.txSegments++;
+      mAckPending = false;
+    }
+
+    return result;
+  }
+
+
+  void Stream::onAck( const uint32_t ack, const size_t window, const size_t now )
+  {
+    /*-------------------------------------------------------------------------
+    Only ACKs for bytes that were actually sent count
+    -------------------------------------------------------------------------*/
+    if ( !mTXOpen || mFailed || seqBefore( ack, mSndUna ) || seqBefore( mSndMax, ack ) )
+    {
+      return;
+    }
+
+    mPeerWindow = window;
+
+    const uint32_t acked = ack - mSndUna;
+    if ( !acked )
+    {
+      return;
+    }
+
+    mTXData.drop( acked );
+    mSndUna  = ack;
+    mRetries = 0;
+
+    if ( seqBefore( mSndNxt, ack ) )
+    {
+      mSndNxt = ack;
+    }
+
+    /*-------------------------------------------------------------------------
+    Release the segments now fully covered. Only ones sent once give a clean
+    round trip sample.
+    -------------------------------------------------------------------------*/
+    while ( mInFlightCount )
+    {
+      const InFlight &seg = mInFlight[ mInFlightHead ];
+      if ( seqBefore( ack, seg.seq + seg.length ) )
+      {
+        break;
+      }
+
+      if ( !seg.resent )
+      {
+        sampleRTT( now - seg.sentTime );
+      }
+
+      mInFlightHead = ( mInFlightHead + 1u ) % RIPPLE_STREAM_WINDOW;
+      mInFlightCount--;
+    }
+  }
+
+
+  void Stream::onTimeout()
+  {
+    /*-------------------------------------------------------------------------
+    Give up once the peer has gone quiet for too long
+    -------------------------------------------------------------------------*/
+    if ( ++mRetries > RIPPLE_STREAM_MAX_RETRIES )
+    {
+      mFailed = true;
+      mTXData.clear();
+      mInFlightCount = 0;
+      return;
+    }
+
+    /*-------------------------------------------------------------------------
+    Everything after the last ACK gets sent again, and the timer backs off in
+    case the link is congested rather than lossy
+    -------------------------------------------------------------------------*/
+    mResendTo      = mSndMax;
+    mSndNxt        = mSndUna;
+    mInFlightCount = 0;
+    mStats.rto     = std::min<size_t>( mStats.rto * 2u, RIPPLE_STREAM_RTO_MAX );
+  }
+
+
+  void Stream::sampleRTT( const size_t rtt )
+  {
+    /*-------------------------------------------------------------------------
+    Smooth the samples and their variation (RFC 6298), in whole ms
+    -------------------------------------------------------------------------*/
+    const size_t sample = std::max<size_t>( rtt, 1u );
+
+    if ( !mStats.srtt )
+    {
+      mStats.srtt = sample;
+      mRTTVar     = sample / 2u;
+    }
+    else
+    {
+      const size_t diff = ( mStats.srtt > sample ) ? ( mStats.srtt - sample ) : ( sample - mStats.srtt );
+      mRTTVar           = ( ( 3u * mRTTVar ) + diff ) / 4u;
+      mStats.srtt       = ( ( 7u * mStats.srtt ) + sample ) / 8u;
+    }
+
+    const size_t rto = mStats.srtt + std::max<size_t>( 4u * mRTTVar, 1u );
+    mStats.rto       = std::clamp<size_t>( rto, RIPPLE_STREAM_RTO_MIN, RIPPLE_STREAM_RTO_MAX );
+  }
+
+}    // namespace Ripple
@@ -0,0 +1,301 @@
+/********************************************************************************
+ *  File Name:
+ *    stream.hpp
+ *
+ *  Description:
+ *    Reliable, ordered byte stream carried over transport packets. Uses a
+ *    sliding window of in-flight segments with cumulative ACKs, retransmit
+ *    timers derived from the measured RTT, and receiver flow control.
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_NETSTACK_STREAM_HPP
+#define RIPPLE_NETSTACK_STREAM_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+/* ETL Includes */
+#include <etl/delegate.h>
+
+/* Chimera Includes */
+#include <Chimera/common>
+
+/* Ripple Includes */
+#include <Ripple/src/netstack/config.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Aliases
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Hands a finished segment to the transport layer. Anything other than OK
+   *  means the segment wasn't taken and will be built again later.
+   */
+  using StreamWriter = etl::delegate<Chimera::Status_t( const void *const, const size_t )>;
+
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr size_t STREAM_IDLE = std::numeric_limits<size_t>::max(); /**< No stream timer is running */
+
+  /*-------------------------------------------------------------------------------
+  Enumerations
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Options carried in StreamHeader::flags
+   */
+  enum bfStreamFlags : uint8_t
+  {
+    STREAM_FLAG_NONE  = 0,
+    STREAM_FLAG_SYN   = ( 1u << 0 ), /**< Segment starts the sender's sequence space */
+    STREAM_FLAG_ACK   = ( 1u << 1 ), /**< The ack and window fields are valid */
+    STREAM_FLAG_RST   = ( 1u << 2 ), /**< Receiver has no connection for the segment at ack */
+    STREAM_FLAG_PROBE = ( 1u << 3 ), /**< Asks for an ACK while the peer window is closed */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Leads the payload of every stream segment, right after the TransportHeader
+   */
+  struct StreamHeader
+  {
+    uint32_t seq;    /**< Sequence number of the first payload byte */
+    uint32_t ack;    /**< Next sequence number expected from the peer */
+    uint16_t window; /**< Bytes the sender of this segment can still take in */
+    uint8_t flags;   /**< Bit field of bfStreamFlags */
+    uint8_t _pad;    /**< Padding for alignment */
+  };
+
+  struct StreamStats
+  {
+    size_t txSegments;  /**< Segments sent, including retransmits and ACKs */
+    size_t retransmits; /**< Segments sent again after a timeout */
+    size_t rxSegments;  /**< Segments accepted in order */
+    size_t rxDropped;   /**< Segments dropped as out of order or over the window */
+    size_t srtt;        /**< Smoothed round trip time (ms) */
+    size_t rto;         /**< Current retransmit timeout (ms) */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   * @brief Fixed size FIFO of bytes that can be read at an offset
+   *
+   * @tparam SIZE   Bytes of storage
+   */
+  template<size_t SIZE>
+  class ByteRing
+  {
+  public:
+    void clear()
+    {
+      mHead  = 0;
+      mCount = 0;
+    }
+
+    size_t size() const
+    {
+      return mCount;
+    }
+
+    size_t space() const
+    {
+      return SIZE - mCount;
+    }
+
+    /**
+     * @brief Appends as much of the data as fits
+     * @return size_t   Bytes appended
+     */
+    size_t push( const void *const data, const size_t bytes )
+    {
+      const size_t count = ( bytes < space() ) ? bytes : space();
+      const size_t tail  = ( mHead + mCount ) % SIZE;
+      const size_t first = ( count < ( SIZE - tail ) ) ? count : ( SIZE - tail );
+
+      memcpy( mData + tail, data, first );
+      memcpy( mData, reinterpret_cast<const uint8_t *>( data ) + first, count - first );
+      mCount += count;
+      return count;
+    }
+
+    /**
+     * @brief Copies bytes out without removing them
+     *
+     * @param offset    Distance from the oldest byte to start at
+     * @param data      Where to copy to
+     * @param bytes     Bytes to copy, must be available
+     */
+    void peek( const size_t offset, void *const data, const size_t bytes ) const
+    {
+      const size_t start = ( mHead + offset ) % SIZE;
+      const size_t first = ( bytes < ( SIZE - start ) ) ? bytes : ( SIZE - start );
+
+      memcpy( data, mData + start, first );
+      memcpy( reinterpret_cast<uint8_t *>( data ) + first, mData, bytes - first );
+    }
+
+    /**
+     * @brief Removes the oldest bytes
+     */
+    void drop( const size_t bytes )
+    {
+      const size_t count = ( bytes < mCount ) ? bytes : mCount;
+      mHead              = ( mHead + count ) % SIZE;
+      mCount -= count;
+    }
+
+  private:
+    uint8_t mData[ SIZE ];
+    size_t mHead;
+    size_t mCount;
+  };
+
+
+  /**
+   * @brief Both halves of a stream connection
+   *
+   * The sender keeps every byte until it is acknowledged, and may have up to
+   * RIPPLE_STREAM_WINDOW segments in flight, limited further by the window the
+   * receiver advertises. The receiver only takes bytes in order and always
+   * acknowledges the next one it expects, so a timeout sends everything after
+   * the last acknowledged byte again (go-back-N).
+   *
+   * Not thread safe. The owning socket's lock guards it.
+   */
+  class Stream
+  {
+  public:
+    Stream();
+
+    /**
+     * @brief Starts a new outgoing byte sequence, dropping anything unsent
+     *
+     * @param now       Current time (ms)
+     */
+    void open( const size_t now );
+
+    /**
+     * @brief Drops all state in both directions
+     */
+    void close();
+
+    /**
+     * @brief Queues bytes to send
+     *
+     * @param data      Bytes to send
+     * @param bytes     Number of bytes
+     * @return size_t   Bytes accepted, less than asked if the buffer is full
+     */
+    size_t write( const void *const data, const size_t bytes );
+
+    /**
+     * @brief Takes received bytes out in order
+     *
+     * @param data      Where to copy to
+     * @param bytes     Most bytes to take
+     * @return size_t   Bytes copied
+     */
+    size_t read( void *const data, const size_t bytes );
+
+    /**
+     * @brief Gets how many received bytes are waiting to be read
+     */
+    size_t available() const;
+
+    /**
+     * @brief Handles a segment from the peer
+     *
+     * @param segment   Segment, starting with its StreamHeader
+     * @param bytes     Bytes in the segment
+     * @param now       Current time (ms)
+     * @return bool     True if the segment started a new incoming sequence
+     */
+    bool receive( const uint8_t *const segment, const size_t bytes, const size_t now );
+
+    /**
+     * @brief Sends whatever the window, timers and pending ACKs allow
+     *
+     * @param now       Current time (ms)
+     * @param writer    Where to hand finished segments
+     * @return size_t   Time until the next timer expires (ms), or STREAM_IDLE
+     */
+    size_t service( const size_t now, StreamWriter &writer );
+
+    /**
+     * @brief Checks if the stream has something to send right away
+     */
+    bool pending() const;
+
+    /**
+     * @brief Checks if the outgoing half gave up after too many retries
+     */
+    bool failed() const
+    {
+      return mFailed;
+    }
+
+    void getStats( StreamStats &stats ) const
+    {
+      stats = mStats;
+    }
+
+  private:
+    /**
+     * @brief A sent segment that hasn't been acknowledged yet
+     */
+    struct InFlight
+    {
+      uint32_t seq;       /**< First byte of the segment */
+      uint16_t length;    /**< Payload bytes */
+      bool resent;        /**< Sent more than once, so no good for RTT samples */
+      size_t sentTime;    /**< When it was last sent (ms) */
+    };
+
+    ByteRing<RIPPLE_STREAM_TX_BUFFER> mTXData; /**< Bytes from mSndUna on, sent or not */
+    ByteRing<RIPPLE_STREAM_RX_BUFFER> mRXData; /**< In order bytes waiting to be read */
+    InFlight mInFlight[ RIPPLE_STREAM_WINDOW ]; /**< Oldest first, from mInFlightHead */
+    size_t mInFlightHead;
+    size_t mInFlightCount;
+
+    bool mTXOpen;       /**< Outgoing half has been opened */
+    bool mRXSynced;     /**< Incoming half has seen the peer's SYN */
+    bool mFailed;       /**< Outgoing half gave up */
+    bool mAckPending;   /**< Peer is owed an ACK */
+    bool mRstPending;   /**< Peer sent data this side has no connection for */
+
+    uint32_t mISN;      /**< First sequence number of the outgoing half */
+    uint32_t mSndUna;   /**< Oldest unacknowledged sequence number */
+    uint32_t mSndNxt;   /**< Next sequence number to send */
+    uint32_t mSndMax;   /**< Highest sequence number ever sent */
+    uint32_t mResendTo; /**< Segments starting before this are retransmits */
+    uint32_t mPeerISN;  /**< First sequence number of the incoming half */
+    uint32_t mRcvNxt;   /**< Next sequence number expected from the peer */
+    uint32_t mRstAck;   /**< Sequence number of the segment the pending RST answers */
+    size_t mPeerWindow; /**< Bytes the peer last said it could take */
+    size_t mProbeTime;  /**< When the closed window was last probed (ms) */
+    size_t mRetries;    /**< Timeouts in a row without progress */
+    size_t mRTTVar;     /**< Round trip time variation (ms) */
+
+    uint8_t mScratch[ sizeof( StreamHeader ) + RIPPLE_STREAM_SEGMENT_BYTES ]; /**< Segment being built */
+    StreamStats mStats;
+
+    Chimera::Status_t sendSegment( const uint32_t seq, const size_t length, const uint8_t flags, StreamWriter &writer );
+    void onAck( const uint32_t ack, const size_t window, const size_t now );
+    void onTimeout();
+    void sampleRTT( const size_t rtt );
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_NETSTACK_STREAM_HPP */
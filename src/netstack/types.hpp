@@ -28,6 +28,7 @@
 #include <Chimera/callback>
 
 /* Ripple Includes */
+#include <Ripple/src/shared/cmn_profile.hpp>
 #include <Ripple/src/shared/cmn_types.hpp>
 
 namespace Ripple
@@ -45,12 +46,27 @@ namespace Ripple
   using Socket_rPtr  = Socket *;
   using SocketId     = uint16_t;
 
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Destination port of fragment resend requests. These are handled by the
+   *  context itself, so no socket may use this port.
+   */
+  static constexpr SocketId NACK_PORT = 0xFFFF;
+
+  /**
+   *  Version field of a FragmentNackWide
+   */
+  static constexpr uint16_t NACK_VERSION_WIDE = 1;
+
   /*-------------------------------------------------------------------------------
   Enumerations
   -------------------------------------------------------------------------------*/
   enum CallbackId : uint8_t
   {
     CB_OUT_OF_MEMORY,
+    CB_SERVICE_OVERRUN, /**< A manager thread pass ran past RIPPLE_CTX_LOOP_BUDGET_US */
 
     CB_NUM_OPTIONS,
     CB_INVALID
@@ -61,10 +77,32 @@ namespace Ripple
   {
     PUSH,
     PULL,
+    STREAM, /**< Reliable, ordered byte stream to the connected peer */
 
     INVALID
   };
 
+  /**
+   *  Options carried in TransportHeader::flags
+   */
+  enum bfTransportFlags : uint16_t
+  {
+    TRANSPORT_FLAG_NONE      = 0,
+    TRANSPORT_FLAG_COALESCED = ( 1u << 0 ), /**< Payload is several packets back to back, each led by a PacketHdr */
+    TRANSPORT_FLAG_STREAM    = ( 1u << 1 ), /**< Payload is a stream segment, led by a StreamHeader */
+  };
+
+  /**
+   *  Sources of work that wake the context manager thread
+   */
+  enum bfContextEvent : uint32_t
+  {
+    CTX_EVT_NONE  = 0,
+    CTX_EVT_RX    = ( 1u << 0 ), /**< The netif received a frame */
+    CTX_EVT_TX    = ( 1u << 1 ), /**< A socket queued a packet to send */
+    CTX_EVT_TIMER = ( 1u << 2 ), /**< A deadline expired or the idle period elapsed */
+  };
+
   /*-------------------------------------------------------------------------------
   Structures
   -------------------------------------------------------------------------------*/
@@ -82,7 +120,56 @@ namespace Ripple
     SocketId srcPort;       /**< Unique ID for the source socket on the transmitting node */
     IPAddress srcAddress;   /**< Source address this packet came from */
     uint16_t dataLength;    /**< Length of the data payload for this packet */
-    uint16_t _pad;          /**< Padding for alignment */
+    uint16_t flags;         /**< Bit field of bfTransportFlags */
+  };
+
+  /**
+   * @brief Asks the sender of a stalled packet to resend some of its fragments
+   *
+   * Sent to NACK_PORT of the node named in the packet's TransportHeader. This
+   * is the original layout and covers fragments 0-31, which is all a packet
+   * can have unless the netif allows more.
+   */
+  struct FragmentNack
+  {
+    uint16_t uuid;    /**< Packet being assembled */
+    uint16_t _pad;    /**< Padding for alignment */
+    uint32_t missing; /**< Bit N is set if fragment number N is missing */
+  };
+
+  /**
+   * @brief Resend request for packets with more than 32 fragments
+   *
+   * Only sent when a fragment past number 31 is missing, so nodes that never
+   * use more keep the original layout on the wire. Told apart by its size.
+   */
+  struct FragmentNackWide
+  {
+    uint16_t uuid;    /**< Packet being assembled */
+    uint16_t version; /**< NACK_VERSION_WIDE */
+    uint32_t _pad;    /**< Padding for alignment */
+    uint64_t missing; /**< Bit N is set if fragment number N is missing */
+  };
+
+  /**
+   * @brief Time taken for work to make it through the context manager
+   */
+  struct LatencyStats
+  {
+    uint32_t last_us; /**< Latest sample (uS) */
+    uint32_t avg_us;  /**< Smoothed samples (uS) */
+    uint32_t max_us;  /**< Worst case sample (uS) */
+  };
+
+  /**
+   * @brief Performance data for the context manager
+   */
+  struct ContextStats
+  {
+    LatencyStats rx;  /**< Netif RX event to the packet reaching its socket */
+    LatencyStats tx;  /**< Socket write to the packet being accepted by the netif */
+    uint32_t wakeups; /**< Passes made by the manager thread */
+    ThreadLoad load;  /**< Manager thread CPU and stack usage */
   };
 }    // namespace Ripple
 
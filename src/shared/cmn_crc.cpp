@@ -0,0 +1,152 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_crc.cpp
+ *
+ *  Description:
+ *    CRC32 used to protect packets, with a backend chosen at compile time
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <cstring>
+
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_crc.hpp>
+
+namespace Ripple
+{
+#if ( RIPPLE_CRC32_BACKEND != RIPPLE_CRC32_BACKEND_ETL )
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr uint32_t CRC32_INIT    = 0xFFFFFFFF;
+  static constexpr uint32_t CRC32_XOR_OUT = 0xFFFFFFFF;
+#endif
+
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_TABLE )
+  /*-------------------------------------------------------------------------------
+  Static Data
+  -------------------------------------------------------------------------------*/
+  static constexpr uint32_t CRC32_POLY_REFLECTED = 0xEDB88320;
+
+  struct CRC32Table
+  {
+    uint32_t entry[ 256 ];
+  };
+
+  /**
+   *  Builds the lookup table, one entry per value of the next input byte
+   *
+   *  @return CRC32Table
+   */
+  static constexpr CRC32Table buildTable()
+  {
+    CRC32Table table{};
+
+    for ( uint32_t idx = 0; idx < 256; idx++ )
+    {
+      uint32_t value = idx;
+      for ( size_t bit = 0; bit < 8; bit++ )
+      {
+        value = ( value & 0x1 ) ? ( ( value >> 1 ) ^ CRC32_POLY_REFLECTED ) : ( value >> 1 );
+      }
+
+      table.entry[ idx ] = value;
+    }
+
+    return table;
+  }
+
+  static constexpr CRC32Table s_table = buildTable();
+  static_assert( s_table.entry[ 1 ] == 0x77073096, "CRC32 table is wrong" );
+
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  static inline uint32_t crc32Step( const uint32_t crc, const uint8_t byte )
+  {
+    return s_table.entry[ ( crc ^ byte ) & 0xFF ] ^ ( crc >> 8 );
+  }
+#endif /* RIPPLE_CRC32_BACKEND_TABLE */
+
+
+  /*-------------------------------------------------------------------------------
+  CRC32 Class
+  -------------------------------------------------------------------------------*/
+  CRC32::CRC32()
+  {
+    reset();
+  }
+
+
+  void CRC32::reset()
+  {
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_ETL )
+    mEngine.reset();
+#else
+    mRegister = CRC32_INIT;
+#endif
+  }
+
+
+  void CRC32::add( const void *const data, const size_t size )
+  {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>( data );
+
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_ETL )
+    mEngine.add( bytes, bytes + size );
+#elif ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_USER )
+    mRegister = crc32Update( mRegister, bytes, size );
+#else
+    uint32_t crc = mRegister;
+    for ( size_t idx = 0; idx < size; idx++ )
+    {
+      crc = crc32Step( crc, bytes[ idx ] );
+    }
+
+    mRegister = crc;
+#endif
+  }
+
+
+  void CRC32::copy( void *const dst, const void *const src, const size_t size )
+  {
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_TABLE )
+    /*-------------------------------------------------
+    Each byte is folded in on its way through, so the
+    data is only walked once
+    -------------------------------------------------*/
+    const uint8_t *in = reinterpret_cast<const uint8_t *>( src );
+    uint8_t *out      = reinterpret_cast<uint8_t *>( dst );
+    uint32_t crc      = mRegister;
+
+    for ( size_t idx = 0; idx < size; idx++ )
+    {
+      const uint8_t byte = in[ idx ];
+      out[ idx ]         = byte;
+      crc                = crc32Step( crc, byte );
+    }
+
+    mRegister = crc;
+#else
+    /*-------------------------------------------------
+    Other backends consume whole blocks. Hardware can
+    run the CRC straight from the copied data.
+    -------------------------------------------------*/
+    memcpy( dst, src, size );
+    add( dst, size );
+#endif
+  }
+
+
+  uint32_t CRC32::value() const
+  {
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_ETL )
+    return mEngine.value();
+#else
+    return mRegister ^ CRC32_XOR_OUT;
+#endif
+  }
+
+}    // namespace Ripple
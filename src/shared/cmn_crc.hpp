@@ -0,0 +1,110 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_crc.hpp
+ *
+ *  Description:
+ *    CRC32 used to protect packets, with a backend chosen at compile time
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_COMMON_CRC_HPP
+#define RIPPLE_COMMON_CRC_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+/*-------------------------------------------------------------------------------
+Backend Options
+-------------------------------------------------------------------------------*/
+#define RIPPLE_CRC32_BACKEND_TABLE ( 0 ) /**< Byte wise lookup table built at compile time */
+#define RIPPLE_CRC32_BACKEND_ETL ( 1 )   /**< etl::crc32 */
+#define RIPPLE_CRC32_BACKEND_USER ( 2 )  /**< Project supplied crc32Update(), such as a CRC peripheral */
+
+/**
+ *  Selects which implementation computes packet CRCs. Every backend yields the
+ *  standard reflected CRC32 (poly 0x04C11DB7), so nodes built with different
+ *  backends still talk to each other.
+ */
+#if !defined( RIPPLE_CRC32_BACKEND )
+#define RIPPLE_CRC32_BACKEND ( RIPPLE_CRC32_BACKEND_TABLE )
+#endif
+
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_ETL )
+#include <etl/crc32.h>
+#endif
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_USER )
+  /**
+   *  Feeds data into a running CRC32. Must be defined by the project when the
+   *  user backend is selected.
+   *
+   *  @param[in]  crc           Current CRC register, before the final inversion
+   *  @param[in]  data          Data to add
+   *  @param[in]  size          Bytes of data
+   *  @return uint32_t          Updated CRC register
+   */
+  extern uint32_t crc32Update( const uint32_t crc, const uint8_t *const data, const size_t size );
+#endif
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Running CRC32. Data can be fed in any number of pieces, so the CRC can be
+   *  built up while the data is being copied or as it arrives.
+   */
+  class CRC32
+  {
+  public:
+    CRC32();
+
+    /**
+     *  Starts a new CRC
+     *  @return void
+     */
+    void reset();
+
+    /**
+     *  Adds data to the CRC
+     *
+     *  @param[in]  data          Data to add
+     *  @param[in]  size          Bytes of data
+     *  @return void
+     */
+    void add( const void *const data, const size_t size );
+
+    /**
+     *  Copies data and adds it to the CRC in the same pass
+     *
+     *  @param[out] dst           Where to copy the data
+     *  @param[in]  src           Data to copy and add
+     *  @param[in]  size          Bytes of data
+     *  @return void
+     */
+    void copy( void *const dst, const void *const src, const size_t size );
+
+    /**
+     *  Gets the CRC of all the data added since the last reset
+     *  @return uint32_t
+     */
+    uint32_t value() const;
+
+  private:
+#if ( RIPPLE_CRC32_BACKEND == RIPPLE_CRC32_BACKEND_ETL )
+    etl::crc32 mEngine; /**< ETL implementation */
+#else
+    uint32_t mRegister; /**< CRC register, before the final inversion */
+#endif
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_COMMON_CRC_HPP */
@@ -0,0 +1,169 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_latency.cpp
+ *
+ *  Description:
+ *    Latency histogram implementation
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <cstring>
+
+/* Chimera Includes */
+#include <Chimera/common>
+
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_latency.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Static Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Finds the bucket a sample belongs in, which is its bit width
+   *
+   *  @param[in]  sample_us   Latency (uS)
+   *  @return size_t
+   */
+  static size_t bucketIndex( const uint32_t sample_us )
+  {
+    const size_t bits = sample_us ? ( 32u - static_cast<size_t>( __builtin_clz( sample_us ) ) ) : 0u;
+    return ( bits < LATENCY_BUCKETS ) ? bits : ( LATENCY_BUCKETS - 1u );
+  }
+
+  /*-------------------------------------------------------------------------------
+  LatencyHistogram Implementation
+  -------------------------------------------------------------------------------*/
+  uint32_t LatencyHistogram::percentile( const uint8_t pct ) const
+  {
+    if ( !count )
+    {
+      return 0;
+    }
+
+    /*-------------------------------------------------------------------------
+    Rank of the sample being looked for, rounded up so p100 is the last one
+    -------------------------------------------------------------------------*/
+    const uint64_t rank = ( ( static_cast<uint64_t>( count ) * ( ( pct < 100 ) ? pct : 100 ) ) + 99u ) / 100u;
+    uint64_t seen       = 0;
+
+    for ( size_t idx = 0; idx < ( LATENCY_BUCKETS - 1u ); idx++ )
+    {
+      seen += buckets[ idx ];
+      if ( seen >= rank )
+      {
+        const uint32_t top = idx ? ( ( 1u << idx ) - 1u ) : 0u;
+        return ( top < max_us ) ? top : max_us;
+      }
+    }
+
+    return max_us;
+  }
+
+
+  void LatencyHistogram::add( const uint32_t sample_us )
+  {
+    buckets[ bucketIndex( sample_us ) ]++;
+    count++;
+    max_us = ( sample_us > max_us ) ? sample_us : max_us;
+  }
+
+
+  void LatencyHistogram::merge( const LatencyHistogram &other )
+  {
+    for ( size_t idx = 0; idx < LATENCY_BUCKETS; idx++ )
+    {
+      buckets[ idx ] += other.buckets[ idx ];
+    }
+
+    count += other.count;
+    max_us = ( other.max_us > max_us ) ? other.max_us : max_us;
+  }
+
+  /*-------------------------------------------------------------------------------
+  LatencyReport Implementation
+  -------------------------------------------------------------------------------*/
+  void LatencyReport::clear()
+  {
+    memset( stage, 0, sizeof( stage ) );
+  }
+
+
+  void LatencyReport::merge( const LatencyReport &other )
+  {
+    for ( size_t idx = 0; idx < LAT_NUM_STAGES; idx++ )
+    {
+      stage[ idx ].merge( other.stage[ idx ] );
+    }
+  }
+
+  /*-------------------------------------------------------------------------------
+  LatencyRecorder Implementation
+  -------------------------------------------------------------------------------*/
+  LatencyRecorder::LatencyRecorder()
+  {
+    clear();
+  }
+
+
+  void LatencyRecorder::clear()
+  {
+    for ( size_t stage = 0; stage < LAT_NUM_STAGES; stage++ )
+    {
+      for ( auto &bucket : mBuckets[ stage ] )
+      {
+        bucket.store( 0, std::memory_order_relaxed );
+      }
+
+      mCount[ stage ].store( 0, std::memory_order_relaxed );
+      mMax[ stage ].store( 0, std::memory_order_relaxed );
+    }
+  }
+
+
+  void LatencyRecorder::record( const LatencyStage stage, const uint32_t sample_us )
+  {
+    if ( !( stage < LAT_NUM_STAGES ) )
+    {
+      return;
+    }
+
+    mBuckets[ stage ][ bucketIndex( sample_us ) ].fetch_add( 1, std::memory_order_relaxed );
+    mCount[ stage ].fetch_add( 1, std::memory_order_relaxed );
+
+    /*-------------------------------------------------------------------------
+    New worst cases are rare, so the swap loop almost never runs
+    -------------------------------------------------------------------------*/
+    uint32_t worst = mMax[ stage ].load( std::memory_order_relaxed );
+    while ( ( sample_us > worst ) &&
+            !mMax[ stage ].compare_exchange_weak( worst, sample_us, std::memory_order_relaxed ) )
+    {
+    }
+  }
+
+
+  void LatencyRecorder::recordSince( const LatencyStage stage, const uint32_t start_us )
+  {
+    record( stage, static_cast<uint32_t>( Chimera::micros() ) - start_us );
+  }
+
+
+  void LatencyRecorder::snapshot( LatencyReport &report ) const
+  {
+    for ( size_t stage = 0; stage < LAT_NUM_STAGES; stage++ )
+    {
+      LatencyHistogram &histogram = report.stage[ stage ];
+      for ( size_t idx = 0; idx < LATENCY_BUCKETS; idx++ )
+      {
+        histogram.buckets[ idx ] = mBuckets[ stage ][ idx ].load( std::memory_order_relaxed );
+      }
+
+      histogram.count  = mCount[ stage ].load( std::memory_order_relaxed );
+      histogram.max_us = mMax[ stage ].load( std::memory_order_relaxed );
+    }
+  }
+
+}  // namespace Ripple
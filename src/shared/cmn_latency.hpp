@@ -0,0 +1,154 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_latency.hpp
+ *
+ *  Description:
+ *    Fixed bucket latency histograms for each stage a packet moves through
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_COMMON_LATENCY_HPP
+#define RIPPLE_COMMON_LATENCY_HPP
+
+/* STL Includes */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Bucket N > 0 holds samples from 2^(N-1) up to 2^N - 1 uS, bucket 0 holds
+   *  zero. The last bucket also catches anything longer, about 0.5s and up.
+   */
+  static constexpr size_t LATENCY_BUCKETS = 20;
+
+  /*-------------------------------------------------------------------------------
+  Enumerations
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Stages a packet is timed through, in the order they happen
+   */
+  enum LatencyStage : uint8_t
+  {
+    LAT_SOCKET_TX,  /**< Socket write to the netif accepting the packet */
+    LAT_LINK_QUEUE, /**< Netif accepting a frame to it being loaded into the radio */
+    LAT_LINK_AIR,   /**< Frame loaded into the radio to its TX_DS */
+    LAT_LINK_RX,    /**< Frame read out of the radio to the network layer pulling it */
+    LAT_ASSEMBLY,   /**< First fragment of a packet arriving to the packet being complete */
+    LAT_DISPATCH,   /**< Packet complete to the socket handing it out */
+
+    LAT_NUM_STAGES
+  };
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Distribution of one stage's samples
+   */
+  struct LatencyHistogram
+  {
+    uint32_t buckets[ LATENCY_BUCKETS ]; /**< Sample count of each log2 bucket */
+    uint32_t count;                      /**< Total samples */
+    uint32_t max_us;                     /**< Worst case sample (uS) */
+
+    /**
+     *  Estimates a percentile. Reports the top of the bucket it falls in, so
+     *  it errs high by at most a factor of two, and never past the max.
+     *
+     *  @param[in]  pct         Percentile to look up, 0-100
+     *  @return uint32_t        Latency (uS), zero if there are no samples
+     */
+    uint32_t percentile( const uint8_t pct ) const;
+
+    /**
+     *  Adds one sample. Not atomic, so only for histograms a single thread
+     *  owns. Shared ones belong in a LatencyRecorder.
+     *
+     *  @param[in]  sample_us   Latency (uS)
+     *  @return void
+     */
+    void add( const uint32_t sample_us );
+
+    /**
+     *  Adds another histogram's samples into this one
+     *
+     *  @param[in]  other       Histogram to add
+     *  @return void
+     */
+    void merge( const LatencyHistogram &other );
+  };
+
+  /**
+   *  Histograms of every stage. Layers only fill in the stages they own and
+   *  leave the rest empty, so reports can simply be merged together.
+   */
+  struct LatencyReport
+  {
+    LatencyHistogram stage[ LAT_NUM_STAGES ];
+
+    void clear();
+    void merge( const LatencyReport &other );
+  };
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Collects latency samples without a lock. Recording is a couple of
+   *  relaxed atomic adds, so it's cheap enough for the TX/RX hot paths, and
+   *  any thread may record while another takes a snapshot.
+   */
+  class LatencyRecorder
+  {
+  public:
+    LatencyRecorder();
+
+    /**
+     *  Drops every sample
+     *  @return void
+     */
+    void clear();
+
+    /**
+     *  Adds a sample to a stage
+     *
+     *  @param[in]  stage       Stage the sample was taken from
+     *  @param[in]  sample_us   Latency (uS)
+     *  @return void
+     */
+    void record( const LatencyStage stage, const uint32_t sample_us );
+
+    /**
+     *  Adds a sample measured from some earlier time stamp up to now
+     *
+     *  @param[in]  stage       Stage the sample was taken from
+     *  @param[in]  start_us    Chimera::micros() when the stage started
+     *  @return void
+     */
+    void recordSince( const LatencyStage stage, const uint32_t start_us );
+
+    /**
+     *  Copies out the samples collected so far. Stages are read one counter at
+     *  a time, so a snapshot taken mid-record may be off by a sample or two.
+     *
+     *  @param[out] report      Where to copy the samples to
+     *  @return void
+     */
+    void snapshot( LatencyReport &report ) const;
+
+  private:
+    std::atomic<uint32_t> mBuckets[ LAT_NUM_STAGES ][ LATENCY_BUCKETS ];
+    std::atomic<uint32_t> mCount[ LAT_NUM_STAGES ];
+    std::atomic<uint32_t> mMax[ LAT_NUM_STAGES ];
+  };
+
+}  // namespace Ripple
+
+#endif  /* !RIPPLE_COMMON_LATENCY_HPP */
@@ -0,0 +1,126 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_profile.cpp
+ *
+ *  Description:
+ *    CPU load and stack usage profiling implementation
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <cstring>
+
+/* Chimera Includes */
+#include <Chimera/common>
+
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_profile.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  ThreadProfiler Implementation
+  -------------------------------------------------------------------------------*/
+  ThreadProfiler::ThreadProfiler() :
+      mIterations( 0 ), mOverruns( 0 ), mBudget_us( 0 ), mLast_us( 0 ), mMax_us( 0 ), mLoad_pm( 0 ), mStackSize( 0 ),
+      mStack( nullptr ), mWorkStart_us( 0 ), mWindowStart_us( 0 ), mWindowBusy_us( 0 )
+  {
+  }
+
+
+  void ThreadProfiler::setBudget( const uint32_t budget_us )
+  {
+    mBudget_us.store( budget_us, std::memory_order_relaxed );
+  }
+
+
+  void ThreadProfiler::watchStack( void *const stack, const size_t size )
+  {
+    if ( !stack || !size )
+    {
+      return;
+    }
+
+    memset( stack, PROFILE_STACK_PAINT, size );
+    mStackSize.store( static_cast<uint32_t>( size ), std::memory_order_relaxed );
+    mStack.store( reinterpret_cast<const uint8_t *>( stack ), std::memory_order_release );
+  }
+
+
+  void ThreadProfiler::beginWork()
+  {
+    mWorkStart_us = static_cast<uint32_t>( Chimera::micros() );
+    if ( !mIterations.load( std::memory_order_relaxed ) )
+    {
+      mWindowStart_us = mWorkStart_us;
+    }
+  }
+
+
+  bool ThreadProfiler::endWork()
+  {
+    const uint32_t now  = static_cast<uint32_t>( Chimera::micros() );
+    const uint32_t busy = now - mWorkStart_us;
+
+    mIterations.fetch_add( 1u, std::memory_order_relaxed );
+    mLast_us.store( busy, std::memory_order_relaxed );
+    if ( busy > mMax_us.load( std::memory_order_relaxed ) )
+    {
+      mMax_us.store( busy, std::memory_order_relaxed );
+    }
+
+    /*-------------------------------------------------
+    Close out the window once it's long enough. Whatever
+    the pass didn't spend working was spent asleep.
+    -------------------------------------------------*/
+    mWindowBusy_us += busy;
+    const uint32_t window = now - mWindowStart_us;
+    if ( window >= RIPPLE_PROFILE_WINDOW_US )
+    {
+      mLoad_pm.store( static_cast<uint32_t>( ( static_cast<uint64_t>( mWindowBusy_us ) * 1000u ) / window ),
+                      std::memory_order_relaxed );
+      mWindowStart_us = now;
+      mWindowBusy_us  = 0;
+    }
+
+    const uint32_t budget = mBudget_us.load( std::memory_order_relaxed );
+    const bool overrun    = budget && ( busy > budget );
+    if ( overrun )
+    {
+      mOverruns.fetch_add( 1u, std::memory_order_relaxed );
+    }
+
+    return overrun;
+  }
+
+
+  void ThreadProfiler::getLoad( ThreadLoad &load ) const
+  {
+    load.iterations   = mIterations.load( std::memory_order_relaxed );
+    load.overruns     = mOverruns.load( std::memory_order_relaxed );
+    load.budget_us    = mBudget_us.load( std::memory_order_relaxed );
+    load.last_us      = mLast_us.load( std::memory_order_relaxed );
+    load.max_us       = mMax_us.load( std::memory_order_relaxed );
+    load.load_pm      = mLoad_pm.load( std::memory_order_relaxed );
+    load.stack_size   = 0;
+    load.stack_unused = 0;
+
+    /*-------------------------------------------------
+    The stack grows down, so the paint left at the low
+    end is what the thread has never reached. The stack
+    itself is scanned racily by design, a byte changing
+    under the scan only moves the watermark.
+    -------------------------------------------------*/
+    const uint8_t *const stack = mStack.load( std::memory_order_acquire );
+    if ( stack )
+    {
+      load.stack_size = mStackSize.load( std::memory_order_relaxed );
+      while ( ( load.stack_unused < load.stack_size ) && ( stack[ load.stack_unused ] == PROFILE_STACK_PAINT ) )
+      {
+        load.stack_unused++;
+      }
+    }
+  }
+
+}    // namespace Ripple
@@ -0,0 +1,139 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_profile.hpp
+ *
+ *  Description:
+ *    CPU load and stack usage profiling for the service threads
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_COMMON_PROFILE_HPP
+#define RIPPLE_COMMON_PROFILE_HPP
+
+/* STL Includes */
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*-------------------------------------------------------------------------------
+Configuration
+-------------------------------------------------------------------------------*/
+/**
+ *  Length of the window the busy share of a thread is measured over (uS)
+ */
+#if !defined( RIPPLE_PROFILE_WINDOW_US )
+#define RIPPLE_PROFILE_WINDOW_US ( 1000000 )
+#endif
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr uint8_t PROFILE_STACK_PAINT = 0xA5; /**< Fill for stack bytes that were never used */
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  How hard a service thread is working
+   */
+  struct ThreadLoad
+  {
+    uint32_t iterations;   /**< Loop passes measured */
+    uint32_t overruns;     /**< Passes that ran past the budget */
+    uint32_t budget_us;    /**< Longest a pass may run, zero for no limit (uS) */
+    uint32_t last_us;      /**< Busy time of the latest pass (uS) */
+    uint32_t max_us;       /**< Worst case busy time of a pass (uS) */
+    uint32_t load_pm;      /**< Busy share of the last full window, in parts per thousand */
+    uint32_t stack_size;   /**< Bytes in the thread stack, zero if not watched */
+    uint32_t stack_unused; /**< Bytes at the far end of the stack never touched */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Splits a service thread's time into busy and idle. The thread brackets
+   *  the work of each loop pass with beginWork() and endWork(), everything
+   *  outside of that counts as idle.
+   *
+   *  Only the owning thread may call beginWork() and endWork(). The figures
+   *  are kept as atomics, so the budget may be set and the load read from
+   *  any thread. Readers see every counter whole, though not necessarily all
+   *  from the same pass.
+   */
+  class ThreadProfiler
+  {
+  public:
+    ThreadProfiler();
+
+    /**
+     *  Sets how long one pass may be busy before it counts as an overrun
+     *
+     *  @param[in]  budget_us   Longest pass (uS), zero for no limit
+     *  @return void
+     */
+    void setBudget( const uint32_t budget_us );
+
+    /**
+     *  Paints a thread stack so its high water mark can be found later. Must
+     *  happen before the thread starts running on it. Stacks are assumed to
+     *  grow down, as they do on every supported target.
+     *
+     *  @note The simulator runs threads on their own native stacks, so the
+     *        buffer handed over stays untouched and reads as all unused.
+     *
+     *  @param[in]  stack       Start of the stack buffer
+     *  @param[in]  size        Bytes in the stack buffer
+     *  @return void
+     */
+    void watchStack( void *const stack, const size_t size );
+
+    /**
+     *  Marks the end of an idle period, just after the thread wakes
+     *  @return void
+     */
+    void beginWork();
+
+    /**
+     *  Marks the end of the work for one pass, just before the thread sleeps
+     *  @return bool            True if the pass ran past its budget
+     */
+    bool endWork();
+
+    /**
+     *  Gets the load figures. Walks the watched stack to find how much of it
+     *  was never used, so costs a scan of up to the whole stack.
+     *
+     *  @param[out] load        Output for the figures
+     *  @return void
+     */
+    void getLoad( ThreadLoad &load ) const;
+
+  private:
+    /*-------------------------------------------------
+    Shared with readers on other threads
+    -------------------------------------------------*/
+    std::atomic<uint32_t> mIterations;   /**< Loop passes measured */
+    std::atomic<uint32_t> mOverruns;     /**< Passes that ran past the budget */
+    std::atomic<uint32_t> mBudget_us;    /**< Longest a pass may run, zero for no limit (uS) */
+    std::atomic<uint32_t> mLast_us;      /**< Busy time of the latest pass (uS) */
+    std::atomic<uint32_t> mMax_us;       /**< Worst case busy time of a pass (uS) */
+    std::atomic<uint32_t> mLoad_pm;      /**< Busy share of the last full window (ppt) */
+    std::atomic<uint32_t> mStackSize;    /**< Bytes in the watched stack */
+    std::atomic<const uint8_t *> mStack; /**< Watched stack buffer */
+
+    /*-------------------------------------------------
+    Owning thread only
+    -------------------------------------------------*/
+    uint32_t mWorkStart_us;   /**< When the current pass started working */
+    uint32_t mWindowStart_us; /**< When the current window opened */
+    uint32_t mWindowBusy_us;  /**< Busy time so far in the current window */
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_COMMON_PROFILE_HPP */
@@ -0,0 +1,70 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_static.hpp
+ *
+ *  Description:
+ *    Storage for objects laid out at compile time instead of on the heap
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_COMMON_STATIC_HPP
+#define RIPPLE_COMMON_STATIC_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Classes
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Suitably aligned room for exactly one T, meant to be declared at file
+   *  scope so the linker places it. The create functions that take a slot
+   *  construct into it rather than allocating.
+   *
+   *  Claiming isn't thread safe, it's meant for startup.
+   */
+  template<typename T>
+  class StaticSlot
+  {
+  public:
+    constexpr StaticSlot() : mStorage{}, mClaimed( false )
+    {
+    }
+
+    /**
+     *  Hands out the storage, once
+     *  @return void *          nullptr if it was already claimed
+     */
+    void *claim()
+    {
+      if ( mClaimed )
+      {
+        return nullptr;
+      }
+
+      mClaimed = true;
+      return mStorage;
+    }
+
+    /**
+     *  Checks if the storage has been handed out
+     *  @return bool
+     */
+    bool claimed() const
+    {
+      return mClaimed;
+    }
+
+  private:
+    alignas( T ) uint8_t mStorage[ sizeof( T ) ];
+    bool mClaimed;
+  };
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_COMMON_STATIC_HPP */
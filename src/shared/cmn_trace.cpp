@@ -0,0 +1,228 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_trace.cpp
+ *
+ *  Description:
+ *    Binary event trace ring implementation
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+/* STL Includes */
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+/* Chimera Includes */
+#include <Chimera/common>
+
+/* Ripple Includes */
+#include <Ripple/src/shared/cmn_trace.hpp>
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Static Data
+  -------------------------------------------------------------------------------*/
+  static_assert( ( RIPPLE_TRACE_DEPTH & ( RIPPLE_TRACE_DEPTH - 1 ) ) == 0, "Trace depth must be a power of two" );
+
+#if RIPPLE_TRACE_DEPTH
+  static TraceRecord s_ring[ RIPPLE_TRACE_DEPTH ];
+  static std::atomic<uint32_t> s_commit[ RIPPLE_TRACE_DEPTH ]; /**< Index + 1 of the record each slot finished holding */
+#endif
+  static std::atomic<uint32_t> s_head( 0 );  /**< Records ever written. The low bits index the ring. */
+  static std::atomic<bool> s_enabled( true );
+
+  static_assert( TRC_NUM_EVENTS == 15, "Update the event names" );
+  static const char *const s_eventNames[ TRC_NUM_EVENTS ] = { "none",         "irq",           "phy_mode",
+                                                              "frame_tx",     "frame_tx_ack",  "frame_tx_fail",
+                                                              "frame_rx",     "frame_rx_drop", "asm_start",
+                                                              "asm_complete", "asm_remove",    "sock_tx_enq",
+                                                              "sock_tx_deq",  "sock_rx_enq",   "sock_rx_deq" };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  void traceEvent( const TraceEvent event, const uint16_t arg0, const uint32_t arg1 )
+  {
+#if RIPPLE_TRACE_DEPTH
+    if ( !s_enabled.load( std::memory_order_relaxed ) )
+    {
+      return;
+    }
+
+    /*-------------------------------------------------
+    Claim a slot, then fill it. Writers never wait on
+    each other, they just land in different slots. The
+    commit word is cleared before and set after the
+    fill, so a drain can tell a finished record from
+    one still being written.
+    -------------------------------------------------*/
+    const uint32_t idx            = s_head.fetch_add( 1, std::memory_order_relaxed );
+    const uint32_t pos            = idx & ( RIPPLE_TRACE_DEPTH - 1u );
+    TraceRecord &slot             = s_ring[ pos ];
+    std::atomic<uint32_t> &commit = s_commit[ pos ];
+
+    commit.store( idx, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    slot.timestamp_us = static_cast<uint32_t>( Chimera::micros() );
+    slot.event        = event;
+    slot.arg0         = arg0;
+    slot.arg1         = arg1;
+
+    commit.store( idx + 1u, std::memory_order_release );
+#else
+    ( void )event;
+    ( void )arg0;
+    ( void )arg1;
+#endif
+  }
+
+
+  void traceEnable( const bool enable )
+  {
+    s_enabled.store( enable, std::memory_order_relaxed );
+  }
+
+
+  size_t traceDrain( TraceRecord *const out, const size_t maxRecords, uint32_t &cursor, uint32_t &lost )
+  {
+    lost = 0;
+
+#if RIPPLE_TRACE_DEPTH
+    if ( !out || !maxRecords )
+    {
+      return 0;
+    }
+
+    /*-------------------------------------------------
+    Anything more than a ring behind has been written
+    over. Skip ahead to the oldest record still there.
+    -------------------------------------------------*/
+    const uint32_t head = s_head.load( std::memory_order_acquire );
+    if ( ( head - cursor ) > RIPPLE_TRACE_DEPTH )
+    {
+      lost   = ( head - cursor ) - RIPPLE_TRACE_DEPTH;
+      cursor = head - RIPPLE_TRACE_DEPTH;
+    }
+
+    /*-------------------------------------------------
+    Only take finished records. One still being filled
+    ends the drain, the next one picks it up. One that
+    was written over, before or while being copied, is
+    counted as lost.
+    -------------------------------------------------*/
+    size_t copied = 0;
+    while ( ( cursor != head ) && ( copied < maxRecords ) )
+    {
+      const uint32_t pos                  = cursor & ( RIPPLE_TRACE_DEPTH - 1u );
+      const std::atomic<uint32_t> &commit = s_commit[ pos ];
+      const uint32_t expected             = cursor + 1u;
+      const uint32_t before               = commit.load( std::memory_order_acquire );
+
+      if ( static_cast<int32_t>( before - expected ) < 0 )
+      {
+        break;
+      }
+
+      out[ copied ] = s_ring[ pos ];
+      std::atomic_thread_fence( std::memory_order_acquire );
+
+      if ( ( before == expected ) && ( commit.load( std::memory_order_relaxed ) == expected ) )
+      {
+        copied++;
+      }
+      else
+      {
+        lost++;
+      }
+
+      cursor++;
+    }
+
+    return copied;
+#else
+    ( void )out;
+    ( void )maxRecords;
+    ( void )cursor;
+    return 0;
+#endif
+  }
+
+
+  size_t traceDump( void *const buffer, const size_t size, uint32_t &cursor )
+  {
+    if ( !buffer || ( size < sizeof( TraceDumpHeader ) ) )
+    {
+      return 0;
+    }
+
+    /*-------------------------------------------------
+    Drain through a small aligned block, since the dump
+    buffer may sit at any offset in a transport frame
+    -------------------------------------------------*/
+    uint8_t *const out    = reinterpret_cast<uint8_t *>( buffer );
+    const size_t maxCount = ( size - sizeof( TraceDumpHeader ) ) / sizeof( TraceRecord );
+    size_t count          = 0;
+    uint32_t totalLost    = 0;
+    TraceRecord block[ 16 ];
+
+    while ( count < maxCount )
+    {
+      uint32_t lost       = 0;
+      const size_t want   = std::min<size_t>( maxCount - count, sizeof( block ) / sizeof( block[ 0 ] ) );
+      const size_t copied = traceDrain( block, want, cursor, lost );
+      totalLost += lost;
+
+      memcpy( out + sizeof( TraceDumpHeader ) + ( count * sizeof( TraceRecord ) ), block, copied * sizeof( TraceRecord ) );
+      count += copied;
+
+      if ( copied < want )
+      {
+        break;
+      }
+    }
+
+    TraceDumpHeader header;
+    header.magic      = TRACE_MAGIC;
+    header.version    = TRACE_VERSION;
+    header.recordSize = sizeof( TraceRecord );
+    header.count      = static_cast<uint32_t>( count );
+    header.lost       = totalLost;
+    memcpy( out, &header, sizeof( header ) );
+
+    return sizeof( TraceDumpHeader ) + ( count * sizeof( TraceRecord ) );
+  }
+
+
+  const char *traceEventName( const uint16_t event )
+  {
+    return ( event < TRC_NUM_EVENTS ) ? s_eventNames[ event ] : "unknown";
+  }
+
+
+  size_t traceFormat( const TraceRecord &record, char *const buffer, const size_t size )
+  {
+    if ( !buffer || !size )
+    {
+      return 0;
+    }
+
+    const int written = snprintf( buffer, size, "%lu,%s,%u,%lu", static_cast<unsigned long>( record.timestamp_us ),
+                                  traceEventName( record.event ), static_cast<unsigned>( record.arg0 ),
+                                  static_cast<unsigned long>( record.arg1 ) );
+    if ( written <= 0 )
+    {
+      return 0;
+    }
+
+    /*-------------------------------------------------
+    snprintf() reports what it would have written, not
+    what fit
+    -------------------------------------------------*/
+    return std::min<size_t>( static_cast<size_t>( written ), size - 1u );
+  }
+
+}    // namespace Ripple
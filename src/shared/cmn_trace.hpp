@@ -0,0 +1,181 @@
+/********************************************************************************
+ *  File Name:
+ *    cmn_trace.hpp
+ *
+ *  Description:
+ *    Binary event trace ring, cheap enough to leave running in flight
+ *
+ *  2021 | Brandon Braun | brandonbraun653@gmail.com
+ *******************************************************************************/
+
+#pragma once
+#ifndef RIPPLE_COMMON_TRACE_HPP
+#define RIPPLE_COMMON_TRACE_HPP
+
+/* STL Includes */
+#include <cstddef>
+#include <cstdint>
+
+/*-------------------------------------------------------------------------------
+Configuration
+-------------------------------------------------------------------------------*/
+/**
+ *  Records held by the trace ring, a power of two. The oldest are overwritten
+ *  once it fills. Zero compiles every trace point out.
+ */
+#if !defined( RIPPLE_TRACE_DEPTH )
+#if defined( EMBEDDED )
+#define RIPPLE_TRACE_DEPTH ( 128 )
+#else /* SIMULATOR */
+#define RIPPLE_TRACE_DEPTH ( 4096 )
+#endif /* EMBEDDED */
+#endif
+
+/**
+ *  Drops one record into the trace ring. Arguments are truncated to 16 and
+ *  32 bits respectively.
+ */
+#if RIPPLE_TRACE_DEPTH
+#define RIPPLE_TRACE( event, arg0, arg1 ) \
+  ::Ripple::traceEvent( ( event ), static_cast<uint16_t>( arg0 ), static_cast<uint32_t>( arg1 ) )
+#else
+#define RIPPLE_TRACE( event, arg0, arg1 ) \
+  do                                      \
+  {                                       \
+  } while ( 0 )
+#endif
+
+namespace Ripple
+{
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr uint32_t TRACE_MAGIC   = 0x43525452; /**< "RTRC" read as little endian bytes */
+  static constexpr uint16_t TRACE_VERSION = 1;
+
+  /*-------------------------------------------------------------------------------
+  Enumerations
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Every trace point. The values are part of the dump format, so only ever
+   *  add to the end.
+   */
+  enum TraceEvent : uint16_t
+  {
+    TRC_NONE,             /**< Unused, marks a slot that was never written */
+    TRC_IRQ,              /**< Radio IRQ line asserted. arg1: link enabled */
+    TRC_PHY_MODE,         /**< Radio FSM changed state. arg0: old state, arg1: new state */
+    TRC_FRAME_TX,         /**< Frame loaded into the radio. arg0: UUID, arg1: frame number << 16 | bytes */
+    TRC_FRAME_TX_ACK,     /**< Frame retired by TX_DS. arg0: UUID, arg1: frame number */
+    TRC_FRAME_TX_FAIL,    /**< Frame ran out of retries. arg0: UUID, arg1: frame number */
+    TRC_FRAME_RX,         /**< Frame queued for the network layer. arg0: UUID, arg1: pipe << 16 | bytes */
+    TRC_FRAME_RX_DROP,    /**< Frame lost to a full RX queue. arg0: UUID, arg1: bytes */
+    TRC_ASM_START,        /**< Packet assembly started. arg0: UUID, arg1: total fragments */
+    TRC_ASM_COMPLETE,     /**< Packet assembly finished. arg0: UUID, arg1: bytes received */
+    TRC_ASM_REMOVE,       /**< Assembly slot released. arg0: UUID, arg1: PacketAssembly::RemoveErr */
+    TRC_SOCK_TX_ENQUEUE,  /**< Socket queued a packet to send. arg0: source port, arg1: bytes */
+    TRC_SOCK_TX_DEQUEUE,  /**< Context handed a queued packet on. arg0: source port, arg1: Chimera status */
+    TRC_SOCK_RX_ENQUEUE,  /**< Packet pushed to a socket. arg0: port, arg1: bytes */
+    TRC_SOCK_RX_DEQUEUE,  /**< Socket took a packet off its queue. arg0: port, arg1: bytes */
+
+    TRC_NUM_EVENTS
+  };
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  One trace record, packed to 12 bytes
+   */
+  struct TraceRecord
+  {
+    uint32_t timestamp_us; /**< Chimera::micros() when it was recorded */
+    uint16_t event;        /**< TraceEvent */
+    uint16_t arg0;         /**< First argument, per event */
+    uint32_t arg1;         /**< Second argument, per event */
+  };
+  static_assert( sizeof( TraceRecord ) == 12, "TraceRecord is part of the dump format" );
+
+  /**
+   *  Leads every dump sent to a host. A dump is this header followed by
+   *  count records, all little endian, oldest first.
+   */
+  struct TraceDumpHeader
+  {
+    uint32_t magic;      /**< TRACE_MAGIC */
+    uint16_t version;    /**< TRACE_VERSION */
+    uint16_t recordSize; /**< sizeof( TraceRecord ) */
+    uint32_t count;      /**< Records that follow */
+    uint32_t lost;       /**< Records overwritten before they could be drained */
+  };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Records an event. Lock free and safe from any thread or ISR. Costs a
+   *  timestamp read, one atomic add and a 12 byte store.
+   *
+   *  @param[in]  event       What happened
+   *  @param[in]  arg0        First argument, per event
+   *  @param[in]  arg1        Second argument, per event
+   *  @return void
+   */
+  void traceEvent( const TraceEvent event, const uint16_t arg0, const uint32_t arg1 );
+
+  /**
+   *  Turns recording on or off. On by default.
+   *
+   *  @param[in]  enable      Whether to record
+   *  @return void
+   */
+  void traceEnable( const bool enable );
+
+  /**
+   *  Copies out the records made since the cursor, oldest first, and moves
+   *  the cursor past them. Start the cursor at zero. A record still being
+   *  written ends the drain early and is picked up by the next one. Records
+   *  written over before they could be copied count as lost.
+   *
+   *  @param[out] out         Where to copy the records
+   *  @param[in]  maxRecords  Room in out
+   *  @param[in]  cursor      Where the last drain stopped, updated on return
+   *  @param[out] lost        Records overwritten since the cursor, or while copied
+   *  @return size_t          Records copied
+   */
+  size_t traceDrain( TraceRecord *const out, const size_t maxRecords, uint32_t &cursor, uint32_t &lost );
+
+  /**
+   *  Drains the records made since the cursor into a dump ready to send to a
+   *  host, a TraceDumpHeader followed by as many records as fit. Same cursor
+   *  rules as traceDrain(). Records are written in host byte order, which is
+   *  little endian on every supported target.
+   *
+   *  @param[out] buffer      Where to write the dump, no alignment needed
+   *  @param[in]  size        Room in buffer
+   *  @param[in]  cursor      Where the last drain stopped, updated on return
+   *  @return size_t          Bytes written, zero if not even the header fits
+   */
+  size_t traceDump( void *const buffer, const size_t size, uint32_t &cursor );
+
+  /**
+   *  Gets the name of an event, for decoding a dump into text
+   *
+   *  @param[in]  event       Event to name
+   *  @return const char *    Name, "unknown" if out of range
+   */
+  const char *traceEventName( const uint16_t event );
+
+  /**
+   *  Decodes a record into one line of text, without a line ending
+   *
+   *  @param[in]  record      Record to decode
+   *  @param[out] buffer      Where to write the text
+   *  @param[in]  size        Room in buffer
+   *  @return size_t          Characters written, not counting the terminator
+   */
+  size_t traceFormat( const TraceRecord &record, char *const buffer, const size_t size );
+
+}    // namespace Ripple
+
+#endif /* !RIPPLE_COMMON_TRACE_HPP */
@@ -13,6 +13,8 @@
 #define RIPPLE_COMMON_UTILITIES_HPP
 
 /* STL Includes */
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 /* Ripple Includes */
@@ -42,6 +44,35 @@ namespace Ripple
    */
   void TaskWaitInit();
 
+  /**
+   *  Bits needed to index an open hash table kept at most half full
+   *
+   *  @param[in]  entries       Entries the table must hold
+   *  @return size_t
+   */
+  constexpr size_t hashIndexBits( const size_t entries )
+  {
+    size_t bits = 1;
+    while ( ( static_cast<size_t>( 1u ) << bits ) < ( 2u * entries ) )
+    {
+      bits++;
+    }
+
+    return bits;
+  }
+
+  /**
+   *  Fibonacci hash of a 16-bit key onto an open hash table
+   *
+   *  @param[in]  key           Key to hash
+   *  @param[in]  bits          Table size as a power of two, at most 16
+   *  @return size_t
+   */
+  constexpr size_t hashIndex16( const uint16_t key, const size_t bits )
+  {
+    return ( ( static_cast<uint32_t>( key ) * 40503u ) & 0xFFFFu ) >> ( 16u - bits );
+  }
+
 }  // namespace Ripple
 
 #endif  /* !RIPPLE_COMMON_UTILITIES_HPP */
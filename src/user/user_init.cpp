@@ -23,14 +23,20 @@ namespace Ripple
   /*-------------------------------------------------------------------------------
   Constants
   -------------------------------------------------------------------------------*/
-  static constexpr size_t THREAD_STACK_BYTES    = 2048;
-  static constexpr size_t THREAD_STACK_WORDS    = STACK_BYTES( THREAD_STACK_BYTES );
+  static constexpr size_t THREAD_STACK_WORDS    = STACK_BYTES( NET_MGR_STACK_BYTES );
   static constexpr std::string_view THREAD_NAME = "NetMgr";
 
   /*-------------------------------------------------------------------------------
   Public Functions
   -------------------------------------------------------------------------------*/
   Context_rPtr create( void *mem_pool, const size_t mem_size )
+  {
+    return createInPlace( nullptr, nullptr, 0, nullptr, 0, mem_pool, mem_size );
+  }
+
+
+  Context_rPtr createInPlace( void *const context, void *const threadStack, const size_t stackSize, void *const pools,
+                              const size_t poolSize, void *const heap, const size_t heapSize )
   {
     using namespace Aurora::Memory;
     using namespace Chimera::Thread;
@@ -38,7 +44,7 @@ namespace Ripple
     /*-------------------------------------------------
     Input Protection
     -------------------------------------------------*/
-    if( !mem_pool || !mem_size )
+    if( !heap || !heapSize || ( threadStack && ( stackSize < NET_MGR_STACK_BYTES ) ) )
     {
       return nullptr;
     }
@@ -48,13 +54,18 @@ namespace Ripple
     initialize the context object.
     -------------------------------------------------*/
     Heap tmpHeap;
-    tmpHeap.assignMemoryPool( mem_pool, mem_size );
+    tmpHeap.assignMemoryPool( heap, heapSize );
 
     /*-------------------------------------------------
     Construct the network context with the memory pool
     -------------------------------------------------*/
-    void *rawContext = tmpHeap.malloc( sizeof( Context ) );
-    Context_rPtr ctx = new( rawContext ) Context( std::move( tmpHeap ) );
+    void *rawContext = context ? context : tmpHeap.malloc( sizeof( Context ) );
+    if ( !rawContext )
+    {
+      return nullptr;
+    }
+
+    Context_rPtr ctx = new( rawContext ) Context( std::move( tmpHeap ), pools, poolSize );
 
     /*-------------------------------------------------
     Boot the network manager thread
@@ -71,11 +82,19 @@ namespace Ripple
     cfg.stackWords                            = THREAD_STACK_WORDS;
     cfg.type                                  = TaskInitType::STATIC;
     cfg.name                                  = THREAD_NAME.data();
-    cfg.specialization.staticTask.stackBuffer = ctx->malloc( THREAD_STACK_BYTES );
-    cfg.specialization.staticTask.stackSize   = THREAD_STACK_BYTES;
+    cfg.specialization.staticTask.stackBuffer = threadStack ? threadStack : ctx->malloc( NET_MGR_STACK_BYTES );
+    cfg.specialization.staticTask.stackSize   = NET_MGR_STACK_BYTES;
+
+    ctx->mProfile.watchStack( cfg.specialization.staticTask.stackBuffer, NET_MGR_STACK_BYTES );
 
     netManager.create( cfg );
     threadId = netManager.start();
+
+    /*-------------------------------------------------
+    Events can be raised before the thread records its
+    own ID, so give it one up front.
+    -------------------------------------------------*/
+    ctx->mTaskId = threadId;
     sendTaskMsg( threadId, ITCMsg::TSK_MSG_WAKEUP, TIMEOUT_DONT_WAIT );
 
     return ctx;
@@ -14,14 +14,66 @@
 
 /* STL Includes */
 #include <cstddef>
+#include <cstdint>
 
 /* Ripple Includes */
+#include <Ripple/src/netstack/config.hpp>
 #include <Ripple/src/netstack/context.hpp>
+#include <Ripple/src/netstack/memory_pool.hpp>
+#include <Ripple/src/netstack/socket.hpp>
+#include <Ripple/src/shared/cmn_static.hpp>
 #include <Ripple/src/shared/cmn_types.hpp>
 #include <Ripple/src/netif/device_intf.hpp>
 
 namespace Ripple
 {
+  /*-------------------------------------------------------------------------------
+  Constants
+  -------------------------------------------------------------------------------*/
+  static constexpr size_t NET_MGR_STACK_BYTES = 2048; /**< Stack given to the network manager thread */
+
+  /*-------------------------------------------------------------------------------
+  Structures
+  -------------------------------------------------------------------------------*/
+  /**
+   *  Everything a context needs, laid out at compile time. Declare one at file
+   *  scope and hand it to create() to bring the stack up without carving any
+   *  of it out of a heap at runtime:
+   *
+   *    static Ripple::StaticStack<4096> s_net RIPPLE_STATIC_SECTION;
+   *
+   *  The heap is only left serving what has no static home of its own, like
+   *  sockets made without a StaticSocketCache or pool blocks beyond the
+   *  configured counts. The netifs take their own StaticSlot.
+   */
+  template<const size_t HEAP_BYTES>
+  struct StaticStack
+  {
+    static_assert( HEAP_BYTES && ( ( HEAP_BYTES % sizeof( size_t ) ) == 0 ), "Heap must be a whole number of words" );
+    static_assert( ( NET_MGR_STACK_BYTES % sizeof( size_t ) ) == 0, "Thread stack must be a whole number of words" );
+    static_assert( ( POOL_TOTAL_BYTES % POOL_ALIGNMENT ) == 0, "Pools won't pack back to back" );
+
+    static constexpr size_t POOL_BYTES = POOL_TOTAL_BYTES ? POOL_TOTAL_BYTES : 1;
+
+    StaticSlot<Context> context;                                             /**< The context object itself */
+    alignas( sizeof( size_t ) ) uint8_t managerStack[ NET_MGR_STACK_BYTES ]; /**< Network manager thread stack */
+    alignas( POOL_ALIGNMENT ) uint8_t pools[ POOL_BYTES ];                   /**< Every block pool */
+    alignas( std::max_align_t ) uint8_t heap[ HEAP_BYTES ];                  /**< Whatever is left to allocate */
+  };
+
+  /**
+   *  Room for a socket and the arena it builds packets in, to be handed to
+   *  Context::socket() in place of a heap allocation
+   */
+  template<const size_t BYTES>
+  struct StaticSocketCache
+  {
+    static_assert( BYTES > SOCKET_OBJECT_BYTES, "No room left after the socket for its arena" );
+    static_assert( ( BYTES % sizeof( size_t ) ) == 0, "Cache must be a whole number of words" );
+
+    alignas( std::max_align_t ) uint8_t memory[ BYTES ];
+  };
+
   /*-------------------------------------------------------------------------------
   Public Functions
   -------------------------------------------------------------------------------*/
@@ -38,6 +90,43 @@ namespace Ripple
    */
   Context_rPtr create( void *mem_pool, const size_t mem_size );
 
+  /**
+   *  Builds a context out of memory the caller already laid out. Backs both
+   *  versions of create(), where anything other than the heap may be given
+   *  as nullptr to have it allocated from the heap instead.
+   *
+   *  @param[in]  context     Memory for the Context object
+   *  @param[in]  threadStack Memory for the network manager thread stack
+   *  @param[in]  stackSize   Bytes in threadStack
+   *  @param[in]  pools       Memory for the block pools
+   *  @param[in]  poolSize    Bytes in pools
+   *  @param[in]  heap        Memory for the context's heap
+   *  @param[in]  heapSize    Bytes in heap
+   *  @return Context         Created context object
+   */
+  Context_rPtr createInPlace( void *const context, void *const threadStack, const size_t stackSize, void *const pools,
+                              const size_t poolSize, void *const heap, const size_t heapSize );
+
+  /**
+   *  Builds a context from the memory set aside by a StaticStack. Can only
+   *  be done once per stack.
+   *
+   *  @param[in]  stack       Statically placed stack memory
+   *  @return Context         Created context object, nullptr if already used
+   */
+  template<const size_t HEAP_BYTES>
+  Context_rPtr create( StaticStack<HEAP_BYTES> &stack )
+  {
+    void *const rawContext = stack.context.claim();
+    if ( !rawContext )
+    {
+      return nullptr;
+    }
+
+    return createInPlace( rawContext, stack.managerStack, sizeof( stack.managerStack ), stack.pools, sizeof( stack.pools ),
+                          stack.heap, sizeof( stack.heap ) );
+  }
+
   /**
    *  Powers up the modules used in processing the network stack. Upon exit, the
    *  network stack is ready for operations.
@@ -11,6 +11,9 @@
 /* Aurora Includes */
 #include <Aurora/logging>
 
+/* Chimera Includes */
+#include <Chimera/thread>
+
 /* Nanopb Includes */
 #include "pb.h"
 #include "pb_common.h"
@@ -24,66 +27,109 @@
 namespace Ripple
 {
   /*-------------------------------------------------------------------------------
-  Public Functions
+  Structures
   -------------------------------------------------------------------------------*/
-  bool transmit( const PacketId pkt, Socket &socket, const void *const data, const size_t size )
+  /**
+   *  Encodes one application packet straight into wherever the socket sends it
+   *  from. Safe to run more than once if the socket asks again.
+   */
+  struct EncodedPacket
   {
-    /*-----------------------------------------------------------------
-    Look up packet to see if supported by the socket
-    -----------------------------------------------------------------*/
-    if ( !packetInFilter( pkt, socket.mConfig.txFilter ) )
+    PacketHdr header;           /**< Header leading the encoded data */
+    const pb_msgdesc_t *fields; /**< Descriptor the data is encoded with, nullptr to copy it raw */
+    const void *data;           /**< NanoPB structure to encode, or header.size raw bytes */
+
+    bool fill( PacketWriter &writer )
     {
-      LOG_ERROR( "TX of packet %d not supported by socket\r\n", pkt );
-      return false;
+      if ( !writer.write( &header, sizeof( PacketHdr ) ) )
+      {
+        return false;
+      }
+
+      if ( !fields )
+      {
+        return writer.write( data, header.size );
+      }
+
+      /*-------------------------------------------------
+      The record always takes its full declared size
+      -------------------------------------------------*/
+      pb_ostream_t stream = pbOutputStream( writer, header.size );
+      if ( !pb_encode( &stream, fields, data ) )
+      {
+        return false;
+      }
+
+      return writer.pad( header.size - stream.bytes_written );
     }
+  };
+
+  /*-------------------------------------------------------------------------------
+  Public Functions
+  -------------------------------------------------------------------------------*/
+  bool transmit( const PacketId pkt, Socket &socket, const void *const data, const size_t size )
+  {
+    return transmitAsync( pkt, socket, data, size, TXCallback(), 0 );
+  }
+
+
+  bool transmit( const PacketId pkt, Socket &socket, const void *const data, const size_t size, const size_t timeout )
+  {
+    return transmitAsync( pkt, socket, data, size, TXCallback(), timeout );
+  }
+
 
-    auto iter = PacketDefinitions.find( pkt );
-    if ( iter == PacketDefinitions.end() )
+  bool transmitAsync( const PacketId pkt, Socket &socket, const void *const data, const size_t size, TXCallback callback,
+                      const size_t timeout )
+  {
+    const PacketDef *def = packetDefinition( pkt );
+    if ( !def )
     {
       LOG_ERROR( "Packet ID [%d] not found in project definitions table\r\n", pkt );
       return false;
     }
 
-    PacketDef pktDef = iter->second;
+    return transmitEncoded( pkt, def->fields, def->size, socket, data, callback, timeout );
+  }
+
 
+  bool transmitEncoded( const PacketId pkt, const pb_msgdesc_t *const fields, const size_t size, Socket &socket,
+                        const void *const data, TXCallback callback, const size_t timeout )
+  {
     /*-----------------------------------------------------------------
-    Calculate sizing paramters and allocate memory for the encoded data
-    plus the packet header.
+    Look up packet to see if supported by the socket
     -----------------------------------------------------------------*/
-    size_t allocSize      = sizeof( PacketHdr ) + pktDef.size;
-    uint8_t *packetBuffer = reinterpret_cast<uint8_t *>( socket.mContext->malloc( allocSize ) );
-
-    if ( !packetBuffer )
+    if ( !packetInFilter( pkt, socket.mConfig.txFilter ) )
     {
-      LOG_ERROR( "Unable to allocate [%d] bytes for packet [%d]\r\n", allocSize, pkt );
+      LOG_ERROR( "TX of packet %d not supported by socket\r\n", pkt );
       return false;
     }
-    else
-    {
-      memset( packetBuffer, 0, allocSize );
-    }
 
     /*-----------------------------------------------------------------
-    Encode the data according to the packet definition
+    Encode the data according to the packet definition, straight into
+    the socket's gathering buffer or the packet that carries it
     -----------------------------------------------------------------*/
-    uint8_t *encoderView = packetBuffer + sizeof( PacketHdr );
-    pb_ostream_t stream  = pb_ostream_from_buffer( encoderView, pktDef.size );
+    EncodedPacket record = {};
+    record.header.id     = pkt;
+    record.header.size   = static_cast<uint8_t>( size );
+    record.fields        = fields;
+    record.data          = data;
 
-    if ( !pb_encode( &stream, pktDef.fields, data ) )
-    {
-      socket.mContext->free( packetBuffer );
-      return false;
-    }
-
-    PacketHdr *hdr = reinterpret_cast<PacketHdr *>( packetBuffer );
-    hdr->id        = pkt;
-    hdr->size      = pktDef.size;
+    const size_t recordSize   = sizeof( PacketHdr ) + size;
+    const PacketFiller filler = PacketFiller::create<EncodedPacket, &EncodedPacket::fill>( record );
 
     /*-----------------------------------------------------------------
-    Write the raw bytes
+    Write the raw bytes. A full socket queue means the link is behind,
+    so wait for it to catch up if allowed to.
     -----------------------------------------------------------------*/
-    auto result = socket.write( packetBuffer, allocSize );
-    socket.mContext->free( packetBuffer );
+    const size_t start = Chimera::millis();
+    auto result        = socket.writePacket( filler, recordSize, callback );
+
+    while ( ( result == Chimera::Status::FULL ) && ( ( Chimera::millis() - start ) < timeout ) )
+    {
+      Chimera::delayMilliseconds( 1 );
+      result = socket.writePacket( filler, recordSize, callback );
+    }
 
     return ( result == Chimera::Status::OK );
   }
@@ -92,7 +138,8 @@ namespace Ripple
   bool onReceive( const PacketId pkt, Socket &socket, PacketCallback callback )
   {
     /*-----------------------------------------------------------------
-    Look up packet to see if supported by the socket
+    Look up packet to see if supported by the socket. The filter only
+    holds valid IDs, so a pass means the ID can index the table.
     -----------------------------------------------------------------*/
     if ( !packetInFilter( pkt, socket.mConfig.rxFilter ) )
     {
@@ -101,34 +148,36 @@ namespace Ripple
     }
 
     /*-----------------------------------------------------------------
-    Is the packet already in existence? Replace the callback.
+    Register the callback, replacing any that already exists
     -----------------------------------------------------------------*/
-    auto iter = socket.mPktCallbacks.find( pkt );
-    if ( iter != socket.mPktCallbacks.end() )
-    {
-      iter->second = callback;
-      return true;
-    }
+    socket.mPktCallbacks[ pkt ] = callback;
+    return true;
+  }
 
-    /*-----------------------------------------------------------------
-    New packet to add. Try and push the registry in.
-    -----------------------------------------------------------------*/
-    if ( !socket.mPktCallbacks.full() )
+
+  bool onReceive( Socket &socket, PacketCallback callback )
+  {
+    socket.mCommonPktCallback = callback;
+    return true;
+  }
+
+
+  bool onReceive( const PacketId pkt, Socket &socket, PacketViewCallback callback )
+  {
+    if ( !packetInFilter( pkt, socket.mConfig.rxFilter ) )
     {
-      socket.mPktCallbacks.insert( { pkt, callback } );
-      return true;
+      LOG_DEBUG( "RX of packet %d not supported\r\n", pkt );
+      return false;
     }
 
-    /*-----------------------------------------------------------------
-    Last resort. If we make it here, there was no registration.
-    -----------------------------------------------------------------*/
-    return false;
+    socket.mViewCallbacks[ pkt ] = callback;
+    return true;
   }
 
 
-  bool onReceive( Socket &socket, PacketCallback callback )
+  bool onReceive( Socket &socket, PacketViewCallback callback )
   {
-    socket.mCommonPktCallback = callback;
+    socket.mCommonViewCallback = callback;
     return true;
   }
 
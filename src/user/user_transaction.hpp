@@ -13,6 +13,7 @@
 #define RIPPLE_USER_TRANSACTIONS_HPP
 
 /* Ripple Includes */
+#include <Ripple/src/netstack/packets/registry.hpp>
 #include <Ripple/src/netstack/packets/types.hpp>
 #include <Ripple/src/netstack/socket.hpp>
 
@@ -30,10 +31,98 @@ namespace Ripple
    * @param data      Packet's data
    * @param size      Packet's size (must match size in packet definitions)
    * @return true     The packet was queued for transmission
-   * @return false    The packet couldn't be queued for some reason
+   * @return false    The packet couldn't be queued for some reason, including a full socket queue
    */
   bool transmit( const PacketId pkt, Socket &socket, const void *const data, const size_t size );
 
+  /**
+   * @brief Transmit a packet on the network, waiting for room in the socket queue
+   *
+   * @param pkt       Which packet to transmit
+   * @param socket    Socket connection the packet will be transmitted through
+   * @param data      Packet's data
+   * @param size      Packet's size (must match size in packet definitions)
+   * @param timeout   Longest to wait for room (ms)
+   * @return true     The packet was queued for transmission
+   * @return false    The packet couldn't be queued before the timeout, or at all
+   */
+  bool transmit( const PacketId pkt, Socket &socket, const void *const data, const size_t size, const size_t timeout );
+
+  /**
+   * @brief Transmit a packet on the network, being told later how it went
+   *
+   * The callback runs on the net manager thread once every frame of the packet
+   * was admitted to the netif, or once the packet was dropped. It is not run if
+   * this call returns false. Packets sent this way are never coalesced.
+   *
+   * @param pkt       Which packet to transmit
+   * @param socket    Socket connection the packet will be transmitted through
+   * @param data      Packet's data
+   * @param size      Packet's size (must match size in packet definitions)
+   * @param callback  Told the outcome of the send
+   * @param timeout   Longest to wait for room in the socket queue (ms)
+   * @return true     The packet was queued for transmission
+   * @return false    The packet couldn't be queued
+   */
+  bool transmitAsync( const PacketId pkt, Socket &socket, const void *const data, const size_t size, TXCallback callback,
+                      const size_t timeout = 0 );
+
+  /**
+   * @brief Transmit a packet already resolved against its definition
+   *
+   * Shared by the ID based and typed transmit calls. Everything about the
+   * packet is taken as given, only the socket's TX filter is checked.
+   *
+   * @param pkt       Which packet to transmit
+   * @param fields    NanoPB descriptor of the data, or nullptr to send it as raw bytes
+   * @param size      Most bytes the data encodes to, or the exact raw byte count
+   * @param socket    Socket connection the packet will be transmitted through
+   * @param data      Packet's data
+   * @param callback  Told the outcome of the send
+   * @param timeout   Longest to wait for room in the socket queue (ms)
+   * @return true     The packet was queued for transmission
+   * @return false    The packet couldn't be queued
+   */
+  bool transmitEncoded( const PacketId pkt, const pb_msgdesc_t *const fields, const size_t size, Socket &socket,
+                        const void *const data, TXCallback callback, const size_t timeout );
+
+  /**
+   * @brief Transmit a packet type registered with RIPPLE_REGISTER_PACKET()
+   *
+   * The ID, encoded size and NanoPB descriptor come from the type, so there
+   * is no table look up and nothing to get out of step with the definitions.
+   *
+   * @param socket    Socket connection the packet will be transmitted through
+   * @param msg       Packet's data
+   * @param timeout   Longest to wait for room in the socket queue (ms)
+   * @return true     The packet was queued for transmission
+   * @return false    The packet couldn't be queued
+   */
+  template<typename PacketType>
+  bool transmit( Socket &socket, const PacketType &msg, const size_t timeout = 0 )
+  {
+    using Traits = PacketTraits<PacketType>;
+    return transmitEncoded( Traits::id, Traits::fields, Traits::size, socket, &msg, TXCallback(), timeout );
+  }
+
+  /**
+   * @brief Transmit a registered packet type, being told later how it went
+   * @see transmitAsync( const PacketId, Socket &, const void *const, const size_t, TXCallback, const size_t )
+   *
+   * @param socket    Socket connection the packet will be transmitted through
+   * @param msg       Packet's data
+   * @param callback  Told the outcome of the send
+   * @param timeout   Longest to wait for room in the socket queue (ms)
+   * @return true     The packet was queued for transmission
+   * @return false    The packet couldn't be queued
+   */
+  template<typename PacketType>
+  bool transmitAsync( Socket &socket, const PacketType &msg, TXCallback callback, const size_t timeout = 0 )
+  {
+    using Traits = PacketTraits<PacketType>;
+    return transmitEncoded( Traits::id, Traits::fields, Traits::size, socket, &msg, callback, timeout );
+  }
+
   /**
    * @brief Register a callback to execute when a particular packet is received
    * @note This callback will supercede any generic callback that has been registered
@@ -58,6 +147,29 @@ namespace Ripple
    */
   bool onReceive( Socket &socket, PacketCallback callback );
 
+  /**
+   * @brief Register a callback that is lent the received packet as a view
+   * @note Supercedes a raw callback registered for the same packet, and any generic one
+   *
+   * @param pkt       Which packet to register the callback against
+   * @param socket    Socket connection that should listen for the packet and execute the callback
+   * @param callback  Callback to execute
+   * @return true     The callback was registered
+   * @return false    The callback failed to be registered
+   */
+  bool onReceive( const PacketId pkt, Socket &socket, PacketViewCallback callback );
+
+  /**
+   * @brief Register a generic callback that is lent any received packet as a view
+   * @note Supercedes a raw generic callback. Only one may be registered.
+   *
+   * @param socket    Socket connection to listen for packets on
+   * @param callback  Callback to execute
+   * @return true     The callback was registered
+   * @return false    The callback failed to be registered
+   */
+  bool onReceive( Socket &socket, PacketViewCallback callback );
+
 }  // namespace Ripple
 
 #endif  /* !RIPPLE_USER_TRANSACTIONS_HPP */